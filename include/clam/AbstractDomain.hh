@@ -3,7 +3,10 @@
 #include "clam/config.h"
 #include "crab/config.h"
 #include "clam/crab/crab_domains.hh"
+#include "crab/analysis/abs_transformer.hpp"
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 
 /**
@@ -22,15 +25,15 @@ namespace llvm {
   #define DUMP_TO_LLVM_STREAM(T)  \
   inline llvm::raw_ostream& operator<<(llvm::raw_ostream& o, \
                                        T& e) {               \
-    crab::crab_string_os s;                                  \
+    clam::crab_raw_os s(o);                                  \
     s << e;                                                  \
-    o << s.str ();                                           \
     return o; }                                                        
 
   DUMP_TO_LLVM_STREAM(clam::lin_exp_t)
   DUMP_TO_LLVM_STREAM(clam::lin_cst_t)
   DUMP_TO_LLVM_STREAM(clam::lin_cst_sys_t)
   DUMP_TO_LLVM_STREAM(clam::interval_domain_t)
+  DUMP_TO_LLVM_STREAM(clam::dense_interval_domain_t)
   DUMP_TO_LLVM_STREAM(clam::wrapped_interval_domain_t)
   DUMP_TO_LLVM_STREAM(clam::ric_domain_t)
   DUMP_TO_LLVM_STREAM(clam::split_dbm_domain_t)
@@ -41,9 +44,8 @@ namespace llvm {
   template <typename DomInfo>
   inline llvm::raw_ostream& operator<<(llvm::raw_ostream& o, 
                                        crab::domains::term_domain<DomInfo>& inv) {
-    crab::crab_string_os s;
+    clam::crab_raw_os s(o);
     s << inv;
-    o << s.str ();
     return o;
   }
 
@@ -52,9 +54,8 @@ namespace llvm {
   inline llvm::raw_ostream& operator<<(llvm::raw_ostream& o, 
   				       crab::domains::apron_domain 
   				       <N,V,D> & inv) {
-    crab::crab_string_os s;
+    clam::crab_raw_os s(o);
     s << inv;
-    o << s.str ();
     return o;
   }
   #else 
@@ -62,9 +63,8 @@ namespace llvm {
   inline llvm::raw_ostream& operator<<(llvm::raw_ostream& o, 
 				       crab::domains::elina_domain 
 				       <N,V,D> & inv) {
-    crab::crab_string_os s;
+    clam::crab_raw_os s(o);
     s << inv;
-    o << s.str ();
     return o;
   }
   #endif
@@ -72,9 +72,8 @@ namespace llvm {
   template <typename Base>
   inline llvm::raw_ostream& operator<<(llvm::raw_ostream& o, 
 				       crab::domains::array_smashing <Base> & inv) {
-    crab::crab_string_os s;
+    clam::crab_raw_os s(o);
     s << inv;
-    o << s.str ();
     return o;
   }
 
@@ -91,6 +90,8 @@ namespace clam {
    class WRAPPER: public GenericAbsDomWrapper {                      \
      id_t m_id;                                                      \
      ABS_DOM m_abs;                                                  \
+     /* linear constraints of m_abs (null until requested) */        \
+     std::shared_ptr<const lin_cst_sys_t> m_csts;                    \
     public:                                                          \
     id_t getId() const { return m_id;}				     \
     								     \
@@ -102,11 +103,34 @@ namespace clam {
     								     \
     GenericAbsDomWrapperPtr clone() const {			     \
       auto res = std::make_shared<WRAPPER>(m_abs, m_id); 	     \
+      res->m_csts = m_csts;					     \
       return res;						     \
     }								     \
     								     \
-    ABS_DOM& get() { return m_abs; }				     \
+    GenericAbsDomWrapperPtr make(bool is_bottom,		     \
+				 const lin_cst_sys_t& csts) const {  \
+      ABS_DOM abs;						     \
+      if (is_bottom) {						     \
+	abs = ABS_DOM::bottom();				     \
+      } else {							     \
+	abs += csts;						     \
+      }								     \
+      return std::make_shared<WRAPPER>(abs, m_id);		     \
+    }								     \
+								     \
+    /* the caller can modify the invariant */			     \
+    ABS_DOM& get() { m_csts.reset(); return m_abs; }		     \
+								     \
+    const ABS_DOM& get() const { return m_abs; }		     \
                                                                      \
+    bool equals(GenericAbsDomWrapper &o) {			     \
+      if (o.getId() != m_id) {					     \
+	return false;						     \
+      }								     \
+      WRAPPER &other = static_cast<WRAPPER&>(o);		     \
+      return m_abs <= other.m_abs && other.m_abs <= m_abs;	     \
+    }								     \
+								     \
     bool is_bottom() {						     \
       return m_abs.is_bottom();					     \
     }								     \
@@ -117,14 +141,56 @@ namespace clam {
   								     \
     void forget(const std::vector<var_t>& vars) {		     \
       m_abs.forget(vars);					     \
+      m_csts.reset();						     \
     }								     \
     								     \
     void project(const std::vector<var_t>& vars) {		     \
       m_abs.project(vars);					     \
+      m_csts.reset();						     \
     }								     \
   								     \
-    lin_cst_sys_t to_linear_constraints() {			     \
-      return m_abs.to_linear_constraint_system();		     \
+    const lin_cst_sys_t& to_linear_constraints() {		     \
+      if (!m_csts) {						     \
+	m_csts = std::make_shared<const lin_cst_sys_t>		     \
+	  (m_abs.to_linear_constraint_system());		     \
+      }								     \
+      return *m_csts;						     \
+    }								     \
+    								     \
+    lin_cst_sys_t filter_linear_constraints(const std::vector<var_t>& vars) { \
+      return filter_constraints(to_linear_constraints(), vars);    \
+    }								     \
+    								     \
+    lin_cst_sys_t to_linear_constraints(const std::vector<var_t>& vars) { \
+      ABS_DOM abs(m_abs);					     \
+      abs.project(vars);					     \
+      return abs.to_linear_constraint_system();		     \
+    }								     \
+    								     \
+    void propagate(basic_block_t& bb, const statement_callback_t& f) { \
+      crab::analyzer::intra_abs_transformer<ABS_DOM> vis(m_abs);    \
+      for (auto &s: bb) {					     \
+	s.accept(&vis);						     \
+	auto filter = [&vis](const std::vector<var_t>& vs) {	     \
+	  return filter_constraints				     \
+	    (vis.get_abs_value().to_linear_constraint_system(), vs); \
+	};							     \
+	if (!f(s, vis.get_abs_value().is_top(), filter)) {	     \
+	  break;						     \
+	}							     \
+      }								     \
+    }								     \
+    								     \
+    void replay(basic_block_t& bb, const statement_filter_t& keep,  \
+		std::vector<GenericAbsDomWrapperPtr>& states) {      \
+      crab::analyzer::intra_abs_transformer<ABS_DOM> vis(m_abs);    \
+      for (auto &s: bb) {					     \
+	if (keep(s)) {						     \
+	  states.push_back(std::make_shared<WRAPPER>(vis.get_abs_value(), m_id)); \
+	}							     \
+	s.accept(&vis);						     \
+      }								     \
+      states.push_back(std::make_shared<WRAPPER>(vis.get_abs_value(), m_id)); \
     }								     \
     								     \
     void write(crab::crab_os& o) {				     \
@@ -141,10 +207,26 @@ namespace clam {
    template <>                                                       \
    inline void getAbsDomWrappee (GenericAbsDomWrapperPtr wrapper,    \
                                  ABS_DOM &abs_dom) {                 \
-     auto wrappee = std::static_pointer_cast<WRAPPER> (wrapper);     \
+     auto wrappee = std::static_pointer_cast<const WRAPPER> (wrapper); \
      abs_dom = wrappee->get ();                                      \
    }                                                 
 
+  // Return the constraints of csts that involve at least one of vars
+  inline lin_cst_sys_t filter_constraints(const lin_cst_sys_t& csts,
+					  std::vector<var_t> vars) {
+    std::sort(vars.begin(), vars.end());
+    lin_cst_sys_t res;
+    for (auto const& cst: csts) {
+      for (auto const& v: cst.variables()) {
+	if (std::binary_search(vars.begin(), vars.end(), v)) {
+	  res += cst;
+	  break;
+	}
+      }
+    }
+    return res;
+  }
+
   //////
   // Generic wrapper to encapsulate an arbitrary abstract domain
   //////
@@ -152,6 +234,19 @@ namespace clam {
   struct GenericAbsDomWrapper {
 
     typedef std::shared_ptr<GenericAbsDomWrapper> GenericAbsDomWrapperPtr;
+
+    // Return the linear constraints of the current invariant that
+    // involve at least one of the variables. 
+    typedef std::function<lin_cst_sys_t(const std::vector<var_t>&)>
+    constraints_filter_t;
+    // Called after each statement with the statement, whether the
+    // invariant after the statement is top and a filter to extract
+    // the relevant constraints of that invariant. Return false to
+    // stop the propagation.
+    typedef std::function<bool(const statement_t&, bool,
+			       const constraints_filter_t&)> statement_callback_t;
+    // Return true if the invariant before the statement is needed
+    typedef std::function<bool(statement_t&)> statement_filter_t;
     
     typedef enum { intv, split_dbm, 
 		   term_intv, term_dis_intv, 
@@ -159,7 +254,8 @@ namespace clam {
 		   boxes, dis_intv,
 		   oct, pk,
 		   num,
-		   w_intv} id_t;
+		   w_intv,
+		   dense_intv} id_t;
     
     GenericAbsDomWrapper() { }
     
@@ -168,14 +264,46 @@ namespace clam {
     virtual id_t getId() const = 0;
     
     virtual GenericAbsDomWrapperPtr clone() const = 0;
+
+    // Return a new invariant of the same domain that is bottom or the
+    // conjunction of csts.
+    virtual GenericAbsDomWrapperPtr make(bool is_bottom,
+					 const lin_cst_sys_t& csts) const = 0;
     
     virtual void write(crab::crab_os& o) = 0;
 
     virtual bool is_bottom() = 0;
 
     virtual bool is_top() = 0;
+
+    // Return true if o wraps the same abstract domain and both
+    // invariants are included in each other.
+    virtual bool equals(GenericAbsDomWrapper &o) = 0;
       
-    virtual lin_cst_sys_t to_linear_constraints() = 0;
+    // The constraints are computed on the first call and kept until
+    // the invariant is modified.
+    virtual const lin_cst_sys_t& to_linear_constraints() = 0;
+
+    // Return the constraints of to_linear_constraints() that involve
+    // at least one of the variables. Unlike the projection below, no
+    // new constraint is inferred.
+    virtual lin_cst_sys_t filter_linear_constraints(const std::vector<var_t>& vars) = 0;
+
+    // Return the linear constraints of the projection of the
+    // invariant onto vars. The invariant is not modified.
+    virtual lin_cst_sys_t to_linear_constraints(const std::vector<var_t>& vars) = 0;
+
+    // Propagate the invariant forward through the statements of bb
+    // and call f after each statement. The invariant is not modified
+    // and the client does not need to know the underlying domain.
+    virtual void propagate(basic_block_t& bb, const statement_callback_t& f) = 0;
+
+    // Propagate the invariant forward through the statements of bb
+    // and add to states a new invariant just before each statement s
+    // such that keep(s), and then the invariant at the end of bb. The
+    // invariant is not modified.
+    virtual void replay(basic_block_t& bb, const statement_filter_t& keep,
+			std::vector<GenericAbsDomWrapperPtr>& states) = 0;
     
     virtual void forget(const std::vector<var_t>& vars) = 0;
     
@@ -192,9 +320,8 @@ namespace clam {
 
    inline llvm::raw_ostream& operator<<(llvm::raw_ostream& o , 
                                         const GenericAbsDomWrapperPtr& v) {
-     crab::crab_string_os s;
+     crab_raw_os s(o);
      v->write (s);
-     o << s.str ();
      return o;
    }
 
@@ -207,6 +334,7 @@ namespace clam {
    inline void getAbsDomWrappee (GenericAbsDomWrapperPtr wrapper, T& wrappee);
 
    DEFINE_WRAPPER(IntervalDomainWrapper,interval_domain_t,intv)
+   DEFINE_WRAPPER(DenseIntervalDomainWrapper,dense_interval_domain_t,dense_intv)
    DEFINE_WRAPPER(WrappedIntervalDomainWrapper,wrapped_interval_domain_t,w_intv)
    DEFINE_WRAPPER(RicDomainWrapper,ric_domain_t,ric)
    DEFINE_WRAPPER(SDbmDomainWrapper,split_dbm_domain_t,split_dbm)
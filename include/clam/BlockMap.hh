@@ -0,0 +1,278 @@
+#pragma once
+
+/* Map from the basic blocks of a module to values (e.g., invariants) */
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace clam {
+
+/**
+ * A table per function with one slot per block, indexed by the
+ * position of the block in its function (the order in which the crab
+ * blocks are created by the CfgBuilder). The blocks of a function are
+ * numbered once, when the first value of the function is inserted,
+ * so adding the values of all the blocks of a large module only
+ * grows small per-function tables and never rehashes one map with an
+ * entry per block.
+ *
+ * The interface is the subset of llvm::DenseMap used by clam. The
+ * iteration order is the order in which the functions were added
+ * and then the layout order of their blocks.
+ *
+ * The table of a function can also keep an object alive for as long
+ * as the values of the function are in the map (e.g., the variable
+ * scope that names the variables of its invariants).
+ **/
+template <typename Value> class block_map {
+public:
+  using key_type = const llvm::BasicBlock *;
+  using mapped_type = Value;
+  using value_type = std::pair<const llvm::BasicBlock *, Value>;
+
+private:
+  struct function_table_t {
+    const llvm::Function *func;
+    // number of each block of func
+    llvm::DenseMap<const llvm::BasicBlock *, unsigned> numbers;
+    // slot.first is null if the block has no value
+    std::vector<value_type> slots;
+    unsigned size;
+    // kept alive with the values of func (it can be null)
+    std::shared_ptr<const void> owner;
+
+    explicit function_table_t(const llvm::Function &F) : func(&F), size(0) {
+      numbers.reserve(F.size());
+      unsigned n = 0;
+      for (auto &B : F) {
+        numbers.insert(std::make_pair(&B, n++));
+      }
+      slots.resize(n, value_type(nullptr, Value()));
+    }
+
+    // A block added to func after the numbering gets the next number
+    unsigned get_number(const llvm::BasicBlock *B) {
+      auto it = numbers.find(B);
+      if (it != numbers.end()) {
+        return it->second;
+      }
+      unsigned n = slots.size();
+      numbers.insert({B, n});
+      slots.push_back(value_type(nullptr, Value()));
+      return n;
+    }
+  };
+
+  std::vector<function_table_t> m_tables;
+  llvm::DenseMap<const llvm::Function *, unsigned> m_table_index;
+  unsigned m_size;
+
+  template <typename Map, typename Ref> class iterator_base {
+    // move to the first slot with a value from the current position
+    void skip_empty() {
+      while (m_table < m_map->m_tables.size()) {
+        auto &slots = m_map->m_tables[m_table].slots;
+        while (m_slot < slots.size() && !slots[m_slot].first) {
+          ++m_slot;
+        }
+        if (m_slot < slots.size()) {
+          return;
+        }
+        ++m_table;
+        m_slot = 0;
+      }
+    }
+
+  public:
+    // position in the map (used by block_map and the conversion of
+    // iterator to const_iterator)
+    Map *m_map;
+    unsigned m_table;
+    unsigned m_slot;
+
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename block_map<Value>::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = typename std::remove_reference<Ref>::type *;
+    using reference = Ref;
+
+    iterator_base(Map *map, unsigned table, unsigned slot)
+        : m_map(map), m_table(table), m_slot(slot) {
+      skip_empty();
+    }
+
+    // iterator to const_iterator
+    template <typename OMap, typename ORef>
+    iterator_base(const iterator_base<OMap, ORef> &o)
+        : m_map(o.m_map), m_table(o.m_table), m_slot(o.m_slot) {}
+
+    Ref operator*() const { return m_map->m_tables[m_table].slots[m_slot]; }
+    pointer operator->() const { return &**this; }
+
+    iterator_base &operator++() {
+      ++m_slot;
+      skip_empty();
+      return *this;
+    }
+
+    iterator_base operator++(int) {
+      iterator_base res(*this);
+      ++*this;
+      return res;
+    }
+
+    bool operator==(const iterator_base &o) const {
+      return m_table == o.m_table && m_slot == o.m_slot;
+    }
+    bool operator!=(const iterator_base &o) const { return !(*this == o); }
+  };
+
+  // index of the table of the function of B
+  unsigned get_or_create_table(const llvm::BasicBlock *B) {
+    return get_or_create_table(*B->getParent());
+  }
+
+  unsigned get_or_create_table(const llvm::Function &F) {
+    auto it = m_table_index.find(&F);
+    if (it != m_table_index.end()) {
+      return it->second;
+    }
+    unsigned table = m_tables.size();
+    m_table_index.insert(std::make_pair(&F, table));
+    m_tables.emplace_back(F);
+    return table;
+  }
+
+  // position of the value of B: (table, slot) or end
+  std::pair<unsigned, unsigned> position(const llvm::BasicBlock *B) const {
+    auto it = m_table_index.find(B->getParent());
+    if (it != m_table_index.end()) {
+      const function_table_t &t = m_tables[it->second];
+      auto nit = t.numbers.find(B);
+      if (nit != t.numbers.end() && t.slots[nit->second].first) {
+        return {it->second, nit->second};
+      }
+    }
+    return {m_tables.size(), 0};
+  }
+
+public:
+  using iterator = iterator_base<block_map<Value>, value_type &>;
+  using const_iterator =
+      iterator_base<const block_map<Value>, const value_type &>;
+
+  block_map() : m_size(0) {}
+
+  iterator begin() { return iterator(this, 0, 0); }
+  iterator end() { return iterator(this, m_tables.size(), 0); }
+  const_iterator begin() const { return const_iterator(this, 0, 0); }
+  const_iterator end() const {
+    return const_iterator(this, m_tables.size(), 0);
+  }
+
+  unsigned size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  iterator find(const llvm::BasicBlock *B) {
+    auto p = position(B);
+    return iterator(this, p.first, p.second);
+  }
+
+  const_iterator find(const llvm::BasicBlock *B) const {
+    auto p = position(B);
+    return const_iterator(this, p.first, p.second);
+  }
+
+  unsigned count(const llvm::BasicBlock *B) const {
+    return position(B).first < m_tables.size();
+  }
+
+  // Return the value of B or Value() if none
+  Value lookup(const llvm::BasicBlock *B) const {
+    auto p = position(B);
+    return p.first < m_tables.size() ? m_tables[p.first].slots[p.second].second
+                                     : Value();
+  }
+
+  // As DenseMap, do nothing if the block has already a value
+  std::pair<iterator, bool> insert(const value_type &kv) {
+    unsigned table = get_or_create_table(kv.first);
+    function_table_t &t = m_tables[table];
+    unsigned n = t.get_number(kv.first);
+    if (t.slots[n].first) {
+      return {iterator(this, table, n), false};
+    }
+    t.slots[n] = kv;
+    ++t.size;
+    ++m_size;
+    return {iterator(this, table, n), true};
+  }
+
+  template <typename It> void insert(It begin, It end) {
+    for (; begin != end; ++begin) {
+      insert(*begin);
+    }
+  }
+
+  Value &operator[](const llvm::BasicBlock *B) {
+    return insert(value_type(B, Value())).first->second;
+  }
+
+  void erase(iterator it) {
+    function_table_t &t = m_tables[it.m_table];
+    t.slots[it.m_slot] = value_type(nullptr, Value());
+    --t.size;
+    --m_size;
+  }
+
+  bool erase(const llvm::BasicBlock *B) {
+    iterator it = find(B);
+    if (it == end()) {
+      return false;
+    }
+    erase(it);
+    return true;
+  }
+
+  // Keep owner alive until the table of F is removed by
+  // erase_function or clear. It replaces the previous owner of F.
+  void set_owner(const llvm::Function &F, std::shared_ptr<const void> owner) {
+    m_tables[get_or_create_table(F)].owner = std::move(owner);
+  }
+
+  std::shared_ptr<const void> get_owner(const llvm::Function &F) const {
+    auto it = m_table_index.find(&F);
+    return it != m_table_index.end() ? m_tables[it->second].owner : nullptr;
+  }
+
+  // Remove the table of F (with the numbering of its blocks and its
+  // owner)
+  void erase_function(const llvm::Function &F) {
+    auto it = m_table_index.find(&F);
+    if (it == m_table_index.end()) {
+      return;
+    }
+    function_table_t &t = m_tables[it->second];
+    m_size -= t.size;
+    t.slots.clear();
+    t.numbers.clear();
+    t.size = 0;
+    t.owner.reset();
+  }
+
+  void clear() {
+    m_tables.clear();
+    m_table_index.clear();
+    m_size = 0;
+  }
+};
+
+} // end namespace clam
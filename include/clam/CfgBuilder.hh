@@ -7,17 +7,25 @@
 #include "clam/crab/crab_cfg.hh"
 #include "clam/CfgBuilderParams.hh"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/Optional.h"
 
 #include "crab/analysis/dataflow/liveness.hpp"
 
+#include <array>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
 
 // forward declarations
 namespace llvm {
   class DataLayout;
   class TargetLibraryInfo;
   class BasicBlock;
+  class Module;
   class Function;
   class Twine;
   class raw_ostream;
@@ -26,6 +34,12 @@ namespace llvm {
 namespace clam {
   class HeapAbstraction;
   class CfgBuilderImpl;
+  class crabLitCache;
+  class crabCalleeTable;
+  class CfgBuilderDiagnostics;
+  class FunctionSummaries;
+  class SparseLiveness;
+  class PrecisionSelection;
 }
 
 namespace sea_dsa {
@@ -40,6 +54,7 @@ namespace clam {
 class CrabBuilderManager;
 class IntraClam_Impl;
 class InterClam_Impl;
+class FrozenCfg;
 
 class CfgBuilder {
 public:
@@ -47,25 +62,97 @@ public:
   using liveness_t = crab::analyzer::liveness<cfg_ref_t>;
   using varset = typename liveness_t::varset_domain_t;
 
+  // A depth-first search from the entry finds the loop heads as the
+  // targets of the edges to a block on the stack. The reachable
+  // blocks are also kept in reverse post-order, so that every edge
+  // that is not a back edge goes forward.
+  struct loop_order_t {
+    basic_block_label_t entry;
+    std::set<basic_block_label_t> heads;
+    std::set<basic_block_label_t> reachable;
+    std::vector<basic_block_label_t> rpo;
+    loop_order_t(basic_block_label_t e) : entry(e) {}
+  };
+
+  // Preferred representation in the array domain of the array of a
+  // region, from the size of the objects of the region allocated or
+  // used by the function (see CrabBuilderParams::array_expand_max_elems).
+  // elems is the number of elements of the largest object or 0 if
+  // its size is not constant.
+  enum class array_repr_t { EXPAND, SMASH };
+  struct region_array_repr_t {
+    array_repr_t repr;
+    uint64_t elems;
+  };
+  // indexed by region id
+  using array_repr_map_t = std::map<unsigned long, region_array_repr_t>;
+
 private:
   
   friend class CrabBuilderManager;
   friend class IntraClam_Impl;
   friend class InterClam_Impl;
   
+  // parameters of the function (the precision level can be chosen
+  // per function)
+  CrabBuilderParams m_params;
+  // the factory of the variables and the scope of the variables of
+  // the function (only if function_var_scopes). They are declared
+  // before the members that refer to the names of the scope so that
+  // they are destroyed after them.
+  llvm_variable_factory *m_vfac;
+  llvm_variable_factory::scope_ptr m_var_scope;
   // the actual cfg builder
   std::unique_ptr<CfgBuilderImpl> m_impl;
-  // live symbols
-  std::unique_ptr<crab::analyzer::liveness<cfg_ref_t>> m_ls;
+  // live symbols as sparse bit-vectors
+  std::unique_ptr<SparseLiveness> m_ls;
+  // live symbols in the format of the crab analyzers: only built if
+  // they are given to an analyzer. Shared with the frozen views.
+  std::shared_ptr<crab::analyzer::liveness<cfg_ref_t>> m_crab_ls;
+  // version of the cfg: it changes each time the cfg is modified
+  unsigned m_cfg_version;
+  // version of the cfg used to compute m_ls and m_crab_ls
+  unsigned m_ls_version;
+  unsigned m_crab_ls_version;
+  std::mutex m_crab_ls_mutex;
+  // statistics of m_ls
+  unsigned m_total_live;
+  unsigned m_max_live_per_blk;
+  unsigned m_avg_live_per_blk;
+  // hash of each block of the function when the cfg was built
+  std::vector<llvm::hash_code> m_block_hashes;
+  // version of the heap abstraction of the manager and hash of the
+  // callees of the function when the cfg was built (see
+  // CrabBuilderManager::rebuild)
+  unsigned m_mem_version;
+  llvm::hash_code m_callees_hash;
+  // loop order of the cfg and version of the cfg used to compute it
+  std::shared_ptr<loop_order_t> m_lo;
+  unsigned m_lo_version;
+  std::mutex m_lo_mutex;
+  // last frozen view of the cfg
+  std::shared_ptr<const FrozenCfg> m_frozen;
+  std::mutex m_frozen_mutex;
   
   CfgBuilder(const llvm::Function& func, CrabBuilderManager& man);
   
   void build_cfg();
 
+  // Add at the end of each block a havoc of the array variables that
+  // can be in the abstract state but are not live at the end of the
+  // block, except the parameters of the function, so that the
+  // analysis forgets them.
+  void forget_dead_arrays();
+
+  // true if m_ls is up-to-date with the cfg
+  bool has_live_symbols() const;
+
   // return live symbols for the whole cfg. Return nullptr if
-  // compute_live_symbols has not been called.
+  // compute_live_symbols has not been called since the last change
+  // of the cfg. Otherwise, the crab liveness analysis is run the
+  // first time.
   // Only IntraClam_Impl and InterClam_Impl should call this method.
-  const liveness_t* get_live_symbols() const;
+  const liveness_t* get_live_symbols();
   
 public:
 
@@ -78,13 +165,61 @@ public:
   // return crab control flow graph
   cfg_t& get_cfg();
 
+  // return the parameters used to build the cfg
+  const CrabBuilderParams& get_params() const { return m_params; }
+
+  // return the scope that names the variables local to the function
+  // or null if CrabBuilderParams::function_var_scopes is disabled.
+  // The names of the scope are valid while it has an owner: the
+  // invariants that outlive the builder must keep it (see
+  // block_map::set_owner).
+  llvm_variable_factory::scope_ptr get_var_scope() const { return m_var_scope; }
+
+  // Clients that modify the cfg returned by get_cfg must call this
+  // method so that cached results (e.g., live symbols) are
+  // recomputed. The cfg cannot be modified while a frozen view of
+  // it is alive.
+  void notify_cfg_changed();
+
+  // Return an immutable view of the cfg with its live symbols and
+  // its loop order from the entry already computed, so that any
+  // number of analyzers can read it from different threads without
+  // copying the cfg. The view is shared by all the calls until the
+  // cfg changes.
+  std::shared_ptr<const FrozenCfg> freeze();
+
+  // true if there is a frozen view of the cfg in use
+  bool is_frozen() const;
+  
   // compute live symbols per block by running standard liveness
-  // analysis
+  // analysis. The result is reused until the cfg changes.
   void compute_live_symbols();
   
   // return live symbols at the end of block bb. Return None if
-  // compute_live_symbols has not been called.
+  // compute_live_symbols has not been called since the last change of
+  // the cfg.
   llvm::Optional<varset> get_live_symbols(const llvm::BasicBlock *bb) const;
+
+  // return the max number of live symbols at the end of a block. It
+  // does not traverse the live symbols of each block. Return None if
+  // compute_live_symbols has not been called since the last change of
+  // the cfg.
+  llvm::Optional<unsigned> get_max_live_per_blk() const;
+
+  // return the preferred representation of the arrays of the regions
+  // whose objects have a known size. Empty unless
+  // CrabBuilderParams::array_expand_max_elems is not zero.
+  const array_repr_map_t &get_array_reprs() const;
+
+  // return the loop order of the cfg from entry. It is computed once
+  // and reused by all the analyses until the cfg changes.
+  const loop_order_t &get_loop_order(const basic_block_label_t &entry);
+
+  // return the total, max and average number of live symbols per
+  // block. Return false if compute_live_symbols has not been called
+  // since the last change of the cfg.
+  bool get_live_stats(unsigned &total_live, unsigned &max_live_per_blk,
+		      unsigned &avg_live_per_blk) const;
   
   // map a llvm basic block to a crab basic block label
   basic_block_label_t get_crab_basic_block(const llvm::BasicBlock *bb) const;
@@ -103,8 +238,68 @@ public:
   // corresponding llvm instruction. Return null if the the array
   // instruction is not mapped to a LLVM instruction.
   const llvm::Instruction* get_instruction(const statement_t& s) const;
+
+  // return the number of blocks of func that are not the same (by
+  // hash of their instructions) as when the cfg was built. Blocks are
+  // compared by position.
+  unsigned num_changed_blocks(const llvm::Function &func) const;
   
 }; // end class CfgBuilder
+
+/**
+ * Immutable view of the cfg of a CfgBuilder (see CfgBuilder::freeze).
+ * All the methods are const and compute nothing so the view can be
+ * shared by concurrent analyzers.
+ **/
+class FrozenCfg {
+public:
+  using liveness_t = CfgBuilder::liveness_t;
+  using loop_order_t = CfgBuilder::loop_order_t;
+
+private:
+  friend class CfgBuilder;
+
+  const CfgBuilder &m_builder;
+  cfg_ref_t m_cfg;
+  std::shared_ptr<const liveness_t> m_live;
+  std::shared_ptr<const loop_order_t> m_lo;
+  unsigned m_total_live;
+  unsigned m_max_live_per_blk;
+  unsigned m_avg_live_per_blk;
+
+  FrozenCfg(const CfgBuilder &builder, cfg_t &cfg,
+	    std::shared_ptr<const liveness_t> live,
+	    std::shared_ptr<const loop_order_t> lo);
+
+public:
+  FrozenCfg(const FrozenCfg &o) = delete;
+
+  FrozenCfg &operator=(const FrozenCfg &o) = delete;
+
+  // the crab analyzers take a cfg_ref_t but they do not modify it
+  cfg_ref_t get_cfg() const { return m_cfg; }
+
+  // live symbols for the whole cfg
+  const liveness_t *get_live_symbols() const { return &*m_live; }
+
+  // loop order of the cfg from its entry
+  const loop_order_t &get_loop_order() const { return *m_lo; }
+
+  unsigned get_max_live_per_blk() const { return m_max_live_per_blk; }
+
+  void get_live_stats(unsigned &total_live, unsigned &max_live_per_blk,
+		      unsigned &avg_live_per_blk) const;
+
+  basic_block_label_t get_crab_basic_block(const llvm::BasicBlock *bb) const {
+    return m_builder.get_crab_basic_block(bb);
+  }
+
+  const basic_block_label_t *
+  get_crab_basic_block(const llvm::BasicBlock *src,
+		       const llvm::BasicBlock *dst) const {
+    return m_builder.get_crab_basic_block(src, dst);
+  }
+}; // end class FrozenCfg
   
   
 /**
@@ -135,6 +330,37 @@ public:
   CrabBuilderManager& operator=(const CrabBuilderManager& o) = delete;
   
   CfgBuilderPtr mk_cfg_builder(const llvm::Function& func); 
+
+  // Build the CFGs of all funcs (if not built already) using up to
+  // num_threads threads. After this method is called, the variable
+  // factory and the heap abstraction are accessed under a lock so
+  // mk_cfg_builder can be also called concurrently.
+  void mk_cfg_builders(const std::vector<const llvm::Function*> &funcs,
+		       unsigned num_threads);
+
+  // Access the variable factory and the heap abstraction under a
+  // lock from now on so that mk_cfg_builder can be called
+  // concurrently. The layouts of the struct types of M, which are
+  // otherwise computed lazily, are computed here.
+  void set_concurrent(const llvm::Module &M);
+
+  // Replace the heap abstraction used by the CFGs built from now
+  // on. The CFGs already built are kept so they must not depend on
+  // the regions (e.g., the functions that do not use memory).
+  void set_heap_abstraction(std::unique_ptr<HeapAbstraction> mem);
+  
+  // Remove the builder of f (if any) so that the next call to
+  // mk_cfg_builder builds its CFG again. It must be called before f
+  // is modified or erased.
+  void invalidate(const llvm::Function &f);
+
+  // Build again the CFG of f after f has been modified in place. If
+  // no block of f changed since its CFG was built, and neither the
+  // heap abstraction nor the kinds of the callees of f changed, then
+  // the builder is kept. Otherwise, it is the same as invalidate
+  // followed by mk_cfg_builder. Set rebuilt to whether the CFG was
+  // built again.
+  CfgBuilderPtr rebuild(const llvm::Function &f, bool &rebuilt);
   
   bool has_cfg(const llvm::Function &f) const;
   
@@ -145,11 +371,33 @@ public:
   variable_factory_t& get_var_factory();
   
   const CrabBuilderParams& get_cfg_builder_params() const;
+
+  // The parameters to build the CFG of f: the precision level of f is
+  // chosen by PrecisionSelection if adaptive_precision is set. The
+  // levels of all the functions of the module are chosen on the
+  // first call.
+  CrabBuilderParams get_cfg_builder_params(const llvm::Function &f);
   
   const llvm::TargetLibraryInfo& get_tli() const ;
   
   HeapAbstraction& get_heap_abstraction();
 
+  // Literals of globals and constants shared by all the CFGs
+  crabLitCache& get_lit_cache();
+
+  // Kind of the callees shared by all the CFGs
+  crabCalleeTable& get_callee_table();
+
+  // Warnings of all the CFGs, aggregated by kind and function
+  CfgBuilderDiagnostics& get_diagnostics();
+
+  // Summaries used to translate the calls to the summarized
+  // functions (see --crab-import-summaries). It must be set before
+  // any CFG is built. The manager does not own the summaries.
+  void set_function_summaries(const FunctionSummaries *summaries);
+
+  const FunctionSummaries* get_function_summaries() const;
+
   const sea_dsa::ShadowMem* get_shadow_mem() const;  
   
   sea_dsa::ShadowMem* get_shadow_mem();
@@ -158,17 +406,45 @@ private:
   
   // User-definable parameters for building the Crab CFGs
   CrabBuilderParams m_params;
-  // Map LLVM function to Crab CfgBuilder
-  llvm::DenseMap<const llvm::Function*, CfgBuilderPtr> m_cfg_builder_map;
+  // Map LLVM function to Crab CfgBuilder. The map is split into
+  // shards, each one protected by its own lock, so that builders can
+  // be added concurrently.
+  struct CfgBuilderShard {
+    std::mutex m_mutex;
+    llvm::DenseMap<const llvm::Function*, CfgBuilderPtr> m_map;
+  };
+  enum { NUM_SHARDS = 16 };
+  mutable std::array<CfgBuilderShard, NUM_SHARDS> m_cfg_builder_map;
+  CfgBuilderShard& get_shard(const llvm::Function *f) const;
+  // hash of the direct callees of f and of their kinds
+  llvm::hash_code hash_callees(const llvm::Function &f);
+  // Whether mk_cfg_builder can be called concurrently
+  bool m_concurrent;
   // Used for the translation from bitcode to Crab CFG
   const llvm::TargetLibraryInfo &m_tli;
   // All CFGs supervised by this manager are created using the same
   // variable factory.
   variable_factory_t m_vfac;
+  // All CFGs share the same literals for globals and constants.
+  std::unique_ptr<crabLitCache> m_lit_cache;
+  // All CFGs share the kind of the callees.
+  std::unique_ptr<crabCalleeTable> m_callees;
+  // All CFGs report their warnings here.
+  std::unique_ptr<CfgBuilderDiagnostics> m_diags;
+  // Summaries of the callees (it can be null)
+  const FunctionSummaries *m_summaries;
   // Whole-program heap analysis
   std::unique_ptr<HeapAbstraction> m_mem;
+  // number of calls to set_heap_abstraction
+  unsigned m_mem_version;
+  // Heap abstractions replaced by set_heap_abstraction: the CFGs
+  // built before refer to them
+  std::vector<std::unique_ptr<HeapAbstraction>> m_old_mems;
   // Shadow memory (it can be null if not available)
   sea_dsa::ShadowMem *m_sm;
+  // Precision level of each function (only if adaptive_precision)
+  std::unique_ptr<PrecisionSelection> m_precisions;
+  std::mutex m_precisions_mutex;
 };
   
 } // end namespace clam
@@ -0,0 +1,70 @@
+#pragma once
+
+/* 
+ * Warnings of the CFG builder that can happen at many sites (e.g.,
+ * unresolved indirect calls). They are counted per kind and function
+ * instead of being printed one by one.
+ */
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+  class Function;
+  class Value;
+  class raw_ostream;
+}
+
+namespace clam {
+
+class CfgBuilderDiagnostics {
+public:
+  enum kind_t {
+    // call that cannot be resolved to a function
+    UNRESOLVED_INDIRECT_CALL,
+    // branch whose condition is a constant expression
+    CONSTANT_EXPR_BRANCH_COND,
+  };
+
+  struct Entry {
+    kind_t kind;
+    std::string function;
+    unsigned count;
+    // the first occurrences
+    std::vector<std::string> examples;
+  };
+  
+  // keep up to max_examples examples per kind and function
+  CfgBuilderDiagnostics(unsigned max_examples): m_max_examples(max_examples) {}
+
+  CfgBuilderDiagnostics(const CfgBuilderDiagnostics &o) = delete;
+  
+  CfgBuilderDiagnostics &operator=(const CfgBuilderDiagnostics &o) = delete;
+  
+  // Record an occurrence of kind in f. The example is only printed if
+  // it is kept.
+  void add(kind_t kind, const llvm::Function &f, const llvm::Value &example);
+
+  bool empty() const;
+  
+  // Return the entries sorted by kind and function name
+  std::vector<Entry> get_entries() const;
+
+  static const char *get_kind_name(kind_t kind);
+  
+  static const char *get_kind_message(kind_t kind);
+  
+  // Print one summary per kind
+  void write(llvm::raw_ostream &o) const;
+  
+private:
+  unsigned m_max_examples;
+  mutable std::mutex m_mutex;
+  llvm::DenseMap<std::pair<unsigned, const llvm::Function*>, Entry> m_entries;
+};
+
+} // end namespace clam
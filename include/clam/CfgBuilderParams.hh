@@ -4,18 +4,43 @@
 
 namespace clam {
 
+// Format of the report of the translation of each function
+enum CfgReportFormat { NO_CFG_REPORT, TEXT_CFG_REPORT, JSON_CFG_REPORT };
+
 /** User-definable parameters to build a Crab CFG **/
 struct CrabBuilderParams {
   // Level of abstraction of the CFG
   crab::cfg::tracked_precision precision_level;
+  // Choose the level of each function, up to precision_level, from
+  // the values its assertions depend on (see PrecisionSelection)
+  bool adaptive_precision;
   // Perform dead code elimination, cfg simplifications, etc
   bool simplify;
   // translate precisely calls
   bool interprocedural;
   // Lower singleton aliases (e.g., globals) to scalar ones
   bool lower_singleton_aliases;
+  // Lower the regions of a single cell of a local object (e.g., the
+  // fields of a local struct that does not escape) to scalar ones
+  bool promote_local_regions;
   // Translate memory operations in SSA form
   bool memory_ssa;
+  // Translate memory operations in SSA form using the regions of the
+  // heap abstraction. Unlike memory_ssa, it does not need the
+  // bitcode to be instrumented by ShadowMem.
+  bool region_memory_ssa;
+  // Forget the array variables at the end of the blocks where they
+  // become dead (only with ARR precision)
+  bool forget_dead_arrays;
+  // Replace the counter of the counting loops by its closed-form
+  // range on their back edges so that they converge without widening
+  bool accelerate_loops;
+  // Move the havocs of the variables that are only havoced and not
+  // read by a loop from its blocks to its preheader
+  bool hoist_loop_havocs;
+  // Add a check that the pointer is not null before each load and
+  // store (only with PTR or ARR precision)
+  bool null_checks;
   // Remove useless havoc operations 
   bool include_useless_havoc;
   // Translation tuned for array smashing to be both sound and more
@@ -24,20 +49,57 @@ struct CrabBuilderParams {
   // Translate bignums (> 64), otherwise operations with big numbers
   // are havoced.
   bool enable_bignums;
+  // Translate select instructions into Crab select statements,
+  // otherwise they are havoced.
+  bool native_select;
+  // Number of examples kept per kind of warning and function. The
+  // rest of occurrences are only counted.
+  unsigned warning_examples;
+  // Number of threads to translate the blocks of a large function
+  // (only with NUM precision)
+  unsigned block_threads;
+  // Build the CFGs one by one in the order they are requested (and
+  // the blocks of a function sequentially) so that the variables are
+  // numbered as in a sequential run
+  bool deterministic;
+  // Name the instructions and blocks of each function in a scope of
+  // the variable factory that is freed with its CfgBuilder
+  bool function_var_scopes;
+  // Tag the arrays of the regions whose objects have at most this
+  // number of elements to be expanded and the bigger ones to be
+  // smashed (0 if disabled, only with ARR precision)
+  unsigned array_expand_max_elems;
   //// --- printing options
   // print the cfg after it has been built
   bool print_cfg;
+  // print the sizes of the cfg and of the translation after it has
+  // been built
+  CfgReportFormat cfg_report;
   
   CrabBuilderParams():
     precision_level(crab::cfg::NUM)
+    , adaptive_precision(false)
     , simplify(false)
     , interprocedural(true)
     , lower_singleton_aliases(false)
+    , promote_local_regions(false)
     , memory_ssa(false)
+    , region_memory_ssa(false)
+    , forget_dead_arrays(false)
+    , accelerate_loops(false)
+    , hoist_loop_havocs(false)
+    , null_checks(false)
     , include_useless_havoc(true)
     , use_array_smashing(true)
     , enable_bignums(false)
-    , print_cfg(false) {}
+    , native_select(true)
+    , warning_examples(3)
+    , block_threads(1)
+    , deterministic(false)
+    , function_var_scopes(false)
+    , array_expand_max_elems(0)
+    , print_cfg(false)
+    , cfg_report(NO_CFG_REPORT) {}
   
   CrabBuilderParams(crab::cfg::tracked_precision _precision_level,
 		    bool _simplify, bool _interprocedural, bool _lower_singleton_aliases,
@@ -46,14 +108,28 @@ struct CrabBuilderParams {
 		    bool _enable_bignums,
 		    bool _print_cfg):
     precision_level(_precision_level)
+    , adaptive_precision(false)
     , simplify(_simplify)
     , interprocedural(_interprocedural)
     , lower_singleton_aliases(_lower_singleton_aliases)
+    , promote_local_regions(false)
     , memory_ssa(_memory_ssa)
+    , region_memory_ssa(false)
+    , forget_dead_arrays(false)
+    , accelerate_loops(false)
+    , hoist_loop_havocs(false)
+    , null_checks(false)
     , include_useless_havoc(_include_useless_havoc)
     , use_array_smashing(_use_array_smashing) 
     , enable_bignums(_enable_bignums)
-    , print_cfg(_print_cfg) {}
+    , native_select(true)
+    , warning_examples(3)
+    , block_threads(1)
+    , deterministic(false)
+    , function_var_scopes(false)
+    , array_expand_max_elems(0)
+    , print_cfg(_print_cfg)
+    , cfg_report(NO_CFG_REPORT) {}
   
   bool track_pointers() const {
     return precision_level == crab::cfg::PTR;
@@ -0,0 +1,85 @@
+#pragma once
+
+/*
+ * Binary index of the checks computed by Clam by source location.
+ *
+ * As the invariant database (see clam/InvariantDatabase.hh), the
+ * index is meant to be memory-mapped by other tools and read in
+ * place. It only depends on LLVM.
+ *
+ * Format (all integers are little-endian, offsets are in bytes from
+ * the start of the file and all records are 8-byte aligned):
+ *
+ *   header := "CLAMCHKI" <u32 version>
+ *             <u32 #files> <u32 files> <u32 #checks> <u32 checks> <u32 0>
+ *   file   := <u32 offset of a NUL-terminated name>
+ *             <u32 first check> <u32 #checks> <u32 0>
+ *   check  := <u32 line> <u32 column> <u32 #safe> <u32 #error>
+ *             <u32 #warning> <u32 0>
+ *
+ * The files are sorted by name and the checks of a file by line and
+ * column, so a file and a range of lines are found by binary search.
+ *
+ * All the assertions at the same location (e.g., in several calling
+ * contexts of an inlined function) are one check. Its counters are
+ * the number of those assertions with each status.
+ */
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace clam {
+
+class CheckIndex {
+public:
+  static const uint32_t VERSION = 1;
+  static const uint32_t NONE = 0xffffffff;
+
+  struct check_t {
+    uint32_t line;
+    uint32_t column;
+    uint32_t safe;
+    uint32_t error;
+    uint32_t warning;
+  };
+
+  // Return null and set err if filename is not a valid index
+  static std::unique_ptr<CheckIndex> open(llvm::StringRef filename,
+                                          std::string &err);
+
+  uint32_t num_files() const { return m_num_files; }
+  uint32_t num_checks() const { return m_num_checks; }
+
+  llvm::StringRef get_file_name(uint32_t f) const;
+
+  // Return the index of the file or NONE
+  uint32_t lookup(llvm::StringRef file) const;
+
+  // Checks of file f with a line in [first_line, last_line], in order
+  std::vector<check_t> query(uint32_t f, uint32_t first_line,
+                             uint32_t last_line) const;
+
+private:
+  std::unique_ptr<llvm::MemoryBuffer> m_buf;
+  const char *m_data;
+  uint32_t m_num_files, m_files;
+  uint32_t m_num_checks, m_checks;
+
+  CheckIndex(std::unique_ptr<llvm::MemoryBuffer> buf);
+  uint32_t u32(uint32_t offset) const;
+  check_t get_check(uint32_t c) const;
+};
+
+// Merge the indexes in inputs (e.g., of the shards of a module, see
+// --crab-shard) into output. The counters of the checks at the same
+// location are added. Return false and set err if an input is not a
+// valid index or output cannot be written.
+bool mergeCheckIndexes(const std::vector<std::string> &inputs,
+                       const std::string &output, std::string &err);
+
+} // end namespace clam
@@ -4,13 +4,21 @@
  * Infer invariants using Crab.
  */
 
+#include "clam/BlockMap.hh"
 #include "clam/ClamAnalysisParams.hh"
+#include "clam/CfgBuilderParams.hh"
+#include "clam/EdgesSet.hh"
 #include "clam/crab/crab_cfg.hh"
 #include "crab/checkers/base_property.hpp"
 #include "llvm/Pass.h"
 #include "llvm/ADT/DenseMap.h"
 
+#include <functional>
+#include <future>
 #include <memory>
+#include <set>
+#include <string>
+#include <vector>
 
 // forward declarations
 
@@ -19,11 +27,99 @@ namespace clam {
   class IntraClam_Impl;
   class InterClam_Impl;
   class CrabBuilderManager;
+  class LazyInvariants;
+  class ShadowFreeInvariantCache;
+  class InstructionInvariantCache;
+  class FunctionAnalysisConfig;
+  class FunctionSummaries;
+  class InvariantStore;
+  class CheckIndexWriter;
 }
 
 namespace clam {
 
-  using edges_set = std::set<std::pair<const llvm::BasicBlock*, const llvm::BasicBlock*>>;
+  /**
+   * Statistics about the analysis of a function
+   **/
+  struct ClamLoopStats {
+    // name of the loop header
+    std::string header;
+    unsigned depth;
+    // number of values modified by each iteration
+    unsigned num_modified;
+    // whether the loop exits by comparing with a constant
+    bool constant_bound;
+    // widening delay chosen for the loop
+    unsigned widening_delay;
+  };
+  
+  // Cost of one visit of a block by the fixpoint iterator (see
+  // --crab-profile-fixpoint)
+  struct ClamBlockStats {
+    std::string name;
+    // headers of the enclosing loops, the outermost first
+    std::vector<std::string> loops;
+    unsigned num_stmts;
+    // number of joins with the post-states of the predecessors
+    unsigned num_joins;
+    unsigned num_widenings;
+    // seconds
+    double transfer_time;
+    double join_time;
+    double widening_time;
+    // one visit times the estimated number of visits
+    double estimated_time;
+
+    ClamBlockStats()
+      : num_stmts(0), num_joins(0), num_widenings(0), transfer_time(0),
+	join_time(0), widening_time(0), estimated_time(0) {}
+  };
+  
+  struct ClamFunctionStats {
+    std::string name;
+    // size of the Crab CFG
+    unsigned num_blocks;
+    unsigned num_stmts;
+    // only if liveness was computed
+    bool has_live;
+    unsigned total_live;
+    unsigned max_live_per_blk;
+    unsigned avg_live_per_blk;
+    // domain used after downgrading (if any)
+    std::string domain;
+    // domains abandoned, in order, because the analysis exceeded its
+    // budget (--crab-fun-timeout, --crab-fun-mem-limit or
+    // --crab-fun-rss-limit)
+    std::vector<std::string> downgrades;
+    // fixpoint and checker time in seconds (only intra-procedural)
+    double analysis_time;
+    unsigned safe_checks;
+    unsigned error_checks;
+    unsigned warning_checks;
+    // widening delay used by the fixpoint iterator
+    unsigned widening_delay;
+    // only if --crab-widening-delay-auto
+    std::vector<ClamLoopStats> loops;
+    // only if --crab-profile-fixpoint
+    std::vector<ClamBlockStats> blocks;
+    // the analysis was stopped by AnalysisParams::cancel_token: the
+    // function has no invariants and no checks
+    bool cancelled;
+
+    ClamFunctionStats()
+      : num_blocks(0), num_stmts(0), has_live(false), total_live(0),
+	max_live_per_blk(0), avg_live_per_blk(0), analysis_time(0),
+	safe_checks(0), error_checks(0), warning_checks(0), widening_delay(0),
+	cancelled(false) {}
+  };
+  
+  /**
+   * Parameters given by the clam command line options (--crab-*)
+   **/
+  CrabBuilderParams getCrabBuilderParamsFromOptions();
+  AnalysisParams getAnalysisParamsFromOptions();
+  // Domain named as in --crab-dom. Return false if unknown.
+  bool parseDomainName(llvm::StringRef name, CrabDomain &dom);
   
   /**
    * Intra-procedural analysis of a function
@@ -49,12 +145,30 @@ namespace clam {
   public:
     
     using wrapper_dom_ptr = std::shared_ptr<GenericAbsDomWrapper>;;
-    using abs_dom_map_t = llvm::DenseMap<const llvm::BasicBlock*, wrapper_dom_ptr>;
+    // invariants of the blocks in per-function tables
+    using abs_dom_map_t = block_map<wrapper_dom_ptr>;
     using lin_csts_map_t = llvm::DenseMap<const llvm::BasicBlock*, lin_cst_sys_t>;    
     using checks_db_t = crab::checker::checks_db;
+    // invariants computed on demand (see AnalysisParams::lazy_invariants)
+    using lazy_inv_map_t = llvm::DenseMap<const llvm::Function*,
+					  std::shared_ptr<LazyInvariants>>;
+    // called with each block of a function and its invariant (null if
+    // not stored)
+    using block_inv_callback_t =
+      std::function<void(const llvm::BasicBlock&, wrapper_dom_ptr)>;
     // for backward compatibility with SeaHorn
     using invariant_map_t = abs_dom_map_t;
     using assumption_map_t = lin_csts_map_t;
+
+    // result of an asynchronous path query (see path_analyze_async)
+    struct path_result_t {
+      // false iff the path implies false
+      bool feasible;
+      // if !feasible, a minimal subset of statements that implies false
+      std::vector<crab::cfg::statement_wrapper> core;
+      // post-conditions at each block
+      abs_dom_map_t post;
+    };
     
   private:
 
@@ -63,8 +177,13 @@ namespace clam {
     const llvm::Function &m_fun;
     abs_dom_map_t m_pre_map;
     abs_dom_map_t m_post_map;
+    lazy_inv_map_t m_lazy_invs;
     edges_set m_infeasible_edges;    
     checks_db_t m_checks_db;
+    // invariants of m_pre_map and m_post_map without shadow variables
+    std::unique_ptr<ShadowFreeInvariantCache> m_shadow_free_invs;
+    // invariants before the instructions of the last queried blocks
+    std::unique_ptr<InstructionInvariantCache> m_inst_invs;
     
   public:
 
@@ -80,6 +199,20 @@ namespace clam {
      **/
     void clear();
 
+    /**
+     * Call before(F) just before the CFG of each analyzed function F
+     * is built and after(F) once its results (printed invariants,
+     * checks, spilled invariants) are reported. The invariants of F
+     * are not kept so after can release the body of F (see clam
+     * --lazy-functions). Only with the sequential intra-procedural
+     * analysis of a numerical CFG.
+     **/
+    void set_function_hooks(std::function<void(llvm::Function&)> before,
+			    std::function<void(llvm::Function&)> after) {
+      m_before_fun = before;
+      m_after_fun = after;
+    }
+
     /* return the manager used to build all CFGs */
     CrabBuilderManager& get_cfg_builder_man();    
 
@@ -112,6 +245,9 @@ namespace clam {
      * post contains the post-conditions at each block.
      * If it returns false then:
      *   - core is a minimal subset of statements that implies false
+     *
+     * If params.path_portfolio is enabled then params.dom is ignored
+     * and core is taken from the first domain that proves false.
      **/
     template<typename Statement>
     bool path_analyze(const AnalysisParams& params,
@@ -127,6 +263,21 @@ namespace clam {
 		      bool layered_solving,
 		      std::vector<Statement>& core) const;
 
+    /**
+     * As path_analyze but the path is solved by a pool of
+     * params.path_threads threads owned by this object so that many
+     * paths can be submitted at once and their results consumed as
+     * they complete. The queries share the prefix caches of
+     * params.path_prefix_cache: the queries with the same domain are
+     * solved one at a time. The destructor waits for the queries not
+     * completed.
+     **/
+    std::future<path_result_t>
+    path_analyze_async(const AnalysisParams& params,
+		       const std::vector<const llvm::BasicBlock*>& path,
+		       /* use gradually more expensive domains until unsat is proven*/
+		       bool layered_solving) const;
+
     /**
      * Return invariants that hold at the entry of b
      **/
@@ -137,6 +288,28 @@ namespace clam {
      **/
     wrapper_dom_ptr get_post(const llvm::BasicBlock *b, bool keep_shadows=false) const;
 
+    /**
+     * Return invariants that hold just before I, computed by
+     * replaying the crab block of I from the invariants at its
+     * entry. The states of the last replayed blocks are cached so
+     * the queries on the instructions of the same block replay it
+     * once. Return null if the entry of the block has no invariant.
+     **/
+    wrapper_dom_ptr get_at(const llvm::Instruction *I, bool keep_shadows=false) const;
+
+    /**
+     * Call f with each block, in layout order, and the invariants that
+     * hold at its entry. Cheaper than get_pre on each block: the
+     * shadow variables are collected once.
+     **/
+    void get_pre_all(const block_inv_callback_t &f, bool keep_shadows=false) const;
+
+    /**
+     * Call f with each block, in layout order, and the invariants that
+     * hold at its exit.
+     **/
+    void get_post_all(const block_inv_callback_t &f, bool keep_shadows=false) const;
+
     /**
      * Return true if there might be a feasible edge between b1 and b2
      **/
@@ -175,9 +348,11 @@ namespace clam {
   public:
 
     /**
-     * Constructor that builds a crab call graph.
+     * Constructor that builds a crab call graph. The independent
+     * parts of the call graph are analyzed with num_threads threads.
      **/
-    InterClam(const llvm::Module &module, CrabBuilderManager &man);
+    InterClam(const llvm::Module &module, CrabBuilderManager &man,
+	      unsigned num_threads = 1);
 
     ~InterClam();    
 
@@ -198,6 +373,15 @@ namespace clam {
      * Call crab analysis on the call graph under assumptions.
      **/    
     void analyze(AnalysisParams &params, const lin_csts_map_t &assumptions);
+
+    /**
+     * Call crab analysis again after the functions in changed have
+     * been modified or replaced in the module. Only the parts of the
+     * call graph connected to the changed functions are analyzed
+     * again.
+     **/
+    void reanalyze(AnalysisParams &params,
+		   const std::vector<const llvm::Function*> &changed);
     
     /**
      * Return invariants that hold at the entry of b
@@ -228,13 +412,61 @@ namespace clam {
     using wrapper_dom_ptr = typename IntraClam::wrapper_dom_ptr;
     using abs_dom_map_t = typename IntraClam::abs_dom_map_t;
     using checks_db_t = typename IntraClam::checks_db_t;
+    using lazy_inv_map_t = typename IntraClam::lazy_inv_map_t;
+    using block_inv_callback_t = typename IntraClam::block_inv_callback_t;
 
     abs_dom_map_t m_pre_map;
     abs_dom_map_t m_post_map;
+    lazy_inv_map_t m_lazy_invs;
+    // invariants of m_pre_map and m_post_map without shadow variables
+    std::unique_ptr<ShadowFreeInvariantCache> m_shadow_free_invs;
     edges_set m_infeasible_edges;
     std::unique_ptr<CrabBuilderManager> m_cfg_builder_man;
     checks_db_t m_checks_db; 
     AnalysisParams m_params;
+    // parameters of individual functions (--crab-dom-config and
+    // annotations)
+    std::unique_ptr<FunctionAnalysisConfig> m_fun_config;
+    // summaries of the callees (--crab-import-summaries)
+    std::unique_ptr<FunctionSummaries> m_summaries;
+    std::vector<ClamFunctionStats> m_fun_stats;
+    // functions not analyzed because they are unreachable from the roots
+    std::vector<std::string> m_skipped_funcs;
+    // analyzed functions whose CFG was released (--crab-release-cfgs)
+    std::set<const llvm::Function*> m_released_funcs;
+    // invariants moved out of m_pre_map and m_post_map
+    // (--crab-spill-invariants)
+    std::unique_ptr<InvariantStore> m_inv_store;
+    // status of the checks by source location (--crab-check-index)
+    std::unique_ptr<CheckIndexWriter> m_check_index;
+    // see set_function_hooks
+    std::function<void(llvm::Function&)> m_before_fun;
+    std::function<void(llvm::Function&)> m_after_fun;
+    // forget the invariants and infeasible edges of F
+    void dropResults(const llvm::Function &F);
+    // whether F was analyzed (even if its CFG was released)
+    bool hasResults(const llvm::Function &F) const;
+    // common implementation of get_pre_all and get_post_all
+    void get_all(const llvm::Function &F, bool is_pre,
+		 const block_inv_callback_t &f, bool KeepShadows) const;
+
+    // results of each domain of --crab-dom=dom1,dom2,...
+    struct DomainSweepResult {
+      CrabDomain dom;
+      double time;
+      unsigned safe;
+      unsigned error;
+      unsigned warning;
+    };
+    void printDomainSweep(const std::vector<DomainSweepResult> &sweep,
+			  llvm::raw_ostream &o) const;
+    void writeStatsJson(const std::string &filename, double total_time) const;
+    void printFixpointProfile(llvm::raw_ostream &o) const;
+    void writeFixpointProfileFolded(const std::string &filename) const;
+    void writeInvariantDatabase(const llvm::Module &M, const std::string &filename) const;
+    void writeSummaries(const llvm::Module &M, const std::string &filename) const;
+    void writeCfgs(const std::vector<const llvm::Function*> &funcs,
+		   const std::string &filename) const;
     
    public:
 
@@ -264,7 +496,8 @@ namespace clam {
       return m_params;
     }
 
-    /* return true if there is Crab CFG for F */
+    /* return true if there is Crab CFG for F (false if it was
+       released by --crab-release-cfgs) */
     bool has_cfg(llvm::Function &F);
 
     /* return the Crab CFG associated to F */
@@ -280,6 +513,21 @@ namespace clam {
      **/
     wrapper_dom_ptr get_post(const llvm::BasicBlock *BB, bool KeepShadows=false) const;
 
+    /**
+     * call f with each block of F, in layout order, and the invariants
+     * that hold at its entry. Cheaper than get_pre on each block: the
+     * shadow variables are collected once.
+     **/
+    void get_pre_all(const llvm::Function &F, const block_inv_callback_t &f,
+		     bool KeepShadows=false) const;
+
+    /**
+     * call f with each block of F, in layout order, and the invariants
+     * that hold at its exit
+     **/
+    void get_post_all(const llvm::Function &F, const block_inv_callback_t &f,
+		      bool KeepShadows=false) const;
+
     /**
      * Return true if there might be a feasible edge between b1 and b2
      **/
@@ -303,6 +551,11 @@ namespace clam {
     unsigned get_total_warning_checks() const;
     
     void print_checks(llvm::raw_ostream &o) const;
+
+    /* return statistics of each analyzed function (module order) */
+    const std::vector<ClamFunctionStats>& get_function_stats() const {
+      return m_fun_stats;
+    }
   };
 
 } // end namespace 
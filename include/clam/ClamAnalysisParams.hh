@@ -2,8 +2,12 @@
 
 #include "clam/config.h"
 
+#include <atomic>
 #include <climits>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace clam {
 
@@ -26,8 +30,41 @@ enum CrabDomain
       , OCT
       , PK
       , WRAPPED_INTERVALS
+      //OCT but the variables of the packs that overflow pack_size
+      //only keep their bounds
+      , PACKED_OCT
+      // INTERVALS with flat bound arrays (for comparison)
+      , DENSE_INTERVALS
   };
+
+// The instances of an exclusive domain share a state that is not
+// thread-safe: the LDD manager of boxes and the Elina/Apron managers
+// of octagons and polyhedra. Only one analysis, checker or transformer
+// of an exclusive domain runs at a time, even with several threads.
+inline bool isExclusiveDomain(CrabDomain dom) {
+  return (dom == BOXES || dom == OCT || dom == PACKED_OCT || dom == PK);
+}
   
+////
+// Modifiers of the domain (bitwise or in AnalysisParams::dom_modifiers)
+////
+enum CrabDomainModifier
+  { NO_DOM_MODIFIERS = 0,
+    // count and time the operations of the domain (only if Clam is
+    // built with CLAM_INSTRUMENT_DOMAINS)
+    DOM_INSTRUMENTED = 1
+  };
+
+////
+// Fixpoint engine of the intra-procedural analysis
+////
+enum CrabFixpointEngine
+  { // recursive iteration of crab over the weak topological order
+    WTO_FIXPOINT = 0,
+    // priority worklist in reverse postorder (see WorklistFixpoint.hh)
+    WORKLIST_FIXPOINT = 1
+  };
+
 ////
 // Kind of checker
 ////
@@ -37,55 +74,224 @@ enum assert_check_kind_t
     NULLITY = 2
   };
   
+/**
+ * Flag shared between the client and the analysis to stop it: once
+ * cancel() is called (from any thread) the analysis stops at the next
+ * check (see AnalysisParams::cancel_token).
+ **/
+class CancellationToken {
+  std::atomic<bool> m_cancelled;
+public:
+  CancellationToken(): m_cancelled(false) {}
+  void cancel() { m_cancelled.store(true); }
+  void reset() { m_cancelled.store(false); }
+  bool is_cancelled() const { return m_cancelled.load(); }
+};
   
 /**
 * Class to set analysis options
  **/
 struct AnalysisParams {
   CrabDomain dom;
+  // intra-procedural analysis: CrabDomainModifier flags applied to dom
+  unsigned dom_modifiers;
 #ifndef TOP_DOWN_INTER_ANALYSIS  
   CrabDomain sum_dom; 
 #endif   
   bool run_backward;
+  // run the backward analysis only on the functions with checks not
+  // proven by the forward analysis
+  bool backward_unproven_only;
   bool run_liveness;
   bool run_inter;
 #ifdef TOP_DOWN_INTER_ANALYSIS    
   unsigned int max_calling_contexts;
+  // reuse the summary of a calling context that includes the new one
+  // instead of analyzing again the callee
+  bool reuse_subsumed_contexts;
+  // analyze a library: every externally visible function is a root
+  // analyzed from a top calling context and the invariants of a
+  // function are joined across the roots that reach it
+  bool inter_multi_root;
+  // check each assertion once, from the join of its invariants in all
+  // the calling contexts, instead of once per context. Ignored if the
+  // call graph has Boolean assertions.
+  bool inter_merge_checks;
 #endif   
   unsigned relational_threshold;
+  // inter-procedural analysis: if true then the functions that
+  // exceed relational_threshold are analyzed separately with a
+  // cheaper domain instead of downgrading the whole program.
+  bool per_function_dom;
+  // max number of variables related by a relational domain (PACKED_OCT)
+  unsigned pack_size;
   unsigned widening_delay;
+  // choose the widening delay of each function from its loop nests
+  // instead of using widening_delay
+  bool auto_widening_delay;
   unsigned narrowing_iters;
   unsigned widening_jumpset;
+  // size the jump set from the constants of the loop guards. If
+  // widening_jumpset > 0 then it bounds the size.
+  bool auto_widening_jumpset;
+  // intra-procedural analysis: fixpoint engine. The worklist is not
+  // used with backward analysis or assumptions.
+  CrabFixpointEngine fixpoint;
+  // dis-intervals, terms with dis-intervals and boxes: the closest
+  // disjuncts of a state are merged after a join if it has more than
+  // max_disjuncts (0 if unlimited, see BoundedDisjunctsDomain.hh)
+  unsigned max_disjuncts;
+  // limits of the array adaptive domain: number of cells before an
+  // array is smashed and max size of an array to be expanded
+  unsigned array_max_smashable_cells;
+  unsigned array_max_size;
+  // scale the array limits of each function by its number of arrays
+  bool auto_array_limits;
+  // print the estimated cost of each function with each domain
+  bool estimate_cost;
+  // if > 0 then a function whose estimated cost exceeds it is
+  // analyzed with intervals
+  double max_estimated_cost;
+  // replay the transfer functions, joins and widenings of each block
+  // after the fixpoint to find the blocks that are expensive
+  bool profile_fixpoint;
+  // analyze first with intervals and only if some checks are not
+  // proven with dom, assuming the interval invariants
+  bool staged;
+  // start from the invariants of the last analysis of the function
+  // (in cache_dir) if they are still inductive
+  bool warm_start;
+  // reuse the checks of the last analysis of the function (in
+  // cache_dir) even if its IR changed since. Its invariants are not
+  // reused. Set for the functions without changed lines (see
+  // --crab-changed-lines).
+  bool reuse_latest;
   bool stats;
+  // the statistics of each function, with its live variables, are
+  // written by --crab-stats-json
+  bool stats_json;
   bool print_invars;
+  // print one line per block with its pre and post invariants
+  bool print_invars_compact;
   bool print_preconds;
   bool print_unjustified_assumptions;
   bool print_summaries;
   bool store_invariants;
+  // intra-procedural analysis: if true then the analyzer is kept
+  // alive and the invariants of a block are only built when queried.
+  bool lazy_invariants;
+  // intra-procedural analysis: if true then only the invariants at
+  // the entry and at the loop heads are kept. The others are
+  // recomputed when queried and the last head_invariants_cache_size
+  // blocks are cached.
+  bool head_invariants;
+  unsigned head_invariants_cache_size;
+  // intra-procedural analysis: if true then the invariants are only
+  // kept at the entry, the loop heads and the merge points. The others
+  // are stored as deltas of linear constraints and decoded when
+  // queried (see DeltaInvariants in ClamImpl.hh).
+  bool delta_invariants;
+  // share one wrapper between the equal stored invariants of a
+  // function
+  bool intern_invariants;
   bool keep_shadow_vars;
   assert_check_kind_t check;
   unsigned check_verbose;
+  // skip the narrowing iterations if all the checks of a function are
+  // already proven after the ascending phase
+  bool check_early_stop;
+  // do not store the invariants of a function whose checks were all
+  // proven by the cheaper analysis of check_early_stop or
+  // backward_unproven_only
+  bool check_early_stop_skip_invariants;
+  // number of threads to check the assertions of a function once its
+  // invariants are computed
+  unsigned check_threads;
+  // the results with several threads (check_threads and the
+  // parallel analysis of the functions) are the same as with one
+  bool deterministic;
+  // directory of the on-disk cache of intra-procedural results
+  // (empty if disabled)
+  std::string cache_dir;
+  // intra-procedural analysis: budget per function in seconds and
+  // MB (0 if unlimited). If exceeded, the function is analyzed again
+  // with a cheaper domain.
+  unsigned fun_timeout;
+  unsigned fun_mem_limit;
+  // intra-procedural analysis: limit (MB) of the resident memory
+  // added while a function is analyzed (0 if unlimited). Unlike
+  // fun_mem_limit it does not count the reserved address space.
+  unsigned fun_rss_limit;
+  // intra-procedural analysis: domains tried in order when a function
+  // exceeds its budget (e.g., oct, zones, int)
+  std::vector<CrabDomain> downgrade_chain;
+  // inter-procedural analysis: time in seconds after which no new
+  // call graph component is analyzed (0 if unlimited). The functions
+  // of the components left out have no invariants and no checks.
+  unsigned inter_deadline;
+  // path analysis: if true then several domains (intervals, zones
+  // and terms with zones) are run concurrently on the path and the
+  // first one that proves infeasibility wins.
+  bool path_portfolio;
+  // path analysis: maximum number of abstract states cached per
+  // domain across path queries of the same function (0 if
+  // disabled). A path query resumes from its longest prefix already
+  // solved by a previous query.
+  unsigned path_prefix_cache;
+  // path analysis: number of threads that solve the asynchronous
+  // path queries of a function (0 if one per hardware thread). Read
+  // by the first asynchronous query.
+  unsigned path_threads;
+  // if not null, the analysis stops as soon as the token is cancelled:
+  // between functions, between inter-procedural components and, with
+  // the worklist fixpoint, between the evaluations of two blocks. The
+  // functions not analyzed have no invariants and no checks.
+  std::shared_ptr<CancellationToken> cancel_token;
+  // if set, called at the same points where cancel_token is checked
+  // (e.g., to let an IDE process events while the analysis runs)
+  std::function<void()> yield;
   
   AnalysisParams()
-    : dom(INTERVALS),
+    : dom(INTERVALS), dom_modifiers(NO_DOM_MODIFIERS),
 #ifndef TOP_DOWN_INTER_ANALYSIS        
       sum_dom(ZONES_SPLIT_DBM),
 #endif       
-      run_backward(false), run_liveness(false),
+      run_backward(false), backward_unproven_only(false), run_liveness(false),
       run_inter(false),
 #ifdef TOP_DOWN_INTER_ANALYSIS        
-      max_calling_contexts(UINT_MAX),
+      max_calling_contexts(UINT_MAX), reuse_subsumed_contexts(false),
+      inter_multi_root(false), inter_merge_checks(false),
 #endif       
-      relational_threshold(10000),
-      widening_delay(1), narrowing_iters(10), widening_jumpset(0),
-      stats(false),
-      print_invars(false), print_preconds(false),
+      relational_threshold(10000), per_function_dom(false), pack_size(64),
+      widening_delay(1), auto_widening_delay(false), narrowing_iters(10), widening_jumpset(0),
+      auto_widening_jumpset(false), fixpoint(WTO_FIXPOINT),
+      max_disjuncts(0), array_max_smashable_cells(64),
+      array_max_size(512), auto_array_limits(false), estimate_cost(false),
+      max_estimated_cost(0), profile_fixpoint(false), staged(false),
+      warm_start(false), reuse_latest(false), stats(false), stats_json(false),
+      print_invars(false), print_invars_compact(false), print_preconds(false),
       print_unjustified_assumptions(false), print_summaries(false),
-      store_invariants(true), keep_shadow_vars(false),
-      check(NOCHECKS), check_verbose(0) { }
+      store_invariants(true), lazy_invariants(false),
+      head_invariants(false), head_invariants_cache_size(256),
+      delta_invariants(false),
+      intern_invariants(false), keep_shadow_vars(false),
+      check(NOCHECKS), check_verbose(0),
+      check_early_stop(false), check_early_stop_skip_invariants(false),
+      check_threads(1), deterministic(false), cache_dir(""),
+      fun_timeout(0), fun_mem_limit(0), fun_rss_limit(0),
+      downgrade_chain(1, INTERVALS), inter_deadline(0), path_portfolio(false),
+      path_prefix_cache(0), path_threads(0) { }
   
   std::string abs_dom_to_str() const;
 
+  // Call yield (if any) and return true if the analysis is cancelled
+  bool should_stop() const {
+    if (yield) {
+      yield();
+    }
+    return cancel_token && cancel_token->is_cancelled();
+  }
+
 #ifndef TOP_DOWN_INTER_ANALYSIS  
   std::string sum_abs_dom_to_str() const;
 #endif
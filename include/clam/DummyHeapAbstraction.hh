@@ -10,6 +10,8 @@ namespace clam {
 struct DummyHeapAbstraction: public HeapAbstraction {
 
   using typename HeapAbstraction::RegionVec;
+  using typename HeapAbstraction::RegionRef;
+  using typename HeapAbstraction::RegionSet;
   using typename HeapAbstraction::RegionId;  
   
   DummyHeapAbstraction(): HeapAbstraction() { }
@@ -26,6 +28,11 @@ struct DummyHeapAbstraction: public HeapAbstraction {
 		   const llvm::Instruction*, const llvm::Value*) {
     return Region();
   }
+
+  const RegionMap &getRegionMap(const llvm::Function&) {
+    static const RegionMap empty;
+    return empty;
+  }
   
   RegionVec getAccessedRegions(const llvm::Function&) {
     return RegionVec();
@@ -58,10 +65,77 @@ struct DummyHeapAbstraction: public HeapAbstraction {
   RegionVec getNewRegions(const llvm::CallInst&) {
     return RegionVec();
   }
+
+  RegionRef getAccessedRegionsRef(const llvm::Function&) {
+    return RegionRef();
+  }
+  
+  RegionRef getOnlyReadRegionsRef(const llvm::Function&) {
+    return RegionRef();
+  }
+  
+  RegionRef getModifiedRegionsRef(const llvm::Function&) {
+    return RegionRef();
+  }
+  
+  RegionRef getNewRegionsRef(const llvm::Function&) {
+    return RegionRef();
+  }
+  
+  RegionRef getAccessedRegionsRef(const llvm::CallInst&) {
+    return RegionRef();
+  }
+  
+  RegionRef getOnlyReadRegionsRef(const llvm::CallInst&) {
+    return RegionRef();
+  }
+  
+  RegionRef getModifiedRegionsRef(const llvm::CallInst&) {
+    return RegionRef();
+  }
+  
+  RegionRef getNewRegionsRef(const llvm::CallInst&) {
+    return RegionRef();
+  }
+  
+  const RegionSet &getAccessedRegionSet(const llvm::Function&) {
+    return m_empty;
+  }
+  
+  const RegionSet &getOnlyReadRegionSet(const llvm::Function&) {
+    return m_empty;
+  }
+  
+  const RegionSet &getModifiedRegionSet(const llvm::Function&) {
+    return m_empty;
+  }
+  
+  const RegionSet &getNewRegionSet(const llvm::Function&) {
+    return m_empty;
+  }
+  
+  const RegionSet &getAccessedRegionSet(const llvm::CallInst&) {
+    return m_empty;
+  }
+  
+  const RegionSet &getOnlyReadRegionSet(const llvm::CallInst&) {
+    return m_empty;
+  }
+  
+  const RegionSet &getModifiedRegionSet(const llvm::CallInst&) {
+    return m_empty;
+  }
+  
+  const RegionSet &getNewRegionSet(const llvm::CallInst&) {
+    return m_empty;
+  }
   
   llvm::StringRef getName() const {
     return "DummyHeapAbstraction";
   }
+
+private:
+  RegionSet m_empty;
 }; 
 
 } // end namespace
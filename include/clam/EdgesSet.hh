@@ -0,0 +1,56 @@
+#pragma once
+
+/* Set of CFG edges (e.g., the edges proven infeasible by Crab) */
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallBitVector.h"
+
+#include <functional>
+#include <set>
+#include <utility>
+
+namespace llvm {
+class BasicBlock;
+} // namespace llvm
+
+namespace clam {
+
+/**
+ * An edge (src, dst) is a bit in a bitmap of the successors of src
+ * indexed by the position of dst in the terminator of src. Lookups
+ * are constant time (in the number of edges) and each block with an
+ * edge only needs a few bits per successor. Pairs of blocks that are
+ * not edges of the CFG are kept apart.
+ **/
+class edges_set {
+public:
+  using edge_t = std::pair<const llvm::BasicBlock *, const llvm::BasicBlock *>;
+
+  void insert(const edge_t &e);
+
+  void insert(const edges_set &o);
+
+  template <typename It> void insert(It begin, It end) {
+    for (; begin != end; ++begin) {
+      insert(*begin);
+    }
+  }
+
+  bool contains(const llvm::BasicBlock *src,
+                const llvm::BasicBlock *dst) const;
+
+  // Remove the edges whose source satisfies pred
+  void erase_if_source(std::function<bool(const llvm::BasicBlock *)> pred);
+
+  void clear();
+
+  bool empty() const { return m_succs.empty() && m_others.empty(); }
+
+private:
+  // bit i is set if the edge to the i-th successor of the block is
+  // in the set
+  llvm::DenseMap<const llvm::BasicBlock *, llvm::SmallBitVector> m_succs;
+  std::set<edge_t> m_others;
+};
+
+} // end namespace clam
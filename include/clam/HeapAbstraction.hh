@@ -7,8 +7,14 @@
 #include "clam/config.h"
 #include "crab/common/debug.hpp"
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SparseBitVector.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/IR/Value.h"
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 // forward declarations
@@ -156,10 +162,9 @@ public:
   }
 };
 
-inline llvm::raw_ostream &operator<<(llvm::raw_ostream &o, std::vector<Region> s) {
+inline llvm::raw_ostream &operator<<(llvm::raw_ostream &o, llvm::ArrayRef<Region> s) {
   o << "{";
-  for (typename std::vector<Region>::iterator it = s.begin(), et = s.end();
-       it != et;) {
+  for (auto it = s.begin(), et = s.end(); it != et;) {
     o << *it;
     ++it;
     if (it != et)
@@ -176,11 +181,17 @@ class HeapAbstraction {
 
 public:
   typedef std::vector<Region> RegionVec;
+  // read-only view of a sequence of regions
+  typedef llvm::ArrayRef<Region> RegionRef;
+  // set of region ids
+  typedef llvm::SparseBitVector<> RegionSet;
   typedef typename Region::RegionId RegionId;
+  // region of each pointer of a function
+  typedef llvm::DenseMap<const llvm::Value *, Region> RegionMap;
 
   // Add a new value if a new HeapAbstraction subclass is created
   // This is used to use static_cast.
-  enum class ClassId { DUMMY, LLVM_DSA, SEA_DSA};
+  enum class ClassId { DUMMY, LLVM_DSA, SEA_DSA, SNAPSHOT};
   
   HeapAbstraction() {}
 
@@ -223,7 +234,141 @@ public:
   // regions that are reachable only from the return of the callee
   virtual RegionVec getNewRegions(const llvm::CallInst &) = 0;
 
+  // The methods below return the same regions as the ones above
+  // without copying them. A view is valid while the heap abstraction
+  // is alive. The default implementations cache the regions returned
+  // by the methods above so subclasses should override them if they
+  // already keep the regions.
+  
+  virtual RegionRef getAccessedRegionsRef(const llvm::Function &F) {
+    return cacheRegions(ACCESSED, &F, [&]() { return getAccessedRegions(F); });
+  }
+
+  virtual RegionRef getOnlyReadRegionsRef(const llvm::Function &F) {
+    return cacheRegions(ONLY_READ, &F, [&]() { return getOnlyReadRegions(F); });
+  }
+
+  virtual RegionRef getModifiedRegionsRef(const llvm::Function &F) {
+    return cacheRegions(MODIFIED, &F, [&]() { return getModifiedRegions(F); });
+  }
+
+  virtual RegionRef getNewRegionsRef(const llvm::Function &F) {
+    return cacheRegions(NEW, &F, [&]() { return getNewRegions(F); });
+  }
+
+  virtual RegionRef getAccessedRegionsRef(const llvm::CallInst &I) {
+    return cacheRegions(ACCESSED, &I, [&]() { return getAccessedRegions(I); });
+  }
+
+  virtual RegionRef getOnlyReadRegionsRef(const llvm::CallInst &I) {
+    return cacheRegions(ONLY_READ, &I, [&]() { return getOnlyReadRegions(I); });
+  }
+
+  virtual RegionRef getModifiedRegionsRef(const llvm::CallInst &I) {
+    return cacheRegions(MODIFIED, &I, [&]() { return getModifiedRegions(I); });
+  }
+
+  virtual RegionRef getNewRegionsRef(const llvm::CallInst &I) {
+    return cacheRegions(NEW, &I, [&]() { return getNewRegions(I); });
+  }
+
+  // The methods below return the ids of the same regions as the ones
+  // above so that membership, intersection and difference of regions
+  // are bitwise operations. The default implementations cache the
+  // sets built from the views.
+
+  virtual const RegionSet &getAccessedRegionSet(const llvm::Function &F) {
+    return cacheRegionSet(ACCESSED, &F, [&]() { return getAccessedRegionsRef(F); });
+  }
+
+  virtual const RegionSet &getOnlyReadRegionSet(const llvm::Function &F) {
+    return cacheRegionSet(ONLY_READ, &F, [&]() { return getOnlyReadRegionsRef(F); });
+  }
+
+  virtual const RegionSet &getModifiedRegionSet(const llvm::Function &F) {
+    return cacheRegionSet(MODIFIED, &F, [&]() { return getModifiedRegionsRef(F); });
+  }
+
+  virtual const RegionSet &getNewRegionSet(const llvm::Function &F) {
+    return cacheRegionSet(NEW, &F, [&]() { return getNewRegionsRef(F); });
+  }
+
+  virtual const RegionSet &getAccessedRegionSet(const llvm::CallInst &I) {
+    return cacheRegionSet(ACCESSED, &I, [&]() { return getAccessedRegionsRef(I); });
+  }
+
+  virtual const RegionSet &getOnlyReadRegionSet(const llvm::CallInst &I) {
+    return cacheRegionSet(ONLY_READ, &I, [&]() { return getOnlyReadRegionsRef(I); });
+  }
+
+  virtual const RegionSet &getModifiedRegionSet(const llvm::CallInst &I) {
+    return cacheRegionSet(MODIFIED, &I, [&]() { return getModifiedRegionsRef(I); });
+  }
+
+  virtual const RegionSet &getNewRegionSet(const llvm::CallInst &I) {
+    return cacheRegionSet(NEW, &I, [&]() { return getNewRegionsRef(I); });
+  }
+
+  // Return the region of each pointer used or defined by the
+  // instructions of F (see forEachPointer) so that a client can
+  // translate a whole function with one query. The default
+  // implementation calls getRegion once per pointer and caches the
+  // map. The map is valid while the heap abstraction is alive.
+  virtual const RegionMap &getRegionMap(const llvm::Function &F);
+
+  // Call f on each pointer used or defined by I that a client of the
+  // heap abstraction can ask about.
+  static void forEachPointer(const llvm::Instruction &I,
+			     llvm::function_ref<void(const llvm::Value *)> f);
+
+  // return the set of ids of regions
+  static RegionSet toRegionSet(RegionRef regions) {
+    RegionSet res;
+    for (const Region &r: regions) {
+      res.set(r.get_id());
+    }
+    return res;
+  }
+  
   virtual llvm::StringRef getName() const = 0;
+
+private:
+  
+  enum RegionQuery { ACCESSED = 0, ONLY_READ, MODIFIED, NEW, NUM_QUERIES };
+  
+  // regions cached by the default implementations of the views. The
+  // key is either a llvm::Function or a llvm::CallInst.
+  std::unordered_map<const void*, RegionVec> m_cache[NUM_QUERIES];
+  std::unordered_map<const void*, RegionSet> m_set_cache[NUM_QUERIES];
+  // maps cached by the default implementation of getRegionMap
+  std::unordered_map<const llvm::Function*, RegionMap> m_region_maps;
+  std::mutex m_cache_mutex;
+
+  template<typename Compute>
+  RegionRef cacheRegions(RegionQuery q, const void *key, Compute compute) {
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+    auto it = m_cache[q].find(key);
+    if (it == m_cache[q].end()) {
+      it = m_cache[q].insert({key, compute()}).first;
+    }
+    return it->second;
+  }
+
+  template<typename ComputeRef>
+  const RegionSet &cacheRegionSet(RegionQuery q, const void *key,
+				  ComputeRef compute_ref) {
+    {
+      std::lock_guard<std::mutex> lock(m_cache_mutex);
+      auto it = m_set_cache[q].find(key);
+      if (it != m_set_cache[q].end()) {
+	return it->second;
+      }
+    }
+    // without the lock because the default views take it
+    RegionSet regions = toRegionSet(compute_ref());
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+    return m_set_cache[q].insert({key, regions}).first->second;
+  }
 };
 
 } // namespace clam
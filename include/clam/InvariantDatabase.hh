@@ -0,0 +1,122 @@
+#pragma once
+
+/*
+ * Binary database of the invariants computed by Clam.
+ *
+ * The database is meant to be memory-mapped by other tools and read
+ * in place: nothing is parsed when it is opened and a block is found
+ * in constant time through a hash table. It only depends on LLVM.
+ *
+ * Format (all integers are little-endian, offsets are in bytes from
+ * the start of the file and all records are 8-byte aligned):
+ *
+ *   header    := "CLAMINVD" <u32 version>
+ *                <u32 #strings> <u32 strings>
+ *                <u32 #functions> <u32 functions>
+ *                <u32 #blocks> <u32 blocks>
+ *                <u32 #slots> <u32 slots>
+ *   strings   := #strings x <u32 offset of a NUL-terminated string>
+ *   function  := <u32 name> <u32 first block> <u32 #blocks>
+ *                <u32 #safe> <u32 #error> <u32 #warning>
+ *   block     := <u32 function> <u32 name> <u32 pre> <u32 post>
+ *   slots     := #slots x <u32 block + 1>  (0 if the slot is empty)
+ *   system    := <u32 flags> <u32 #constraints> #constraints x constraint
+ *   constraint:= <u32 kind> <u32 #terms> <u32 signed> <u32 0>
+ *                <i64 constant> #terms x (<i64 coefficient> <u32 variable> <u32 0>)
+ *
+ * Names and variables are indexes in the string table. The pre and
+ * post fields of a block are offsets of a system, or NONE if the
+ * invariant was not stored. A system with the BOTTOM flag is
+ * unsatisfiable. A constraint is sum(coefficient * variable) +
+ * constant kind 0. Constraints whose numbers do not fit in 64 bits
+ * are not stored, so a system can be weaker than the invariant.
+ *
+ * The functions are in module order and the blocks of a function are
+ * consecutive. The slot of a block is the FNV-1a hash of its function
+ * name, a NUL character and its block name, modulo #slots (a power of
+ * two), with linear probing.
+ */
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace clam {
+
+class InvariantDatabase {
+public:
+  static const uint32_t VERSION = 1;
+  static const uint32_t NONE = 0xffffffff;
+  static const uint32_t BOTTOM = 1;
+
+  enum constraint_kind_t { EQ = 0, NE = 1, LE = 2, LT = 3 };
+
+  // Return null and set err if filename is not a valid database
+  static std::unique_ptr<InvariantDatabase> open(llvm::StringRef filename,
+                                                 std::string &err);
+
+  static uint32_t hash(llvm::StringRef function, llvm::StringRef block);
+
+  uint32_t num_functions() const { return m_num_functions; }
+  uint32_t num_blocks() const { return m_num_blocks; }
+
+  // Return the index of the block or NONE
+  uint32_t lookup(llvm::StringRef function, llvm::StringRef block) const;
+
+  llvm::StringRef get_string(uint32_t idx) const;
+
+  /* Functions */
+  llvm::StringRef get_function_name(uint32_t f) const;
+  uint32_t get_first_block(uint32_t f) const;
+  uint32_t get_num_blocks(uint32_t f) const;
+  uint32_t get_safe_checks(uint32_t f) const;
+  uint32_t get_error_checks(uint32_t f) const;
+  uint32_t get_warning_checks(uint32_t f) const;
+
+  /* Blocks */
+  uint32_t get_block_function(uint32_t b) const;
+  llvm::StringRef get_block_name(uint32_t b) const;
+  // offset of the system or NONE
+  uint32_t get_pre(uint32_t b) const;
+  uint32_t get_post(uint32_t b) const;
+
+  /* Systems and constraints (by offset) */
+  bool is_bottom(uint32_t sys) const;
+  uint32_t get_num_constraints(uint32_t sys) const;
+  // offset of the first constraint of sys
+  uint32_t get_first_constraint(uint32_t sys) const { return sys + 8; }
+  // offset of the constraint after cst
+  uint32_t get_next_constraint(uint32_t cst) const;
+  constraint_kind_t get_kind(uint32_t cst) const;
+  bool is_signed(uint32_t cst) const;
+  int64_t get_constant(uint32_t cst) const;
+  uint32_t get_num_terms(uint32_t cst) const;
+  int64_t get_coefficient(uint32_t cst, uint32_t i) const;
+  llvm::StringRef get_variable(uint32_t cst, uint32_t i) const;
+
+private:
+  std::unique_ptr<llvm::MemoryBuffer> m_buf;
+  const char *m_data;
+  uint32_t m_num_strings, m_strings;
+  uint32_t m_num_functions, m_functions;
+  uint32_t m_num_blocks, m_blocks;
+  uint32_t m_num_slots, m_slots;
+
+  InvariantDatabase(std::unique_ptr<llvm::MemoryBuffer> buf);
+  uint32_t u32(uint32_t offset) const;
+  int64_t i64(uint32_t offset) const;
+};
+
+// Merge the databases in inputs (e.g., of the shards of a module,
+// see --crab-shard) into output. The functions are in the order of
+// the inputs and a function in several inputs is only taken from the
+// first one. Return false and set err if an input is not a valid
+// database or output cannot be written.
+bool mergeInvariantDatabases(const std::vector<std::string> &inputs,
+                             const std::string &output, std::string &err);
+
+} // end namespace clam
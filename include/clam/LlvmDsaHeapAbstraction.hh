@@ -6,8 +6,10 @@
 
 #include "clam/HeapAbstraction.hh"
 #include "dsa/DSNode.h" // not enough forward declaration
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/StringRef.h"
 
+#include <mutex>
 #include <unordered_map>
 
 // forward declarations
@@ -27,6 +29,7 @@ namespace clam {
    public:
 
     using typename HeapAbstraction::RegionVec;
+    using typename HeapAbstraction::RegionRef;
     using typename HeapAbstraction::RegionId;
     
    private:
@@ -44,14 +47,29 @@ namespace clam {
     bool m_disambiguate_external;
     
     llvm::DenseMap<const llvm::Function*, RegionVec> m_func_accessed;
+    llvm::DenseMap<const llvm::Function*, RegionVec> m_func_only_reads;
     llvm::DenseMap<const llvm::Function*, RegionVec> m_func_mods;
     llvm::DenseMap<const llvm::Function*, RegionVec> m_func_news;
 
     llvm::DenseMap<const llvm::CallInst*, RegionVec> m_callsite_accessed;
+    llvm::DenseMap<const llvm::CallInst*, RegionVec> m_callsite_only_reads;
     llvm::DenseMap<const llvm::CallInst*, RegionVec> m_callsite_mods;
     llvm::DenseMap<const llvm::CallInst*, RegionVec> m_callsite_news;
 
+    // functions whose regions and callsite regions are cached
+    llvm::DenseSet<const llvm::Function*> m_cached_funcs;
+    // guards the caches and the region ids
+    std::mutex m_mutex;
+
     RegionId getId(const llvm::DSNode* n, unsigned offset);
+
+    // assign the ids of the nodes of every graph in module order so
+    // that they do not depend on the order of the queries
+    void numberNodes(const llvm::DSGraph &g);
+
+    // cache the regions of f and of its callsites if not done yet.
+    // m_mutex must be held.
+    void cacheFunction(const llvm::Function &f);
             
     // compute and cache the set of read, mod and new nodes of a whole
     // function such that mod nodes are a subset of the read nodes and
@@ -100,6 +118,22 @@ namespace clam {
     
     virtual RegionVec getNewRegions(const llvm::CallInst &I) override;
     
+    virtual RegionRef getAccessedRegionsRef(const llvm::Function &F) override;
+    
+    virtual RegionRef getOnlyReadRegionsRef(const llvm::Function &F) override;
+    
+    virtual RegionRef getModifiedRegionsRef(const llvm::Function &F) override;
+    
+    virtual RegionRef getNewRegionsRef(const llvm::Function &F) override;
+    
+    virtual RegionRef getAccessedRegionsRef(const llvm::CallInst &I) override;
+    
+    virtual RegionRef getOnlyReadRegionsRef(const llvm::CallInst &I) override;
+    
+    virtual RegionRef getModifiedRegionsRef(const llvm::CallInst &I) override;
+    
+    virtual RegionRef getNewRegionsRef(const llvm::CallInst &I) override;
+    
     virtual llvm::StringRef getName() const override {
       return "LlvmDsaHeapAbstraction";
     }
@@ -6,12 +6,18 @@
 namespace clam {
 
   // Preprocessor passes
-  llvm::Pass* createLowerCstExprPass ();
+  llvm::Pass* createLowerCstExprPass (bool shared);
   llvm::Pass* createLowerGvInitializersPass ();
   llvm::Pass* createLowerSelectPass ();
   llvm::Pass* createLowerUnsignedICmpPass ();
+  llvm::Pass* createFusedLoweringPass (bool lowerCstExpr, bool lowerUnsignedICmp,
+                                       bool lowerSelect, bool sharedCstExpr);
   llvm::Pass* createScalarizerPass();
   llvm::Pass* createMarkInternalInlinePass ();
+  llvm::Pass* createMarkSelectiveInlinePass (unsigned maxSize, unsigned maxCalls,
+                                             unsigned callerBudget, bool report);
+  llvm::Pass* createSpecializeConstantArgsPass (unsigned minCalls, unsigned maxClones,
+                                               unsigned budget, bool report);
   llvm::Pass* createRemoveUnreachableBlocksPass ();
   llvm::Pass* createSimplifyAssumePass ();
   llvm::Pass* createDevirtualizeFunctionsPass();
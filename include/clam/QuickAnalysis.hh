@@ -0,0 +1,64 @@
+#pragma once
+
+/*
+ * Analysis of a single function without any pass setup.
+ */
+
+#include "clam/Clam.hh"
+
+#include <memory>
+
+namespace llvm {
+  class Function;
+  class Module;
+}
+
+namespace clam {
+  class HeapAbstraction;
+}
+
+namespace clam {
+
+  struct QuickAnalysisResult {
+    // invariants at the entry of each block without shadow variables
+    IntraClam::abs_dom_map_t pre;
+    IntraClam::checks_db_t checks;
+    // whether the CFG was reused from a previous query on the same
+    // function
+    bool reused_cfg;
+
+    QuickAnalysisResult(): reused_cfg(false) {}
+  };
+
+  /**
+   * Analyze fun with dom and check its assertions. If the estimated
+   * cost of the analysis with dom exceeds budget (0 if unlimited)
+   * then fun is analyzed with intervals.
+   *
+   * The CFGs are built by a manager per module that is kept between
+   * queries so the CFG of a function is only built again if the
+   * function changed. The values do not need to be named first. By
+   * default there is no heap abstraction so only the numerical part
+   * of the function is analyzed (see quickSetHeapAbstraction).
+   *
+   * Queries on different modules can run concurrently. The queries
+   * on the same module are serialized.
+   **/
+  QuickAnalysisResult quickAnalyze(const llvm::Function &fun,
+				   CrabDomain dom = INTERVALS,
+				   double budget = 0);
+
+  /**
+   * Use mem to translate the memory of the functions of M in the
+   * next queries. The CFGs already built for M are dropped.
+   **/
+  void quickSetHeapAbstraction(const llvm::Module &M,
+			       std::unique_ptr<HeapAbstraction> mem);
+
+  /**
+   * Release the CFGs and the heap abstraction kept for M. It must be
+   * called before M is destroyed.
+   **/
+  void quickRelease(const llvm::Module &M);
+
+} // end namespace clam
@@ -32,6 +32,7 @@ class LegacySeaDsaHeapAbstraction : public HeapAbstraction {
 public:
   using typename HeapAbstraction::RegionId;
   using typename HeapAbstraction::RegionVec;
+  using typename HeapAbstraction::RegionRef;
 
 private:
   // XXX: We should use sea_dsa::Graph::SetFactory.
@@ -47,16 +48,31 @@ private:
   RegionId getId(const sea_dsa::Cell &c);
 
   void initialize(const llvm::Module &M);
+
+  // regions found in the sea-dsa graphs without ids yet
+  struct PendingRegions;
+
+  // collect the read, mod and new nodes of a whole function. It only
+  // reads the sea-dsa graphs.
+  void collectReadModNewNodes(const llvm::Function &f,
+                              PendingRegions &regions) const;
+
+  // collect the read, mod and new nodes of a callsite. It only reads
+  // the sea-dsa graphs.
+  void collectReadModNewNodesFromCallSite(const llvm::CallInst &I,
+                                          PendingRegions &regions) const;
   
   // compute and cache the set of read, mod and new nodes of a whole
   // function such that mod nodes are a subset of the read nodes and
   // the new nodes are disjoint from mod nodes.
-  void computeReadModNewNodes(const llvm::Function &f);
+  void computeReadModNewNodes(const llvm::Function &f,
+                              const PendingRegions &regions);
 
   // Compute and cache the set of read, mod and new nodes of a
   // callsite such that mod nodes are a subset of the read nodes and
   // the new nodes are disjoint from mod nodes.
   void computeReadModNewNodesFromCallSite(const llvm::CallInst &I,
+                                          const PendingRegions &regions,
                                           callsite_map_t &accessed,
                                           callsite_map_t &mods,
                                           callsite_map_t &news);
@@ -65,7 +81,8 @@ private:
 
 public:
   // This class creates and owns a sea-dsa GlobalAnalysis instance and
-  // run it on M.
+  // run it on M. The regions of the functions are computed with
+  // num_threads threads once sea-dsa finishes.
   LegacySeaDsaHeapAbstraction(const llvm::Module &M, llvm::CallGraph &cg,
                               const llvm::DataLayout &dl,
                               const llvm::TargetLibraryInfo &tli,
@@ -74,7 +91,8 @@ public:
 			      bool disambiguate_for_array_smashing,
                               bool disambiguate_unknown,
                               bool disambiguate_ptr_cast,
-                              bool disambiguate_external);
+                              bool disambiguate_external,
+                              unsigned num_threads = 1);
 
   // This class takes an existing sea-dsa Global Analysis instance.
   // It doesn't own it.
@@ -83,7 +101,8 @@ public:
 			      bool disambiguate_for_array_smashing,
                               bool disambiguate_unknown,
                               bool disambiguate_ptr_cast,
-                              bool disambiguate_external);
+                              bool disambiguate_external,
+                              unsigned num_threads = 1);
   
   ~LegacySeaDsaHeapAbstraction();
 
@@ -112,6 +131,22 @@ public:
 
   virtual RegionVec getNewRegions(const llvm::CallInst &I) override;
 
+  virtual RegionRef getAccessedRegionsRef(const llvm::Function &F) override;
+
+  virtual RegionRef getOnlyReadRegionsRef(const llvm::Function &F) override;
+
+  virtual RegionRef getModifiedRegionsRef(const llvm::Function &F) override;
+
+  virtual RegionRef getNewRegionsRef(const llvm::Function &F) override;
+
+  virtual RegionRef getAccessedRegionsRef(const llvm::CallInst &I) override;
+
+  virtual RegionRef getOnlyReadRegionsRef(const llvm::CallInst &I) override;
+
+  virtual RegionRef getModifiedRegionsRef(const llvm::CallInst &I) override;
+
+  virtual RegionRef getNewRegionsRef(const llvm::CallInst &I) override;
+
   virtual llvm::StringRef getName() const override {
     return "LegacySeaDsaHeapAbstraction";
   }
@@ -129,13 +164,21 @@ private:
   bool m_disambiguate_unknown;
   bool m_disambiguate_ptr_cast;
   bool m_disambiguate_external;
+  unsigned m_num_threads;
 
   llvm::DenseMap<const llvm::Function *, RegionVec> m_func_accessed;
+  llvm::DenseMap<const llvm::Function *, RegionVec> m_func_only_reads;
   llvm::DenseMap<const llvm::Function *, RegionVec> m_func_mods;
   llvm::DenseMap<const llvm::Function *, RegionVec> m_func_news;
   llvm::DenseMap<const llvm::CallInst *, RegionVec> m_callsite_accessed;
+  llvm::DenseMap<const llvm::CallInst *, RegionVec> m_callsite_only_reads;
   llvm::DenseMap<const llvm::CallInst *, RegionVec> m_callsite_mods;
   llvm::DenseMap<const llvm::CallInst *, RegionVec> m_callsite_news;
+  /// region of each cell (node, offset) returned by getRegion. The
+  /// classification of a cell only depends on the cell and the
+  /// disambiguation flags which do not change.
+  llvm::DenseMap<std::pair<const sea_dsa::Node *, unsigned>, Region>
+      m_cell_regions;
 };
 
 using SeaDsaHeapAbstraction = LegacySeaDsaHeapAbstraction;
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "clam/HeapAbstraction.hh"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace clam {
+
+/*
+ * Heap abstraction that replays the answers of another heap
+ * abstraction.
+ *
+ * It records the region of each pointer used by an instruction,
+ * whether a pointer is a base pointer and the regions of each
+ * function and callsite. The recorded answers can be written into a
+ * file and loaded in a later run on the same module so that the
+ * heap analysis (e.g., sea-dsa) does not need to run again.
+ *
+ * Queries that were not recorded (e.g., pointers that are constant
+ * expressions) return an unknown region which is always sound.
+ */
+class SnapshotHeapAbstraction : public HeapAbstraction {
+public:
+  using typename HeapAbstraction::RegionId;
+  using typename HeapAbstraction::RegionVec;
+  using typename HeapAbstraction::RegionRef;
+  using typename HeapAbstraction::RegionSet;
+
+  // Record all the answers of mem for module M.
+  static std::unique_ptr<SnapshotHeapAbstraction>
+  record(const llvm::Module &M, HeapAbstraction &mem);
+
+  // Return the snapshot stored in file if it was written with the
+  // same key for module M. Otherwise, return null.
+  static std::unique_ptr<SnapshotHeapAbstraction>
+  load(const std::string &file, const std::string &key, const llvm::Module &M);
+
+  // Write the snapshot into file. Errors are reported as warnings.
+  bool write(const std::string &file, const std::string &key) const;
+
+  // Return the key of a snapshot given the module and a textual
+  // representation of the options of the heap analysis.
+  static std::string getKey(const llvm::Module &M,
+                            const std::string &options_str);
+
+  HeapAbstraction::ClassId getClassId() const {
+    return HeapAbstraction::ClassId::SNAPSHOT;
+  }
+
+  bool isBasePtr(const llvm::Function &F, const llvm::Value *V);
+
+  Region getRegion(const llvm::Function &fun, const llvm::Instruction *i,
+                   const llvm::Value *ptr);
+
+  RegionVec getAccessedRegions(const llvm::Function &F) {
+    return getRegions(ACCESSED, &F);
+  }
+
+  RegionVec getOnlyReadRegions(const llvm::Function &F) {
+    return getRegions(ONLY_READ, &F);
+  }
+
+  RegionVec getModifiedRegions(const llvm::Function &F) {
+    return getRegions(MODIFIED, &F);
+  }
+
+  RegionVec getNewRegions(const llvm::Function &F) {
+    return getRegions(NEW, &F);
+  }
+
+  RegionVec getAccessedRegions(const llvm::CallInst &I) {
+    return getRegions(ACCESSED, &I);
+  }
+
+  RegionVec getOnlyReadRegions(const llvm::CallInst &I) {
+    return getRegions(ONLY_READ, &I);
+  }
+
+  RegionVec getModifiedRegions(const llvm::CallInst &I) {
+    return getRegions(MODIFIED, &I);
+  }
+
+  RegionVec getNewRegions(const llvm::CallInst &I) {
+    return getRegions(NEW, &I);
+  }
+
+  RegionRef getAccessedRegionsRef(const llvm::Function &F) {
+    return getRegions(ACCESSED, &F);
+  }
+
+  RegionRef getOnlyReadRegionsRef(const llvm::Function &F) {
+    return getRegions(ONLY_READ, &F);
+  }
+
+  RegionRef getModifiedRegionsRef(const llvm::Function &F) {
+    return getRegions(MODIFIED, &F);
+  }
+
+  RegionRef getNewRegionsRef(const llvm::Function &F) {
+    return getRegions(NEW, &F);
+  }
+
+  RegionRef getAccessedRegionsRef(const llvm::CallInst &I) {
+    return getRegions(ACCESSED, &I);
+  }
+
+  RegionRef getOnlyReadRegionsRef(const llvm::CallInst &I) {
+    return getRegions(ONLY_READ, &I);
+  }
+
+  RegionRef getModifiedRegionsRef(const llvm::CallInst &I) {
+    return getRegions(MODIFIED, &I);
+  }
+
+  RegionRef getNewRegionsRef(const llvm::CallInst &I) {
+    return getRegions(NEW, &I);
+  }
+
+  const RegionSet &getAccessedRegionSet(const llvm::Function &F) {
+    return getRegionSet(ACCESSED, &F);
+  }
+
+  const RegionSet &getOnlyReadRegionSet(const llvm::Function &F) {
+    return getRegionSet(ONLY_READ, &F);
+  }
+
+  const RegionSet &getModifiedRegionSet(const llvm::Function &F) {
+    return getRegionSet(MODIFIED, &F);
+  }
+
+  const RegionSet &getNewRegionSet(const llvm::Function &F) {
+    return getRegionSet(NEW, &F);
+  }
+
+  const RegionSet &getAccessedRegionSet(const llvm::CallInst &I) {
+    return getRegionSet(ACCESSED, &I);
+  }
+
+  const RegionSet &getOnlyReadRegionSet(const llvm::CallInst &I) {
+    return getRegionSet(ONLY_READ, &I);
+  }
+
+  const RegionSet &getModifiedRegionSet(const llvm::CallInst &I) {
+    return getRegionSet(MODIFIED, &I);
+  }
+
+  const RegionSet &getNewRegionSet(const llvm::CallInst &I) {
+    return getRegionSet(NEW, &I);
+  }
+
+  llvm::StringRef getName() const { return "SnapshotHeapAbstraction"; }
+
+private:
+  enum Query { ACCESSED = 0, ONLY_READ, MODIFIED, NEW, NUM_QUERIES };
+
+  struct Regions {
+    RegionVec vecs[NUM_QUERIES];
+    RegionSet sets[NUM_QUERIES];
+  };
+
+  const llvm::Module &m_M;
+  // regions of the pointers (second) used by the instructions (first)
+  llvm::DenseMap<std::pair<const llvm::Instruction *, const llvm::Value *>,
+                 Region> m_value_regions;
+  // base pointers of each function
+  llvm::DenseSet<std::pair<const llvm::Function *, const llvm::Value *>>
+      m_base_ptrs;
+  // the key is either a llvm::Function or a llvm::CallInst
+  std::unordered_map<const void *, Regions> m_regions;
+  RegionVec m_empty_vec;
+  RegionSet m_empty_set;
+
+  SnapshotHeapAbstraction(const llvm::Module &M) : HeapAbstraction(), m_M(M) {}
+
+  // build the sets of regions once all the regions are known
+  void initRegionSets();
+
+  const RegionVec &getRegions(Query q, const void *key) const {
+    auto it = m_regions.find(key);
+    return (it != m_regions.end() ? it->second.vecs[q] : m_empty_vec);
+  }
+
+  const RegionSet &getRegionSet(Query q, const void *key) const {
+    auto it = m_regions.find(key);
+    return (it != m_regions.end() ? it->second.sets[q] : m_empty_set);
+  }
+};
+
+} // namespace clam
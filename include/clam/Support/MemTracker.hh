@@ -0,0 +1,65 @@
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace clam {
+
+/**
+ * Memory allocated by each function and phase of the analysis.
+ *
+ * If Clam is built with CLAM_TRACK_ALLOCATIONS then the global
+ * operator new and operator delete are replaced by versions that tag
+ * each allocation with the function and the phase of the allocating
+ * thread (see ScopedFunction and ScopedPhase). The bytes are counted
+ * against those tags until they are freed, by any thread. Otherwise,
+ * nothing is tracked and all the usages are empty.
+ **/
+class MemTracker {
+public:
+  struct usage_t {
+    // bytes allocated with the tag and not freed yet
+    uint64_t live;
+    // maximum of live
+    uint64_t peak;
+    usage_t() : live(0), peak(0) {}
+  };
+
+  static bool enabled();
+
+  static std::map<std::string, usage_t> get_functions();
+  static usage_t get_function(llvm::StringRef function);
+  static std::map<std::string, usage_t> get_phases();
+  static usage_t get_total();
+
+  // The allocations of the current thread are tagged with function
+  // until the end of the scope
+  class ScopedFunction {
+    uint32_t m_prev;
+
+  public:
+    ScopedFunction(llvm::StringRef function);
+    ~ScopedFunction();
+    ScopedFunction(const ScopedFunction &) = delete;
+    ScopedFunction &operator=(const ScopedFunction &) = delete;
+  };
+
+  // The allocations of the current thread are tagged with phase
+  // (e.g., "cfg", "liveness", "fixpoint" or "invariants") until the
+  // end of the scope or the next enter
+  class ScopedPhase {
+    uint32_t m_prev;
+
+  public:
+    ScopedPhase(llvm::StringRef phase);
+    ~ScopedPhase();
+    void enter(llvm::StringRef phase);
+    ScopedPhase(const ScopedPhase &) = delete;
+    ScopedPhase &operator=(const ScopedPhase &) = delete;
+  };
+};
+
+} // end namespace clam
@@ -4,8 +4,20 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Function.h"
 
+#include <string>
+
 namespace clam {
 
+  // Name of v to print it. Unnamed arguments, blocks and
+  // instructions get the name that NameValues would give them (_N
+  // where N is their slot number) so the IR does not need to be named
+  // before building the Crab CFGs (see --crab-lazy-names).
+  std::string getValueName(const llvm::Value &v);
+
+  // Forget the names synthesized for the values of F. It must be
+  // called before F is modified.
+  void invalidateValueNames(const llvm::Function &F);
+
   class NameValues : public llvm::ModulePass {
    public:
     
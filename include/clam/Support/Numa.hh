@@ -0,0 +1,30 @@
+#pragma once
+
+namespace clam {
+
+/**
+ * Placement of the worker threads on the NUMA nodes of the machine
+ * (--crab-threads-numa).
+ *
+ * If enabled, worker i is pinned to the CPUs of node i % num_nodes()
+ * so consecutive workers are spread over the nodes. Since Linux
+ * allocates a page on the node of the thread that first touches it,
+ * and malloc gives each thread its own arena, the CFG copies and the
+ * abstract states built by a pinned worker stay on its node. The
+ * nodes are read from /sys/devices/system/node: elsewhere, and on
+ * machines with a single node, nothing is pinned.
+ **/
+class Numa {
+public:
+  static void set_enabled(bool enabled);
+  static bool enabled();
+
+  // Number of nodes with CPUs (1 if unknown)
+  static unsigned num_nodes();
+
+  // Pin the calling thread as worker number worker. Return false if
+  // it is not pinned.
+  static bool pin_worker(unsigned worker);
+};
+
+} // end namespace clam
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "clam/Support/MemTracker.hh"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace clam {
+
+/**
+ * Counters and timers of Clam (--crab-stats).
+ *
+ * Unlike crab::CrabStats, which is one global registry, each thread
+ * updates its own counters and they are only combined when read:
+ * counters are added, maxima are maxed and timers are added. The
+ * counters of a thread that exits are kept.
+ *
+ * The updates of a thread are also attributed to the function set by
+ * ScopedFunction, if any, so they can be read per function.
+ **/
+class ClamStats {
+public:
+  static void count(llvm::StringRef name, uint64_t n = 1);
+  static void count_max(llvm::StringRef name, uint64_t v);
+  // seconds
+  static void add_time(llvm::StringRef name, double t);
+
+  static uint64_t get(llvm::StringRef name);
+  static double get_time(llvm::StringRef name);
+
+  // All the counters and timers (in seconds) of all the threads, or
+  // only those attributed to function
+  static std::map<std::string, double> get_all();
+  static std::map<std::string, double> get_function(llvm::StringRef function);
+
+  static void reset();
+
+  // One line per counter and timer, as crab::CrabStats::PrintBrunch
+  static void PrintBrunch(llvm::raw_ostream &o);
+
+  // The updates of the current thread, and its allocations (see
+  // MemTracker), are attributed to function until the end of the
+  // scope
+  class ScopedFunction {
+    const std::string *m_prev;
+    std::string m_function;
+    MemTracker::ScopedFunction m_mem;
+
+  public:
+    ScopedFunction(llvm::StringRef function);
+    ~ScopedFunction();
+    ScopedFunction(const ScopedFunction &) = delete;
+    ScopedFunction &operator=(const ScopedFunction &) = delete;
+  };
+};
+
+class ScopedClamStats {
+  std::string m_name;
+  std::chrono::steady_clock::time_point m_start;
+
+public:
+  ScopedClamStats(llvm::StringRef name)
+      : m_name(name.str()), m_start(std::chrono::steady_clock::now()) {}
+
+  ~ScopedClamStats() {
+    ClamStats::add_time(m_name, std::chrono::duration<double>(
+                                    std::chrono::steady_clock::now() - m_start)
+                                    .count());
+  }
+};
+
+} // end namespace clam
@@ -3,17 +3,21 @@
 /**  Program transformation to replace indirect calls with direct calls **/
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/InstVisitor.h"
 
 #include <memory>
 #include <map> // for multimap
+#include <string>
+#include <vector>
 
 namespace llvm {
 class Module;
 class Function;
 class CallSite;
 class PointerType;
+class FunctionType;
 class CallGraph;
 } // namespace llvm
 
@@ -46,10 +50,13 @@ struct DevirtStats {
   // number of calls which were resolved by Dsa but no consistent type
   // signature was found
   unsigned m_num_type_unresolved;
+  // number of calls with too many targets replaced with a havoc
+  unsigned m_num_megamorphic;
 
   DevirtStats():
     m_num_indirect_calls(0), m_num_resolved_calls(0),
-    m_num_dsa_unresolved(0), m_num_type_unresolved(0) {}
+    m_num_dsa_unresolved(0), m_num_type_unresolved(0),
+    m_num_megamorphic(0) {}
 
   void dump() const;
 };
@@ -76,6 +83,9 @@ public:
   /* return all possible targets for CS */
   virtual const AliasSet* getTargets(llvm::CallSite &CS) = 0;
 
+  /* true if CS is not resolved because it has too many targets */
+  virtual bool isMegamorphic(llvm::CallSite &CS) { return false; }
+
   /* for reusing bounce functions */
   virtual llvm::Function* getBounceFunction(llvm::CallSite &CS) = 0;
   virtual void cacheBounceFunction(llvm::CallSite &CS, llvm::Function* bounce) = 0;
@@ -139,6 +149,8 @@ public:
   
   const AliasSet* getTargets(llvm::CallSite &CS);
 
+  bool isMegamorphic(llvm::CallSite &CS);
+  
   llvm::Function* getBounceFunction(llvm::CallSite& CS);
   
   void cacheBounceFunction(llvm::CallSite&CS, llvm::Function* bounceFunction);  
@@ -158,10 +170,62 @@ private:
   unsigned m_max_num_targets;
   // -- map from callsite to the corresponding alias set
   TargetsMap m_targets_map;  
+  // -- callsites with more than m_max_num_targets targets
+  llvm::DenseSet<llvm::Instruction*> m_megamorphic;
   // -- map from alias set id + dsa targets to an existing bounce function
   BounceMap m_bounce_map;  
 };
 
+/*
+ * Resolve indirect calls by using a resolution table computed by
+ * another resolver in a previous run on the same module (see
+ * exportResolutionTable). This avoids running again the pointer
+ * analysis.
+ */
+class CallSiteResolverByTable final: public CallSiteResolverByTypes {
+public:
+  using AliasSetId = CallSiteResolverByTypes::AliasSetId;  
+  using AliasSet = CallSiteResolverByTypes::AliasSet;
+
+  // Return null if the table cannot be read or it was not computed
+  // with the same key.
+  static std::unique_ptr<CallSiteResolverByTable>
+  load(llvm::Module &M, const std::string &file, const std::string &key,
+       DevirtStats &stats);
+  
+  ~CallSiteResolverByTable();
+  
+  const AliasSet* getTargets(llvm::CallSite &CS);
+
+  llvm::Function* getBounceFunction(llvm::CallSite& CS);
+  
+  void cacheBounceFunction(llvm::CallSite&CS, llvm::Function* bounceFunction);  
+
+private:
+  /* invariant: the value in TargetsMap's entries is sorted */  
+  using TargetsMap = llvm::DenseMap<llvm::Instruction*, AliasSet>;
+  using BounceMap = std::multimap<AliasSetId, std::pair<const AliasSet*, llvm::Function *>>;
+  // -- map from callsite to the corresponding alias set
+  TargetsMap m_targets_map;  
+  // -- map from alias set id + targets to an existing bounce function
+  BounceMap m_bounce_map;  
+
+  CallSiteResolverByTable(llvm::Module& M, DevirtStats &stats);
+};
+
+/* 
+ * Write into file the targets of all the indirect calls of M
+ * resolved by CSR. A callsite is identified by the name of its
+ * function and its position in the function. Return false if the
+ * file cannot be written.
+ */
+bool exportResolutionTable(llvm::Module &M, CallSiteResolver &CSR,
+			   const std::string &file, const std::string &key);
+
+/* Return a key that identifies the module M and the resolver options */
+std::string getResolutionTableKey(const llvm::Module &M,
+				  const std::string &options_str);
+
 //
 // Class: DevirtualizeFunctions
 //
@@ -181,6 +245,20 @@ private:
   // allow creating of indirect calls during devirtualization
   // (required for soundness)
   bool m_allowIndirectCalls;
+  // share bounce functions between callsites with the same targets
+  // and the same signature modulo pointer types
+  bool m_shareBounceFns;
+  using SharedBounceKey =
+    std::pair<llvm::FunctionType*, std::vector<const llvm::Function*>>;
+  std::map<SharedBounceKey, llvm::Function*> m_shared_bounce_map;
+  // dispatch in bounce functions with a single switch rather than
+  // with a chain of comparisons
+  bool m_switchBounceFns;
+  // replace the calls with more targets with a call to an external
+  // function (if 0 then unlimited)
+  unsigned m_maxNumTargets;
+  // external functions used for the calls with too many targets
+  llvm::DenseMap<llvm::FunctionType*, llvm::Function*> m_havoc_fns;
   // Worklist of call sites to transform
   llvm::SmallVector<llvm::Instruction *, 32> m_worklist;
   // For stats
@@ -192,8 +270,25 @@ private:
   /// create a bounce function that calls functions directly
   llvm::Function *mkBounceFn(llvm::CallSite &CS, CallSiteResolver *CSR);
 
+  /// create or reuse a bounce function whose pointer types are erased
+  llvm::Function *mkSharedBounceFn(llvm::CallSite &CS, CallSiteResolver *CSR);
+
+  llvm::Function *createBounceFn(llvm::FunctionType *NewTy,
+				 const AliasSet &Targets, llvm::Module *M);
+
+  /// true if CS has more than m_maxNumTargets targets
+  bool isMegamorphic(llvm::CallSite &CS, CallSiteResolver *CSR);
+
+  /// replace the call-site with a call to an external function
+  void mkHavocCall(llvm::CallSite &CS);
+
+  llvm::Function *getHavocFn(llvm::FunctionType *Ty, llvm::Module *M);
+  
 public:
-  DevirtualizeFunctions(llvm::CallGraph *cg, bool allowIndirectCalls);
+  DevirtualizeFunctions(llvm::CallGraph *cg, bool allowIndirectCalls,
+			bool shareBounceFns = false,
+			bool switchBounceFns = true,
+			unsigned maxNumTargets = 0);
 
   ~DevirtualizeFunctions();
 
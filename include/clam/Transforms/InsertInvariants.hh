@@ -19,6 +19,8 @@ namespace clam {
 
     llvm::Function* m_assumeFn;
 
+    bool runOnModuleParallel (llvm::Module& M, unsigned num_threads);
+
   public:
     
     static char ID;        
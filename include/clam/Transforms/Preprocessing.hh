@@ -0,0 +1,36 @@
+#pragma once
+
+/*
+ * Pass pipelines shared by clam-pp and clam.
+ *
+ * clam-pp runs addPreprocessingPasses on the bitcode produced by
+ * clang. clam can run the same pipeline (and optionally the LLVM -O
+ * pipeline) on the in-memory module before the analysis so that the
+ * whole frontend runs in a single process.
+ */
+
+namespace llvm {
+  namespace legacy {
+    class PassManager;
+    class FunctionPassManager;
+  }
+}
+
+namespace clam {
+
+  // Add the clam-pp pipeline to pm.
+  void addPreprocessingPasses (llvm::legacy::PassManager &pm);
+
+  // Add the lowering passes that clam always runs before the
+  // analysis (see tools/clam.cc).
+  void addLoweringPasses (llvm::legacy::PassManager &pm);
+
+  // Add the function passes of addLoweringPasses, for a function
+  // whose body is read on demand (see clam --lazy-functions). The
+  // constant expressions are lowered by the fused lowering.
+  void addFunctionLoweringPasses (llvm::legacy::FunctionPassManager &fpm);
+
+  // Add the LLVM pipeline of opt -O<level> to pm, configured as
+  // clam.py configures opt (no vectorization).
+  void addOptimizationPasses (llvm::legacy::PassManager &pm, unsigned level);
+}
@@ -9,6 +9,9 @@
 /** Include all abstract domains */
 #cmakedefine HAVE_ALL_DOMAINS ${HAVE_ALL_DOMAINS}
 
+/** Build each abstract domain (except zones) as a plugin */
+#cmakedefine HAVE_DOMAIN_PLUGINS ${HAVE_DOMAIN_PLUGINS}
+
 /** Include inter-procedural analysis */
 #cmakedefine HAVE_INTER ${HAVE_INTER}
 
@@ -19,6 +22,22 @@
  ** in DBM-based domains. Only if USE_DBM_BIGNUM is disabled.  **/
 #cmakedefine USE_DBM_SAFEINT ${USE_DBM_SAFEINT}
 
+/** Whether to store the weights of DBM-based domains in a dense
+ ** matrix. Only if USE_DBM_BIGNUM is disabled. **/
+#cmakedefine USE_DBM_DENSE ${USE_DBM_DENSE}
+
+/** Whether the term functor uses integer instead of string variable
+ ** names in its underlying domain **/
+#cmakedefine USE_TERM_INT_VARNAMES ${USE_TERM_INT_VARNAMES}
+
+/** Whether the global operator new and delete are replaced to count
+ ** the memory allocated by each function and phase **/
+#cmakedefine TRACK_ALLOCATIONS ${TRACK_ALLOCATIONS}
+
+/** Whether the domains can be instrumented to count and time their
+ ** operations (--crab-dom-instrument) **/
+#cmakedefine INSTRUMENT_DOMAINS ${INSTRUMENT_DOMAINS}
+
 /** Use new top-down inter-procedural analysis.  Otherwise, it will
     use the old bottom-up analysis */
 #cmakedefine TOP_DOWN_INTER_ANALYSIS ${TOP_DOWN_INTER_ANALYSIS}
@@ -10,64 +10,92 @@
 #include "crab/cfg/var_factory.hpp"
 
 #include "llvm/IR/Value.h"
+#include "llvm/IR/Argument.h"
 #include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "clam/Support/NameValues.hh"
+
 #include <memory>
 #include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <ostream>
+#include <streambuf>
 
 namespace clam {
 
   // This wrapper is needed because we can have crab blocks which do
   // not correspond to llvm blocks.
+  //
+  // Crab compares, orders and hashes block labels very often so the
+  // identity of a wrapper is given by its unique identifier. Names
+  // are only built when printing so a label is just two pointers
+  // plus an identifier.
   class llvm_basic_block_wrapper {
     
   public:
 
     // the new block represents that the control is at b
     llvm_basic_block_wrapper(const llvm::BasicBlock *b, std::size_t id)
-      : m_bb(b), m_edge(nullptr, nullptr), m_name(b->getName()), m_id(id) {
-      assert(b->hasName());
+      : m_src(b), m_dst(nullptr), m_id(id) {
+      assert(b);
     }
 
     // the new block represents that the control goes from src to dst
     llvm_basic_block_wrapper(const llvm::BasicBlock *src, const llvm::BasicBlock *dst,
-			     std::string name, std::size_t id)
-      : m_bb(nullptr), m_edge(src, dst), m_name(name), m_id(id) {}
+			     std::size_t id)
+      : m_src(src), m_dst(dst), m_id(id) {
+      assert(src && dst);
+    }
 
     llvm_basic_block_wrapper()
-      : m_bb(nullptr), m_edge(nullptr, nullptr), m_name(""), m_id(0) {}
+      : m_src(nullptr), m_dst(nullptr), m_id(0) {}
 
     // for boost bgl
     llvm_basic_block_wrapper(std::nullptr_t)
-      : m_bb(nullptr), m_edge(nullptr, nullptr), m_name(""), m_id(0) {}
+      : m_src(nullptr), m_dst(nullptr), m_id(0) {}
     
-    std::string get_name() const { return m_name; }
+    std::string get_name() const {
+      if (const llvm::BasicBlock *bb = get_basic_block()) {
+	return getValueName(*bb);
+      } else if (is_edge()) {
+	return std::string("__@bb_") + std::to_string(m_id);
+      } else {
+	return std::string("");
+      }
+    }
 
     bool is_edge() const {
-      return !m_bb && (m_edge.first && m_edge.second);
+      return m_dst != nullptr;
     }
     
     const llvm::BasicBlock* get_basic_block() const {
-      return m_bb;
+      return (m_dst ? nullptr : m_src);
     }
     
-    const std::pair<const llvm::BasicBlock*, const llvm::BasicBlock*>&
+    std::pair<const llvm::BasicBlock*, const llvm::BasicBlock*>
     get_edge() const {
-      return m_edge;
+      if (is_edge()) {
+	return {m_src, m_dst};
+      } else {
+	return {nullptr, nullptr};
+      }
     }
 
     bool operator==(const llvm_basic_block_wrapper &other) const
-    { return m_name == other.m_name; }
+    { return m_id == other.m_id; }
     
     bool operator!=(const llvm_basic_block_wrapper &other) const
     { return !(this->operator==(other)); }
     
     bool operator<(const llvm_basic_block_wrapper &other) const
-    { return m_name < other.m_name; }
+    { return m_id < other.m_id; }
 
     std::size_t hash() const {
-      return std::hash<std::string>{}(m_name);
+      return std::hash<std::size_t>{}(m_id);
     }
 
     // used by some crab datastructures
@@ -81,13 +109,13 @@ namespace clam {
     // block or edge, but not both.
     // 
     
-    // the block wrapper corresponds to a llvm basic block
-    const llvm::BasicBlock *m_bb;
-    // the block wrapper corresponds to a llvm edge
-    std::pair<const llvm::BasicBlock *, const llvm::BasicBlock *> m_edge;
-    // block wrapper name
-    std::string m_name;
-    // block wrapper unique identifier
+    // If m_dst is null then the block wrapper corresponds to the llvm
+    // basic block m_src. Otherwise, it corresponds to the llvm edge
+    // (m_src, m_dst).
+    const llvm::BasicBlock *m_src;
+    const llvm::BasicBlock *m_dst;
+    // block wrapper unique identifier (unique within a function, 0
+    // is reserved for the empty wrapper)
     std::size_t m_id;
   };
   
@@ -119,7 +147,7 @@ namespace crab {
       namespace indexed_string_impl {
         // To print variable names
         template<> inline std::string get_str(const llvm::Value *v) 
-        {return v->getName().str();}
+        {return clam::getValueName(*v);}
       } 
     }
   }
@@ -143,8 +171,170 @@ namespace clam {
        
        typedef variable_factory_t::varname_t varname_t;
        typedef variable_factory_t::const_var_range const_var_range;
+       typedef unsigned long index_t;
+       
+       // A function scope names the instructions and blocks of a
+       // function. Its names are dropped with the scope instead of
+       // living as long as the module factory. It shares the lock of
+       // the module factory.
+       class function_scope: public variable_factory_t {
+	 llvm_variable_factory &m_parent;
+       public:
+	 function_scope(llvm_variable_factory &parent, index_t start_id)
+	   : variable_factory_t(start_id), m_parent(parent) {}
+
+	 varname_t operator[](const llvm::Value *v) {
+	   auto lock = m_parent.lock();
+	   return variable_factory_t::operator[](v);
+	 }
+
+	 varname_t get() {
+	   auto lock = m_parent.lock();
+	   return variable_factory_t::get();
+	 }
+
+	 varname_t get(index_t key) {
+	   auto lock = m_parent.lock();
+	   return variable_factory_t::get(key);
+	 }
+       };
+       typedef std::shared_ptr<function_scope> scope_ptr;
        
-       llvm_variable_factory(): variable_factory_t() {}
+       llvm_variable_factory()
+	 : variable_factory_t(), m_thread_safe(false), m_next_scope(1) {}
+
+       // If enabled then all the methods used to create new variable
+       // names can be called concurrently.
+       void set_thread_safe(bool v) { m_thread_safe = v; }
+
+       bool is_thread_safe() const { return m_thread_safe; }
+       
+       // Open the scope of f. While it is open the instructions and
+       // blocks of f are named by the scope. Otherwise they are named,
+       // as f itself and its arguments, by the module scope of f,
+       // which lives until erase(f). The globals, the constants and
+       // the variables created by get() are named by the module
+       // factory. The indexes of a scope do not overlap with those of
+       // the module factory or of any other scope so names of
+       // different scopes can be in the same abstract state (e.g.,
+       // inter-procedural analysis).
+       scope_ptr open_scope(const llvm::Function &f) {
+	 auto l = lock();
+	 scope_ptr &s = m_scopes[&f];
+	 if (!s) {
+	   s = std::make_shared<function_scope>(*this, m_next_scope++ * SCOPE_SIZE);
+	 }
+	 return s;
+       }
+
+       // Close the scope s of f. The names of s are freed once the
+       // last owner of s is gone.
+       void close_scope(const llvm::Function &f, const scope_ptr &s) {
+	 auto l = lock();
+	 auto it = m_scopes.find(&f);
+	 if (it != m_scopes.end() && it->second == s) {
+	   m_scopes.erase(it);
+	 }
+       }
+
+       // Drop the names of f, of its arguments, instructions and
+       // blocks. It must be called before f is erased (e.g., when it
+       // is replaced by linking a new definition) since the addresses
+       // of its values can be reused by new values.
+       void erase(const llvm::Function &f) {
+	 auto l = lock();
+	 m_scopes.erase(&f);
+	 m_module_scopes.erase(&f);
+       }
+
+       size_t num_open_scopes() const {
+	 auto l = lock();
+	 return m_scopes.size();
+       }
+       
+       varname_t operator[](const llvm::Value *v) {
+	 auto l = lock();
+	 return lookup(v);
+       }
+
+       // Crab creates names (e.g., the ghost variables of a domain)
+       // through the factory of an existing name, which is this one
+       // or a scope, so the creation hooks of the base class are
+       // also overridden to take the lock.
+       varname_t get() {
+	 auto l = lock();
+	 return variable_factory_t::get();
+       }
+
+       varname_t get(index_t key) {
+	 auto l = lock();
+	 return variable_factory_t::get(key);
+       }
+
+       template<typename... Args>
+       varname_t get(Args&&... args) {
+	 auto l = lock();
+	 return variable_factory_t::get(std::forward<Args>(args)...);
+       }
+
+       // The lock of the factory and of its scopes. It is only taken
+       // if the factory is thread-safe.
+       std::unique_lock<std::mutex> lock() const {
+	 std::unique_lock<std::mutex> l(m_mutex, std::defer_lock);
+	 if (m_thread_safe) {
+	   l.lock();
+	 }
+	 return l;
+       }
+       
+     private:
+       // number of indexes reserved for the module factory and for
+       // each scope
+       static const index_t SCOPE_SIZE = index_t(1) << 40;
+       
+       bool m_thread_safe;
+       mutable std::mutex m_mutex;
+       std::unordered_map<const llvm::Function*, scope_ptr> m_scopes;
+       std::unordered_map<const llvm::Function*, scope_ptr> m_module_scopes;
+       index_t m_next_scope;
+
+       static const llvm::Function *get_scope_function(const llvm::Value *v) {
+	 if (const llvm::Instruction *I = llvm::dyn_cast<llvm::Instruction>(v)) {
+	   return I->getParent()->getParent();
+	 } else if (const llvm::BasicBlock *B = llvm::dyn_cast<llvm::BasicBlock>(v)) {
+	   return B->getParent();
+	 } else {
+	   return nullptr;
+	 }
+       }
+
+       // the lock is already held
+       function_scope &get_module_scope(const llvm::Function &f) {
+	 scope_ptr &s = m_module_scopes[&f];
+	 if (!s) {
+	   s = std::make_shared<function_scope>(*this, m_next_scope++ * SCOPE_SIZE);
+	 }
+	 return *s;
+       }
+
+       varname_t lookup(const llvm::Value *v) {
+	 // -- the lock is already held
+	 if (const llvm::Function *f = get_scope_function(v)) {
+	   auto it = m_scopes.find(f);
+	   if (it != m_scopes.end()) {
+	     return it->second->variable_factory_t::operator[](v);
+	   }
+	   return get_module_scope(*f).variable_factory_t::operator[](v);
+	 }
+	 const llvm::Function *f = llvm::dyn_cast<llvm::Function>(v);
+	 if (const llvm::Argument *a = llvm::dyn_cast<llvm::Argument>(v)) {
+	   f = a->getParent();
+	 }
+	 if (f) {
+	   return get_module_scope(*f).variable_factory_t::operator[](v);
+	 }
+	 return variable_factory_t::operator[](v);
+       }
      };
   
      typedef llvm_variable_factory variable_factory_t;
@@ -200,20 +390,62 @@ namespace crab {
   }
 }
 
+namespace clam {
+  /*
+   * A crab_os that writes directly into a llvm::raw_ostream so that
+   * crab objects can be printed without building a string first. The
+   * raw_ostream does the buffering. If single_line then newlines are
+   * printed as spaces.
+   */
+  class crab_raw_os: public crab::crab_os {
+    class raw_buf: public std::streambuf {
+      llvm::raw_ostream &m_o;
+      bool m_single_line;
+    public:
+      raw_buf(llvm::raw_ostream &o, bool single_line)
+	: m_o(o), m_single_line(single_line) {}
+    protected:
+      int_type overflow(int_type c) override {
+	if (!traits_type::eq_int_type(c, traits_type::eof())) {
+	  char ch = traits_type::to_char_type(c);
+	  m_o << ((m_single_line && ch == '\n') ? ' ' : ch);
+	}
+	return traits_type::not_eof(c);
+      }
+      std::streamsize xsputn(const char *s, std::streamsize n) override {
+	if (!m_single_line) {
+	  m_o.write(s, n);
+	} else {
+	  for (std::streamsize i = 0; i < n; ++i) {
+	    m_o << (s[i] == '\n' ? ' ' : s[i]);
+	  }
+	}
+	return n;
+      }
+    };
+    
+    raw_buf m_buf;
+    std::ostream m_stream;
+    
+  public:
+    // the base only keeps the address of m_stream
+    crab_raw_os(llvm::raw_ostream &o, bool single_line = false)
+      : crab::crab_os(&m_stream), m_buf(o, single_line), m_stream(&m_buf) {}
+  };
+}
+
 namespace {
   inline llvm::raw_ostream& operator<<(llvm::raw_ostream& o, 
 				       const clam::cfg_t& cfg) {
-    crab::crab_string_os s;
+    clam::crab_raw_os s(o);
     s << cfg;
-    o << s.str ();
     return o;
   }
 
   inline llvm::raw_ostream& operator<<(llvm::raw_ostream& o, 
 				       clam::cfg_ref_t cfg) {
-    crab::crab_string_os s;
+    clam::crab_raw_os s(o);
     s << cfg;
-    o << s.str ();
     return o;
   }
 }
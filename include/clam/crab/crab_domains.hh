@@ -18,6 +18,7 @@
 #include "crab/domains/flat_boolean_domain.hpp"
 #include "crab/domains/combined_domains.hpp"
 #include "crab/domains/wrapped_interval_domain.hpp"
+#include "clam/crab/dense_intervals.hh"
 
 /*
    Definition of the abstract domains (no instantiation done here)
@@ -34,9 +35,12 @@ namespace clam {
     /* options for array smashing */  
     enum { is_smashable = 1 };
     enum { smash_at_nonzero_offset = 1};
-    enum { max_smashable_cells = 64};
+    /* The limits are set by Clam before analyzing each function
+       (see AnalysisParams::array_max_smashable_cells and
+       array_max_size) so each thread has its own copy. */
+    static thread_local unsigned max_smashable_cells;
     /* options for array expansion */  
-    enum { max_array_size = 512 };
+    static thread_local unsigned max_array_size;
   };
   template<class Dom>
   using array_domain = array_adaptive_domain<Dom, ArrayAdaptParams>;
@@ -63,6 +67,8 @@ namespace clam {
   
   /// -- Intervals
   typedef interval_domain<number_t, varname_t> BASE(interval_domain_t);
+  /// -- Intervals with vectorized join, meet, widening and inclusion
+  typedef dense_interval_domain<BASE(interval_domain_t)> BASE(dense_interval_domain_t);
   /// -- Wrapped interval domain (APLAS'12)
   typedef wrapped_interval_domain<number_t, varname_t> BASE(wrapped_interval_domain_t);
   /// To choose DBM parameters
@@ -93,15 +99,30 @@ namespace clam {
     typedef int64_t Wt;
     typedef crab::AdaptGraph<Wt> graph_t;
   };
+  struct DenseFastDBMParams{
+    /* As FastDBMParams but the weights are stored in a dense matrix:
+       the closure and the join of dense DBMs visit contiguous rows
+       instead of the edge maps of AdaptGraph */
+    enum { chrome_dijkstra = 1 };
+    enum { widen_restabilize = 1 };
+    enum { special_assign = 1 };
+    enum { close_bounds_inline = 0 };	 
+    typedef int64_t Wt;
+    typedef crab::SparseWtGraph<Wt> graph_t;
+  };
   /// -- Zones using sparse DBMs in split normal form (SAS'16)
 #ifdef USE_DBM_BIGNUM
   typedef SplitDBM<number_t, varname_t, BigNumDBMParams> BASE(split_dbm_domain_t);
 #else
 #ifdef USE_DBM_SAFEINT
   typedef SplitDBM<number_t, varname_t, SafeFastDBMParams> BASE(split_dbm_domain_t);
+#else
+#ifdef USE_DBM_DENSE
+  typedef SplitDBM<number_t, varname_t, DenseFastDBMParams> BASE(split_dbm_domain_t);
 #else
   typedef SplitDBM<number_t, varname_t, FastDBMParams> BASE(split_dbm_domain_t);
 #endif
+#endif
 #endif 
   /// -- Boxes
   typedef boxes_domain<number_t, varname_t> BASE(boxes_domain_t);
@@ -125,11 +146,24 @@ namespace clam {
   /// -- Term functor domain with Intervals (VMCAI'16)
   typedef crab::cfg::var_factory_impl::str_var_alloc_col::varname_t str_varname_t;
   typedef interval_domain<number_t, str_varname_t> str_interval_dom_t;
+  typedef dis_interval_domain<number_t, str_varname_t> str_dis_interval_dom_t;
+  /// The variables of the term graph get integer names allocated by
+  /// index instead of strings
+  typedef crab::cfg::var_factory_impl::int_var_alloc_col::varname_t int_varname_t;
+  typedef interval_domain<number_t, int_varname_t> int_interval_dom_t;
+  typedef dis_interval_domain<number_t, int_varname_t> int_dis_interval_dom_t;
+#ifdef USE_TERM_INT_VARNAMES
+  typedef term::TDomInfo<number_t, varname_t, int_interval_dom_t> idom_info;
+#else
   typedef term::TDomInfo<number_t, varname_t, str_interval_dom_t> idom_info;
+#endif
   typedef term_domain<idom_info> BASE(term_int_domain_t);
   /// -- Term functor domain with DisIntervals (VMCAI'16)
-  typedef dis_interval_domain<number_t, str_varname_t> str_dis_interval_dom_t;
+#ifdef USE_TERM_INT_VARNAMES
+  typedef term::TDomInfo<number_t, varname_t, int_dis_interval_dom_t> dis_idom_info;
+#else
   typedef term::TDomInfo<number_t, varname_t, str_dis_interval_dom_t> dis_idom_info;
+#endif
   typedef term_domain<dis_idom_info> BASE(term_dis_int_domain_t);
   /// -- Reduced product of Term(DisIntervals) with split zones
   typedef reduced_numerical_domain_product2<BASE(term_dis_int_domain_t),
@@ -137,6 +171,7 @@ namespace clam {
 					    reduced_product_impl::term_dbm_params> BASE(num_domain_t);
 
   ARRAY_BOOL_NUM(interval_domain_t);
+  ARRAY_BOOL_NUM(dense_interval_domain_t);
   ARRAY_BOOL_NUM(split_dbm_domain_t);
   ARRAY_BOOL_NUM(dis_interval_domain_t);
   ARRAY_BOOL_NUM(oct_domain_t);
@@ -0,0 +1,920 @@
+#pragma once
+
+/*
+ * dense_interval_domain<Base> is the interval domain Base whose state
+ * is stored in two flat int64_t arrays, the lower and the upper
+ * bounds, indexed by a dense index of the variables that is shared by
+ * all the states (dense_intervals_impl::var_index). A state covers a
+ * window [offset, offset + size) of the indexes and the variables
+ * outside its window are unconstrained.
+ *
+ * Join, meet, widening and inclusion are branch-free loops over the
+ * overlap of the windows of both states that the compiler vectorizes.
+ * Forget, project, assignments, additions, subtractions and
+ * multiplications and the additions of linear constraints are also
+ * done on the arrays. The constraints are propagated one at a time
+ * until no bound changes (at most MAX_ROUNDS rounds) so the result
+ * can be less precise than the solver of Base on a system of
+ * constraints.
+ *
+ * The infinities are INT64_MIN and INT64_MAX. If a finite bound, or
+ * an intermediate result, does not fit strictly between them the
+ * state moves to Base, which computes with unlimited integers, and so
+ * it does for the other operations (division, bitwise, conversions,
+ * backward and array operations, narrowing and widening with
+ * thresholds). The state moves back to the arrays as soon as all its
+ * bounds fit.
+ *
+ * It exists to compare against the intervals of crab
+ * (--crab-dom=dense-int vs --crab-dom=int).
+ */
+
+#include "clam/crab/crab_cfg.hh"
+#include "crab/domains/intervals.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace clam {
+
+namespace dense_intervals_impl {
+
+  static const int64_t MINUS_INF = INT64_MIN;
+  static const int64_t PLUS_INF = INT64_MAX;
+
+  // rounds of propagation of a system of constraints
+  static const unsigned MAX_ROUNDS = 10;
+
+  // The dense index of each variable. The indexes are given in order
+  // of first use and never reused so the variables of a function,
+  // which are created together, have close indexes.
+  class var_index {
+    std::mutex m_mutex;
+    std::unordered_map<uint64_t, size_t> m_index;
+    std::vector<var_t> m_vars;
+
+  public:
+    static var_index &get() {
+      static var_index index;
+      return index;
+    }
+
+    size_t index(const var_t &v) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto res = m_index.insert(std::make_pair((uint64_t) v.index(), m_vars.size()));
+      if (res.second) {
+	m_vars.push_back(v);
+      }
+      return res.first->second;
+    }
+
+    var_t var(size_t i) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_vars[i];
+    }
+  };
+
+  // Return false if n does not fit strictly between the infinities
+  inline bool to_int64(const number_t &n, int64_t &out) {
+    if (!n.fits_slong()) {
+      return false;
+    }
+    long v = (long) n;
+    if (v <= MINUS_INF || v >= PLUS_INF) {
+      return false;
+    }
+    out = v;
+    return true;
+  }
+
+  template<typename Bound>
+  inline bool to_int64(const Bound &b, int64_t inf, int64_t &out) {
+    if (!b.is_finite()) {
+      out = inf;
+      return true;
+    }
+    return to_int64(*(b.number()), out);
+  }
+
+  template<typename Bound>
+  inline Bound to_bound(int64_t v) {
+    if (v == MINUS_INF) return Bound::minus_infinity();
+    if (v == PLUS_INF) return Bound::plus_infinity();
+    return Bound(number_t(v));
+  }
+
+  /* Arithmetic on bounds. They return false if a finite result does
+     not fit strictly between the infinities. */
+
+  inline int64_t neg(int64_t a) {
+    if (a == MINUS_INF) return PLUS_INF;
+    if (a == PLUS_INF) return MINUS_INF;
+    return -a;
+  }
+
+  // a + b where a and b are both lower bounds (inf is MINUS_INF) or
+  // both upper bounds (inf is PLUS_INF)
+  inline bool add(int64_t a, int64_t b, int64_t inf, int64_t &out) {
+    if (a == inf || b == inf) {
+      out = inf;
+      return true;
+    }
+    int64_t r;
+    if (__builtin_add_overflow(a, b, &r) || r == MINUS_INF || r == PLUS_INF) {
+      return false;
+    }
+    out = r;
+    return true;
+  }
+
+  inline bool mul(int64_t a, int64_t b, int64_t &out) {
+    if (a == 0 || b == 0) {
+      out = 0;
+      return true;
+    }
+    if (a == MINUS_INF || a == PLUS_INF || b == MINUS_INF || b == PLUS_INF) {
+      out = ((a < 0) != (b < 0)) ? MINUS_INF : PLUS_INF;
+      return true;
+    }
+    int64_t r;
+    if (__builtin_mul_overflow(a, b, &r) || r == MINUS_INF || r == PLUS_INF) {
+      return false;
+    }
+    out = r;
+    return true;
+  }
+
+  // [l1,u1] * [l2,u2]
+  inline bool mul(int64_t l1, int64_t u1, int64_t l2, int64_t u2,
+		  int64_t &lb, int64_t &ub) {
+    int64_t p[4];
+    if (!mul(l1, l2, p[0]) || !mul(l1, u2, p[1]) ||
+	!mul(u1, l2, p[2]) || !mul(u1, u2, p[3])) {
+      return false;
+    }
+    lb = *std::min_element(p, p + 4);
+    ub = *std::max_element(p, p + 4);
+    return true;
+  }
+
+  // floor(a / c) and ceil(a / c) for a finite and c != 0
+  inline int64_t div_floor(int64_t a, int64_t c) {
+    int64_t q = a / c;
+    return (a % c != 0 && ((a < 0) != (c < 0))) ? q - 1 : q;
+  }
+
+  inline int64_t div_ceil(int64_t a, int64_t c) {
+    int64_t q = a / c;
+    return (a % c != 0 && ((a < 0) == (c < 0))) ? q + 1 : q;
+  }
+
+  /* The kernels: the result is left in lb1 and ub1 */
+
+  inline void join(int64_t *lb1, int64_t *ub1,
+		   const int64_t *lb2, const int64_t *ub2, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      lb1[i] = std::min(lb1[i], lb2[i]);
+      ub1[i] = std::max(ub1[i], ub2[i]);
+    }
+  }
+
+  // Return false if the meet is bottom
+  inline bool meet(int64_t *lb1, int64_t *ub1,
+		   const int64_t *lb2, const int64_t *ub2, size_t n) {
+    unsigned empty = 0;
+    for (size_t i = 0; i < n; ++i) {
+      lb1[i] = std::max(lb1[i], lb2[i]);
+      ub1[i] = std::min(ub1[i], ub2[i]);
+      empty |= (lb1[i] > ub1[i]);
+    }
+    return !empty;
+  }
+
+  inline void widen(int64_t *lb1, int64_t *ub1,
+		    const int64_t *lb2, const int64_t *ub2, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      lb1[i] = lb2[i] < lb1[i] ? MINUS_INF : lb1[i];
+      ub1[i] = ub2[i] > ub1[i] ? PLUS_INF : ub1[i];
+    }
+  }
+
+  inline bool leq(const int64_t *lb1, const int64_t *ub1,
+		  const int64_t *lb2, const int64_t *ub2, size_t n) {
+    unsigned out = 0;
+    for (size_t i = 0; i < n; ++i) {
+      out |= (lb1[i] < lb2[i]) | (ub1[i] > ub2[i]);
+    }
+    return !out;
+  }
+
+  inline bool all_top(const int64_t *lb, const int64_t *ub, size_t n) {
+    unsigned out = 0;
+    for (size_t i = 0; i < n; ++i) {
+      out |= (lb[i] != MINUS_INF) | (ub[i] != PLUS_INF);
+    }
+    return !out;
+  }
+
+  // A linear constraint over dense indexes: sum(a_i x_i) + b <= 0,
+  // or sum(a_i x_i) + b != 0 if is_diseq.
+  struct dense_cst_t {
+    bool is_diseq;
+    int64_t b;
+    std::vector<std::pair<size_t, int64_t>> terms;
+  };
+
+} // end namespace dense_intervals_impl
+
+template<typename Base>
+class dense_interval_domain: public Base {
+  typedef dense_interval_domain<Base> this_type;
+  typedef typename Base::interval_t interval_t;
+  typedef ikos::bound<number_t> bound_t;
+  typedef dense_intervals_impl::dense_cst_t dense_cst_t;
+
+  // If m_dense the state is in the arrays (and Base is top),
+  // otherwise it is in Base.
+  bool m_dense;
+  bool m_is_bottom;
+  size_t m_off;
+  std::vector<int64_t> m_lb;
+  std::vector<int64_t> m_ub;
+
+  static size_t index(const var_t &v) {
+    return dense_intervals_impl::var_index::get().index(v);
+  }
+
+  size_t win_end() const { return m_off + m_lb.size(); }
+
+  bool is_top_at(size_t k) const {
+    return m_lb[k] == dense_intervals_impl::MINUS_INF &&
+      m_ub[k] == dense_intervals_impl::PLUS_INF;
+  }
+
+  void get(size_t i, int64_t &lb, int64_t &ub) const {
+    if (i < m_off || i >= win_end()) {
+      lb = dense_intervals_impl::MINUS_INF;
+      ub = dense_intervals_impl::PLUS_INF;
+    } else {
+      lb = m_lb[i - m_off];
+      ub = m_ub[i - m_off];
+    }
+  }
+
+  // Set the bounds of the variable of index i, growing the window if
+  // needed
+  void put(size_t i, int64_t lb, int64_t ub) {
+    using namespace dense_intervals_impl;
+    if (lb > ub) {
+      make_bottom();
+      return;
+    }
+    bool top = (lb == MINUS_INF && ub == PLUS_INF);
+    if (m_lb.empty()) {
+      if (top) return;
+      m_off = i;
+      m_lb.push_back(lb);
+      m_ub.push_back(ub);
+      return;
+    }
+    if (i < m_off) {
+      if (top) return;
+      m_lb.insert(m_lb.begin(), m_off - i, MINUS_INF);
+      m_ub.insert(m_ub.begin(), m_off - i, PLUS_INF);
+      m_off = i;
+    } else if (i >= win_end()) {
+      if (top) return;
+      m_lb.resize(i - m_off + 1, MINUS_INF);
+      m_ub.resize(i - m_off + 1, PLUS_INF);
+    }
+    m_lb[i - m_off] = lb;
+    m_ub[i - m_off] = ub;
+  }
+
+  // Remove the unconstrained variables at both ends of the window
+  void trim() {
+    size_t first = 0, last = m_lb.size();
+    while (first < last && is_top_at(first)) ++first;
+    while (last > first && is_top_at(last - 1)) --last;
+    if (first == last) {
+      m_lb.clear();
+      m_ub.clear();
+      m_off = 0;
+      return;
+    }
+    m_lb.erase(m_lb.begin() + last, m_lb.end());
+    m_ub.erase(m_ub.begin() + last, m_ub.end());
+    m_lb.erase(m_lb.begin(), m_lb.begin() + first);
+    m_ub.erase(m_ub.begin(), m_ub.begin() + first);
+    m_off += first;
+  }
+
+  void make_bottom() {
+    m_dense = true;
+    m_is_bottom = true;
+    m_off = 0;
+    m_lb.clear();
+    m_ub.clear();
+  }
+
+  // Return the state as a state of Base
+  Base to_base() const {
+    if (!m_dense) {
+      return Base(*this);
+    }
+    if (m_is_bottom) {
+      return Base::bottom();
+    }
+    using namespace dense_intervals_impl;
+    Base res = Base::top();
+    var_index &vars = var_index::get();
+    for (size_t k = 0; k < m_lb.size(); ++k) {
+      if (!is_top_at(k)) {
+	res.set(vars.var(m_off + k), interval_t(to_bound<bound_t>(m_lb[k]),
+						to_bound<bound_t>(m_ub[k])));
+      }
+    }
+    return res;
+  }
+
+  // Move the state to Base
+  void to_map() {
+    if (m_dense) {
+      Base::operator=(to_base());
+      m_dense = false;
+      m_is_bottom = false;
+      m_off = 0;
+      m_lb.clear();
+      m_ub.clear();
+    }
+  }
+
+  // Move the state to the arrays if all its bounds fit
+  void from_map() {
+    using namespace dense_intervals_impl;
+    if (m_dense) {
+      return;
+    }
+    if (Base::is_bottom()) {
+      make_bottom();
+      Base::operator=(Base::top());
+      return;
+    }
+    Base s(*this);
+    std::vector<std::pair<size_t, std::pair<int64_t, int64_t>>> elems;
+    size_t lo = SIZE_MAX, hi = 0;
+    for (auto it = s.begin(), et = s.end(); it != et; ++it) {
+      int64_t lb, ub;
+      if (!to_int64(it->second.lb(), MINUS_INF, lb) ||
+	  !to_int64(it->second.ub(), PLUS_INF, ub)) {
+	return;
+      }
+      size_t i = index(it->first);
+      lo = std::min(lo, i);
+      hi = std::max(hi, i + 1);
+      elems.push_back(std::make_pair(i, std::make_pair(lb, ub)));
+    }
+    m_dense = true;
+    m_is_bottom = false;
+    m_off = 0;
+    m_lb.clear();
+    m_ub.clear();
+    if (!elems.empty()) {
+      m_off = lo;
+      m_lb.assign(hi - lo, MINUS_INF);
+      m_ub.assign(hi - lo, PLUS_INF);
+      for (auto const &e: elems) {
+	m_lb[e.first - lo] = e.second.first;
+	m_ub[e.first - lo] = e.second.second;
+      }
+      trim();
+    }
+    Base::operator=(Base::top());
+  }
+
+  // Run an operation of Base on the state and move the result back to
+  // the arrays
+  class map_scope {
+    this_type &m_dom;
+  public:
+    map_scope(this_type &dom): m_dom(dom) { m_dom.to_map(); }
+    ~map_scope() { m_dom.from_map(); }
+  };
+
+  static bool is_bottom_of(const this_type &o) {
+    if (o.m_dense) {
+      return o.m_is_bottom;
+    }
+    Base b(o);
+    return b.is_bottom();
+  }
+
+  bool leq_dense(const this_type &o) const {
+    using namespace dense_intervals_impl;
+    size_t lo = std::max(m_off, o.m_off), hi = std::min(win_end(), o.win_end());
+    if (lo >= hi) {
+      return all_top(o.m_lb.data(), o.m_ub.data(), o.m_lb.size());
+    }
+    // outside the window of this the variables of o must be
+    // unconstrained
+    size_t before = lo - o.m_off, after = hi - o.m_off;
+    return all_top(o.m_lb.data(), o.m_ub.data(), before) &&
+      all_top(o.m_lb.data() + after, o.m_ub.data() + after, o.m_lb.size() - after) &&
+      leq(m_lb.data() + (lo - m_off), m_ub.data() + (lo - m_off),
+	  o.m_lb.data() + before, o.m_ub.data() + before, hi - lo);
+  }
+
+  // Join or widening: the result is unconstrained outside the overlap
+  // of the windows
+  template<typename Kernel>
+  this_type overlap_op(const this_type &o, Kernel kernel) const {
+    this_type res;
+    size_t lo = std::max(m_off, o.m_off), hi = std::min(win_end(), o.win_end());
+    if (lo < hi) {
+      res.m_off = lo;
+      res.m_lb.assign(m_lb.begin() + (lo - m_off), m_lb.begin() + (hi - m_off));
+      res.m_ub.assign(m_ub.begin() + (lo - m_off), m_ub.begin() + (hi - m_off));
+      kernel(res.m_lb.data(), res.m_ub.data(),
+	     o.m_lb.data() + (lo - o.m_off), o.m_ub.data() + (lo - o.m_off), hi - lo);
+      res.trim();
+    }
+    return res;
+  }
+
+  this_type meet_dense(const this_type &o) const {
+    using namespace dense_intervals_impl;
+    if (m_lb.empty()) return o;
+    if (o.m_lb.empty()) return *this;
+    size_t lo = std::min(m_off, o.m_off), hi = std::max(win_end(), o.win_end());
+    this_type res;
+    res.m_off = lo;
+    res.m_lb.assign(hi - lo, MINUS_INF);
+    res.m_ub.assign(hi - lo, PLUS_INF);
+    std::copy(m_lb.begin(), m_lb.end(), res.m_lb.begin() + (m_off - lo));
+    std::copy(m_ub.begin(), m_ub.end(), res.m_ub.begin() + (m_off - lo));
+    if (!meet(res.m_lb.data() + (o.m_off - lo), res.m_ub.data() + (o.m_off - lo),
+	      o.m_lb.data(), o.m_ub.data(), o.m_lb.size())) {
+      return bottom();
+    }
+    return res;
+  }
+
+  /* The operations on the arrays. They return false if they must be
+     done by Base. */
+
+  bool assign_dense(const var_t &x, const lin_exp_t &e) {
+    using namespace dense_intervals_impl;
+    int64_t lb, ub;
+    if (!to_int64(e.constant(), lb)) {
+      return false;
+    }
+    ub = lb;
+    for (auto const &t: e) {
+      int64_t c, l, u, cl, cu;
+      if (!to_int64(t.first, c)) {
+	return false;
+      }
+      get(index(t.second), l, u);
+      if (!(c >= 0 ? mul(c, l, cl) && mul(c, u, cu) : mul(c, u, cl) && mul(c, l, cu)) ||
+	  !add(lb, cl, MINUS_INF, lb) || !add(ub, cu, PLUS_INF, ub)) {
+	return false;
+      }
+    }
+    put(index(x), lb, ub);
+    return true;
+  }
+
+  template<typename... Args>
+  bool assign_dense(const Args&...) { return false; }
+
+  bool apply_interval(crab::domains::arith_operation_t op, const var_t &x,
+		      int64_t l1, int64_t u1, int64_t l2, int64_t u2) {
+    using namespace dense_intervals_impl;
+    int64_t lb, ub;
+    switch (op) {
+    case crab::domains::OP_ADDITION:
+      if (!add(l1, l2, MINUS_INF, lb) || !add(u1, u2, PLUS_INF, ub)) return false;
+      break;
+    case crab::domains::OP_SUBTRACTION:
+      if (!add(l1, neg(u2), MINUS_INF, lb) || !add(u1, neg(l2), PLUS_INF, ub)) return false;
+      break;
+    case crab::domains::OP_MULTIPLICATION:
+      if (!mul(l1, u1, l2, u2, lb, ub)) return false;
+      break;
+    default:
+      return false;
+    }
+    put(index(x), lb, ub);
+    return true;
+  }
+
+  bool apply_dense(crab::domains::arith_operation_t op,
+		   const var_t &x, const var_t &y, const var_t &z) {
+    int64_t l1, u1, l2, u2;
+    get(index(y), l1, u1);
+    get(index(z), l2, u2);
+    return apply_interval(op, x, l1, u1, l2, u2);
+  }
+
+  bool apply_dense(crab::domains::arith_operation_t op,
+		   const var_t &x, const var_t &y, const number_t &k) {
+    int64_t l1, u1, c;
+    if (!dense_intervals_impl::to_int64(k, c)) {
+      return false;
+    }
+    get(index(y), l1, u1);
+    return apply_interval(op, x, l1, u1, c, c);
+  }
+
+  template<typename... Args>
+  bool apply_dense(const Args&...) { return false; }
+
+  // Add to csts the constraint sign * e + offset <= 0 (or != 0)
+  static bool to_dense_cst(const lin_exp_t &e, int64_t sign, int64_t offset,
+			   bool is_diseq, std::vector<dense_cst_t> &csts) {
+    using namespace dense_intervals_impl;
+    dense_cst_t cst;
+    cst.is_diseq = is_diseq;
+    if (!to_int64(e.constant(), cst.b) ||
+	!add(sign * cst.b, offset, PLUS_INF, cst.b)) {
+      return false;
+    }
+    for (auto const &t: e) {
+      int64_t c;
+      if (!to_int64(t.first, c)) {
+	return false;
+      }
+      if (c != 0) {
+	cst.terms.push_back(std::make_pair(index(t.second), sign * c));
+      }
+    }
+    csts.push_back(cst);
+    return true;
+  }
+
+  // Tighten the bounds of the variables of cst. Return false if an
+  // intermediate result does not fit.
+  bool propagate(const dense_cst_t &cst, bool &changed) {
+    using namespace dense_intervals_impl;
+    if (cst.is_diseq) {
+      // only a x + b != 0 can cut a bound of x
+      if (cst.terms.size() != 1 || cst.b % cst.terms[0].second != 0) {
+	return true;
+      }
+      int64_t v = -cst.b / cst.terms[0].second, l, u;
+      size_t i = cst.terms[0].first;
+      get(i, l, u);
+      if (l == v && u == v) {
+	make_bottom();
+      } else if (l == v || u == v) {
+	if (v + 1 == PLUS_INF || v - 1 == MINUS_INF) return false;
+	put(i, l == v ? v + 1 : l, u == v ? v - 1 : u);
+	changed = true;
+      }
+      return true;
+    }
+    // sum, without the infinite ones, of the lower bounds of the terms
+    int64_t sum = cst.b;
+    unsigned num_inf = 0;
+    size_t inf_k = 0;
+    std::vector<int64_t> los(cst.terms.size());
+    for (size_t k = 0; k < cst.terms.size(); ++k) {
+      int64_t l, u, c = cst.terms[k].second;
+      get(cst.terms[k].first, l, u);
+      if (!mul(c, c > 0 ? l : u, los[k])) {
+	return false;
+      }
+      if (los[k] == MINUS_INF) {
+	++num_inf;
+	inf_k = k;
+      } else if (!add(sum, los[k], MINUS_INF, sum)) {
+	return false;
+      }
+    }
+    if (num_inf == 0 && cst.terms.empty()) {
+      if (sum > 0) make_bottom();
+      return true;
+    }
+    if (num_inf > 1) {
+      return true;
+    }
+    for (size_t k = 0; k < cst.terms.size(); ++k) {
+      if (num_inf == 1 && k != inf_k) {
+	continue;
+      }
+      // c x <= -(sum - lo of the term)
+      int64_t rest = sum, c = cst.terms[k].second, l, u;
+      if (num_inf == 0 && !add(rest, -los[k], MINUS_INF, rest)) {
+	return false;
+      }
+      int64_t rhs = -rest;
+      get(cst.terms[k].first, l, u);
+      if (c > 0) {
+	int64_t nu = div_floor(rhs, c);
+	if (nu >= u) continue;
+	u = nu;
+      } else {
+	int64_t nl = div_ceil(rhs, c);
+	if (nl <= l) continue;
+	l = nl;
+      }
+      put(cst.terms[k].first, l, u);
+      changed = true;
+      if (m_is_bottom) {
+	return true;
+      }
+    }
+    return true;
+  }
+
+  template<typename Constraints>
+  bool add_constraints_dense(const Constraints &in) {
+    std::vector<dense_cst_t> csts;
+    for (auto const &cst: in) {
+      if (cst.is_tautology()) {
+	continue;
+      }
+      if (cst.is_contradiction()) {
+	make_bottom();
+	return true;
+      }
+      const lin_exp_t &e = cst.expression();
+      bool ok;
+      if (cst.is_inequality()) {
+	ok = to_dense_cst(e, 1, 0, false, csts);
+      } else if (cst.is_strict_inequality()) {
+	// e < 0 is e + 1 <= 0 over the integers
+	ok = to_dense_cst(e, 1, 1, false, csts);
+      } else if (cst.is_equality()) {
+	ok = to_dense_cst(e, 1, 0, false, csts) && to_dense_cst(e, -1, 0, false, csts);
+      } else if (cst.is_disequation()) {
+	ok = to_dense_cst(e, 1, 0, true, csts);
+      } else {
+	ok = false;
+      }
+      if (!ok) {
+	return false;
+      }
+    }
+    // If a result does not fit the constraints are added again by
+    // Base to the bounds tightened so far, which is sound.
+    bool changed = true;
+    for (unsigned r = 0; r < dense_intervals_impl::MAX_ROUNDS && changed; ++r) {
+      changed = false;
+      for (auto const &cst: csts) {
+	if (!propagate(cst, changed)) {
+	  return false;
+	}
+	if (m_is_bottom) {
+	  return true;
+	}
+      }
+    }
+    return true;
+  }
+
+  bool add_dense(const lin_cst_t &cst) {
+    return add_constraints_dense(std::vector<lin_cst_t>(1, cst));
+  }
+
+  bool add_dense(const lin_cst_sys_t &csts) {
+    return add_constraints_dense(csts);
+  }
+
+  template<typename... Args>
+  bool add_dense(const Args&...) { return false; }
+
+public:
+  dense_interval_domain()
+    : Base(), m_dense(true), m_is_bottom(false), m_off(0) {}
+
+  // implicit so that the results of the operations of Base can be
+  // used as this type
+  dense_interval_domain(const Base &dom)
+    : Base(dom), m_dense(false), m_is_bottom(false), m_off(0) {
+    from_map();
+  }
+
+  static this_type top() { return this_type(); }
+
+  static this_type bottom() {
+    this_type res;
+    res.m_is_bottom = true;
+    return res;
+  }
+
+  static std::string getDomainName() { return "DenseIntervals"; }
+
+  void set_to_top() { *this = top(); }
+
+  void set_to_bottom() { *this = bottom(); }
+
+  bool is_bottom() {
+    return m_dense ? m_is_bottom : Base::is_bottom();
+  }
+
+  bool is_top() {
+    if (!m_dense) return Base::is_top();
+    return !m_is_bottom &&
+      dense_intervals_impl::all_top(m_lb.data(), m_ub.data(), m_lb.size());
+  }
+
+  bool operator<=(const this_type &o) {
+    if (is_bottom()) return true;
+    if (is_bottom_of(o)) return false;
+    if (m_dense && o.m_dense) {
+      return leq_dense(o);
+    }
+    return to_base() <= o.to_base();
+  }
+
+  void operator|=(const this_type &o) {
+    *this = *this | o;
+  }
+
+  this_type operator|(const this_type &o) {
+    if (is_bottom()) return o;
+    if (is_bottom_of(o)) return *this;
+    if (m_dense && o.m_dense) {
+      return overlap_op(o, dense_intervals_impl::join);
+    }
+    return this_type(to_base() | o.to_base());
+  }
+
+  this_type operator&(const this_type &o) {
+    if (is_bottom() || is_bottom_of(o)) return bottom();
+    if (m_dense && o.m_dense) {
+      return meet_dense(o);
+    }
+    return this_type(to_base() & o.to_base());
+  }
+
+  this_type operator||(const this_type &o) {
+    if (is_bottom()) return o;
+    if (is_bottom_of(o)) return *this;
+    if (m_dense && o.m_dense) {
+      return overlap_op(o, dense_intervals_impl::widen);
+    }
+    return this_type(to_base() || o.to_base());
+  }
+
+  template<typename Thresholds>
+  this_type widening_thresholds(const this_type &o, const Thresholds &ts) {
+    return this_type(to_base().widening_thresholds(o.to_base(), ts));
+  }
+
+  this_type operator&&(const this_type &o) {
+    return this_type(to_base() && o.to_base());
+  }
+
+  // no-ops for intervals
+  void normalize() {}
+
+  void minimize() {}
+
+  void operator-=(const var_t &v) {
+    if (!m_dense) {
+      map_scope s(*this);
+      Base::operator-=(v);
+    } else if (!m_is_bottom) {
+      put(index(v), dense_intervals_impl::MINUS_INF, dense_intervals_impl::PLUS_INF);
+      trim();
+    }
+  }
+
+  template<typename Vars>
+  void forget(const Vars &vars) {
+    for (auto const &v: vars) {
+      *this -= v;
+    }
+  }
+
+  template<typename Vars>
+  void project(const Vars &vars) {
+    if (!m_dense) {
+      map_scope s(*this);
+      Base::project(vars);
+    } else if (!m_is_bottom) {
+      this_type res;
+      for (auto const &v: vars) {
+	int64_t lb, ub;
+	size_t i = index(v);
+	get(i, lb, ub);
+	res.put(i, lb, ub);
+      }
+      *this = res;
+    }
+  }
+
+  void set(const var_t &v, interval_t i) {
+    using namespace dense_intervals_impl;
+    int64_t lb, ub;
+    if (m_dense && (i.is_bottom() || m_is_bottom)) {
+      make_bottom();
+    } else if (m_dense && to_int64(i.lb(), MINUS_INF, lb) && to_int64(i.ub(), PLUS_INF, ub)) {
+      put(index(v), lb, ub);
+    } else {
+      map_scope s(*this);
+      Base::set(v, i);
+    }
+  }
+
+  interval_t operator[](const var_t &v) {
+    if (!m_dense) {
+      return Base::operator[](v);
+    }
+    if (m_is_bottom) {
+      return interval_t::bottom();
+    }
+    int64_t lb, ub;
+    get(index(v), lb, ub);
+    return interval_t(dense_intervals_impl::to_bound<bound_t>(lb),
+		      dense_intervals_impl::to_bound<bound_t>(ub));
+  }
+
+  template<typename... Args>
+  void assign(Args&&... args) {
+    if (m_dense && m_is_bottom) return;
+    if (!(m_dense && assign_dense(args...))) {
+      map_scope s(*this);
+      Base::assign(std::forward<Args>(args)...);
+    }
+  }
+
+  template<typename... Args>
+  void apply(Args&&... args) {
+    if (m_dense && m_is_bottom) return;
+    if (!(m_dense && apply_dense(args...))) {
+      map_scope s(*this);
+      Base::apply(std::forward<Args>(args)...);
+    }
+  }
+
+  // a linear constraint or a linear constraint system
+  template<typename Constraints>
+  void operator+=(const Constraints &csts) {
+    if (m_dense && m_is_bottom) return;
+    if (!(m_dense && add_dense(csts))) {
+      map_scope s(*this);
+      Base::operator+=(csts);
+    }
+  }
+
+  /* The other operations are those of Base */
+
+  // They update the state
+#define DENSE_INTERVALS_OP(NAME)						\
+  template<typename... Args>						\
+  auto NAME(Args&&... args)						\
+    -> decltype(std::declval<Base&>().NAME(std::forward<Args>(args)...)) { \
+    map_scope s(*this);							\
+    return Base::NAME(std::forward<Args>(args)...);			\
+  }
+
+  // They only read the state so they run on a copy in Base
+#define DENSE_INTERVALS_CONST_OP(NAME)					\
+  template<typename... Args>						\
+  auto NAME(Args&&... args)						\
+    -> decltype(std::declval<Base&>().NAME(std::forward<Args>(args)...)) { \
+    if (!m_dense) return Base::NAME(std::forward<Args>(args)...);	\
+    return to_base().NAME(std::forward<Args>(args)...);			\
+  }
+
+  DENSE_INTERVALS_OP(backward_assign)
+  DENSE_INTERVALS_OP(backward_apply)
+  DENSE_INTERVALS_OP(select)
+  DENSE_INTERVALS_OP(intrinsic)
+  DENSE_INTERVALS_OP(backward_intrinsic)
+  DENSE_INTERVALS_OP(expand)
+  DENSE_INTERVALS_OP(rename)
+  DENSE_INTERVALS_OP(assign_bool_cst)
+  DENSE_INTERVALS_OP(assign_bool_var)
+  DENSE_INTERVALS_OP(apply_binary_bool)
+  DENSE_INTERVALS_OP(assume_bool)
+  DENSE_INTERVALS_OP(backward_assign_bool_cst)
+  DENSE_INTERVALS_OP(backward_assign_bool_var)
+  DENSE_INTERVALS_OP(backward_apply_binary_bool)
+  DENSE_INTERVALS_OP(array_init)
+  DENSE_INTERVALS_OP(array_load)
+  DENSE_INTERVALS_OP(array_store)
+  DENSE_INTERVALS_OP(array_store_range)
+  DENSE_INTERVALS_OP(array_assign)
+  DENSE_INTERVALS_OP(backward_array_init)
+  DENSE_INTERVALS_OP(backward_array_load)
+  DENSE_INTERVALS_OP(backward_array_store)
+  DENSE_INTERVALS_OP(backward_array_store_range)
+  DENSE_INTERVALS_OP(backward_array_assign)
+  DENSE_INTERVALS_CONST_OP(to_linear_constraint_system)
+  DENSE_INTERVALS_CONST_OP(to_disjunctive_linear_constraint_system)
+  DENSE_INTERVALS_CONST_OP(write)
+
+#undef DENSE_INTERVALS_OP
+#undef DENSE_INTERVALS_CONST_OP
+};
+
+} // end namespace clam
@@ -0,0 +1,380 @@
+#include "AnalysisCache.hh"
+#include "ValueNumbering.hh"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "clam/Support/Debug.hh"
+
+#include <cstdlib>
+#include <sstream>
+
+/*
+ * Format of a cache entry (one item per line):
+ *
+ *   clam-cache <version>
+ *   checks <safe> <error> <warning>
+ *   check <safe|error|warning> <line> <column> <file>
+ *   pre|post <block> bottom
+ *   pre|post <block> <n>    followed by n lines, one per constraint:
+ *     <eq|ne|le|lt> <signed> <constant> <m> (<coef> <value> <type> <bitwidth>)*
+ *   edge <src block> <dst block>
+ *   end
+ *
+ * Blocks are identified by their position in the function. Values are
+ * a<n> (n-th argument), i<n> (n-th instruction) or g<name> (global).
+ */
+
+namespace clam {
+
+using namespace llvm;
+
+static const unsigned CACHE_VERSION = 2;
+
+static bool writeConstraint(const lin_cst_t &cst, const ValueNumbering &vn,
+                            raw_ostream &o) {
+  std::string kind;
+  if (cst.is_equality()) {
+    kind = "eq";
+  } else if (cst.is_disequation()) {
+    kind = "ne";
+  } else if (cst.is_strict_inequality()) {
+    kind = "lt";
+  } else if (cst.is_inequality()) {
+    kind = "le";
+  } else {
+    return false;
+  }
+
+  std::string str;
+  raw_string_ostream terms(str);
+  unsigned num_terms = 0;
+  for (auto t : cst.expression()) {
+    var_t v = t.second;
+    if (!v.name().get()) {
+      // shadow variable
+      return false;
+    }
+    std::string ref;
+    if (!vn.getRef(*(v.name().get()), ref)) {
+      return false;
+    }
+    terms << " " << t.first.get_str() << " " << ref << " "
+          << (int)v.get_type() << " " << v.get_bitwidth();
+    ++num_terms;
+  }
+  o << kind << " " << cst.is_signed() << " "
+    << cst.expression().constant().get_str() << " " << num_terms
+    << terms.str() << "\n";
+  return true;
+}
+
+static bool readConstraint(std::istream &in, const ValueNumbering &vn,
+                           llvm_variable_factory &vfac, lin_cst_t &cst) {
+  std::string kind, constant;
+  bool is_signed;
+  unsigned num_terms;
+  if (!(in >> kind >> is_signed >> constant >> num_terms)) {
+    return false;
+  }
+  lin_exp_t e(number_t(constant));
+  for (unsigned i = 0; i < num_terms; ++i) {
+    std::string coef, ref;
+    int ty;
+    unsigned bitwidth;
+    if (!(in >> coef >> ref >> ty >> bitwidth)) {
+      return false;
+    }
+    const Value *v = vn.getValue(ref);
+    if (!v) {
+      return false;
+    }
+    var_t x(vfac[v], (crab::variable_type)ty, bitwidth);
+    e = e + number_t(coef) * x;
+  }
+  if (kind == "eq") {
+    cst = lin_cst_t(e == number_t(0));
+  } else if (kind == "ne") {
+    cst = lin_cst_t(e != number_t(0));
+  } else if (kind == "lt") {
+    cst = lin_cst_t(e < number_t(0));
+  } else if (kind == "le") {
+    cst = lin_cst_t(e <= number_t(0));
+  } else {
+    return false;
+  }
+  if (!is_signed) {
+    cst.set_unsigned();
+  }
+  return true;
+}
+
+static void writeInvariant(const std::string &tag, const BasicBlock *b,
+                           const AnalysisCache::Invariant &inv,
+                           const ValueNumbering &vn, raw_ostream &o) {
+  o << tag << " " << vn.getBlockId(b) << " ";
+  if (inv.is_bottom) {
+    o << "bottom\n";
+    return;
+  }
+  std::string str;
+  raw_string_ostream csts(str);
+  unsigned num_csts = 0;
+  for (auto const &cst : inv.csts) {
+    if (writeConstraint(cst, vn, csts)) {
+      ++num_csts;
+    }
+  }
+  o << num_csts << "\n" << csts.str();
+}
+
+AnalysisCache::AnalysisCache(std::string dir) : m_dir(dir) {}
+
+std::string AnalysisCache::getKey(const std::string &cfg_str,
+                                  const std::string &params_str) {
+  MD5 hash;
+  hash.update(cfg_str);
+  hash.update(params_str);
+  MD5::MD5Result result;
+  hash.final(result);
+  SmallString<32> res;
+  MD5::stringifyResult(result, res);
+  return res.str();
+}
+
+std::string AnalysisCache::getPath(const std::string &key) const {
+  SmallString<256> path(m_dir);
+  sys::path::append(path, key + ".crab");
+  return path.str();
+}
+
+bool AnalysisCache::load(const std::string &key, const Function &fun,
+                         llvm_variable_factory &vfac,
+                         FunctionResults &res) const {
+  return loadFile(getPath(key), fun, vfac, res);
+}
+
+bool AnalysisCache::loadFile(const std::string &path, const Function &fun,
+                             llvm_variable_factory &vfac,
+                             FunctionResults &res) const {
+  auto buf = MemoryBuffer::getFile(path);
+  if (!buf) {
+    return false;
+  }
+
+  ValueNumbering vn(fun);
+  std::istringstream in((*buf)->getBuffer().str());
+  std::string tag;
+  unsigned version;
+  if (!(in >> tag >> version) || tag != "clam-cache" ||
+      version != CACHE_VERSION) {
+    return false;
+  }
+
+  FunctionResults tmp;
+  while (in >> tag) {
+    if (tag == "end") {
+      res = std::move(tmp);
+      return true;
+    } else if (tag == "checks") {
+      if (!(in >> tmp.safe_checks >> tmp.error_checks >> tmp.warning_checks))
+        break;
+    } else if (tag == "check") {
+      std::string status;
+      Check check;
+      if (!(in >> status >> check.line >> check.column))
+        break;
+      if (status == "safe") {
+        check.status = SAFE;
+      } else if (status == "error") {
+        check.status = ERROR;
+      } else if (status == "warning") {
+        check.status = WARNING;
+      } else {
+        break;
+      }
+      // the file is the rest of the line
+      in >> std::ws;
+      if (!std::getline(in, check.file) || check.file.empty())
+        break;
+      tmp.checks.push_back(check);
+    } else if (tag == "pre" || tag == "post") {
+      unsigned id;
+      std::string num;
+      if (!(in >> id >> num))
+        break;
+      const BasicBlock *b = vn.getBlock(id);
+      if (!b)
+        break;
+      Invariant inv;
+      if (num == "bottom") {
+        inv.is_bottom = true;
+      } else {
+        char *end;
+        unsigned num_csts = std::strtoul(num.c_str(), &end, 10);
+        if (*end != '\0')
+          break;
+        for (unsigned i = 0; i < num_csts; ++i) {
+          lin_cst_t cst;
+          if (!readConstraint(in, vn, vfac, cst))
+            return false;
+          inv.csts += cst;
+        }
+      }
+      (tag == "pre" ? tmp.pre : tmp.post)[b] = inv;
+    } else if (tag == "edge") {
+      unsigned src, dst;
+      if (!(in >> src >> dst) || !vn.getBlock(src) || !vn.getBlock(dst))
+        break;
+      tmp.infeasible_edges.push_back({vn.getBlock(src), vn.getBlock(dst)});
+    } else {
+      break;
+    }
+  }
+  CLAM_WARNING("ignored corrupted cache entry " << path);
+  return false;
+}
+
+bool AnalysisCache::writeFile(const std::string &path,
+                              std::function<void(raw_ostream &)> write) const {
+  if (std::error_code ec = sys::fs::create_directories(m_dir)) {
+    CLAM_WARNING("cannot create cache directory " << m_dir << ": "
+                                                  << ec.message());
+    return false;
+  }
+
+  int fd;
+  SmallString<256> tmp_path;
+  SmallString<256> model(path);
+  model += "-%%%%%%.tmp";
+  if (std::error_code ec = sys::fs::createUniqueFile(model, fd, tmp_path)) {
+    CLAM_WARNING("cannot write into cache directory " << m_dir << ": "
+                                                      << ec.message());
+    return false;
+  }
+  {
+    raw_fd_ostream o(fd, /*shouldClose=*/true);
+    write(o);
+  }
+  if (std::error_code ec = sys::fs::rename(tmp_path, path)) {
+    CLAM_WARNING("cannot write cache entry " << path << ": " << ec.message());
+    sys::fs::remove(tmp_path);
+    return false;
+  }
+  return true;
+}
+
+bool AnalysisCache::contains(const std::string &key) const {
+  return sys::fs::exists(getPath(key));
+}
+
+void AnalysisCache::store(const std::string &key, const Function &fun,
+                          const FunctionResults &res) const {
+  storeFile(getPath(key), fun, res);
+}
+
+void AnalysisCache::storeFile(const std::string &path, const Function &fun,
+                              const FunctionResults &res) const {
+  ValueNumbering vn(fun);
+  writeFile(path, [&](raw_ostream &o) {
+    o << "clam-cache " << CACHE_VERSION << "\n";
+    o << "checks " << res.safe_checks << " " << res.error_checks << " "
+      << res.warning_checks << "\n";
+    for (auto &check : res.checks) {
+      o << "check "
+        << (check.status == SAFE    ? "safe"
+            : check.status == ERROR ? "error"
+                                    : "warning")
+        << " " << check.line << " " << check.column << " " << check.file
+        << "\n";
+    }
+    for (auto &kv : res.pre) {
+      writeInvariant("pre", kv.first, kv.second, vn, o);
+    }
+    for (auto &kv : res.post) {
+      writeInvariant("post", kv.first, kv.second, vn, o);
+    }
+    for (auto &e : res.infeasible_edges) {
+      o << "edge " << vn.getBlockId(e.first) << " " << vn.getBlockId(e.second)
+        << "\n";
+    }
+    o << "end\n";
+  });
+}
+
+std::string AnalysisCache::getNamePath(const std::string &name,
+                                       const std::string &suffix) const {
+  MD5 hash;
+  hash.update(name);
+  MD5::MD5Result result;
+  hash.final(result);
+  SmallString<32> hash_str;
+  MD5::stringifyResult(result, hash_str);
+  SmallString<256> path(m_dir);
+  sys::path::append(path, hash_str + suffix);
+  return path.str();
+}
+
+std::string AnalysisCache::getTimePath(const Function &fun) const {
+  return getNamePath(fun.getName(), ".time");
+}
+
+bool AnalysisCache::loadLatest(const Function &fun, const std::string &dom_name,
+                               llvm_variable_factory &vfac,
+                               FunctionResults &res) const {
+  return loadFile(getNamePath(fun.getName().str() + ";" + dom_name, ".last"),
+                  fun, vfac, res);
+}
+
+void AnalysisCache::storeLatest(const Function &fun, const std::string &dom_name,
+                                const FunctionResults &res) const {
+  storeFile(getNamePath(fun.getName().str() + ";" + dom_name, ".last"), fun,
+            res);
+}
+
+bool AnalysisCache::loadChecks(const Function &fun,
+                               const std::string &params_key,
+                               llvm_variable_factory &vfac,
+                               FunctionResults &res) const {
+  return loadFile(getNamePath(fun.getName().str() + ";" + params_key, ".checks"),
+                  fun, vfac, res);
+}
+
+void AnalysisCache::storeChecks(const Function &fun,
+                                const std::string &params_key,
+                                const FunctionResults &res) const {
+  FunctionResults checks;
+  checks.safe_checks = res.safe_checks;
+  checks.error_checks = res.error_checks;
+  checks.warning_checks = res.warning_checks;
+  checks.checks = res.checks;
+  storeFile(getNamePath(fun.getName().str() + ";" + params_key, ".checks"),
+            fun, checks);
+}
+
+bool AnalysisCache::loadTime(const Function &fun, double &time) const {
+  auto buf = MemoryBuffer::getFile(getTimePath(fun));
+  if (!buf) {
+    return false;
+  }
+  std::istringstream in((*buf)->getBuffer().str());
+  std::string tag;
+  return (in >> tag >> time) && tag == "time" && time >= 0;
+}
+
+void AnalysisCache::storeTime(const Function &fun, double time) const {
+  writeFile(getTimePath(fun), [time](raw_ostream &o) {
+    o << "time " << format("%.6f", time) << "\n";
+  });
+}
+
+} // end namespace clam
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "clam/crab/crab_cfg.hh"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class BasicBlock;
+class Function;
+class raw_ostream;
+} // namespace llvm
+
+namespace clam {
+
+/**
+ * Persistent on-disk cache of the results of the intra-procedural
+ * analysis of a function.
+ *
+ * An entry is keyed by a hash of the Crab CFG of the function
+ * together with all the analysis parameters that can change its
+ * results. Invariants are stored as linear constraints over the LLVM
+ * values of the function (arguments, instructions and globals) so
+ * they can be restored in a different run. Constraints over variables
+ * that cannot be mapped back to a LLVM value (e.g., shadow variables)
+ * are not stored. Checks are stored as counters together with the
+ * status and location of each assertion with debug info.
+ **/
+class AnalysisCache {
+public:
+  enum check_status_t { SAFE, ERROR, WARNING };
+
+  struct Check {
+    check_status_t status;
+    std::string file;
+    int line;
+    int column;
+    Check() : status(WARNING), line(0), column(0) {}
+  };
+
+  struct Invariant {
+    bool is_bottom;
+    lin_cst_sys_t csts;
+    Invariant() : is_bottom(false) {}
+  };
+
+  struct FunctionResults {
+    std::map<const llvm::BasicBlock *, Invariant> pre;
+    std::map<const llvm::BasicBlock *, Invariant> post;
+    std::vector<std::pair<const llvm::BasicBlock *, const llvm::BasicBlock *>>
+        infeasible_edges;
+    // all the checks, including those in checks
+    unsigned safe_checks;
+    unsigned error_checks;
+    unsigned warning_checks;
+    // the checks with debug info
+    std::vector<Check> checks;
+    FunctionResults() : safe_checks(0), error_checks(0), warning_checks(0) {}
+  };
+
+  explicit AnalysisCache(std::string dir);
+
+  // Return the key of a function given a textual representation of
+  // its Crab CFG and of the analysis parameters.
+  static std::string getKey(const std::string &cfg_str,
+                            const std::string &params_str);
+
+  // Return true and populate res if key is in the cache.
+  bool load(const std::string &key, const llvm::Function &fun,
+            llvm_variable_factory &vfac, FunctionResults &res) const;
+
+  // Return true if key is in the cache.
+  bool contains(const std::string &key) const;
+
+  // Store res in the cache. Errors are reported as warnings.
+  void store(const std::string &key, const llvm::Function &fun,
+             const FunctionResults &res) const;
+
+  // Time in seconds of the last analysis (not loaded from the cache)
+  // of a function with the same name as fun. It is kept even if the
+  // function changes so it can be used to schedule the analyses.
+  bool loadTime(const llvm::Function &fun, double &time) const;
+
+  void storeTime(const llvm::Function &fun, double time) const;
+
+  // Results of the last analysis of a function with the same name as
+  // fun with the domain dom_name. They might not be the results of
+  // fun if it changed since (see --crab-warm-start).
+  bool loadLatest(const llvm::Function &fun, const std::string &dom_name,
+                  llvm_variable_factory &vfac, FunctionResults &res) const;
+
+  void storeLatest(const llvm::Function &fun, const std::string &dom_name,
+                   const FunctionResults &res) const;
+
+  // Checks of the last analysis of a function with the same name as
+  // fun with the same parameters (see ClamImpl getParamsKey). Only
+  // the checks of res are stored: they are identified by their
+  // source lines so they remain valid if the IR of fun changes but
+  // not its source (see --crab-changed-lines).
+  bool loadChecks(const llvm::Function &fun, const std::string &params_key,
+                  llvm_variable_factory &vfac, FunctionResults &res) const;
+
+  void storeChecks(const llvm::Function &fun, const std::string &params_key,
+                   const FunctionResults &res) const;
+
+private:
+  std::string m_dir;
+  std::string getPath(const std::string &key) const;
+  std::string getNamePath(const std::string &name,
+                          const std::string &suffix) const;
+  std::string getTimePath(const llvm::Function &fun) const;
+  bool loadFile(const std::string &path, const llvm::Function &fun,
+                llvm_variable_factory &vfac, FunctionResults &res) const;
+  void storeFile(const std::string &path, const llvm::Function &fun,
+                 const FunctionResults &res) const;
+  // Write into a temporary file that is renamed to path once
+  // complete, so that concurrent readers never see a partial file.
+  bool writeFile(const std::string &path,
+                 std::function<void(llvm::raw_ostream &)> write) const;
+};
+
+} // end namespace clam
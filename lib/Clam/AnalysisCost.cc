@@ -0,0 +1,174 @@
+#include "AnalysisCost.hh"
+
+#include "llvm/ADT/iterator_range.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
+
+#include <algorithm>
+#include <set>
+
+using namespace llvm;
+
+namespace clam {
+
+// cells of an array counted as live variables by relational domains
+static const unsigned CELLS_PER_ARRAY = 4;
+
+unsigned numArrayVars(cfg_ref_t cfg) {
+  std::set<var_t> arrays;
+  auto add = [&arrays](const var_t &v) {
+    if (v.get_type() == ARR_INT_TYPE || v.get_type() == ARR_BOOL_TYPE) {
+      arrays.insert(v);
+    }
+  };
+  for (auto &bb : llvm::make_range(cfg.begin(), cfg.end())) {
+    for (auto &s : llvm::make_range(bb.begin(), bb.end())) {
+      auto &ls = s.get_live();
+      for (auto it = ls.defs_begin(), et = ls.defs_end(); it != et; ++it) {
+        add(*it);
+      }
+      for (auto it = ls.uses_begin(), et = ls.uses_end(); it != et; ++it) {
+        add(*it);
+      }
+    }
+  }
+  return arrays.size();
+}
+
+AnalysisCost::AnalysisCost(const Function &F, CfgBuilder &builder,
+                           bool compute_live)
+    : m_num_blocks(0), m_num_stmts(0), m_max_stmts_per_blk(0),
+      m_max_loop_depth(0), m_max_live_per_blk(0), m_num_arrays(0) {
+  cfg_ref_t cfg = builder.get_cfg();
+  for (auto &bb : llvm::make_range(cfg.begin(), cfg.end())) {
+    unsigned n = std::distance(bb.begin(), bb.end());
+    m_num_blocks++;
+    m_num_stmts += n;
+    m_max_stmts_per_blk = std::max(m_max_stmts_per_blk, n);
+  }
+  if (compute_live) {
+    builder.compute_live_symbols();
+  }
+  m_max_live_per_blk = builder.get_max_live_per_blk().getValueOr(0);
+  m_num_arrays = numArrayVars(cfg);
+
+  if (!F.isDeclaration()) {
+    DominatorTree DT(const_cast<Function &>(F));
+    LoopInfo LI(DT);
+    for (auto &BB : F) {
+      m_max_loop_depth = std::max(m_max_loop_depth, LI.getLoopDepth(&BB));
+    }
+  }
+}
+
+double AnalysisCost::estimate(CrabDomain dom,
+                              const AnalysisParams &params) const {
+  double n = std::max(m_max_live_per_blk, 1U) +
+             (double)m_num_arrays * CELLS_PER_ARRAY;
+  double op;
+  switch (dom) {
+  case INTERVALS:
+  case DENSE_INTERVALS:
+    op = n;
+    break;
+  case INTERVALS_CONGRUENCES:
+  case WRAPPED_INTERVALS:
+    op = 2 * n;
+    break;
+  case TERMS_INTERVALS:
+    op = 4 * n;
+    break;
+  case DIS_INTERVALS:
+    op = 8 * n;
+    break;
+  case TERMS_DIS_INTERVALS:
+    op = 32 * n;
+    break;
+  case BOXES:
+  case ZONES_SPLIT_DBM:
+    // closure of a split DBM is quadratic in practice
+    op = n * n;
+    break;
+  case TERMS_ZONES:
+  case ADAPT_TERMS_ZONES:
+    op = 32 * n + n * n;
+    break;
+  case OCT:
+    // cubic closure of 2n x 2n matrices
+    op = 8 * n * n * n;
+    break;
+  case PACKED_OCT: {
+    double p = std::min(n, (double)std::max(params.pack_size, 1U));
+    op = (n / p) * 8 * p * p * p;
+    break;
+  }
+  case PK:
+    // the number of generators can be exponential
+    op = 64 * n * n * n;
+    break;
+  default:
+    op = n * n;
+  }
+  double iterations =
+      1 + (double)m_max_loop_depth * (params.widening_delay + 1) +
+      (m_max_loop_depth > 0 ? params.narrowing_iters : 0);
+  return std::max(m_num_stmts, 1U) * iterations * op;
+}
+
+double AnalysisCost::footprint(CrabDomain dom,
+                               const AnalysisParams &params) const {
+  double n = std::max(m_max_live_per_blk, 1U) +
+             (double)m_num_arrays * CELLS_PER_ARRAY;
+  // bytes of one state
+  double state;
+  switch (dom) {
+  case INTERVALS:
+  case DENSE_INTERVALS:
+  case INTERVALS_CONGRUENCES:
+  case WRAPPED_INTERVALS:
+    state = 64 * n;
+    break;
+  case TERMS_INTERVALS:
+  case DIS_INTERVALS:
+    state = 256 * n;
+    break;
+  case TERMS_DIS_INTERVALS:
+    state = 1024 * n;
+    break;
+  case BOXES:
+    // decision diagrams share their nodes
+    state = 512 * n;
+    break;
+  case ZONES_SPLIT_DBM:
+  case TERMS_ZONES:
+  case ADAPT_TERMS_ZONES:
+    // sparse DBM with one edge per pair of variables at worst
+    state = 64 * n + 32 * n * n;
+    break;
+  case OCT:
+    // dense 2n x 2n matrix of bounds
+    state = 4 * 8 * n * n;
+    break;
+  case PACKED_OCT: {
+    double p = std::min(n, (double)std::max(params.pack_size, 1U));
+    state = (n / p) * 4 * 8 * p * p;
+    break;
+  }
+  case PK:
+    state = 64 * 8 * n * n;
+    break;
+  default:
+    state = 16 * n * n;
+  }
+  double states = 2.0 * std::max(m_num_blocks, 1U) + m_max_loop_depth;
+  return states * state;
+}
+
+void AnalysisCost::write(crab::crab_os &o) const {
+  o << "blocks=" << m_num_blocks << " stmts=" << m_num_stmts
+    << " max-stmts-per-blk=" << m_max_stmts_per_blk
+    << " loop-depth=" << m_max_loop_depth
+    << " max-live=" << m_max_live_per_blk << " arrays=" << m_num_arrays;
+}
+
+} // end namespace clam
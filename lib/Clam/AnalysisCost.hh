@@ -0,0 +1,60 @@
+#pragma once
+
+/* Estimated cost of analyzing a function with each abstract domain */
+
+#include "clam/CfgBuilder.hh"
+#include "clam/ClamAnalysisParams.hh"
+#include "clam/crab/crab_cfg.hh"
+
+#include "llvm/IR/Function.h"
+
+namespace clam {
+
+// Number of array variables of the CFG
+unsigned numArrayVars(cfg_ref_t cfg);
+
+/*
+ * The features are computed from the CFG (and its liveness) and from
+ * the loop nests of the function. The cost of a domain is
+ *
+ *   num_stmts * iterations * cost of one operation
+ *
+ * where iterations grows with the loop depth and the widening delay,
+ * and the cost of one operation is the complexity of the domain in
+ * the max number of live variables per block (array variables count
+ * as several cells). The unit is arbitrary: costs are only compared
+ * with each other and with --crab-max-estimated-cost.
+ */
+class AnalysisCost {
+public:
+  // If !compute_live and liveness was not computed before then the
+  // number of live variables is not part of the cost.
+  AnalysisCost(const llvm::Function &F, CfgBuilder &builder,
+               bool compute_live = true);
+
+  double estimate(CrabDomain dom, const AnalysisParams &params) const;
+
+  // Estimated bytes allocated by the analysis with dom: the size of
+  // one abstract state times the number of stored states (the pre and
+  // post of each block and the states kept at the loop heads).
+  double footprint(CrabDomain dom, const AnalysisParams &params) const;
+
+  unsigned num_blocks() const { return m_num_blocks; }
+  unsigned num_stmts() const { return m_num_stmts; }
+  unsigned max_stmts_per_blk() const { return m_max_stmts_per_blk; }
+  unsigned max_loop_depth() const { return m_max_loop_depth; }
+  unsigned max_live_per_blk() const { return m_max_live_per_blk; }
+  unsigned num_arrays() const { return m_num_arrays; }
+
+  void write(crab::crab_os &o) const;
+
+private:
+  unsigned m_num_blocks;
+  unsigned m_num_stmts;
+  unsigned m_max_stmts_per_blk;
+  unsigned m_max_loop_depth;
+  unsigned m_max_live_per_blk;
+  unsigned m_num_arrays;
+};
+
+} // end namespace clam
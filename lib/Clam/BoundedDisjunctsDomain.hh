@@ -0,0 +1,240 @@
+#pragma once
+
+/*
+ * bounded_disjuncts_domain<Dom> behaves as Dom (a disjunctive domain:
+ * dis-intervals, terms with dis-intervals or boxes) but after each
+ * join, if the state has more than max_disjuncts() disjuncts, the
+ * closest disjuncts are merged until at most max_disjuncts() are
+ * left.
+ *
+ * The distance between two disjuncts is computed from their bounding
+ * boxes: first the number of bounds lost by their convex hull, then
+ * the sum of the gaps between their intervals. The pair at the
+ * smallest distance is replaced with its hull, so that two adjacent
+ * intervals are merged before two far apart ones. The state is then
+ * rebuilt as the join of the remaining disjuncts, which is sound but
+ * loses what Dom does not express as linear constraints (e.g., the
+ * terms of the term domain and the array contents).
+ *
+ * The limit is per thread so it is set before analyzing each
+ * function. The merges of a thread are added to ClamStats by flush():
+ *
+ *   Domain.Disjuncts.Merges     number of states with too many disjuncts
+ *   Domain.Disjuncts.Removed    number of disjuncts removed by merging
+ */
+
+#include "clam/AbstractDomain.hh"
+#include "clam/crab/crab_domains.hh"
+#include "clam/Support/Stats.hh"
+
+#include <cstdint>
+#include <set>
+#include <type_traits>
+#include <vector>
+
+namespace clam {
+
+namespace bounded_disjuncts_impl {
+
+  // 0 if unlimited
+  inline unsigned &max_disjuncts() {
+    static thread_local unsigned max = 0;
+    return max;
+  }
+
+  struct stats_t {
+    uint64_t merges;
+    uint64_t removed;
+
+    stats_t(): merges(0), removed(0) {}
+
+    // Add the counters to ClamStats and reset them
+    void flush() {
+      if (merges > 0) {
+	ClamStats::count("Domain.Disjuncts.Merges", merges);
+	ClamStats::count("Domain.Disjuncts.Removed", removed);
+      }
+      merges = removed = 0;
+    }
+  };
+
+  inline stats_t &get_stats() {
+    static thread_local stats_t stats;
+    return stats;
+  }
+
+  typedef base_interval_domain_t box_t;
+  typedef box_t::interval_t interval_t;
+
+  // Distance between two boxes: bounds lost by their hull and then
+  // the gaps between their intervals
+  struct distance_t {
+    unsigned lost_bounds;
+    number_t gap;
+
+    distance_t(): lost_bounds(0), gap(0) {}
+
+    bool operator<(const distance_t &o) const {
+      return lost_bounds < o.lost_bounds ||
+	(lost_bounds == o.lost_bounds && gap < o.gap);
+    }
+  };
+
+  inline distance_t distance(box_t b1, box_t b2, const std::set<var_t> &vars) {
+    distance_t d;
+    for (auto const &v: vars) {
+      interval_t i1 = b1[v], i2 = b2[v];
+      if (i1.is_bottom() || i2.is_bottom()) {
+	continue;
+      }
+      d.lost_bounds += (i1.lb().is_finite() != i2.lb().is_finite());
+      d.lost_bounds += (i1.ub().is_finite() != i2.ub().is_finite());
+      // -- gap between the upper bound of one and the lower bound of
+      //    the other
+      if (i2.lb().is_finite() && i1.ub().is_finite() &&
+	  *(i1.ub().number()) < *(i2.lb().number())) {
+	d.gap += *(i2.lb().number()) - *(i1.ub().number());
+      } else if (i1.lb().is_finite() && i2.ub().is_finite() &&
+		 *(i2.ub().number()) < *(i1.lb().number())) {
+	d.gap += *(i1.lb().number()) - *(i2.ub().number());
+      }
+    }
+    return d;
+  }
+
+} // end namespace bounded_disjuncts_impl
+
+// Domains whose disjuncts are bounded (see AnalysisParams::max_disjuncts)
+template<typename Dom>
+struct is_disjunctive_domain: std::false_type {};
+template<>
+struct is_disjunctive_domain<dis_interval_domain_t>: std::true_type {};
+template<>
+struct is_disjunctive_domain<term_dis_int_domain_t>: std::true_type {};
+template<>
+struct is_disjunctive_domain<boxes_domain_t>: std::true_type {};
+
+template<typename Dom>
+class bounded_disjuncts_domain: public Dom {
+  typedef bounded_disjuncts_domain<Dom> this_type;
+
+  void bound() {
+    using namespace bounded_disjuncts_impl;
+    unsigned max = max_disjuncts();
+    if (max == 0 || Dom::is_bottom() || Dom::is_top()) {
+      return;
+    }
+    auto disjuncts = Dom::to_disjunctive_linear_constraint_system();
+    if (disjuncts.size() <= max) {
+      return;
+    }
+    // -- the bounding box of each disjunct
+    std::vector<box_t> boxes;
+    std::set<var_t> vars;
+    for (auto const &csts: disjuncts) {
+      box_t box = box_t::top();
+      box += csts;
+      boxes.push_back(box);
+      for (auto const &cst: csts) {
+	for (auto const &v: cst.variables()) {
+	  vars.insert(v);
+	}
+      }
+    }
+    unsigned num_disjuncts = boxes.size();
+    // -- merge the closest pair until max boxes are left
+    while (boxes.size() > max) {
+      unsigned best_i = 0, best_j = 1;
+      distance_t best = distance(boxes[0], boxes[1], vars);
+      for (unsigned i = 0; i < boxes.size(); ++i) {
+	for (unsigned j = i + 1; j < boxes.size(); ++j) {
+	  if (i == 0 && j == 1) continue;
+	  distance_t d = distance(boxes[i], boxes[j], vars);
+	  if (d < best) {
+	    best = d;
+	    best_i = i;
+	    best_j = j;
+	  }
+	}
+      }
+      boxes[best_i] = boxes[best_i] | boxes[best_j];
+      boxes.erase(boxes.begin() + best_j);
+    }
+    Dom res = Dom::bottom();
+    for (auto &box: boxes) {
+      Dom disjunct = Dom::top();
+      disjunct += box.to_linear_constraint_system();
+      res.Dom::operator|=(disjunct);
+    }
+    Dom::operator=(res);
+    stats_t &stats = get_stats();
+    stats.merges++;
+    stats.removed += num_disjuncts - boxes.size();
+  }
+
+public:
+  bounded_disjuncts_domain(): Dom() {}
+
+  // implicit so that the operations inherited from Dom that return
+  // a Dom can be used as this type
+  bounded_disjuncts_domain(const Dom &dom): Dom(dom) {}
+
+  static this_type top() { return this_type(Dom::top()); }
+
+  static this_type bottom() { return this_type(Dom::bottom()); }
+
+  const Dom &base() const { return *this; }
+
+  void operator|=(const this_type &o) {
+    Dom::operator|=(o);
+    bound();
+  }
+
+  this_type operator|(const this_type &o) {
+    this_type res(Dom::operator|(o));
+    res.bound();
+    return res;
+  }
+};
+
+// The invariants are wrapped and unwrapped as invariants of Dom
+template<typename Dom>
+inline GenericAbsDomWrapperPtr mkGenericAbsDomWrapper(bounded_disjuncts_domain<Dom> abs_dom) {
+  return mkGenericAbsDomWrapper<Dom>(abs_dom.base());
+}
+
+template<typename Dom>
+inline void getAbsDomWrappee(GenericAbsDomWrapperPtr wrapper,
+			     bounded_disjuncts_domain<Dom> &abs_dom) {
+  Dom base;
+  getAbsDomWrappee(wrapper, base);
+  abs_dom = base;
+}
+
+} // end namespace clam
+
+namespace crab {
+namespace domains {
+
+  // The checks are done as with Dom
+  template<typename Dom>
+  class checker_domain_traits<clam::bounded_disjuncts_domain<Dom>> {
+  public:
+    template<typename Cst>
+    static bool entail(clam::bounded_disjuncts_domain<Dom> &inv, const Cst &cst) {
+      return checker_domain_traits<Dom>::entail(inv, cst);
+    }
+
+    template<typename Cst>
+    static bool entail(const Cst &cst, clam::bounded_disjuncts_domain<Dom> &inv) {
+      return checker_domain_traits<Dom>::entail(cst, inv);
+    }
+
+    template<typename Cst>
+    static bool intersect(clam::bounded_disjuncts_domain<Dom> &inv, const Cst &cst) {
+      return checker_domain_traits<Dom>::intersect(inv, cst);
+    }
+  };
+
+} // end namespace domains
+} // end namespace crab
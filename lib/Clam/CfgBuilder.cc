@@ -68,32 +68,54 @@
 
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/iterator_range.h"
+#include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/IR/CallSite.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/GetElementPtrTypeIterator.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/InstVisitor.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/TypeFinder.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 
+#include "CfgBuilderCallees.hh"
 #include "CfgBuilderLit.hh"
+#include "CfgBuilderMemSSA.hh"
 #include "CfgBuilderMemRegions.hh"
 #include "CfgBuilderUtils.hh"
 #include "CfgBuilderShadowMem.hh"
+#include "FunctionSummaries.hh"
+#include "LoopAcceleration.hh"
+#include "OutputSink.hh"
+#include "PrecisionSelection.hh"
+#include "SparseLiveness.hh"
 
 #include "clam/CfgBuilder.hh"
+#include "clam/CfgBuilderDiagnostics.hh"
 #include "clam/DummyHeapAbstraction.hh"
 #include "clam/Support/CFG.hh"
 #include "clam/Support/Debug.hh"
+#include "clam/Support/NameValues.hh"
+#include "clam/Support/Stats.hh"
 #include "crab/common/debug.hpp"
-#include "crab/common/stats.hpp"
 #include "crab/transforms/dce.hpp"
 
 #include "sea_dsa/ShadowMem.hh"
 
 #include <algorithm>
+#include <atomic>
 #include <boost/functional/hash_fwd.hpp> // for hash_combine
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
 #include <unordered_map>
 
 using namespace llvm;
@@ -105,26 +127,6 @@ namespace {
 
 using namespace clam;
 
-bool checkAllDefinitionsHaveNames(const Function &F) {
-  // for (auto &Arg : F.args()) {
-  //   if (!Arg.hasName()) {
-  // 	return false;
-  //   }
-  // }
-
-  for (const BasicBlock &BB : F) {
-    if (!BB.hasName()) {
-      return false;
-    }
-    for (const Instruction &I : BB) {
-      if (!I.hasName() && !(I.getType()->isVoidTy())) {
-        return false;
-      }
-    }
-  }
-  return true;
-}
-
 void havoc(var_t v, basic_block_t &bb, bool include_useless_havoc) {
   if (include_useless_havoc) {
     bb.havoc(v);
@@ -134,10 +136,10 @@ void havoc(var_t v, basic_block_t &bb, bool include_useless_havoc) {
 // %x = icmp geq %y, 10  ---> bool_assign(%x, y >= 0)
 void cmpInstToCrabBool(CmpInst &I, crabLitFactory &lfac, basic_block_t &bb) {
   // The type of I is a boolean or vector of booleans
-  normalizeCmpInst(I);
-
-  const Value &v0 = *I.getOperand(0);
-  const Value &v1 = *I.getOperand(1);
+  const Value *p0, *p1;
+  CmpInst::Predicate pred = normalizeCmpInst(I, p0, p1);
+  const Value &v0 = *p0;
+  const Value &v1 = *p1;
 
   crab_lit_ref_t ref = lfac.getLit(I);
   if (!ref || !(ref->isBool()) || !(ref->isVar())) {
@@ -163,7 +165,7 @@ void cmpInstToCrabBool(CmpInst &I, crabLitFactory &lfac, basic_block_t &bb) {
   lin_exp_t op1 = lfac.getExp(ref1);
 
   assert(isBool(I));
-  switch (I.getPredicate()) {
+  switch (pred) {
   case CmpInst::ICMP_EQ: {
     lin_cst_t cst(op0 == op1);
     bb.bool_assign(lhs, cst);
@@ -177,7 +179,7 @@ void cmpInstToCrabBool(CmpInst &I, crabLitFactory &lfac, basic_block_t &bb) {
   case CmpInst::ICMP_ULT:
   case CmpInst::ICMP_SLT: {
     lin_cst_t cst(op0 <= op1 - number_t(1));
-    if (I.getPredicate() == CmpInst::ICMP_ULT) {
+    if (pred == CmpInst::ICMP_ULT) {
       cst.set_unsigned();
     }
     bb.bool_assign(lhs, cst);
@@ -186,7 +188,7 @@ void cmpInstToCrabBool(CmpInst &I, crabLitFactory &lfac, basic_block_t &bb) {
   case CmpInst::ICMP_ULE:
   case CmpInst::ICMP_SLE: {
     lin_cst_t cst(op0 <= op1);
-    if (I.getPredicate() == CmpInst::ICMP_ULE) {
+    if (pred == CmpInst::ICMP_ULE) {
       cst.set_unsigned();
     }
     bb.bool_assign(lhs, cst);
@@ -200,10 +202,10 @@ void cmpInstToCrabBool(CmpInst &I, crabLitFactory &lfac, basic_block_t &bb) {
 /* If possible, return a pointer constraint from CmpInst */
 Optional<ptr_cst_t> cmpInstToCrabPtr(CmpInst &I, crabLitFactory &lfac,
                                      const bool isNegated) {
-  normalizeCmpInst(I);
-
-  const Value &v0 = *I.getOperand(0);
-  const Value &v1 = *I.getOperand(1);
+  const Value *p0, *p1;
+  CmpInst::Predicate pred = normalizeCmpInst(I, p0, p1);
+  const Value &v0 = *p0;
+  const Value &v1 = *p1;
 
   crab_lit_ref_t ref0 = lfac.getLit(v0);
   if (!ref0 || !(ref0->isPtr()))
@@ -213,15 +215,15 @@ Optional<ptr_cst_t> cmpInstToCrabPtr(CmpInst &I, crabLitFactory &lfac,
   if (!ref1 || !(ref1->isPtr()))
     return llvm::None;
 
-  if (I.getPredicate() != CmpInst::ICMP_EQ &&
-      I.getPredicate() != CmpInst::ICMP_NE) {
+  if (pred != CmpInst::ICMP_EQ &&
+      pred != CmpInst::ICMP_NE) {
     // CLAM_WARNING("unexpected pointer comparison " << I);
     return llvm::None;
   }
 
   bool is_eq;
-  if ((I.getPredicate() == CmpInst::ICMP_EQ && !isNegated) ||
-      (I.getPredicate() == CmpInst::ICMP_NE && isNegated)) {
+  if ((pred == CmpInst::ICMP_EQ && !isNegated) ||
+      (pred == CmpInst::ICMP_NE && isNegated)) {
     is_eq = true;
   } else {
     is_eq = false;
@@ -253,10 +255,10 @@ Optional<ptr_cst_t> cmpInstToCrabPtr(CmpInst &I, crabLitFactory &lfac,
 /* If possible, return a linear constraint from CmpInst */
 Optional<lin_cst_t> cmpInstToCrabInt(CmpInst &I, crabLitFactory &lfac,
                                      const bool isNegated = false) {
-  normalizeCmpInst(I);
-
-  const Value &v0 = *I.getOperand(0);
-  const Value &v1 = *I.getOperand(1);
+  const Value *p0, *p1;
+  CmpInst::Predicate pred = normalizeCmpInst(I, p0, p1);
+  const Value &v0 = *p0;
+  const Value &v1 = *p1;
 
   crab_lit_ref_t ref0 = lfac.getLit(v0);
   if (!ref0 || !(ref0->isInt()))
@@ -269,7 +271,7 @@ Optional<lin_cst_t> cmpInstToCrabInt(CmpInst &I, crabLitFactory &lfac,
   lin_exp_t op0 = lfac.getExp(ref0);
   lin_exp_t op1 = lfac.getExp(ref1);
 
-  switch (I.getPredicate()) {
+  switch (pred) {
   case CmpInst::ICMP_EQ:
     if (!isNegated)
       return lin_cst_t(op0 == op1);
@@ -289,7 +291,7 @@ Optional<lin_cst_t> cmpInstToCrabInt(CmpInst &I, crabLitFactory &lfac,
       cst = lin_cst_t(op0 <= op1 - number_t(1));
     else
       cst = lin_cst_t(op0 >= op1);
-    if (I.getPredicate() == CmpInst::ICMP_ULT) {
+    if (pred == CmpInst::ICMP_ULT) {
       cst.set_unsigned();
     }
     return cst;
@@ -302,7 +304,7 @@ Optional<lin_cst_t> cmpInstToCrabInt(CmpInst &I, crabLitFactory &lfac,
       cst = lin_cst_t(op0 <= op1);
     else
       cst = lin_cst_t(op0 >= op1 + number_t(1));
-    if (I.getPredicate() == CmpInst::ICMP_ULE) {
+    if (pred == CmpInst::ICMP_ULE) {
       cst.set_unsigned();
     }
     return cst;
@@ -314,6 +316,58 @@ Optional<lin_cst_t> cmpInstToCrabInt(CmpInst &I, crabLitFactory &lfac,
   return llvm::None;
 }
 
+/* If the unsigned comparison I (negated if isNegated) is equivalent
+   to signed constraints then add them to csts and return true. This
+   is the case if one operand is a non-negative constant and the
+   comparison bounds the other operand, e.g.,
+
+     x <u 10  iff  0 <= x <= 9
+
+   so the domains that ignore unsigned constraints still use it. The
+   other cases (e.g., x >=u 10) are disjunctions of signed
+   constraints so the unsigned constraint is needed. */
+bool unsignedCmpToSignedCsts(CmpInst &I, crabLitFactory &lfac,
+			     const bool isNegated, std::vector<lin_cst_t> &csts) {
+  const Value *p0, *p1;
+  CmpInst::Predicate pred = normalizeCmpInst(I, p0, p1);
+  if (pred != CmpInst::ICMP_ULT && pred != CmpInst::ICMP_ULE) {
+    return false;
+  }
+  crab_lit_ref_t ref0 = lfac.getLit(*p0);
+  crab_lit_ref_t ref1 = lfac.getLit(*p1);
+  if (!ref0 || !ref0->isInt() || !ref1 || !ref1->isInt() ||
+      ref0->isVar() == ref1->isVar()) {
+    return false;
+  }
+  bool cst_on_right = ref0->isVar();
+  number_t c = lfac.getIntCst(cst_on_right ? ref1 : ref0);
+  if (c < number_t(0)) {
+    return false;
+  }
+  lin_exp_t x = lfac.getExp(cst_on_right ? ref0 : ref1);
+  // -- whether the comparison is x <u c or x <=u c after moving the
+  //    constant to the right
+  bool upper, strict;
+  if (cst_on_right) {
+    // x < c, x <= c or their negations x >= c, x > c
+    upper = !isNegated;
+    strict = (pred == CmpInst::ICMP_ULT) != isNegated;
+  } else {
+    // c < x, c <= x or their negations x <= c, x < c
+    upper = isNegated;
+    strict = (pred == CmpInst::ICMP_ULE) == isNegated;
+  }
+  if (upper) {
+    csts.push_back(lin_cst_t(x >= number_t(0)));
+    csts.push_back(lin_cst_t(x <= (strict ? c - number_t(1) : c)));
+    return true;
+  } else if (!strict && c == number_t(0)) {
+    // x >=u 0 is always true
+    return true;
+  }
+  return false;
+}
+
 // This function makes sure that all actual parameters and function
 // return values are variables. This is required by crab.
 // precondition: v is tracked.
@@ -361,6 +415,26 @@ var_t normalizeFuncParamOrRet(Value &v, basic_block_t &bb,
 //! Translate PHI nodes
 struct CrabPhiVisitor : public InstVisitor<CrabPhiVisitor> {
 
+  // Maps reused across the edges of a function so that they are not
+  // allocated again for each edge
+  struct scratch_t {
+    // map a PHI node of the block to a Crab variable with its value
+    // before the copies
+    DenseMap<const Value*, var_t> old_val_map;
+    // map a PHI incoming value to a cell if the PHI node is a shadow
+    // mem PHI node.
+    DenseMap<const Value*, std::pair<sea_dsa::Cell,Region>> sm_cell_map;
+    // copies (phi node, incoming value) of the edge
+    std::vector<std::pair<PHINode*, const Value*>> copies;
+    // index in copies of the copy that writes a phi node
+    DenseMap<const Value*, unsigned> copy_index;
+    // number of copies not emitted yet that read the phi node written
+    // by each copy
+    std::vector<unsigned> pending_reads;
+    std::vector<char> emitted;
+    std::vector<unsigned> ready;
+  };
+  
   crabLitFactory &m_lfac;
   HeapAbstraction &m_mem;
   sea_dsa::ShadowMem *m_sm;
@@ -371,6 +445,7 @@ struct CrabPhiVisitor : public InstVisitor<CrabPhiVisitor> {
   const BasicBlock &m_inc_BB;
   // builder parameters
   const CrabBuilderParams &m_params;
+  scratch_t &m_scratch;
 
   const sea_dsa::ShadowMem* getShadowMem() const {
     if (m_params.memory_ssa && m_sm) {
@@ -383,23 +458,160 @@ struct CrabPhiVisitor : public InstVisitor<CrabPhiVisitor> {
   
   CrabPhiVisitor(crabLitFactory &lfac, HeapAbstraction &mem, sea_dsa::ShadowMem *sm,
 		 const DataLayout &dl, basic_block_t &bb, const BasicBlock &inc_BB,
-		 const CrabBuilderParams &params)
+		 const CrabBuilderParams &params, scratch_t &scratch)
     : m_lfac(lfac), m_mem(mem), m_sm(sm), m_dl(dl), m_bb(bb),
-      m_inc_BB(inc_BB), m_params(params) {}
+      m_inc_BB(inc_BB), m_params(params), m_scratch(scratch) {}
+
+  // Copy the value of the phi node v into a fresh variable
+  void saveOldValue(const PHINode &v) {
+    DenseMap<const Value*, var_t> &old_val_map = m_scratch.old_val_map;
+    crab_lit_ref_t phi_val_ref = m_lfac.getLit(v);
+    if (!phi_val_ref) {
+      return;
+    }
+    auto sm_it = m_scratch.sm_cell_map.find(&v);
+    if (sm_it != m_scratch.sm_cell_map.end()) {
+      // shadow mem phi node: array
+      if (!phi_val_ref->isVar()) {
+	CLAM_ERROR("unexpected shadow PHI node");
+      }
+      Region reg = sm_it->second.second;
+      bool lowerToScalar = get_singleton_value(reg, m_params.lower_singleton_aliases);
+      if (reg.getRegionInfo().get_type() == BOOL_REGION) {
+	var_t lhs = (lowerToScalar ? m_lfac.mkBoolVar(): m_lfac.mkBoolArrayVar());
+	if (lowerToScalar) {
+	  m_bb.bool_assign(lhs, m_lfac.mkArraySingletonVar(reg, &v));
+	} else {
+	  m_bb.array_assign(lhs, m_lfac.mkArrayVar(reg, &v));
+	}
+	old_val_map.insert({&v, lhs});		  
+      } else if (reg.getRegionInfo().get_type() == INT_REGION) {
+	var_t lhs = (lowerToScalar ?
+		     m_lfac.mkIntVar(reg.getRegionInfo().get_bitwidth()):
+		     m_lfac.mkIntArrayVar(reg.getRegionInfo().get_bitwidth()));
+	if (lowerToScalar) {
+	  m_bb.assign(lhs, m_lfac.mkArraySingletonVar(reg, &v));
+	} else {
+	  m_bb.array_assign(lhs, m_lfac.mkArrayVar(reg, &v));
+	}
+	old_val_map.insert({&v, lhs});		  
+      } else {
+	CLAM_WARNING("Skipped shadow mem phi node" << v);
+      }
+    } else {
+      // non-shadow mem phi node: bool, integer, or pointer
+      if (phi_val_ref->isBool()) {
+	var_t lhs = m_lfac.mkBoolVar();
+	if (phi_val_ref->isVar()) {
+	  m_bb.bool_assign(lhs, phi_val_ref->getVar());
+	} else {
+	  m_bb.bool_assign(lhs, m_lfac.isBoolTrue(phi_val_ref)
+			   ? lin_cst_t::get_true()
+			   : lin_cst_t::get_false());
+	}
+	old_val_map.insert({&v, lhs});
+      } else if (phi_val_ref->isInt()) {
+	var_t lhs = m_lfac.mkIntVar(v.getType()->getIntegerBitWidth());
+	m_bb.assign(lhs, m_lfac.getExp(phi_val_ref));
+	old_val_map.insert({&v, lhs});	     
+      } else if (phi_val_ref->isPtr()) {
+	var_t lhs = m_lfac.mkPtrVar();
+	if (phi_val_ref->isVar()) {
+	  m_bb.ptr_assign(lhs, phi_val_ref->getVar(), number_t(0));
+	} else {
+	  m_bb.ptr_null(lhs);
+	}
+	old_val_map.insert({&v, lhs});
+      } else { 
+	/* unreachable */
+      }
+    }
+  }
 
+  // Assign the incoming value v (or its old value if it was saved) to
+  // the phi node
+  void emitCopy(PHINode &phi, const Value &v) {
+    auto it = m_scratch.old_val_map.find(&v);
+    bool has_old = (it != m_scratch.old_val_map.end());
+    auto sm_it = m_scratch.sm_cell_map.find(&v);
+    if (sm_it != m_scratch.sm_cell_map.end()) {
+      /// Shadow mem PHI node: array 
+      Region reg  = sm_it->second.second;
+      bool lowerToScalar = get_singleton_value(reg, m_params.lower_singleton_aliases);	
+      if (lowerToScalar) {
+	switch (reg.getRegionInfo().get_type()) {
+	case BOOL_REGION:
+	  m_bb.bool_assign(m_lfac.mkArraySingletonVar(reg, &phi),
+			   has_old ? it->second : m_lfac.mkArraySingletonVar(reg, &v));
+	  break;
+	case INT_REGION:
+	  m_bb.assign(m_lfac.mkArraySingletonVar(reg, &phi),
+		      has_old ? it->second : m_lfac.mkArraySingletonVar(reg, &v));
+	  break;
+	default:
+	  CLAM_WARNING("Skipped shadow mem phi node" << phi);	    
+	}
+      } else {
+	m_bb.array_assign(m_lfac.mkArrayVar(reg, &phi),
+			  has_old ? it->second : m_lfac.mkArrayVar(reg, &v));
+      }
+      return;
+    }
+    
+    /// Regular PHI node: bool, integer, or pointer
+    crab_lit_ref_t lhs_ref = m_lfac.getLit(phi);
+    if (!lhs_ref || !lhs_ref->isVar()) {
+      CLAM_ERROR("unexpected PHI instruction");
+    }
+    var_t lhs = lhs_ref->getVar();	
+    if (has_old) {
+      // -- use old version if exists
+      if (isBool(phi)) {
+	m_bb.bool_assign(lhs, it->second);
+      } else if (phi.getType()->isIntegerTy()) {
+	m_bb.assign(lhs, it->second);
+      } else if (isPointer(phi, m_lfac.get_cfg_builder_params())) {
+	m_bb.ptr_assign(lhs, it->second, number_t(0));
+      }
+    } else if (crab_lit_ref_t phi_val_ref = m_lfac.getLit(v)) {
+      if (phi_val_ref->isBool()) {
+	if (phi_val_ref->isVar()) {
+	  m_bb.bool_assign(lhs, phi_val_ref->getVar());
+	} else {
+	  m_bb.bool_assign(lhs, m_lfac.isBoolTrue(phi_val_ref)
+			   ? lin_cst_t::get_true()
+			   : lin_cst_t::get_false());
+	}
+      } else if (phi_val_ref->isInt()) {
+	m_bb.assign(lhs, m_lfac.getExp(phi_val_ref));
+      } else if (phi_val_ref->isPtr()) {
+	if (phi_val_ref->isVar()) {
+	  m_bb.ptr_assign(lhs, phi_val_ref->getVar(), number_t(0));
+	} else {
+	  m_bb.ptr_null(lhs);
+	}
+      } else {
+	/* unreachable*/
+      }
+    } else {
+      // we can be here if the incoming value is a bignum and we
+      // don't allow bignums.
+      m_bb.havoc(lhs);
+    }
+  }
+  
   void visitBasicBlock(BasicBlock &BB) {
     if (!isa<PHINode>(BB.begin()))
       return;
 
-    // Map an PHI incoming value to a Crab variable
-    DenseMap<const Value*, var_t> old_val_map;
+    scratch_t &s = m_scratch;
+    s.old_val_map.clear();
+    s.sm_cell_map.clear();
+    s.copies.clear();
+    s.copy_index.clear();
+    
     // Get shadow memory if available
     const sea_dsa::ShadowMem *sm = getShadowMem();
-    // map an PHI incoming value to a cell if the PHI node is a shadow
-    // mem PHI node.
-    DenseMap<const Value*, std::pair<sea_dsa::Cell,Region>> sm_cell_map;
-
-    
     if (sm) {
       // We first identify all shadow mem PHI nodes
       auto curr = BB.begin();
@@ -413,182 +625,76 @@ struct CrabPhiVisitor : public InstVisitor<CrabPhiVisitor> {
 	  sea_dsa::Cell cell = cellOpt.getValue();
 	  Region reg = getShadowRegion(cell, m_dl, *sm);
 	  if (!reg.isUnknown()) {
-	    sm_cell_map.insert({&v, {cell, reg}});
+	    s.sm_cell_map.insert({&v, {cell, reg}});
 	  }
       	}
       }
     }
 
-    // --- All the phi-nodes must be evaluated atomically. This
-    //     means that if one phi node v1 has as incoming value
-    //     another phi node v2 in the same block then it should take
-    //     the v2's old value (i.e., before v2's evaluation).
-
-    auto curr = BB.begin();
-    for (; PHINode *phi = dyn_cast<PHINode>(curr); ++curr) {
-      const Value &v = *phi->getIncomingValueForBlock(&m_inc_BB);
-      if (!isTracked(v, m_lfac.get_cfg_builder_params()))
+    // -- the copies of the edge
+    for (auto curr = BB.begin(); PHINode *phi = dyn_cast<PHINode>(curr); ++curr) {
+      if (!isTracked(*phi, m_lfac.get_cfg_builder_params()))
         continue;
-      const PHINode *phi_v = dyn_cast<PHINode>(&v);
-      if (phi_v && (phi_v->getParent() == &BB)) {
-        // -- save the old version of the variable that maps to the
-        //    phi node v
-        auto it = old_val_map.find(&v);
-        if (it == old_val_map.end()) {
-          if (crab_lit_ref_t phi_val_ref = m_lfac.getLit(v)) {
-	    auto sm_it = sm_cell_map.find(&v);
-	    if (sm_it != sm_cell_map.end()) {
-	      // shadow mem phi node: array
-              if (!phi_val_ref->isVar()) {
-		CLAM_ERROR("unexpected shadow PHI node");
-	      }
-	      Region reg = sm_it->second.second;
-	      bool lowerToScalar = get_singleton_value(reg, m_params.lower_singleton_aliases);
-	      if (reg.getRegionInfo().get_type() == BOOL_REGION) {
-		var_t lhs = (lowerToScalar ? m_lfac.mkBoolVar(): m_lfac.mkBoolArrayVar());
-		if (lowerToScalar) {
-		  m_bb.bool_assign(lhs, m_lfac.mkArraySingletonVar(reg, phi));
-		} else {
-		  m_bb.array_assign(lhs, m_lfac.mkArrayVar(reg, phi));
-		}
-		old_val_map.insert({&v, lhs});		  
-	      } else if (reg.getRegionInfo().get_type() == INT_REGION) {
-		var_t lhs = (lowerToScalar ?
-			     m_lfac.mkIntVar(reg.getRegionInfo().get_bitwidth()):
-			     m_lfac.mkIntArrayVar(reg.getRegionInfo().get_bitwidth()));
-		if (lowerToScalar) {
-		  m_bb.assign(lhs, m_lfac.mkArraySingletonVar(reg, phi));
-		} else {
-		  m_bb.array_assign(lhs, m_lfac.mkArrayVar(reg, phi));
-		}
-		old_val_map.insert({&v, lhs});		  
-	      } else {
-		CLAM_WARNING("Skipped shadow mem phi node" << *phi);
-	      }
-	    } else {
-	      // non-shadow mem phi node: bool, integer, or pointer
-
-	      if (phi->getName().startswith("shadow.mem")) {
-		// XXX: If clam is run from SeaHorn then the bitcode
-		// will be instrumented by ShadowMem. Here we try to
-		// identify PHI shadow mem instructions and ignore them.
-		continue;
-	      }
-	      
-	      if (phi_val_ref->isBool()) {
-		var_t lhs = m_lfac.mkBoolVar();
-		if (phi_val_ref->isVar()) {
-		  m_bb.bool_assign(lhs, phi_val_ref->getVar());
-		} else {
-		  m_bb.bool_assign(lhs, m_lfac.isBoolTrue(phi_val_ref)
-				   ? lin_cst_t::get_true()
-				   : lin_cst_t::get_false());
-		}
-		old_val_map.insert({&v, lhs});
-	      } else if (phi_val_ref->isInt()) {
-		var_t lhs =
-		  m_lfac.mkIntVar(phi_v->getType()->getIntegerBitWidth());
-		m_bb.assign(lhs, m_lfac.getExp(phi_val_ref));
-		old_val_map.insert({&v, lhs});	     
-	      } else if (phi_val_ref->isPtr()) {
-		var_t lhs = m_lfac.mkPtrVar();
-		if (phi_val_ref->isVar()) {
-		  m_bb.ptr_assign(lhs, phi_val_ref->getVar(), number_t(0));
-		} else {
-		  m_bb.ptr_null(lhs);
-		}
-		old_val_map.insert({&v, lhs});
-	      } else { 
-		/* unreachable */
-	      }
-	    }
-	  }
-	}
+      const Value &v = *phi->getIncomingValueForBlock(&m_inc_BB);
+      if (&v == phi) {
+	// the phi node keeps its value along this edge
+	continue;
+      }
+      if (!s.sm_cell_map.count(&v) && phi->getName().startswith("shadow.mem")) {
+	// XXX: If clam is run from SeaHorn then the bitcode will be
+	// instrumented by ShadowMem. Here we try to identify PHI
+	// shadow mem instructions and ignore them.
+	continue;
       }
+      s.copy_index.insert({phi, s.copies.size()});
+      s.copies.push_back({phi, &v});
     }
 
-    curr = BB.begin();
-    for (; isa<PHINode>(curr); ++curr) {
-      PHINode &phi = *cast<PHINode>(curr);
-      if (!isTracked(phi, m_lfac.get_cfg_builder_params()))
-        continue;
-      
-      const Value &v = *phi.getIncomingValueForBlock(&m_inc_BB);
-
-      auto sm_it = sm_cell_map.find(&v);
-      if (sm_it != sm_cell_map.end()) {
-	/// Shadow mem PHI node: array 
-	Region reg  = sm_it->second.second;
-	bool lowerToScalar = get_singleton_value(reg, m_params.lower_singleton_aliases);	
-	if (lowerToScalar) {
-	  switch (reg.getRegionInfo().get_type()) {
-	  case BOOL_REGION:
-	    m_bb.bool_assign(m_lfac.mkArraySingletonVar(reg, &phi),
-			     m_lfac.mkArraySingletonVar(reg, &v));
-	    break;
-	  case INT_REGION:
-	    m_bb.assign(m_lfac.mkArraySingletonVar(reg, &phi),
-			m_lfac.mkArraySingletonVar(reg, &v));
-	    break;
-	  default:
-	    CLAM_WARNING("Skipped shadow mem phi node" << phi);	    
-	  }
-	} else {
-	  m_bb.array_assign(m_lfac.mkArrayVar(reg, &phi),
-			    m_lfac.mkArrayVar(reg, &v));
-	}
-      } else {
-	/// Regular PHI node: bool, integer, or pointer
-
-	if (phi.getName().startswith("shadow.mem")) {
-	  // XXX: If clam is run from SeaHorn then the bitcode will be
-	  // instrumented by ShadowMem. Here we try to identify PHI
-	  // shadow mem instructions and ignore them.
-	  continue;
-	}
-	
-	crab_lit_ref_t lhs_ref = m_lfac.getLit(phi);
-	if (!lhs_ref || !lhs_ref->isVar()) {
-	  CLAM_ERROR("unexpected PHI instruction");
-	}
-	var_t lhs = lhs_ref->getVar();	
-	auto it = old_val_map.find(&v);
-	if (it != old_val_map.end()) {
-	  // -- use old version if exists
-	  if (isBool(phi)) {
-	    m_bb.bool_assign(lhs, it->second);
-	  } else if (phi.getType()->isIntegerTy()) {
-	    m_bb.assign(lhs, it->second);
-	  } else if (isPointer(phi, m_lfac.get_cfg_builder_params())) {
-	    m_bb.ptr_assign(lhs, it->second, number_t(0));
-	  }
-	} else {	
-	  if (crab_lit_ref_t phi_val_ref = m_lfac.getLit(v)) {
-	    if (phi_val_ref->isBool()) {
-	      if (phi_val_ref->isVar()) {
-		m_bb.bool_assign(lhs, phi_val_ref->getVar());
-	      } else {
-		m_bb.bool_assign(lhs, m_lfac.isBoolTrue(phi_val_ref)
-				 ? lin_cst_t::get_true()
-				 : lin_cst_t::get_false());
-	      }
-	    } else if (phi_val_ref->isInt()) {
-	      m_bb.assign(lhs, m_lfac.getExp(phi_val_ref));
-	    } else if (phi_val_ref->isPtr()) {
-	      if (phi_val_ref->isVar()) {
-		m_bb.ptr_assign(lhs, phi_val_ref->getVar(), number_t(0));
-	      } else {
-		m_bb.ptr_null(lhs);
-	      }
-	    } else {
-	      /* unreachable*/
-	    }
-	  } else {
-	    // we can be here if the incoming value is a bignum and we
-	    // don't allow bignums.
-	    m_bb.havoc(lhs);
-	  }
+    // --- All the phi-nodes must be evaluated atomically: the copies
+    //     are a parallel copy. They are emitted in an order where
+    //     each phi node is written after all the copies that read
+    //     it, so a temporary variable is only needed to break a
+    //     cycle of copies (e.g., a swap).
+    unsigned n = s.copies.size();
+    s.pending_reads.assign(n, 0);
+    s.emitted.assign(n, false);
+    s.ready.clear();
+    for (auto &c: s.copies) {
+      auto it = s.copy_index.find(c.second);
+      if (it != s.copy_index.end()) {
+	s.pending_reads[it->second]++;
+      }
+    }
+    // -- in reverse so that the independent copies are emitted in
+    //    the order of the phi nodes
+    for (unsigned i = n; i-- > 0;) {
+      if (s.pending_reads[i] == 0) {
+	s.ready.push_back(i);
+      }
+    }
+    unsigned num_emitted = 0, next_cycle = 0;
+    while (num_emitted < n) {
+      if (s.ready.empty()) {
+	// -- only cycles are left: the old value of one phi node is
+	//    saved and its readers use it
+	while (s.emitted[next_cycle] || s.pending_reads[next_cycle] == 0) {
+	  ++next_cycle;
 	}
+	saveOldValue(*s.copies[next_cycle].first);
+	ClamStats::count("CFG.Phi.Temporaries");
+	s.pending_reads[next_cycle] = 0;
+	s.ready.push_back(next_cycle);
+      }
+      unsigned i = s.ready.back();
+      s.ready.pop_back();
+      emitCopy(*s.copies[i].first, *s.copies[i].second);
+      s.emitted[i] = true;
+      ++num_emitted;
+      auto it = s.copy_index.find(s.copies[i].second);
+      if (it != s.copy_index.end() && !s.emitted[it->second] &&
+	  s.pending_reads[it->second] > 0 &&
+	  --s.pending_reads[it->second] == 0) {
+	s.ready.push_back(it->second);
       }
     }
   }
@@ -602,6 +708,20 @@ class CrabInstVisitor : public InstVisitor<CrabInstVisitor> {
   sea_dsa::ShadowMem *m_sm;
   const DataLayout *m_dl;
   const TargetLibraryInfo *m_tli;
+  crabCalleeTable &m_callees;
+  // summaries of the callees (it can be null)
+  const FunctionSummaries *m_summaries;
+  CfgBuilderDiagnostics &m_diags;
+  // memory SSA form built from the regions (it can be null)
+  const RegionMemorySSA *m_memssa;
+  // regions of the pointers of the function (it can be null)
+  const HeapAbstraction::RegionMap *m_regions;
+  // whether the heap abstraction can return regions. If not (no
+  // heap analysis) memory is translated without querying it.
+  bool m_heap_regions;
+  // whether a pointer can have a region (from the heap abstraction
+  // or from ShadowMem)
+  bool m_has_regions;
   basic_block_t &m_bb;
   unsigned int m_object_id;
   bool m_has_seahorn_fail;
@@ -616,6 +736,12 @@ class CrabInstVisitor : public InstVisitor<CrabInstVisitor> {
   // to initialize arrays
   std::set<Region> &m_init_regions;
   const CrabBuilderParams &m_params;
+  // GEPs of the block with symbolic offset, by source element type,
+  // pointer operand and indexes. Two GEPs with the same key compute
+  // the same value so the second one reuses the variable of the
+  // first one.
+  using gep_key_t = std::pair<const Type*, std::vector<const Value*>>;
+  std::map<gep_key_t, var_t> m_gep_cache;
 
   unsigned fieldOffset(const StructType *t, unsigned field) const;
   uint64_t storageSize(const Type *t) const;
@@ -655,8 +781,13 @@ class CrabInstVisitor : public InstVisitor<CrabInstVisitor> {
   void doMemIntrinsic(MemIntrinsic &I);
   void doGlobalInitializer(CallInst &I);
   void doVerifierCall(CallInst &I);
+  void doSummaryCall(CallInst &I, const FunctionSummaries::Summary &summary);
   void doGep(GetElementPtrInst &I, unsigned max_index_bitwidth,
 	     var_t lhs, llvm::Optional<var_t> base);
+  // Return the variable of a previous GEP of the block with the same
+  // key as I or null
+  const var_t *findGep(const GetElementPtrInst &I) const;
+  void cacheGep(const GetElementPtrInst &I, var_t v);
   void doStoreInst(StoreInst &I, bool is_singleton,
 		   llvm::Optional<var_t> new_var, var_t old_var,
 		   crab_lit_ref_t val, Region reg);
@@ -672,11 +803,23 @@ class CrabInstVisitor : public InstVisitor<CrabInstVisitor> {
       return nullptr;
     }
   }
+
+  // Region of ptr used by user
+  Region getRegion(Instruction *user, Value *ptr) const {
+    if (!m_has_regions) {
+      return Region();
+    }
+    return get_region(m_mem, getShadowMem(), *m_dl, user, ptr, m_regions);
+  }
   
 public:
   CrabInstVisitor(
       crabLitFactory &lfac, HeapAbstraction &mem, sea_dsa::ShadowMem *sm,
-      const DataLayout *dl, const TargetLibraryInfo *tli, basic_block_t &bb,
+      const DataLayout *dl, const TargetLibraryInfo *tli,
+      crabCalleeTable &callees, const FunctionSummaries *summaries,
+      CfgBuilderDiagnostics &diags,
+      const RegionMemorySSA *memssa,
+      const HeapAbstraction::RegionMap *regions, basic_block_t &bb,
       llvm::DenseMap<const statement_t *, const llvm::Instruction *> &rev_map,
       std::set<Region> &init_regions,
       DenseMap<const GetElementPtrInst*, var_t> &gep_map,
@@ -703,6 +846,8 @@ public:
   void visitGetElementPtrInst(GetElementPtrInst &I);
   void visitStoreInst(StoreInst &I);
   void visitLoadInst(LoadInst &I);
+  // Check that ptr is not null before I dereferences it
+  void addNullCheck(const Value &ptr, Instruction &I);
   void visitAllocaInst(AllocaInst &I);
   void visitCallInst(CallInst &I);
   void visitUnreachableInst(UnreachableInst &I);
@@ -798,20 +943,17 @@ bool CrabInstVisitor::AllUsesAreNonTrackMem(Value *V) const {
   for (auto &U : V->uses()) {
     if (StoreInst *SI = dyn_cast<StoreInst>(U.getUser())) {
       if (isa<Instruction>(V)) {
-        if (get_region(m_mem, getShadowMem(), *m_dl, 
-		       SI, SI->getPointerOperand()).isUnknown() &&
+        if (getRegion(SI, SI->getPointerOperand()).isUnknown() &&
             (!SI->getValueOperand()->getType()->isPointerTy() ||
-             get_region(m_mem, getShadowMem(), *m_dl,
-			SI, SI->getValueOperand()).isUnknown()))
+             getRegion(SI, SI->getValueOperand()).isUnknown()))
           continue;
       }
       return false;
     } else if (LoadInst *LI = dyn_cast<LoadInst>(U.getUser())) {
       if (Instruction *I = dyn_cast<Instruction>(V)) {
-        if (get_region(m_mem, getShadowMem(), *m_dl,
-		       LI, LI->getPointerOperand()).isUnknown() &&
+        if (getRegion(LI, LI->getPointerOperand()).isUnknown() &&
             (!I->getType()->isPointerTy() ||
-             get_region(m_mem, getShadowMem(), *m_dl, LI, LI).isUnknown()))
+             getRegion(LI, LI).isUnknown()))
           continue;
       }
       return false;
@@ -1156,7 +1298,7 @@ void CrabInstVisitor::doMemIntrinsic(MemIntrinsic &I) {
   MemCpyInst  *MCI = dyn_cast<MemCpyInst>(&I);
   MemMoveInst *MVI = dyn_cast<MemMoveInst>(&I);
   Value *dst = I.getDest();
-  Region dst_reg = get_region(m_mem, getShadowMem(), *m_dl, &I, dst);
+  Region dst_reg = getRegion(&I, dst);
   if (dst_reg.isUnknown()) {
     return;
   }
@@ -1164,13 +1306,34 @@ void CrabInstVisitor::doMemIntrinsic(MemIntrinsic &I) {
   const statement_t *crab_stmt = nullptr;
   if (MCI || MVI) {
     /** 
-     * TODO: to be more precise we need from crab something like
-     * array_copy that copies len bytes from dst to src. We could use
-     * array_assign if we know statically that src and dst have the
-     * same size and the memory transfer function copies the entire
-     * memory region. For memmove, we would also need to prove that
-     * source and destination do not overlap.
+     * If the transfer copies a whole object into a local object of
+     * the same type, and the regions of the destination only contain
+     * that object, then each region of the destination is replaced
+     * with the region of the source at the same offset. The objects
+     * are different so the source and the destination of a memmove
+     * do not overlap.
+     *
+     * TODO: to be more precise in the other cases we need from crab
+     * something like array_copy that copies len bytes from dst to
+     * src.
      **/
+    std::vector<std::pair<Region, Region>> copies;
+    if (m_regions &&
+	get_transfer_regions(m_mem, *m_dl, *cast<MemTransferInst>(&I),
+			     *m_regions, copies)) {
+      for (auto &c: copies) {
+	var_t c_dst = m_lfac.mkArrayVar(c.first);
+	if (c.second.isUnknown() ||
+	    get_singleton_value(c.second, m_params.lower_singleton_aliases)) {
+	  m_bb.havoc(c_dst);
+	} else {
+	  m_bb.array_assign(c_dst, m_lfac.mkArrayVar(c.second));
+	}
+      }
+      ClamStats::count("CFG.MemTransfer.Translated");
+      return;
+    }
+    ClamStats::count("CFG.MemTransfer.Skipped");
     if (MCI)      
       CLAM_WARNING("Skipped memcpy instruction");
     else 
@@ -1226,12 +1389,14 @@ void CrabInstVisitor::doMemIntrinsic(MemIntrinsic &I) {
   }
 }
 
-/* verifier.zero_initializer(v) or verifier.int_initializer(v,k) 
+/* verifier.zero_initializer(v) or verifier.int_initializer(v,k) or
+   verifier.range_initializer(v,min,max)
 
    This special treatment for global initializers is mostly needed for
    array smashing-like domains. zero_initializer for arrays is still
    useful for other domains because it can avoid too many array stores
-   if the array to be initialized is large.
+   if the array to be initialized is large. range_initializer
+   summarizes a large array of integers by the range of its elements.
 */
 void CrabInstVisitor::doGlobalInitializer(CallInst &I) {
   CallSite CS(&I);
@@ -1247,7 +1412,7 @@ void CrabInstVisitor::doGlobalInitializer(CallInst &I) {
   Type *ty = cast<PointerType>(v->getType())->getElementType();
 
   auto sm = getShadowMem();
-  auto r = get_region(m_mem, sm, *m_dl, &I, v);
+  auto r = getRegion(&I, v);
   auto getShadowVar = [&sm](CallInst &I, Value* v) {
     if (sm) {
       Value* shadowVar = nullptr;
@@ -1271,6 +1436,21 @@ void CrabInstVisitor::doGlobalInitializer(CallInst &I) {
       }
     }
 
+    /* verifier.range_initializer(v,min,max) */
+    crab_lit_ref_t max_ref = nullptr;
+    if (CS.arg_size() == 3) {
+      ref = m_lfac.getLit(*(CS.getArgument(1)));
+      max_ref = m_lfac.getLit(*(CS.getArgument(2)));
+      if (!ref || !max_ref || !ref->isInt() || ref->isVar() ||
+	  !max_ref->isInt() || max_ref->isVar()) {
+	return;
+      }
+      if (m_lfac.getIntCst(ref) == m_lfac.getIntCst(max_ref)) {
+	// all the elements are equal: same as int_initializer
+	max_ref = nullptr;
+      }
+    }
+
     auto varShadowOpt = getShadowVar(I, v);
     if (varShadowOpt.hasValue() && !varShadowOpt.getValue()) {
       // something went wrong with shadow mem. Abort ...
@@ -1282,9 +1462,13 @@ void CrabInstVisitor::doGlobalInitializer(CallInst &I) {
       var_t a = (varShadowOpt.hasValue() ?
 		 m_lfac.mkArraySingletonVar(r, varShadowOpt.getValue()) :
 		 m_lfac.mkArraySingletonVar(r));
-      if (isInteger(ty)) {
+      if (isInteger(ty) && max_ref) {
+        m_bb.havoc(a);
+        m_bb.assume(a >= m_lfac.getIntCst(ref));
+        m_bb.assume(a <= m_lfac.getIntCst(max_ref));
+      } else if (isInteger(ty)) {
         number_t init_val =
-            ((CS.arg_size() == 2) && !ref->isVar() ? m_lfac.getIntCst(ref)
+            ((CS.arg_size() >= 2) && !ref->isVar() ? m_lfac.getIntCst(ref)
                                                    : number_t(0));
         m_bb.assign(a, init_val);
       } else if (isBool(ty)) {
@@ -1312,8 +1496,8 @@ void CrabInstVisitor::doGlobalInitializer(CallInst &I) {
       var_t a = (varShadowOpt.hasValue() ?
 		 m_lfac.mkArrayVar(r, varShadowOpt.getValue()) :
 		 m_lfac.mkArrayVar(r));
-      /* verifier.int_initializer(v,k) */
-      if (CS.arg_size() == 2) {
+      /* verifier.int_initializer(v,k) or verifier.range_initializer(v,k,k) */
+      if (CS.arg_size() >= 2) {
         if (ref->isInt()) {
           init_val = m_lfac.getIntCst(ref);
         } else if (ref->isBool()) {
@@ -1355,7 +1539,21 @@ void CrabInstVisitor::doGlobalInitializer(CallInst &I) {
 	  elem_size = storageSize(cast<ArrayType>(ty)->getElementType());
 	  lin_exp_t ub_idx = lb_idx + lin_exp_t(
 			     cast<ArrayType>(ty)->getNumElements() * elem_size - 1);
-	  if (m_params.use_array_smashing) {	  
+	  if (max_ref) {
+	    // All the elements of the array are in [min,max]. Only the
+	    // smashed array can be initialized with one statement
+	    // because all its elements are represented by the same
+	    // variable. Otherwise, the elements are left unknown.
+	    if (m_params.use_array_smashing) {
+	      unsigned bitwidth =
+		cast<ArrayType>(ty)->getElementType()->getIntegerBitWidth();
+	      var_t elem = m_lfac.mkIntVar(bitwidth);
+	      m_bb.assume(elem >= m_lfac.getIntCst(ref));
+	      m_bb.assume(elem <= m_lfac.getIntCst(max_ref));
+	      m_bb.array_init(a, lb_idx, ub_idx, elem, elem_size);
+	      m_bb.havoc(elem);
+	    }
+	  } else if (m_params.use_array_smashing) {	  
 	    m_bb.array_init(a, lb_idx, ub_idx, init_val, elem_size);
 	  } else {
 	    m_bb.array_store_range(a, lb_idx, ub_idx, init_val, elem_size);	    
@@ -1367,6 +1565,54 @@ void CrabInstVisitor::doGlobalInitializer(CallInst &I) {
   }
 }
 
+/* call to a function with a summary: assume the summary */
+void CrabInstVisitor::doSummaryCall(CallInst &I,
+                                    const FunctionSummaries::Summary &summary) {
+  if (summary.is_bottom) {
+    m_bb.assume(lin_cst_t::get_false());
+    return;
+  }
+  CallSite CS(&I);
+  bool has_ret = DoesCallSiteReturn(I, m_params) &&
+                 ShouldCallSiteReturn(I, m_params);
+  for (auto &c : summary.csts) {
+    lin_exp_t e(c.constant);
+    bool is_tracked = true;
+    for (auto &t : c.terms) {
+      if (t.arg == FunctionSummaries::RET && !has_ret) {
+        is_tracked = false;
+        break;
+      }
+      const Value *v =
+          (t.arg == FunctionSummaries::RET ? &I : CS.getArgument(t.arg));
+      crab_lit_ref_t ref =
+          isTracked(*v, m_params) ? m_lfac.getLit(*v) : nullptr;
+      if (!ref || !ref->isInt()) {
+        is_tracked = false;
+        break;
+      }
+      e = e + t.coef * m_lfac.getExp(ref);
+    }
+    if (!is_tracked) {
+      continue;
+    }
+    lin_cst_t cst;
+    if (c.kind == "eq") {
+      cst = lin_cst_t(e == number_t(0));
+    } else if (c.kind == "ne") {
+      cst = lin_cst_t(e != number_t(0));
+    } else if (c.kind == "lt") {
+      cst = lin_cst_t(e < number_t(0));
+    } else {
+      cst = lin_cst_t(e <= number_t(0));
+    }
+    if (!c.is_signed) {
+      cst.set_unsigned();
+    }
+    m_bb.assume(cst);
+  }
+}
+
 /* special functions for verification */
 void CrabInstVisitor::doVerifierCall(CallInst &I) {
   CallSite CS(&I);
@@ -1474,14 +1720,23 @@ void CrabInstVisitor::doVerifierCall(CallInst &I) {
 
 CrabInstVisitor::CrabInstVisitor(
     crabLitFactory &lfac, HeapAbstraction &mem, sea_dsa::ShadowMem *sm,
-    const DataLayout *dl, const TargetLibraryInfo *tli, basic_block_t &bb,
+    const DataLayout *dl, const TargetLibraryInfo *tli,
+    crabCalleeTable &callees, const FunctionSummaries *summaries,
+    CfgBuilderDiagnostics &diags,
+    const RegionMemorySSA *memssa,
+    const HeapAbstraction::RegionMap *regions, basic_block_t &bb,
     llvm::DenseMap<const statement_t *, const llvm::Instruction *> &rev_map,
     std::set<Region> &init_regions,
     DenseMap<const GetElementPtrInst*, var_t> &gep_map,
     const CrabBuilderParams &params)
-  : m_lfac(lfac), m_mem(mem), m_sm(sm), m_dl(dl), m_tli(tli), m_bb(bb), m_object_id(0),
+  : m_lfac(lfac), m_mem(mem), m_sm(sm), m_dl(dl), m_tli(tli), m_callees(callees),
+    m_summaries(summaries), m_diags(diags), m_memssa(memssa), m_regions(regions),
+    m_heap_regions(mem.getClassId() != HeapAbstraction::ClassId::DUMMY),
+    m_has_regions(m_heap_regions), m_bb(bb), m_object_id(0),
     m_has_seahorn_fail(false), m_gep_map(gep_map), m_rev_map(rev_map),
-    m_init_regions(init_regions), m_params(params) {}
+    m_init_regions(init_regions), m_params(params) {
+  m_has_regions |= (getShadowMem() != nullptr);
+}
 
 /// I is already translated if it is the condition of a branch or
 /// a select's condition.  Here we cover cases where I is an
@@ -1688,8 +1943,33 @@ void CrabInstVisitor::visitSelectInst(SelectInst &I) {
   crab_lit_ref_t lhs = m_lfac.getLit(I);
   assert(lhs && lhs->isVar());
 
+  if (!m_params.native_select) {
+    // -- baseline: the select is not modeled
+    havoc(lhs->getVar(), m_bb, m_params.include_useless_havoc);
+    return;
+  }
+  
   if (isPointer(I, m_params)) {
-    // We don't even bother with pointers
+    // Crab does not have a pointer select so we only translate the
+    // cases where the selected pointer is known.
+    Value *v = nullptr;
+    if (ConstantInt *ci = dyn_cast<ConstantInt>(I.getCondition())) {
+      v = (ci->isOne() ? I.getTrueValue() : I.getFalseValue());
+    } else if (I.getTrueValue() == I.getFalseValue()) {
+      v = I.getTrueValue();
+    }
+    if (v) {
+      crab_lit_ref_t op = m_lfac.getLit(*v);
+      if (op && op->isPtr()) {
+        if (m_lfac.isPtrNull(op)) {
+          m_bb.ptr_null(lhs->getVar());
+        } else {
+          assert(op->isVar());
+          m_bb.ptr_assign(lhs->getVar(), op->getVar(), number_t(0));
+        }
+        return;
+      }
+    }
     CLAM_WARNING("skipped " << I << "\n"
                             << "Enable --lower-select.");
     havoc(lhs->getVar(), m_bb, m_params.include_useless_havoc);
@@ -1762,7 +2042,7 @@ void CrabInstVisitor::visitSelectInst(SelectInst &I) {
       m_bb.bool_select(lhs->getVar(), c->getVar(), op1->getVar(), ff_v);
     } else {
       m_bb.bool_select(lhs->getVar(), c->getVar(), op1->getVar(),
-                       op1->getVar());
+                       op2->getVar());
     }
   } else if (isInteger(I)) {
 
@@ -1954,6 +2234,36 @@ void CrabInstVisitor::doGep(GetElementPtrInst &I, unsigned max_index_bitwidth,
   }
 }
 
+static bool getGepKey(const GetElementPtrInst &I,
+		      std::pair<const Type*, std::vector<const Value*>> &key) {
+  // constant offsets are translated to a single statement
+  if (I.hasAllConstantIndices()) {
+    return false;
+  }
+  key.first = I.getSourceElementType();
+  key.second.reserve(I.getNumOperands());
+  for (const Value *op: I.operand_values()) {
+    key.second.push_back(op);
+  }
+  return true;
+}
+
+const var_t *CrabInstVisitor::findGep(const GetElementPtrInst &I) const {
+  gep_key_t key;
+  if (!getGepKey(I, key)) {
+    return nullptr;
+  }
+  auto it = m_gep_cache.find(key);
+  return (it != m_gep_cache.end() ? &(it->second) : nullptr);
+}
+
+void CrabInstVisitor::cacheGep(const GetElementPtrInst &I, var_t v) {
+  gep_key_t key;
+  if (getGepKey(I, key)) {
+    m_gep_cache.insert({std::move(key), v});
+  }
+}
+
 /* 
  The translation of GEP is different depending on whether the
  precision level is PTR or ARR. With PTR the translation should not
@@ -1994,7 +2304,14 @@ void CrabInstVisitor::visitGetElementPtrInst(GetElementPtrInst &I) {
     }
     assert(ptr->isVar());
 
+    if (const var_t *prev = findGep(I)) {
+      m_bb.ptr_assign(lhs->getVar(), *prev, number_t(0));
+      CRAB_LOG("cfg-gep", crab::outs() << "-- " << lhs->getVar() << ":=" << *prev
+	                               << " (same GEP)\n");
+      return;
+    }
     doGep(I, bitwidth, lhs->getVar(), ptr->getVar());
+    cacheGep(I, lhs->getVar());
     
   } else if (m_params.precision_level == crab::cfg::ARR) {
     /*
@@ -2029,7 +2346,7 @@ void CrabInstVisitor::visitGetElementPtrInst(GetElementPtrInst &I) {
       if (auto sm = getShadowMem()) {
 	CLAM_WARNING("TODO: precise translation of GEP if shadow mem is used");
       } else {
-	Region r = get_region(m_mem, getShadowMem(), *m_dl, &I, &I);
+	Region r = getRegion(&I, &I);
 	if (r.isUnknown()) {
 	  // we don't keep track of the memory region, we bail out ...
 	  return;
@@ -2048,9 +2365,15 @@ void CrabInstVisitor::visitGetElementPtrInst(GetElementPtrInst &I) {
     
     assert(m_gep_map.find(&I) == m_gep_map.end());
     if (isBasePtr) {
+      if (const var_t *prev = findGep(I)) {
+	// the offset is already in a variable
+	m_gep_map.insert(std::make_pair(&I, *prev));
+	return;
+      }
       var_t shadowV(m_lfac.get_vfac().get(), crab::INT_TYPE, bitwidth);
       m_gep_map.insert(std::make_pair(&I, shadowV));
       doGep(I, bitwidth, shadowV, llvm::None);
+      cacheGep(I, shadowV);
     } else {
       var_t shadowV = getUnconstrainedArrayIdxVar(m_lfac.get_vfac(), bitwidth);      
       CRAB_LOG("cfg-array-index",
@@ -2151,6 +2474,22 @@ void CrabInstVisitor::doStoreInst(StoreInst &I, bool is_singleton,
   }
 }
   
+void CrabInstVisitor::addNullCheck(const Value &ptr, Instruction &I) {
+  if (isa<ConstantExpr>(ptr)) {
+    return;
+  }
+  crab_lit_ref_t ref = m_lfac.getLit(ptr);
+  if (!ref || !ref->isPtr()) {
+    return;
+  }
+  if (m_lfac.isPtrNull(ref)) {
+    m_bb.ptr_assertion(ptr_cst_t::mk_false(), getDebugLoc(&I));
+  } else {
+    m_bb.ptr_assertion(ptr_cst_t::mk_diseq_null(ref->getVar()), getDebugLoc(&I));
+  }
+  ClamStats::count("CFG.NullChecks");
+}
+
 void CrabInstVisitor::visitStoreInst(StoreInst &I) {
   /** 
    * The LLVM store instruction will be translated to *either*: (a)
@@ -2165,6 +2504,10 @@ void CrabInstVisitor::visitStoreInst(StoreInst &I) {
    * language.
   **/
 
+  if (m_params.null_checks) {
+    addNullCheck(*I.getPointerOperand(), I);
+  }
+
   if (isa<ConstantExpr>(I.getPointerOperand()) ||
       isa<ConstantExpr>(I.getValueOperand())) {
     // We don't handle constant expressions.
@@ -2193,8 +2536,7 @@ void CrabInstVisitor::visitStoreInst(StoreInst &I) {
       // expressions are lowered.
       CLAM_ERROR("unexpected value operand of store instruction");
     }
-    Region r = get_region(m_mem, getShadowMem(), *m_dl,
-			  &I, I.getPointerOperand());
+    Region r = getRegion(&I, I.getPointerOperand());
     if (!r.isUnknown()) {
       bool lowerToScalar = get_singleton_value(r, m_params.lower_singleton_aliases);
       if (auto sm = getShadowMem()) {
@@ -2210,6 +2552,10 @@ void CrabInstVisitor::visitStoreInst(StoreInst &I) {
 		     m_lfac.mkArrayVar(r, defUsePair.second)),
 		    val, r);
 	
+      } else if (Optional<var_t> def = (m_memssa && !lowerToScalar ?
+					m_memssa->getDef(I) : llvm::None)) {
+	// Memory SSA form from the regions
+	doStoreInst(I, lowerToScalar, def, m_memssa->getUse(I).getValue(), val, r);
       } else {
 	doStoreInst(I, lowerToScalar, llvm::None,
 		    (lowerToScalar ?
@@ -2284,6 +2630,10 @@ void CrabInstVisitor::visitLoadInst(LoadInst &I) {
     This case is symmetric to StoreInst.
    */
 
+  if (m_params.null_checks) {
+    addNullCheck(*I.getPointerOperand(), I);
+  }
+
   if (!isTracked(I, m_params)) {
     return;
   }
@@ -2314,8 +2664,7 @@ void CrabInstVisitor::visitLoadInst(LoadInst &I) {
     if (!lhs || !lhs->isVar()) {
       CLAM_ERROR("unexpected lhs of load instruction");
     }
-    Region r = get_region(m_mem, getShadowMem(), *m_dl,
-			  &I, I.getPointerOperand());
+    Region r = getRegion(&I, I.getPointerOperand());
     if (!(r.isUnknown())) {
       bool lowerToScalar = get_singleton_value(r, m_params.lower_singleton_aliases);
       if (auto sm = getShadowMem()) {
@@ -2325,6 +2674,10 @@ void CrabInstVisitor::visitLoadInst(LoadInst &I) {
 		    m_lfac.mkArraySingletonVar(r, &useV):
 		    m_lfac.mkArrayVar(r, &useV)),
 		   r);
+      } else if (Optional<var_t> use = (m_memssa && !lowerToScalar ?
+					m_memssa->getUse(I) : llvm::None)) {
+	// Memory SSA form from the regions
+	doLoadInst(I, lowerToScalar, lhs->getVar(), use.getValue(), r);
       } else {
 	doLoadInst(I, lowerToScalar, lhs->getVar(),
 		   (lowerToScalar ?
@@ -2353,7 +2706,7 @@ void CrabInstVisitor::visitAllocaInst(AllocaInst &I) {
     assert(lhs && lhs->isVar());
     m_bb.ptr_new_object(lhs->getVar(), m_object_id++);
   } else if (m_lfac.get_track() == ARR && m_params.use_array_smashing) { 
-    Region r = get_region(m_mem, getShadowMem(), *m_dl, &I, &I);
+    Region r = getRegion(&I, &I);
     if (!r.isUnknown()) {
       // Nodes which do not have an explicit initialization are
       // initially undefined. Instead, we assume they are zero
@@ -2401,9 +2754,8 @@ void CrabInstVisitor::visitCallInst(CallInst &I) {
       // -- inline asm: do nothing
     } else {
       // -- unresolved indirect call
-      CLAM_WARNING("skipped indirect call. " <<
-		   "Either --devirt-functions was not used or " <<
-		   "indirect call cannot be resolved.");
+      m_diags.add(CfgBuilderDiagnostics::UNRESOLVED_INDIRECT_CALL,
+		  *I.getParent()->getParent(), I);
 
       if (DoesCallSiteReturn(I, m_params) &&
           ShouldCallSiteReturn(I, m_params)) {
@@ -2416,29 +2768,19 @@ void CrabInstVisitor::visitCallInst(CallInst &I) {
     return;
   }
 
-  if (callee->getName().startswith("shadow.mem")) {
-    return;
-  }
-
-  if (callee->getName().equals("seahorn.fn.enter"))
+  switch (m_callees.getKind(I, *callee)) {
+  case CALLEE_SHADOW_MEM:
     return;
-
-  if (isVerifierCall(*callee)) {
+  case CALLEE_VERIFIER:
     doVerifierCall(I);
     return;
-  }
-
-  if (isAllocationFn(&I, m_tli)) {
+  case CALLEE_ALLOCATOR:
     doAllocFn(I);
     return;
-  }
-
-  if (isZeroInitializer(*callee) || isIntInitializer(*callee)) {
+  case CALLEE_INITIALIZER:
     doGlobalInitializer(I);
     return;
-  }
-
-  if (callee->isIntrinsic()) {
+  case CALLEE_INTRINSIC:
     if (MemIntrinsic *MI = dyn_cast<MemIntrinsic>(&I)) {
       doMemIntrinsic(*MI);
     } else {
@@ -2451,9 +2793,16 @@ void CrabInstVisitor::visitCallInst(CallInst &I) {
       }
     }
     return;
+  case CALLEE_ORDINARY:
+    break;
   }
 
-  bool is_external = callee->isDeclaration() || callee->isVarArg() || !m_params.interprocedural;
+  // -- a function with a summary is translated as an external call
+  //    even if its code is available
+  const FunctionSummaries::Summary *summary =
+      (m_summaries ? m_summaries->lookup(*callee) : nullptr);
+  bool is_external = summary || callee->isDeclaration() ||
+                     callee->isVarArg() || !m_params.interprocedural;
   if (is_external && !isCrabIntrinsic(*callee)) {
     /**
      * If external or we don't perform inter-procedural reasoning
@@ -2474,8 +2823,14 @@ void CrabInstVisitor::visitCallInst(CallInst &I) {
     // -- havoc all modified regions by the callee
     // Note that even if the code is not available for the callee, the
     // pointer analysis might be able to model its pointer semantics.
-    if (m_lfac.get_track() == ARR) {
-      RegionVec mods = get_modified_regions(m_mem, I);
+    // The havocs are skipped if the callee does not write memory
+    // according to its model or its attributes.
+    if (m_lfac.get_track() == ARR && m_heap_regions) {
+      SmallRegionVec mods = get_modified_regions(m_mem, I);
+      if (!mods.empty() && !m_callees.mayWriteMemory(I, *callee)) {
+	ClamStats::count("CFG.ExternalCall.SkippedHavocs", mods.size());
+	mods.clear();
+      }
       for (auto a : mods) {
         if (get_singleton_value(a, m_params.lower_singleton_aliases))
           m_bb.havoc(m_lfac.mkArraySingletonVar(a));
@@ -2484,6 +2839,11 @@ void CrabInstVisitor::visitCallInst(CallInst &I) {
       }
     }
 
+    if (summary) {
+      doSummaryCall(I, *summary);
+      return;
+    }
+
     CLAM_WARNING("Call to external function " << callee->getName() << ". "  
 		 << "Havocing the return value and possibly its modified memory regions "
 		 << "if the pointer analysis models the external function");
@@ -2508,6 +2868,12 @@ void CrabInstVisitor::visitCallInst(CallInst &I) {
    *    - a_i1,...,a_in are read-only and modified arrays by foo.
    *    - a_o1,...,a_om are modified and new arrays created inside foo.
    *
+   * The arrays are only the regions read, modified or created by foo
+   * at this callsite. CFG.Callsite.Params counts the distinct
+   * parameters of the callsite: the tracked actuals, the lhs and each
+   * of those regions once, although a modified region is both an
+   * input and an output. CFG.Callsite.Regions counts the regions.
+   *
    * TODOX: version for memory ssa form
    **/
 
@@ -2554,12 +2920,19 @@ void CrabInstVisitor::visitCallInst(CallInst &I) {
     }
   }
 
-  if (m_lfac.get_track() == ARR) {
+  // -- each region is counted once: the modified and new regions are
+  //    the array outputs and the only read regions are the rest
+  const unsigned num_scalar_inputs = inputs.size();
+  const unsigned num_scalar_outputs = outputs.size();
+  unsigned num_regions = 0;
+
+  if (m_lfac.get_track() == ARR && m_heap_regions) {
     // -- add the input and output array parameters a_i1,...,a_in
     // -- and a_o1,...,a_om.
-    RegionVec onlyreads = get_read_only_regions(m_mem, I);
-    RegionVec mods = get_modified_regions(m_mem, I);
-    RegionVec news = get_new_regions(m_mem, I);
+    SmallRegionVec onlyreads = get_read_only_regions(m_mem, I);
+    SmallRegionVec mods = get_modified_regions(m_mem, I);
+    SmallRegionVec news = get_new_regions(m_mem, I);
+    const HeapAbstraction::RegionSet &news_set = m_mem.getNewRegionSet(I);
 
     CRAB_LOG("cfg-mem", llvm::errs()
                             << "Callsite " << I << "\n"
@@ -2582,7 +2955,7 @@ void CrabInstVisitor::visitCallInst(CallInst &I) {
 
     // -- add modified regions as both input and output parameters
     for (auto a : mods) {
-      if (std::find(news.begin(), news.end(), a) != news.end()) {
+      if (news_set.test(a.get_id())) {
         continue;
       }
 
@@ -2606,12 +2979,16 @@ void CrabInstVisitor::visitCallInst(CallInst &I) {
     for (auto a : news) {
       outputs.push_back(m_lfac.mkArrayVar(a));
     }
+    num_regions = onlyreads.size() + (outputs.size() - num_scalar_outputs);
   }
 
   // -- Finally, add the callsite or crab intrinsic
   if (isCrabIntrinsic(*callee)) {
     m_bb.intrinsic(getCrabIntrinsicName(*callee), outputs, inputs);
   } else {
+    ClamStats::count("CFG.Callsite.Params",
+                     num_scalar_inputs + num_scalar_outputs + num_regions);
+    ClamStats::count("CFG.Callsite.Regions", num_regions);
     m_bb.callsite(callee->getName().str(), outputs, inputs);
   }
 }
@@ -2638,9 +3015,11 @@ namespace clam {
 class CfgBuilderImpl {
 public:
   CfgBuilderImpl(const llvm::Function &func, llvm_variable_factory &vfac,
+                 crabLitCache &lit_cache,
                  HeapAbstraction &mem, sea_dsa::ShadowMem *sm,
 		 const llvm::TargetLibraryInfo *tli,
-		 const CrabBuilderParams &params);
+		 crabCalleeTable &callees, const FunctionSummaries *summaries,
+		 CfgBuilderDiagnostics &diags, const CrabBuilderParams &params);
 
   void build_cfg();
 
@@ -2653,6 +3032,13 @@ public:
   // return crab control flow graph
   cfg_t &get_cfg();
 
+  const llvm::Function &get_func() const { return m_func; }
+
+  const CrabBuilderParams &get_params() const { return m_params; }
+
+  // inputs and outputs of the function declaration of the cfg, sorted
+  const std::vector<var_t> &get_func_params() const { return m_func_params; }
+
   // map a llvm basic block to a crab basic block label
   basic_block_label_t get_crab_basic_block(const llvm::BasicBlock *bb) const;
 
@@ -2671,6 +3057,10 @@ public:
   // instruction is not mapped to a LLVM instruction.
   const llvm::Instruction *get_instruction(const statement_t &s) const;
 
+  const CfgBuilder::array_repr_map_t &get_array_reprs() const {
+    return m_array_reprs;
+  }
+
 private:
   // map from a llvm basic block to a crab basic block id
   using node_to_crab_block_map_t =
@@ -2697,6 +3087,8 @@ private:
   llvm::Function &m_func;
   // literal factory
   crabLitFactory m_lfac;
+  // literals shared by all the CFGs
+  crabLitCache &m_lit_cache;
   // heap analysis for array translation
   HeapAbstraction &m_mem;
   // shadow mem for memory ssa form
@@ -2716,17 +3108,47 @@ private:
   // not the case for array instructions. For those case, we keep
   // explicitly the reverse mapping.
   llvm::DenseMap<const statement_t *, const llvm::Instruction *> m_rev_map;
+  // inputs and outputs of the function declaration, sorted
+  std::vector<var_t> m_func_params;
   // information about LLVM pointers
   const llvm::DataLayout *m_dl;
   const llvm::TargetLibraryInfo *m_tli;
+  // kind of the callees, shared by all the CFGs
+  crabCalleeTable &m_callees;
+  // summaries of the callees, shared by all the CFGs (it can be null)
+  const FunctionSummaries *m_summaries;
+  // warnings that can happen at many sites
+  CfgBuilderDiagnostics &m_diags;
   // cfg builder parameters
   const CrabBuilderParams &m_params;
+  // preferred representation of the arrays of the regions
+  CfgBuilder::array_repr_map_t m_array_reprs;
 
   /// Helpers for build_cfg
 
+  // Tag the regions of the objects of known size allocated or used by
+  // the function (see CrabBuilderParams::array_expand_max_elems)
+  void tag_array_regions();
+
+  // Move the havocs of the loops to their preheaders (see
+  // CrabBuilderParams::hoist_loop_havocs)
+  void hoist_loop_havocs();
+
+  // Print the sizes of the CFG and of the translation (see
+  // CrabBuilderParams::cfg_report)
+  void write_cfg_report() const;
+
   // Given a llvm basic block return its corresponding crab basic block
   basic_block_t *lookup(const llvm::BasicBlock &bb) const;
 
+  // Call translate(i, lfac, rev_map) on each block i of blocks from
+  // several threads
+  void translate_blocks_in_parallel(
+      const std::vector<llvm::BasicBlock *> &blocks,
+      std::function<void(unsigned, crabLitFactory &,
+			 llvm::DenseMap<const statement_t *,
+					const llvm::Instruction *> &)> translate);
+
   void add_block(const llvm::BasicBlock &bb);
 
   void add_edge(const llvm::BasicBlock &src, const llvm::BasicBlock &target);
@@ -2734,6 +3156,11 @@ private:
   basic_block_t *exec_edge(const llvm::BasicBlock &src,
                            const llvm::BasicBlock &target);
 
+  void add_switch_assumptions(const llvm::SwitchInst &SI,
+                              const llvm::BasicBlock &dst, basic_block_t &bb);
+
+  void accelerate_back_edge(const CountingLoop &cl, basic_block_t &bb);
+
   void add_block_in_between(basic_block_t &src, basic_block_t &dst,
                             basic_block_t &between);
 
@@ -2745,16 +3172,21 @@ private:
 
 CfgBuilderImpl::CfgBuilderImpl(const Function &func,
                                llvm_variable_factory &vfac,
+                               crabLitCache &lit_cache,
                                HeapAbstraction &mem, sea_dsa::ShadowMem *sm,
                                const TargetLibraryInfo *tli,
+                               crabCalleeTable &callees,
+                               const FunctionSummaries *summaries,
+                               CfgBuilderDiagnostics &diags,
                                const CrabBuilderParams &params)
     : m_is_cfg_built(false),
       // HACK: it's safe to remove constness because we know that the
       // Builder never modifies the bitcode.
-      m_func(const_cast<Function &>(func)), m_lfac(vfac, params),
-      m_mem(mem), m_sm(sm),
+      m_func(const_cast<Function &>(func)), m_lfac(vfac, params, &lit_cache),
+      m_lit_cache(lit_cache), m_mem(mem), m_sm(sm),
       m_cfg(nullptr), m_id(0), m_dl(&(func.getParent()->getDataLayout())),
-      m_tli(tli), m_params(params) {
+      m_tli(tli), m_callees(callees), m_summaries(summaries), m_diags(diags),
+      m_params(params) {
   m_cfg.reset(new cfg_t(make_crab_basic_block_label(&m_func.getEntryBlock()),
                         m_params.precision_level));
 }
@@ -2781,7 +3213,7 @@ basic_block_label_t
 CfgBuilderImpl::get_crab_basic_block(const BasicBlock *bb) const {
   auto it = m_node_to_crab_map.find(bb);
   if (it == m_node_to_crab_map.end()) {
-    CLAM_ERROR("cannot map llvm basic block ", bb->getName(),
+    CLAM_ERROR("cannot map llvm basic block ", getValueName(*bb),
                " to crab basic block label");
   }
   return it->second;
@@ -2838,19 +3270,11 @@ CfgBuilderImpl::make_crab_basic_block_label(const BasicBlock *bb) {
   return res;
 }
 
-static std::string create_bb_name(unsigned id, std::string prefix = "") {
-  if (prefix == "")
-    prefix = std::string("__@bb_");
-  std::string id_str = std::to_string(id);
-  return prefix + id_str;
-}
-
 basic_block_label_t
 CfgBuilderImpl::make_crab_basic_block_label(const BasicBlock *src,
                                             const BasicBlock *dst) {
   ++m_id;
-  std::string name = create_bb_name(m_id);
-  basic_block_label_t res(src, dst, name, m_id);
+  basic_block_label_t res(src, dst, m_id);
   m_edge_to_crab_map.insert({{src, dst}, res});
   return res;
 }
@@ -2876,9 +3300,9 @@ basic_block_t *CfgBuilderImpl::exec_edge(const BasicBlock &src,
             (ci->isZero() && br->getSuccessor(1) != &dst)) {
           bb.unreachable();
         }
-      } else if (const ConstantExpr *ce = dyn_cast<const ConstantExpr>(&c)) {
-        CLAM_WARNING("Clam cfg builder skipped a branch condition with "
-                     "constant expression");
+      } else if (isa<ConstantExpr>(c)) {
+        m_diags.add(CfgBuilderDiagnostics::CONSTANT_EXPR_BRANCH_COND,
+                    *src.getParent(), *br);
       } else {
         bool isNegated = (br->getSuccessor(1) == &dst);
         bool lower_cond_as_bool = false;
@@ -2887,9 +3311,16 @@ basic_block_t *CfgBuilderImpl::exec_edge(const BasicBlock &src,
             lower_cond_as_bool = true;
           } else if (isInteger(*(CI->getOperand(0))) &&
                      isInteger(*(CI->getOperand(1)))) {
-            auto cst_opt = cmpInstToCrabInt(*CI, m_lfac, isNegated);
-            if (cst_opt.hasValue()) {
-              bb.assume(cst_opt.getValue());
+            std::vector<lin_cst_t> csts;
+            if (unsignedCmpToSignedCsts(*CI, m_lfac, isNegated, csts)) {
+              for (auto &cst: csts) {
+                bb.assume(cst);
+              }
+            } else {
+              auto cst_opt = cmpInstToCrabInt(*CI, m_lfac, isNegated);
+              if (cst_opt.hasValue()) {
+                bb.assume(cst_opt.getValue());
+              }
             }
           } else if (isPointer(*(CI->getOperand(0)), m_params) &&
                      isPointer(*(CI->getOperand(1)), m_params)) {
@@ -2926,70 +3357,391 @@ basic_block_t *CfgBuilderImpl::exec_edge(const BasicBlock &src,
     }
   } else if (const SwitchInst *SI = dyn_cast<SwitchInst>(src.getTerminator())) {
     // switch <value>, label <defaultdest> [ <val>, label <dest> ... ]
-    //
-    // TODO: we do not translate precisely switch instructions. We
-    // simply add an edge from src to dest.
-
-    // To be precise, we need to create a block between src and dest
-    // and add the statement "assume(value == val)" if dest is not
-    // the default block. For the default block, we need to add the
-    // sequence:
-    //      "assume(value != val1); ... ; assume(value != valk);"
-
-    add_edge(src, dst);
+    basic_block_t *crab_src = lookup(src);
+    basic_block_t *crab_dst = lookup(dst);
+    assert(crab_src && crab_dst);
+
+    // Create a new crab block that represents the LLVM edge. There is
+    // only one block even if several cases jump to dst.
+    auto bb_label = make_crab_basic_block_label(&src, &dst);
+    basic_block_t &bb = m_cfg->insert(bb_label);
+    add_block_in_between(*crab_src, *crab_dst, bb);
+    add_switch_assumptions(*SI, dst, bb);
+    return &bb;
   }
   return nullptr;
 }
 
-void CfgBuilderImpl::build_cfg() {
-  if (m_is_cfg_built) {
+// Add in bb the assumptions that hold if SI jumps to dst:
+//
+// - if dst is not the default destination then the value is in
+//   [lo,hi], the smallest interval with all the values of the cases
+//   that jump to dst. If there are fewer values in [lo,hi] that do
+//   not jump to dst than values that jump to dst then they are
+//   excluded with disequalities.
+//
+// - if dst is only the default destination then
+//     "assume(value != val1); ... ; assume(value != valk);"
+//
+// - if dst is the default destination and the destination of some
+//   cases then nothing is assumed.
+void CfgBuilderImpl::add_switch_assumptions(const SwitchInst &SI,
+                                            const BasicBlock &dst,
+                                            basic_block_t &bb) {
+  const Value &c = *SI.getCondition();
+  if (!isInteger(c) || isa<ConstantExpr>(c)) {
     return;
   }
-  m_is_cfg_built = true;
-  crab::ScopedCrabStats __st__("CFG Construction");
-
-  // Sanity check: pass NameValues must have been executed before
-  bool res = checkAllDefinitionsHaveNames(m_func);
-  if (!res) {
-    CLAM_ERROR("All blocks and definitions must have a name");
+  crab_lit_ref_t lit = m_lfac.getLit(c);
+  if (!lit || !lit->isInt()) {
+    return;
+  }
+  lin_exp_t e = m_lfac.getExp(lit);
+
+  std::vector<ikos::z_number> dst_vals, other_vals;
+  for (auto Case : SI.cases()) {
+    // -- through the literals so that the number of a case is built
+    //    once for all the edges of the switch
+    crab_lit_ref_t case_lit = m_lfac.getLit(*Case.getCaseValue());
+    if (!case_lit || !case_lit->isInt()) {
+      // a bignum
+      return;
+    }
+    ikos::z_number n = m_lfac.getIntCst(case_lit);
+    if (Case.getCaseSuccessor() == &dst) {
+      dst_vals.push_back(n);
+    } else {
+      other_vals.push_back(n);
+    }
   }
 
-  // Create create basic block for each LLVM block
-  for (auto &B : m_func) {
-    add_block(B);
+  if (SI.getDefaultDest() == &dst) {
+    if (dst_vals.empty()) {
+      for (auto &n : other_vals) {
+        bb.assume(lin_cst_t(e != number_t(n)));
+      }
+    }
+    return;
   }
 
-  basic_block_t *ret_block = nullptr;
-  var_ref_t ret_val;
-  bool has_seahorn_fail = false;
-  // keep track of initialized regions
-  std::set<Region> init_regions;
-  // For translation of gep if precision level is ARR
-  DenseMap<const GetElementPtrInst*, var_t> gep_map;
-  
-  for (auto &B : m_func) {
-    basic_block_t *bb = lookup(B);
-    if (!bb)
-      continue;
+  if (dst_vals.empty()) {
+    return;
+  }
+  // the values of the cases of a switch are distinct
+  std::sort(dst_vals.begin(), dst_vals.end());
+  const ikos::z_number &lo = dst_vals.front();
+  const ikos::z_number &hi = dst_vals.back();
+  if (lo == hi) {
+    bb.assume(lin_cst_t(e == number_t(lo)));
+    return;
+  }
+  bb.assume(lin_cst_t(e >= number_t(lo)));
+  bb.assume(lin_cst_t(e <= number_t(hi)));
+  ikos::z_number num_holes =
+      (hi - lo) + ikos::z_number(1) - ikos::z_number((int64_t)dst_vals.size());
+  if (num_holes > ikos::z_number(0) &&
+      num_holes <= ikos::z_number((int64_t)dst_vals.size())) {
+    for (unsigned i = 0, sz = dst_vals.size(); i + 1 < sz; ++i) {
+      for (ikos::z_number k = dst_vals[i] + ikos::z_number(1);
+           k < dst_vals[i + 1]; k = k + ikos::z_number(1)) {
+        bb.assume(lin_cst_t(e != number_t(k)));
+      }
+    }
+  }
+}
 
-    // -- build a CFG block ignoring branches, phi-nodes, and return
-    CrabInstVisitor v(m_lfac, m_mem, m_sm, m_dl, m_tli, *bb, m_rev_map,
-		      init_regions, gep_map, m_params);
-    v.visit(B);
-    // hook for seahorn
-    has_seahorn_fail |=
-        (v.has_seahorn_fail() && m_func.getName().equals("main"));
+// Add at the end of bb, the back edge of cl after the copies of the
+// phi nodes, "havoc(i); assume(i >= lb); assume(i <= ub)" where
+// [lb,ub] is the range of the counter i of cl after the increment.
+// The loop head then only joins its entry value with the same range.
+void CfgBuilderImpl::accelerate_back_edge(const CountingLoop &cl,
+                                          basic_block_t &bb) {
+  crab_lit_ref_t i = m_lfac.getLit(*cl.counter);
+  crab_lit_ref_t init = m_lfac.getLit(*cl.init);
+  crab_lit_ref_t bound = m_lfac.getLit(*cl.bound);
+  if (!i || !i->isVar() || !i->isInt() || !init || !init->isInt() ||
+      !bound || !bound->isInt()) {
+    return;
+  }
+  lin_exp_t x(i->getVar());
+  lin_exp_t from = m_lfac.getExp(init) + number_t(cl.step);
+  lin_exp_t to = m_lfac.getExp(bound) + number_t(cl.offset);
+  bb.havoc(i->getVar());
+  if (cl.step > 0) {
+    bb.assume(lin_cst_t(x >= from));
+    bb.assume(lin_cst_t(x <= to));
+  } else {
+    bb.assume(lin_cst_t(x <= from));
+    bb.assume(lin_cst_t(x >= to));
+  }
+  ClamStats::count("CFG.Loops.Accelerated");
+}
 
-    // -- process the exit block of the function and its returned value.
-    if (ReturnInst *RI = dyn_cast<ReturnInst>(B.getTerminator())) {
-      if (ret_block) {
-        // UnifyFunctionExitNodes ensures *at most* one return
-        // instruction per function.
-        CLAM_ERROR("UnifyFunctionExitNodes pass should be run first");
+// Number of consecutive blocks translated by a thread at once
+static const unsigned BLOCK_CHUNK_SIZE = 512;
+
+void CfgBuilderImpl::translate_blocks_in_parallel(
+    const std::vector<BasicBlock *> &blocks,
+    std::function<void(unsigned, crabLitFactory &,
+		       DenseMap<const statement_t *, const Instruction *> &)> translate) {
+  unsigned num_chunks = (blocks.size() + BLOCK_CHUNK_SIZE - 1) / BLOCK_CHUNK_SIZE;
+  unsigned num_threads = std::min(m_params.block_threads, num_chunks);
+  CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Translating " << blocks.size()
+		  << " blocks of " << m_func.getName() << " with "
+		  << num_threads << " threads\n";);
+  llvm_variable_factory &vfac = m_lfac.get_vfac();
+  bool thread_safe = vfac.is_thread_safe();
+  vfac.set_thread_safe(true);
+  std::vector<DenseMap<const statement_t *, const Instruction *>> rev_maps(num_threads);
+  std::atomic<unsigned> next(0);
+  auto worker = [&](unsigned t) {
+    // Each thread has its own literals. A value has the same variable
+    // in all the factories because its name comes from vfac (except
+    // undefined values which get a fresh variable per factory).
+    crabLitFactory lfac(vfac, m_params, &m_lit_cache);
+    for (unsigned c = next++; c < num_chunks; c = next++) {
+      unsigned end = std::min((c + 1) * BLOCK_CHUNK_SIZE, (unsigned) blocks.size());
+      for (unsigned i = c * BLOCK_CHUNK_SIZE; i < end; ++i) {
+	translate(i, lfac, rev_maps[t]);
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  workers.reserve(num_threads);
+  for (unsigned t = 0; t < num_threads; ++t) {
+    workers.emplace_back(worker, t);
+  }
+  for (auto &t: workers) {
+    t.join();
+  }
+  vfac.set_thread_safe(thread_safe);
+  for (auto &rev_map: rev_maps) {
+    m_rev_map.insert(rev_map.begin(), rev_map.end());
+  }
+}
+
+// A havoc of v in a loop is moved to the end of the preheader if
+// all the definitions of v in the CFG are havocs, v is not an input
+// of the function and no statement of the loop reads v. The value of
+// v is then unconstrained everywhere, before and after the move, so
+// the invariants are the same but the loop evaluates fewer
+// statements at each iteration. Only the outermost loop that has a
+// preheader is considered: moving the havoc to the preheader of an
+// inner loop would still evaluate it at each iteration of the outer
+// one.
+//
+// The assumes of the loop are kept: even over loop-invariant
+// variables an assume only holds on the paths that go through its
+// block, and moving it before the loop would strengthen the
+// invariants of the blocks in between and of the exits.
+void CfgBuilderImpl::hoist_loop_havocs() {
+  // -- the variables defined by a statement other than a havoc
+  std::set<var_t> assigned;
+  for (auto &bb : llvm::make_range(m_cfg->begin(), m_cfg->end())) {
+    for (auto &s : llvm::make_range(bb.begin(), bb.end())) {
+      if (!s.is_havoc()) {
+	auto &ls = s.get_live();
+	assigned.insert(ls.defs_begin(), ls.defs_end());
+      }
+    }
+  }
+
+  DominatorTree DT(m_func);
+  LoopInfo LI(DT);
+  unsigned num_hoisted = 0;
+  std::vector<const Loop *> worklist(LI.begin(), LI.end());
+  while (!worklist.empty()) {
+    const Loop *L = worklist.back();
+    worklist.pop_back();
+    const BasicBlock *preheader = L->getLoopPreheader();
+    basic_block_t *pre_bb = preheader ? lookup(*preheader) : nullptr;
+    if (!pre_bb) {
+      worklist.insert(worklist.end(), L->begin(), L->end());
+      continue;
+    }
+    // -- the crab blocks of the loop: its blocks and the blocks of
+    //    the edges between them
+    std::vector<basic_block_t *> loop_bbs;
+    SmallPtrSet<basic_block_t *, 16> seen;
+    for (const BasicBlock *B : L->blocks()) {
+      if (basic_block_t *bb = lookup(*B)) {
+	loop_bbs.push_back(bb);
+      }
+      for (const BasicBlock *S : succs(*B)) {
+	if (L->contains(S)) {
+	  const basic_block_label_t *l = get_crab_basic_block(B, S);
+	  if (l && seen.insert(&m_cfg->get_node(*l)).second) {
+	    loop_bbs.push_back(&m_cfg->get_node(*l));
+	  }
+	}
+      }
+    }
+    std::set<var_t> read;
+    for (basic_block_t *bb : loop_bbs) {
+      for (auto &s : llvm::make_range(bb->begin(), bb->end())) {
+	auto &ls = s.get_live();
+	read.insert(ls.uses_begin(), ls.uses_end());
+      }
+    }
+    std::vector<std::pair<basic_block_t *, const statement_t *>> removed;
+    std::set<var_t> hoisted;
+    for (basic_block_t *bb : loop_bbs) {
+      for (auto &s : llvm::make_range(bb->begin(), bb->end())) {
+	if (!s.is_havoc()) {
+	  continue;
+	}
+	auto &ls = s.get_live();
+	assert(std::distance(ls.defs_begin(), ls.defs_end()) == 1);
+	const var_t &v = *ls.defs_begin();
+	if (assigned.count(v) || read.count(v) ||
+	    std::binary_search(m_func_params.begin(), m_func_params.end(), v)) {
+	  continue;
+	}
+	removed.push_back({bb, &s});
+	hoisted.insert(v);
+      }
+    }
+    for (auto &kv : removed) {
+      m_rev_map.erase(kv.second);
+      kv.first->remove(kv.second);
+    }
+    pre_bb->set_insert_point_back();
+    for (const var_t &v : hoisted) {
+      pre_bb->havoc(v);
+    }
+    num_hoisted += removed.size();
+  }
+  if (num_hoisted > 0) {
+    ClamStats::count("CFG.Loops.HoistedHavocs", num_hoisted);
+    CRAB_LOG("cfg-loops", llvm::errs() << "Function " << m_func.getName() << ": "
+	     << num_hoisted << " havocs moved to the loop preheaders\n");
+  }
+}
+
+void CfgBuilderImpl::build_cfg() {
+  if (m_is_cfg_built) {
+    return;
+  }
+  m_is_cfg_built = true;
+  ClamStats::ScopedFunction __fn__(m_func.getName());
+  ScopedClamStats __st__("CFG Construction");
+  MemTracker::ScopedPhase __phase__("cfg");
+  if (m_params.adaptive_precision) {
+    ClamStats::count(std::string("CFG.Precision.") +
+		     PrecisionSelection::name(m_params.precision_level));
+  }
+
+  // Create create basic block for each LLVM block
+  for (auto &B : m_func) {
+    add_block(B);
+  }
+
+  basic_block_t *ret_block = nullptr;
+  var_ref_t ret_val;
+  bool has_seahorn_fail = false;
+  // keep track of initialized regions
+  std::set<Region> init_regions;
+  // For translation of gep if precision level is ARR
+  DenseMap<const GetElementPtrInst*, var_t> gep_map;
+  // -- the regions of all the pointers of the function in one query
+  const HeapAbstraction::RegionMap *regions = nullptr;
+  HeapAbstraction::RegionMap promoted_regions;
+  if (m_params.precision_level == crab::cfg::ARR && !(m_params.memory_ssa && m_sm) &&
+      m_mem.getClassId() != HeapAbstraction::ClassId::DUMMY) {
+    regions = &m_mem.getRegionMap(m_func);
+    if (m_params.promote_local_regions && !m_sm) {
+      unsigned num_promoted = promote_local_regions(m_mem, *m_dl, m_func,
+						    *regions, promoted_regions);
+      if (num_promoted > 0) {
+	ClamStats::count("CFG.Regions.Promoted", num_promoted);
+	CRAB_LOG("cfg-mem", llvm::errs() << "Function " << m_func.getName() << ": "
+		 << num_promoted << " local regions promoted to scalars\n");
+	regions = &promoted_regions;
+      }
+    }
+  }
+  // Memory SSA form without ShadowMem
+  std::unique_ptr<RegionMemorySSA> memssa;
+  if (m_params.region_memory_ssa && m_params.precision_level == crab::cfg::ARR &&
+      !(m_params.memory_ssa && m_sm) &&
+      m_mem.getClassId() != HeapAbstraction::ClassId::DUMMY) {
+    memssa.reset(new RegionMemorySSA(m_func, m_mem, *m_dl, m_lfac, m_params,
+				     regions));
+    CRAB_LOG("cfg-mem", llvm::errs() << "Function " << m_func.getName() << ": "
+	     << memssa->num_regions() << " regions in memory SSA form\n");
+  }
+  RegionMemorySSA::copy_vector_t memssa_copies;
+  // -- reused by the translation of the phi nodes of all the edges
+  CrabPhiVisitor::scratch_t phi_scratch;
+  // -- the counting loops whose back edges are accelerated
+  std::unique_ptr<LoopAcceleration> accel;
+  if (m_params.accelerate_loops) {
+    accel.reset(new LoopAcceleration(m_func));
+    CRAB_LOG("cfg-loops", accel->write(llvm::errs()));
+  }
+
+  // -- build a CFG block for each LLVM block ignoring branches,
+  //    phi-nodes, and return
+  std::vector<BasicBlock *> blocks;
+  blocks.reserve(m_func.size());
+  for (auto &B : m_func) {
+    blocks.push_back(&B);
+  }
+  std::vector<char> block_seahorn_fail(blocks.size(), false);
+  auto translate = [&](unsigned i, crabLitFactory &lfac,
+		       DenseMap<const statement_t *, const Instruction *> &rev_map) {
+    basic_block_t *bb = lookup(*blocks[i]);
+    if (!bb)
+      return;
+    CrabInstVisitor v(lfac, m_mem, m_sm, m_dl, m_tli, m_callees, m_summaries,
+		      m_diags, memssa.get(), regions, *bb, rev_map, init_regions, gep_map,
+		      m_params);
+    v.visit(*blocks[i]);
+    block_seahorn_fail[i] = v.has_seahorn_fail();
+  };
+  // With NUM precision the blocks only share the literals: the
+  // memory is not translated so neither the regions nor the GEPs of
+  // other blocks are used.
+  if (m_params.block_threads > 1 && !m_params.deterministic &&
+      m_params.precision_level == crab::cfg::NUM &&
+      !m_sm && blocks.size() >= 2 * BLOCK_CHUNK_SIZE) {
+    translate_blocks_in_parallel(blocks, translate);
+  } else {
+    for (unsigned i = 0; i < blocks.size(); ++i) {
+      translate(i, m_lfac, m_rev_map);
+    }
+  }
+  
+  for (unsigned i = 0; i < blocks.size(); ++i) {
+    BasicBlock &B = *blocks[i];
+    basic_block_t *bb = lookup(B);
+    if (!bb)
+      continue;
+
+    // hook for seahorn
+    has_seahorn_fail |=
+        (block_seahorn_fail[i] && m_func.getName().equals("main"));
+
+    // -- process the exit block of the function and its returned value.
+    if (ReturnInst *RI = dyn_cast<ReturnInst>(B.getTerminator())) {
+      if (ret_block) {
+        // UnifyFunctionExitNodes ensures *at most* one return
+        // instruction per function.
+        CLAM_ERROR("UnifyFunctionExitNodes pass should be run first");
       }
 
       ret_block = bb;
       m_cfg->set_exit(ret_block->label());
+      if (memssa && m_params.interprocedural && !m_func.isVarArg() &&
+	  !m_func.getName().equals("main")) {
+	// the array variables of the regions are the outputs of the
+	// function
+	memssa_copies.clear();
+	memssa->getExitCopies(B, memssa_copies);
+	for (auto &c: memssa_copies) {
+	  bb->array_assign(c.first, c.second);
+	}
+      }
       if (has_seahorn_fail) {
         ret_block->assertion(lin_cst_t::get_false(), getDebugLoc(RI));
       }
@@ -3009,6 +3761,15 @@ void CfgBuilderImpl::build_cfg() {
       // count as a successor but we want to consider it as a such.
       if (SwitchInst *SI = dyn_cast<SwitchInst>(B.getTerminator())) {
         succs_vector.push_back(SI->getDefaultDest());
+        // Several cases can jump to the same block but each block
+        // must be visited only once.
+        SmallPtrSet<const BasicBlock *, 8> seen;
+        succs_vector.erase(std::remove_if(succs_vector.begin(),
+                                          succs_vector.end(),
+                                          [&seen](const BasicBlock *b) {
+                                            return !seen.insert(b).second;
+                                          }),
+                           succs_vector.end());
       }
       for (const BasicBlock *dst : succs_vector) {
         // -- move branch condition in bb to a new block inserted
@@ -3018,8 +3779,21 @@ void CfgBuilderImpl::build_cfg() {
         // -- phi nodes in dst are translated into assignments in
         //    the predecessor
         CrabPhiVisitor v(m_lfac, m_mem, m_sm, *m_dl,
-			 (mid_bb ? *mid_bb : *bb), B, m_params);
+			 (mid_bb ? *mid_bb : *bb), B, m_params, phi_scratch);
         v.visit(const_cast<BasicBlock &>(*dst));
+	if (memssa) {
+	  // -- memory phi nodes of the regions
+	  memssa_copies.clear();
+	  memssa->getPhiCopies(B, *dst, memssa_copies);
+	  for (auto &c: memssa_copies) {
+	    (mid_bb ? *mid_bb : *bb).array_assign(c.first, c.second);
+	  }
+	}
+	if (accel) {
+	  if (const CountingLoop *cl = accel->lookup(B, *dst)) {
+	    accelerate_back_edge(*cl, mid_bb ? *mid_bb : *bb);
+	  }
+	}
       }
     }
   }
@@ -3114,11 +3888,13 @@ void CfgBuilderImpl::build_cfg() {
       }
     }
 
-    if (m_lfac.get_track() == ARR && (!m_func.getName().equals("main"))) {
+    if (m_lfac.get_track() == ARR && !m_func.getName().equals("main") &&
+	m_mem.getClassId() != HeapAbstraction::ClassId::DUMMY) {
       // -- add the input and output array parameters
-      RegionVec onlyreads = get_read_only_regions(m_mem, m_func);
-      RegionVec mods = get_modified_regions(m_mem, m_func);
-      RegionVec news = get_new_regions(m_mem, m_func);
+      SmallRegionVec onlyreads = get_read_only_regions(m_mem, m_func);
+      SmallRegionVec mods = get_modified_regions(m_mem, m_func);
+      SmallRegionVec news = get_new_regions(m_mem, m_func);
+      const HeapAbstraction::RegionSet &news_set = m_mem.getNewRegionSet(m_func);
 
       CRAB_LOG("cfg-mem", llvm::errs() << "Function " << m_func.getName()
                                        << "\n\tOnly-Read regions "
@@ -3139,7 +3915,7 @@ void CfgBuilderImpl::build_cfg() {
 
       // -- add input/output parameters
       for (auto a : mods) {
-        if (std::find(news.begin(), news.end(), a) != news.end()) {
+        if (news_set.test(a.get_id())) {
           continue;
         }
         var_ref_t a_in;
@@ -3224,6 +4000,11 @@ void CfgBuilderImpl::build_cfg() {
       CLAM_ERROR("function inputs and outputs should not intersect");
     }
 
+    m_func_params.clear();
+    std::merge(sorted_ins.begin(), sorted_ins.end(),
+	       sorted_outs.begin(), sorted_outs.end(),
+	       std::back_inserter(m_func_params));
+
     typedef function_decl<number_t, varname_t> function_decl_t;
     m_cfg->set_func_decl(
         function_decl_t(m_func.getName().str(), inputs, outputs));
@@ -3313,6 +4094,10 @@ void CfgBuilderImpl::build_cfg() {
     }
   }
 
+  if (m_params.hoist_loop_havocs) {
+    hoist_loop_havocs();
+  }
+
   if (m_params.simplify) {
     // -- Remove dead statements generated by our translation
     CRAB_VERBOSE_IF(1, crab::get_msg_stream()
@@ -3331,12 +4116,241 @@ void CfgBuilderImpl::build_cfg() {
                            << "Finished CFG simplification\n";);
   }
 
+  if (m_params.array_expand_max_elems > 0 &&
+      m_params.precision_level == crab::cfg::ARR &&
+      m_mem.getClassId() != HeapAbstraction::ClassId::DUMMY) {
+    tag_array_regions();
+  }
+
+  if (m_params.cfg_report != NO_CFG_REPORT) {
+    write_cfg_report();
+  }
+
   if (m_params.print_cfg) {
-    crab::outs() << *m_cfg << "\n";
+    if (OutputSink *sink = OutputSink::get()) {
+      crab::crab_string_os o;
+      o << *m_cfg << "\n";
+      sink->write("cfg", m_func.getName(), o.str());
+    } else {
+      crab::outs() << *m_cfg << "\n";
+    }
   }
   return;
 }
 
+void CfgBuilderImpl::write_cfg_report() const {
+  enum { ASSIGN, ASSUME, HAVOC, ASSERT, ARRAY, PTR, CALL, OTHER, NUM_KINDS };
+  static const char *kind_names[NUM_KINDS] = {
+      "assign", "assume", "havoc", "assert", "array", "ptr", "call", "other"};
+  auto kind_of = [](const statement_t &s) -> unsigned {
+    if (s.is_bin_op() || s.is_assign() || s.is_int_cast() || s.is_select() ||
+        s.is_bool_bin_op() || s.is_bool_assign_cst() ||
+        s.is_bool_assign_var() || s.is_bool_select()) {
+      return ASSIGN;
+    } else if (s.is_assume() || s.is_bool_assume()) {
+      return ASSUME;
+    } else if (s.is_havoc()) {
+      return HAVOC;
+    } else if (s.is_assert() || s.is_bool_assert()) {
+      return ASSERT;
+    } else if (s.is_arr_init() || s.is_arr_read() || s.is_arr_write() ||
+               s.is_arr_assign()) {
+      return ARRAY;
+    } else if (s.is_ptr_read() || s.is_ptr_write() || s.is_ptr_null() ||
+               s.is_ptr_object() || s.is_ptr_assign() || s.is_ptr_function() ||
+               s.is_ptr_assume() || s.is_ptr_assert()) {
+      return PTR;
+    } else if (s.is_callsite() || s.is_return()) {
+      return CALL;
+    }
+    return OTHER;
+  };
+  // -- the instruction of a statement: the reverse map or the LLVM
+  //    value of one of its variables
+  auto inst_of = [this](const statement_t &s) -> const Instruction * {
+    if (const Instruction *I = m_rev_map.lookup(&s)) {
+      return I;
+    }
+    auto &ls = s.get_live();
+    for (auto it = ls.defs_begin(), et = ls.defs_end(); it != et; ++it) {
+      if (auto v = it->name().get()) {
+        if (const Instruction *I = dyn_cast<Instruction>(*v)) {
+          return I;
+        }
+      }
+    }
+    return nullptr;
+  };
+
+  unsigned num_insts = 0;
+  for (auto &B : m_func) {
+    num_insts += B.size();
+  }
+  unsigned kinds[NUM_KINDS] = {0};
+  unsigned num_blocks = 0, num_stmts = 0;
+  std::set<var_t> scalars, arrays, shadows;
+  std::map<std::pair<std::string, unsigned>, unsigned> lines;
+  for (auto &bb : llvm::make_range(m_cfg->begin(), m_cfg->end())) {
+    ++num_blocks;
+    for (auto &s : bb) {
+      ++num_stmts;
+      kinds[kind_of(s)]++;
+      auto &ls = s.get_live();
+      auto add = [&](const var_t &v) {
+        if (v.get_type() == ARR_INT_TYPE || v.get_type() == ARR_BOOL_TYPE) {
+          arrays.insert(v);
+        } else if (v.name().get()) {
+          scalars.insert(v);
+        } else {
+          shadows.insert(v);
+        }
+      };
+      for (auto it = ls.defs_begin(), et = ls.defs_end(); it != et; ++it) {
+        add(*it);
+      }
+      for (auto it = ls.uses_begin(), et = ls.uses_end(); it != et; ++it) {
+        add(*it);
+      }
+      const Instruction *I = inst_of(s);
+      if (I && I->getDebugLoc()) {
+        const DILocation *loc = I->getDebugLoc().get();
+        lines[{loc->getFilename().str(), loc->getLine()}]++;
+      }
+    }
+  }
+  // -- a lower bound: the statements are counted with the size of
+  //    their base class
+  uint64_t bytes = (uint64_t)num_blocks * sizeof(basic_block_t) +
+                   (uint64_t)num_stmts * sizeof(statement_t) +
+                   m_rev_map.getMemorySize() +
+                   (m_node_to_crab_map.size() + m_edge_to_crab_map.size()) *
+                       sizeof(std::pair<const void *, basic_block_label_t>);
+  // -- the source lines with more statements
+  const unsigned max_lines = 5;
+  std::vector<std::pair<std::pair<std::string, unsigned>, unsigned>> top_lines(
+      lines.begin(), lines.end());
+  std::stable_sort(top_lines.begin(), top_lines.end(),
+                   [](const std::pair<std::pair<std::string, unsigned>, unsigned> &a,
+                      const std::pair<std::pair<std::string, unsigned>, unsigned> &b) {
+                     return a.second > b.second;
+                   });
+  if (top_lines.size() > max_lines) {
+    top_lines.resize(max_lines);
+  }
+
+  std::string str;
+  raw_string_ostream o(str);
+  if (m_params.cfg_report == JSON_CFG_REPORT) {
+    o << "{\"function\": \"" << jsonEscape(m_func.getName()) << "\""
+      << ", \"llvm_blocks\": " << m_func.size()
+      << ", \"llvm_instructions\": " << num_insts
+      << ", \"crab_blocks\": " << num_blocks
+      << ", \"edge_blocks\": " << m_edge_to_crab_map.size()
+      << ", \"crab_statements\": " << num_stmts << ", \"statements\": {";
+    for (unsigned k = 0; k < NUM_KINDS; ++k) {
+      o << (k > 0 ? ", " : "") << "\"" << kind_names[k] << "\": " << kinds[k];
+    }
+    o << "}, \"variables\": {\"scalar\": " << scalars.size()
+      << ", \"array\": " << arrays.size()
+      << ", \"shadow\": " << shadows.size() << "}"
+      << ", \"rev_map\": " << m_rev_map.size()
+      << ", \"estimated_bytes\": " << bytes << ", \"top_lines\": [";
+    for (unsigned i = 0; i < top_lines.size(); ++i) {
+      o << (i > 0 ? ", " : "") << "{\"file\": \""
+        << jsonEscape(top_lines[i].first.first) << "\", \"line\": "
+        << top_lines[i].first.second << ", \"statements\": "
+        << top_lines[i].second << "}";
+    }
+    o << "]}\n";
+  } else {
+    o << "=== CFG report of " << m_func.getName() << " ===\n"
+      << "LLVM blocks: " << m_func.size() << "\n"
+      << "LLVM instructions: " << num_insts << "\n"
+      << "Crab blocks: " << num_blocks << " (edge blocks: "
+      << m_edge_to_crab_map.size() << ")\n"
+      << "Crab statements: " << num_stmts << "\n";
+    for (unsigned k = 0; k < NUM_KINDS; ++k) {
+      o << "  " << kind_names[k] << ": " << kinds[k] << "\n";
+    }
+    o << "Variables: " << scalars.size() + arrays.size() + shadows.size()
+      << " (scalar: " << scalars.size() << ", array: " << arrays.size()
+      << ", shadow: " << shadows.size() << ")\n"
+      << "Reverse map entries: " << m_rev_map.size() << "\n"
+      << "Estimated bytes: " << bytes << "\n";
+    if (!top_lines.empty()) {
+      o << "Source lines with more statements:\n";
+      for (auto &kv : top_lines) {
+        o << "  " << kv.first.first << ":" << kv.first.second << ": "
+          << kv.second << "\n";
+      }
+    }
+  }
+  if (OutputSink *sink = OutputSink::get()) {
+    sink->write("cfg-report", m_func.getName(), o.str());
+    return;
+  }
+  // -- the CFGs can be built by several threads
+  static std::mutex report_mutex;
+  std::lock_guard<std::mutex> lock(report_mutex);
+  crab::outs() << o.str();
+}
+
+void CfgBuilderImpl::tag_array_regions() {
+  // -- the largest object of each region: 0 if its size is not constant
+  std::map<Region::RegionId, std::pair<Region, uint64_t>> objects;
+  // -- bytes is 0 if the size of the object is not constant
+  auto addObject = [&](const Instruction *I, const Value *ptr, uint64_t bytes) {
+    Region r = m_mem.getRegion(m_func, I, ptr);
+    if (r.isUnknown()) {
+      return;
+    }
+    uint64_t elem_bytes = std::max(r.getRegionInfo().get_bitwidth() / 8, 1u);
+    uint64_t elems = bytes / elem_bytes;
+    auto it = objects.find(r.get_id());
+    if (it == objects.end()) {
+      objects.insert({r.get_id(), {r, elems}});
+    } else if (it->second.second > 0) {
+      it->second.second = (elems == 0 ? 0 : std::max(it->second.second, elems));
+    }
+  };
+  std::set<const GlobalVariable *> globals;
+  for (auto &I : instructions(m_func)) {
+    if (const AllocaInst *AI = dyn_cast<AllocaInst>(&I)) {
+      uint64_t bytes = 0;
+      const ConstantInt *n = dyn_cast<ConstantInt>(AI->getArraySize());
+      if (n && AI->getAllocatedType()->isSized()) {
+	bytes = m_dl->getTypeAllocSize(AI->getAllocatedType()) * n->getZExtValue();
+      }
+      addObject(AI, AI, bytes);
+    }
+    for (const Value *op : I.operand_values()) {
+      const GlobalVariable *GV =
+	dyn_cast<GlobalVariable>(op->stripInBoundsOffsets());
+      if (GV && globals.insert(GV).second && GV->getValueType()->isSized()) {
+	addObject(&I, GV, m_dl->getTypeAllocSize(GV->getValueType()));
+      }
+    }
+  }
+
+  unsigned num_expand = 0, num_smash = 0;
+  for (auto &kv : objects) {
+    uint64_t elems = kv.second.second;
+    bool expand = elems > 0 && elems <= m_params.array_expand_max_elems;
+    m_array_reprs[kv.first] = {expand ? CfgBuilder::array_repr_t::EXPAND
+				      : CfgBuilder::array_repr_t::SMASH, elems};
+    CRAB_LOG("cfg-mem", llvm::errs() << "Function " << m_func.getName() << ": "
+	     << kv.second.first << " with " << elems << " elements is "
+	     << (expand ? "expanded" : "smashed") << "\n");
+    if (expand) {
+      ++num_expand;
+    } else {
+      ++num_smash;
+    }
+  }
+  ClamStats::count("CFG.Arrays.Expand", num_expand);
+  ClamStats::count("CFG.Arrays.Smash", num_smash);
+}
+
 /* CrabBuilderParams class */
 
 void CrabBuilderParams::write(raw_ostream &o) const {
@@ -3355,27 +4369,195 @@ void CrabBuilderParams::write(raw_ostream &o) const {
   default:;
     ;
   }
+  o << "\tadaptive abstraction level: " << adaptive_precision << "\n";
   o << "\tsimplify cfg: " << simplify << "\n";
+  o << "\tcfg report: " << cfg_report << "\n";
   o << "\tinterproc cfg: " << interprocedural << "\n";
   o << "\tmemory-ssa cfg: " << memory_ssa << "\n";
+  o << "\tmemory-ssa cfg from heap regions: " << region_memory_ssa << "\n";
+  o << "\tforget dead arrays: " << forget_dead_arrays << "\n";
+  o << "\taccelerate loops: " << accelerate_loops << "\n";
+  o << "\thoist loop havocs: " << hoist_loop_havocs << "\n";
+  o << "\tnull checks: " << null_checks << "\n";
   o << "\tlower singleton aliases into scalars: " << lower_singleton_aliases
     << "\n";
+  o << "\tpromote local regions into scalars: " << promote_local_regions
+    << "\n";
   o << "\ttuned translation for array smashing:"  << use_array_smashing << "\n";
   o << "\tenable big numbers: " << enable_bignums << "\n";
+  o << "\tnative select: " << native_select << "\n";
+  o << "\texamples per warning and function: " << warning_examples << "\n";
+  o << "\tdeterministic: " << deterministic << "\n";
+  o << "\tfunction variable scopes: " << function_var_scopes << "\n";
+  o << "\tmax elements of expanded arrays: " << array_expand_max_elems << "\n";
 }
 
 /* CFG Builder class */
 CfgBuilder::CfgBuilder(const llvm::Function &func, CrabBuilderManager &man)
-    : m_impl(new CfgBuilderImpl(func, man.get_var_factory(),
+    : m_params(man.get_cfg_builder_params(func)),
+      m_vfac(&man.get_var_factory()),
+      // -- the scope is opened before m_impl creates any variable
+      m_var_scope(man.get_cfg_builder_params().function_var_scopes ?
+                  m_vfac->open_scope(func) : nullptr),
+      m_impl(new CfgBuilderImpl(func, man.get_var_factory(),
+                                man.get_lit_cache(),
                                 man.get_heap_abstraction(),
 				man.get_shadow_mem(),
 				&(man.get_tli()),
-                                man.get_cfg_builder_params())),
-      m_ls(nullptr) {}
+				man.get_callee_table(),
+				man.get_function_summaries(),
+				man.get_diagnostics(),
+                                m_params)),
+      m_ls(nullptr), m_crab_ls(nullptr), m_cfg_version(0), m_ls_version(0),
+      m_crab_ls_version(0),
+      m_total_live(0), m_max_live_per_blk(0), m_avg_live_per_blk(0),
+      m_mem_version(0), m_callees_hash(0), m_lo(nullptr), m_lo_version(0), m_frozen(nullptr) {
+  if (m_var_scope) {
+    ClamStats::count("CFG.VarScopes.Opened");
+  }
+}
 
-CfgBuilder::~CfgBuilder() {}
+CfgBuilder::~CfgBuilder() {
+  if (m_var_scope) {
+    // -- m_impl and the cfg still refer to the names of the scope
+    //    until they are destroyed after this body, before
+    //    m_var_scope. The scope is freed with its last owner.
+    m_vfac->close_scope(m_impl->get_func(), m_var_scope);
+  }
+}
+
+// Hash of the instructions of B ignoring debug intrinsics and
+// metadata attachments. The instructions are hashed by structure
+// (opcode, types, flags and the identity of their operands) instead of
+// by their text, which would number all the values of the function
+// for each instruction. The hashes are only compared within the same
+// process.
+static hash_code hashBlock(const BasicBlock &B) {
+  hash_code h = hash_value(B.getName());
+  for (auto &I : B) {
+    if (isa<DbgInfoIntrinsic>(I)) {
+      continue;
+    }
+    h = hash_combine(h, I.getOpcode(), I.getType(),
+		     I.getRawSubclassOptionalData());
+    for (const Use &U : I.operands()) {
+      h = hash_combine(h, U.get());
+    }
+    // -- the parts of an instruction that are not operands
+    if (const CmpInst *CI = dyn_cast<CmpInst>(&I)) {
+      h = hash_combine(h, (unsigned) CI->getPredicate());
+    } else if (const PHINode *PN = dyn_cast<PHINode>(&I)) {
+      for (const BasicBlock *Pred : PN->blocks()) {
+	h = hash_combine(h, Pred);
+      }
+    } else if (const AllocaInst *AI = dyn_cast<AllocaInst>(&I)) {
+      h = hash_combine(h, AI->getAllocatedType());
+    } else if (const GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(&I)) {
+      h = hash_combine(h, GEP->getSourceElementType());
+    } else if (const LoadInst *LI = dyn_cast<LoadInst>(&I)) {
+      h = hash_combine(h, LI->isVolatile());
+    } else if (const StoreInst *SI = dyn_cast<StoreInst>(&I)) {
+      h = hash_combine(h, SI->isVolatile());
+    } else if (const ExtractValueInst *EV = dyn_cast<ExtractValueInst>(&I)) {
+      h = hash_combine(h, hash_combine_range(EV->idx_begin(), EV->idx_end()));
+    } else if (const InsertValueInst *IV = dyn_cast<InsertValueInst>(&I)) {
+      h = hash_combine(h, hash_combine_range(IV->idx_begin(), IV->idx_end()));
+    }
+  }
+  return h;
+}
+
+const CfgBuilder::array_repr_map_t &CfgBuilder::get_array_reprs() const {
+  return m_impl->get_array_reprs();
+}
+
+void CfgBuilder::build_cfg() {
+  m_impl->build_cfg();
+  notify_cfg_changed();
+  m_block_hashes.clear();
+  for (auto &B : m_impl->get_func()) {
+    m_block_hashes.push_back(hashBlock(B));
+  }
+  const CrabBuilderParams &params = m_impl->get_params();
+  if (params.forget_dead_arrays && params.precision_level == crab::cfg::ARR) {
+    forget_dead_arrays();
+  }
+}
+
+void CfgBuilder::forget_dead_arrays() {
+  compute_live_symbols();
+  auto &cfg = m_impl->get_cfg();
+  // -- the variables that can be in the abstract state at the end of
+  //    a block are the ones live at the end of its predecessors and
+  //    the ones of its statements
+  auto isArray = [](const var_t &v) {
+    return (v.get_type() == ARR_INT_TYPE || v.get_type() == ARR_BOOL_TYPE ||
+	    v.get_type() == ARR_PTR_TYPE);
+  };
+  const std::vector<var_t> &params = m_impl->get_func_params();
+  std::vector<std::pair<basic_block_t *, std::vector<var_t>>> dead;
+  for (auto &bb : llvm::make_range(cfg.begin(), cfg.end())) {
+    if (cfg.has_exit() && bb.label() == cfg.exit()) {
+      continue;
+    }
+    SparseLiveness::bitset_t in_state;
+    for (auto pred : llvm::make_range(bb.prev_blocks())) {
+      in_state |= m_ls->live_out(pred);
+    }
+    std::set<var_t> candidates;
+    for (unsigned i : in_state) {
+      candidates.insert(m_ls->get_var(i));
+    }
+    for (auto &s : llvm::make_range(bb.begin(), bb.end())) {
+      auto &ls = s.get_live();
+      candidates.insert(ls.defs_begin(), ls.defs_end());
+      candidates.insert(ls.uses_begin(), ls.uses_end());
+    }
+    std::vector<var_t> vs;
+    for (const var_t &v : candidates) {
+      if (isArray(v) && !m_ls->is_live_out(bb.label(), v) &&
+	  !std::binary_search(params.begin(), params.end(), v)) {
+	vs.push_back(v);
+      }
+    }
+    if (!vs.empty()) {
+      dead.push_back({&bb, std::move(vs)});
+    }
+  }
+  if (dead.empty()) {
+    return;
+  }
+  unsigned num_havocs = 0;
+  for (auto &kv : dead) {
+    // -- the entry block can have its insertion point at the front
+    kv.first->set_insert_point_back();
+    for (const var_t &v : kv.second) {
+      kv.first->havoc(v);
+      ++num_havocs;
+    }
+  }
+  ClamStats::count("CFG.DeadArrays.Forgotten", num_havocs);
+  // -- a havoc of a variable that is not live at the end of its block
+  //    does not change the live variables
+  notify_cfg_changed();
+  m_ls_version = m_cfg_version;
+}
 
-void CfgBuilder::build_cfg() { m_impl->build_cfg(); }
+unsigned CfgBuilder::num_changed_blocks(const llvm::Function &func) const {
+  unsigned num_blocks = 0, num_changed = 0;
+  for (auto &B : func) {
+    if (num_blocks >= m_block_hashes.size() ||
+	m_block_hashes[num_blocks] != hashBlock(B)) {
+      ++num_changed;
+    }
+    ++num_blocks;
+  }
+  if (num_blocks < m_block_hashes.size()) {
+    // -- erased blocks
+    num_changed += m_block_hashes.size() - num_blocks;
+  }
+  return num_changed;
+}
 
 cfg_t &CfgBuilder::get_cfg() { return m_impl->get_cfg(); }
 
@@ -3395,48 +4577,359 @@ CfgBuilder::get_instruction(const statement_t &s) const {
   return m_impl->get_instruction(s);
 }
 
+void CfgBuilder::notify_cfg_changed() {
+  assert(!is_frozen() && "the cfg was modified while a frozen view is in use");
+  {
+    std::lock_guard<std::mutex> lock(m_frozen_mutex);
+    m_frozen.reset();
+  }
+  ++m_cfg_version;
+}
+
+bool CfgBuilder::is_frozen() const {
+  // -- one reference is m_frozen
+  return m_frozen && m_frozen.use_count() > 1;
+}
+
+std::shared_ptr<const FrozenCfg> CfgBuilder::freeze() {
+  std::lock_guard<std::mutex> lock(m_frozen_mutex);
+  if (m_frozen) {
+    return m_frozen;
+  }
+  ScopedClamStats __st__("CFG.Freeze");
+  cfg_t &cfg = m_impl->get_cfg();
+  compute_live_symbols();
+  get_live_symbols();
+  get_loop_order(cfg.entry());
+  std::shared_ptr<const liveness_t> live;
+  {
+    std::lock_guard<std::mutex> ls_lock(m_crab_ls_mutex);
+    live = m_crab_ls;
+  }
+  std::shared_ptr<const loop_order_t> lo;
+  {
+    std::lock_guard<std::mutex> lo_lock(m_lo_mutex);
+    lo = m_lo;
+  }
+  std::shared_ptr<FrozenCfg> frozen(new FrozenCfg(*this, cfg, live, lo));
+  get_live_stats(frozen->m_total_live, frozen->m_max_live_per_blk,
+		 frozen->m_avg_live_per_blk);
+  m_frozen = frozen;
+  return m_frozen;
+}
+
+bool CfgBuilder::has_live_symbols() const {
+  return m_ls && m_ls_version == m_cfg_version;
+}
+
 void CfgBuilder::compute_live_symbols() {
-  if (!m_ls) {
+  if (!has_live_symbols()) {
     auto &cfg = m_impl->get_cfg();
-    m_ls.reset(new liveness_t(cfg));
     CRAB_VERBOSE_IF(1,
 		    auto fdecl = cfg.get_func_decl();            
 		    crab::get_msg_stream() << "Running liveness analysis for " 
 		                           << fdecl.get_func_name()
 		                           << "  ...\n";);
-    m_ls->exec();
+    {
+      ScopedClamStats __st__("Liveness");
+      MemTracker::ScopedPhase __phase__("liveness");
+      m_ls.reset(new SparseLiveness(cfg));
+    }
+    m_ls_version = m_cfg_version;
 
-    unsigned total_live, avg_live_per_blk, max_live_per_blk;
-    m_ls->get_stats(total_live, max_live_per_blk, avg_live_per_blk);
+    // compute the statistics once: they require a traversal of the
+    // live symbols of all blocks.
+    m_ls->get_stats(m_total_live, m_max_live_per_blk, m_avg_live_per_blk);
     CRAB_VERBOSE_IF(1, 
 		  crab::outs() << "-- Max number of out live vars per block=" 
-                               << max_live_per_blk << "\n"
+                               << m_max_live_per_blk << "\n"
                                << "-- Avg number of out live vars per block=" 
-                               << avg_live_per_blk << "\n";);
-    crab::CrabStats::count_max("Liveness.count.maxOutVars",
-			       max_live_per_blk);
+                               << m_avg_live_per_blk << "\n";);
+    ClamStats::count_max("Liveness.count.maxOutVars", m_max_live_per_blk);
     
   }
 }
 
-const CfgBuilder::liveness_t* CfgBuilder::get_live_symbols() const {
-  return (m_ls ? &*m_ls: nullptr);
+const CfgBuilder::liveness_t* CfgBuilder::get_live_symbols() {
+  if (!has_live_symbols()) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(m_crab_ls_mutex);
+  if (!m_crab_ls || m_crab_ls_version != m_cfg_version) {
+    m_crab_ls.reset(new liveness_t(m_impl->get_cfg()));
+    m_crab_ls->exec();
+    m_crab_ls_version = m_cfg_version;
+  }
+  return &*m_crab_ls;
 }
 
 Optional<CfgBuilder::varset> CfgBuilder::get_live_symbols(const BasicBlock *B) const {
-  if (!m_ls) {
+  if (!has_live_symbols()) {
     return llvm::None;
   } else {
     basic_block_label_t bbl = get_crab_basic_block(B);
-    return m_ls->get(bbl);
+    varset res = varset::bottom();
+    for (unsigned i : m_ls->live_out(bbl)) {
+      res += m_ls->get_var(i);
+    }
+    return res;
+  }
+}
+
+Optional<unsigned> CfgBuilder::get_max_live_per_blk() const {
+  if (!has_live_symbols()) {
+    return llvm::None;
+  } else {
+    return m_max_live_per_blk;
+  }
+}
+
+const CfgBuilder::loop_order_t &
+CfgBuilder::get_loop_order(const basic_block_label_t &entry) {
+  std::lock_guard<std::mutex> lock(m_lo_mutex);
+  if (m_lo && m_lo_version == m_cfg_version && m_lo->entry == entry) {
+    return *m_lo;
+  }
+  ScopedClamStats __st__("CFG.LoopOrder");
+  cfg_t &cfg = m_impl->get_cfg();
+  std::unique_ptr<loop_order_t> lo(new loop_order_t(entry));
+  struct frame_t {
+    basic_block_label_t bl;
+    std::vector<basic_block_label_t> succs;
+    unsigned next;
+  };
+  auto mkFrame = [&cfg](const basic_block_label_t &bl) {
+    frame_t f;
+    f.bl = bl;
+    f.next = 0;
+    auto &bb = cfg.get_node(bl);
+    for (auto succ: llvm::make_range(bb.next_blocks())) {
+      f.succs.push_back(succ);
+    }
+    return f;
+  };
+  std::set<basic_block_label_t> on_stack;
+  std::vector<frame_t> stack;
+  lo->heads.insert(entry);
+  lo->reachable.insert(entry);
+  on_stack.insert(entry);
+  stack.push_back(mkFrame(entry));
+  while (!stack.empty()) {
+    frame_t &f = stack.back();
+    if (f.next == f.succs.size()) {
+      lo->rpo.push_back(f.bl);
+      on_stack.erase(f.bl);
+      stack.pop_back();
+      continue;
+    }
+    basic_block_label_t succ = f.succs[f.next++];
+    if (on_stack.count(succ) > 0) {
+      lo->heads.insert(succ);
+    } else if (lo->reachable.insert(succ).second) {
+      on_stack.insert(succ);
+      stack.push_back(mkFrame(succ));
+    }
   }
+  std::reverse(lo->rpo.begin(), lo->rpo.end());
+  m_lo = std::move(lo);
+  m_lo_version = m_cfg_version;
+  return *m_lo;
+}
+
+bool CfgBuilder::get_live_stats(unsigned &total_live,
+				unsigned &max_live_per_blk,
+				unsigned &avg_live_per_blk) const {
+  if (!has_live_symbols()) {
+    return false;
+  }
+  total_live = m_total_live;
+  max_live_per_blk = m_max_live_per_blk;
+  avg_live_per_blk = m_avg_live_per_blk;
+  return true;
+}
+
+/* Frozen view of a CFG */
+FrozenCfg::FrozenCfg(const CfgBuilder &builder, cfg_t &cfg,
+		     std::shared_ptr<const liveness_t> live,
+		     std::shared_ptr<const loop_order_t> lo)
+  : m_builder(builder), m_cfg(cfg), m_live(live), m_lo(lo),
+    m_total_live(0), m_max_live_per_blk(0), m_avg_live_per_blk(0) {}
+
+void FrozenCfg::get_live_stats(unsigned &total_live,
+			       unsigned &max_live_per_blk,
+			       unsigned &avg_live_per_blk) const {
+  total_live = m_total_live;
+  max_live_per_blk = m_max_live_per_blk;
+  avg_live_per_blk = m_avg_live_per_blk;
 }
 
 /* CFG Manager class */
+namespace {
+// Serialize all the queries to a heap abstraction. Most heap
+// abstractions cache lazily region identifiers so they cannot be
+// queried concurrently.
+class LockedHeapAbstraction: public HeapAbstraction {
+  std::unique_ptr<HeapAbstraction> m_mem;
+  std::mutex m_mutex;
+  
+public:
+  LockedHeapAbstraction(std::unique_ptr<HeapAbstraction> mem)
+    : m_mem(std::move(mem)) {}
+
+  virtual ClassId getClassId() const override {
+    return m_mem->getClassId();
+  }
+
+  virtual bool isBasePtr(const Function &F, const Value *V) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->isBasePtr(F, V);
+  }
+  
+  virtual Region getRegion(const Function &F, const Instruction *I,
+			   const Value *V) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getRegion(F, I, V);
+  }
+
+  virtual const RegionMap &getRegionMap(const Function &F) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getRegionMap(F);
+  }
+
+  virtual RegionVec getAccessedRegions(const Function &F) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getAccessedRegions(F);
+  }
+
+  virtual RegionVec getOnlyReadRegions(const Function &F) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getOnlyReadRegions(F);
+  }
+
+  virtual RegionVec getModifiedRegions(const Function &F) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getModifiedRegions(F);
+  }
+
+  virtual RegionVec getNewRegions(const Function &F) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getNewRegions(F);
+  }
+
+  virtual RegionVec getAccessedRegions(const CallInst &I) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getAccessedRegions(I);
+  }
+
+  virtual RegionVec getOnlyReadRegions(const CallInst &I) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getOnlyReadRegions(I);
+  }
+
+  virtual RegionVec getModifiedRegions(const CallInst &I) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getModifiedRegions(I);
+  }
+
+  virtual RegionVec getNewRegions(const CallInst &I) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getNewRegions(I);
+  }
+
+  virtual RegionRef getAccessedRegionsRef(const Function &F) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getAccessedRegionsRef(F);
+  }
+
+  virtual RegionRef getOnlyReadRegionsRef(const Function &F) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getOnlyReadRegionsRef(F);
+  }
+
+  virtual RegionRef getModifiedRegionsRef(const Function &F) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getModifiedRegionsRef(F);
+  }
+
+  virtual RegionRef getNewRegionsRef(const Function &F) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getNewRegionsRef(F);
+  }
+
+  virtual RegionRef getAccessedRegionsRef(const CallInst &I) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getAccessedRegionsRef(I);
+  }
+
+  virtual RegionRef getOnlyReadRegionsRef(const CallInst &I) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getOnlyReadRegionsRef(I);
+  }
+
+  virtual RegionRef getModifiedRegionsRef(const CallInst &I) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getModifiedRegionsRef(I);
+  }
+
+  virtual RegionRef getNewRegionsRef(const CallInst &I) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getNewRegionsRef(I);
+  }
+
+  virtual const RegionSet &getAccessedRegionSet(const Function &F) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getAccessedRegionSet(F);
+  }
+
+  virtual const RegionSet &getOnlyReadRegionSet(const Function &F) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getOnlyReadRegionSet(F);
+  }
+
+  virtual const RegionSet &getModifiedRegionSet(const Function &F) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getModifiedRegionSet(F);
+  }
+
+  virtual const RegionSet &getNewRegionSet(const Function &F) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getNewRegionSet(F);
+  }
+
+  virtual const RegionSet &getAccessedRegionSet(const CallInst &I) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getAccessedRegionSet(I);
+  }
+
+  virtual const RegionSet &getOnlyReadRegionSet(const CallInst &I) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getOnlyReadRegionSet(I);
+  }
+
+  virtual const RegionSet &getModifiedRegionSet(const CallInst &I) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getModifiedRegionSet(I);
+  }
+
+  virtual const RegionSet &getNewRegionSet(const CallInst &I) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mem->getNewRegionSet(I);
+  }
+
+  virtual StringRef getName() const override {
+    return m_mem->getName();
+  }
+};
+} // end anonymous namespace
+  
 CrabBuilderManager::CrabBuilderManager(CrabBuilderParams params,
                                        const llvm::TargetLibraryInfo &tli,
                                        std::unique_ptr<HeapAbstraction> mem)
-  : m_params(params), m_tli(tli), m_mem(std::move(mem)), m_sm(nullptr) {
+  : m_params(params), m_concurrent(false), m_tli(tli),
+    m_lit_cache(new crabLitCache()), m_callees(new crabCalleeTable(tli)),
+    m_diags(new CfgBuilderDiagnostics(params.warning_examples)),
+    m_summaries(nullptr), m_mem(std::move(mem)), m_mem_version(0),
+    m_sm(nullptr) {
   // This constructor cannot enable memory ssa form.
   if (m_params.memory_ssa) {
     CLAM_WARNING("Memory SSA needs ShadowMem");
@@ -3448,7 +4941,11 @@ CrabBuilderManager::CrabBuilderManager(CrabBuilderParams params,
 CrabBuilderManager::CrabBuilderManager(CrabBuilderParams params,
                                        const llvm::TargetLibraryInfo &tli,
 				       sea_dsa::ShadowMem &sm)
-  : m_params(params), m_tli(tli), m_mem(new DummyHeapAbstraction()), m_sm(&sm) {
+  : m_params(params), m_concurrent(false), m_tli(tli),
+    m_lit_cache(new crabLitCache()), m_callees(new crabCalleeTable(tli)),
+    m_diags(new CfgBuilderDiagnostics(params.warning_examples)),
+    m_summaries(nullptr), m_mem(new DummyHeapAbstraction()),
+    m_mem_version(0), m_sm(&sm) {
   // This constructor enables memory ssa form.
   if (m_params.memory_ssa) {
     if (params.interprocedural) {
@@ -3462,23 +4959,164 @@ CrabBuilderManager::CrabBuilderManager(CrabBuilderParams params,
   CRAB_VERBOSE_IF(1, m_params.write(llvm::errs()));  
 }
 
-CrabBuilderManager::~CrabBuilderManager() {}
+CrabBuilderManager::~CrabBuilderManager() {
+  // The builders refer to the literal arenas, the variable factory,
+  // the callee table and the heap abstraction owned by the manager
+  // but m_cfg_builder_map is declared before them so destroy the
+  // builders first.
+  for (auto &shard : m_cfg_builder_map) {
+    shard.m_map.clear();
+  }
+}
+
+CrabBuilderManager::CfgBuilderShard &
+CrabBuilderManager::get_shard(const Function *f) const {
+  unsigned h = DenseMapInfo<const Function *>::getHashValue(f);
+  return m_cfg_builder_map[h % NUM_SHARDS];
+}
 
 CrabBuilderManager::CfgBuilderPtr
 CrabBuilderManager::mk_cfg_builder(const Function &f) {
-  auto it = m_cfg_builder_map.find(&f);
-  if (it == m_cfg_builder_map.end()) {
-    CfgBuilderPtr builder(new CfgBuilder(f, *this));
-    builder->build_cfg();
-    m_cfg_builder_map.insert({&f, builder});
-    return builder;
+  CfgBuilderShard &shard = get_shard(&f);
+  {
+    std::lock_guard<std::mutex> lock(shard.m_mutex);
+    auto it = shard.m_map.find(&f);
+    if (it != shard.m_map.end()) {
+      return it->second;
+    }
+  }
+  // The CFG is built without holding the lock of the shard. If two
+  // threads build the same CFG then the first one wins.
+  CfgBuilderPtr builder(new CfgBuilder(f, *this));
+  builder->build_cfg();
+  builder->m_mem_version = m_mem_version;
+  builder->m_callees_hash = hash_callees(f);
+  std::lock_guard<std::mutex> lock(shard.m_mutex);
+  return shard.m_map.insert({&f, builder}).first->second;
+}
+
+void CrabBuilderManager::mk_cfg_builders(const std::vector<const Function*> &funcs,
+					 unsigned num_threads) {
+  num_threads = std::min(num_threads, (unsigned) funcs.size());
+  if (num_threads <= 1 || m_sm || m_params.deterministic) {
+    // ShadowMem cannot be queried concurrently. In deterministic mode
+    // the variables are created in the order of funcs.
+    for (const Function *f: funcs) {
+      mk_cfg_builder(*f);
+    }
+    return;
+  }
+
+  set_concurrent(*(funcs.front()->getParent()));
+
+  CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Building " << funcs.size()
+		  << " Crab CFGs with " << num_threads << " threads\n";);
+  std::atomic<unsigned> next(0);
+  auto worker = [&]() {
+    for (unsigned i = next++; i < funcs.size(); i = next++) {
+      mk_cfg_builder(*funcs[i]);
+    }
+  };
+  std::vector<std::thread> workers;
+  workers.reserve(num_threads);
+  for (unsigned i = 0; i < num_threads; ++i) {
+    workers.emplace_back(worker);
+  }
+  for (auto &t: workers) {
+    t.join();
+  }
+}
+
+void CrabBuilderManager::set_concurrent(const Module &M) {
+  if (m_concurrent) {
+    return;
+  }
+  m_concurrent = true;
+  m_vfac.set_thread_safe(true);
+  m_mem.reset(new LockedHeapAbstraction(std::move(m_mem)));
+  // DataLayout computes lazily the layout of struct types
+  const DataLayout &dl = M.getDataLayout();
+  TypeFinder struct_types;
+  struct_types.run(M, false);
+  for (StructType *ty: struct_types) {
+    if (!ty->isOpaque() && ty->isSized()) {
+      dl.getStructLayout(ty);
+    }
+  }
+}
+
+void CrabBuilderManager::set_heap_abstraction(std::unique_ptr<HeapAbstraction> mem) {
+  m_old_mems.push_back(std::move(m_mem));
+  ++m_mem_version;
+  if (m_concurrent) {
+    m_mem.reset(new LockedHeapAbstraction(std::move(mem)));
   } else {
-    return it->second;
+    m_mem = std::move(mem);
   }
 }
 
+void CrabBuilderManager::invalidate(const Function &f) {
+  // f can be used by other CFGs as a function pointer
+  m_lit_cache->erase(f);
+  m_callees->erase(f);
+  invalidateValueNames(f);
+  CfgBuilderShard &shard = get_shard(&f);
+  std::lock_guard<std::mutex> lock(shard.m_mutex);
+  shard.m_map.erase(&f);
+}
+
+CrabBuilderManager::CfgBuilderPtr
+CrabBuilderManager::rebuild(const Function &f, bool &rebuilt) {
+  CfgBuilderPtr builder;
+  {
+    CfgBuilderShard &shard = get_shard(&f);
+    std::lock_guard<std::mutex> lock(shard.m_mutex);
+    auto it = shard.m_map.find(&f);
+    if (it != shard.m_map.end()) {
+      builder = it->second;
+    }
+  }
+  if (builder) {
+    unsigned num_changed = builder->num_changed_blocks(f);
+    // -- the translation of the blocks also depends on the regions
+    //    and on the kinds of the callees
+    bool mem_changed = builder->m_mem_version != m_mem_version;
+    bool callees_changed = builder->m_callees_hash != hash_callees(f);
+    if (num_changed == 0 && !mem_changed && !callees_changed) {
+      rebuilt = false;
+      return builder;
+    }
+    CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Rebuilding the CFG of "
+		    << f.getName() << ": " << num_changed
+		    << " blocks changed"
+		    << (mem_changed ? ", new heap abstraction" : "")
+		    << (callees_changed ? ", callees changed" : "") << "\n";);
+  }
+  invalidate(f);
+  rebuilt = true;
+  return mk_cfg_builder(f);
+}
+
+hash_code CrabBuilderManager::hash_callees(const Function &f) {
+  hash_code h = hash_value(f.getName());
+  for (auto &I : instructions(f)) {
+    const CallInst *CI = dyn_cast<CallInst>(&I);
+    if (!CI) {
+      continue;
+    }
+    if (const Function *callee =
+	dyn_cast<Function>(CI->getCalledValue()->stripPointerCasts())) {
+      h = hash_combine(h, callee, callee->isDeclaration(),
+		       (unsigned) m_callees->getKind(*CI, *callee));
+    }
+  }
+  return h;
+}
+
 bool CrabBuilderManager::has_cfg(const Function &f) const {
-  return m_cfg_builder_map.find(&f) != m_cfg_builder_map.end();
+  CfgBuilderShard &shard = get_shard(&f);
+  std::lock_guard<std::mutex> lock(shard.m_mutex);
+  return shard.m_map.find(&f) != shard.m_map.end();
 }
 
 cfg_t &CrabBuilderManager::get_cfg(const Function &f) const {
@@ -3487,8 +5125,10 @@ cfg_t &CrabBuilderManager::get_cfg(const Function &f) const {
 
 CrabBuilderManager::CfgBuilderPtr
 CrabBuilderManager::get_cfg_builder(const Function &f) const {
-  auto it = m_cfg_builder_map.find(&f);
-  if (it == m_cfg_builder_map.end()) {
+  CfgBuilderShard &shard = get_shard(&f);
+  std::lock_guard<std::mutex> lock(shard.m_mutex);
+  auto it = shard.m_map.find(&f);
+  if (it == shard.m_map.end()) {
     CLAM_ERROR("Cannot find crab cfg for ", f.getName());
   }
   return it->second;
@@ -3496,6 +5136,24 @@ CrabBuilderManager::get_cfg_builder(const Function &f) const {
 
 variable_factory_t &CrabBuilderManager::get_var_factory() { return m_vfac; }
 
+CrabBuilderParams
+CrabBuilderManager::get_cfg_builder_params(const Function &f) {
+  CrabBuilderParams params(m_params);
+  if (!m_params.adaptive_precision) {
+    return params;
+  }
+  std::lock_guard<std::mutex> lock(m_precisions_mutex);
+  if (!m_precisions) {
+    m_precisions.reset(new PrecisionSelection(*f.getParent(),
+					      m_params.precision_level,
+					      m_params.interprocedural,
+					      m_params.null_checks));
+    CRAB_LOG("cfg-precision", m_precisions->write(llvm::errs()));
+  }
+  params.precision_level = m_precisions->get(f);
+  return params;
+}
+
 const CrabBuilderParams &CrabBuilderManager::get_cfg_builder_params() const {
   return m_params;
 }
@@ -3506,6 +5164,21 @@ const llvm::TargetLibraryInfo &CrabBuilderManager::get_tli() const {
 
 HeapAbstraction &CrabBuilderManager::get_heap_abstraction() { return *m_mem; }
 
+crabLitCache &CrabBuilderManager::get_lit_cache() { return *m_lit_cache; }
+
+crabCalleeTable &CrabBuilderManager::get_callee_table() { return *m_callees; }
+
+CfgBuilderDiagnostics &CrabBuilderManager::get_diagnostics() { return *m_diags; }
+
+void CrabBuilderManager::set_function_summaries(
+    const FunctionSummaries *summaries) {
+  m_summaries = summaries;
+}
+
+const FunctionSummaries *CrabBuilderManager::get_function_summaries() const {
+  return m_summaries;
+}
+
 const sea_dsa::ShadowMem *CrabBuilderManager::get_shadow_mem() const {
   return m_sm;
 }
@@ -0,0 +1,151 @@
+#include "CfgBuilderCallees.hh"
+#include "CfgBuilderUtils.hh"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Analysis/MemoryBuiltins.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace clam {
+
+using namespace llvm;
+
+callee_kind_t crabCalleeTable::getKind(const CallInst &I, const Function &callee) {
+  Shard &shard = getShard(&callee);
+  {
+    std::lock_guard<std::mutex> lock(shard.m_mutex);
+    auto it = shard.m_map.find(&callee);
+    if (it != shard.m_map.end()) {
+      if (it->second != CALLEE_ALLOCATOR) {
+	return it->second;
+      }
+      // isAllocationFn does not look through casts and it honors
+      // nobuiltin call sites.
+      ImmutableCallSite CS(&I);
+      return (CS.getCalledValue() == &callee && !CS.isNoBuiltin() ?
+	      CALLEE_ALLOCATOR : CALLEE_ORDINARY);
+    }
+  }
+
+  // The answer of isAllocationFn only depends on the callee for
+  // direct calls without nobuiltin. Otherwise it is false so an
+  // ordinary callee is not added to the table: it could still be an
+  // allocation function for another call site. Like the other
+  // checks, it does not depend on whether the callee has a body.
+  ImmutableCallSite CS(&I);
+  bool is_direct = (CS.getCalledValue() == &callee && !CS.isNoBuiltin());
+  callee_kind_t kind;
+  if (callee.getName().startswith("shadow.mem") ||
+      callee.getName().equals("seahorn.fn.enter")) {
+    kind = CALLEE_SHADOW_MEM;
+  } else if (isVerifierCall(callee)) {
+    kind = CALLEE_VERIFIER;
+  } else if (isAllocationFn(&I, &m_tli)) {
+    kind = CALLEE_ALLOCATOR;
+  } else if (isZeroInitializer(callee) || isIntInitializer(callee) ||
+	     isRangeInitializer(callee)) {
+    kind = CALLEE_INITIALIZER;
+  } else if (callee.isIntrinsic()) {
+    kind = CALLEE_INTRINSIC;
+  } else {
+    kind = CALLEE_ORDINARY;
+  }
+  if (!is_direct && kind == CALLEE_ORDINARY) {
+    return kind;
+  }
+
+  std::lock_guard<std::mutex> lock(shard.m_mutex);
+  shard.m_map.insert({&callee, kind});
+  return kind;
+}
+
+void crabCalleeTable::erase(const Function &f) {
+  Shard &shard = getShard(&f);
+  std::lock_guard<std::mutex> lock(shard.m_mutex);
+  shard.m_map.erase(&f);
+  shard.m_facts.erase(&f);
+}
+
+bool crabCalleeTable::readModels(StringRef filename, std::string &err) {
+  auto buf = MemoryBuffer::getFile(filename);
+  if (!buf) {
+    err = "cannot read " + filename.str() + ": " + buf.getError().message();
+    return false;
+  }
+  for (line_iterator it(**buf, true /*skip blanks*/, '#'); !it.is_at_end(); ++it) {
+    auto error = [&](const Twine &msg) {
+      err = (filename + ":" + Twine(it.line_number()) + ": " + msg).str();
+      return false;
+    };
+    StringRef glob, rest;
+    std::tie(glob, rest) = getToken(*it);
+    Expected<GlobPattern> pattern = GlobPattern::create(glob);
+    if (!pattern) {
+      return error(toString(pattern.takeError()));
+    }
+    unsigned facts = 0;
+    while (true) {
+      StringRef fact;
+      std::tie(fact, rest) = getToken(rest);
+      if (fact.empty()) {
+	break;
+      }
+      if (fact == "readnone") {
+	facts |= MODEL_READNONE;
+      } else if (fact == "readonly") {
+	facts |= MODEL_READONLY;
+      } else if (fact == "argmemonly") {
+	facts |= MODEL_ARGMEMONLY;
+      } else {
+	return error("unknown fact " + fact);
+      }
+    }
+    if (facts == 0) {
+      return error("expected readnone, readonly or argmemonly");
+    }
+    m_models.emplace_back(std::move(*pattern), facts);
+  }
+  return true;
+}
+
+bool crabCalleeTable::mayWriteMemory(const CallInst &I, const Function &callee) {
+  unsigned facts = 0;
+  if (!m_models.empty()) {
+    Shard &shard = getShard(&callee);
+    std::lock_guard<std::mutex> lock(shard.m_mutex);
+    auto it = shard.m_facts.find(&callee);
+    if (it != shard.m_facts.end()) {
+      facts = it->second;
+    } else {
+      for (auto &kv: m_models) {
+	if (kv.first.match(callee.getName())) {
+	  facts = kv.second;
+	  break;
+	}
+      }
+      shard.m_facts.insert({&callee, facts});
+    }
+  }
+
+  ImmutableCallSite CS(&I);
+  if ((facts & (MODEL_READNONE | MODEL_READONLY)) || CS.onlyReadsMemory()) {
+    return false;
+  }
+  if ((facts & MODEL_ARGMEMONLY) || CS.onlyAccessesArgMemory()) {
+    for (unsigned i = 0, e = CS.arg_size(); i < e; ++i) {
+      if (CS.getArgument(i)->getType()->isPointerTy() && !CS.onlyReadsMemory(i)) {
+	return true;
+      }
+    }
+    return false;
+  }
+  return true;
+}
+
+} // end namespace clam
@@ -0,0 +1,104 @@
+#pragma once
+
+/* Classification of the callees of the call sites */
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/GlobPattern.h"
+
+#include <array>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class CallInst;
+class Function;
+class TargetLibraryInfo;
+} // namespace llvm
+
+namespace clam {
+
+// How a call to a function is translated to Crab
+enum callee_kind_t {
+  // a call to a function without special meaning
+  CALLEE_ORDINARY,
+  // shadow.mem.* and seahorn.fn.enter: the call is ignored
+  CALLEE_SHADOW_MEM,
+  // assume, assert, error, etc.
+  CALLEE_VERIFIER,
+  // malloc, calloc, etc.
+  CALLEE_ALLOCATOR,
+  // verifier.zero_initializer, verifier.int_initializer, etc.
+  CALLEE_INITIALIZER,
+  // LLVM intrinsics
+  CALLEE_INTRINSIC,
+};
+
+/*
+ * The kind of each callee is computed the first time the callee is
+ * called and then it is shared by all the CFGs of the module so that
+ * the translation of a call site does not compare names.
+ */
+class crabCalleeTable {
+public:
+  crabCalleeTable(const llvm::TargetLibraryInfo &tli) : m_tli(tli) {}
+
+  crabCalleeTable(const crabCalleeTable &o) = delete;
+
+  crabCalleeTable &operator=(const crabCalleeTable &o) = delete;
+
+  // Return the kind of callee at call site I.
+  callee_kind_t getKind(const llvm::CallInst &I, const llvm::Function &callee);
+
+  // Remove the kind of f. It must be called before f is erased.
+  void erase(const llvm::Function &f);
+
+  /*
+   * Read the memory effects of some external functions from a file
+   * with one entry per line:
+   *
+   *   # comment
+   *   <glob> readnone|readonly|argmemonly ...
+   *
+   * with the meaning of the LLVM function attributes with the same
+   * name. The first entry whose glob matches the name of a function
+   * is used. It must be called before any CFG is built. Return false
+   * and set err if the file cannot be read or an entry is not valid.
+   */
+  bool readModels(llvm::StringRef filename, std::string &err);
+
+  // Return false if the call site I does not write any memory of the
+  // caller: callee (or I) only reads memory, or it only accesses the
+  // memory pointed by its arguments and it only reads them. The facts
+  // come from the models file and the LLVM attributes.
+  bool mayWriteMemory(const llvm::CallInst &I, const llvm::Function &callee);
+
+private:
+  const llvm::TargetLibraryInfo &m_tli;
+
+  enum model_fact_t {
+    MODEL_READNONE = 1,
+    MODEL_READONLY = 2,
+    MODEL_ARGMEMONLY = 4
+  };
+  // the models of the file, in order
+  std::vector<std::pair<llvm::GlobPattern, unsigned>> m_models;
+
+  struct Shard {
+    std::mutex m_mutex;
+    llvm::DenseMap<const llvm::Function *, callee_kind_t> m_map;
+    // facts of the models file, by callee
+    llvm::DenseMap<const llvm::Function *, unsigned> m_facts;
+  };
+  enum { NUM_SHARDS = 16 };
+  std::array<Shard, NUM_SHARDS> m_shards;
+
+  Shard &getShard(const llvm::Function *f) {
+    unsigned h = llvm::DenseMapInfo<const llvm::Function *>::getHashValue(f);
+    return m_shards[h % NUM_SHARDS];
+  }
+};
+
+} // end namespace clam
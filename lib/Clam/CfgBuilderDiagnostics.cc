@@ -0,0 +1,92 @@
+#include "clam/CfgBuilderDiagnostics.hh"
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Value.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+namespace clam {
+
+using namespace llvm;
+
+void CfgBuilderDiagnostics::add(kind_t kind, const Function &f,
+				const Value &example) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto res = m_entries.insert({{kind, &f}, Entry()});
+  Entry &e = res.first->second;
+  if (res.second) {
+    e.kind = kind;
+    e.function = f.getName();
+    e.count = 0;
+  }
+  ++e.count;
+  if (e.examples.size() < m_max_examples) {
+    std::string str;
+    raw_string_ostream o(str);
+    o << example;
+    e.examples.push_back(o.str());
+  }
+}
+
+bool CfgBuilderDiagnostics::empty() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries.empty();
+}
+
+std::vector<CfgBuilderDiagnostics::Entry>
+CfgBuilderDiagnostics::get_entries() const {
+  std::vector<Entry> res;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    res.reserve(m_entries.size());
+    for (auto &kv: m_entries) {
+      res.push_back(kv.second);
+    }
+  }
+  std::sort(res.begin(), res.end(), [](const Entry &e1, const Entry &e2) {
+      return (e1.kind < e2.kind ||
+	      (e1.kind == e2.kind && e1.function < e2.function));
+    });
+  return res;
+}
+
+const char *CfgBuilderDiagnostics::get_kind_name(kind_t kind) {
+  switch (kind) {
+  case UNRESOLVED_INDIRECT_CALL:  return "unresolved-indirect-call";
+  case CONSTANT_EXPR_BRANCH_COND: return "constant-expr-branch-cond";
+  }
+  return "unknown";
+}
+
+const char *CfgBuilderDiagnostics::get_kind_message(kind_t kind) {
+  switch (kind) {
+  case UNRESOLVED_INDIRECT_CALL:
+    return "skipped indirect call. Either --devirt-functions was not used "
+           "or indirect call cannot be resolved.";
+  case CONSTANT_EXPR_BRANCH_COND:
+    return "Clam cfg builder skipped a branch condition with constant expression";
+  }
+  return "unknown";
+}
+
+void CfgBuilderDiagnostics::write(raw_ostream &o) const {
+  std::vector<Entry> entries = get_entries();
+  for (unsigned i = 0, e = entries.size(); i < e; ) {
+    kind_t kind = entries[i].kind;
+    unsigned j = i, total = 0;
+    for (; j < e && entries[j].kind == kind; ++j) {
+      total += entries[j].count;
+    }
+    o << "CLAM WARNING: " << get_kind_message(kind) << "\n"
+      << "  " << total << " occurrence(s) in " << j - i << " function(s):\n";
+    for (; i < j; ++i) {
+      o << "    " << entries[i].function << ": " << entries[i].count << "\n";
+      for (auto &ex: entries[i].examples) {
+	o << "      " << ex << "\n";
+      }
+    }
+  }
+}
+
+} // end namespace clam
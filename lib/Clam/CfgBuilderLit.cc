@@ -5,21 +5,51 @@
 #include "clam/crab/crab_cfg.hh"
 
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalValue.h"
 
 namespace clam {
 
 using namespace llvm;
 using namespace crab;
 
+bool crabLitCache::isShared(const Value &v) {
+  // undefined values are translated to fresh variables so they are
+  // not shared.
+  return (isa<GlobalValue>(v) || isa<ConstantInt>(v) ||
+          isa<ConstantPointerNull>(v));
+}
+
+void crabLitCache::erase(const Value &v) {
+  Shard &shard = getShard(&v);
+  std::lock_guard<std::mutex> lock(shard.m_mutex);
+  shard.m_map.erase(&v);
+}
+
 crabLitFactoryImpl::crabLitFactoryImpl(llvm_variable_factory &vfac,
-                                       const CrabBuilderParams &params)
-    : m_vfac(vfac), m_params(params) {}
+                                       const CrabBuilderParams &params,
+                                       crabLitCache *shared_cache)
+    : m_vfac(vfac), m_params(params), m_shared_cache(shared_cache) {}
 
 crab_lit_ref_t crabLitFactoryImpl::getLit(const Value &v) {
   auto it = m_lit_cache.find(&v);
   if (it != m_lit_cache.end()) {
     return it->second;
   }
+  crab_lit_ref_t ref;
+  if (m_shared_cache && crabLitCache::isShared(v)) {
+    ref = m_shared_cache->findOrCreate(
+        v, [&](BumpPtrAllocator &arena) { return mkLit(v, arena); });
+  } else {
+    ref = mkLit(v, m_arena);
+  }
+  if (ref) {
+    m_lit_cache.insert(binding_t(&v, ref));
+  }
+  return ref;
+}
+
+crab_lit_ref_t crabLitFactoryImpl::mkLit(const Value &v,
+                                         BumpPtrAllocator &arena) {
   const Type &t = *v.getType();
   // Note that getBoolLit, getPtrLit and getIntLit are not aware of
   // which types are tracked or not. They only use type information
@@ -27,26 +57,20 @@ crab_lit_ref_t crabLitFactoryImpl::getLit(const Value &v) {
   if (isBool(&t)) {
     Optional<crabBoolLit> lit = getBoolLit(v);
     if (lit.hasValue()) {
-      crab_lit_ref_t ref = std::static_pointer_cast<crabLit>(
-          std::make_shared<crabBoolLit>(lit.getValue()));
-      m_lit_cache.insert(binding_t(&v, ref));
-      return ref;
+      return std::static_pointer_cast<crabLit>(std::allocate_shared<crabBoolLit>(
+          ArenaAllocator<crabBoolLit>(arena), lit.getValue()));
     }
   } else if (isInteger(&t)) {
     Optional<crabIntLit> lit = getIntLit(v);
     if (lit.hasValue()) {
-      crab_lit_ref_t ref = std::static_pointer_cast<crabLit>(
-          std::make_shared<crabIntLit>(lit.getValue()));
-      m_lit_cache.insert(binding_t(&v, ref));
-      return ref;
+      return std::static_pointer_cast<crabLit>(std::allocate_shared<crabIntLit>(
+          ArenaAllocator<crabIntLit>(arena), lit.getValue()));
     }
   } else if (t.isPointerTy()) {
     Optional<crabPtrLit> lit = getPtrLit(v);
     if (lit.hasValue()) {
-      crab_lit_ref_t ref = std::static_pointer_cast<crabLit>(
-          std::make_shared<crabPtrLit>(lit.getValue()));
-      m_lit_cache.insert(binding_t(&v, ref));
-      return ref;
+      return std::static_pointer_cast<crabLit>(std::allocate_shared<crabPtrLit>(
+          ArenaAllocator<crabPtrLit>(arena), lit.getValue()));
     }
   }
   return nullptr;
@@ -89,7 +113,7 @@ var_t crabLitFactoryImpl::mkArraySingletonVar(Region mem_region,
     // returns zero which means for us "unknown" bitwidth so we are
     // good.
   } else {
-    CLAM_ERROR("Memory region does not belong to a global singleton");
+    CLAM_ERROR("Memory region does not belong to a singleton");
   }
   switch (mem_region.getRegionInfo().get_type()) {
   case INT_REGION:
@@ -242,8 +266,9 @@ Optional<crabIntLit> crabLitFactoryImpl::getIntLit(const Value &v) {
 }
 
 crabLitFactory::crabLitFactory(llvm_variable_factory &vfac,
-                               const CrabBuilderParams &params)
-    : m_impl(new crabLitFactoryImpl(vfac, params)) {}
+                               const CrabBuilderParams &params,
+                               crabLitCache *shared_cache)
+    : m_impl(new crabLitFactoryImpl(vfac, params, shared_cache)) {}
 
 crabLitFactory::~crabLitFactory() { delete m_impl; }
 
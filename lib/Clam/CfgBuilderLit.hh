@@ -2,6 +2,8 @@
 
 /* A wrapper object for a LLVM variable or constant */
 
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -9,6 +11,8 @@
 #include "clam/crab/crab_cfg.hh"
 #include "clam/HeapAbstraction.hh"
 
+#include <array>
+#include <mutex>
 #include <unordered_map>
 
 namespace clam {
@@ -167,12 +171,102 @@ public:
 
 typedef std::shared_ptr<crabLit> crab_lit_ref_t;
 
+/**
+ * STL allocator that allocates from an arena. Memory is only
+ * released when the arena is destroyed so the arena must outlive all
+ * the objects allocated from it.
+ **/
+template <typename T> class ArenaAllocator {
+  template <typename U> friend class ArenaAllocator;
+  llvm::BumpPtrAllocator *m_arena;
+
+public:
+  typedef T value_type;
+
+  explicit ArenaAllocator(llvm::BumpPtrAllocator &arena) : m_arena(&arena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &o) : m_arena(o.m_arena) {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(m_arena->Allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *, std::size_t) {}
+
+  template <typename U> bool operator==(const ArenaAllocator<U> &o) const {
+    return m_arena == o.m_arena;
+  }
+
+  template <typename U> bool operator!=(const ArenaAllocator<U> &o) const {
+    return m_arena != o.m_arena;
+  }
+};
+
+/**
+ * Literals shared by all the functions of a module: globals and
+ * constants. A literal is never modified once it is inserted so the
+ * same literal object can be used by concurrent CFG builders.
+ **/
+class crabLitCache {
+public:
+  crabLitCache() {}
+
+  crabLitCache(const crabLitCache &o) = delete;
+
+  crabLitCache &operator=(const crabLitCache &o) = delete;
+
+  // Return true if the literal of v does not depend on the function
+  // where v is used.
+  static bool isShared(const llvm::Value &v);
+
+  // Return the literal of v. If v has none yet then mk_lit(arena)
+  // creates it from the arena of the cache. mk_lit can return null.
+  template <typename MkLit>
+  crab_lit_ref_t findOrCreate(const llvm::Value &v, MkLit mk_lit) {
+    Shard &shard = getShard(&v);
+    std::lock_guard<std::mutex> lock(shard.m_mutex);
+    auto it = shard.m_map.find(&v);
+    if (it != shard.m_map.end()) {
+      return it->second;
+    }
+    crab_lit_ref_t lit = mk_lit(shard.m_arena);
+    if (lit) {
+      shard.m_map.insert({&v, lit});
+    }
+    return lit;
+  }
+
+  // Remove the literal of v. It must be called before v is erased.
+  void erase(const llvm::Value &v);
+
+private:
+  // The cache is split into shards, each one protected by its own
+  // lock, so that concurrent builders rarely wait for each other.
+  struct Shard {
+    std::mutex m_mutex;
+    // the arena must be destroyed after the literals
+    llvm::BumpPtrAllocator m_arena;
+    std::unordered_map<const llvm::Value *, crab_lit_ref_t> m_map;
+  };
+  enum { NUM_SHARDS = 16 };
+  mutable std::array<Shard, NUM_SHARDS> m_shards;
+
+  Shard &getShard(const llvm::Value *v) const {
+    unsigned h = llvm::DenseMapInfo<const llvm::Value *>::getHashValue(v);
+    return m_shards[h % NUM_SHARDS];
+  }
+};
+
 /* Implementation of a factory to create literals */
 class crabLitFactoryImpl {
 public:
   
+  // If not null, shared_cache keeps the literals of globals and
+  // constants and it is shared with other factories.
   crabLitFactoryImpl(llvm_variable_factory &vfac,
-                     const CrabBuilderParams &params);
+                     const CrabBuilderParams &params,
+                     crabLitCache *shared_cache = nullptr);
 
   llvm_variable_factory &get_vfac() { return m_vfac; }
 
@@ -225,7 +319,15 @@ private:
 
   llvm_variable_factory &m_vfac;
   const CrabBuilderParams &m_params;
+  // the literals of the function are allocated from the arena so
+  // that they are released at once with the factory. It must be
+  // destroyed after m_lit_cache.
+  llvm::BumpPtrAllocator m_arena;
+  // literals of the function (plus the shared literals used by it)
   lit_cache_t m_lit_cache;
+  crabLitCache *m_shared_cache;
+
+  crab_lit_ref_t mkLit(const llvm::Value &v, llvm::BumpPtrAllocator &arena);
   
   llvm::Optional<crabBoolLit> getBoolLit(const llvm::Value &v);
   llvm::Optional<crabIntLit> getIntLit(const llvm::Value &v);
@@ -238,7 +340,8 @@ private:
 class crabLitFactory {
 public:
   
-  crabLitFactory(llvm_variable_factory &vfac, const CrabBuilderParams &params);
+  crabLitFactory(llvm_variable_factory &vfac, const CrabBuilderParams &params,
+                 crabLitCache *shared_cache = nullptr);
 
   ~crabLitFactory();
 
@@ -1,6 +1,10 @@
 #pragma once
 
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Value.h"
 
 #include "clam/HeapAbstraction.hh"
@@ -12,6 +16,11 @@
 #include "CfgBuilderUtils.hh"
 #include "CfgBuilderShadowMem.hh"
 
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
 /**
  *  Convenient utilities to extract memory regions from LLVM
  *  instructions.
@@ -19,19 +28,26 @@
 namespace clam {
 
 typedef typename HeapAbstraction::RegionVec RegionVec;
+// regions of a function or callsite kept on the stack while translating it
+typedef llvm::SmallVector<Region, 8> SmallRegionVec;
 
 // "Switch" function that uses either ShadowMem (mem) or
 // HeapAbstraction (sm) to return the cell pointer a LLVM pointer.
+// If not null, regions is the region map of the function of user
+// (see HeapAbstraction::getRegionMap) and the heap abstraction is
+// only queried for the pointers that are not in the map.
 inline Region get_region(HeapAbstraction &mem,
 			 const sea_dsa::ShadowMem* sm,
 			 const llvm::DataLayout &dl,
-			 llvm::Instruction *user, llvm::Value *ptr) {
+			 llvm::Instruction *user, llvm::Value *ptr,
+			 const HeapAbstraction::RegionMap *regions = nullptr) {
   if (sm) {
     // Use ShadowMem (sm) to access to the cell pointed by the pointer.
     llvm::CallInst *CI = llvm::dyn_cast<llvm::CallInst>(user);
     if (llvm::isa<llvm::LoadInst>(user) || llvm::isa<llvm::StoreInst>(user)) {
       return getShadowRegionFromLoadOrStore(*sm, dl, *user);
-    } else if (CI && (isZeroInitializer(*CI) || isIntInitializer(*CI))) {
+    } else if (CI && (isZeroInitializer(*CI) || isIntInitializer(*CI) ||
+		      isRangeInitializer(*CI))) {
       return getShadowRegionFromGvInitializer(*sm, dl, *user, *ptr);
     } else {
       // To see which instructions we are skipping ...
@@ -39,8 +55,19 @@ inline Region get_region(HeapAbstraction &mem,
     }
   } else {
     // Use the Heap analysis (mem) to access to the cell pointed by the pointer.
-    llvm::Function *fun = user->getParent()->getParent();
-    Region res = mem.getRegion(*fun, user, ptr);
+    Region res;
+    bool found = false;
+    if (regions) {
+      auto it = regions->find(ptr);
+      if (it != regions->end()) {
+	res = it->second;
+	found = true;
+      }
+    }
+    if (!found) {
+      llvm::Function *fun = user->getParent()->getParent();
+      res = mem.getRegion(*fun, user, ptr);
+    }
     if (res.getRegionInfo().get_type() == INT_REGION ||
 	res.getRegionInfo().get_type() == BOOL_REGION) {
       return res;
@@ -49,16 +76,18 @@ inline Region get_region(HeapAbstraction &mem,
   return Region();    
 }
 
-// Return whether the region contains a singleton alias class. 
+// Return whether the region contains a singleton alias class. The
+// singletons that are not globals are the local cells given by
+// promote_local_regions, which is only called if they are enabled.
 inline const llvm::Value *
 get_singleton_value(Region r, bool enable_unique_scalars) {
-  if (enable_unique_scalars) {
-    if (r.isUnknown())
-      return nullptr;
-    if (r.getRegionInfo().get_type() == INT_REGION ||
-	r.getRegionInfo().get_type() == BOOL_REGION) {
-      if (const llvm::Value *v = r.getSingleton()) {
-        return v;
+  if (r.isUnknown())
+    return nullptr;
+  if (r.getRegionInfo().get_type() == INT_REGION ||
+      r.getRegionInfo().get_type() == BOOL_REGION) {
+    if (const llvm::Value *v = r.getSingleton()) {
+      if (enable_unique_scalars || !llvm::isa<llvm::GlobalVariable>(v)) {
+	return v;
       }
     }
   }
@@ -71,9 +100,9 @@ get_singleton_value(Region r, bool enable_unique_scalars) {
 
 // v is either a llvm::Function or llvm::CallInst.
 template <typename V>
-inline RegionVec get_read_only_regions(HeapAbstraction &mem, V &v) {
-  RegionVec res;
-  auto regions = mem.getOnlyReadRegions(v);
+inline SmallRegionVec get_read_only_regions(HeapAbstraction &mem, V &v) {
+  SmallRegionVec res;
+  HeapAbstraction::RegionRef regions = mem.getOnlyReadRegionsRef(v);
   std::copy_if(regions.begin(), regions.end(), std::back_inserter(res),
                [](Region r) {
                  return r.getRegionInfo().get_type() == INT_REGION ||
@@ -84,9 +113,9 @@ inline RegionVec get_read_only_regions(HeapAbstraction &mem, V &v) {
 
 // v is either a llvm::Function or llvm::CallInst.
 template <typename V>
-inline RegionVec get_modified_regions(HeapAbstraction &mem, V &v) {
-  RegionVec res;
-  auto regions = mem.getModifiedRegions(v);
+inline SmallRegionVec get_modified_regions(HeapAbstraction &mem, V &v) {
+  SmallRegionVec res;
+  HeapAbstraction::RegionRef regions = mem.getModifiedRegionsRef(v);
   std::copy_if(regions.begin(), regions.end(), std::back_inserter(res),
                [](Region r) {
                  return r.getRegionInfo().get_type() == INT_REGION ||
@@ -97,9 +126,9 @@ inline RegionVec get_modified_regions(HeapAbstraction &mem, V &v) {
 
 // v is either a llvm::Function or llvm::CallInst.
 template <typename V>
-inline RegionVec get_new_regions(HeapAbstraction &mem, V &v) {
-  RegionVec res;
-  auto regions = mem.getNewRegions(v);
+inline SmallRegionVec get_new_regions(HeapAbstraction &mem, V &v) {
+  SmallRegionVec res;
+  HeapAbstraction::RegionRef regions = mem.getNewRegionsRef(v);
   std::copy_if(regions.begin(), regions.end(), std::back_inserter(res),
                [](Region r) {
                  return r.getRegionInfo().get_type() == INT_REGION ||
@@ -108,4 +137,241 @@ inline RegionVec get_new_regions(HeapAbstraction &mem, V &v) {
   return res;
 }
 
+// Return the copies (dst, src) of regions that translate the memcpy
+// or memmove I of a whole object into a local object of the same
+// type. src is unknown if the regions of the destination at the same
+// offsets are not a single region of the source of the same type.
+//
+// The copies are only returned if they replace the whole contents of
+// the regions of the destination: all the pointers of the function
+// (regions) with a region of the destination point into it and no
+// callsite accesses them. Otherwise, return false.
+inline bool
+get_transfer_regions(HeapAbstraction &mem, const llvm::DataLayout &dl,
+		     const llvm::MemTransferInst &I,
+		     const HeapAbstraction::RegionMap &regions,
+		     std::vector<std::pair<Region, Region>> &copies) {
+  const llvm::ConstantInt *len = llvm::dyn_cast<llvm::ConstantInt>(I.getLength());
+  const llvm::AllocaInst *dst = llvm::dyn_cast<llvm::AllocaInst>(I.getDest());
+  const llvm::Value *src = I.getSource();
+  if (!len || !dst || dst->isArrayAllocation() || dst == src) {
+    return false;
+  }
+  llvm::Type *src_ty = nullptr;
+  if (const llvm::AllocaInst *AI = llvm::dyn_cast<llvm::AllocaInst>(src)) {
+    src_ty = AI->isArrayAllocation() ? nullptr : AI->getAllocatedType();
+  } else if (const llvm::GlobalVariable *GV = llvm::dyn_cast<llvm::GlobalVariable>(src)) {
+    src_ty = GV->getValueType();
+  }
+  if (src_ty != dst->getAllocatedType() ||
+      dl.getTypeAllocSize(src_ty) != len->getZExtValue()) {
+    return false;
+  }
+
+  auto isTrackedRegion = [](Region r) {
+    return (r.getRegionInfo().get_type() == INT_REGION ||
+	    r.getRegionInfo().get_type() == BOOL_REGION);
+  };
+  // regions of dst and src by offset
+  std::multimap<int64_t, Region> dst_fields, src_fields;
+  std::set<Region::RegionId> dst_ids;
+  for (auto &kv: regions) {
+    if (!isTrackedRegion(kv.second)) {
+      continue;
+    }
+    if (llvm::GetUnderlyingObject(kv.first, dl) == dst) {
+      dst_ids.insert(kv.second.get_id());
+    }
+    int64_t offset = 0;
+    const llvm::Value *base = llvm::GetPointerBaseWithConstantOffset(kv.first, offset, dl);
+    if (base == dst) {
+      dst_fields.insert({offset, kv.second});
+    } else if (base == src) {
+      src_fields.insert({offset, kv.second});
+    }
+  }
+  // -- the regions of dst only contain dst
+  for (auto &kv: regions) {
+    if (dst_ids.count(kv.second.get_id()) &&
+	llvm::GetUnderlyingObject(kv.first, dl) != dst) {
+      return false;
+    }
+  }
+  const llvm::Function &F = *I.getParent()->getParent();
+  for (auto &J: llvm::instructions(F)) {
+    const llvm::CallInst *CI = llvm::dyn_cast<llvm::CallInst>(&J);
+    if (!CI || llvm::isa<llvm::IntrinsicInst>(CI)) {
+      continue;
+    }
+    for (auto &rs: {get_read_only_regions(mem, *CI), get_modified_regions(mem, *CI),
+		    get_new_regions(mem, *CI)}) {
+      for (auto &r: rs) {
+	if (dst_ids.count(r.get_id())) {
+	  return false;
+	}
+      }
+    }
+  }
+
+  // -- the source of each region of dst: unknown if there is none or
+  //    several
+  std::set<Region> dst_regions;
+  std::map<Region, Region> sources;
+  std::set<Region> unknown;
+  for (auto &kv: dst_fields) {
+    const Region &d = kv.second;
+    dst_regions.insert(d);
+    auto range = src_fields.equal_range(kv.first);
+    if (range.first == range.second) {
+      unknown.insert(d);
+    }
+    for (auto it = range.first; it != range.second; ++it) {
+      auto res = sources.insert({d, it->second});
+      if (!(it->second.getRegionInfo() == d.getRegionInfo()) ||
+	  !(res.first->second == it->second)) {
+	unknown.insert(d);
+      }
+    }
+  }
+  for (Region::RegionId id: dst_ids) {
+    if (std::none_of(dst_regions.begin(), dst_regions.end(),
+		     [id](const Region &r) { return r.get_id() == id; })) {
+      // -- a region of dst without a constant offset
+      return false;
+    }
+  }
+  for (const Region &d: dst_regions) {
+    copies.push_back({d, unknown.count(d) ? Region() : sources[d]});
+  }
+  return true;
+}
+
+// Promote to scalars the regions of F that are a single cell of a
+// local object. A region is promoted if all its pointers in regions
+// point to the same offset of a static alloca of F, all its accesses
+// are loads and stores of the same integer type, no callsite accesses
+// it, and the address of the alloca only flows into loads and stores,
+// possibly through casts and GEPs with constant indices. promoted is
+// regions where the promoted regions have as singleton the pointer of
+// one of their accesses (see get_singleton_value). Return the number
+// of promoted regions.
+inline unsigned
+promote_local_regions(HeapAbstraction &mem, const llvm::DataLayout &dl,
+		      const llvm::Function &F,
+		      const HeapAbstraction::RegionMap &regions,
+		      HeapAbstraction::RegionMap &promoted) {
+  struct cell_t {
+    const llvm::Value *base;
+    int64_t offset;
+    llvm::Type *type;
+    const llvm::Value *ptr;
+    bool valid;
+  };
+  std::map<Region::RegionId, cell_t> cells;
+  auto addAccess = [&](const llvm::Value *ptr, llvm::Type *ty) {
+    auto it = regions.find(ptr);
+    if (it == regions.end()) {
+      return;
+    }
+    Region r = it->second;
+    if (r.getRegionInfo().get_type() != INT_REGION &&
+	r.getRegionInfo().get_type() != BOOL_REGION) {
+      return;
+    }
+    int64_t offset = 0;
+    const llvm::Value *base = llvm::GetPointerBaseWithConstantOffset(ptr, offset, dl);
+    auto res = cells.insert({r.get_id(), {base, offset, ty, ptr, ty->isIntegerTy()}});
+    cell_t &c = res.first->second;
+    if (c.base != base || c.offset != offset || c.type != ty) {
+      c.valid = false;
+    }
+  };
+  auto isLifetimeMarker = [](const llvm::User *U) {
+    const llvm::IntrinsicInst *II = llvm::dyn_cast<llvm::IntrinsicInst>(U);
+    return II && (II->getIntrinsicID() == llvm::Intrinsic::lifetime_start ||
+		  II->getIntrinsicID() == llvm::Intrinsic::lifetime_end);
+  };
+
+  // -- the accesses of the allocas whose address does not escape
+  for (auto &I: llvm::instructions(F)) {
+    const llvm::AllocaInst *AI = llvm::dyn_cast<llvm::AllocaInst>(&I);
+    if (!AI || !AI->isStaticAlloca()) {
+      continue;
+    }
+    std::vector<std::pair<const llvm::Value *, llvm::Type *>> accesses;
+    llvm::SmallVector<const llvm::Value *, 8> worklist;
+    worklist.push_back(AI);
+    bool escapes = false;
+    while (!worklist.empty() && !escapes) {
+      const llvm::Value *v = worklist.pop_back_val();
+      for (const llvm::User *U: v->users()) {
+	if (const llvm::LoadInst *LI = llvm::dyn_cast<llvm::LoadInst>(U)) {
+	  escapes |= LI->isVolatile();
+	  accesses.push_back({v, LI->getType()});
+	} else if (const llvm::StoreInst *SI = llvm::dyn_cast<llvm::StoreInst>(U)) {
+	  escapes |= (SI->isVolatile() || SI->getValueOperand() == v);
+	  accesses.push_back({v, SI->getValueOperand()->getType()});
+	} else if (const llvm::GetElementPtrInst *GEP =
+		   llvm::dyn_cast<llvm::GetElementPtrInst>(U)) {
+	  escapes |= !GEP->hasAllConstantIndices();
+	  worklist.push_back(U);
+	} else if (llvm::isa<llvm::BitCastInst>(U)) {
+	  worklist.push_back(U);
+	} else if (!isLifetimeMarker(U)) {
+	  escapes = true;
+	}
+      }
+    }
+    if (!escapes) {
+      for (auto &a: accesses) {
+	addAccess(a.first, a.second);
+      }
+    }
+  }
+  // -- the same cell through all the pointers of the region
+  for (auto &kv: regions) {
+    auto it = cells.find(kv.second.get_id());
+    if (it == cells.end() || !it->second.valid) {
+      continue;
+    }
+    int64_t offset = 0;
+    const llvm::Value *base =
+      llvm::GetPointerBaseWithConstantOffset(kv.first, offset, dl);
+    if (base != it->second.base || offset != it->second.offset) {
+      it->second.valid = false;
+    }
+  }
+  for (auto &I: llvm::instructions(F)) {
+    const llvm::CallInst *CI = llvm::dyn_cast<llvm::CallInst>(&I);
+    if (!CI || llvm::isa<llvm::IntrinsicInst>(CI)) {
+      continue;
+    }
+    for (auto &rs: {get_read_only_regions(mem, *CI), get_modified_regions(mem, *CI),
+		    get_new_regions(mem, *CI)}) {
+      for (auto &r: rs) {
+	auto it = cells.find(r.get_id());
+	if (it != cells.end()) {
+	  it->second.valid = false;
+	}
+      }
+    }
+  }
+
+  promoted = regions;
+  unsigned num_promoted = 0;
+  for (auto &kv: cells) {
+    num_promoted += kv.second.valid;
+  }
+  if (num_promoted > 0) {
+    for (auto &kv: promoted) {
+      auto it = cells.find(kv.second.get_id());
+      if (it != cells.end() && it->second.valid) {
+	kv.second = Region(kv.second.get_id(), kv.second.getRegionInfo(),
+			   it->second.ptr);
+      }
+    }
+  }
+  return num_promoted;
+}
+
 } // end namespace clam
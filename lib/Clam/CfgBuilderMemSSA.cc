@@ -0,0 +1,248 @@
+#include "CfgBuilderMemSSA.hh"
+#include "CfgBuilderLit.hh"
+#include "CfgBuilderMemRegions.hh"
+#include "CfgBuilderUtils.hh"
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/IteratedDominanceFrontier.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+
+#include <map>
+#include <set>
+
+namespace clam {
+
+using namespace llvm;
+
+RegionMemorySSA::RegionMemorySSA(Function &F, HeapAbstraction &mem,
+				 const DataLayout &dl, crabLitFactory &lfac,
+				 const CrabBuilderParams &params,
+				 const HeapAbstraction::RegionMap *region_map) {
+  if (F.isDeclaration()) {
+    return;
+  }
+
+  /// -- collect the regions accessed by loads and stores and the
+  ///    regions accessed by anything else.
+  std::map<Region::RegionId, Region> candidates;
+  std::set<Region::RegionId> excluded;
+  DenseMap<Region::RegionId, SmallPtrSet<BasicBlock*, 8>> def_blocks;
+  DenseMap<const Instruction*, Region::RegionId> accesses;
+  const HeapAbstraction::RegionMap &regions =
+    (region_map ? *region_map : mem.getRegionMap(F));
+
+  auto addAccess = [&](Instruction &I, Value *ptr) {
+    if (isa<ConstantExpr>(ptr)) {
+      // not translated
+      return;
+    }
+    Region r = get_region(mem, nullptr, dl, &I, ptr, &regions);
+    if (r.isUnknown() || get_singleton_value(r, params.lower_singleton_aliases)) {
+      return;
+    }
+    candidates.insert({r.get_id(), r});
+    accesses.insert({&I, r.get_id()});
+    if (isa<StoreInst>(I)) {
+      def_blocks[r.get_id()].insert(I.getParent());
+    }
+  };
+  auto exclude = [&excluded](Region r) {
+    if (!r.isUnknown()) {
+      excluded.insert(r.get_id());
+    }
+  };
+  auto excludeAll = [&exclude](const SmallRegionVec &regions) {
+    for (auto r: regions) {
+      exclude(r);
+    }
+  };
+
+  const BasicBlock *entry = &F.getEntryBlock();
+  for (auto &B: F) {
+    for (auto &I: B) {
+      if (StoreInst *SI = dyn_cast<StoreInst>(&I)) {
+	Value &val = *SI->getValueOperand();
+	if (isInteger(val) || isBool(val)) {
+	  addAccess(I, SI->getPointerOperand());
+	}
+      } else if (LoadInst *LI = dyn_cast<LoadInst>(&I)) {
+	if (isTracked(*LI, params) && (isInteger(*LI) || isBool(*LI))) {
+	  addAccess(I, LI->getPointerOperand());
+	}
+      } else if (AllocaInst *AI = dyn_cast<AllocaInst>(&I)) {
+	// an alloca in the entry block initializes the entry version
+	if (&B != entry) {
+	  exclude(get_region(mem, nullptr, dl, AI, AI, &regions));
+	}
+      } else if (CallInst *CI = dyn_cast<CallInst>(&I)) {
+	const Function *callee =
+	  dyn_cast<Function>(CI->getCalledValue()->stripPointerCasts());
+	if (callee && (callee->getName().startswith("shadow.mem") ||
+		       callee->getName().equals("seahorn.fn.enter") ||
+		       isVerifierCall(*callee))) {
+	  continue;
+	}
+	if (MemIntrinsic *MI = dyn_cast<MemIntrinsic>(CI)) {
+	  exclude(get_region(mem, nullptr, dl, CI, MI->getDest(), &regions));
+	  if (MemTransferInst *MT = dyn_cast<MemTransferInst>(MI)) {
+	    exclude(get_region(mem, nullptr, dl, CI, MT->getSource(), &regions));
+	    // -- the other regions copied by the transfer (see
+	    //    CrabInstVisitor::doMemIntrinsic)
+	    std::vector<std::pair<Region, Region>> copies;
+	    if (get_transfer_regions(mem, dl, *MT, regions, copies)) {
+	      for (auto &c: copies) {
+		exclude(c.first);
+		exclude(c.second);
+	      }
+	    }
+	  }
+	  continue;
+	}
+	if (callee && (isZeroInitializer(*callee) || isIntInitializer(*callee) ||
+		       isRangeInitializer(*callee))) {
+	  exclude(get_region(mem, nullptr, dl, CI, CI->getArgOperand(0), &regions));
+	  continue;
+	}
+	if (callee && callee->isIntrinsic()) {
+	  continue;
+	}
+	excludeAll(get_read_only_regions(mem, *CI));
+	excludeAll(get_modified_regions(mem, *CI));
+	excludeAll(get_new_regions(mem, *CI));
+      }
+    }
+  }
+
+  DenseMap<Region::RegionId, unsigned> index;
+  for (auto &kv: candidates) {
+    if (excluded.count(kv.first) || !def_blocks.count(kv.first)) {
+      // a region that is never written does not need versions
+      continue;
+    }
+    index.insert({kv.first, m_regions.size()});
+    m_regions.emplace_back(kv.second, lfac.mkArrayVar(kv.second));
+  }
+  if (m_regions.empty()) {
+    return;
+  }
+
+  auto mkVersion = [&lfac](const Region &r) {
+    if (r.getRegionInfo().get_type() == BOOL_REGION) {
+      return lfac.mkBoolArrayVar();
+    } else {
+      return lfac.mkIntArrayVar(r.getRegionInfo().get_bitwidth());
+    }
+  };
+
+  /// -- place the phi nodes of each region at the iterated dominance
+  ///    frontier of its stores (as LLVM MemorySSA does for the whole
+  ///    memory).
+  DominatorTree DT(F);
+  ForwardIDFCalculator IDF(DT);
+  for (auto &kv: index) {
+    RegionVersions &rv = m_regions[kv.second];
+    IDF.setDefiningBlocks(def_blocks[kv.first]);
+    SmallVector<BasicBlock*, 32> phi_blocks;
+    IDF.calculate(phi_blocks);
+    for (BasicBlock *B: phi_blocks) {
+      rv.m_phis.insert({B, mkVersion(rv.m_region)});
+    }
+  }
+
+  /// -- rename in dominator tree order. The version at the entry of a
+  ///    block is its phi node or the version at the end of its
+  ///    immediate dominator.
+  DenseMap<const Instruction*, unsigned> inst_index;
+  for (auto &kv: accesses) {
+    auto it = index.find(kv.second);
+    if (it != index.end()) {
+      inst_index.insert({kv.first, it->second});
+    }
+  }
+  std::vector<var_t> cur;
+  cur.reserve(m_regions.size());
+  for (auto &rv: m_regions) {
+    cur.push_back(rv.m_base);
+  }
+  for (DomTreeNode *N: depth_first(DT.getRootNode())) {
+    BasicBlock *B = N->getBlock();
+    DomTreeNode *IDom = N->getIDom();
+    for (unsigned k = 0, e = m_regions.size(); k < e; ++k) {
+      RegionVersions &rv = m_regions[k];
+      auto it = rv.m_phis.find(B);
+      if (it != rv.m_phis.end()) {
+	cur[k] = it->second;
+      } else if (IDom) {
+	cur[k] = rv.m_ends.find(IDom->getBlock())->second;
+      } else {
+	cur[k] = rv.m_base;
+      }
+    }
+    for (auto &I: *B) {
+      auto it = inst_index.find(&I);
+      if (it == inst_index.end()) {
+	continue;
+      }
+      unsigned k = it->second;
+      m_uses.insert({&I, cur[k]});
+      if (isa<StoreInst>(I)) {
+	var_t v = mkVersion(m_regions[k].m_region);
+	m_defs.insert({&I, v});
+	cur[k] = v;
+      }
+    }
+    for (unsigned k = 0, e = m_regions.size(); k < e; ++k) {
+      m_regions[k].m_ends.insert({B, cur[k]});
+    }
+  }
+}
+
+Optional<var_t> RegionMemorySSA::getUse(const Instruction &I) const {
+  auto it = m_uses.find(&I);
+  if (it != m_uses.end()) {
+    return it->second;
+  }
+  return None;
+}
+
+Optional<var_t> RegionMemorySSA::getDef(const StoreInst &I) const {
+  auto it = m_defs.find(&I);
+  if (it != m_defs.end()) {
+    return it->second;
+  }
+  return None;
+}
+
+void RegionMemorySSA::getPhiCopies(const BasicBlock &src, const BasicBlock &dst,
+				   copy_vector_t &copies) const {
+  for (auto &rv: m_regions) {
+    auto phi_it = rv.m_phis.find(&dst);
+    if (phi_it == rv.m_phis.end()) {
+      continue;
+    }
+    auto end_it = rv.m_ends.find(&src);
+    if (end_it == rv.m_ends.end()) {
+      // src is not reachable from the entry
+      continue;
+    }
+    if (!(phi_it->second == end_it->second)) {
+      copies.push_back({phi_it->second, end_it->second});
+    }
+  }
+}
+
+void RegionMemorySSA::getExitCopies(const BasicBlock &bb,
+				    copy_vector_t &copies) const {
+  for (auto &rv: m_regions) {
+    auto end_it = rv.m_ends.find(&bb);
+    if (end_it != rv.m_ends.end() && !(end_it->second == rv.m_base)) {
+      copies.push_back({rv.m_base, end_it->second});
+    }
+  }
+}
+
+} // end namespace clam
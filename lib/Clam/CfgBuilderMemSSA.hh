@@ -0,0 +1,86 @@
+#pragma once
+
+/*
+ * Memory SSA form of the array variables of a function built from
+ * the regions of the heap abstraction. Unlike the translation based
+ * on sea-dsa ShadowMem, the bitcode is not instrumented with
+ * shadow.mem functions.
+ */
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
+
+#include "clam/crab/crab_cfg.hh"
+#include "clam/HeapAbstraction.hh"
+#include "clam/CfgBuilderParams.hh"
+
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class BasicBlock;
+class DataLayout;
+class Function;
+class Instruction;
+class StoreInst;
+}
+
+namespace clam {
+
+class crabLitFactory;
+
+class RegionMemorySSA {
+public:
+  typedef std::vector<std::pair<var_t, var_t>> copy_vector_t;
+
+  /*
+   * A region is put in SSA form only if all its accesses in F are
+   * loads and stores (allocas in the entry block are also allowed).
+   * The other regions (e.g., accessed by callsites or memory
+   * intrinsics) and singleton regions keep a single array variable.
+   * If not null, regions replaces the region map of F (e.g., after
+   * promote_local_regions).
+   */
+  RegionMemorySSA(llvm::Function &F, HeapAbstraction &mem,
+		  const llvm::DataLayout &dl, crabLitFactory &lfac,
+		  const CrabBuilderParams &params,
+		  const HeapAbstraction::RegionMap *regions = nullptr);
+
+  RegionMemorySSA(const RegionMemorySSA &o) = delete;
+
+  RegionMemorySSA &operator=(const RegionMemorySSA &o) = delete;
+
+  // Version read by a load or store. None if not in SSA form.
+  llvm::Optional<var_t> getUse(const llvm::Instruction &I) const;
+
+  // Version defined by a store. None if not in SSA form.
+  llvm::Optional<var_t> getDef(const llvm::StoreInst &I) const;
+
+  // Copies (lhs, rhs) of the versions merged at dst along the edge
+  // src -> dst.
+  void getPhiCopies(const llvm::BasicBlock &src, const llvm::BasicBlock &dst,
+		    copy_vector_t &copies) const;
+
+  // Copies (lhs, rhs) from the last version at the end of bb to the
+  // array variable of the region. They are needed if the array
+  // variables are outputs of the function.
+  void getExitCopies(const llvm::BasicBlock &bb, copy_vector_t &copies) const;
+
+  unsigned num_regions() const { return m_regions.size(); }
+
+private:
+  struct RegionVersions {
+    Region m_region;
+    // version at the entry of the function
+    var_t m_base;
+    llvm::DenseMap<const llvm::BasicBlock *, var_t> m_phis;
+    llvm::DenseMap<const llvm::BasicBlock *, var_t> m_ends;
+    RegionVersions(Region r, var_t base): m_region(r), m_base(base) {}
+  };
+
+  std::vector<RegionVersions> m_regions;
+  llvm::DenseMap<const llvm::Instruction *, var_t> m_uses;
+  llvm::DenseMap<const llvm::Instruction *, var_t> m_defs;
+};
+
+} // end namespace clam
@@ -151,8 +151,8 @@ Region getShadowRegion(llvm::CallInst &shadowInst,
   return Region();
 }
 
-// Find shadow mem instruction from a verifier.int_initializer or
-// verifier.zero_initializer call.
+// Find shadow mem instruction from a verifier.int_initializer,
+// verifier.zero_initializer or verifier.range_initializer call.
 CallInst* getShadowCIFromGvInitializer(const sea_dsa::ShadowMem &sm,
 				       llvm::Instruction &gvInitInst,
 				       llvm::Value &v) {
@@ -9,6 +9,9 @@
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Value.h"
 
+#include <cstdint>
+#include <cstdio>
+
 namespace clam {
 
 using namespace ikos;
@@ -16,15 +19,8 @@ using namespace llvm;
 
 // Any integer that cannot be represented by 64 bits is considered a bignum.
 bool isSignedBigNum(const APInt &v) {
-  unsigned b = v.getBitWidth();
-  if (b <= 64) {
-    return false;
-  } else {
-    // if bitwidth > 64 then we check the actual value
-    APInt max(b, APInt::getSignedMaxValue(64).getSExtValue(), true);
-    APInt min(b, APInt::getSignedMinValue(64).getSExtValue(), true);
-    return (v.sgt(max) || v.slt(min));
-  }
+  // without building the 64-bit bounds as APInts of v's bitwidth
+  return v.getMinSignedBits() > 64;
 }
 
 bool isBool(const Type *t) { return (t->isIntegerTy(1)); }
@@ -49,6 +45,10 @@ z_number toZNumber(const APInt &v, const CrabBuilderParams &params,
   if (!params.enable_bignums) {
     is_bignum = isSignedBigNum(v);
   }
+  if (v.getMinSignedBits() <= 64) {
+    // common case: no need to go through the limbs
+    return z_number((int64_t)v.getSExtValue());
+  }
 #if 0
   // Convert to strings is not ideal but it shouldn't be a big
   // bottleneck.
@@ -78,6 +78,30 @@ z_number getIntConstant(const ConstantInt *CI, const CrabBuilderParams &params,
   }
 }
 
+bool toInt64(const z_number &n, int64_t &res) {
+  // z_number is a mpz_class so the check does not build a string
+  mpz_srcptr z = n.get_mpz_t();
+  if (sizeof(long) == sizeof(int64_t) && mpz_fits_slong_p(z)) {
+    res = (int64_t)mpz_get_si(z);
+    return true;
+  }
+  if (mpz_sizeinbase(z, 2) > 63) {
+    // INT64_MIN is the only 64-bit number that needs 64 bits
+    if (mpz_cmp_si(z, 0) >= 0 || mpz_sizeinbase(z, 2) > 64 ||
+	mpz_scan1(z, 0) != 63) {
+      return false;
+    }
+    res = INT64_MIN;
+    return true;
+  }
+  // long has 32 bits: build the number from its two halves
+  uint64_t mag = 0;
+  size_t count = 0;
+  mpz_export(&mag, &count, -1, sizeof(uint64_t), 0, 0, z);
+  res = mpz_sgn(z) < 0 ? -(int64_t)mag : (int64_t)mag;
+  return true;
+}
+
 bool isTrackedType(const Type &ty, const CrabBuilderParams &params) {
   // -- a pointer
   if (ty.isPointerTy())
@@ -127,21 +151,53 @@ crab::cfg::debug_info getDebugLoc(const Instruction *inst) {
   return crab::cfg::debug_info(File, Line, Col);
 }
 
+std::string jsonEscape(StringRef str) {
+  std::string res;
+  for (char c : str) {
+    switch (c) {
+    case '"':
+      res += "\\\"";
+      break;
+    case '\\':
+      res += "\\\\";
+      break;
+    case '\n':
+      res += "\\n";
+      break;
+    case '\t':
+      res += "\\t";
+      break;
+    default:
+      if ((unsigned char)c < 0x20) {
+        char buf[8];
+        snprintf(buf, sizeof(buf), "\\u%04x", c);
+        res += buf;
+      } else {
+        res += c;
+      }
+    }
+  }
+  return res;
+}
+
 uint64_t storageSize(const Type *t, const DataLayout &dl) {
   return dl.getTypeStoreSize(const_cast<Type *>(t));
 }
 
-void normalizeCmpInst(CmpInst &I) {
+CmpInst::Predicate normalizeCmpInst(const CmpInst &I, const Value *&op0,
+				    const Value *&op1) {
   switch (I.getPredicate()) {
   case ICmpInst::ICMP_UGT:
   case ICmpInst::ICMP_SGT:
-    I.swapOperands();
-    break;
   case ICmpInst::ICMP_UGE:
   case ICmpInst::ICMP_SGE:
-    I.swapOperands();
-    break;
-  default:;
+    op0 = I.getOperand(1);
+    op1 = I.getOperand(0);
+    return I.getSwappedPredicate();
+  default:
+    op0 = I.getOperand(0);
+    op1 = I.getOperand(1);
+    return I.getPredicate();
   }
 }
 
@@ -237,6 +293,19 @@ bool isIntInitializer(const CallInst &CI) {
   return false;
 }
 
+bool isRangeInitializer(const Function &F) {
+  return F.getName().startswith("verifier.range_initializer");
+}
+
+bool isRangeInitializer(const CallInst &CI) {
+  ImmutableCallSite CS(&CI);
+  const Value *calleeV = CS.getCalledValue();
+  if (const Function *callee = dyn_cast<Function>(calleeV->stripPointerCasts())) {
+    return isRangeInitializer(*callee);
+  }
+  return false;
+}
+
 // Return true if all uses are BranchInst's
 bool AllUsesAreBrInst(Value &V) {
   // XXX: do not strip pointers here
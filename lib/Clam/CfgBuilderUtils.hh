@@ -2,6 +2,10 @@
 
 #include "clam/CfgBuilderParams.hh"
 #include "clam/crab/crab_cfg.hh"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/InstrTypes.h"
+
+#include <string>
 
 namespace llvm {
 class Type;
@@ -40,6 +44,9 @@ ikos::z_number toZNumber(const llvm::APInt &v, const CrabBuilderParams &params,
 ikos::z_number getIntConstant(const llvm::ConstantInt *CI,
                               const CrabBuilderParams &params, bool &is_bignum);
 
+// Return true and set res if n fits in 64 bits
+bool toInt64(const ikos::z_number &n, int64_t &res);
+
 bool isTrackedType(const llvm::Type &ty, const CrabBuilderParams &params);
 
 bool isTracked(const llvm::Value &v, const CrabBuilderParams &params);
@@ -60,8 +67,16 @@ crab::cfg::debug_info getDebugLoc(const llvm::Instruction *inst);
 
 uint64_t storageSize(const llvm::Type *t, const llvm::DataLayout &dl);
 
-// Convert GT integer comparisons  to GE
-void normalizeCmpInst(llvm::CmpInst &I);
+// Escape str to be a JSON string
+std::string jsonEscape(llvm::StringRef str);
+
+// Return the predicate of I after converting GT (GE) integer
+// comparisons to LT (LE) by swapping the operands, which are returned
+// in op0 and op1. I is not modified so that functions can be
+// translated concurrently.
+llvm::CmpInst::Predicate normalizeCmpInst(const llvm::CmpInst &I,
+					  const llvm::Value *&op0,
+					  const llvm::Value *&op1);
 
 bool isIntToBool(const llvm::CastInt &I);
 
@@ -95,6 +110,10 @@ bool isIntInitializer(const llvm::Function &F);
 
 bool isIntInitializer(const llvm::CallInst &CI);
 
+bool isRangeInitializer(const llvm::Function &F);
+
+bool isRangeInitializer(const llvm::CallInst &CI);
+
 // Return true if all uses are BranchInst's
 bool AllUsesAreBrInst(llvm::Value &V);
 
@@ -0,0 +1,119 @@
+#include "ChangedLines.hh"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace clam {
+
+using namespace llvm;
+
+// a is b or a ends with /b
+static bool isPathSuffix(StringRef a, StringRef b) {
+  if (b.empty() || !a.endswith(b)) {
+    return false;
+  }
+  return a.size() == b.size() || a[a.size() - b.size() - 1] == '/' ||
+    b.front() == '/';
+}
+
+bool ChangedLines::readFile(StringRef filename, std::string &err) {
+  auto buf = MemoryBuffer::getFile(filename);
+  if (!buf) {
+    err = "cannot read " + filename.str() + ": " + buf.getError().message();
+    return false;
+  }
+  for (line_iterator it(**buf, true /*skip blanks*/, '#'); !it.is_at_end(); ++it) {
+    auto error = [&](const Twine &msg) {
+      err = (filename + ":" + Twine(it.line_number()) + ": " + msg).str();
+      return false;
+    };
+    StringRef entry = it->trim();
+    size_t colon = entry.rfind(':');
+    if (colon == StringRef::npos || colon == 0) {
+      return error("expected <file>:<ranges> instead of " + entry);
+    }
+    StringRef file = entry.substr(0, colon);
+    SmallVector<StringRef, 4> ranges;
+    entry.substr(colon + 1).split(ranges, ',', -1, false /*keep empty*/);
+    if (ranges.empty()) {
+      return error("expected line ranges after " + file);
+    }
+    for (StringRef r: ranges) {
+      StringRef first, last;
+      std::tie(first, last) = r.trim().split('-');
+      unsigned begin, end;
+      if (first.getAsInteger(10, begin)) {
+	return error("expected a line number instead of " + first);
+      }
+      end = begin;
+      if (!last.empty() && last.getAsInteger(10, end)) {
+	return error("expected a line number instead of " + last);
+      }
+      if (end < begin) {
+	return error("empty line range " + r);
+      }
+      m_ranges.push_back({file.str(), begin, end});
+    }
+  }
+  return true;
+}
+
+bool ChangedLines::isChanged(StringRef dir, StringRef file, unsigned line) const {
+  std::string path = (file.startswith("/") || dir.empty()) ?
+    file.str() : (dir + "/" + file).str();
+  for (auto &r: m_ranges) {
+    if (line < r.begin || line > r.end) {
+      continue;
+    }
+    if (isPathSuffix(path, r.file) || isPathSuffix(r.file, file)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::set<const Function *> ChangedLines::getChangedFunctions(const Module &M) const {
+  std::set<const Function *> res;
+  for (auto &F: M) {
+    if (F.isDeclaration()) {
+      continue;
+    }
+    if (const DISubprogram *SP = F.getSubprogram()) {
+      if (isChanged(SP->getDirectory(), SP->getFilename(), SP->getLine())) {
+	res.insert(&F);
+	continue;
+      }
+    }
+    bool changed = false;
+    for (auto &I: instructions(F)) {
+      // -- the location of the instruction and of the call sites
+      //    where it was inlined
+      for (const DILocation *loc = I.getDebugLoc().get(); loc && !changed;
+	   loc = loc->getInlinedAt()) {
+	changed = isChanged(loc->getDirectory(), loc->getFilename(), loc->getLine());
+      }
+      if (changed) {
+	res.insert(&F);
+	break;
+      }
+    }
+  }
+  return res;
+}
+
+bool ChangedLines::hasDebugInfo(const Module &M) {
+  for (auto &F: M) {
+    if (F.getSubprogram()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // end namespace clam
@@ -0,0 +1,61 @@
+#pragma once
+
+/* Functions of a module that changed according to a list of source lines */
+
+#include "llvm/ADT/StringRef.h"
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class Function;
+class Module;
+}
+
+namespace clam {
+
+/*
+ * The changed lines come from a file with one entry per line:
+ *
+ *   # comment
+ *   <file>:<range>,...,<range>
+ *
+ * where a range is either a line L or L1-L2 (both included). The file
+ * of an entry and the file of a debug location are the same if one is
+ * a suffix of the other at a path separator (e.g., src/foo.c and
+ * /home/ci/project/src/foo.c).
+ *
+ * A function changed if one of its instructions has a debug location
+ * in a range, either its own location or the location of a call site
+ * where it was inlined, or if the line of its declaration is in a
+ * range. The module must be compiled with debug information (-g).
+ */
+class ChangedLines {
+public:
+  // Return false and set err if the file cannot be read or an entry
+  // is not valid.
+  bool readFile(llvm::StringRef filename, std::string &err);
+
+  bool empty() const { return m_ranges.empty(); }
+
+  // Return the functions of M with a changed line.
+  std::set<const llvm::Function *> getChangedFunctions(const llvm::Module &M) const;
+
+  // Return true if at least one function of M has debug information
+  static bool hasDebugInfo(const llvm::Module &M);
+
+private:
+  struct range_t {
+    std::string file;
+    unsigned begin;
+    unsigned end;
+  };
+
+  bool isChanged(llvm::StringRef dir, llvm::StringRef file, unsigned line) const;
+
+  std::vector<range_t> m_ranges;
+};
+
+} // end namespace clam
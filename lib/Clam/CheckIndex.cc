@@ -0,0 +1,261 @@
+#include "clam/CheckIndex.hh"
+#include "CheckIndexWriter.hh"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "clam/Support/Debug.hh"
+
+namespace clam {
+
+using namespace llvm;
+
+static const char MAGIC[] = "CLAMCHKI";
+static const uint32_t HEADER_SIZE = 32;
+static const uint32_t FILE_SIZE = 16;
+static const uint32_t CHECK_SIZE = 24;
+
+/** Reader **/
+
+CheckIndex::CheckIndex(std::unique_ptr<MemoryBuffer> buf)
+    : m_buf(std::move(buf)), m_data(m_buf->getBufferStart()) {
+  m_num_files = u32(12);
+  m_files = u32(16);
+  m_num_checks = u32(20);
+  m_checks = u32(24);
+}
+
+uint32_t CheckIndex::u32(uint32_t offset) const {
+  return support::endian::read32le(m_data + offset);
+}
+
+std::unique_ptr<CheckIndex> CheckIndex::open(StringRef filename,
+                                             std::string &err) {
+  // large files are memory-mapped by MemoryBuffer
+  auto buf = MemoryBuffer::getFile(filename, -1,
+                                   /*RequiresNullTerminator=*/false);
+  if (!buf) {
+    err = buf.getError().message();
+    return nullptr;
+  }
+  StringRef data = (*buf)->getBuffer();
+  if (data.size() < HEADER_SIZE || !data.startswith(StringRef(MAGIC, 8))) {
+    err = "not a check index";
+    return nullptr;
+  }
+  std::unique_ptr<CheckIndex> idx(new CheckIndex(std::move(*buf)));
+  if (idx->u32(8) != VERSION) {
+    err = "unsupported check index version";
+    return nullptr;
+  }
+  auto fits = [&data](uint64_t offset, uint64_t n, uint64_t size) {
+    return offset + n * size <= data.size();
+  };
+  if (!fits(idx->m_files, idx->m_num_files, FILE_SIZE) ||
+      !fits(idx->m_checks, idx->m_num_checks, CHECK_SIZE)) {
+    err = "corrupted check index";
+    return nullptr;
+  }
+  return idx;
+}
+
+StringRef CheckIndex::get_file_name(uint32_t f) const {
+  return StringRef(m_data + u32(m_files + FILE_SIZE * f));
+}
+
+uint32_t CheckIndex::lookup(StringRef file) const {
+  uint32_t lo = 0, hi = m_num_files;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    int cmp = get_file_name(mid).compare(file);
+    if (cmp == 0) {
+      return mid;
+    } else if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return NONE;
+}
+
+CheckIndex::check_t CheckIndex::get_check(uint32_t c) const {
+  uint32_t offset = m_checks + CHECK_SIZE * c;
+  check_t res;
+  res.line = u32(offset);
+  res.column = u32(offset + 4);
+  res.safe = u32(offset + 8);
+  res.error = u32(offset + 12);
+  res.warning = u32(offset + 16);
+  return res;
+}
+
+std::vector<CheckIndex::check_t>
+CheckIndex::query(uint32_t f, uint32_t first_line, uint32_t last_line) const {
+  std::vector<check_t> res;
+  uint32_t first = u32(m_files + FILE_SIZE * f + 4);
+  uint32_t end = first + u32(m_files + FILE_SIZE * f + 8);
+  // -- first check with a line >= first_line
+  uint32_t lo = first, hi = end;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (get_check(mid).line < first_line) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  for (uint32_t c = lo; c < end; ++c) {
+    check_t chk = get_check(c);
+    if (chk.line > last_line) {
+      break;
+    }
+    res.push_back(chk);
+  }
+  return res;
+}
+
+/** Writer **/
+
+void CheckIndexWriter::add(StringRef file, unsigned line, unsigned column,
+                           status_t status) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  counters_t &c = m_checks[file.str()][{line, column}];
+  switch (status) {
+  case SAFE:
+    c.safe++;
+    break;
+  case ERROR:
+    c.error++;
+    break;
+  case WARNING:
+    c.warning++;
+    break;
+  }
+}
+
+void CheckIndexWriter::add(StringRef file, unsigned line, unsigned column,
+                           unsigned safe, unsigned error, unsigned warning) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  counters_t &c = m_checks[file.str()][{line, column}];
+  c.safe += safe;
+  c.error += error;
+  c.warning += warning;
+}
+
+void CheckIndexWriter::add(const CheckIndexWriter &other) {
+  std::lock(m_mutex, other.m_mutex);
+  std::lock_guard<std::mutex> lock(m_mutex, std::adopt_lock);
+  std::lock_guard<std::mutex> other_lock(other.m_mutex, std::adopt_lock);
+  for (auto &file : other.m_checks) {
+    auto &checks = m_checks[file.first];
+    for (auto &kv : file.second) {
+      counters_t &c = checks[kv.first];
+      c.safe += kv.second.safe;
+      c.error += kv.second.error;
+      c.warning += kv.second.warning;
+    }
+  }
+}
+
+static void writeU32(std::string &buf, uint32_t v) {
+  for (unsigned i = 0; i < 4; ++i) {
+    buf.push_back((char)((v >> (8 * i)) & 0xff));
+  }
+}
+
+bool CheckIndexWriter::write(const std::string &file) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uint32_t num_checks = 0;
+  for (auto &kv : m_checks) {
+    num_checks += kv.second.size();
+  }
+  // -- layout
+  uint32_t files = HEADER_SIZE;
+  uint32_t checks = files + FILE_SIZE * m_checks.size();
+  uint32_t names = checks + CHECK_SIZE * num_checks;
+
+  std::string buf;
+  buf.append(MAGIC, 8);
+  writeU32(buf, CheckIndex::VERSION);
+  writeU32(buf, m_checks.size());
+  writeU32(buf, files);
+  writeU32(buf, num_checks);
+  writeU32(buf, checks);
+  writeU32(buf, 0);
+  // -- files (std::map iterates them by name)
+  uint32_t name = names, first = 0;
+  for (auto &kv : m_checks) {
+    writeU32(buf, name);
+    writeU32(buf, first);
+    writeU32(buf, kv.second.size());
+    writeU32(buf, 0);
+    name += kv.first.size() + 1;
+    first += kv.second.size();
+  }
+  // -- checks (by line and column)
+  for (auto &kv : m_checks) {
+    for (auto &chk : kv.second) {
+      writeU32(buf, chk.first.first);
+      writeU32(buf, chk.first.second);
+      writeU32(buf, chk.second.safe);
+      writeU32(buf, chk.second.error);
+      writeU32(buf, chk.second.warning);
+      writeU32(buf, 0);
+    }
+  }
+  assert(buf.size() == names);
+  for (auto &kv : m_checks) {
+    buf += kv.first;
+    buf.push_back('\0');
+  }
+
+  // Write first into a temporary file and then rename it so that
+  // concurrent readers never see a partial index.
+  int fd;
+  SmallString<256> tmp_path;
+  if (std::error_code ec =
+          sys::fs::createUniqueFile(file + "-%%%%%%.tmp", fd, tmp_path)) {
+    CLAM_WARNING("cannot write check index " << file << ": " << ec.message());
+    return false;
+  }
+  {
+    raw_fd_ostream o(fd, /*shouldClose=*/true);
+    o << buf;
+  }
+  if (std::error_code ec = sys::fs::rename(tmp_path, file)) {
+    CLAM_WARNING("cannot write check index " << file << ": " << ec.message());
+    sys::fs::remove(tmp_path);
+    return false;
+  }
+  return true;
+}
+
+/** Merge **/
+
+bool mergeCheckIndexes(const std::vector<std::string> &inputs,
+                       const std::string &output, std::string &err) {
+  CheckIndexWriter res;
+  for (auto &input : inputs) {
+    std::unique_ptr<CheckIndex> idx = CheckIndex::open(input, err);
+    if (!idx) {
+      err = input + ": " + err;
+      return false;
+    }
+    for (uint32_t f = 0; f < idx->num_files(); ++f) {
+      StringRef file = idx->get_file_name(f);
+      for (auto &chk : idx->query(f, 0, CheckIndex::NONE)) {
+        res.add(file, chk.line, chk.column, chk.safe, chk.error, chk.warning);
+      }
+    }
+  }
+  if (!res.write(output)) {
+    err = "cannot write " + output;
+    return false;
+  }
+  return true;
+}
+
+} // end namespace clam
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace clam {
+
+/**
+ * Build a check index (see clam/CheckIndex.hh) in memory and write it
+ * at once. Checks can be added concurrently.
+ **/
+class CheckIndexWriter {
+public:
+  enum status_t { SAFE, ERROR, WARNING };
+
+  void add(llvm::StringRef file, unsigned line, unsigned column,
+           status_t status);
+
+  // Add the counters of a check (e.g., from another index)
+  void add(llvm::StringRef file, unsigned line, unsigned column,
+           unsigned safe, unsigned error, unsigned warning);
+
+  // Errors are reported as warnings
+  bool write(const std::string &file) const;
+
+private:
+  struct counters_t {
+    unsigned safe, error, warning;
+    counters_t() : safe(0), error(0), warning(0) {}
+  };
+
+  // checks by file and (line, column)
+  std::map<std::string, std::map<std::pair<unsigned, unsigned>, counters_t>>
+      m_checks;
+  mutable std::mutex m_mutex;
+};
+
+} // end namespace clam
@@ -1,5 +1,7 @@
 #include "llvm/Pass.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/IR/Module.h"
@@ -10,6 +12,7 @@
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/Transforms/Utils/UnifyFunctionExitNodes.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/CFG.h"
@@ -18,46 +21,59 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Config/llvm-config.h"
 
 #include "clam/config.h"
 #include "clam/AbstractDomain.hh"
 #include "clam/Clam.hh"
 #include "clam/CfgBuilder.hh"
+#include "clam/CfgBuilderDiagnostics.hh"
 #include "clam/Support/Debug.hh"
+#include "clam/Support/MemTracker.hh"
 #include "clam/Support/NameValues.hh"
+#include "clam/Support/Numa.hh"
+#include "clam/Support/Stats.hh"
 /** Wrappers for pointer analyses **/
 #include "clam/DummyHeapAbstraction.hh"
 #include "clam/LlvmDsaHeapAbstraction.hh"
 #include "clam/SeaDsaHeapAbstraction.hh"
+#include "clam/SnapshotHeapAbstraction.hh"
 #ifdef HAVE_DSA
 #include "dsa/Steensgaard.hh"
 #endif
 #include "sea_dsa/AllocWrapInfo.hh"
 #include "sea_dsa/ShadowMem.hh"
 
-#include "crab/common/debug.hpp"
-#include "crab/common/stats.hpp"
-#include "crab/analysis/fwd_analyzer.hpp"
-#include "crab/analysis/bwd_analyzer.hpp"
-#ifdef TOP_DOWN_INTER_ANALYSIS
-#include "crab/analysis/inter/top_down_inter_analyzer.hpp"
-#else
-#include "crab/analysis/inter/bottom_up_inter_analyzer.hpp"
-#endif 
-#include "crab/analysis/dataflow/liveness.hpp"
-#include "crab/analysis/dataflow/assumptions.hpp"
-#include "crab/checkers/assertion.hpp"
-//#include "crab/checkers/null.hpp"
-#include "crab/checkers/checker.hpp"
-#include "crab/cg/cg.hpp"
-#include "crab/cg/cg_bgl.hpp"
-#include "./crab/path_analyzer.hpp"
-
+#include "ClamImpl.hh"
+#include "CfgBuilderCallees.hh"
+#include "CfgBuilderUtils.hh"
+#include "FunctionAnalysisConfig.hh"
+#include "FunctionSummaries.hh"
+#include "AnalysisCost.hh"
+#include "InvariantDatabaseWriter.hh"
+#include "InvariantStore.hh"
+#include "CheckIndexWriter.hh"
+#include "ChangedLines.hh"
+#include "OutputSink.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <memory>
-#include <functional>
+#include <iostream>
 #include <map>
 #include <unordered_map>
 #include <unordered_set>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 using namespace llvm;
 using namespace clam;
@@ -68,698 +84,189 @@ using namespace crab::checker;
 
 #include "ClamOptions.def"
 
-// In C++11 we need to pass to std::bind "this" (if class member
-// functions are called) as well as all placeholders for each
-// argument. This is wrapper to avoid that and improve readability.
-template <class C, typename Ret, typename ... Ts>
-static std::function<Ret(Ts...)> bind_this(C* c, Ret(C::*m)(Ts...)) {
-  return [=](Ts&&... args) { return (c->*m)(std::forward<decltype(args)>(args)...); };
-}
-
 namespace clam {
-  
-  /** Begin typedefs **/
-  typedef crab::analyzer::liveness<cfg_ref_t> liveness_t;
-  typedef crab::cg::call_graph<cfg_ref_t> call_graph_t; 
-  typedef crab::cg::call_graph_ref<call_graph_t> call_graph_ref_t;
-  typedef std::unordered_map<cfg_ref_t, const liveness_t*> liveness_map_t;
-  typedef typename IntraClam::wrapper_dom_ptr wrapper_dom_ptr;    
-  typedef typename IntraClam::checks_db_t checks_db_t;
-  typedef typename IntraClam::abs_dom_map_t abs_dom_map_t;
-  typedef typename IntraClam::lin_csts_map_t lin_csts_map_t;
-
-  //typedef typename IntraClam::assumption_map_t assumption_map_t;
-
-  /** End typedefs **/
-
-  #if 0
-  /** Begin global counters **/
-  static unsigned num_invars; // some measure for the size of invariants
-  static unsigned num_nontrivial_blocks;
-  /** End global counters **/
-  #endif
-
-  static bool isRelationalDomain(CrabDomain dom) {
-    return (dom == ZONES_SPLIT_DBM || dom == OCT ||
-	    dom == PK || dom == TERMS_ZONES);
-  }
-
-  static bool isTrackable(const Function &fun) {
-    return !fun.isDeclaration() && !fun.empty() && !fun.isVarArg();
-  }
-
-  /** convenient wrapper for the analysis datastructures **/
-  struct AnalysisResults {
-    // invariants that hold at the entry of a block
-    abs_dom_map_t &premap;
-    // invariants that hold at the exit of a block
-    abs_dom_map_t &postmap;
-    // infeasible edges 
-    edges_set &infeasible_edges;
-    // database with all the checks
-    checks_db_t &checksdb;
-
-    AnalysisResults(abs_dom_map_t &pre, abs_dom_map_t &post,
-		    edges_set& false_edges,  checks_db_t &db)
-      : premap(pre)
-      , postmap(post)
-      , infeasible_edges(false_edges)
-      , checksdb(db) {}
-  };
-
-  /** return invariant for block in table but filtering out shadow_varnames **/
-  static wrapper_dom_ptr lookup(const abs_dom_map_t &table,
-				const llvm::BasicBlock &block,
-				const std::vector<varname_t> &shadow_varnames) {
-    auto it = table.find(&block);
-    if (it == table.end()) {
-      return nullptr;
-    }
-    
-    if (shadow_varnames.empty()) {
-      return it->second;
-    } else {
-      std::vector<var_t> shadow_vars;
-      shadow_vars.reserve(shadow_varnames.size());
-      for(unsigned i=0; i<shadow_vars.size(); ++i) {
-	// we need to create a typed variable
-	shadow_vars.push_back(var_t(shadow_varnames[i], crab::UNK_TYPE, 0));
-      }
-      auto invs = it->second->clone();
-      invs->forget(shadow_vars); 
-      return invs;
-    }
-  }   
-
-  /** update table with pre or post invariants **/
-  static bool update(abs_dom_map_t &table, 
-		     const llvm::BasicBlock &block, wrapper_dom_ptr absval) {
-    bool already = false;
-    auto it = table.find(&block);
-    if (it == table.end()) {
-      table.insert(std::make_pair(&block, absval));
-    } else {
-      it->second = absval;
-      already = true;
-    }
-    return already;
-  }
-      
-  /** Pretty-printer utilities **/
-  namespace pretty_printer_impl {
-
-    /** Generic class for a block annotation **/
-    class block_annotation {
-    public:
-      typedef typename cfg_ref_t::statement_t statement_t;
-      
-      block_annotation() {}
-      virtual ~block_annotation() {}
-
-      virtual std::string name() const = 0;
-      virtual void print_begin(basic_block_label_t bbl, crab::crab_os &o) const {}
-      virtual void print_end(basic_block_label_t bbl, crab::crab_os &o) const {}
-      virtual void print_begin(const statement_t &s, crab::crab_os &o) const {}
-      virtual void print_end(const statement_t &s, crab::crab_os &o) const {}
-			      
-    };
-
-    /** Annotation for invariants **/
-    class invariant_annotation: public block_annotation {
-    private:
-      const abs_dom_map_t &m_premap;
-      const abs_dom_map_t &m_postmap;
-      std::vector<varname_t> m_shadow_vars;
-      
-    public:
-      invariant_annotation(const llvm_variable_factory &vfac,
-			   const abs_dom_map_t &premap,
-			   const abs_dom_map_t &postmap,
-			   const bool keep_shadows)
-	: block_annotation(), m_premap(premap), m_postmap(postmap) {
-	if (keep_shadows) {
-	  m_shadow_vars.reserve(std::distance(vfac.get_shadow_vars().begin(),
-					      vfac.get_shadow_vars().end()));
-	  m_shadow_vars.insert(m_shadow_vars.begin(),
-			       vfac.get_shadow_vars().begin(),
-			       vfac.get_shadow_vars().end());
-	}
-      }
-      
-      std::string name() const { return "INVARIANTS";}
-      
-      void print_begin(basic_block_label_t bbl, crab::crab_os &o) const {
-	if (const llvm::BasicBlock *bb = bbl.get_basic_block()) {
-	  wrapper_dom_ptr pre = lookup(m_premap, *bb, m_shadow_vars);
-	  o << "  " << name() << ": ";
-	  if (pre){
-	    o << pre << "\n";
-	  } else {
-	    o << "null\n";
-	  }
-	}
-      }
-      
-      void print_end(basic_block_label_t bbl, crab::crab_os &o) const {
-	if (const llvm::BasicBlock *bb = bbl.get_basic_block()) {
-	  wrapper_dom_ptr post = lookup(m_postmap, *bb, m_shadow_vars);
-	  o << "  " << name() << ": ";
-	  if (post) {
-	    o << post << "\n";
-	  } else {
-	    o << "null\n";
-	  }
-	}
-      }
-    };
-
-    /** Annotation for unjustified assumptions done by the analysis **/
-    class unjust_assumption_annotation: public block_annotation {
-    private:
-      typedef typename assumption_analysis<cfg_ref_t>::assumption_ptr assumption_ptr;
-      
-    public:
-      typedef assumption_analysis<cfg_ref_t> unjust_assumption_analysis_t;
-      
-    private:
-      typedef typename cfg_ref_t::statement_t statement_t;
-      
-      cfg_ref_t m_cfg;
-      unjust_assumption_analysis_t *m_analyzer;
-      
-    public:
-      unjust_assumption_annotation(cfg_ref_t cfg, unjust_assumption_analysis_t *analyzer)
-	: block_annotation(), m_cfg(cfg), m_analyzer(analyzer) { }
-      
-      std::string name() const { return "UNJUSTIFIED ASSUMPTIONS";}
-      
-      void print_begin(const statement_t &s, crab::crab_os &o) const {
-	std::vector<assumption_ptr> assumes;
-	if (s.is_assert()) {
-	  typedef typename cfg_ref_t::basic_block_t::assert_t assert_t;
-	  m_analyzer->get_assumptions(static_cast<const assert_t *>(&s), assumes);
-	  if (!assumes.empty()) {
-	    o << "  /** assert verified as ";
-	    for (std::vector<assumption_ptr>::iterator it = assumes.begin(),
-		   et = assumes.end(); it!=et;) {
-	      o << (*it)->get_id_str();
-	      ++it;
-	      if (it != et)
-		o << ",";
-	      else
-		o << ";";
-	    }
-	    o << "**/\n";
-	  }
-	} else {
-	  m_analyzer->get_originated_assumptions(&s, assumes);
-	  for (auto assume_ptr: assumes) {
-	    o << "  /** "; assume_ptr->write(o); o << "**/\n";
-	  }
-	}
-      }
-      
-    };
-    
-    /** Print a block together with its annotations **/
-    class print_block {
-      cfg_ref_t m_cfg;
-      crab::crab_os &m_o;
-      const std::vector<std::unique_ptr<block_annotation>> &m_annotations;
-
-    public:
-      
-      print_block(cfg_ref_t cfg, crab::crab_os &o,
-		   const std::vector<std::unique_ptr<block_annotation>> &annotations)
-	: m_cfg(cfg), m_o(o), m_annotations(annotations) {} 
-
-      void operator()(basic_block_label_t bbl) const {
-	// do not print block if no annotations
-	if (m_annotations.empty()) return;
-	
-	m_o << bbl.get_name() << ":\n";
-
-	crab::crab_string_os o;
-	for (auto& p: m_annotations) {
-	  p->print_begin(bbl,o);
-	}
-	if (o.str() != "") {
-	  m_o << "/**\n" << o.str() << "**/\n";
-	}
-	
-	const basic_block_t &bb = m_cfg.get_node(bbl);
-	bool empty_block = (std::distance(bb.begin(), bb.end()) == 0);
-	for (auto const &s: bb) {
-	  for (auto& p: m_annotations) {
-	    p->print_begin(s, m_o);
-	  }	  
-	  m_o << "  " << s << ";\n";
-	  for (auto& p: m_annotations) {
-	    p->print_end(s, m_o);
-	  }	  
-	}
-	if (!empty_block) {
-	  crab::crab_string_os o;
-	  for (auto& p: m_annotations) {
-	    p->print_end(bbl, o);
-	  }
-	  if (o.str() != "") {
-	    m_o << "/**\n" << o.str() << "**/\n";
-	  }
-	}
 
-	std::pair<cfg_ref_t::const_succ_iterator, 
-		  cfg_ref_t::const_succ_iterator> p = bb.next_blocks();
-	cfg_ref_t::const_succ_iterator it = p.first;
-	cfg_ref_t::const_succ_iterator et = p.second;
-	if (it != et) {
-	  m_o << "  " << "goto ";
-	  for (; it != et; ) {
-	    m_o << crab::cfg_impl::get_label_str(*it);
-	    ++it;
-	    if (it == et) {
-	      m_o << ";";
-	    } else {
-	      m_o << ",";
-	    }
-	  }
-	}
-	m_o << "\n";
-      }
-    };
+  std::mutex output_mutex;
 
-    typedef std::unordered_set<basic_block_label_t> visited_t;
-    template<typename T>
-    void dfs_rec(cfg_ref_t cfg, basic_block_label_t curId, visited_t &visited, T f) {
-      if (visited.find(curId) != visited.end()) return;
-      visited.insert(curId);
-      const basic_block_t &cur = cfg.get_node(curId);
-      f(curId);
-      for (auto const n : llvm::make_range(cur.next_blocks())) {
-    	dfs_rec(cfg, n, visited, f);
+  bool parseDomainName(StringRef name, CrabDomain &dom) {
+    auto &parser = ClamDomain.getParser();
+    for (unsigned i = 0, e = parser.getNumOptions(); i < e; ++i) {
+      if (name == parser.getOption(i)) {
+	return !parser.parse(ClamDomain, ClamDomain.ArgStr, name, dom);
       }
     }
-    
-    template<typename T>
-    void dfs(cfg_ref_t cfg, T f) {
-      visited_t visited;
-      dfs_rec(cfg, cfg.entry(), visited, f);
-    }
+    return false;
+  }
 
-    void print_annotations(cfg_ref_t cfg,
-			   const std::vector<std::unique_ptr<block_annotation>> &annotations) {
-      print_block f(cfg, crab::outs(), annotations);
-      dfs(cfg, f);
-    }
-  } //end namespace
+#ifdef HAVE_ARRAY_ADAPT
+  thread_local unsigned ArrayAdaptParams::max_smashable_cells = 64;
+  thread_local unsigned ArrayAdaptParams::max_array_size = 512;
+#endif
 
-  static std::string dom_to_str(CrabDomain dom) {
-    switch (dom) {
-    case INTERVALS:             return interval_domain_t::getDomainName();
-    case INTERVALS_CONGRUENCES: return ric_domain_t::getDomainName();
-    case BOXES:                 return boxes_domain_t::getDomainName();
-    case DIS_INTERVALS:         return dis_interval_domain_t::getDomainName();
-    case ZONES_SPLIT_DBM:       return split_dbm_domain_t::getDomainName();
-    case TERMS_DIS_INTERVALS:   return term_dis_int_domain_t::getDomainName();
-    case TERMS_ZONES:           return num_domain_t::getDomainName();
-    case OCT:                   return oct_domain_t::getDomainName();
-    case PK:                    return pk_domain_t::getDomainName();
-    case WRAPPED_INTERVALS:     return wrapped_interval_domain_t::getDomainName();
-    default:                    return "none";
-    }
-  }
-  
-  std::string AnalysisParams::abs_dom_to_str() const {
-    return dom_to_str(dom);
+  static void resolveDomain(unsigned key) {
+    initDomain((CrabDomain) key);
   }
 
 #ifndef TOP_DOWN_INTER_ANALYSIS
-  std::string AnalysisParams::sum_abs_dom_to_str() const {
-    return dom_to_str(sum_dom);
+  // the key of the inter-procedural table is a pair of domains
+  static void resolveInterDomains(unsigned key) {
+    initDomain((CrabDomain) (key / NUM_CRAB_DOMAINS));
+    initDomain((CrabDomain) (key % NUM_CRAB_DOMAINS));
+  }
+#endif
+  
+  IntraClam_Impl::intra_analyses_t& IntraClam_Impl::intra_analyses() {
+    static intra_analyses_t table(resolveDomain);
+    return table;
   }
-#endif 
-    
-  /**
-   * Internal implementation of the intra-procedural analysis
-   **/
-  class IntraClam_Impl {
-  public:
-    IntraClam_Impl(const Function &fun, CrabBuilderManager &man)
-      : m_cfg_builder(nullptr), m_fun(fun), m_vfac(man.get_var_factory()) {
-      
-      if (isTrackable(m_fun)) {
-	if (!man.has_cfg(m_fun)) {
-	  CRAB_VERBOSE_IF(1, crab::get_msg_stream()
-			  << "Started Crab CFG construction for "
-			  << fun.getName() << "\n");	  
-	  m_cfg_builder = man.mk_cfg_builder(m_fun);
-	  CRAB_VERBOSE_IF(1, crab::get_msg_stream()
-			  << "Finished Crab CFG construction for "
-			  << fun.getName() << "\n");	
-	} else {
-	  m_cfg_builder = man.get_cfg_builder(m_fun);
-	}
-      } else {
-	CRAB_VERBOSE_IF(1, llvm::outs() << "Cannot build CFG for "
-			                << fun.getName() << "\n");
-      }
-    }
-
-    void Analyze(AnalysisParams &params,
-		 const llvm::BasicBlock *entry,
-		 // assumptions can be provided in abs_dom format or
-		 // as linear constraints.
-		 const abs_dom_map_t  &abs_dom_assumptions,
-		 const lin_csts_map_t &lin_csts_assumptions,
-		 AnalysisResults &results) {
 
-      if (!m_cfg_builder) {
-	CRAB_VERBOSE_IF(1, llvm::outs() << "Skipped analysis for "
-			                << m_fun.getName() << "\n");
-	return;
-      }
+  IntraClam_Impl::path_analyses_t& IntraClam_Impl::path_analyses() {
+    static path_analyses_t table(resolveDomain);
+    return table;
+  }
+  
+  InterClam_Impl::inter_analyses_t& InterClam_Impl::inter_analyses() {
+#ifdef TOP_DOWN_INTER_ANALYSIS
+    static inter_analyses_t table(resolveDomain);
+#else
+    static inter_analyses_t table(resolveInterDomains);
+#endif
+    return table;
+  }
 
-      const liveness_t* live = nullptr;
-      if (params.run_liveness || isRelationalDomain(params.dom)) {
-	// -- run liveness
-	m_cfg_builder->compute_live_symbols();
-	if (isRelationalDomain(params.dom)) {
-	  live = m_cfg_builder->get_live_symbols();
-	  assert(live);	  
-	  unsigned total_live, avg_live_per_blk, max_live_per_blk;
-	  live->get_stats(total_live, max_live_per_blk, avg_live_per_blk);
-	  CRAB_VERBOSE_IF(1, 
-		    crab::outs() << "Max live per block: "
-		                 << max_live_per_blk << "\n"
-		                 << "Threshold: "
-		                 << params.relational_threshold << "\n");
-#ifdef HAVE_ALL_DOMAINS	  
-	  if (max_live_per_blk > params.relational_threshold) {
-	    // default domain
-	    params.dom = INTERVALS;
-	  }
-#endif 	  
-	}
-      }
+#ifdef HAVE_DOMAIN_PLUGINS
+  static bool loadDomainPlugin(const std::string &path) {
+    std::string err;
+    if (sys::DynamicLibrary::LoadLibraryPermanently(path.c_str(), &err)) {
+      CLAM_WARNING("cannot load domain plugin " << path << ": " << err);
+      return false;
+    }
+    CRAB_VERBOSE_IF(1, crab::outs() << "Loaded domain plugin " << path << "\n");
+    return true;
+  }
 
-      if (CrabBuildOnlyCFG) {
-	return;
-      }
-      
-      if (intra_analyses.count(params.dom)) {
-      	intra_analyses.at(params.dom).analyze(params, entry,
-					      abs_dom_assumptions, lin_csts_assumptions,
-					      (params.run_liveness)? live : nullptr,
-					      results);
-      } else {
-      	crab::outs() << "Warning: abstract domain not found or enabled.\n"
-		     << "Compile with -DALL_DOMAINS=ON.\n";
-	// crab::outs() << "Running " << intra_analyses.at(INTERVALS).name << " ...\n"; 
-      	// intra_analyses.at(INTERVALS).analyze(params, entry, assumptions,
-	// 				   (params.run_liveness)? live : nullptr,
-	// 				    results);
-      }
+  // <prefix>/lib/clam-domains
+  static SmallString<256> installedDomainPluginsDir() {
+    static int anchor;
+    std::string exe = sys::fs::getMainExecutable(nullptr, &anchor);
+    SmallString<256> dir;
+    if (!exe.empty()) {
+      dir = sys::path::parent_path(sys::path::parent_path(exe));
+      sys::path::append(dir, "lib", "clam-domains");
     }
-    
-    bool pathAnalyze(const AnalysisParams& params,
-		     const std::vector<const llvm::BasicBlock*>& blocks,
-		     bool layered_solving, 
-		     std::vector<crab::cfg::statement_wrapper>& core,
-		     bool populate_inv_map, abs_dom_map_t& post) const { 
-		     
-      assert(m_cfg_builder);
-
-      // build the full path (included internal basic blocks added
-      // during the translation to Crab)
-      std::vector<basic_block_label_t> path;
-      path.reserve(blocks.size());
-      for(unsigned i=0; i < blocks.size(); ++i) {
-	path.push_back(m_cfg_builder->get_crab_basic_block(blocks[i]));
-	if (i < blocks.size() - 1) {
-	  if (const basic_block_label_t* edge_bb =
-	      m_cfg_builder->get_crab_basic_block(blocks[i], blocks[i+1])) {
-	    path.push_back(*edge_bb);
-	  }
+    return dir;
+  }
+  
+  // Load the plugin of the domain in domains/<name>.cc. If it is not
+  // installed then load all the installed plugins since the domain
+  // can be provided by any of them.
+  static void loadInstalledDomainPlugin(const char *name) {
+    SmallString<256> dir = installedDomainPluginsDir();
+    if (dir.empty()) {
+      return;
+    }
+    if (name) {
+      for (const char *ext: {".so", ".dylib"}) {
+	SmallString<256> path(dir);
+	sys::path::append(path, std::string("libClamDomain") + name + ext);
+	if (sys::fs::exists(path)) {
+	  loadDomainPlugin(path.str());
+	  return;
 	}
       }
-
-      bool res;
-      if (path_analyses.count(params.dom)) {
-      	path_analyses.at(params.dom).analyze(path, core, layered_solving , populate_inv_map,
-					     post, res);
-      } else {
-      	crab::outs() << "Warning: abstract domain not found or enabled.\n"
-		     << "Compile with -DALL_DOMAINS=ON.\n";
-	// crab::outs() << "Running " << path_analyses.at(INTERVALS).name << " ...\n";
-      	// path_analyses.at(INTERVALS).analyze(path, core, layered_solving, populate_inv_map,
-	// 				    post, res);
-      }
-      return res;
     }
-    
-  private:
-    
-    CrabBuilderManager::CfgBuilderPtr m_cfg_builder;
-    const Function &m_fun;
-    llvm_variable_factory &m_vfac;
-
-    // helper to get a reference to a crab cfg from the builder
-    cfg_t& get_cfg() { return m_cfg_builder->get_cfg(); }
-    
-    template<typename Dom>
-    void analyzeCfg(const AnalysisParams &params,
-		    const BasicBlock *entry,
-		    const abs_dom_map_t &abs_dom_assumptions,
-		    const lin_csts_map_t &lin_csts_assumptions,
-		    const liveness_t *live,
-		    AnalysisResults &results) {
-      
-      // -- we use the combined forward/backward analyzer
-      typedef intra_forward_backward_analyzer<cfg_ref_t,Dom> intra_analyzer_t;
-      // -- checkers for assertions and nullity
-      typedef intra_checker<intra_analyzer_t> intra_checker_t;
-      typedef assert_property_checker<intra_analyzer_t> assert_prop_t;
-      //typedef null_property_checker<intra_analyzer_t> null_prop_t;
-      
-      CRAB_VERBOSE_IF(1,
-		      auto fdecl = get_cfg().get_func_decl();            
-		      crab::get_msg_stream() << "Running intra-procedural analysis with " 
-		                    << "\"" << Dom::getDomainName()  << "\""
-		                    << " for "  << fdecl.get_func_name()
-		                    << "  ... \n";);
-      
-      // -- run intra-procedural analysis
-      intra_analyzer_t analyzer(get_cfg());
-      typename intra_analyzer_t::assumption_map_t crab_assumptions;
-
-      // Reconstruct a crab assumption map from an abs_dom_map_t
-      for (auto &kv: abs_dom_assumptions) {
-	Dom absval;
-	getAbsDomWrappee(kv.second, absval);
-	crab_assumptions.insert({m_cfg_builder->get_crab_basic_block(kv.first), absval});
-      }
-      
-      // Reconstruct a crab assumption map from a lin_csts_map_t
-      for (auto &kv: lin_csts_assumptions) {
-	Dom absval;
-	absval += kv.second;
-	crab_assumptions.insert({m_cfg_builder->get_crab_basic_block(kv.first), absval});
-      }
-      
-      // We use as initial state an assumption if exists
-      Dom entry_dom = Dom::top();
-      auto it = crab_assumptions.find(m_cfg_builder->get_crab_basic_block(entry));
-      if (it != crab_assumptions.end()) {
-	entry_dom = it->second;
-      }
-      
-      analyzer.run(m_cfg_builder->get_crab_basic_block(entry), entry_dom, 
-		   !params.run_backward, crab_assumptions, live,
-		   params.widening_delay, params.narrowing_iters, params.widening_jumpset);
-      CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Finished intra-procedural analysis.\n"); 
-
-      // -- store invariants
-      if (params.store_invariants || params.print_invars) {
-	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Storing invariants.\n");       
-	for (basic_block_label_t bl: llvm::make_range(get_cfg().label_begin(),
-						      get_cfg().label_end())) {
-	  if (bl.is_edge()) {
-	    // Note that we use get_post instead of get_pre:
-	    //   the crab block (bl) has an assume statement corresponding
-	    //   to the branch condition in the predecessor of the
-	    //   LLVM edge. We want the invariant *after* the
-	    //   evaluation of the assume.		
-	    if (analyzer.get_post(bl).is_bottom()) {
-	      results.infeasible_edges.insert({bl.get_edge().first, bl.get_edge().second});
-	    }
-	  } else if (const BasicBlock *B = bl.get_basic_block()) {
-	    // --- invariants that hold at the entry of the blocks
-	    auto pre = analyzer.get_pre(bl);
-	    update(results.premap, *B,  mkGenericAbsDomWrapper(pre));
-	    // --- invariants that hold at the exit of the blocks
-	    auto post = analyzer.get_post(bl);
-	    update(results.postmap, *B,  mkGenericAbsDomWrapper(post));
-	    #if 0
-	    if (params.stats) {
-	      unsigned num_block_invars = 0;
-	      // XXX: for boxes it would be more useful to get a measure
-	      // from to_disjunctive_linear_constraint_system() but it
-	      // can be really slow. 
-	      num_block_invars += pre.to_linear_constraint_system().size();
-	      num_invars += num_block_invars;
-	      if (num_block_invars > 0) num_nontrivial_blocks++;
-	    }
-	    #endif 
-	  } else {
-	    // this should be unreachable
-	    assert(false && "A Crab block should correspond to either an LLVM edge or block");
+    static std::once_flag flag;
+    std::call_once(flag, [&dir]() {
+	std::error_code ec;
+	for (sys::fs::directory_iterator it(dir, ec), et; it != et && !ec;
+	     it.increment(ec)) {
+	  StringRef ext = sys::path::extension(it->path());
+	  if (ext == ".so" || ext == ".dylib") {
+	    loadDomainPlugin(it->path());
 	  }
 	}
-	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "All invariants stored.\n");
-      }
-      
-      // -- print all cfg annotations (if any)
-      if (params.print_invars ||
-	  params.print_unjustified_assumptions) {
-
-	typedef pretty_printer_impl::block_annotation block_annotation_t;
-	typedef pretty_printer_impl::invariant_annotation inv_annotation_t;
-	typedef pretty_printer_impl::unjust_assumption_annotation unjust_assume_annotation_t;
-	std::vector<std::unique_ptr<block_annotation_t>> pool_annotations;
-
-	if (get_cfg().has_func_decl()) {
-	  auto fdecl = get_cfg().get_func_decl();
-	  crab::outs() << "\n" << fdecl << "\n";
-	} else {
-	  llvm::outs() << "\n" << "function " << m_fun.getName() << "\n";
-	}
-	if (params.print_invars) {
-	  pool_annotations.emplace_back(
-	       make_unique<inv_annotation_t>(m_vfac, results.premap, results.postmap, 
-					     params.keep_shadow_vars));
-	}
-
-	// XXX: it must be alive when print_annotations is called.
-	#if 0
-	assumption_naive_analysis<cfg_ref_t> unjust_assumption_analyzer(get_cfg());
-	#else
-	assumption_dataflow_analysis<cfg_ref_t> unjust_assumption_analyzer(get_cfg());
-	#endif 
-	
-	if (params.print_unjustified_assumptions) {
-	  // -- run first the analysis
-	  unjust_assumption_analyzer.exec();
-	  pool_annotations.emplace_back(
-	    make_unique<unjust_assume_annotation_t>(get_cfg(), &unjust_assumption_analyzer));
+      });
+  }
+#endif   
+
+  // Load the plugins given by --crab-dom-plugin. They can register
+  // any domain so they are loaded before the first domain is
+  // registered.
+  void initDomains() {
+    static std::once_flag flag;
+    std::call_once(flag, []() {
+#ifdef HAVE_DOMAIN_PLUGINS
+	for (auto &path: CrabDomPlugins) {
+	  loadDomainPlugin(path);
 	}
+#endif 	
+      });
+  }
 
-	pretty_printer_impl::print_annotations(get_cfg(), pool_annotations);
-      }
-          
-      if (params.check) {
-	// --- checking assertions and collecting data
-	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Checking assertions ... \n"); 
-	typename intra_checker_t::prop_checker_ptr
-	  prop(new assert_prop_t(params.check_verbose));
-	// if (params.check == NULLITY)
-	//   prop.reset(new null_prop_t(params.check_verbose));
-	intra_checker_t checker(analyzer, {prop});
-	checker.run();
-	CRAB_VERBOSE_IF(1,
-			llvm::outs() << "Function " << m_fun.getName() << "\n";
-			checker.show(crab::outs()));
-	results.checksdb += checker.get_all_checks();
-	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Finished assert checking.\n");      
-      }
-
-      
+  struct DomainRegistration {
+    // null if the domain is a plugin
+    void (*reg)();
+    // translation unit in domains/ (null if no domain is linked)
+    const char *name;
+  };
+  
+#ifdef HAVE_DOMAIN_PLUGINS
+#define DOMAIN_REGISTRATION(NAME) {nullptr, #NAME}
+#else
+#define DOMAIN_REGISTRATION(NAME) {register##NAME##Domain, #NAME}
+#endif
+  
+  static DomainRegistration domainRegistration(CrabDomain dom) {
+    switch (dom) {
+    case ZONES_SPLIT_DBM:       return {registerZonesDomain, "Zones"};
+#ifdef HAVE_ALL_DOMAINS
+    case INTERVALS:             return DOMAIN_REGISTRATION(Intervals);
+    case DENSE_INTERVALS:       return DOMAIN_REGISTRATION(DenseIntervals);
+    case INTERVALS_CONGRUENCES: return DOMAIN_REGISTRATION(IntervalsCongruences);
+    case BOXES:                 return DOMAIN_REGISTRATION(Boxes);
+    case DIS_INTERVALS:         return DOMAIN_REGISTRATION(DisIntervals);
+    case TERMS_INTERVALS:       return DOMAIN_REGISTRATION(TermsIntervals);
+    case TERMS_DIS_INTERVALS:   return DOMAIN_REGISTRATION(TermsDisIntervals);
+    case TERMS_ZONES:           return DOMAIN_REGISTRATION(TermsZones);
+    case OCT:
+    case PACKED_OCT:            return DOMAIN_REGISTRATION(Oct);
+    case PK:                    return DOMAIN_REGISTRATION(Pk);
+    case WRAPPED_INTERVALS:     return DOMAIN_REGISTRATION(WrappedIntervals);
+#endif
+    default:                    return {nullptr, nullptr};
+    }
+  }
+#undef DOMAIN_REGISTRATION
+  
+  void initDomain(CrabDomain dom) {
+    static std::once_flag flags[NUM_CRAB_DOMAINS];
+    if ((unsigned) dom >= NUM_CRAB_DOMAINS) {
       return;
     }
-
-    template<typename AbsDom>
-    void wrapperPathAnalyze(const std::vector<basic_block_label_t>& path,
-			    std::vector<crab::cfg::statement_wrapper>& core,
-			    bool layered_solving, bool populate_inv_map,
-			    abs_dom_map_t& post, bool &res) {
-      using path_analyzer_t = path_analyzer<cfg_ref_t, AbsDom>;
-      
-      AbsDom init;
-      path_analyzer_t path_analyzer(get_cfg(), init);
-      res = path_analyzer.solve(path, layered_solving);
-      if (populate_inv_map) {
-	for(auto n: path) {
-	  if (const llvm::BasicBlock* bb = n.get_basic_block()) {
-	    AbsDom abs_val = path_analyzer.get_fwd_constraints(n);
-	    post.insert({bb, mkGenericAbsDomWrapper(abs_val)});
-	    if (abs_val.is_bottom()) {
-	      // the rest of blocks must be also bottom so we don't
-	      // bother storing them.
-	      break;
-	    }
-	  }
+    std::call_once(flags[dom], [dom]() {
+	initDomains();
+	DomainRegistration r = domainRegistration(dom);
+	if (r.reg) {
+	  CRAB_VERBOSE_IF(1, crab::outs() << "Registered domain " << r.name << "\n");
+	  r.reg();
+	  return;
 	}
-      }
-
-      if (!res) {
-	path_analyzer.get_unsat_core(core);
-      }
-    }
-
-    struct intra_analysis {
-      std::function<void(const AnalysisParams&,
-			 const BasicBlock*,
-			 const abs_dom_map_t&,
-			 const lin_csts_map_t&,			 
-			 const liveness_t*,
-			 AnalysisResults&)> analyze;
-      std::string name;
-    };
+#ifdef HAVE_DOMAIN_PLUGINS
+	loadInstalledDomainPlugin(r.name);
+#endif
+      });
+  }
+  
+  std::string AnalysisParams::abs_dom_to_str() const {
+    return dom_to_str(dom);
+  }
 
-    struct path_analysis {
-      std::function<void(const std::vector<basic_block_label_t>&,
-			 std::vector<crab::cfg::statement_wrapper>&,
-			 bool, bool, abs_dom_map_t&,bool&)> analyze;
-      std::string name;
-    };
+#ifndef TOP_DOWN_INTER_ANALYSIS
+  std::string AnalysisParams::sum_abs_dom_to_str() const {
+    return dom_to_str(sum_dom);
+  }
+#endif 
     
-    // Domains used for intra-procedural analysis
-    const std::map<CrabDomain, intra_analysis> intra_analyses {
-      {
-	ZONES_SPLIT_DBM         , { bind_this(this, &IntraClam_Impl::analyzeCfg<split_dbm_domain_t>), "zones" }}	
-      #ifdef HAVE_ALL_DOMAINS	
-      , { INTERVALS_CONGRUENCES , { bind_this(this, &IntraClam_Impl::analyzeCfg<ric_domain_t>), "reduced product of intervals and congruences" }}
-      , { DIS_INTERVALS         , { bind_this(this, &IntraClam_Impl::analyzeCfg<dis_interval_domain_t>), "disjunctive intervals" }}
-      , { TERMS_INTERVALS       , { bind_this(this, &IntraClam_Impl::analyzeCfg<term_int_domain_t>), "terms with intervals" }}
-      , { WRAPPED_INTERVALS     , { bind_this(this, &IntraClam_Impl::analyzeCfg<wrapped_interval_domain_t>), "wrapped intervals" }}
-      , { TERMS_ZONES           , { bind_this(this, &IntraClam_Impl::analyzeCfg<num_domain_t>), "terms with zones" }}
-      , { TERMS_DIS_INTERVALS   , { bind_this(this, &IntraClam_Impl::analyzeCfg<term_dis_int_domain_t>), "terms with disjunctive intervals" }}
-      , { OCT                   , { bind_this(this, &IntraClam_Impl::analyzeCfg<oct_domain_t>), "octagons" }}
-      , { BOXES                 , { bind_this(this, &IntraClam_Impl::analyzeCfg<boxes_domain_t>), "boxes" }}
-      , { PK                    , { bind_this(this, &IntraClam_Impl::analyzeCfg<pk_domain_t>), "polyhedra" }}
-      , { INTERVALS             , { bind_this(this, &IntraClam_Impl::analyzeCfg<interval_domain_t>), "classical intervals" }} 	
-      #endif 	
-      
-    };
-
-
-    // Domains used for path-based analysis
-    const std::map<CrabDomain, path_analysis> path_analyses {
-      {
-	ZONES_SPLIT_DBM       , { bind_this(this, &IntraClam_Impl::wrapperPathAnalyze<split_dbm_domain_t>), "zones" }}
-      #ifdef HAVE_ALL_DOMAINS
-      , { INTERVALS             , { bind_this(this, &IntraClam_Impl::wrapperPathAnalyze<interval_domain_t>), "classical intervals" }} 	
-      , { TERMS_INTERVALS       , { bind_this(this, &IntraClam_Impl::wrapperPathAnalyze<term_int_domain_t>), "terms with intervals" }}
-      , { WRAPPED_INTERVALS     , { bind_this(this, &IntraClam_Impl::wrapperPathAnalyze<wrapped_interval_domain_t>), "wrapped intervals" }}
-      , { TERMS_ZONES           , { bind_this(this, &IntraClam_Impl::wrapperPathAnalyze<num_domain_t>), "terms with zones" }}
-      , { BOXES                 , { bind_this(this, &IntraClam_Impl::wrapperPathAnalyze<boxes_domain_t>), "boxes" }}            
-      #endif 	
-      /* 
-	 To add new domains here make sure you add an explicit
-	 instantiation in crab/path_analyzer.cc 
-      */
-      //, { TERMS_DIS_INTERVALS , { bind_this(this, &IntraClam_Impl::wrapperPathAnalyze<term_dis_int_domain_t>), "terms with disjunctive intervals" }}
-    };      
-  }; // end class
 
   /**
    *   Begin IntraClam methods
@@ -767,6 +274,8 @@ namespace clam {
   IntraClam::IntraClam(const Function &fun, CrabBuilderManager &man)
     : m_impl(nullptr), m_fun(fun), m_builder_man(man) {
     m_impl = make_unique<IntraClam_Impl>(m_fun, m_builder_man); 
+    m_shadow_free_invs = make_unique<ShadowFreeInvariantCache>();
+    m_inst_invs = make_unique<InstructionInvariantCache>();
   }
 
   IntraClam::~IntraClam() {}
@@ -774,6 +283,9 @@ namespace clam {
   void IntraClam::clear() {
     m_pre_map.clear();
     m_post_map.clear();
+    m_lazy_invs.clear();
+    m_shadow_free_invs->clear();
+    m_inst_invs->clear();
     m_checks_db.clear();
   }
 
@@ -783,7 +295,9 @@ namespace clam {
   
   void IntraClam::analyze(AnalysisParams &params,
 			  const abs_dom_map_t &assumptions) {    
-    AnalysisResults results = { m_pre_map, m_post_map, m_infeasible_edges, m_checks_db};
+    AnalysisResults results = { m_pre_map, m_post_map, m_infeasible_edges, m_checks_db,
+				&m_lazy_invs};
+    m_inst_invs->clear();
     lin_csts_map_t lin_csts_assumptions;
     m_impl->Analyze(params, &(m_fun.getEntryBlock()),
 		    assumptions, lin_csts_assumptions, results);
@@ -792,7 +306,9 @@ namespace clam {
   void IntraClam::analyze(AnalysisParams &params,
 			  const llvm::BasicBlock *entry,
 			  const abs_dom_map_t &assumptions) {
-    AnalysisResults results = { m_pre_map, m_post_map, m_infeasible_edges, m_checks_db};
+    AnalysisResults results = { m_pre_map, m_post_map, m_infeasible_edges, m_checks_db,
+				&m_lazy_invs};
+    m_inst_invs->clear();
     lin_csts_map_t lin_csts_assumptions;    
     m_impl->Analyze(params, entry,
 		    assumptions, lin_csts_assumptions, results);
@@ -800,7 +316,9 @@ namespace clam {
 
   void IntraClam::analyze(AnalysisParams &params,
 			  const lin_csts_map_t &assumptions) {    
-    AnalysisResults results = { m_pre_map, m_post_map, m_infeasible_edges, m_checks_db};
+    AnalysisResults results = { m_pre_map, m_post_map, m_infeasible_edges, m_checks_db,
+				&m_lazy_invs};
+    m_inst_invs->clear();
     abs_dom_map_t abs_dom_assumptions;
     m_impl->Analyze(params, &(m_fun.getEntryBlock()),
 		    abs_dom_assumptions, assumptions, results);
@@ -809,7 +327,9 @@ namespace clam {
   void IntraClam::analyze(AnalysisParams &params,
 			  const llvm::BasicBlock *entry,
 			  const lin_csts_map_t  &assumptions) {
-    AnalysisResults results = { m_pre_map, m_post_map, m_infeasible_edges, m_checks_db};
+    AnalysisResults results = { m_pre_map, m_post_map, m_infeasible_edges, m_checks_db,
+				&m_lazy_invs};
+    m_inst_invs->clear();
     abs_dom_map_t abs_dom_assumptions;    
     m_impl->Analyze(params, entry, abs_dom_assumptions, assumptions, results);
   }
@@ -833,6 +353,13 @@ namespace clam {
     return m_impl->pathAnalyze(params, path, layered_solving, core, true, post_conditions);
   }
 
+  std::future<IntraClam::path_result_t>
+  IntraClam::path_analyze_async(const AnalysisParams& params,
+				const std::vector<const llvm::BasicBlock*>& path,
+				bool layered_solving) const {
+    return m_impl->pathAnalyzeAsync(params, path, layered_solving);
+  }
+
   wrapper_dom_ptr IntraClam::get_pre(const llvm::BasicBlock *block,
 				     bool keep_shadows) const {
     std::vector<varname_t> shadows;
@@ -840,7 +367,7 @@ namespace clam {
     if (!keep_shadows)
       shadows = std::vector<varname_t>(vfac.get_shadow_vars().begin(),
 				       vfac.get_shadow_vars().end());
-    return lookup(m_pre_map, *block, shadows);
+    return m_shadow_free_invs->lookup(m_pre_map, m_lazy_invs, true, *block, shadows);
   }   
 
   wrapper_dom_ptr IntraClam::get_post(const llvm::BasicBlock *block,
@@ -850,12 +377,51 @@ namespace clam {
     if (!keep_shadows)
       shadows = std::vector<varname_t>(vfac.get_shadow_vars().begin(),
 				       vfac.get_shadow_vars().end());
-    return lookup(m_post_map, *block, shadows);
+    return m_shadow_free_invs->lookup(m_post_map, m_lazy_invs, false, *block, shadows);
+  }
+
+  wrapper_dom_ptr IntraClam::get_at(const llvm::Instruction *I,
+				    bool keep_shadows) const {
+    // -- the block is replayed with the shadow variables
+    wrapper_dom_ptr pre = lookup(m_pre_map, m_lazy_invs, true, *I->getParent(),
+				 std::vector<varname_t>());
+    if (!pre) {
+      return nullptr;
+    }
+    auto cfg_builder = m_builder_man.get_cfg_builder(m_fun);
+    wrapper_dom_ptr inv = m_inst_invs->lookup(*I, pre, *cfg_builder);
+    if (keep_shadows) {
+      return inv;
+    }
+    auto &vfac = m_builder_man.get_var_factory();
+    std::vector<varname_t> shadows(vfac.get_shadow_vars().begin(),
+				   vfac.get_shadow_vars().end());
+    return forget_shadows(inv, mk_shadow_vars(shadows));
+  }
+
+  void IntraClam::get_pre_all(const block_inv_callback_t &f,
+			      bool keep_shadows) const {
+    std::vector<varname_t> shadows;
+    auto &vfac = m_builder_man.get_var_factory();
+    if (!keep_shadows)
+      shadows = std::vector<varname_t>(vfac.get_shadow_vars().begin(),
+				       vfac.get_shadow_vars().end());
+    lookup_all(m_pre_map, m_lazy_invs, true, m_fun, shadows, f);
+  }
+
+  void IntraClam::get_post_all(const block_inv_callback_t &f,
+			       bool keep_shadows) const {
+    std::vector<varname_t> shadows;
+    auto &vfac = m_builder_man.get_var_factory();
+    if (!keep_shadows)
+      shadows = std::vector<varname_t>(vfac.get_shadow_vars().begin(),
+				       vfac.get_shadow_vars().end());
+    lookup_all(m_post_map, m_lazy_invs, false, m_fun, shadows, f);
   }
 
   bool IntraClam::has_feasible_edge(const llvm::BasicBlock *b1,
 				    const llvm::BasicBlock* b2) const {
-    return !(m_infeasible_edges.count({b1, b2}) > 0);    
+    return !(m_infeasible_edges.contains(b1, b2));    
   }
   
   const checks_db_t& IntraClam::get_checks_db() const { return m_checks_db;}
@@ -864,373 +430,14 @@ namespace clam {
    *   End IntraClam methods
    **/
 
-  /**
-   *   Internal implementation of the inter-procedural analysis
-   **/
-  class InterClam_Impl {
-  public:
-    InterClam_Impl(const Module& M, CrabBuilderManager &man)
-      : m_cg(nullptr), m_crab_builder_man(man), m_M(M)  {
-
-      std::vector<cfg_ref_t> cfg_ref_vector;
-      for (auto const &F : m_M) {
-        if (isTrackable(F)) {
-	  // -- build cfg's
-	  if (!man.has_cfg(F)) {
-	    m_crab_builder_man.mk_cfg_builder(F);
-	  }
-	  cfg_t* cfg = &(m_crab_builder_man.get_cfg(F));
-	  cfg_ref_vector.push_back(*cfg);
-	  CRAB_VERBOSE_IF(1, llvm::outs() << "Built Crab CFG for "
-			                  << F.getName() << "\n");
-	} else {
-	  CRAB_VERBOSE_IF(1, llvm::outs() << "Cannot build CFG for "
-			                  << F.getName() << "\n");
-	}
-      }
-      // build call graph
-      m_cg = make_unique<call_graph_t>(cfg_ref_vector.begin(), cfg_ref_vector.end());
-    }
-    
-    void Analyze(AnalysisParams &params,
-		 // assumptions can be provided in abs_dom format or
-		 // as linear constraints.
-		 const abs_dom_map_t &abs_dom_assumptions /*unused*/,
-		 const lin_csts_map_t &lin_csts_assumptions /*unused*/,
-		 AnalysisResults &results) {
-
-      // If the number of live variables per block is too high we
-      // switch to a cheap domain regardless what the user wants.
-      CrabDomain absdom =  params.dom;
-      
-      /* Compute liveness information and choose statically the
-	 abstract domain */
-
-      if (params.run_liveness || isRelationalDomain(absdom)) {
-	unsigned max_live_per_blk = 0;
-	for (auto cg_node: llvm::make_range(vertices(*m_cg))) {
-	  const liveness_t* live = nullptr;
-
-	  // Get the cfg builder to run liveness
-	  if (const Function *fun = m_M.getFunction(cg_node.name())) {
-	    auto cfg_builder = m_crab_builder_man.get_cfg_builder(*fun);
-	    assert(cfg_builder);
-	    // run liveness
-	    cfg_builder->compute_live_symbols();
-	    live = cfg_builder->get_live_symbols();
-	    // update max number of live variables for whole cg
-	    unsigned total_live, max_live_per_blk_, avg_live_per_blk;
-	    live->get_stats(total_live, max_live_per_blk_, avg_live_per_blk);
-	    max_live_per_blk = std::max(max_live_per_blk, max_live_per_blk_);
-	  }
-
-	  if (isRelationalDomain(absdom)) {
-	    // FIXME: the selection of the final domain is fixed for the
-	    //        whole program. That is, if there is one function that
-	    //        exceeds the threshold then the cheaper domain will be
-	    //        used for all functions. We should be able to change
-	    //        from one function to another.
-	    CRAB_VERBOSE_IF(1,
-		      crab::outs() << "Max live per block: "
-		                   << max_live_per_blk << "\n"
-		                   << "Threshold: "
-		                   << params.relational_threshold << "\n");
-            #ifdef HAVE_ALL_DOMAINS	  	    
-	    if (max_live_per_blk > params.relational_threshold) {
-	      // default domain
-	      absdom = INTERVALS;
-	    }
-            #endif 	    
-	  }
-	  
-	  if (params.run_liveness) {
-	    m_live_map.insert({cg_node.get_cfg(), live});	    
-	  } 
-	} // end for
-      }
-      
-      // -- run the interprocedural analysis
-      if (!CrabBuildOnlyCFG) {
-	////
-	// TODO: pass assumptions to the inter-procedural analysis
-	/////
-#ifndef TOP_DOWN_INTER_ANALYSIS	
-	if (inter_analyses.count({params.sum_dom, params.dom})) {
-	  inter_analyses.at({params.sum_dom, params.dom}).analyze(params, results);
-	} else {
-	  if (inter_analyses.count({ZONES_SPLIT_DBM, ZONES_SPLIT_DBM})) {
-	    crab::outs() << "Warning: abstract domains not found or enabled.\n"
-			 << "Compile with -DALL_DOMAINS=ON.\n";	    
-	    // crab::outs() << "Running " << inter_analyses.at({ZONES_SPLIT_DBM, INTERVALS}).name
-	    // 		    << "\n";
-	    // inter_analyses.at({ZONES_SPLIT_DBM, INTERVALS}).analyze(params, results);	
-	  } else {
-	    crab::outs() << "Warning: inter-procedural analysis is not enabled.\n"
-			 << "Compile with -DENABLE_INTER=ON or do not use --crab-inter\n";
-	  }
-	}
-#else
-	if (inter_analyses.count(params.dom)) {
-	  inter_analyses.at(params.dom).analyze(params, results);
-	} else {
-	  if (inter_analyses.count(ZONES_SPLIT_DBM)) {
-	    crab::outs() << "Warning: abstract domains not found or enabled.\n"
-			 << "Compile with -DALL_DOMAINS=ON.\n";	    
-	  } else {
-	    crab::outs() << "Warning: inter-procedural analysis is not enabled.\n"
-			 << "Compile with -DENABLE_INTER=ON or do not use --crab-inter\n";
-	  }
-	}
-#endif 	
-      }
-    }
-    
-  private:
-    
-    // crab call graph 
-    std::unique_ptr<call_graph_t> m_cg;
-    // crab cfg builder manager
-    CrabBuilderManager& m_crab_builder_man;
-    // the LLVM module
-    const Module& m_M;    
-    // live symbols
-    liveness_map_t m_live_map;
-
-    basic_block_label_t get_crab_basic_block(const BasicBlock* bb) const {
-      const Function*f = bb->getParent();
-      auto builder = m_crab_builder_man.get_cfg_builder(*f);
-      return builder->get_crab_basic_block(bb);
-    }
-    
-    /** Run inter-procedural analysis on the whole call graph **/
-#ifdef TOP_DOWN_INTER_ANALYSIS
-    template<typename Dom>
-#else    
-    template<typename BUDom, typename TDDom>
-#endif     
-    void analyzeCg(const AnalysisParams &params,
-		   AnalysisResults &results) {
-
-#ifdef TOP_DOWN_INTER_ANALYSIS
-      CRAB_VERBOSE_IF(1, 
- 		      crab::get_msg_stream() << "Running top-down inter-procedural analysis " 
-		                             << "with domain:" 
-		                             << "\"" << Dom::getDomainName() << "\""
-		                             << "  ...\n";);
-
-      typedef top_down_inter_analyzer<call_graph_ref_t, Dom> inter_analyzer_t;
-      typedef top_down_inter_analyzer_parameters<call_graph_ref_t> inter_params_t;      
-
-      inter_params_t inter_params;
-      inter_params.run_checker = params.check;
-      inter_params.checker_verbosity  = params.check_verbose;
-      inter_params.minimize_invariants = true;
-      inter_params.max_call_contexts = params.max_calling_contexts;
-      inter_params.live_map = (params.run_liveness ? &m_live_map : nullptr);
-      inter_params.widening_delay = params.widening_delay;
-      inter_params.descending_iters = params.narrowing_iters;
-      inter_params.thresholds_size = params.widening_jumpset;
-      inter_analyzer_t analyzer(*m_cg, inter_params);
-      analyzer.run(Dom::top());
-      if (inter_params.run_checker) {
-	results.checksdb += analyzer.get_all_checks();
-      }
-#else      
-      typedef bottom_up_inter_analyzer<call_graph_ref_t, BUDom, TDDom> inter_analyzer_t;
-      typedef inter_checker<inter_analyzer_t> inter_checker_t;
-      typedef assert_property_checker<inter_analyzer_t> assert_prop_t;
-      //typedef null_property_checker<inter_analyzer_t> null_prop_t;
-      
-      CRAB_VERBOSE_IF(1, 
- 		      crab::get_msg_stream() << "Running inter-procedural analysis with " 
-		                    << "forward domain:" 
-		                    << "\"" << TDDom::getDomainName() << "\""
-		                    << " and bottom-up domain:" 
-		                    << "\"" << BUDom::getDomainName() << "\"" 
-		                    << "  ...\n";);
-      
-      inter_analyzer_t analyzer(*m_cg, (params.run_liveness ? &m_live_map : nullptr),
-				params.widening_delay, 
-				params.narrowing_iters, 
-				params.widening_jumpset);
-      analyzer.run(TDDom::top());
-#endif
-    
-      CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Finished inter-procedural analysis.\n");
-      
-      // -- store invariants
-      if (params.store_invariants || params.print_invars) {
-	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Storing invariants.\n");
-      }
-      
-      for (auto &n: llvm::make_range(vertices(*m_cg))) {
-	cfg_ref_t cfg = n.get_cfg();
-	if (const Function *F = m_M.getFunction(n.name())) {
-	  if (params.store_invariants || params.print_invars) {
-	    for (basic_block_label_t bl:
-		   llvm::make_range(cfg.label_begin(),cfg.label_end())) {
-	      if (bl.is_edge()) {
-		// Note that we use get_post instead of get_pre:
-		//   the crab block (bl) has an assume statement corresponding
-		//   to the branch condition in the predecessor of the
-		//   LLVM edge. We want the invariant *after* the
-		//   evaluation of the assume.		
-		if (analyzer.get_post(cfg, bl).is_bottom()) {
-		  results.infeasible_edges.insert({bl.get_edge().first, bl.get_edge().second});
-		}
-	      } else if (const BasicBlock *B = bl.get_basic_block()) {
-		// --- invariants that hold at the entry of the blocks
-		auto pre = analyzer.get_pre(cfg, get_crab_basic_block(B));
-		update(results.premap, *B, mkGenericAbsDomWrapper(pre));
-		// --- invariants that hold at the exit of the blocks
-		auto post = analyzer.get_post(cfg, get_crab_basic_block(B));
-		update(results.postmap, *B, mkGenericAbsDomWrapper(post));
-
-		#if 0
-		if (params.stats) {
-		  unsigned num_block_invars = 0;
-		  // XXX: for boxes we should use
-		  // to_disjunctive_linear_constraint_system() but it
-		  // can be very expensive.
-		  num_block_invars += pre.to_linear_constraint_system().size();
-		  num_invars += num_block_invars;
-		  if (num_block_invars > 0) num_nontrivial_blocks++;
-		}
-		#endif 
-	      } else {
-		// this should be unreachable
-	      assert(false && "A Crab block should correspond to either an LLVM edge or block");
-	      }
-	    }
-	    
-	    // --- print invariants and summaries
-	    if (params.print_invars && isTrackable(*F)) {
-	      if (cfg.has_func_decl()) {
-		auto fdecl = cfg.get_func_decl();
-		crab::outs() << "\n" << fdecl << "\n";
-	      } else {
-		llvm::outs() << "\n" << "function " << F->getName() << "\n";
-	      }
-	      std::vector<std::unique_ptr<pretty_printer_impl::block_annotation>> annotations;
-	      annotations.emplace_back(make_unique<pretty_printer_impl::invariant_annotation>
-				       (m_crab_builder_man.get_var_factory(),
-					results.premap, results.postmap,
-					params.keep_shadow_vars));
-	      pretty_printer_impl::print_annotations(cfg, annotations);	    
-	    }
-	  }
-
-#ifndef TOP_DOWN_INTER_ANALYSIS	  
-	  // Summaries are not currently stored but it would be easy to do so.	    
-	  if (params.print_summaries && analyzer.has_summary(cfg)) {
-	    auto summ = analyzer.get_summary(cfg);
-	    crab::outs() << "SUMMARY " << *summ << "\n";
-	  }
-#endif 	  
-	}
-      }
-      
-      if (params.store_invariants || params.print_invars) {	
-	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "All invariants stored.\n");
-      }
-
-#ifndef TOP_DOWN_INTER_ANALYSIS      
-      // --- checking assertions and collecting data
-      if (params.check) {
-	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Checking assertions ... \n"); 
-	typename inter_checker_t::prop_checker_ptr
-	  prop(new assert_prop_t(params.check_verbose));
-	// if (params.check == NULLITY)
-	//   prop.reset(new null_prop_t(params.check_verbose));      
-	inter_checker_t checker(analyzer, {prop});
-	checker.run();
-	//CRAB_VERBOSE_IF(1, checker.show(crab::outs()));
-	results.checksdb += checker.get_all_checks();
-	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Finished assert checking.\n"); 
-      }
-#endif       
-      return;
-    }
-
-    // Domains used for inter-procedural analysis
-    struct inter_analysis {
-      std::function<void(const AnalysisParams&, AnalysisResults&)> analyze;
-      std::string name;
-    };
-
-    // Domains used for intra-procedural analysis
-#ifdef TOP_DOWN_INTER_ANALYSIS
-    const std::map<CrabDomain, inter_analysis> inter_analyses {
-      #ifdef HAVE_INTER
-      { ZONES_SPLIT_DBM,
-	  { bind_this(this, &InterClam_Impl::analyzeCg<split_dbm_domain_t>), "zones" }}
-      #ifdef HAVE_ALL_DOMAINS
-      , { INTERVALS,
-	  { bind_this(this, &InterClam_Impl::analyzeCg<interval_domain_t>), "intervals" }}
-      , { WRAPPED_INTERVALS,
-	  { bind_this(this, &InterClam_Impl::analyzeCg<wrapped_interval_domain_t>), "wrapped intervals" }}
-      , { OCT,
-	  { bind_this(this, &InterClam_Impl::analyzeCg<oct_domain_t>), "oct" }}
-      , { TERMS_ZONES,
-	  { bind_this(this, &InterClam_Impl::analyzeCg<num_domain_t>), "terms+zones" }}
-      , { TERMS_DIS_INTERVALS,
-	  { bind_this(this, &InterClam_Impl::analyzeCg<term_dis_int_domain_t>), "terms+dis_intervals" }}
-      , { BOXES,
-	  { bind_this(this, &InterClam_Impl::analyzeCg<boxes_domain_t>), "boxes" }}
-      , { PK,
-	  { bind_this(this, &InterClam_Impl::analyzeCg<pk_domain_t>), "pk" }}
-      #endif
-      #endif 	
-    };    
-  };
-#else    
-    const std::map<std::pair<CrabDomain,CrabDomain>, inter_analysis> inter_analyses {
-      #ifdef HAVE_INTER
-      {{ZONES_SPLIT_DBM, ZONES_SPLIT_DBM},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<split_dbm_domain_t, split_dbm_domain_t>), "bottom-up:zones, top-down:zones" }}
-      #ifdef HAVE_ALL_DOMAINS
-      , {{ZONES_SPLIT_DBM, INTERVALS},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<split_dbm_domain_t, interval_domain_t>), "bottom-up:zones, top-down:intervals" }}
-      , {{ZONES_SPLIT_DBM, WRAPPED_INTERVALS},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<split_dbm_domain_t, wrapped_interval_domain_t>), "bottom-up:zones, top-down:wrapped intervals" }}
-      , {{ZONES_SPLIT_DBM, OCT},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<split_dbm_domain_t, oct_domain_t>), "bottom-up:zones, top-down:oct" }}
-      , {{ZONES_SPLIT_DBM, TERMS_ZONES},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<split_dbm_domain_t, num_domain_t>), "bottom-up:zones, top-down:terms+zones" }}
-      , {{ZONES_SPLIT_DBM, TERMS_DIS_INTERVALS},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<split_dbm_domain_t, term_dis_int_domain_t>), "bottom-up:zones, top-down:terms+dis_intervals" }}
-      , {{ZONES_SPLIT_DBM, BOXES},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<split_dbm_domain_t, boxes_domain_t>), "bottom-up:zones, top-down:boxes" }}
-      , {{ZONES_SPLIT_DBM, PK},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<split_dbm_domain_t, pk_domain_t>), "bottom-up:zones, top-down:pk" }}	
-      , {{OCT, INTERVALS},
-	 { bind_this(this, &InterClam_Impl::analyzeCg<oct_domain_t, interval_domain_t>), "bottom-up:oct, top-down:intervals" }}
-      , {{OCT, WRAPPED_INTERVALS},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<oct_domain_t, wrapped_interval_domain_t>), "bottom-up:oct, top-down:wrapped intervals" }}
-      , {{OCT, ZONES_SPLIT_DBM},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<oct_domain_t, split_dbm_domain_t>), "bottom-up:oct, top-down:zones" }}
-      , {{OCT, BOXES},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<oct_domain_t, boxes_domain_t>), "bottom-up:oct, top-down:boxes" }}
-      , {{OCT, OCT},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<oct_domain_t, oct_domain_t>), "bottom-up:oct, top-down:oct" }}
-      , {{OCT, PK},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<oct_domain_t, pk_domain_t>), "bottom-up:oct, top-down:pk" }}
-      , {{OCT, TERMS_ZONES},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<oct_domain_t, num_domain_t>), "bottom-up:oct, top-down:terms+zones" }}
-      , {{OCT, TERMS_DIS_INTERVALS},
-	  { bind_this(this, &InterClam_Impl::analyzeCg<oct_domain_t, term_dis_int_domain_t>), "bottom-up:oct, top-down:terms+dis_intervals" }}
-      #endif
-      #endif 	
-    };    
-  };
-#endif 
 
   /**
    *   Begin InterClam methods
    **/
-  InterClam::InterClam(const Module &module, CrabBuilderManager &man)		        
+  InterClam::InterClam(const Module &module, CrabBuilderManager &man,
+		       unsigned num_threads)
     : m_impl(nullptr), m_builder_man(man) {
-    m_impl = make_unique<InterClam_Impl>(module, m_builder_man);
+    m_impl = make_unique<InterClam_Impl>(module, m_builder_man, num_threads);
   }
 
   InterClam::~InterClam() {}
@@ -1259,6 +466,12 @@ namespace clam {
     m_impl->Analyze(params, abs_dom_assumptions, assumptions, results);
   }
 
+  void InterClam::reanalyze(AnalysisParams &params,
+			    const std::vector<const llvm::Function*> &changed) {
+    AnalysisResults results = { m_pre_map, m_post_map, m_infeasible_edges, m_checks_db};
+    m_impl->Reanalyze(params, changed, results);
+  }
+
   wrapper_dom_ptr InterClam::get_pre(const llvm::BasicBlock *block,
 					 bool keep_shadows) const {
     std::vector<varname_t> shadows;
@@ -1283,7 +496,7 @@ namespace clam {
 
   bool InterClam::has_feasible_edge(const llvm::BasicBlock *b1,
 					const llvm::BasicBlock* b2) const {
-    return !(m_infeasible_edges.count({b1, b2}) > 0);
+    return !(m_infeasible_edges.contains(b1, b2));
   }
   
   const checks_db_t& InterClam::get_checks_db() const { return m_checks_db;}
@@ -1293,69 +506,1451 @@ namespace clam {
    **/
   
   /**
-   * Begin ClamPass methods
+   * Estimate the cost of analyzing each function with the domain it
+   * will be analyzed with. Liveness is computed only if compute_live.
+   * If params.cache_dir has the time of a previous analysis of a
+   * function then that time is its cost, and the estimates of the
+   * other functions are converted to seconds with the average ratio
+   * between those times and their estimates.
    **/
-  ClamPass::ClamPass():
-    llvm::ModulePass(ID), m_cfg_builder_man(nullptr) {}
-  
-  void ClamPass::releaseMemory() {
-    m_pre_map.clear(); 
-    m_post_map.clear();
-    m_checks_db.clear();
-  }
-  
-  bool ClamPass::runOnModule(Module &M) {
+  static void estimateCosts(const std::vector<const Function*> &funcs,
+			    CrabBuilderManager &man,
+			    const AnalysisParams &params,
+			    unsigned num_threads,
+			    const FunctionAnalysisConfig *config,
+			    bool compute_live,
+			    std::vector<std::unique_ptr<AnalysisCost>> &features,
+			    DenseMap<const Function*, double> &costs) {
+    man.mk_cfg_builders(funcs, num_threads);
+    features.clear();
+    features.resize(funcs.size());
+    std::atomic<unsigned> next(0);
+    auto worker = [&]() {
+      for (unsigned i = next++; i < funcs.size(); i = next++) {
+	auto builder = man.mk_cfg_builder(*funcs[i]);
+	features[i] = make_unique<AnalysisCost>(*funcs[i], *builder, compute_live);
+      }
+    };
+    num_threads = std::max(std::min(num_threads, (unsigned) funcs.size()), 1U);
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < num_threads; ++i) {
+      workers.emplace_back(worker);
+    }
+    worker();
+    for (auto &t: workers) {
+      t.join();
+    }
 
-    /// Translate the module to Crab CFGs
+    std::vector<double> estimates(funcs.size());
+    std::vector<double> times(funcs.size(), -1);
+    double sum_times = 0, sum_estimates = 0;
+    for (unsigned i = 0; i < funcs.size(); ++i) {
+      AnalysisParams fparams(params);
+      if (config) {
+	config->apply(*funcs[i], fparams);
+      }
+      estimates[i] = features[i]->estimate(fparams.dom, fparams);
+      if (!params.cache_dir.empty() &&
+	  AnalysisCache(params.cache_dir).loadTime(*funcs[i], times[i])) {
+	sum_times += times[i];
+	sum_estimates += estimates[i];
+      }
+    }
+    double ratio = (sum_times > 0 && sum_estimates > 0) ?
+      sum_times / sum_estimates : 1;
+    for (unsigned i = 0; i < funcs.size(); ++i) {
+      costs[funcs[i]] = times[i] >= 0 ? times[i] : estimates[i] * ratio;
+    }
+  }
+
+  /**
+   * Keep in funcs only the functions of the given shard. The functions
+   * are assigned, from the largest, to the shard with fewer
+   * instructions so far. The assignment only depends on the module so
+   * the shards of all the runs on the same module are disjoint.
+   **/
+  static void selectShard(std::vector<const Function*> &funcs,
+			  unsigned shard, unsigned num_shards) {
+    std::vector<unsigned> sizes(funcs.size());
+    std::vector<unsigned> order(funcs.size());
+    for (unsigned i = 0; i < funcs.size(); ++i) {
+      sizes[i] = std::distance(inst_begin(funcs[i]), inst_end(funcs[i]));
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sizes](unsigned i, unsigned j) {
+	return sizes[i] > sizes[j];
+      });
+    std::vector<uint64_t> loads(num_shards, 0);
+    std::vector<char> selected(funcs.size(), false);
+    for (unsigned i: order) {
+      unsigned min = std::min_element(loads.begin(), loads.end()) - loads.begin();
+      // -- empty functions still count so that they are spread
+      loads[min] += std::max(sizes[i], 1U);
+      selected[i] = (min == shard);
+    }
+    unsigned j = 0;
+    for (unsigned i = 0; i < funcs.size(); ++i) {
+      if (selected[i]) {
+	funcs[j++] = funcs[i];
+      }
+    }
+    funcs.resize(j);
+  }
+
+  // Print, from the most expensive function, the features of each
+  // function and the estimated cost of each available domain.
+  static void printCosts(const std::vector<const Function*> &funcs,
+			 const AnalysisParams &params,
+			 const std::vector<std::unique_ptr<AnalysisCost>> &features,
+			 const DenseMap<const Function*, double> &costs) {
+    std::vector<unsigned> order(funcs.size());
+    for (unsigned i = 0; i < funcs.size(); ++i) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](unsigned i, unsigned j) {
+	return costs.lookup(funcs[i]) > costs.lookup(funcs[j]);
+      });
+
+    llvm::outs() << "\n************** ESTIMATED ANALYSIS COST ****************\n";
+    for (unsigned i: order) {
+      crab_raw_os o(llvm::outs());
+      o << funcs[i]->getName().str() << ": ";
+      features[i]->write(o);
+      o << "\n";
+      std::vector<std::pair<double, CrabDomain>> ranking;
+      for (unsigned dom = 0; dom < NUM_CRAB_DOMAINS; ++dom) {
+	if (IntraClam_Impl::intra_analyses().count(dom)) {
+	  ranking.push_back({features[i]->estimate((CrabDomain) dom, params),
+			     (CrabDomain) dom});
+	}
+      }
+      std::stable_sort(ranking.begin(), ranking.end());
+      for (auto &kv: ranking) {
+	llvm::outs() << "  " << dom_to_str(kv.second) << " "
+		     << format("%.3g", kv.first) << "\n";
+      }
+    }
+    llvm::outs() << "************** ESTIMATED ANALYSIS COST END *************\n";
+  }
+
+  /**
+   * Line-delimited JSON records with the checks of each function,
+   * written as soon as the function is analyzed (--crab-check-stream):
+   *
+   *   {"function": ..., "file": ..., "line": ..., "safe": n,
+   *    "error": n, "warning": n, "time": seconds}
+   *
+   * file and line are the location of the function in the sources and
+   * are only present if it has debug info. If the analysis is stopped
+   * by --crab-stop-on-error the last record is {"stopped": function}.
+   **/
+  class CheckStream {
+    std::unique_ptr<raw_fd_ostream> m_file;
+    raw_ostream *m_os;
+    std::mutex m_mutex;
+
+    CheckStream(): m_os(nullptr) {}
+    
+  public:
+    // Return null if filename cannot be written. "-" is the standard
+    // output.
+    static std::unique_ptr<CheckStream> open(const std::string &filename) {
+      std::unique_ptr<CheckStream> res(new CheckStream());
+      if (filename == "-") {
+	res->m_os = &llvm::outs();
+	return res;
+      }
+      std::error_code ec;
+      res->m_file.reset(new raw_fd_ostream(filename, ec, sys::fs::F_Text));
+      if (ec) {
+	CLAM_WARNING("cannot write " << filename << ": " << ec.message());
+	return nullptr;
+      }
+      res->m_os = res->m_file.get();
+      return res;
+    }
+
+    void report(const Function &F, const ClamFunctionStats &fs) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      raw_ostream &o = *m_os;
+      o << "{\"function\": \"" << jsonEscape(F.getName()) << "\"";
+      if (const DISubprogram *sp = F.getSubprogram()) {
+	o << ", \"file\": \"" << jsonEscape(sp->getFilename()) << "\""
+	  << ", \"line\": " << sp->getLine();
+      }
+      o << ", \"safe\": " << fs.safe_checks
+	<< ", \"error\": " << fs.error_checks
+	<< ", \"warning\": " << fs.warning_checks
+	<< ", \"time\": " << format("%.6f", fs.analysis_time) << "}\n";
+      // -- readers see each function as soon as it is analyzed
+      o.flush();
+    }
+
+    void stopped(const Function &F) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      *m_os << "{\"stopped\": \"" << jsonEscape(F.getName()) << "\"}\n";
+      m_os->flush();
+    }
+  };
+
+  /**
+   * Progress of the intra-procedural analysis of a module
+   * (--crab-checkpoint-dir). Each analyzed function is appended to a
+   * manifest, one record per line:
+   *
+   *   <function> \t <#safe> \t <#error> \t <#warning> \t <time>
+   *
+   * There is one manifest per module and analysis parameters. The
+   * invariants are not in the manifest but in the cache
+   * (params.cache_dir) so after a restart a function of the manifest
+   * is restored from the cache instead of being analyzed again. A
+   * record is flushed as soon as it is written so only the functions
+   * being analyzed are lost if the run is killed.
+   **/
+  class Checkpoint {
+    struct record_t {
+      unsigned safe, error, warning;
+      double time;
+    };
+    std::string m_filename;
+    std::unordered_map<std::string, record_t> m_done;
+    std::unique_ptr<raw_fd_ostream> m_file;
+    std::mutex m_mutex;
+
+    Checkpoint() {}
+
+    // Ignore the records that are not complete (e.g., the last one if
+    // the run was killed while writing it)
+    void read(StringRef data) {
+      SmallVector<StringRef, 64> lines;
+      data.split(lines, '\n', -1, false);
+      if (!data.endswith("\n") && !lines.empty()) {
+	lines.pop_back();
+      }
+      for (StringRef line: lines) {
+	SmallVector<StringRef, 5> fields;
+	// -- the name of the function is the only field that could have
+	//    a tab
+	StringRef rest = line;
+	for (unsigned i = 0; i < 4; ++i) {
+	  std::pair<StringRef, StringRef> p = rest.rsplit('\t');
+	  if (p.second.empty() || p.first == rest) {
+	    break;
+	  }
+	  fields.push_back(p.second);
+	  rest = p.first;
+	}
+	record_t rec;
+	if (fields.size() != 4 ||
+	    fields[3].getAsInteger(10, rec.safe) ||
+	    fields[2].getAsInteger(10, rec.error) ||
+	    fields[1].getAsInteger(10, rec.warning) ||
+	    fields[0].getAsDouble(rec.time)) {
+	  continue;
+	}
+	m_done[rest.str()] = rec;
+      }
+    }
+
+  public:
+    // Return the key of the manifest of the analysis of funcs. The
+    // functions are only identified by their names and sizes: the
+    // cache decides whether the results of a function are still valid.
+    static std::string getKey(const Module &M,
+			      const std::vector<const Function*> &funcs,
+			      const AnalysisParams &params) {
+      hash_code h = hash_combine(M.getModuleIdentifier(),
+				 dom_to_str(params.dom), params.check,
+				 params.run_backward, params.run_liveness,
+				 params.widening_delay, params.narrowing_iters);
+      for (const Function *F: funcs) {
+	unsigned num_insts = 0;
+	for (const BasicBlock &B: *F) {
+	  num_insts += B.size();
+	}
+	h = hash_combine(h, F->getName(), F->size(), num_insts);
+      }
+      return utohexstr((uint64_t) (size_t) h);
+    }
+
+    // Return null if the manifest cannot be written
+    static std::unique_ptr<Checkpoint> open(const std::string &dir,
+					    const std::string &key) {
+      if (std::error_code ec = sys::fs::create_directories(dir)) {
+	CLAM_WARNING("cannot create checkpoint directory " << dir << ": "
+		     << ec.message());
+	return nullptr;
+      }
+      std::unique_ptr<Checkpoint> res(new Checkpoint());
+      SmallString<256> path(dir);
+      sys::path::append(path, "progress-" + key);
+      res->m_filename = path.str();
+      bool partial = false;
+      if (auto buf = MemoryBuffer::getFile(res->m_filename)) {
+	StringRef data = (*buf)->getBuffer();
+	res->read(data);
+	partial = !data.empty() && !data.endswith("\n");
+      }
+      std::error_code ec;
+      res->m_file.reset(new raw_fd_ostream(res->m_filename, ec,
+					   sys::fs::F_Append | sys::fs::F_Text));
+      if (ec) {
+	CLAM_WARNING("cannot write " << res->m_filename << ": " << ec.message());
+	return nullptr;
+      }
+      if (partial) {
+	// -- end the incomplete record so that it is ignored
+	*res->m_file << "\n";
+      }
+      return res;
+    }
+
+    const std::string &get_filename() const { return m_filename; }
+
+    unsigned num_done() const { return m_done.size(); }
+
+    // Only the records read by open: they are not modified afterwards
+    // so this can be called concurrently with completed.
+    bool done(const Function &F) const {
+      return m_done.count(F.getName().str()) > 0;
+    }
+
+    void completed(const Function &F, const ClamFunctionStats &fs) {
+      if (done(F)) {
+	return;
+      }
+      std::lock_guard<std::mutex> lock(m_mutex);
+      *m_file << F.getName() << "\t" << fs.safe_checks
+	      << "\t" << fs.error_checks << "\t" << fs.warning_checks
+	      << "\t" << format("%.6f", fs.analysis_time) << "\n";
+      m_file->flush();
+    }
+  };
+
+  /**
+   * Status of the intra-procedural analysis of a module, rewritten
+   * every interval seconds by a background thread and once more when
+   * the analysis ends (--crab-progress-file):
+   *
+   *   {"done": n, "total": n, "elapsed": seconds, "eta": seconds,
+   *    "rss_mb": n, "current": [{"function": ..., "elapsed": seconds}]}
+   *
+   * eta is the estimated time left: the estimated cost of the
+   * functions not analyzed yet (see AnalysisCost.hh) times the time
+   * per unit of cost of the functions done, divided among the
+   * threads. Without cost estimates all functions cost the same. It
+   * is only present once a function is done. rss_mb is only present
+   * on Linux.
+   **/
+  class ProgressReport {
+    typedef std::chrono::steady_clock clock_t;
+
+    std::string m_filename;
+    unsigned m_num_threads;
+    unsigned m_total;
+    DenseMap<const Function*, double> m_costs;
+    double m_total_cost;
+    unsigned m_done;
+    double m_done_cost;
+    double m_done_time;
+    clock_t::time_point m_start;
+    // functions being analyzed and when they started
+    std::vector<std::pair<const Function*, clock_t::time_point>> m_current;
+    bool m_stop;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::thread m_thread;
+
+    double cost(const Function *F) const {
+      auto it = m_costs.find(F);
+      return it != m_costs.end() ? it->second : 1;
+    }
+
+    static double seconds(clock_t::duration d) {
+      return std::chrono::duration<double>(d).count();
+    }
+
+    // Write first into a temporary file and then rename it so that
+    // readers never see a partial status. Called with m_mutex held.
+    void write() {
+      auto now = clock_t::now();
+      std::string buf;
+      raw_string_ostream o(buf);
+      o << "{\"done\": " << m_done << ", \"total\": " << m_total
+	<< ", \"elapsed\": " << format("%.1f", seconds(now - m_start));
+      if (m_done > 0 && m_done_cost > 0) {
+	double left = (m_total_cost - m_done_cost) * (m_done_time / m_done_cost);
+	for (auto &kv: m_current) {
+	  left -= seconds(now - kv.second);
+	}
+	o << ", \"eta\": "
+	  << format("%.1f", std::max(left, 0.0) / std::max(m_num_threads, 1U));
+      }
+      long rss = residentMemoryMB();
+      if (rss >= 0) {
+	o << ", \"rss_mb\": " << rss;
+      }
+      o << ", \"current\": [";
+      for (unsigned i = 0; i < m_current.size(); ++i) {
+	o << (i > 0 ? ", " : "") << "{\"function\": \""
+	  << jsonEscape(m_current[i].first->getName()) << "\", \"elapsed\": "
+	  << format("%.1f", seconds(now - m_current[i].second)) << "}";
+      }
+      o << "]}\n";
+      o.flush();
+
+      int fd;
+      SmallString<256> tmp_path;
+      if (std::error_code ec =
+	  sys::fs::createUniqueFile(m_filename + "-%%%%%%.tmp", fd, tmp_path)) {
+	CLAM_WARNING("cannot write " << m_filename << ": " << ec.message());
+	return;
+      }
+      {
+	raw_fd_ostream f(fd, /*shouldClose=*/true);
+	f << buf;
+      }
+      if (std::error_code ec = sys::fs::rename(tmp_path, m_filename)) {
+	CLAM_WARNING("cannot write " << m_filename << ": " << ec.message());
+	sys::fs::remove(tmp_path);
+      }
+    }
+
+  public:
+    ProgressReport(const std::string &filename, unsigned interval,
+		   unsigned num_threads,
+		   const std::vector<const Function*> &funcs,
+		   const DenseMap<const Function*, double> &costs)
+      : m_filename(filename), m_num_threads(num_threads),
+	m_total(funcs.size()), m_costs(costs), m_total_cost(0),
+	m_done(0), m_done_cost(0), m_done_time(0),
+	m_start(clock_t::now()), m_stop(false) {
+      for (const Function *F: funcs) {
+	m_total_cost += cost(F);
+      }
+      std::lock_guard<std::mutex> lock(m_mutex);
+      write();
+      if (interval > 0) {
+	m_thread = std::thread([this, interval]() {
+	    std::unique_lock<std::mutex> lock(m_mutex);
+	    while (!m_cond.wait_for(lock, std::chrono::seconds(interval),
+				    [this]() { return m_stop; })) {
+	      write();
+	    }
+	  });
+      }
+    }
+
+    ~ProgressReport() {
+      {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stop = true;
+	write();
+      }
+      m_cond.notify_all();
+      if (m_thread.joinable()) {
+	m_thread.join();
+      }
+    }
+
+    // Replace the cost estimates (e.g., once computed by the parallel
+    // analysis)
+    void set_costs(const DenseMap<const Function*, double> &costs,
+		   const std::vector<const Function*> &funcs) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_costs = costs;
+      m_total_cost = 0;
+      for (const Function *F: funcs) {
+	m_total_cost += cost(F);
+      }
+    }
+
+    void started(const Function &F) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_current.push_back({&F, clock_t::now()});
+    }
+
+    void finished(const Function &F) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = std::find_if(m_current.begin(), m_current.end(),
+			     [&F](const std::pair<const Function*,
+				  clock_t::time_point> &kv) {
+			       return kv.first == &F;
+			     });
+      if (it == m_current.end()) {
+	return;
+      }
+      m_done++;
+      m_done_cost += cost(&F);
+      m_done_time += seconds(clock_t::now() - it->second);
+      m_current.erase(it);
+    }
+  };
+
+  /**
+   * Admission of the functions analyzed in parallel within a memory
+   * budget (--crab-threads-mem-budget). The footprint of a function is
+   * predicted by AnalysisCost::footprint and scaled by the ratio
+   * between the memory used by the functions analyzed so far and
+   * their predictions, if the allocations are tracked (MemTracker).
+   *
+   * A function is started once its footprint fits in what the running
+   * functions left of the budget, so fewer functions run at the same
+   * time when the large ones run. It is always started if no other
+   * function runs. If its footprint alone exceeds the budget then it
+   * is analyzed with the next domain of params.downgrade_chain that
+   * fits (the last one if none fits).
+   **/
+  class MemoryGovernor {
+  public:
+    struct ticket_t {
+      std::string function;
+      // unscaled prediction
+      double predicted;
+      uint64_t reserved;
+      uint64_t live_before;
+      ticket_t(): predicted(0), reserved(0), live_before(0) {}
+    };
+
+  private:
+    const uint64_t m_budget;
+    uint64_t m_in_use;
+    unsigned m_running;
+    // sums over the functions analyzed so far (for the ratio)
+    double m_observed;
+    double m_predicted;
+    std::mutex m_mutex;
+    std::condition_variable m_released;
+
+    double ratio() const {
+      return (m_observed > 0 && m_predicted > 0) ? m_observed / m_predicted : 1;
+    }
+
+  public:
+    explicit MemoryGovernor(uint64_t budget)
+      : m_budget(budget), m_in_use(0), m_running(0),
+	m_observed(0), m_predicted(0) {}
+
+    // Wait until F can be started. params.dom is downgraded if needed.
+    ticket_t admit(const Function &F, const AnalysisCost &cost,
+		   AnalysisParams &params) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      double predicted = cost.footprint(params.dom, params);
+      if (predicted * ratio() > m_budget) {
+	const std::vector<CrabDomain> &chain = params.downgrade_chain;
+	auto it = std::find(chain.begin(), chain.end(), params.dom);
+	it = (it == chain.end() ? chain.begin() : std::next(it));
+	CrabDomain dom = params.dom;
+	for (; it != chain.end(); ++it) {
+	  if (IntraClam_Impl::intra_analyses().count(*it)) {
+	    dom = *it;
+	    if (cost.footprint(dom, params) * ratio() <= m_budget) break;
+	  }
+	}
+	if (dom != params.dom) {
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Analyzing "
+			  << F.getName() << " with " << dom_to_str(dom)
+			  << " instead of " << dom_to_str(params.dom)
+			  << ": its predicted memory exceeds the budget\n";);
+	  ClamStats::count("Governor.Downgrades");
+	  params.dom = dom;
+	  predicted = cost.footprint(dom, params);
+	}
+      }
+      ticket_t t;
+      t.function = F.getName();
+      t.predicted = predicted;
+      t.reserved = (uint64_t) std::min(predicted * ratio(), (double) m_budget);
+      if (m_running > 0 && m_in_use + t.reserved > m_budget) {
+	ClamStats::count("Governor.Waits");
+	m_released.wait(lock, [&]() {
+	    return m_running == 0 || m_in_use + t.reserved <= m_budget;
+	  });
+      }
+      ++m_running;
+      m_in_use += t.reserved;
+      t.live_before = MemTracker::get_function(t.function).live;
+      return t;
+    }
+
+    // F of t is done
+    void release(const ticket_t &t) {
+      uint64_t observed = 0;
+      if (MemTracker::enabled()) {
+	// -- the peak can be the one of the CFG construction: the
+	//    footprint is then overestimated, which is safe
+	MemTracker::usage_t u = MemTracker::get_function(t.function);
+	observed = u.peak > t.live_before ? u.peak - t.live_before : 0;
+      }
+      {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	--m_running;
+	m_in_use -= t.reserved;
+	if (observed > 0 && t.predicted > 0) {
+	  m_observed += observed;
+	  m_predicted += t.predicted;
+	}
+      }
+      m_released.notify_all();
+    }
+  };
+
+  /**
+   * Analyze independently all trackable functions using a pool of
+   * threads. Each function is analyzed with its own copy of the
+   * analysis parameters and its own results which are merged into
+   * results at the end.
+   *
+   * All the CFGs are built before any analysis starts. The functions
+   * are analyzed from the most expensive one (costs, or estimated if
+   * costs is null) so that a large function does not finish last
+   * while the other threads are idle.
+   *
+   * If stream is not null the checks of each function are reported as
+   * soon as it is analyzed. If stop_on_error then no function is
+   * started once a function has an error check. No function is
+   * started either once params.cancel_token is cancelled. With
+   * --crab-threads-mem-budget the functions are started by a
+   * MemoryGovernor.
+   **/
+  static void parallelIntraAnalyze(const std::vector<const Function*> &funcs,
+				   CrabBuilderManager &man,
+				   const AnalysisParams &params,
+				   unsigned num_threads,
+				   const FunctionAnalysisConfig *config,
+				   const DenseMap<const Function*, double> *costs,
+				   AnalysisResults &results,
+				   std::vector<ClamFunctionStats> &stats,
+				   CheckStream *stream, Checkpoint *checkpoint,
+				   ProgressReport *progress, bool stop_on_error) {
+    struct FunctionResults {
+      abs_dom_map_t premap;
+      abs_dom_map_t postmap;
+      lazy_inv_map_t lazy_invariants;
+      edges_set infeasible_edges;
+      checks_db_t checksdb;
+    };
+    
+    man.mk_cfg_builders(funcs, num_threads);
+    std::vector<std::unique_ptr<IntraClam_Impl>> analyzers;
+    analyzers.reserve(funcs.size());
+    for (const Function *F: funcs) {
+      analyzers.emplace_back(make_unique<IntraClam_Impl>(*F, man));
+    }
+
+    std::vector<unsigned> order(funcs.size());
+    for (unsigned i = 0; i < funcs.size(); ++i) {
+      order[i] = i;
+    }
+    DenseMap<const Function*, double> estimated_costs;
+    std::vector<std::unique_ptr<AnalysisCost>> features;
+    std::unique_ptr<MemoryGovernor> governor;
+    if (CrabThreadsMemBudget > 0) {
+      governor.reset(new MemoryGovernor((uint64_t) CrabThreadsMemBudget << 20));
+    }
+    if (!costs || governor) {
+      // -- liveness is only computed if the analysis needs it anyway
+      //    or for the footprints
+      bool compute_live = params.run_liveness || isRelationalDomain(params.dom) ||
+	!CrabStatsJson.empty() || governor;
+      estimateCosts(funcs, man, params, num_threads, config, compute_live,
+		    features, estimated_costs);
+      if (!costs) {
+	costs = &estimated_costs;
+	if (progress) {
+	  progress->set_costs(estimated_costs, funcs);
+	}
+      }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](unsigned i, unsigned j) {
+	return costs->lookup(funcs[i]) > costs->lookup(funcs[j]);
+      });
+
+    std::vector<FunctionResults> func_results(funcs.size());
+    std::vector<char> analyzed(funcs.size(), false);
+    // -- in deterministic mode the functions are reported in module
+    //    order and, if stop_on_error, only the functions up to the
+    //    first error in module order are merged as in a sequential run.
+    //    Their check indexes are kept apart until then.
+    bool deterministic = params.deterministic;
+    std::vector<std::unique_ptr<CheckIndexWriter>> check_indexes(funcs.size());
+    if (deterministic && stop_on_error && results.check_index) {
+      for (auto &ci: check_indexes) {
+	ci.reset(new CheckIndexWriter());
+      }
+    }
+    std::vector<char> done(funcs.size(), false);
+    unsigned next_report = 0;
+    unsigned num_merged = funcs.size();
+    std::mutex report_mutex;
+    std::atomic<unsigned> next(0);
+    std::atomic<bool> stop(false);
+    auto report = [&](unsigned i) {
+      const ClamFunctionStats &fs = analyzers[i]->get_stats();
+      if (stream) {
+	stream->report(*funcs[i], fs);
+      }
+      if (checkpoint) {
+	checkpoint->completed(*funcs[i], fs);
+      }
+      if (stop_on_error && fs.error_checks > 0 && !stop.exchange(true)) {
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Stopped after the first "
+			<< "error in " << funcs[i]->getName() << "\n";);
+	if (stream) {
+	  stream->stopped(*funcs[i]);
+	}
+	if (deterministic) {
+	  num_merged = i + 1;
+	}
+      }
+    };
+    auto worker = [&]() {
+      /* -- empty assumptions */
+      abs_dom_map_t abs_dom_assumptions;
+      lin_csts_map_t lin_csts_assumptions;
+      for (unsigned k = next++; k < funcs.size() && !stop; k = next++) {
+	if (params.should_stop()) {
+	  stop = true;
+	  break;
+	}
+	unsigned i = order[k];
+	// Analyze can modify the parameters (e.g., the abstract domain)
+	AnalysisParams fparams(params);
+	if (config) {
+	  config->apply(*funcs[i], fparams);
+	}
+	MemoryGovernor::ticket_t ticket;
+	if (governor) {
+	  ticket = governor->admit(*funcs[i], *features[i], fparams);
+	  if (stop || params.should_stop()) {
+	    governor->release(ticket);
+	    stop = true;
+	    break;
+	  }
+	}
+	FunctionResults &fres = func_results[i];
+	AnalysisResults res = {fres.premap, fres.postmap,
+			       fres.infeasible_edges, fres.checksdb,
+			       (results.lazy_invariants ? &fres.lazy_invariants : nullptr),
+			       (check_indexes[i] ? check_indexes[i].get() : results.check_index)};
+	if (progress) {
+	  progress->started(*funcs[i]);
+	}
+	analyzers[i]->Analyze(fparams, &funcs[i]->getEntryBlock(),
+			      abs_dom_assumptions, lin_csts_assumptions, res);
+	if (governor) {
+	  governor->release(ticket);
+	}
+	analyzed[i] = true;
+	if (progress) {
+	  progress->finished(*funcs[i]);
+	}
+	if (!deterministic) {
+	  report(i);
+	  continue;
+	}
+	std::lock_guard<std::mutex> lock(report_mutex);
+	done[i] = true;
+	while (next_report < funcs.size() && done[next_report] && !stop) {
+	  report(next_report++);
+	}
+      }
+    };
+
+    num_threads = std::min(num_threads, (unsigned) funcs.size());
+    CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Analyzing " << funcs.size()
+		    << " functions with " << num_threads << " threads\n";);
+    // -- the analyses create variables (e.g., the ghost variables of
+    //    the domains) through the shared factory
+    variable_factory_t &vfac = man.get_var_factory();
+    bool thread_safe = vfac.is_thread_safe();
+    vfac.set_thread_safe(thread_safe || num_threads > 1);
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads);
+    for (unsigned i = 0; i < num_threads; ++i) {
+      workers.emplace_back([&worker, i]() {
+	  Numa::pin_worker(i);
+	  worker();
+	});
+    }
+    for (auto &t: workers) {
+      t.join();
+    }
+    vfac.set_thread_safe(thread_safe);
+
+    // -- merge results following the order of the module so that the
+    //    output is deterministic.
+    for (unsigned i = 0; i < num_merged; ++i) {
+      if (analyzed[i]) {
+	stats.push_back(analyzers[i]->get_stats());
+      }
+      if (check_indexes[i]) {
+	results.check_index->add(*check_indexes[i]);
+      }
+    }
+    for (unsigned i = 0; i < num_merged; ++i) {
+      FunctionResults &fres = func_results[i];
+      for (auto &kv: fres.premap) {
+	update(results.premap, *kv.first, kv.second);
+      }
+      for (auto &kv: fres.postmap) {
+	update(results.postmap, *kv.first, kv.second);
+      }
+      if (results.lazy_invariants) {
+	results.lazy_invariants->insert(fres.lazy_invariants.begin(),
+					fres.lazy_invariants.end());
+      }
+      results.infeasible_edges.insert(fres.infeasible_edges);
+      results.checksdb += fres.checksdb;
+    }
+  }
+  
+  /**
+   * Parameters given by the command line options
+   **/
+  CrabBuilderParams getCrabBuilderParamsFromOptions() {
+    CrabBuilderParams params(CrabTrackLev, CrabCFGSimplify, true,
+			     CrabEnableUniqueScalars, CrabMemShadows, 
+			     CrabIncludeHavoc, CrabUseArraySmashing,
+			     CrabEnableBignums, CrabPrintCFG);
+    params.adaptive_precision = CrabTrackAdaptive;
+    params.cfg_report = CrabCfgReport;
+    params.native_select = CrabNativeSelect;
+    params.warning_examples = CrabBuilderWarningExamples;
+    params.region_memory_ssa = CrabMemSSARegions;
+    params.promote_local_regions = CrabPromoteLocalRegions;
+    params.forget_dead_arrays = CrabForgetDeadArrays;
+    params.array_expand_max_elems = CrabArrayExpandMaxElems;
+    params.accelerate_loops = CrabAccelerateLoops;
+    params.hoist_loop_havocs = CrabHoistLoopHavocs;
+    params.null_checks = (CrabCheck == assert_check_kind_t::NULLITY);
+    if (params.null_checks && params.precision_level == crab::cfg::NUM) {
+      CLAM_WARNING("--crab-check=null needs --crab-track=ptr or --crab-track=arr");
+    }
+    params.block_threads = CrabCfgBlockThreads;
+    params.deterministic = CrabDeterministic;
+    params.function_var_scopes = CrabFunctionVarScopes;
+    return params;
+  }
+
+  // Key of the heap snapshot of M for the current heap options
+  static std::string getHeapSnapshotKey(const Module &M) {
+    std::string str;
+    raw_string_ostream o(str);
+    o << (int) CrabHeapAnalysis.getValue() << " " << CrabUseArraySmashing << " "
+      << CrabDsaDisambiguateUnknown << " " << CrabDsaDisambiguatePtrCast << " "
+      << CrabDsaDisambiguateExternal;
+    return SnapshotHeapAbstraction::getKey(M, o.str());
+  }
+
+#ifdef LLVM_ON_UNIX
+  enum heap_budget_status_t { HEAP_WITHIN_BUDGET, HEAP_OUT_OF_TIME, HEAP_FAILED };
+
+  /* Run mk_heap in a child process that records the regions of the
+     heap abstraction in a snapshot. If the child finishes within
+     budget seconds then snapshot is the one it recorded. */
+  static heap_budget_status_t
+  runHeapAnalysisInChild(const Module &M, unsigned budget,
+			 const std::function<std::unique_ptr<HeapAbstraction>()> &mk_heap,
+			 std::unique_ptr<SnapshotHeapAbstraction> &snapshot) {
+    SmallString<128> file;
+    int fd;
+    if (std::error_code ec = sys::fs::createTemporaryFile("clam-heap", "snapshot", fd, file)) {
+      CLAM_WARNING("cannot create temporary file: " << ec.message());
+      return HEAP_FAILED;
+    }
+    close(fd);
+    std::string key = getHeapSnapshotKey(M);
+    llvm::outs().flush();
+    llvm::errs().flush();
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+      sys::fs::remove(file);
+      return HEAP_FAILED;
+    }
+    if (pid == 0) {
+      std::unique_ptr<HeapAbstraction> mem = mk_heap();
+      bool ok = SnapshotHeapAbstraction::record(M, *mem)->write(file.str(), key);
+      _exit(ok ? 0 : 1);
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(budget);
+    int status;
+    while (waitpid(pid, &status, WNOHANG) != pid) {
+      if (std::chrono::steady_clock::now() > deadline) {
+	kill(pid, SIGKILL);
+	waitpid(pid, &status, 0);
+	sys::fs::remove(file);
+	return HEAP_OUT_OF_TIME;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+      snapshot = SnapshotHeapAbstraction::load(file.str(), key, M);
+    }
+    sys::fs::remove(file);
+    return snapshot ? HEAP_WITHIN_BUDGET : HEAP_FAILED;
+  }
+#endif
+
+  namespace {
+  /* Direct call edges between the trackable functions of a module */
+  struct ModuleCallEdges {
+    typedef std::vector<const Function*> func_vector_t;
+    DenseMap<const Function*, func_vector_t> callers, callees;
+    // functions that call directly the assert or error functions
+    std::set<const Function*> checked;
+    // number of calls to the assert or error functions
+    DenseMap<const Function*, unsigned> num_checks;
+    // address-taken functions can be the target of any indirect call
+    func_vector_t addr_taken;
+    std::set<const Function*> has_indirect_calls;
+
+    ModuleCallEdges(const Module &M) {
+      for (auto const &F: M) {
+	if (!isTrackable(F)) continue;
+	if (F.hasAddressTaken()) {
+	  addr_taken.push_back(&F);
+	}
+	for (auto const &I: instructions(F)) {
+	  ImmutableCallSite CS(&I);
+	  if (!CS) continue;
+	  const Function *callee =
+	    dyn_cast<Function>(CS.getCalledValue()->stripPointerCasts());
+	  if (!callee) {
+	    has_indirect_calls.insert(&F);
+	  } else if (isAssertFn(*callee) || isErrorFn(*callee)) {
+	    checked.insert(&F);
+	    num_checks[&F]++;
+	  } else if (isTrackable(*callee)) {
+	    callers[callee].push_back(&F);
+	    callees[&F].push_back(callee);
+	  }
+	}
+      }
+    }
+
+    // Add to res all the functions reachable from it through edges
+    // and the extra successors added by extra.
+    static void closure(std::set<const Function*> &res,
+			DenseMap<const Function*, func_vector_t> &edges,
+			std::function<void(const Function*, func_vector_t&)> extra) {
+      std::vector<const Function*> worklist(res.begin(), res.end());
+      while (!worklist.empty()) {
+	const Function *F = worklist.back();
+	worklist.pop_back();
+	func_vector_t succs = edges[F];
+	extra(F, succs);
+	for (const Function *G: succs) {
+	  if (res.insert(G).second) {
+	    worklist.push_back(G);
+	  }
+	}
+      }
+    }
+
+    // Add to res all the functions that can be called from it
+    void callees_closure(std::set<const Function*> &res) {
+      closure(res, callees, [this](const Function *F, func_vector_t &succs) {
+	  if (has_indirect_calls.count(F)) {
+	    succs.insert(succs.end(), addr_taken.begin(), addr_taken.end());
+	  }
+	});
+    }
+
+    // Add to res all the functions that can call it
+    void callers_closure(std::set<const Function*> &res) {
+      closure(res, callers, [this](const Function *F, func_vector_t &succs) {
+	  // an address-taken function can be called from any function
+	  // with indirect calls
+	  if (F->hasAddressTaken()) {
+	    succs.insert(succs.end(), has_indirect_calls.begin(), has_indirect_calls.end());
+	  }
+	});
+    }
+
+    // Add to res the functions that can call it through at most
+    // depth calls
+    void callers_closure(std::set<const Function*> &res, unsigned depth) {
+      func_vector_t level(res.begin(), res.end());
+      for (unsigned d = 0; d < depth && !level.empty(); ++d) {
+	func_vector_t next;
+	for (const Function *F: level) {
+	  func_vector_t preds = callers[F];
+	  if (F->hasAddressTaken()) {
+	    preds.insert(preds.end(), has_indirect_calls.begin(), has_indirect_calls.end());
+	  }
+	  for (const Function *G: preds) {
+	    if (res.insert(G).second) {
+	      next.push_back(G);
+	    }
+	  }
+	}
+	level.swap(next);
+      }
+    }
+  };
+  } // end namespace
+
+  /**
+   * Functions that can influence the checks of M. 
+   *  
+   * In intra-procedural mode, each function is analyzed separately so
+   * only the functions with checks matter. In inter-procedural mode,
+   * the callers of those functions provide their calling contexts
+   * and all the functions reachable from the callers can modify
+   * their state, so we keep the callers and all their callees.
+   **/
+  static std::set<const Function*> getConeOfChecks(ModuleCallEdges &edges, bool inter) {
+    if (!inter) {
+      return edges.checked;
+    }
+    // -- callers of the functions with checks
+    std::set<const Function*> res = edges.checked;
+    edges.callers_closure(res);
+    // -- and all their callees
+    edges.callees_closure(res);
+    return res;
+  }
+
+  /**
+   * Functions of M reachable from the roots (by default, main). 
+   **/
+  static std::set<const Function*> getReachableFromRoots(const Module &M,
+							 ModuleCallEdges &edges) {
+    std::set<const Function*> res;
+    std::vector<std::string> roots(CrabRoots.begin(), CrabRoots.end());
+    if (roots.empty()) {
+      roots.push_back("main");
+    }
+    for (auto &name: roots) {
+      const Function *F = M.getFunction(name);
+      if (!F || !isTrackable(*F)) {
+	CLAM_WARNING("root function " << name << " not found or without body");
+	continue;
+      }
+      res.insert(F);
+    }
+    edges.callees_closure(res);
+    return res;
+  }
+
+  /**
+   * Trackable functions of M whose CFG does not depend on the heap
+   * abstraction: they do not access memory, none of their values is
+   * a pointer so there are no regions to ask for, and they only call
+   * external functions or other memory-free functions.
+   **/
+  static std::vector<const Function*> getMemoryFreeFunctions(const Module &M) {
+    DenseMap<const Function*, std::vector<const Function*>> callees;
+    std::set<const Function*> res;
+    for (auto const &F: M) {
+      if (!isTrackable(F)) continue;
+      bool memfree = true;
+      for (auto const &I: instructions(F)) {
+	ImmutableCallSite CS(&I);
+	const Function *callee =
+	  CS ? dyn_cast<Function>(CS.getCalledValue()) : nullptr;
+	if (CS && !callee) {
+	  memfree = false;
+	} else if (!CS && I.mayReadOrWriteMemory()) {
+	  memfree = false;
+	} else if (I.getType()->isPointerTy()) {
+	  memfree = false;
+	} else {
+	  for (const Value *op: I.operand_values()) {
+	    if (op != callee && op->getType()->isPointerTy()) {
+	      memfree = false;
+	      break;
+	    }
+	  }
+	}
+	if (!memfree) break;
+	if (callee && !callee->isDeclaration()) {
+	  callees[&F].push_back(callee);
+	}
+      }
+      if (memfree) {
+	res.insert(&F);
+      }
+    }
+    // -- remove the functions that call a function that uses memory
+    bool change = true;
+    while (change) {
+      change = false;
+      for (auto it = res.begin(); it != res.end();) {
+	auto &succs = callees[*it];
+	if (std::any_of(succs.begin(), succs.end(),
+			[&res](const Function *G) { return res.count(G) == 0; })) {
+	  it = res.erase(it);
+	  change = true;
+	} else {
+	  ++it;
+	}
+      }
+    }
+    std::vector<const Function*> funcs;
+    for (auto const &F: M) {
+      if (res.count(&F)) {
+	funcs.push_back(&F);
+      }
+    }
+    return funcs;
+  }
+  
+  AnalysisParams getAnalysisParamsFromOptions() {
+    AnalysisParams params;
+    // -- with several domains (sweep) this is the first one
+    params.dom = ClamDomain.empty() ? DEFAULT_DOMAIN : ClamDomain.front();
+#ifdef INSTRUMENT_DOMAINS
+    if (CrabDomInstrument) {
+      params.dom_modifiers |= DOM_INSTRUMENTED;
+    }
+#endif
+#ifndef TOP_DOWN_INTER_ANALYSIS            
+    params.sum_dom = CrabSummDomain;
+#endif     
+    params.run_backward = CrabBackward;
+    params.backward_unproven_only = CrabBackwardUnprovenOnly;
+    params.run_inter = CrabInter;
+#ifdef TOP_DOWN_INTER_ANALYSIS            
+    params.max_calling_contexts = CrabInterMaxSummaries;
+    params.reuse_subsumed_contexts = CrabInterReuseSubsumedContexts;
+    params.inter_multi_root = CrabInterMultiRoot;
+    params.inter_merge_checks = CrabInterMergeChecks;
+#endif     
+    params.run_liveness = CrabLive;
+    params.relational_threshold = CrabRelationalThreshold;
+    params.per_function_dom = CrabPerFunctionDomain;
+    params.pack_size = CrabPackSize;
+    params.widening_delay = CrabWideningDelay;
+    params.auto_widening_delay = CrabWideningDelayAuto;
+    params.narrowing_iters = CrabNarrowingIters;
+    params.widening_jumpset = CrabWideningJumpSet;
+    params.auto_widening_jumpset = CrabWideningJumpSetAuto;
+    params.fixpoint = CrabFixpoint;
+    params.max_disjuncts = CrabMaxDisjuncts;
+    params.array_max_smashable_cells = CrabArrayMaxSmashableCells;
+    params.array_max_size = CrabArrayMaxSize;
+    params.auto_array_limits = CrabArrayAutoLimits;
+    params.estimate_cost = CrabEstimateCost;
+    params.max_estimated_cost = CrabMaxEstimatedCost;
+    params.profile_fixpoint = CrabProfileFixpoint || !CrabProfileFixpointFolded.empty();
+    params.staged = CrabStaged;
+    params.stats = CrabStats;
+    params.stats_json = !CrabStatsJson.empty();
+    params.print_invars = CrabPrintAns || CrabPrintAnsCompact;
+    params.print_invars_compact = CrabPrintAnsCompact;
+    params.print_unjustified_assumptions = CrabPrintUnjustifiedAssumptions;
+    params.print_summaries = CrabPrintSumm;
+    params.store_invariants = CrabStoreInvariants;
+    params.lazy_invariants = CrabLazyInvariants;
+    params.head_invariants = CrabHeadInvariants;
+    params.head_invariants_cache_size = CrabHeadInvariantsCacheSize;
+    params.delta_invariants = CrabDeltaInvariants;
+    params.intern_invariants = CrabInternInvariants;
+    params.keep_shadow_vars = CrabKeepShadows;
+    params.check = CrabCheck;
+    params.check_verbose = CrabCheckVerbose;
+    params.check_early_stop = CrabCheckEarlyStop;
+    params.check_early_stop_skip_invariants = CrabCheckEarlyStopSkipInvariants;
+    params.check_threads = CrabCheckThreads;
+    params.deterministic = CrabDeterministic;
+    params.cache_dir = CrabCacheDir;
+    if (params.cache_dir.empty()) {
+      // -- the functions analyzed before a restart are restored from
+      //    the cache (see Checkpoint)
+      params.cache_dir = CrabCheckpointDir;
+    }
+    params.warm_start = CrabWarmStart;
+    if (params.warm_start && params.cache_dir.empty()) {
+      CLAM_WARNING("--crab-warm-start is ignored without --crab-cache-dir");
+      params.warm_start = false;
+    }
+    params.fun_timeout = CrabFunTimeout;
+    params.fun_mem_limit = CrabFunMemLimit;
+    params.fun_rss_limit = CrabFunRssLimit;
+    if (!CrabDowngradeChain.empty()) {
+      params.downgrade_chain.assign(CrabDowngradeChain.begin(),
+				    CrabDowngradeChain.end());
+    }
+    params.inter_deadline = CrabInterDeadline;
+    return params;
+  }
+
+  // Override the options that make the cost of the analysis
+  // non-linear in the size of the CFGs (--crab-triage). The
+  // intervals have no relations and widening at the first iteration
+  // without narrowing visits each loop a bounded number of times.
+  static void applyTriageOptions() {
+    if (CrabInter) {
+      CLAM_WARNING("--crab-inter is ignored with --crab-triage: "
+		   "the calls are analyzed with the imported summaries, if any");
+      CrabInter = false;
+    }
+    if (ClamDomain.size() > 1 ||
+	(ClamDomain.size() == 1 && ClamDomain.front() != INTERVALS)) {
+      CLAM_WARNING("--crab-dom is ignored with --crab-triage");
+    }
+    if (!CrabDomConfig.empty()) {
+      CLAM_WARNING("--crab-dom-config is ignored with --crab-triage");
+    }
+    if (CrabBackward || CrabStaged || CrabWideningDelayAuto ||
+	CrabWideningJumpSetAuto) {
+      CLAM_WARNING("--crab-backward, --crab-staged and the automatic widening "
+		   "options are ignored with --crab-triage");
+    }
+    ClamDomain.clear();
+    ClamDomain.push_back(INTERVALS);
+    CrabDomConfig = "";
+    CrabBackward = false;
+    CrabStaged = false;
+    CrabWideningDelay = 0;
+    CrabWideningDelayAuto = false;
+    CrabNarrowingIters = 0;
+    CrabWideningJumpSet = 0;
+    CrabWideningJumpSetAuto = false;
+    CrabStoreInvariants = false;
+    CrabLazyInvariants = false;
+    if (CrabCheck == assert_check_kind_t::NOCHECKS) {
+      CrabCheck = assert_check_kind_t::ASSERTION;
+    }
+  }
+
+  /**
+   * Begin ClamPass methods
+   **/
+  ClamPass::ClamPass():
+    llvm::ModulePass(ID),
+    m_shadow_free_invs(new ShadowFreeInvariantCache()),
+    m_cfg_builder_man(nullptr) {}
+  
+  void ClamPass::releaseMemory() {
+    m_pre_map.clear(); 
+    m_post_map.clear();
+    m_lazy_invs.clear();
+    m_shadow_free_invs->clear();
+    m_checks_db.clear();
+    m_fun_stats.clear();
+    m_released_funcs.clear();
+    m_inv_store.reset();
+    m_check_index.reset();
+  }
+  
+  bool ClamPass::runOnModule(Module &M) {
+
+    /// Translate the module to Crab CFGs
+
+    if (CrabTriage) {
+      applyTriageOptions();
+    }
     
-    CrabBuilderParams params(CrabTrackLev, CrabCFGSimplify, true,
-			     CrabEnableUniqueScalars, CrabMemShadows, 
-			     CrabIncludeHavoc, CrabUseArraySmashing,
-			     CrabEnableBignums, CrabPrintCFG);
+    CrabBuilderParams params = getCrabBuilderParamsFromOptions();
+
+    // -- the printed CFGs and invariants go to the sink until the end
+    //    of the pass
+    std::unique_ptr<OutputSink> output;
+    if (!CrabOutputFile.empty()) {
+      output = OutputSink::open(CrabOutputFile);
+    }
+    Numa::set_enabled(CrabThreadsNuma && CrabThreads > 1);
+
+    // -- the bodies of the functions are read on demand (see
+    //    set_function_hooks) so nothing can look at the whole module
+    bool lazy_functions = (bool) m_before_fun;
+    if (lazy_functions) {
+      if (CrabInter || params.precision_level != crab::cfg::NUM) {
+	CLAM_ERROR("the functions can only be read on demand by the "
+		   "intra-procedural analysis with --crab-track=num");
+      }
+      if (!CrabInvariantsDb.empty() || !CrabExportSummaries.empty() ||
+	  !CrabDumpCfg.empty() || CrabSliceToChecks || CrabReachableOnly ||
+	  ClamDomain.size() > 1) {
+	CLAM_ERROR("--crab-invariants-db, --crab-export-summaries, --crab-dump-cfg, "
+		   "--crab-slice-to-checks, --crab-reachable-only and several "
+		   "domains in --crab-dom need all the functions at once");
+      }
+      if (CrabThreads > 1 || CrabPipelineHeap || CrabEstimateCost) {
+	CLAM_WARNING("--crab-threads, --crab-pipeline-heap and --crab-estimate-cost "
+		     "are ignored if the functions are read on demand");
+	CrabThreads = 1;
+	CrabPipelineHeap = false;
+	CrabEstimateCost = false;
+      }
+    }
     
     auto &tli = getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
 
+    // -- the external models and the summaries must be set before
+    //    any CFG is built
+    auto loadModelsAndSummaries = [&]() {
+      if (!CrabExternalModels.empty()) {
+	std::string err;
+	if (!m_cfg_builder_man->get_callee_table().readModels(CrabExternalModels, err)) {
+	  CLAM_ERROR(err);
+	}
+      }
+      m_summaries.reset();
+      if (!CrabImportSummaries.empty()) {
+	m_summaries.reset(new FunctionSummaries());
+	std::string err;
+	if (!m_summaries->readFile(CrabImportSummaries, err)) {
+	  CLAM_ERROR(err);
+	}
+	m_summaries->match(M);
+	m_cfg_builder_man->set_function_summaries(m_summaries.get());
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Loaded "
+			<< m_summaries->size() << " summaries from "
+			<< CrabImportSummaries << "\n";);
+      }
+    };
+
+    // -- the CFGs of the functions that do not use memory are the
+    //    same with any heap abstraction so they are built by another
+    //    thread while the heap analysis runs. The manager starts
+    //    with no heap abstraction and gets it once it is ready.
+    bool pipeline_heap = CrabPipelineHeap;
+    if (pipeline_heap && CrabMemShadows) {
+      CLAM_WARNING("--crab-pipeline-heap is ignored with --crab-mem-shadows");
+      pipeline_heap = false;
+    }
+    if (pipeline_heap && CrabDeterministic) {
+      // -- the CFGs would not be built in module order
+      CLAM_WARNING("--crab-pipeline-heap is ignored with --crab-deterministic");
+      pipeline_heap = false;
+    }
+    std::vector<const Function*> memfree_funcs;
+    std::thread pipeline;
+    if (pipeline_heap) {
+      std::unique_ptr<HeapAbstraction> mem(new DummyHeapAbstraction());
+      m_cfg_builder_man.reset(new CrabBuilderManager(params, tli, std::move(mem)));
+      loadModelsAndSummaries();
+      memfree_funcs = getMemoryFreeFunctions(M);
+      // -- the heap analysis also reads the module
+      m_cfg_builder_man->set_concurrent(M);
+      unsigned num_threads = std::max((unsigned) CrabThreads, 1U);
+      pipeline = std::thread([this, &memfree_funcs, num_threads]() {
+	  m_cfg_builder_man->mk_cfg_builders(memfree_funcs, num_threads);
+	});
+    }
+
     /// Create the CFG builder manager
     if (!CrabMemShadows) {
       std::unique_ptr<HeapAbstraction> mem(new DummyHeapAbstraction());    
+      // -- the numerical translation never asks the heap abstraction
+      //    for regions so the heap analysis is not run
+      heap_analysis_t heap_analysis = CrabHeapAnalysis;
+      if (params.precision_level == crab::cfg::NUM &&
+	  heap_analysis != heap_analysis_t::NONE) {
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Skipped heap analysis "
+			<< "because only numerical variables are tracked\n";);
+	heap_analysis = heap_analysis_t::NONE;
+      }
+      bool use_snapshot = (CrabHeapSnapshot != "" &&
+			   heap_analysis != heap_analysis_t::NONE);
+      std::string snapshot_key;
+      if (use_snapshot) {
+	snapshot_key = getHeapSnapshotKey(M);
+	if (auto snapshot = SnapshotHeapAbstraction::load(CrabHeapSnapshot,
+							  snapshot_key, M)) {
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Loaded heap snapshot "
+			  << CrabHeapSnapshot << "\n";);
+	  mem = std::move(snapshot);
+	}
+      }
       // If CrabMemShadows is enabled then we don't run any heap
       // analysis.
-      switch(CrabHeapAnalysis) {
-      case heap_analysis_t::LLVM_DSA:
-        #ifdef HAVE_DSA
-	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Started llvm-dsa analysis\n";);
-	mem.reset
-	  (new LlvmDsaHeapAbstraction(M,&getAnalysis<SteensgaardDataStructures>(), 
-				      CrabDsaDisambiguateUnknown,
-				      CrabDsaDisambiguatePtrCast,
-				      CrabDsaDisambiguateExternal));
-	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Finished llvm-dsa analysis\n";);      
-	break;
-        #else
-	CLAM_WARNING("llvm-dsa heap analysis is not available. Running sea-dsa");
-	// execute CI_SEA_DSA
-        #endif      
-      case heap_analysis_t::CI_SEA_DSA:
-      case heap_analysis_t::CS_SEA_DSA: {
-	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Started sea-dsa analysis\n";);
-	CallGraph& cg = getAnalysis<CallGraphWrapperPass>().getCallGraph();      
-	const DataLayout& dl = M.getDataLayout();
-	sea_dsa::AllocWrapInfo* allocWrapInfo = &getAnalysis<sea_dsa::AllocWrapInfo>();      
-	mem.reset
-	  (new LegacySeaDsaHeapAbstraction(M, cg, dl, tli, *allocWrapInfo,
-					   (CrabHeapAnalysis == heap_analysis_t::CS_SEA_DSA),
-					   CrabUseArraySmashing,
-					   CrabDsaDisambiguateUnknown,
-					   CrabDsaDisambiguatePtrCast,
-					   CrabDsaDisambiguateExternal));
-	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Finished sea-dsa analysis\n";);      
-	break;
-      }
-      case heap_analysis_t::NONE:
-      default:
-	CLAM_WARNING("running clam without heap analysis");
-      }
-      m_cfg_builder_man.reset(new CrabBuilderManager(params, tli, std::move(mem))); 
+      if (mem->getClassId() != HeapAbstraction::ClassId::SNAPSHOT) {
+	switch(heap_analysis) {
+	case heap_analysis_t::LLVM_DSA:
+	  #ifdef HAVE_DSA
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Started llvm-dsa analysis\n";);
+	  mem.reset
+	    (new LlvmDsaHeapAbstraction(M,&getAnalysis<SteensgaardDataStructures>(), 
+					CrabDsaDisambiguateUnknown,
+					CrabDsaDisambiguatePtrCast,
+					CrabDsaDisambiguateExternal));
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Finished llvm-dsa analysis\n";);      
+	  break;
+	  #else
+	  CLAM_WARNING("llvm-dsa heap analysis is not available. Running sea-dsa");
+	  // execute CI_SEA_DSA
+	  #endif      
+	case heap_analysis_t::CI_SEA_DSA:
+	case heap_analysis_t::CS_SEA_DSA: {
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Started sea-dsa analysis\n";);
+	  CallGraph& cg = getAnalysis<CallGraphWrapperPass>().getCallGraph();      
+	  const DataLayout& dl = M.getDataLayout();
+	  sea_dsa::AllocWrapInfo* allocWrapInfo = &getAnalysis<sea_dsa::AllocWrapInfo>();      
+	  auto mkSeaDsa = [&](bool is_cs) {
+	    return std::unique_ptr<HeapAbstraction>
+	      (new LegacySeaDsaHeapAbstraction(M, cg, dl, tli, *allocWrapInfo, is_cs,
+					       CrabUseArraySmashing,
+					       CrabDsaDisambiguateUnknown,
+					       CrabDsaDisambiguatePtrCast,
+					       CrabDsaDisambiguateExternal,
+					       CrabThreads));
+	  };
+	  bool is_cs = (CrabHeapAnalysis == heap_analysis_t::CS_SEA_DSA);
+#ifdef LLVM_ON_UNIX
+	  if (is_cs && CrabHeapAnalysisBudget > 0) {
+	    // -- sea-dsa cannot be stopped so the context-sensitive
+	    //    analysis runs in a child that passes its regions back
+	    //    through a snapshot
+	    std::unique_ptr<SnapshotHeapAbstraction> snapshot;
+	    switch (runHeapAnalysisInChild(M, CrabHeapAnalysisBudget,
+					   [&]() { return mkSeaDsa(true); }, snapshot)) {
+	    case HEAP_WITHIN_BUDGET:
+	      mem = std::move(snapshot);
+	      break;
+	    case HEAP_OUT_OF_TIME:
+	      CLAM_WARNING("cs-sea-dsa did not finish in " << CrabHeapAnalysisBudget
+			   << " seconds. Running ci-sea-dsa");
+	      ClamStats::count("HeapAnalysis.FallbackToCI");
+	      mem = mkSeaDsa(false);
+	      // -- the snapshot would be taken as the one of cs-sea-dsa
+	      use_snapshot = false;
+	      break;
+	    case HEAP_FAILED:
+	      CLAM_WARNING("cannot run cs-sea-dsa within budget. Running without budget.");
+	      mem = mkSeaDsa(true);
+	      break;
+	    }
+	  } else
+#endif
+	  mem = mkSeaDsa(is_cs);
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Finished sea-dsa analysis\n";);      
+	  break;
+	}
+	case heap_analysis_t::NONE:
+	default:
+	  if (CrabHeapAnalysis == heap_analysis_t::NONE) {
+	    CLAM_WARNING("running clam without heap analysis");
+	  }
+	}
+	if (use_snapshot) {
+	  // Replay the snapshot also in this run so that it behaves as
+	  // the runs that load it.
+	  std::unique_ptr<SnapshotHeapAbstraction> snapshot =
+	    SnapshotHeapAbstraction::record(M, *mem);
+	  if (snapshot->write(CrabHeapSnapshot, snapshot_key)) {
+	    CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Wrote heap snapshot "
+			    << CrabHeapSnapshot << "\n";);
+	  }
+	  mem = std::move(snapshot);
+	}
+      }
+      if (pipeline_heap) {
+	pipeline.join();
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Built "
+			<< memfree_funcs.size() << " CFGs of functions without "
+			<< "memory during the heap analysis\n";);
+	ClamStats::count("CFG.Pipeline.MemoryFree", memfree_funcs.size());
+	m_cfg_builder_man->set_heap_abstraction(std::move(mem));
+      } else {
+	m_cfg_builder_man.reset(new CrabBuilderManager(params, tli, std::move(mem)));
+      }
     } else {
       if (auto smp = getAnalysisIfAvailable<sea_dsa::ShadowMemPass>()) {
 	m_cfg_builder_man.reset(new CrabBuilderManager(params, tli, smp->getShadowMem()));      
@@ -1366,66 +1961,507 @@ namespace clam {
 	  CLAM_WARNING("getAnalysisIfAvailable<ShadowMemPass> returned null");
       }
     }
+
+    if (!pipeline_heap) {
+      loadModelsAndSummaries();
+    }
         
     /// Run the analysis 
 						  
-    m_params.dom = ClamDomain;
-#ifndef TOP_DOWN_INTER_ANALYSIS            
-    m_params.sum_dom = CrabSummDomain;
-#endif     
-    m_params.run_backward = CrabBackward;
-    m_params.run_inter = CrabInter;
-#ifdef TOP_DOWN_INTER_ANALYSIS            
-    m_params.max_calling_contexts = CrabInterMaxSummaries;
-#endif     
-    m_params.run_liveness = CrabLive;
-    m_params.relational_threshold = CrabRelationalThreshold;
-    m_params.widening_delay = CrabWideningDelay;
-    m_params.narrowing_iters = CrabNarrowingIters;
-    m_params.widening_jumpset = CrabWideningJumpSet;
-    m_params.stats = CrabStats;
-    m_params.print_invars = CrabPrintAns;
-    m_params.print_unjustified_assumptions = CrabPrintUnjustifiedAssumptions;
-    m_params.print_summaries = CrabPrintSumm;
-    m_params.store_invariants = CrabStoreInvariants;
-    m_params.keep_shadow_vars = CrabKeepShadows;
-    m_params.check = CrabCheck;
-    m_params.check_verbose = CrabCheckVerbose;
+    m_params = getAnalysisParamsFromOptions();
+    m_fun_config.reset(new FunctionAnalysisConfig(parseDomainName));
+    if (!CrabDomConfig.empty()) {
+      std::string err;
+      if (!m_fun_config->readFile(CrabDomConfig, err)) {
+	CLAM_ERROR(err);
+      }
+    }
+    if (!CrabTriage) {
+      // -- the annotations can choose any domain
+      m_fun_config->readAnnotations(M);
+    }
             
-    unsigned num_analyzed_funcs = 0;
+    std::set<const Function*> slice;
+    bool use_slice = false;
+    ModuleCallEdges edges(M);
+    if (CrabSliceToChecks) {
+      if (CrabCheck == assert_check_kind_t::NOCHECKS) {
+	CLAM_WARNING("--crab-slice-to-checks is ignored if --crab-check=none");
+      } else {
+	slice = getConeOfChecks(edges, CrabInter);
+	use_slice = true;
+      }
+    }
+    // -- the inter-procedural analysis starts from the roots so the
+    //    functions unreachable from them do not need a CFG. Modules
+    //    without roots (e.g., libraries) are analyzed entirely.
+    bool prune_unreachable = CrabReachableOnly;
+    bool multi_root = false;
+#ifdef TOP_DOWN_INTER_ANALYSIS
+    // -- the functions unreachable from main are roots of a library
+    multi_root = CrabInterMultiRoot;
+#endif
+    if (!prune_unreachable && CrabInter && CrabInterReachableOnly && !multi_root) {
+      const Function *main = M.getFunction("main");
+      prune_unreachable = !CrabRoots.empty() || (main && isTrackable(*main));
+    }
+    std::set<const Function*> reachable;
+    if (prune_unreachable) {
+      reachable = getReachableFromRoots(M, edges);
+    }
+    // -- only the functions whose source changed are analyzed. With
+    //    --crab-inter, their callers up to a depth give them their
+    //    calling contexts and their callees their summaries. Without,
+    //    the other functions reuse their last results (the results of
+    //    the inter-procedural analysis are not cached).
+    std::set<const Function*> changed;
+    bool use_changed = false, reuse_unchanged = false;
+    if (!CrabChangedLines.empty()) {
+      ChangedLines lines;
+      std::string err;
+      if (!lines.readFile(CrabChangedLines, err)) {
+	CLAM_ERROR(err);
+      }
+      if (!ChangedLines::hasDebugInfo(M)) {
+	CLAM_WARNING("--crab-changed-lines is ignored without debug information");
+      } else {
+	changed = lines.getChangedFunctions(M);
+	use_changed = true;
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Functions with changed lines:"
+			<< changed.size() << "\n";);
+	if (CrabInter) {
+	  edges.callers_closure(changed, CrabChangedCallersDepth);
+	  edges.callees_closure(changed);
+	} else if (!m_params.cache_dir.empty()) {
+	  reuse_unchanged = true;
+	}
+      }
+    }
+    // -- the functions outside the slice do not have invariants
+    // -- nor the functions with a summary
+    auto isTrackableOrLazy = [lazy_functions](const Function &F) {
+      return isTrackable(F) ||
+	(lazy_functions && F.isMaterializable() && !F.isVarArg());
+    };
+    auto isAnalyzed = [&](const Function &F) {
+      return isTrackableOrLazy(F) &&
+	(!m_summaries || !m_summaries->lookup(F)) &&
+	(!use_slice || slice.count(&F) > 0) &&
+	(!prune_unreachable || reachable.count(&F) > 0) &&
+	(!use_changed || reuse_unchanged || changed.count(&F) > 0);
+    };
+
+    std::vector<const Function*> funcs;
+    unsigned num_trackable_funcs = 0;
+    m_skipped_funcs.clear();
     for (auto &F : M) {
-      if (!isTrackable(F)) continue;
-      num_analyzed_funcs++;
+      if (!isTrackableOrLazy(F)) continue;
+      num_trackable_funcs++;
+      if (isAnalyzed(F)) {
+	funcs.push_back(&F);
+	if (reuse_unchanged && changed.count(&F) == 0) {
+	  m_fun_config->setReuseLatest(F);
+	}
+      } else if (prune_unreachable && reachable.count(&F) == 0) {
+	m_skipped_funcs.push_back(F.getName());
+      }
+    }
+    if (!CrabShard.empty()) {
+      StringRef k, n;
+      std::tie(k, n) = StringRef(CrabShard).split('/');
+      unsigned shard, num_shards;
+      if (k.getAsInteger(10, shard) || n.getAsInteger(10, num_shards) ||
+	  shard >= num_shards) {
+	CLAM_ERROR("--crab-shard expects K/N with 0 <= K < N");
+      }
+      if (CrabInter) {
+	// -- a component needs the summaries of its callees
+	CLAM_WARNING("--crab-shard is ignored with --crab-inter");
+      } else {
+	selectShard(funcs, shard, num_shards);
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Shard " << shard << "/"
+			<< num_shards << " has " << funcs.size()
+			<< " functions\n";);
+      }
+    }
+    unsigned num_analyzed_funcs = funcs.size();
+    if (CrabReachableOnly) {
+      // -- the functions with more checks per instruction first so
+      //    that the results on the checks are available sooner.
+      DenseMap<const Function*, double> density;
+      for (const Function *F : funcs) {
+	auto it = edges.num_checks.find(F);
+	if (it != edges.num_checks.end()) {
+	  density[F] = (double) it->second /
+	    (double) std::distance(inst_begin(F), inst_end(F));
+	}
+      }
+      std::stable_sort(funcs.begin(), funcs.end(),
+		       [&density](const Function *F1, const Function *F2) {
+			 return density.lookup(F1) > density.lookup(F2);
+		       });
     }
     
     CRAB_VERBOSE_IF(1,
 	     crab::get_msg_stream() << "Started clam\n"; 
              crab::get_msg_stream() << "Total number of analyzed functions:" 
-                           << num_analyzed_funcs << "\n";);
+                           << num_analyzed_funcs << "\n";
+	     if (use_slice || prune_unreachable || use_changed) {
+	       crab::get_msg_stream() << "Skipped functions:"
+				      << num_trackable_funcs - num_analyzed_funcs << "\n";
+	     }
+	     for (auto &name: m_skipped_funcs) {
+	       crab::get_msg_stream() << "  " << name << " is unreachable from the roots\n";
+	     });
+
+
+    if (CrabThreads > 1 && CrabStats) {
+      // Crab statistics (e.g., of the fixpoint iterator) are kept in
+      // process-wide counters that crab updates without a lock, so
+      // they cannot be updated by several workers. Clam's are per
+      // thread (see ClamStats).
+      CLAM_WARNING("--crab-threads is ignored if --crab-stats is enabled");
+      CrabThreads = 1;
+    }
 
+    if (CrabThreads > 1 &&
+	(CrabFunTimeout > 0 || CrabFunMemLimit > 0 || CrabFunRssLimit > 0)) {
+      // Budgets fork a process per function which is not safe if
+      // other threads are running.
+      CLAM_WARNING("--crab-fun-timeout, --crab-fun-mem-limit and "
+		   "--crab-fun-rss-limit are ignored if --crab-threads > 1");
+      m_params.fun_timeout = 0;
+      m_params.fun_mem_limit = 0;
+      m_params.fun_rss_limit = 0;
+    }
 
-    if (CrabInter){
-      InterClam_Impl inter_crab(M, *m_cfg_builder_man);
-      AnalysisResults results = { m_pre_map, m_post_map, m_infeasible_edges, m_checks_db};
-      /* -- empty assumptions */      
-      abs_dom_map_t abs_dom_assumptions;
-      lin_csts_map_t lin_csts_assumptions;      
-      inter_crab.Analyze(m_params, abs_dom_assumptions, lin_csts_assumptions, results);
-    } else {
-      unsigned fun_counter = 1;
-      for (auto &F : M) {
-	if (!CrabInter && isTrackable(F)) {
+    // -- the CFG of a function is released once it is analyzed so
+    //    the peak memory follows the largest function (plus the
+    //    literals of the globals and constants, which are shared by
+    //    all the CFGs and kept until the manager is destroyed)
+    bool release_cfgs = CrabReleaseCfgs || lazy_functions;
+    if (release_cfgs && (CrabInter || CrabThreads > 1)) {
+      CLAM_WARNING("--crab-release-cfgs is ignored with --crab-inter or "
+		   "--crab-threads > 1");
+      release_cfgs = false;
+    }
+    if (release_cfgs && m_params.lazy_invariants) {
+      // lazy invariants keep the CFG alive
+      CLAM_WARNING("--crab-lazy-invariants is ignored if --crab-release-cfgs");
+      m_params.lazy_invariants = false;
+    }
+    if (release_cfgs && m_params.head_invariants) {
+      // the other invariants are recomputed on the CFG so the head
+      // invariants would keep every CFG alive
+      CLAM_WARNING("--crab-head-invariants is ignored if --crab-release-cfgs");
+      m_params.head_invariants = false;
+    }
+    if (release_cfgs && m_params.delta_invariants) {
+      // the deltas are decoded on the CFG
+      CLAM_WARNING("--crab-delta-invariants is ignored if --crab-release-cfgs");
+      m_params.delta_invariants = false;
+    }
+    m_released_funcs.clear();
+
+    // -- the invariants of a function are moved to disk once it is
+    //    analyzed so only the invariants of one function are in memory
+    bool spill_invariants = !CrabSpillInvariants.empty();
+    if (spill_invariants && (CrabInter || CrabThreads > 1)) {
+      CLAM_WARNING("--crab-spill-invariants is ignored with --crab-inter or "
+		   "--crab-threads > 1");
+      spill_invariants = false;
+    }
+    if (spill_invariants && !m_params.store_invariants) {
+      CLAM_WARNING("--crab-spill-invariants is ignored if --crab-store-invariants=false");
+      spill_invariants = false;
+    }
+    if (spill_invariants) {
+      std::string err;
+      if (!InvariantStore::checkDirectory(CrabSpillInvariants, err)) {
+	CLAM_WARNING("--crab-spill-invariants is ignored: " << err);
+	spill_invariants = false;
+      }
+    }
+    if (spill_invariants && m_params.lazy_invariants) {
+      // lazy invariants are not stored in the maps
+      CLAM_WARNING("--crab-lazy-invariants is ignored if --crab-spill-invariants");
+      m_params.lazy_invariants = false;
+    }
+    if (spill_invariants && m_params.delta_invariants) {
+      CLAM_WARNING("--crab-delta-invariants is ignored if --crab-spill-invariants");
+      m_params.delta_invariants = false;
+    }
+    m_inv_store.reset();
+
+    // -- report the checks of each function as soon as it is analyzed
+    std::unique_ptr<CheckStream> check_stream;
+    bool stop_on_error = CrabStopOnError;
+    if ((!CrabCheckStream.empty() || stop_on_error) && !m_params.check) {
+      CLAM_WARNING("--crab-check-stream and --crab-stop-on-error are ignored "
+		   "without --crab-check");
+      stop_on_error = false;
+    } else if (!CrabCheckStream.empty()) {
+      check_stream = CheckStream::open(CrabCheckStream);
+    }
+    if (stop_on_error && CrabInter) {
+      CLAM_WARNING("--crab-stop-on-error is ignored with --crab-inter");
+      stop_on_error = false;
+    }
+#ifdef INSTRUMENT_DOMAINS
+    if (CrabDomInstrument && CrabInter) {
+      CLAM_WARNING("--crab-dom-instrument is ignored with --crab-inter");
+    }
+#endif
+
+    // -- index the checks by source location
+    bool check_index = !CrabCheckIndex.empty();
+    if (check_index && !m_params.check) {
+      CLAM_WARNING("--crab-check-index is ignored without --crab-check");
+      check_index = false;
+    } else if (check_index && CrabInter) {
+      CLAM_WARNING("--crab-check-index is ignored with --crab-inter");
+      check_index = false;
+    }
+    m_check_index.reset();
+
+    // -- report periodically the functions done and being analyzed
+    bool use_progress = !CrabProgressFile.empty();
+    if (use_progress && CrabInter) {
+      CLAM_WARNING("--crab-progress-file is ignored with --crab-inter");
+      use_progress = false;
+    }
+
+    // -- record the analyzed functions so that a restarted run skips them
+    bool use_checkpoint = !CrabCheckpointDir.empty();
+    if (use_checkpoint && CrabInter) {
+      CLAM_WARNING("--crab-checkpoint-dir is ignored with --crab-inter");
+      use_checkpoint = false;
+    }
+
+    // -- analyze all the functions with m_params. The CFGs are built
+    //    once by the builder manager and shared by all the runs.
+    auto analyzeModule = [&]() {
+      m_fun_stats.clear();
+      if (spill_invariants) {
+	m_inv_store.reset(new InvariantStore(CrabSpillInvariants,
+					     m_cfg_builder_man->get_var_factory()));
+      }
+      if (check_index) {
+	m_check_index.reset(new CheckIndexWriter());
+      }
+      std::unique_ptr<Checkpoint> checkpoint;
+      if (use_checkpoint) {
+	checkpoint = Checkpoint::open(CrabCheckpointDir,
+				      Checkpoint::getKey(M, funcs, m_params));
+	if (checkpoint && checkpoint->num_done() > 0) {
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Resuming from "
+			  << checkpoint->get_filename() << ": "
+			  << checkpoint->num_done() << " of " << funcs.size()
+			  << " functions already analyzed\n";);
+	}
+      }
+      DenseMap<const Function*, double> costs;
+      if (m_params.estimate_cost) {
+        std::vector<std::unique_ptr<AnalysisCost>> features;
+        estimateCosts(funcs, *m_cfg_builder_man, m_params, CrabThreads,
+		      m_fun_config.get(), true, features, costs);
+        printCosts(funcs, m_params, features, costs);
+      }
+      std::unique_ptr<ProgressReport> progress;
+      if (use_progress) {
+	progress.reset(new ProgressReport(CrabProgressFile, CrabProgressInterval,
+					  std::max((unsigned) CrabThreads, 1U),
+					  funcs, costs));
+      }
+      auto start = std::chrono::steady_clock::now();
+      if (CrabInter){
+        std::set<const Function*> analyzed(funcs.begin(), funcs.end());
+        InterClam_Impl inter_crab(M, *m_cfg_builder_man, CrabThreads,
+				  (use_slice || prune_unreachable || use_changed || m_summaries) ?
+				  &analyzed : nullptr);
+        inter_crab.set_function_config(m_fun_config.get());
+        AnalysisResults results = { m_pre_map, m_post_map, m_infeasible_edges, m_checks_db};
+        /* -- empty assumptions */      
+        abs_dom_map_t abs_dom_assumptions;
+        lin_csts_map_t lin_csts_assumptions;      
+        inter_crab.Analyze(m_params, abs_dom_assumptions, lin_csts_assumptions, results);
+        m_fun_stats = inter_crab.get_stats();
+	if (check_stream) {
+	  // -- the functions are analyzed together
+	  for (auto &fs: m_fun_stats) {
+	    if (const Function *F = M.getFunction(fs.name)) {
+	      check_stream->report(*F, fs);
+	    }
+	  }
+	}
+      } else if (CrabThreads > 1) {
+        AnalysisResults results = { m_pre_map, m_post_map, m_infeasible_edges, m_checks_db,
+				    &m_lazy_invs, m_check_index.get()};
+        parallelIntraAnalyze(funcs, *m_cfg_builder_man, m_params, CrabThreads,
+			     m_fun_config.get(),
+			     m_params.estimate_cost ? &costs : nullptr,
+			     results, m_fun_stats, check_stream.get(), checkpoint.get(),
+			     progress.get(), stop_on_error);
+      } else {
+	if (m_params.deterministic && !release_cfgs) {
+	  // -- all the CFGs are built before the first analysis as with
+	  //    several threads
+	  m_cfg_builder_man->mk_cfg_builders(funcs, 1);
+	}
+        unsigned fun_counter = 1;
+        for (const Function *F : funcs) {
+	  if (m_params.should_stop()) {
+	    CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Analysis cancelled before "
+			    << F->getName() << "\n";);
+	    ClamStats::count("Analysis.Cancelled");
+	    break;
+	  }
 	  CRAB_VERBOSE_IF(1,
 			  crab::get_msg_stream() << "###Function "
 			  << fun_counter << "/" << num_analyzed_funcs << "###\n";);
 	  ++fun_counter;
-	  runOnFunction(F); 
+	  if (progress) {
+	    progress->started(*F);
+	  }
+	  if (m_before_fun) {
+	    m_before_fun(const_cast<Function&>(*F));
+	  }
+	  runOnFunction(const_cast<Function&>(*F));
+	  if (progress) {
+	    progress->finished(*F);
+	  }
+	  const ClamFunctionStats &fs = m_fun_stats.back();
+	  bool stop = stop_on_error && fs.error_checks > 0;
+	  if (check_stream) {
+	    check_stream->report(*F, fs);
+	  }
+	  if (checkpoint) {
+	    checkpoint->completed(*F, fs);
+	  }
+	  if (m_inv_store) {
+	    m_inv_store->spill(*F, m_pre_map, m_post_map);
+	  }
+	  if (release_cfgs) {
+	    // -- the invariants of F keep the names of its scope alive
+	    //    (see IntraClam_Impl::Analyze)
+	    m_cfg_builder_man->invalidate(*F);
+	    m_released_funcs.insert(F);
+	  }
+	  if (m_after_fun) {
+	    dropResults(*F);
+	    m_after_fun(const_cast<Function&>(*F));
+	  }
+	  if (stop) {
+	    CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Stopped after the first "
+			    << "error in " << F->getName() << "\n";);
+	    if (check_stream) {
+	      check_stream->stopped(*F);
+	    }
+	    break;
+	  }
+        }
+	if (m_inv_store) {
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+			  << "Spilled the invariants of "
+			  << m_inv_store->num_functions() << " functions\n";);
 	}
       }
+      return std::chrono::duration<double>
+        (std::chrono::steady_clock::now() - start).count();
+    };
+
+    double total_time = 0;
+    if (ClamDomain.size() <= 1) {
+      total_time = analyzeModule();
+    } else {
+      // -- domain sweep: the results of the last domain are kept
+      std::vector<DomainSweepResult> sweep;
+      for (CrabDomain dom: ClamDomain) {
+	m_pre_map.clear();
+	m_post_map.clear();
+	m_lazy_invs.clear();
+	m_shadow_free_invs->clear();
+	m_infeasible_edges.clear();
+	m_checks_db.clear();
+	m_params.dom = dom;
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Started analysis with "
+			<< dom_to_str(dom) << "\n";);
+	DomainSweepResult res;
+	res.dom = dom;
+	res.time = analyzeModule();
+	res.safe = get_total_safe_checks();
+	res.error = get_total_error_checks();
+	res.warning = get_total_warning_checks();
+	sweep.push_back(res);
+	total_time += res.time;
+      }
+      printDomainSweep(sweep, llvm::outs());
+    }
+
+    if (::crab::CrabWarningFlag) {
+      m_cfg_builder_man->get_diagnostics().write(llvm::errs());
+    }
+
+    if (CrabTriage) {
+      // -- throughput of the triage: tracked by clam-bench.py --triage
+      uint64_t num_stmts = 0;
+      double analysis_time = 0;
+      for (auto const &fs: m_fun_stats) {
+	num_stmts += fs.num_stmts;
+	analysis_time += fs.analysis_time;
+      }
+      ClamStats::count("Triage.Statements", num_stmts);
+      ClamStats::add_time("Triage.AnalysisTime", analysis_time);
+      if (analysis_time > 0) {
+	ClamStats::count("Triage.StatementsPerSec", num_stmts / analysis_time);
+      }
     }
 
     if (CrabStats) {
       crab::CrabStats::PrintBrunch(crab::outs());
+      std::string clam_stats;
+      raw_string_ostream o(clam_stats);
+      ClamStats::PrintBrunch(o);
+      crab::outs() << o.str();
+    }
+
+    if (!CrabStatsJson.empty()) {
+      writeStatsJson(CrabStatsJson, total_time);
+    }
+
+    if (m_params.profile_fixpoint) {
+      if (CrabInter) {
+	CLAM_WARNING("--crab-profile-fixpoint only profiles the functions "
+		     "analyzed separately by the inter-procedural analysis");
+      }
+      printFixpointProfile(llvm::outs());
+      if (!CrabProfileFixpointFolded.empty()) {
+	writeFixpointProfileFolded(CrabProfileFixpointFolded);
+      }
+    }
+
+    if (!CrabInvariantsDb.empty()) {
+      if (!m_params.store_invariants) {
+	CLAM_WARNING("--crab-invariants-db is ignored if --crab-store-invariants=false");
+      } else {
+	writeInvariantDatabase(M, CrabInvariantsDb);
+      }
+    }
+    
+    if (m_check_index) {
+      m_check_index->write(CrabCheckIndex);
+    }
+
+    if (!CrabDumpCfg.empty()) {
+      writeCfgs(funcs, CrabDumpCfg);
+    }
+
+    if (!CrabExportSummaries.empty()) {
+      if (!m_params.store_invariants) {
+	CLAM_WARNING("--crab-export-summaries is ignored if --crab-store-invariants=false");
+      } else {
+	writeSummaries(M, CrabExportSummaries);
+      }
     }
     
     if (CrabCheck) {
@@ -1457,16 +2493,336 @@ namespace clam {
    return false;
   }
 
+  void ClamPass::dropResults(const Function &F) {
+    m_pre_map.erase_function(F);
+    m_post_map.erase_function(F);
+    m_lazy_invs.erase(&F);
+    m_shadow_free_invs->clear();
+    m_infeasible_edges.erase_if_source([&F](const BasicBlock *B) {
+	return B->getParent() == &F;
+      });
+  }
+
   bool ClamPass::runOnFunction(Function &F) {
     IntraClam_Impl intra_crab(F, *m_cfg_builder_man);
-    AnalysisResults results = { m_pre_map, m_post_map, m_infeasible_edges, m_checks_db};
+    AnalysisResults results = { m_pre_map, m_post_map, m_infeasible_edges, m_checks_db,
+				&m_lazy_invs, m_check_index.get()};
     /* -- empty assumptions */
     abs_dom_map_t abs_dom_assumptions;
     lin_csts_map_t lin_csts_assumptions;          
-    intra_crab.Analyze(m_params, &F.getEntryBlock(),
+    AnalysisParams fparams(m_params);
+    bool has_config = m_fun_config && m_fun_config->apply(F, fparams);
+    intra_crab.Analyze(has_config ? fparams : m_params, &F.getEntryBlock(),
 		       abs_dom_assumptions, lin_csts_assumptions, results);
+    m_fun_stats.push_back(intra_crab.get_stats());
     return false;
   }
+
+  void ClamPass::printDomainSweep(const std::vector<DomainSweepResult> &sweep,
+				  raw_ostream &o) const {
+    o << "\n************** DOMAIN SWEEP ****************\n";
+    o << format("%-24s %10s %8s %8s %8s %8s\n", "domain", "time(s)",
+		"safe", "error", "warning", "+safe");
+    for (auto &res: sweep) {
+      o << format("%-24s %10.3f %8u %8u %8u %+8d\n",
+		  dom_to_str(res.dom).c_str(), res.time, res.safe, res.error,
+		  res.warning, (int) res.safe - (int) sweep.front().safe);
+    }
+    o << "************** DOMAIN SWEEP END *************\n";
+  }
+
+  void ClamPass::printFixpointProfile(raw_ostream &o) const {
+    auto total = [](const ClamFunctionStats &fs) {
+      double t = 0;
+      for (auto &bs: fs.blocks) {
+	t += bs.estimated_time;
+      }
+      return t;
+    };
+    std::vector<const ClamFunctionStats*> funcs;
+    for (auto &fs: m_fun_stats) {
+      if (!fs.blocks.empty()) {
+	funcs.push_back(&fs);
+      }
+    }
+    std::stable_sort(funcs.begin(), funcs.end(),
+		     [&total](const ClamFunctionStats *f1, const ClamFunctionStats *f2) {
+		       return total(*f1) > total(*f2);
+		     });
+    
+    o << "\n************** FIXPOINT PROFILE ****************\n";
+    o << "Times are in microseconds for one visit of the block. The estimated\n"
+      << "time multiplies them by the estimated number of visits.\n";
+    for (const ClamFunctionStats *fs: funcs) {
+      o << "\nFunction " << fs->name << ": estimated "
+	<< format("%.0f", total(*fs) * 1e6) << "\n";
+      o << format("  %-24s %5s %5s %5s %5s %10s %10s %10s %12s\n",
+		  "block", "depth", "stmts", "joins", "widen",
+		  "transfer", "join", "widening", "estimated");
+      std::vector<const ClamBlockStats*> blocks;
+      for (auto &bs: fs->blocks) {
+	blocks.push_back(&bs);
+      }
+      std::stable_sort(blocks.begin(), blocks.end(),
+		       [](const ClamBlockStats *b1, const ClamBlockStats *b2) {
+			 return b1->estimated_time > b2->estimated_time;
+		       });
+      for (const ClamBlockStats *bs: blocks) {
+	o << format("  %-24s %5u %5u %5u %5u %10.1f %10.1f %10.1f %12.1f\n",
+		    bs->name.c_str(), (unsigned) bs->loops.size(), bs->num_stmts,
+		    bs->num_joins, bs->num_widenings, bs->transfer_time * 1e6,
+		    bs->join_time * 1e6, bs->widening_time * 1e6,
+		    bs->estimated_time * 1e6);
+      }
+    }
+    o << "************** FIXPOINT PROFILE END *************\n";
+  }
+
+  // One line per block: function;outer loop header;...;block <usecs>
+  void ClamPass::writeFixpointProfileFolded(const std::string &filename) const {
+    std::error_code ec;
+    llvm::raw_fd_ostream o(filename, ec, llvm::sys::fs::F_Text);
+    if (ec) {
+      CLAM_WARNING("cannot open " << filename << ": " << ec.message());
+      return;
+    }
+    for (auto &fs: m_fun_stats) {
+      for (auto &bs: fs.blocks) {
+	o << fs.name;
+	for (auto &header: bs.loops) {
+	  o << ";" << header;
+	}
+	if (bs.loops.empty() || bs.loops.back() != bs.name) {
+	  o << ";" << bs.name;
+	}
+	uint64_t usecs = (uint64_t) std::llround(bs.estimated_time * 1e6);
+	o << " " << std::max(usecs, (uint64_t) 1) << "\n";
+      }
+    }
+  }
+
+  // Counters and timers of ClamStats as a "stats" field
+  static void writeStatsJsonCounters(raw_ostream &o,
+				     const std::map<std::string, double> &stats) {
+    if (stats.empty()) {
+      return;
+    }
+    o << ", \"stats\": {";
+    bool first = true;
+    for (auto &kv: stats) {
+      o << (first ? "" : ", ") << "\"" << jsonEscape(kv.first) << "\": "
+	<< format("%.15g", kv.second);
+      first = false;
+    }
+    o << "}";
+  }
+
+  void ClamPass::writeStatsJson(const std::string &filename, double total_time) const {
+    std::error_code ec;
+    llvm::raw_fd_ostream o(filename, ec, llvm::sys::fs::F_Text);
+    if (ec) {
+      CLAM_WARNING("cannot open " << filename << ": " << ec.message());
+      return;
+    }
+    unsigned num_blocks = 0, num_stmts = 0;
+    // peak of the bytes allocated by each function (CLAM_TRACK_ALLOCATIONS)
+    auto mem_functions = MemTracker::get_functions();
+    o << "{\n  \"functions\": [";
+    for (unsigned i=0; i < m_fun_stats.size(); ++i) {
+      const ClamFunctionStats &fs = m_fun_stats[i];
+      num_blocks += fs.num_blocks;
+      num_stmts += fs.num_stmts;
+      o << (i > 0 ? ",\n" : "\n")
+	<< "    {\"name\": \"" << jsonEscape(fs.name) << "\""
+	<< ", \"blocks\": " << fs.num_blocks
+	<< ", \"statements\": " << fs.num_stmts;
+      if (fs.has_live) {
+	o << ", \"total_live\": " << fs.total_live
+	  << ", \"max_live_per_block\": " << fs.max_live_per_blk
+	  << ", \"avg_live_per_block\": " << fs.avg_live_per_blk;
+      }
+      o << ", \"domain\": \"" << jsonEscape(fs.domain) << "\""
+	<< ", \"analysis_time\": " << format("%.6f", fs.analysis_time)
+	<< ", \"safe_checks\": " << fs.safe_checks
+	<< ", \"error_checks\": " << fs.error_checks
+	<< ", \"warning_checks\": " << fs.warning_checks;
+      if (fs.widening_delay > 0) {
+	o << ", \"widening_delay\": " << fs.widening_delay;
+      }
+      if (!fs.downgrades.empty()) {
+	o << ", \"downgraded_from\": [";
+	for (unsigned j=0; j < fs.downgrades.size(); ++j) {
+	  o << (j > 0 ? ", " : "") << "\"" << jsonEscape(fs.downgrades[j]) << "\"";
+	}
+	o << "]";
+      }
+      if (!fs.loops.empty()) {
+	o << ", \"loops\": [";
+	for (unsigned j=0; j < fs.loops.size(); ++j) {
+	  const ClamLoopStats &ls = fs.loops[j];
+	  o << (j > 0 ? ", " : "")
+	    << "{\"header\": \"" << jsonEscape(ls.header) << "\""
+	    << ", \"depth\": " << ls.depth
+	    << ", \"modified\": " << ls.num_modified
+	    << ", \"constant_bound\": " << (ls.constant_bound ? "true" : "false")
+	    << ", \"widening_delay\": " << ls.widening_delay << "}";
+	}
+	o << "]";
+      }
+      writeStatsJsonCounters(o, ClamStats::get_function(fs.name));
+      if (MemTracker::enabled()) {
+	o << ", \"peak_bytes\": " << mem_functions[fs.name].peak;
+      }
+      o << "}";
+    }
+    o << "\n  ],\n"
+      << "  \"totals\": {\"functions\": " << m_fun_stats.size()
+      << ", \"blocks\": " << num_blocks
+      << ", \"statements\": " << num_stmts
+      << ", \"analysis_time\": " << format("%.6f", total_time)
+      << ", \"safe_checks\": " << get_total_safe_checks()
+      << ", \"error_checks\": " << get_total_error_checks()
+      << ", \"warning_checks\": " << get_total_warning_checks();
+    writeStatsJsonCounters(o, ClamStats::get_all());
+    if (MemTracker::enabled()) {
+      o << ", \"peak_bytes\": " << MemTracker::get_total().peak
+	<< ", \"phases\": {";
+      bool first = true;
+      for (auto &kv: MemTracker::get_phases()) {
+	o << (first ? "" : ", ") << "\"" << jsonEscape(kv.first) << "\": "
+	  << kv.second.peak;
+	first = false;
+      }
+      o << "}";
+    }
+    o << "}";
+    if (!m_skipped_funcs.empty()) {
+      o << ",\n  \"skipped_functions\": [";
+      for (unsigned i=0; i < m_skipped_funcs.size(); ++i) {
+	o << (i > 0 ? ", " : "") << "\"" << jsonEscape(m_skipped_funcs[i]) << "\"";
+      }
+      o << "]";
+    }
+    auto warnings = m_cfg_builder_man->get_diagnostics().get_entries();
+    if (!warnings.empty()) {
+      o << ",\n  \"builder_warnings\": [";
+      for (unsigned i=0; i < warnings.size(); ++i) {
+	auto &w = warnings[i];
+	o << (i > 0 ? ",\n" : "\n")
+	  << "    {\"kind\": \"" << CfgBuilderDiagnostics::get_kind_name(w.kind) << "\""
+	  << ", \"function\": \"" << jsonEscape(w.function) << "\""
+	  << ", \"count\": " << w.count
+	  << ", \"examples\": [";
+	for (unsigned j=0; j < w.examples.size(); ++j) {
+	  o << (j > 0 ? ", " : "") << "\"" << jsonEscape(w.examples[j]) << "\"";
+	}
+	o << "]}";
+      }
+      o << "\n  ]";
+    }
+    o << "\n}\n";
+  }
+  
+  void ClamPass::writeInvariantDatabase(const Module &M,
+					const std::string &filename) const {
+    std::map<std::string, const ClamFunctionStats*> stats;
+    for (auto &fs: m_fun_stats) {
+      stats[fs.name] = &fs;
+    }
+    InvariantDatabaseWriter db;
+    for (auto &F: M) {
+      if (!hasResults(F)) continue;
+      auto it = stats.find(F.getName());
+      if (it != stats.end()) {
+	db.add_function(F.getName(), it->second->safe_checks,
+			it->second->error_checks, it->second->warning_checks);
+      } else {
+	db.add_function(F.getName(), 0, 0, 0);
+      }
+      std::vector<wrapper_dom_ptr> pre;
+      get_pre_all(F, [&pre](const BasicBlock &B, wrapper_dom_ptr inv) {
+		    pre.push_back(inv);
+		  });
+      unsigned i = 0;
+      get_post_all(F, [&](const BasicBlock &B, wrapper_dom_ptr inv) {
+		     db.add_block(getValueName(B), pre[i++], inv);
+		   });
+    }
+    db.write(filename);
+  }
+  
+  void ClamPass::writeSummaries(const Module &M,
+				const std::string &filename) const {
+    FunctionSummaries summaries;
+    auto &vfac = m_cfg_builder_man->get_var_factory();
+    for (auto &F: M) {
+      if (F.isDeclaration() || F.getName() == "main" || !hasResults(F)) continue;
+      // -- only the functions analyzed without assumptions on their
+      //    inputs (e.g., not the callees of the inter-procedural
+      //    analysis) have invariants that hold for any caller
+      wrapper_dom_ptr entry = get_pre(&F.getEntryBlock());
+      if (!entry || !entry->is_top()) continue;
+      const ReturnInst *ret = nullptr;
+      unsigned num_rets = 0;
+      for (auto &B: F) {
+	if (const ReturnInst *RI = dyn_cast<ReturnInst>(B.getTerminator())) {
+	  ret = RI;
+	  ++num_rets;
+	}
+      }
+      if (num_rets > 1) continue;
+      if (num_rets == 0) {
+	// -- the function never returns
+	summaries.add(F, nullptr, true, lin_cst_sys_t());
+	continue;
+      }
+      wrapper_dom_ptr post = get_post(ret->getParent());
+      if (!post) continue;
+      const Value *rv = ret->getReturnValue();
+      std::vector<var_t> vars;
+      for (auto &a: F.args()) {
+	if (isInteger(a)) {
+	  vars.push_back(var_t(vfac[&a], crab::INT_TYPE,
+			       a.getType()->getIntegerBitWidth()));
+	}
+      }
+      if (rv && isInteger(*rv) && !isa<Constant>(rv) && !isa<Argument>(rv)) {
+	vars.push_back(var_t(vfac[rv], crab::INT_TYPE,
+			     rv->getType()->getIntegerBitWidth()));
+      }
+      bool is_bottom = post->is_bottom();
+      summaries.add(F, rv, is_bottom,
+		    is_bottom ? lin_cst_sys_t() : post->to_linear_constraints(vars));
+    }
+    std::string err;
+    if (!summaries.writeFile(filename, err)) {
+      CLAM_WARNING(err);
+      return;
+    }
+    CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Wrote " << summaries.size()
+		    << " summaries into " << filename << "\n";);
+  }
+  
+  void ClamPass::writeCfgs(const std::vector<const Function*> &funcs,
+			   const std::string &filename) const {
+    std::error_code ec;
+    llvm::raw_fd_ostream o(filename, ec, llvm::sys::fs::F_Text);
+    if (ec) {
+      CLAM_WARNING("cannot write CFGs into " << filename << ": " << ec.message());
+      return;
+    }
+    unsigned num_cfgs = 0;
+    for (const Function *F: funcs) {
+      // -- only the CFGs built by the analysis
+      if (!m_cfg_builder_man->has_cfg(*F)) continue;
+      crab::crab_string_os s;
+      s << m_cfg_builder_man->get_cfg(*F);
+      o << s.str() << "\n";
+      ++num_cfgs;
+    }
+    CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Wrote " << num_cfgs
+		    << " CFGs into " << filename << "\n";);
+  }
   
   void ClamPass::getAnalysisUsage(AnalysisUsage &AU) const {
     bool runSeaDsa = false;
@@ -1503,6 +2859,10 @@ namespace clam {
    * For clam clients
    **/
 
+  bool ClamPass::hasResults(const llvm::Function &F) const {
+    return m_cfg_builder_man->has_cfg(F) || m_released_funcs.count(&F) > 0;
+  }
+
   bool ClamPass::has_cfg(llvm::Function &F) {
     return m_cfg_builder_man->has_cfg(F);
   }
@@ -1524,7 +2884,14 @@ namespace clam {
     if (!keep_shadows)
       shadows = std::vector<varname_t>(vfac.get_shadow_vars().begin(),
 				       vfac.get_shadow_vars().end());
-    return lookup(m_pre_map, *block, shadows);
+    if (m_inv_store && m_inv_store->contains(*block->getParent())) {
+      abs_dom_map_t spilled;
+      if (wrapper_dom_ptr inv = m_inv_store->get_pre(*block)) {
+	spilled.insert({block, inv});
+      }
+      return lookup(spilled, *block, shadows);
+    }
+    return m_shadow_free_invs->lookup(m_pre_map, m_lazy_invs, true, *block, shadows);
   }   
 
   // return invariants that hold at the exit of block
@@ -1535,12 +2902,51 @@ namespace clam {
     if (!keep_shadows)
       shadows = std::vector<varname_t>(vfac.get_shadow_vars().begin(),
 				       vfac.get_shadow_vars().end());
-    return lookup(m_post_map, *block, shadows);
+    if (m_inv_store && m_inv_store->contains(*block->getParent())) {
+      abs_dom_map_t spilled;
+      if (wrapper_dom_ptr inv = m_inv_store->get_post(*block)) {
+	spilled.insert({block, inv});
+      }
+      return lookup(spilled, *block, shadows);
+    }
+    return m_shadow_free_invs->lookup(m_post_map, m_lazy_invs, false, *block, shadows);
+  }
+
+  void ClamPass::get_all(const llvm::Function &F, bool is_pre,
+			 const block_inv_callback_t &f, bool keep_shadows) const {
+    if (m_inv_store && m_inv_store->contains(F)) {
+      // -- the spilled invariants do not have shadow variables
+      for (auto &B: F) {
+	f(B, is_pre ? m_inv_store->get_pre(B) : m_inv_store->get_post(B));
+      }
+      return;
+    }
+    std::vector<varname_t> shadows;
+    auto &vfac = m_cfg_builder_man->get_var_factory();
+    if (!keep_shadows)
+      shadows = std::vector<varname_t>(vfac.get_shadow_vars().begin(),
+				       vfac.get_shadow_vars().end());
+    lookup_all(is_pre ? m_pre_map : m_post_map, m_lazy_invs, is_pre, F,
+	       shadows, f);
+  }
+
+  // call f with the invariants that hold at the entry of each block of F
+  void ClamPass::get_pre_all(const llvm::Function &F,
+			     const block_inv_callback_t &f,
+			     bool keep_shadows) const {
+    get_all(F, true, f, keep_shadows);
+  }
+
+  // call f with the invariants that hold at the exit of each block of F
+  void ClamPass::get_post_all(const llvm::Function &F,
+			      const block_inv_callback_t &f,
+			      bool keep_shadows) const {
+    get_all(F, false, f, keep_shadows);
   }
 
   bool ClamPass::has_feasible_edge(const llvm::BasicBlock *b1,
 				       const llvm::BasicBlock* b2) const {
-    return !(m_infeasible_edges.count({b1, b2}) > 0);
+    return !(m_infeasible_edges.contains(b1, b2));
   }
   
   /**
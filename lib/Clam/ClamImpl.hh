@@ -0,0 +1,4576 @@
+#pragma once
+
+/**
+ * Internal implementation of the intra and inter-procedural analyses.
+ *
+ * This header is only included by Clam.cc and by the translation
+ * units in domains/, one per abstract domain, that instantiate and
+ * register the analyses of their domain. These translation units
+ * are either linked into ClamAnalysis or built as plugins
+ * (-DCLAM_DOMAIN_PLUGINS=ON) that are loaded at runtime.
+ **/
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/iterator_range.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Config/llvm-config.h"
+
+#include "clam/config.h"
+#include "clam/AbstractDomain.hh"
+#include "clam/Clam.hh"
+#include "clam/CfgBuilder.hh"
+#include "clam/Support/Debug.hh"
+#include "clam/Support/NameValues.hh"
+#include "clam/Support/Numa.hh"
+#include "clam/Support/Stats.hh"
+
+#include "crab/common/debug.hpp"
+#include "crab/common/stats.hpp"
+#include "crab/analysis/fwd_analyzer.hpp"
+#include "crab/analysis/bwd_analyzer.hpp"
+#ifdef TOP_DOWN_INTER_ANALYSIS
+#include "crab/analysis/inter/top_down_inter_analyzer.hpp"
+#else
+#include "crab/analysis/inter/bottom_up_inter_analyzer.hpp"
+#endif 
+#include "crab/analysis/dataflow/liveness.hpp"
+#include "crab/analysis/dataflow/assumptions.hpp"
+#include "crab/checkers/assertion.hpp"
+#include "crab/checkers/checker.hpp"
+#include "crab/cg/cg.hpp"
+#include "crab/cg/cg_bgl.hpp"
+#include "./crab/path_analyzer.hpp"
+#include "AnalysisCache.hh"
+#include "AnalysisCost.hh"
+#include "CfgBuilderUtils.hh"
+#include "CheckIndexWriter.hh"
+#include "FunctionAnalysisConfig.hh"
+#ifdef INSTRUMENT_DOMAINS
+#include "InstrumentedDomain.hh"
+#include "BoundedDisjunctsDomain.hh"
+#endif
+#include "PackedDomain.hh"
+#include "VariablePacking.hh"
+#include "NullityAnalysis.hh"
+#include "OutputSink.hh"
+#include "WideningDelay.hh"
+#include "WideningThresholds.hh"
+#include "WorklistFixpoint.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <typeindex>
+#include <unordered_map>
+#include <unordered_set>
+#ifdef LLVM_ON_UNIX
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Defined in ClamOptions.def
+extern llvm::cl::opt<bool> CrabBuildOnlyCFG;
+
+// Table of member functions of C (one per abstract domain) indexed
+// by an unsigned key. There is only one table per kind of analysis,
+// shared by all the instances of C, and populated when the domains
+// are registered (see domains/). If the table has a resolver then it
+// is called with the key before each lookup so that the domains are
+// registered the first time they are needed.
+template <class C, typename Fn, unsigned N>
+class dispatch_table;
+
+template <class C, typename Ret, typename ... Ts, unsigned N>
+class dispatch_table<C, Ret(Ts...), N> {
+public:
+  typedef Ret (C::*method_t)(Ts...);
+  typedef void (*resolver_t)(unsigned key);
+  
+  struct entry_t {
+    method_t method;
+    const char* name;
+    
+    Ret analyze(C* c, Ts... args) const {
+      return (c->*method)(std::forward<Ts>(args)...);
+    }
+  };
+  
+  dispatch_table(resolver_t resolver = nullptr): m_resolver(resolver) {
+    for (unsigned i=0; i < N; ++i) {
+      m_entries[i] = {nullptr, ""};
+    }
+  }
+
+  void add(unsigned key, entry_t entry) {
+    assert(key < N);
+    m_entries[key] = entry;
+  }
+  
+  bool count(unsigned key) const {
+    if (key >= N) return false;
+    if (m_resolver) m_resolver(key);
+    return m_entries[key].method;
+  }
+  
+  const entry_t& at(unsigned key) const {
+    assert(key < N);
+    if (m_resolver) m_resolver(key);
+    assert(m_entries[key].method);
+    return m_entries[key];
+  }
+  
+private:
+  entry_t m_entries[N];
+  resolver_t m_resolver;
+};
+
+namespace clam {
+
+  using namespace llvm;
+  using namespace crab::cfg;
+  using namespace crab::cg;
+
+  // Size of the address space and resident memory in MB of the
+  // process pid (0: this process). Return false if unknown.
+  inline bool processMemoryMB(long pid, long &size, long &resident) {
+#ifdef __linux__
+    std::string statm = pid > 0 ? "/proc/" + std::to_string(pid) + "/statm"
+                                : "/proc/self/statm";
+    bool ok = false;
+    if (FILE *f = fopen(statm.c_str(), "r")) {
+      ok = (fscanf(f, "%ld %ld", &size, &resident) == 2);
+      fclose(f);
+    }
+    if (ok) {
+      size = (size * sysconf(_SC_PAGESIZE)) >> 20;
+      resident = (resident * sysconf(_SC_PAGESIZE)) >> 20;
+    }
+    return ok;
+#else
+    return false;
+#endif
+  }
+
+  // Resident memory in MB of the process pid (0: this process) or -1
+  // if unknown
+  inline long residentMemoryMB(long pid = 0) {
+    long size, resident;
+    return processMemoryMB(pid, size, resident) ? resident : -1;
+  }
+
+  // Address space size in MB of this process or -1 if unknown
+  inline long addressSpaceMB() {
+    long size, resident;
+    return processMemoryMB(0, size, resident) ? size : -1;
+  }
+  using namespace crab::analyzer;
+  using namespace crab::checker;
+
+  static const unsigned NUM_CRAB_DOMAINS = DENSE_INTERVALS + 1;
+  
+  /** Begin typedefs **/
+  typedef crab::analyzer::liveness<cfg_ref_t> liveness_t;
+  typedef crab::cg::call_graph<cfg_ref_t> call_graph_t; 
+  typedef crab::cg::call_graph_ref<call_graph_t> call_graph_ref_t;
+  typedef std::unordered_map<cfg_ref_t, const liveness_t*> liveness_map_t;
+  typedef typename IntraClam::wrapper_dom_ptr wrapper_dom_ptr;    
+  typedef typename IntraClam::checks_db_t checks_db_t;
+  typedef typename IntraClam::abs_dom_map_t abs_dom_map_t;
+  typedef typename IntraClam::lin_csts_map_t lin_csts_map_t;
+  typedef typename IntraClam::lazy_inv_map_t lazy_inv_map_t;
+  typedef typename IntraClam::block_inv_callback_t block_inv_callback_t;
+
+  //typedef typename IntraClam::assumption_map_t assumption_map_t;
+
+  /** End typedefs **/
+
+  /**
+   * Load the domain plugins given by --crab-dom-plugin. Only the
+   * first call has effect.
+   **/
+  void initDomains();
+
+  /**
+   * Register dom, loading its plugin if the domains are plugins. The
+   * dispatch tables call it on each lookup so that the libraries and
+   * managers of a domain (Elina/Apron, LDD, ...) are initialized only
+   * if the domain is used. Only the first call for dom has effect.
+   **/
+  void initDomain(CrabDomain dom);
+
+  #if 0
+  /** Begin global counters **/
+  static unsigned num_invars; // some measure for the size of invariants
+  static unsigned num_nontrivial_blocks;
+  /** End global counters **/
+  #endif
+
+  inline bool isRelationalDomain(CrabDomain dom) {
+    return (dom == ZONES_SPLIT_DBM || dom == OCT ||
+	    dom == PK || dom == TERMS_ZONES);
+  }
+
+  inline bool isTrackable(const Function &fun) {
+    return !fun.isDeclaration() && !fun.empty() && !fun.isVarArg();
+  }
+
+  // Serialize printing when several functions are analyzed in
+  // parallel (see --crab-threads).
+  extern std::mutex output_mutex;
+
+  /** convenient wrapper for the analysis datastructures **/
+  struct AnalysisResults {
+    // invariants that hold at the entry of a block
+    abs_dom_map_t &premap;
+    // invariants that hold at the exit of a block
+    abs_dom_map_t &postmap;
+    // infeasible edges 
+    edges_set &infeasible_edges;
+    // database with all the checks
+    checks_db_t &checksdb;
+    // invariants computed on demand (null if not supported by the client)
+    lazy_inv_map_t *lazy_invariants;
+    // status of each check by source location (null if not needed)
+    CheckIndexWriter *check_index;
+
+    AnalysisResults(abs_dom_map_t &pre, abs_dom_map_t &post,
+		    edges_set& false_edges,  checks_db_t &db,
+		    lazy_inv_map_t *lazy = nullptr,
+		    CheckIndexWriter *index = nullptr)
+      : premap(pre)
+      , postmap(post)
+      , infeasible_edges(false_edges)
+      , checksdb(db)
+      , lazy_invariants(lazy)
+      , check_index(index) {}
+  };
+
+  /** typed variables (needed by forget) for the shadow variables **/
+  inline std::vector<var_t>
+  mk_shadow_vars(const std::vector<varname_t> &shadow_varnames) {
+    std::vector<var_t> shadow_vars;
+    shadow_vars.reserve(shadow_varnames.size());
+    for(unsigned i=0; i<shadow_varnames.size(); ++i) {
+      shadow_vars.push_back(var_t(shadow_varnames[i], crab::UNK_TYPE, 0));
+    }
+    return shadow_vars;
+  }
+
+  /** return a copy of inv without shadow_vars **/
+  inline wrapper_dom_ptr forget_shadows(const wrapper_dom_ptr &inv,
+					const std::vector<var_t> &shadow_vars) {
+    if (!inv || shadow_vars.empty()) {
+      return inv;
+    }
+    auto invs = inv->clone();
+    invs->forget(shadow_vars);
+    return invs;
+  }
+  
+  /** return invariant for block in table but filtering out shadow_varnames **/
+  inline wrapper_dom_ptr lookup(const abs_dom_map_t &table,
+				const llvm::BasicBlock &block,
+				const std::vector<varname_t> &shadow_varnames) {
+    auto it = table.find(&block);
+    if (it == table.end()) {
+      return nullptr;
+    }
+    return forget_shadows(it->second, mk_shadow_vars(shadow_varnames));
+  }   
+
+  /** 
+   * Invariants of a function that are built on demand from the
+   * fixpoint of its analyzer. This avoids copying the abstract states
+   * of all blocks if clients only query some of them.
+   **/
+  class LazyInvariants {
+  public:
+    virtual ~LazyInvariants() {}
+    virtual wrapper_dom_ptr get_pre(const llvm::BasicBlock &block) const = 0;
+    virtual wrapper_dom_ptr get_post(const llvm::BasicBlock &block) const = 0;
+  };
+
+  template<typename Analyzer>
+  class AnalyzerInvariants: public LazyInvariants {
+    // keep alive the cfg used by the analyzer
+    CrabBuilderManager::CfgBuilderPtr m_cfg_builder;
+    std::unique_ptr<Analyzer> m_analyzer;
+    
+  public:
+    AnalyzerInvariants(CrabBuilderManager::CfgBuilderPtr cfg_builder,
+		       std::unique_ptr<Analyzer> analyzer)
+      : m_cfg_builder(cfg_builder), m_analyzer(std::move(analyzer)) {}
+    
+    wrapper_dom_ptr get_pre(const llvm::BasicBlock &block) const override {
+      return mkGenericAbsDomWrapper
+	(m_analyzer->get_pre(m_cfg_builder->get_crab_basic_block(&block)));
+    }
+    
+    wrapper_dom_ptr get_post(const llvm::BasicBlock &block) const override {
+      return mkGenericAbsDomWrapper
+	(m_analyzer->get_post(m_cfg_builder->get_crab_basic_block(&block)));
+    }
+  };
+
+  /**
+   * Add to checks the status of each assertion of the block bl of
+   * cfg from pre, the invariant at the entry of bl. The status is
+   * computed as the assertion checker does. Boolean assertions are
+   * not checked.
+   **/
+  template<typename Dom>
+  static void checkBlockAsserts(cfg_ref_t cfg, const basic_block_label_t &bl,
+				Dom pre, checks_db_t &checks) {
+    typedef crab::analyzer::intra_abs_transformer<Dom> abs_tr_t;
+    typedef typename cfg_ref_t::basic_block_t::assert_t assert_t;
+    abs_tr_t abs_tr(pre);
+    for (auto &s: cfg.get_node(bl)) {
+      if (s.is_assert()) {
+	const lin_cst_t &cst = static_cast<const assert_t*>(&s)->constraint();
+	Dom inv = abs_tr.get_abs_value();
+	if (inv.is_bottom() ||
+	    crab::domains::checker_domain_traits<Dom>::entail(inv, cst)) {
+	  checks.add(_SAFE, s.get_debug_info());
+	} else if (crab::domains::checker_domain_traits<Dom>::intersect(inv, cst)) {
+	  checks.add(_WARN, s.get_debug_info());
+	} else {
+	  checks.add(_ERR, s.get_debug_info());
+	}
+      }
+      s.accept(&abs_tr);
+    }
+  }
+
+  /**
+   * Invariants of a function that only keep the abstract states at
+   * the entry and at the loop heads. The state of any other block is
+   * recomputed when queried by propagating the states of the heads
+   * through the acyclic region that reaches the block. The most
+   * recently recomputed states are kept in a LRU cache.
+   *
+   * This assumes that the fixpoint of a block that is not a loop head
+   * is the join of the post-states of its predecessors, which only
+   * holds for a forward analysis without assumptions.
+   **/
+  template<typename Dom>
+  class HeadInvariants: public LazyInvariants {
+    typedef crab::analyzer::intra_abs_transformer<Dom> abs_tr_t;
+    typedef std::list<std::pair<basic_block_label_t, Dom>> lru_t;
+    
+    // keep alive the cfg
+    CrabBuilderManager::CfgBuilderPtr m_cfg_builder;
+    // pre-states of the entry and the loop heads
+    std::map<basic_block_label_t, Dom> m_heads;
+    // blocks reachable from the entry
+    std::set<basic_block_label_t> m_reachable;
+    unsigned m_cache_size;
+    // post-states, the most recently used first
+    mutable lru_t m_lru;
+    mutable std::map<basic_block_label_t, typename lru_t::iterator> m_lru_map;
+    mutable std::mutex m_mutex;
+
+    Dom compute_pre(const basic_block_label_t &bl) const {
+      auto it = m_heads.find(bl);
+      if (it != m_heads.end()) {
+	return it->second;
+      }
+      Dom res = Dom::bottom();
+      if (m_reachable.count(bl) == 0) {
+	return res;
+      }
+      // the edges to a block that is not a head are not back edges
+      // so the recursion terminates.
+      auto &bb = m_cfg_builder->get_cfg().get_node(bl);
+      for (auto pred: llvm::make_range(bb.prev_blocks())) {
+	if (m_reachable.count(pred) > 0) {
+	  res |= compute_post(pred);
+	}
+      }
+      return res;
+    }
+    
+    Dom compute_post(const basic_block_label_t &bl) const {
+      auto it = m_lru_map.find(bl);
+      if (it != m_lru_map.end()) {
+	m_lru.splice(m_lru.begin(), m_lru, it->second);
+	return it->second->second;
+      }
+      abs_tr_t abs_tr(compute_pre(bl));
+      for (auto &s: m_cfg_builder->get_cfg().get_node(bl)) {
+	s.accept(&abs_tr);
+      }
+      Dom res = abs_tr.get_abs_value();
+      m_lru.push_front({bl, res});
+      m_lru_map[bl] = m_lru.begin();
+      if (m_lru.size() > m_cache_size) {
+	m_lru_map.erase(m_lru.back().first);
+	m_lru.pop_back();
+      }
+      return res;
+    }
+    
+  public:
+    template<typename Analyzer>
+    HeadInvariants(CrabBuilderManager::CfgBuilderPtr cfg_builder,
+		   Analyzer &analyzer, basic_block_label_t entry,
+		   unsigned cache_size)
+      : m_cfg_builder(cfg_builder), m_cache_size(std::max(cache_size, 1U)) {
+      auto &lo = m_cfg_builder->get_loop_order(entry);
+      m_reachable = lo.reachable;
+      for (auto &h: lo.heads) {
+	m_heads.insert({h, analyzer.get_pre(h)});
+      }
+    }
+    
+    wrapper_dom_ptr get_pre(const llvm::BasicBlock &block) const override {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return mkGenericAbsDomWrapper
+	(compute_pre(m_cfg_builder->get_crab_basic_block(&block)));
+    }
+    
+    wrapper_dom_ptr get_post(const llvm::BasicBlock &block) const override {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return mkGenericAbsDomWrapper
+	(compute_post(m_cfg_builder->get_crab_basic_block(&block)));
+    }
+  };
+
+  /**
+   * Invariants of a function that keep the full abstract states only
+   * at the anchors: the entry, the loop heads and the blocks with
+   * several predecessors. Any other state is a delta, the linear
+   * constraints added and removed with respect to a reference state:
+   * the pre-state of the block for its post-state and the post-state
+   * of its only predecessor (its immediate dominator) for its
+   * pre-state. A state is decoded when queried by applying the deltas
+   * from the closest anchor.
+   *
+   * As for the cache (see toAbsVal), a decoded state is rebuilt from
+   * its linear constraints so it loses what Dom does not express as
+   * linear constraints. The anchors are exact.
+   **/
+  template<typename Dom>
+  class DeltaInvariants: public LazyInvariants {
+    // -- a state: (block, true) is its pre-state, (block, false) its
+    //    post-state
+    typedef std::pair<basic_block_label_t, bool> state_t;
+    typedef std::vector<lin_cst_t> csts_t;
+    struct delta_t {
+      state_t ref;
+      bool is_bottom;
+      csts_t added;
+      csts_t removed;
+    };
+
+    // keep alive the cfg
+    CrabBuilderManager::CfgBuilderPtr m_cfg_builder;
+    // pre-states of the anchors
+    std::map<basic_block_label_t, Dom> m_anchors;
+    std::map<state_t, delta_t> m_deltas;
+
+    static std::string key(const lin_cst_t &cst) {
+      crab::crab_string_os o;
+      o << cst;
+      return o.str();
+    }
+
+    static csts_t to_csts(Dom absval) {
+      csts_t res;
+      if (!absval.is_bottom()) {
+	for (auto const &cst: absval.to_linear_constraint_system()) {
+	  res.push_back(cst);
+	}
+      }
+      return res;
+    }
+
+    static delta_t mk_delta(state_t ref, const csts_t &ref_csts, bool is_bottom,
+			    const csts_t &cur_csts) {
+      delta_t d;
+      d.ref = ref;
+      d.is_bottom = is_bottom;
+      std::set<std::string> ref_keys, cur_keys;
+      for (auto const &cst: ref_csts) {
+	ref_keys.insert(key(cst));
+      }
+      for (auto const &cst: cur_csts) {
+	cur_keys.insert(key(cst));
+	if (!ref_keys.count(key(cst))) {
+	  d.added.push_back(cst);
+	}
+      }
+      for (auto const &cst: ref_csts) {
+	if (!cur_keys.count(key(cst))) {
+	  d.removed.push_back(cst);
+	}
+      }
+      return d;
+    }
+
+    // Return false if the state is bottom. Otherwise csts are its
+    // constraints.
+    bool decode(state_t state, csts_t &csts) const {
+      // -- the deltas from the anchor to state
+      std::vector<const delta_t*> chain;
+      auto it = m_deltas.find(state);
+      while (it != m_deltas.end()) {
+	chain.push_back(&it->second);
+	state = it->second.ref;
+	it = m_deltas.find(state);
+      }
+      auto ait = m_anchors.find(state.first);
+      if (ait == m_anchors.end()) {
+	return false;
+      }
+      bool is_bottom = ait->second.is_bottom();
+      csts = to_csts(ait->second);
+      for (auto rit = chain.rbegin(), ret = chain.rend(); rit != ret; ++rit) {
+	const delta_t &d = **rit;
+	std::set<std::string> removed;
+	for (auto const &cst: d.removed) {
+	  removed.insert(key(cst));
+	}
+	csts_t next;
+	for (auto const &cst: csts) {
+	  if (!removed.count(key(cst))) {
+	    next.push_back(cst);
+	  }
+	}
+	next.insert(next.end(), d.added.begin(), d.added.end());
+	csts.swap(next);
+	is_bottom = d.is_bottom;
+      }
+      return !is_bottom;
+    }
+
+    Dom get(state_t state) const {
+      // -- an anchor
+      if (state.second && !m_deltas.count(state)) {
+	auto it = m_anchors.find(state.first);
+	return it == m_anchors.end() ? Dom::bottom() : it->second;
+      }
+      csts_t csts;
+      if (!decode(state, csts)) {
+	return Dom::bottom();
+      }
+      lin_cst_sys_t sys;
+      for (auto const &cst: csts) {
+	sys += cst;
+      }
+      Dom res = Dom::top();
+      res += sys;
+      return res;
+    }
+
+  public:
+    template<typename Analyzer>
+    DeltaInvariants(CrabBuilderManager::CfgBuilderPtr cfg_builder,
+		    Analyzer &analyzer, basic_block_label_t entry)
+      : m_cfg_builder(cfg_builder) {
+      auto &lo = m_cfg_builder->get_loop_order(entry);
+      auto &cfg = m_cfg_builder->get_cfg();
+      // -- the constraints of the post-states already encoded
+      std::map<basic_block_label_t, csts_t> posts;
+      uint64_t num_csts = 0;
+      for (auto &bl: lo.rpo) {
+	std::vector<basic_block_label_t> preds;
+	for (auto pred: llvm::make_range(cfg.get_node(bl).prev_blocks())) {
+	  if (lo.reachable.count(pred) > 0) {
+	    preds.push_back(pred);
+	  }
+	}
+	Dom pre = analyzer.get_pre(bl);
+	csts_t pre_csts = to_csts(pre);
+	if (bl == lo.entry || lo.heads.count(bl) || preds.size() != 1 ||
+	    !posts.count(preds[0])) {
+	  m_anchors.insert({bl, pre});
+	} else {
+	  delta_t d = mk_delta(state_t(preds[0], false), posts[preds[0]],
+			       pre.is_bottom(), pre_csts);
+	  num_csts += d.added.size() + d.removed.size();
+	  m_deltas.insert({state_t(bl, true), std::move(d)});
+	}
+	Dom post = analyzer.get_post(bl);
+	csts_t post_csts = to_csts(post);
+	delta_t d = mk_delta(state_t(bl, true), pre_csts, post.is_bottom(), post_csts);
+	num_csts += d.added.size() + d.removed.size();
+	m_deltas.insert({state_t(bl, false), std::move(d)});
+	posts[bl] = std::move(post_csts);
+      }
+      ClamStats::count("Invariants.Delta.Anchors", m_anchors.size());
+      ClamStats::count("Invariants.Delta.Constraints", num_csts);
+    }
+
+    wrapper_dom_ptr get_pre(const llvm::BasicBlock &block) const override {
+      return mkGenericAbsDomWrapper
+	(get(state_t(m_cfg_builder->get_crab_basic_block(&block), true)));
+    }
+
+    wrapper_dom_ptr get_post(const llvm::BasicBlock &block) const override {
+      return mkGenericAbsDomWrapper
+	(get(state_t(m_cfg_builder->get_crab_basic_block(&block), false)));
+    }
+  };
+
+  /** 
+   * return invariant for block but filtering out shadow_varnames. The
+   * invariant is built on demand if the analyzer of the function is
+   * in lazy_table.
+   **/
+  inline wrapper_dom_ptr lookup(const abs_dom_map_t &table,
+				const lazy_inv_map_t &lazy_table, bool is_pre,
+				const llvm::BasicBlock &block,
+				const std::vector<varname_t> &shadow_varnames) {
+    auto it = lazy_table.find(block.getParent());
+    if (it == lazy_table.end()) {
+      return lookup(table, block, shadow_varnames);
+    }
+    abs_dom_map_t tmp;
+    tmp.insert({&block, (is_pre ? it->second->get_pre(block) :
+			          it->second->get_post(block))});
+    return lookup(tmp, block, shadow_varnames);
+  }
+
+  /**
+   * Call f with each block of fun, in layout order, and its invariant
+   * (null if not stored) filtering out shadow_varnames. The shadow
+   * variables are built once for all the blocks.
+   **/
+  inline void lookup_all(const abs_dom_map_t &table,
+			 const lazy_inv_map_t &lazy_table, bool is_pre,
+			 const llvm::Function &fun,
+			 const std::vector<varname_t> &shadow_varnames,
+			 const block_inv_callback_t &f) {
+    std::vector<var_t> shadow_vars = mk_shadow_vars(shadow_varnames);
+    auto it = lazy_table.find(&fun);
+    for (auto &block: fun) {
+      wrapper_dom_ptr inv;
+      if (it != lazy_table.end()) {
+	inv = (is_pre ? it->second->get_pre(block) : it->second->get_post(block));
+      } else {
+	auto inv_it = table.find(&block);
+	if (inv_it != table.end()) {
+	  inv = inv_it->second;
+	}
+      }
+      f(block, forget_shadows(inv, shadow_vars));
+    }
+  }
+
+  /**
+   * Invariants without the shadow variables (see keep_shadows in
+   * get_pre and get_post). The projection of an invariant is computed
+   * on the first query and reused while the stored invariant and the
+   * shadow variables do not change. Invariants built on demand are
+   * not cached. The projections are shared and must not be modified.
+   **/
+  class ShadowFreeInvariantCache {
+    struct entry_t {
+      // stored invariant from which projected was computed
+      wrapper_dom_ptr inv;
+      wrapper_dom_ptr projected;
+    };
+    llvm::DenseMap<const llvm::BasicBlock*, entry_t> m_pre;
+    llvm::DenseMap<const llvm::BasicBlock*, entry_t> m_post;
+    // shadow variables of the cached projections
+    size_t m_num_shadows;
+    std::mutex m_mutex;
+    
+  public:
+    ShadowFreeInvariantCache(): m_num_shadows(0) {}
+    
+    wrapper_dom_ptr lookup(const abs_dom_map_t &table,
+			   const lazy_inv_map_t &lazy_table, bool is_pre,
+			   const llvm::BasicBlock &block,
+			   const std::vector<varname_t> &shadow_varnames) {
+      if (shadow_varnames.empty() ||
+	  lazy_table.find(block.getParent()) != lazy_table.end()) {
+	return clam::lookup(table, lazy_table, is_pre, block, shadow_varnames);
+      }
+      auto it = table.find(&block);
+      if (it == table.end()) {
+	return nullptr;
+      }
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_num_shadows != shadow_varnames.size()) {
+	// -- new shadow variables: all the projections are stale
+	clear_unlocked();
+	m_num_shadows = shadow_varnames.size();
+      }
+      entry_t &e = (is_pre ? m_pre : m_post)[&block];
+      if (e.inv != it->second) {
+	e.inv = it->second;
+	e.projected = forget_shadows(it->second, mk_shadow_vars(shadow_varnames));
+      }
+      return e.projected;
+    }
+
+    void clear() {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      clear_unlocked();
+    }
+
+  private:
+    void clear_unlocked() {
+      m_pre.clear();
+      m_post.clear();
+    }
+  };
+  
+  /**
+   * Invariants that hold just before an instruction (see
+   * IntraClam::get_at). The crab block of the instruction is replayed
+   * from the invariant at its entry, and the states before the
+   * instructions of the last cache_size replayed blocks are kept so
+   * that the queries in the same block cost one replay.
+   *
+   * A statement belongs to the instruction returned by
+   * CfgBuilder::get_instruction (array statements) or else to the
+   * instruction of a variable it defines, and the statements of the
+   * phi nodes of the successors belong to the terminator. The
+   * invariant before an instruction is the one before the first
+   * statement of the instruction, or of the next instruction of the
+   * block with statements (at the end of the block if none). The
+   * cache must be cleared when the invariants change.
+   **/
+  class InstructionInvariantCache {
+    struct entry_t {
+      // position of each instruction in the block
+      llvm::DenseMap<const llvm::Instruction*, unsigned> numbers;
+      // increasing positions of the instructions with statements
+      std::vector<unsigned> positions;
+      // states[i] holds before the instruction at positions[i] and
+      // the last one at the end of the block
+      std::vector<wrapper_dom_ptr> states;
+    };
+    typedef std::list<std::pair<const llvm::BasicBlock*, entry_t>> lru_t;
+    
+    unsigned m_cache_size;
+    // the most recently used first
+    lru_t m_lru;
+    llvm::DenseMap<const llvm::BasicBlock*, lru_t::iterator> m_lru_map;
+    std::mutex m_mutex;
+
+    static const llvm::Instruction *get_instruction(const CfgBuilder &builder,
+						    statement_t &s) {
+      if (const llvm::Instruction *I = builder.get_instruction(s)) {
+	return I;
+      }
+      auto &ls = s.get_live();
+      for (auto it = ls.defs_begin(), et = ls.defs_end(); it != et; ++it) {
+	if (auto v = it->name().get()) {
+	  if (const llvm::Instruction *I = llvm::dyn_cast<llvm::Instruction>(*v)) {
+	    return I;
+	  }
+	}
+      }
+      return nullptr;
+    }
+
+    void replay(const llvm::BasicBlock &B, wrapper_dom_ptr pre,
+		CfgBuilder &builder, entry_t &e) {
+      unsigned n = 0;
+      for (auto &I: B) {
+	e.numbers[&I] = n++;
+      }
+      unsigned term = e.numbers[B.getTerminator()];
+      auto keep = [&](statement_t &s) {
+	const llvm::Instruction *I = get_instruction(builder, s);
+	if (!I) {
+	  return false;
+	}
+	auto it = e.numbers.find(I);
+	unsigned pos = (it != e.numbers.end() ? it->second : term);
+	if (!e.positions.empty() && pos <= e.positions.back()) {
+	  return false;
+	}
+	e.positions.push_back(pos);
+	return true;
+      };
+      auto &bb = builder.get_cfg().get_node(builder.get_crab_basic_block(&B));
+      pre->replay(bb, keep, e.states);
+      ClamStats::count("Invariants.Instruction.Replays");
+    }
+    
+  public:
+    InstructionInvariantCache(unsigned cache_size = 64)
+      : m_cache_size(std::max(cache_size, 1U)) {}
+
+    // pre is the invariant at the entry of the block of I, with the
+    // shadow variables
+    wrapper_dom_ptr lookup(const llvm::Instruction &I, wrapper_dom_ptr pre,
+			   CfgBuilder &builder) {
+      const llvm::BasicBlock *B = I.getParent();
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_lru_map.find(B);
+      if (it != m_lru_map.end()) {
+	m_lru.splice(m_lru.begin(), m_lru, it->second);
+      } else {
+	m_lru.push_front({B, entry_t()});
+	replay(*B, pre, builder, m_lru.front().second);
+	m_lru_map[B] = m_lru.begin();
+	if (m_lru.size() > m_cache_size) {
+	  m_lru_map.erase(m_lru.back().first);
+	  m_lru.pop_back();
+	}
+      }
+      entry_t &e = m_lru.front().second;
+      unsigned pos = e.numbers.lookup(&I);
+      auto pit = std::lower_bound(e.positions.begin(), e.positions.end(), pos);
+      return e.states[pit - e.positions.begin()];
+    }
+
+    void clear() {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_lru.clear();
+      m_lru_map.clear();
+    }
+  };
+
+  /**
+   * Share one wrapper between equal invariants. The invariants are
+   * hashed by their linear constraints, which the wrapper caches,
+   * and two invariants with the same hash are shared only if each
+   * one is included in the other. The shared invariants must not be
+   * modified.
+   **/
+  class InvariantInterner {
+    std::unordered_map<std::size_t, std::vector<wrapper_dom_ptr>> m_table;
+    unsigned m_num_shared;
+
+    static llvm::hash_code hash(const number_t &n) {
+      if (n.fits_slong()) {
+	return llvm::hash_value((long) n);
+      }
+      crab::crab_string_os o;
+      o << n;
+      return llvm::hash_value(o.str());
+    }
+
+    static std::size_t hash(const lin_cst_sys_t &csts) {
+      llvm::hash_code h = llvm::hash_value(0);
+      for (auto const &cst: csts) {
+	unsigned kind = (cst.is_equality() ? 0 : cst.is_inequality() ? 1 :
+			 cst.is_strict_inequality() ? 2 : 3);
+	h = llvm::hash_combine(h, kind, hash(cst.expression().constant()));
+	for (auto const &t: cst.expression()) {
+	  h = llvm::hash_combine(h, hash(t.first), t.second.index());
+	}
+      }
+      return h;
+    }
+    
+  public:
+    InvariantInterner(): m_num_shared(0) {}
+
+    wrapper_dom_ptr intern(wrapper_dom_ptr absval) {
+      auto &bucket = m_table[hash(absval->to_linear_constraints())];
+      for (auto &other: bucket) {
+	if (other->equals(*absval)) {
+	  m_num_shared++;
+	  return other;
+	}
+      }
+      bucket.push_back(absval);
+      return absval;
+    }
+
+    // number of invariants replaced by an equal one
+    unsigned num_shared() const { return m_num_shared; }
+  };
+  
+  /** update table with pre or post invariants **/
+  inline bool update(abs_dom_map_t &table, 
+		     const llvm::BasicBlock &block, wrapper_dom_ptr absval) {
+    bool already = false;
+    auto it = table.find(&block);
+    if (it == table.end()) {
+      table.insert(std::make_pair(&block, absval));
+    } else {
+      it->second = absval;
+      already = true;
+    }
+    return already;
+  }
+      
+  /** Pretty-printer utilities **/
+  namespace pretty_printer_impl {
+
+    /** Generic class for a block annotation **/
+    class block_annotation {
+    public:
+      typedef typename cfg_ref_t::statement_t statement_t;
+      
+      block_annotation() {}
+      virtual ~block_annotation() {}
+
+      virtual std::string name() const = 0;
+      virtual void print_begin(basic_block_label_t bbl, crab::crab_os &o) const {}
+      virtual void print_end(basic_block_label_t bbl, crab::crab_os &o) const {}
+      virtual void print_begin(const statement_t &s, crab::crab_os &o) const {}
+      virtual void print_end(const statement_t &s, crab::crab_os &o) const {}
+			      
+    };
+
+    /** Annotation for invariants **/
+    class invariant_annotation: public block_annotation {
+    private:
+      const abs_dom_map_t &m_premap;
+      const abs_dom_map_t &m_postmap;
+      std::vector<varname_t> m_shadow_vars;
+      
+    public:
+      invariant_annotation(const llvm_variable_factory &vfac,
+			   const abs_dom_map_t &premap,
+			   const abs_dom_map_t &postmap,
+			   const bool keep_shadows)
+	: block_annotation(), m_premap(premap), m_postmap(postmap) {
+	if (keep_shadows) {
+	  m_shadow_vars.reserve(std::distance(vfac.get_shadow_vars().begin(),
+					      vfac.get_shadow_vars().end()));
+	  m_shadow_vars.insert(m_shadow_vars.begin(),
+			       vfac.get_shadow_vars().begin(),
+			       vfac.get_shadow_vars().end());
+	}
+      }
+      
+      std::string name() const { return "INVARIANTS";}
+
+      wrapper_dom_ptr pre(const llvm::BasicBlock &bb) const {
+	return lookup(m_premap, bb, m_shadow_vars);
+      }
+
+      wrapper_dom_ptr post(const llvm::BasicBlock &bb) const {
+	return lookup(m_postmap, bb, m_shadow_vars);
+      }
+      
+      void print_begin(basic_block_label_t bbl, crab::crab_os &o) const {
+	if (const llvm::BasicBlock *bb = bbl.get_basic_block()) {
+	  wrapper_dom_ptr pre = this->pre(*bb);
+	  o << "  " << name() << ": ";
+	  if (pre){
+	    o << pre << "\n";
+	  } else {
+	    o << "null\n";
+	  }
+	}
+      }
+      
+      void print_end(basic_block_label_t bbl, crab::crab_os &o) const {
+	if (const llvm::BasicBlock *bb = bbl.get_basic_block()) {
+	  wrapper_dom_ptr post = this->post(*bb);
+	  o << "  " << name() << ": ";
+	  if (post) {
+	    o << post << "\n";
+	  } else {
+	    o << "null\n";
+	  }
+	}
+      }
+    };
+
+    /** Annotation for unjustified assumptions done by the analysis **/
+    class unjust_assumption_annotation: public block_annotation {
+    private:
+      typedef typename assumption_analysis<cfg_ref_t>::assumption_ptr assumption_ptr;
+      
+    public:
+      typedef assumption_analysis<cfg_ref_t> unjust_assumption_analysis_t;
+      
+    private:
+      typedef typename cfg_ref_t::statement_t statement_t;
+      
+      cfg_ref_t m_cfg;
+      unjust_assumption_analysis_t *m_analyzer;
+      
+    public:
+      unjust_assumption_annotation(cfg_ref_t cfg, unjust_assumption_analysis_t *analyzer)
+	: block_annotation(), m_cfg(cfg), m_analyzer(analyzer) { }
+      
+      std::string name() const { return "UNJUSTIFIED ASSUMPTIONS";}
+      
+      void print_begin(const statement_t &s, crab::crab_os &o) const {
+	std::vector<assumption_ptr> assumes;
+	if (s.is_assert()) {
+	  typedef typename cfg_ref_t::basic_block_t::assert_t assert_t;
+	  m_analyzer->get_assumptions(static_cast<const assert_t *>(&s), assumes);
+	  if (!assumes.empty()) {
+	    o << "  /** assert verified as ";
+	    for (std::vector<assumption_ptr>::iterator it = assumes.begin(),
+		   et = assumes.end(); it!=et;) {
+	      o << (*it)->get_id_str();
+	      ++it;
+	      if (it != et)
+		o << ",";
+	      else
+		o << ";";
+	    }
+	    o << "**/\n";
+	  }
+	} else {
+	  m_analyzer->get_originated_assumptions(&s, assumes);
+	  for (auto assume_ptr: assumes) {
+	    o << "  /** "; assume_ptr->write(o); o << "**/\n";
+	  }
+	}
+      }
+      
+    };
+    
+    /** Print a block together with its annotations **/
+    class print_block {
+      cfg_ref_t m_cfg;
+      crab::crab_os &m_o;
+      const std::vector<std::unique_ptr<block_annotation>> &m_annotations;
+
+    public:
+      
+      print_block(cfg_ref_t cfg, crab::crab_os &o,
+		   const std::vector<std::unique_ptr<block_annotation>> &annotations)
+	: m_cfg(cfg), m_o(o), m_annotations(annotations) {} 
+
+      void operator()(basic_block_label_t bbl) const {
+	// do not print block if no annotations
+	if (m_annotations.empty()) return;
+	
+	m_o << bbl.get_name() << ":\n";
+
+	// block annotations are buffered to know whether they are empty
+	std::string buf;
+	{
+	  llvm::raw_string_ostream raw(buf);
+	  crab_raw_os o(raw);
+	  for (auto& p: m_annotations) {
+	    p->print_begin(bbl,o);
+	  }
+	}
+	if (!buf.empty()) {
+	  m_o << "/**\n" << buf << "**/\n";
+	}
+	
+	const basic_block_t &bb = m_cfg.get_node(bbl);
+	bool empty_block = (std::distance(bb.begin(), bb.end()) == 0);
+	for (auto const &s: bb) {
+	  for (auto& p: m_annotations) {
+	    p->print_begin(s, m_o);
+	  }	  
+	  m_o << "  " << s << ";\n";
+	  for (auto& p: m_annotations) {
+	    p->print_end(s, m_o);
+	  }	  
+	}
+	if (!empty_block) {
+	  buf.clear();
+	  {
+	    llvm::raw_string_ostream raw(buf);
+	    crab_raw_os o(raw);
+	    for (auto& p: m_annotations) {
+	      p->print_end(bbl, o);
+	    }
+	  }
+	  if (!buf.empty()) {
+	    m_o << "/**\n" << buf << "**/\n";
+	  }
+	}
+
+	std::pair<cfg_ref_t::const_succ_iterator, 
+		  cfg_ref_t::const_succ_iterator> p = bb.next_blocks();
+	cfg_ref_t::const_succ_iterator it = p.first;
+	cfg_ref_t::const_succ_iterator et = p.second;
+	if (it != et) {
+	  m_o << "  " << "goto ";
+	  for (; it != et; ) {
+	    m_o << crab::cfg_impl::get_label_str(*it);
+	    ++it;
+	    if (it == et) {
+	      m_o << ";";
+	    } else {
+	      m_o << ",";
+	    }
+	  }
+	}
+	m_o << "\n";
+      }
+    };
+
+    typedef std::unordered_set<basic_block_label_t> visited_t;
+    template<typename T>
+    void dfs_rec(cfg_ref_t cfg, basic_block_label_t curId, visited_t &visited, T f) {
+      if (visited.find(curId) != visited.end()) return;
+      visited.insert(curId);
+      const basic_block_t &cur = cfg.get_node(curId);
+      f(curId);
+      for (auto const n : llvm::make_range(cur.next_blocks())) {
+    	dfs_rec(cfg, n, visited, f);
+      }
+    }
+    
+    template<typename T>
+    void dfs(cfg_ref_t cfg, T f) {
+      visited_t visited;
+      dfs_rec(cfg, cfg.entry(), visited, f);
+    }
+
+    inline void print_annotations(cfg_ref_t cfg, crab::crab_os &o,
+			   const std::vector<std::unique_ptr<block_annotation>> &annotations) {
+      print_block f(cfg, o, annotations);
+      dfs(cfg, f);
+    }
+
+    /** Print one line per LLVM block: "fn:block pre: <inv> post: <inv>" **/
+    class print_compact_block {
+      llvm::StringRef m_fname;
+      const invariant_annotation &m_invs;
+      llvm::raw_ostream &m_o;
+
+      void print(const wrapper_dom_ptr &inv) const {
+	if (inv) {
+	  crab_raw_os o(m_o, true /*single line*/);
+	  o << inv;
+	} else {
+	  m_o << "null";
+	}
+      }
+      
+    public:
+      print_compact_block(llvm::StringRef fname, const invariant_annotation &invs,
+			  llvm::raw_ostream &o)
+	: m_fname(fname), m_invs(invs), m_o(o) {}
+
+      void operator()(basic_block_label_t bbl) const {
+	// blocks that correspond to LLVM edges are not printed
+	const llvm::BasicBlock *bb = bbl.get_basic_block();
+	if (!bb) return;
+	m_o << m_fname << ":" << bbl.get_name() << " pre: ";
+	print(m_invs.pre(*bb));
+	m_o << " post: ";
+	print(m_invs.post(*bb));
+	m_o << "\n";
+      }
+    };
+    
+    inline void print_compact_invariants(cfg_ref_t cfg, llvm::StringRef fname,
+					 const invariant_annotation &invs,
+					 llvm::raw_ostream &o) {
+      print_compact_block f(fname, invs, o);
+      dfs(cfg, f);
+    }
+  } //end namespace
+
+  inline std::string dom_to_str(CrabDomain dom) {
+    switch (dom) {
+    case INTERVALS:             return interval_domain_t::getDomainName();
+    case DENSE_INTERVALS:       return dense_interval_domain_t::getDomainName();
+    case INTERVALS_CONGRUENCES: return ric_domain_t::getDomainName();
+    case BOXES:                 return boxes_domain_t::getDomainName();
+    case DIS_INTERVALS:         return dis_interval_domain_t::getDomainName();
+    case ZONES_SPLIT_DBM:       return split_dbm_domain_t::getDomainName();
+    case TERMS_DIS_INTERVALS:   return term_dis_int_domain_t::getDomainName();
+    case TERMS_ZONES:           return num_domain_t::getDomainName();
+    case OCT:                   return oct_domain_t::getDomainName();
+    case PACKED_OCT:            return oct_domain_t::getDomainName();
+    case PK:                    return pk_domain_t::getDomainName();
+    case WRAPPED_INTERVALS:     return wrapped_interval_domain_t::getDomainName();
+    default:                    return "none";
+    }
+  }
+  
+  /** fill the size and liveness statistics of the CFG of a function **/
+  inline void getCfgStats(CfgBuilder &builder, ClamFunctionStats &stats) {
+    cfg_ref_t cfg = builder.get_cfg();
+    stats.num_blocks = std::distance(cfg.label_begin(), cfg.label_end());
+    stats.num_stmts = 0;
+    for (auto &bb: llvm::make_range(cfg.begin(), cfg.end())) {
+      stats.num_stmts += std::distance(bb.begin(), bb.end());
+    }
+    stats.has_live = builder.get_live_stats(stats.total_live,
+					    stats.max_live_per_blk,
+					    stats.avg_live_per_blk);
+  }
+  
+  // Upper bound on the widening delay chosen from the loop nests
+  static const unsigned MAX_AUTO_WIDENING_DELAY = 8;
+  
+  // Size of the jump set to keep all the thresholds, bounded by
+  // max_size if not zero.
+  static inline unsigned chooseJumpSetSize(const WideningThresholds &thresholds,
+					   unsigned max_size) {
+    unsigned size = thresholds.jump_set_size();
+    if (max_size > 0) {
+      size = std::min(size, max_size);
+    }
+    CRAB_VERBOSE_IF(1,
+		    crab::outs() << "Widening thresholds: "
+		                 << thresholds.num_constants() << "\n"
+		                 << "Jump set size: " << size << "\n");
+    CRAB_LOG("clam-thresholds", thresholds.write(crab::outs()));
+    return size;
+  }
+
+  // Scale an array limit so that a function with few arrays can
+  // afford larger arrays than one with many. The result is within
+  // [limit/4, limit*4].
+  static inline unsigned scaleArrayLimit(unsigned limit, unsigned num_arrays) {
+    const unsigned num_reference_arrays = 16;
+    uint64_t scaled =
+      (uint64_t) limit * num_reference_arrays / std::max(num_arrays, 1U);
+    uint64_t lb = std::max(limit / 4, 1U);
+    uint64_t ub = (uint64_t) limit * 4;
+    return (unsigned) std::min(std::max(scaled, lb), ub);
+  }
+
+  static inline void chooseArrayLimits(AnalysisParams &params,
+				       unsigned num_arrays) {
+    params.auto_array_limits = false;
+    params.array_max_smashable_cells =
+      scaleArrayLimit(params.array_max_smashable_cells, num_arrays);
+    params.array_max_size = scaleArrayLimit(params.array_max_size, num_arrays);
+    CRAB_VERBOSE_IF(1,
+		    crab::outs() << "Arrays: " << num_arrays << "\n"
+		                 << "Array max smashable cells: "
+		                 << params.array_max_smashable_cells << "\n"
+		                 << "Array max size: "
+		                 << params.array_max_size << "\n");
+  }
+
+  // The array adaptive domain reads its limits from static members.
+  // If the builder tagged the arrays of the function (reprs) then the
+  // arrays are expanded up to the size of the largest one tagged to
+  // be expanded, and all smashed if none is.
+  static inline void setArrayLimits(const AnalysisParams &params,
+				    const CfgBuilder::array_repr_map_t *reprs = nullptr) {
+#ifdef HAVE_ARRAY_ADAPT
+    ArrayAdaptParams::max_smashable_cells = params.array_max_smashable_cells;
+    ArrayAdaptParams::max_array_size = params.array_max_size;
+    if (reprs && !reprs->empty()) {
+      uint64_t max_expand = 0;
+      for (auto &kv: *reprs) {
+	if (kv.second.repr == CfgBuilder::array_repr_t::EXPAND) {
+	  max_expand = std::max(max_expand, kv.second.elems);
+	}
+      }
+      ArrayAdaptParams::max_array_size =
+	(unsigned) std::min<uint64_t>(max_expand, params.array_max_size);
+    }
+#endif
+  }
+  
+  /**
+   * Threads that run the asynchronous path queries of a function
+   * (IntraClam::path_analyze_async) in the order they are submitted.
+   * The destructor waits for the queries already submitted.
+   **/
+  class PathQueryPool {
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_queue;
+    std::vector<std::thread> m_threads;
+    bool m_stop;
+
+    void work() {
+      while (true) {
+	std::function<void()> task;
+	{
+	  std::unique_lock<std::mutex> lock(m_mutex);
+	  m_cv.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+	  if (m_queue.empty()) {
+	    return;
+	  }
+	  task = std::move(m_queue.front());
+	  m_queue.pop_front();
+	}
+	task();
+      }
+    }
+
+  public:
+    PathQueryPool(unsigned num_threads): m_stop(false) {
+      for (unsigned i = 0; i < std::max(num_threads, 1u); ++i) {
+	m_threads.emplace_back([this]() { work(); });
+      }
+    }
+
+    PathQueryPool(const PathQueryPool &o) = delete;
+    PathQueryPool &operator=(const PathQueryPool &o) = delete;
+
+    ~PathQueryPool() {
+      {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stop = true;
+      }
+      m_cv.notify_all();
+      for (auto &t: m_threads) {
+	t.join();
+      }
+    }
+
+    void submit(std::function<void()> task) {
+      {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_queue.push_back(std::move(task));
+      }
+      m_cv.notify_one();
+    }
+  };
+
+  /**
+   * Internal implementation of the intra-procedural analysis
+   **/
+  class IntraClam_Impl {
+  public:
+    IntraClam_Impl(const Function &fun, CrabBuilderManager &man)
+      : m_cfg_builder(nullptr), m_fun(fun), m_vfac(man.get_var_factory()) {
+
+      initDomains();
+      
+      if (isTrackable(m_fun)) {
+	if (!man.has_cfg(m_fun)) {
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+			  << "Started Crab CFG construction for "
+			  << fun.getName() << "\n");	  
+	  m_cfg_builder = man.mk_cfg_builder(m_fun);
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+			  << "Finished Crab CFG construction for "
+			  << fun.getName() << "\n");	
+	} else {
+	  m_cfg_builder = man.get_cfg_builder(m_fun);
+	}
+      } else {
+	CRAB_VERBOSE_IF(1, llvm::outs() << "Cannot build CFG for "
+			                << fun.getName() << "\n");
+      }
+    }
+
+    void Analyze(AnalysisParams &params,
+		 const llvm::BasicBlock *entry,
+		 // assumptions can be provided in abs_dom format or
+		 // as linear constraints.
+		 const abs_dom_map_t  &abs_dom_assumptions,
+		 const lin_csts_map_t &lin_csts_assumptions,
+		 AnalysisResults &results) {
+
+      if (!m_cfg_builder) {
+	CRAB_VERBOSE_IF(1, llvm::outs() << "Skipped analysis for "
+			                << m_fun.getName() << "\n");
+	return;
+      }
+
+      // -- the invariants keep the names of the function alive even if
+      //    its builder is released or built again
+      if (auto scope = m_cfg_builder->get_var_scope()) {
+	results.premap.set_owner(m_fun, scope);
+	results.postmap.set_owner(m_fun, scope);
+      }
+
+      if (params.auto_widening_jumpset) {
+	WideningThresholds thresholds(m_cfg_builder->get_cfg());
+	AnalysisParams th_params(params);
+	th_params.auto_widening_jumpset = false;
+	th_params.widening_jumpset =
+	  chooseJumpSetSize(thresholds, params.widening_jumpset);
+	Analyze(th_params, entry, abs_dom_assumptions, lin_csts_assumptions,
+		results);
+	return;
+      }
+
+      if (params.auto_widening_delay) {
+	WideningDelay delays(m_fun, MAX_AUTO_WIDENING_DELAY);
+	CRAB_VERBOSE_IF(1, crab::outs() << "Widening delay: " << delays.delay() << "\n");
+	CRAB_LOG("clam-widening-delay", delays.write(crab::outs()));
+	AnalysisParams wd_params(params);
+	wd_params.auto_widening_delay = false;
+	wd_params.widening_delay = delays.delay();
+	m_stats.loops = delays.loops();
+	Analyze(wd_params, entry, abs_dom_assumptions, lin_csts_assumptions,
+		results);
+	return;
+      }
+
+      if (params.auto_array_limits) {
+	AnalysisParams ar_params(params);
+	chooseArrayLimits(ar_params, numArrayVars(m_cfg_builder->get_cfg()));
+	Analyze(ar_params, entry, abs_dom_assumptions, lin_csts_assumptions,
+		results);
+	return;
+      }
+
+      ClamStats::ScopedFunction fscope(m_fun.getName());
+      m_stats.name = m_fun.getName();
+      m_stats.widening_delay = params.widening_delay;
+      if (params.should_stop()) {
+	m_stats.cancelled = true;
+	ClamStats::count("Analysis.Cancelled");
+	return;
+      }
+      setArrayLimits(params, &m_cfg_builder->get_array_reprs());
+
+      const liveness_t* live = nullptr;
+      // -- the live symbols are shared by the analyses of the cfg
+      //    that run concurrently so they are read from a frozen view
+      std::shared_ptr<const FrozenCfg> frozen;
+      if (params.run_liveness || isRelationalDomain(params.dom) ||
+	  params.stats_json) {
+	// -- run liveness
+	m_cfg_builder->compute_live_symbols();
+	if (isRelationalDomain(params.dom)) {
+	  frozen = m_cfg_builder->freeze();
+	  live = frozen->get_live_symbols();
+	  assert(live);	  
+	  unsigned max_live_per_blk = frozen->get_max_live_per_blk();
+	  CRAB_VERBOSE_IF(1, 
+		    crab::outs() << "Max live per block: "
+		                 << max_live_per_blk << "\n"
+		                 << "Threshold: "
+		                 << params.relational_threshold << "\n");
+#ifdef HAVE_ALL_DOMAINS	  
+	  if (max_live_per_blk > params.relational_threshold &&
+	      intra_analyses().count(INTERVALS)) {
+	    // default domain
+	    params.dom = INTERVALS;
+	  }
+#endif 	  
+	}
+      }
+
+#ifdef HAVE_ALL_DOMAINS
+      if (params.max_estimated_cost > 0 && params.dom != INTERVALS &&
+	  intra_analyses().count(INTERVALS)) {
+	AnalysisCost cost(m_fun, *m_cfg_builder);
+	double estimated = cost.estimate(params.dom, params);
+	if (estimated > params.max_estimated_cost) {
+	  CRAB_VERBOSE_IF(1, crab::outs() << "Estimated cost " << estimated
+			  << " exceeds " << params.max_estimated_cost << "\n");
+	  params.dom = INTERVALS;
+	}
+      }
+#endif
+
+      getCfgStats(*m_cfg_builder, m_stats);
+      
+      if (CrabBuildOnlyCFG) {
+	return;
+      }
+
+      if (params.check == NULLITY) {
+	checkNullity(results);
+	return;
+      }
+      
+      if (intra_analyses().count(params.dom)) {
+	m_stats.domain = dom_to_str(params.dom);
+	unsigned safe = results.checksdb.get_total_safe();
+	unsigned err = results.checksdb.get_total_error();
+	unsigned warn = results.checksdb.get_total_warning();
+	auto start = std::chrono::steady_clock::now();
+	if ((params.fun_timeout > 0 || params.fun_mem_limit > 0 ||
+	     params.fun_rss_limit > 0) &&
+	    abs_dom_assumptions.empty() && lin_csts_assumptions.empty()) {
+	  analyzeWithBudget(params, entry, (params.run_liveness)? live : nullptr,
+			    results);
+	  m_stats.domain = dom_to_str(params.dom);
+	} else if (params.staged && params.check && params.dom != INTERVALS &&
+		   intra_analyses().count(INTERVALS) &&
+		   abs_dom_assumptions.empty() && lin_csts_assumptions.empty()) {
+	  analyzeStaged(params, entry, (params.run_liveness)? live : nullptr,
+			results);
+	} else {
+	  intra_analyses().at(params.dom).analyze(this, params, entry,
+						abs_dom_assumptions, lin_csts_assumptions,
+						(params.run_liveness)? live : nullptr,
+						results);
+	}
+	m_stats.analysis_time = std::chrono::duration<double>
+	  (std::chrono::steady_clock::now() - start).count();
+	m_stats.safe_checks = results.checksdb.get_total_safe() - safe;
+	m_stats.error_checks = results.checksdb.get_total_error() - err;
+	m_stats.warning_checks = results.checksdb.get_total_warning() - warn;
+      } else {
+      	crab::outs() << "Warning: abstract domain not found or enabled.\n"
+		     << "Compile with -DALL_DOMAINS=ON.\n";
+	// crab::outs() << "Running " << intra_analyses.at(INTERVALS).name << " ...\n"; 
+      	// intra_analyses.at(INTERVALS).analyze(params, entry, assumptions,
+	// 				   (params.run_liveness)? live : nullptr,
+	// 				    results);
+      }
+    }
+    
+    // The null checks do not need the numerical invariants: they are
+    // proven by a nullness analysis of the CFG alone.
+    void checkNullity(AnalysisResults &results) {
+      unsigned safe = results.checksdb.get_total_safe();
+      unsigned err = results.checksdb.get_total_error();
+      unsigned warn = results.checksdb.get_total_warning();
+      auto start = std::chrono::steady_clock::now();
+      CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+		      << "Running nullity analysis for " << m_fun.getName() << "\n");
+      NullityAnalysis nullity(get_cfg());
+      CRAB_LOG("clam-nullity", nullity.write(crab::outs()));
+      nullity.check(results.checksdb);
+      m_stats.domain = "nullity";
+      m_stats.analysis_time = std::chrono::duration<double>
+	(std::chrono::steady_clock::now() - start).count();
+      m_stats.safe_checks = results.checksdb.get_total_safe() - safe;
+      m_stats.error_checks = results.checksdb.get_total_error() - err;
+      m_stats.warning_checks = results.checksdb.get_total_warning() - warn;
+    }
+    
+    bool pathAnalyze(const AnalysisParams& params,
+		     const std::vector<const llvm::BasicBlock*>& blocks,
+		     bool layered_solving, 
+		     std::vector<crab::cfg::statement_wrapper>& core,
+		     bool populate_inv_map, abs_dom_map_t& post) {
+
+      assert(m_cfg_builder);
+
+      // build the full path (included internal basic blocks added
+      // during the translation to Crab)
+      std::vector<basic_block_label_t> path;
+      path.reserve(blocks.size());
+      for(unsigned i=0; i < blocks.size(); ++i) {
+	path.push_back(m_cfg_builder->get_crab_basic_block(blocks[i]));
+	if (i < blocks.size() - 1) {
+	  if (const basic_block_label_t* edge_bb =
+	      m_cfg_builder->get_crab_basic_block(blocks[i], blocks[i+1])) {
+	    path.push_back(*edge_bb);
+	  }
+	}
+      }
+
+      bool res;
+      if (params.path_portfolio) {
+	res = portfolioPathAnalyze(params, path, layered_solving, core,
+				   populate_inv_map, post);
+      } else if (path_analyses().count(params.dom)) {
+      	path_analyses().at(params.dom).analyze(this, params, path, core, layered_solving , populate_inv_map,
+					     post, res, nullptr);
+      } else {
+      	crab::outs() << "Warning: abstract domain not found or enabled.\n"
+		     << "Compile with -DALL_DOMAINS=ON.\n";
+	// crab::outs() << "Running " << path_analyses.at(INTERVALS).name << " ...\n";
+      	// path_analyses.at(INTERVALS).analyze(path, core, layered_solving, populate_inv_map,
+	// 				    post, res);
+      }
+      return res;
+    }
+
+    std::future<IntraClam::path_result_t>
+    pathAnalyzeAsync(const AnalysisParams& params,
+		     const std::vector<const llvm::BasicBlock*>& blocks,
+		     bool layered_solving) {
+      assert(m_cfg_builder);
+      {
+	std::lock_guard<std::mutex> lock(m_path_pool_mutex);
+	if (!m_path_pool) {
+	  unsigned num_threads = params.path_threads > 0 ? params.path_threads :
+	    std::thread::hardware_concurrency();
+	  m_path_pool.reset(new PathQueryPool(num_threads));
+	}
+      }
+      ClamStats::count("PathAnalysis.Async.Queries");
+      auto promise = std::make_shared<std::promise<IntraClam::path_result_t>>();
+      std::future<IntraClam::path_result_t> future = promise->get_future();
+      m_path_pool->submit([this, params, blocks, layered_solving, promise]() {
+	  // -- the cfg cannot change while the query runs
+	  std::shared_ptr<const FrozenCfg> frozen = m_cfg_builder->freeze();
+	  IntraClam::path_result_t result;
+	  result.feasible = pathAnalyze(params, blocks, layered_solving,
+					result.core, true, result.post);
+	  promise->set_value(std::move(result));
+	});
+      return future;
+    }
+
+    ~IntraClam_Impl() {
+      // -- the pending path queries use the rest of the members
+      m_path_pool.reset();
+    }
+    
+    const ClamFunctionStats& get_stats() const { return m_stats; }
+    
+  private:
+    
+    CrabBuilderManager::CfgBuilderPtr m_cfg_builder;
+    const Function &m_fun;
+    llvm_variable_factory &m_vfac;
+    ClamFunctionStats m_stats;
+
+    // helper to get a reference to a crab cfg from the builder
+    cfg_t& get_cfg() { return m_cfg_builder->get_cfg(); }
+
+    bool hasBoolAsserts() {
+      for (auto &bb: llvm::make_range(get_cfg().begin(), get_cfg().end())) {
+	for (auto &s: bb) {
+	  if (s.is_bool_assert()) {
+	    return true;
+	  }
+	}
+      }
+      return false;
+    }
+
+    // Blocks from which a call to an assert or error function is
+    // reachable
+    std::set<const BasicBlock*> getConeOfChecks() const {
+      std::set<const BasicBlock*> cone;
+      std::vector<const BasicBlock*> worklist;
+      for (auto &I: instructions(m_fun)) {
+	ImmutableCallSite CS(&I);
+	if (!CS) continue;
+	const Function *callee =
+	  dyn_cast<Function>(CS.getCalledValue()->stripPointerCasts());
+	if (callee && (isAssertFn(*callee) || isErrorFn(*callee)) &&
+	    cone.insert(I.getParent()).second) {
+	  worklist.push_back(I.getParent());
+	}
+      }
+      while (!worklist.empty()) {
+	const BasicBlock *B = worklist.back();
+	worklist.pop_back();
+	for (const BasicBlock *pred: llvm::predecessors(B)) {
+	  if (cone.insert(pred).second) {
+	    worklist.push_back(pred);
+	  }
+	}
+      }
+      return cone;
+    }
+
+    // Analyze with intervals and, if some checks are not proven,
+    // again with params.dom. The second analysis assumes the interval
+    // invariants at the entry of the blocks that reach a check so
+    // that it only needs to find the relations between variables.
+    void analyzeStaged(AnalysisParams &params, const BasicBlock *entry,
+		       const liveness_t *live, AnalysisResults &results) {
+      abs_dom_map_t pre, post;
+      edges_set edges;
+      checks_db_t db;
+      AnalysisResults int_results(pre, post, edges, db);
+      AnalysisParams int_params(params);
+      int_params.dom = INTERVALS;
+      int_params.store_invariants = true;
+      int_params.print_invars = false;
+      int_params.print_invars_compact = false;
+      int_params.profile_fixpoint = false;
+      intra_analyses().at(INTERVALS).analyze(this, int_params, entry, abs_dom_map_t(),
+					   lin_csts_map_t(), live, int_results);
+      if (db.get_total_warning() == 0) {
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+			<< "All checks of " << m_fun.getName()
+			<< " proven with intervals.\n");
+	m_stats.domain = dom_to_str(INTERVALS);
+	if (params.store_invariants) {
+	  for (auto &kv: pre) {
+	    update(results.premap, *kv.first, kv.second);
+	  }
+	  for (auto &kv: post) {
+	    update(results.postmap, *kv.first, kv.second);
+	  }
+	}
+	results.infeasible_edges.insert(edges);
+	results.checksdb += db;
+	return;
+      }
+      lin_csts_map_t seeds;
+      for (const BasicBlock *B: getConeOfChecks()) {
+	auto it = pre.find(B);
+	if (it != pre.end() && !it->second->is_top()) {
+	  seeds.insert({B, it->second->to_linear_constraints()});
+	}
+      }
+      CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+		      << db.get_total_warning() << " checks of " << m_fun.getName()
+		      << " not proven with intervals. Assuming the interval"
+		      << " invariants of " << seeds.size() << " blocks.\n");
+      intra_analyses().at(params.dom).analyze(this, params, entry, abs_dom_map_t(),
+					    seeds, live, results);
+    }
+
+    // Return the sorted variables of the packs of at most pack_size
+    // variables that overflow (see VariablePacking). These are the
+    // variables that PACKED_OCT does not relate.
+    std::vector<var_t> getOverflowVars(unsigned pack_size) {
+      VariablePacking packs(m_cfg_builder->get_cfg(), pack_size);
+      std::vector<var_t> vars = packs.get_overflow_vars();
+      std::sort(vars.begin(), vars.end());
+      CRAB_VERBOSE_IF(1,
+		crab::outs() << "Variables: " << packs.num_vars() << "\n"
+		             << "Packs: " << packs.num_packs() << "\n"
+		             << "Max pack size: " << packs.max_pack_size() << "\n"
+		             << "Pack size bound: " << pack_size << "\n"
+		             << "Variables of overflowing packs: " << vars.size() << "\n");
+      CRAB_LOG("clam-packing", packs.write(crab::outs()));
+      return vars;
+    }
+
+    // NOT_STORED: the child finished but its results are not in the
+    // cache (e.g., the cache directory is full or not writable)
+    enum budget_status_t { WITHIN_BUDGET, OUT_OF_TIME, OUT_OF_MEMORY, FAILED,
+			   CANCELLED, NOT_STORED };
+
+    static const char *budget_status_to_str(budget_status_t status) {
+      switch (status) {
+      case WITHIN_BUDGET: return "within budget";
+      case OUT_OF_TIME:   return "timeout";
+      case OUT_OF_MEMORY: return "rss";
+      case CANCELLED:     return "cancelled";
+      case NOT_STORED:    return "not stored";
+      default:            return "failed";
+      }
+    }
+
+    // Period of the checks of the resident memory and of the
+    // cancellation while a child analyzes a function
+    static const unsigned BUDGET_POLL_MS = 50;
+
+    // Next domain of params.downgrade_chain that was not tried yet,
+    // starting after dom if dom is in the chain. Return false if none.
+    bool nextDomain(const AnalysisParams &params, CrabDomain dom,
+		    const std::set<CrabDomain> &tried, CrabDomain &next) {
+      const std::vector<CrabDomain> &chain = params.downgrade_chain;
+      auto it = std::find(chain.begin(), chain.end(), dom);
+      it = (it == chain.end() ? chain.begin() : std::next(it));
+      for (; it != chain.end(); ++it) {
+	if (!tried.count(*it) && intra_analyses().count(*it)) {
+	  next = *it;
+	  return true;
+	}
+      }
+      return false;
+    }
+
+#ifdef LLVM_ON_UNIX
+    // Run the analysis of the function in a child process within the
+    // time and memory budgets of params. The child stores its results
+    // in the cache at params.cache_dir. params.fun_mem_limit bounds
+    // the address space that the child adds to the one inherited from
+    // this process. The resident memory of the child is polled while
+    // it runs, so the analysis is stopped in the middle of the
+    // fixpoint when it grows by more than params.fun_rss_limit. The
+    // child is also killed at the deadline or if params.should_stop().
+    // This thread waits on a timer until the child exits, the deadline
+    // or the next poll (only if there is something to poll).
+    budget_status_t analyzeInChild(const AnalysisParams &params,
+				   const BasicBlock *entry,
+				   const liveness_t *live) {
+      llvm::outs().flush();
+      llvm::errs().flush();
+      std::cout.flush();
+      // -- the child starts with the resident pages of this process
+      //    (shared until written) so only its growth is charged to
+      //    the function
+      long base_rss = params.fun_rss_limit > 0 ? residentMemoryMB() : 0;
+      pid_t pid = fork();
+      if (pid < 0) {
+	CLAM_WARNING("cannot fork to analyze " << m_fun.getName()
+		     << " within budget. Running without budget.");
+	abs_dom_map_t pre, post;
+	edges_set edges;
+	checks_db_t db;
+	AnalysisResults res(pre, post, edges, db);
+	intra_analyses().at(params.dom).analyze(this, params, entry, abs_dom_map_t(),
+					      lin_csts_map_t(), live, res);
+	return WITHIN_BUDGET;
+      }
+      
+      if (pid == 0) {
+	if (params.fun_mem_limit > 0) {
+	  // -- the address space inherited from the parent is not
+	  //    charged to the function
+	  long base = std::max(addressSpaceMB(), 0L);
+	  struct rlimit rl;
+	  rl.rlim_cur = rl.rlim_max = (rlim_t) (base + params.fun_mem_limit) << 20;
+	  setrlimit(RLIMIT_AS, &rl);
+	}
+	// the parent prints the results after loading them
+	AnalysisParams cparams(params);
+	cparams.print_invars = false;
+	cparams.print_unjustified_assumptions = false;
+	cparams.store_invariants = false;
+	// the parent checks the cancellation and calls yield
+	cparams.cancel_token.reset();
+	cparams.yield = nullptr;
+	abs_dom_map_t pre, post;
+	edges_set edges;
+	checks_db_t db;
+	AnalysisResults res(pre, post, edges, db);
+	intra_analyses().at(cparams.dom).analyze(this, cparams, entry, abs_dom_map_t(),
+					       lin_csts_map_t(), live, res);
+	llvm::outs().flush();
+	std::cout.flush();
+	_exit(0);
+      }
+
+      // -- the reaper blocks until the child exits but leaves it as a
+      //    zombie (WNOWAIT) so that pid cannot be reused before this
+      //    thread kills it or reaps it
+      std::mutex mutex;
+      std::condition_variable cv;
+      bool exited = false;
+      std::thread reaper([pid, &mutex, &cv, &exited]() {
+	  siginfo_t info;
+	  while (waitid(P_PID, pid, &info, WEXITED | WNOWAIT) < 0 && errno == EINTR) {}
+	  std::lock_guard<std::mutex> lock(mutex);
+	  exited = true;
+	  cv.notify_one();
+	});
+      // -- the cancellation and yield are checked from this thread
+      bool poll = (params.fun_rss_limit > 0 && base_rss >= 0) ||
+	params.cancel_token || params.yield;
+      auto deadline = std::chrono::steady_clock::now() +
+	std::chrono::seconds(params.fun_timeout);
+      budget_status_t exceeded = WITHIN_BUDGET;
+      std::unique_lock<std::mutex> lock(mutex);
+      while (!exited) {
+	auto now = std::chrono::steady_clock::now();
+	if (params.fun_timeout > 0 && now >= deadline) {
+	  exceeded = OUT_OF_TIME;
+	} else if (params.fun_rss_limit > 0 && base_rss >= 0) {
+	  long rss = residentMemoryMB(pid);
+	  if (rss >= 0 && rss - base_rss > (long) params.fun_rss_limit) {
+	    exceeded = OUT_OF_MEMORY;
+	  }
+	}
+	if (exceeded == WITHIN_BUDGET && poll) {
+	  lock.unlock();
+	  if (params.should_stop()) {
+	    exceeded = CANCELLED;
+	  }
+	  lock.lock();
+	}
+	if (exceeded != WITHIN_BUDGET) {
+	  kill(pid, SIGKILL);
+	  break;
+	}
+	if (poll) {
+	  auto wake = now + std::chrono::milliseconds(BUDGET_POLL_MS);
+	  if (params.fun_timeout > 0) {
+	    wake = std::min(wake, deadline);
+	  }
+	  cv.wait_until(lock, wake, [&exited]() { return exited; });
+	} else if (params.fun_timeout > 0) {
+	  cv.wait_until(lock, deadline, [&exited]() { return exited; });
+	} else {
+	  cv.wait(lock, [&exited]() { return exited; });
+	}
+      }
+      lock.unlock();
+      reaper.join();
+      int status;
+      while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+      if (exceeded != WITHIN_BUDGET) {
+	return exceeded;
+      }
+      // -- the child also fails if it reaches params.fun_mem_limit
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+	return FAILED;
+      }
+      std::string key = getCacheKey(params, dom_to_str(params.dom), entry, live);
+      return (AnalysisCache(params.cache_dir).contains(key) ? WITHIN_BUDGET : NOT_STORED);
+    }
+#endif 
+
+    // Analyze the function within the time and memory budgets of
+    // params. If the budget is exceeded then the function is analyzed
+    // again with the next domain of params.downgrade_chain (by
+    // default, intervals) and, as a last resort, all its invariants
+    // are top and all its checks are warnings. The results are passed
+    // through the cache so the same limitations apply (see
+    // AnalysisCache.hh). If they cannot be stored then the function
+    // has no invariants and all its checks are warnings. params.dom is
+    // updated with the domain used.
+    void analyzeWithBudget(AnalysisParams &params, const BasicBlock *entry,
+			   const liveness_t *live, AnalysisResults &results) {
+#ifdef LLVM_ON_UNIX
+      std::string dir = params.cache_dir;
+      bool remove_dir = false;
+      if (dir.empty()) {
+	SmallString<128> path;
+	if (std::error_code ec = sys::fs::createUniqueDirectory("clam-budget", path)) {
+	  CLAM_WARNING("cannot create temporary directory: " << ec.message()
+		       << ". Running without budget.");
+	  intra_analyses().at(params.dom).analyze(this, params, entry, abs_dom_map_t(),
+						lin_csts_map_t(), live, results);
+	  return;
+	}
+	dir = path.str();
+	remove_dir = true;
+      }
+
+      AnalysisParams fparams(params);
+      fparams.cache_dir = dir;
+      std::set<CrabDomain> tried;
+      budget_status_t status;
+      while ((status = analyzeInChild(fparams, entry, live)) != WITHIN_BUDGET) {
+	if (status == NOT_STORED) {
+	  // -- the other domains would not be stored either
+	  break;
+	}
+	if (status == CANCELLED) {
+	  // -- not a downgrade: the function has no results
+	  m_stats.cancelled = true;
+	  ClamStats::count("Analysis.Cancelled");
+	  if (remove_dir) {
+	    sys::fs::remove_directories(dir);
+	  }
+	  return;
+	}
+	tried.insert(fparams.dom);
+	CrabDomain next = fparams.dom;
+	bool has_fallback = nextDomain(fparams, fparams.dom, tried, next);
+	CLAM_WARNING(m_fun.getName() << " exceeded its analysis budget ("
+		     << budget_status_to_str(status) << ") with "
+		     << dom_to_str(fparams.dom)
+		     << (has_fallback ? ". Trying with " + dom_to_str(next) + "."
+			 : std::string(". Assuming top.")));
+	// -- record the downgrade
+	m_stats.downgrades.push_back(dom_to_str(fparams.dom));
+	ClamStats::count("Downgrade.total");
+	ClamStats::count(std::string("Downgrade.") + budget_status_to_str(status));
+	if (!has_fallback) {
+	  // -- mark all the invariants as top
+	  AnalysisCache::FunctionResults top;
+	  for (auto &B: m_fun) {
+	    top.pre[&B] = AnalysisCache::Invariant();
+	    top.post[&B] = AnalysisCache::Invariant();
+	  }
+	  if (fparams.check) {
+	    for (auto &bb: llvm::make_range(get_cfg().begin(), get_cfg().end())) {
+	      for (auto &s: bb) {
+		if (!s.is_assert()) continue;
+		top.warning_checks++;
+		if (s.get_debug_info().has_debug()) {
+		  top.checks.push_back(toCachedCheck(s.get_debug_info(), _WARN));
+		}
+	      }
+	    }
+	  }
+	  std::string key = getCacheKey(fparams, dom_to_str(fparams.dom), entry, live);
+	  AnalysisCache(dir).store(key, m_fun, top);
+	  if (!AnalysisCache(dir).contains(key)) {
+	    status = NOT_STORED;
+	  }
+	  break;
+	}
+	fparams.dom = next;
+      }
+      if (status == NOT_STORED) {
+	// -- the results cannot be passed through the cache: the
+	//    function is not analyzed again here without budget
+	CLAM_WARNING("the results of " << m_fun.getName()
+		     << " cannot be stored in the cache at " << dir
+		     << ". Assuming top.");
+	ClamStats::count("Budget.NotStored");
+	if (fparams.check) {
+	  for (auto &bb: llvm::make_range(get_cfg().begin(), get_cfg().end())) {
+	    for (auto &s: bb) {
+	      if (s.is_assert()) results.checksdb.add(_WARN, s.get_debug_info());
+	    }
+	  }
+	}
+	params.dom = fparams.dom;
+	if (remove_dir) {
+	  sys::fs::remove_directories(dir);
+	}
+	return;
+      }
+      // -- load the results from the cache
+      intra_analyses().at(fparams.dom).analyze(this, fparams, entry, abs_dom_map_t(),
+					     lin_csts_map_t(), live, results);
+      params.dom = fparams.dom;
+      
+      if (remove_dir) {
+	sys::fs::remove_directories(dir);
+      }
+#else
+      CLAM_WARNING("analysis budgets are only supported on Unix");
+      intra_analyses().at(params.dom).analyze(this, params, entry, abs_dom_map_t(),
+					    lin_csts_map_t(), live, results);
+#endif       
+    }
+    
+    // Return the cache key of the function for a given domain
+    std::string getCacheKey(const AnalysisParams &params, std::string dom_name,
+			    const BasicBlock *entry, const liveness_t *live) {
+      crab::crab_string_os cfg_str;
+      cfg_str << get_cfg();
+      return AnalysisCache::getKey(cfg_str.str(), getValueName(*entry) + ";" +
+				   getParamsKey(params, dom_name, live));
+    }
+
+    // Return the part of the cache keys that depends on the
+    // parameters of the analysis and of the cfg but not on the cfg
+    // itself (see AnalysisCache::loadChecks)
+    std::string getParamsKey(const AnalysisParams &params, std::string dom_name,
+			     const liveness_t *live) {
+      std::string params_str;
+      raw_string_ostream o(params_str);
+      o << dom_name << ";track=" << (int) m_cfg_builder->get_params().precision_level
+	<< ";mods=" << params.dom_modifiers
+	<< ";" << params.run_backward << ";" << (live != nullptr)
+	<< ";" << params.widening_delay << ";" << params.narrowing_iters
+	<< ";" << params.widening_jumpset << ";" << params.check
+	<< ";" << params.array_max_smashable_cells << ";" << params.array_max_size
+	<< ";" << params.keep_shadow_vars;
+      if (params.max_disjuncts > 0) {
+	o << ";max-disjuncts=" << params.max_disjuncts;
+      }
+      if (params.dom == PACKED_OCT) {
+	o << ";pack-size=" << params.pack_size;
+      }
+      if (params.fixpoint != WTO_FIXPOINT) {
+	o << ";fixpoint=" << params.fixpoint;
+      }
+      if (params.check && params.check_early_stop) {
+	// the invariants might be computed without narrowing
+	o << ";early-stop";
+      }
+      if (params.check && params.check_early_stop_skip_invariants) {
+	// the invariants might not be stored
+	o << ";skip-invariants";
+      }
+      if (params.check && params.run_backward && params.backward_unproven_only) {
+	// the invariants might be computed without the backward analysis
+	o << ";backward-unproven-only";
+      }
+      return o.str();
+    }
+
+    template<typename Dom>
+    static AnalysisCache::Invariant toCachedInvariant(Dom absval) {
+      AnalysisCache::Invariant res;
+      res.is_bottom = absval.is_bottom();
+      if (!res.is_bottom) {
+	res.csts = absval.to_linear_constraint_system();
+      }
+      return res;
+    }
+
+    template<typename Dom>
+    static Dom toAbsVal(const AnalysisCache::Invariant &inv) {
+      Dom absval;
+      if (inv.is_bottom) {
+	absval = Dom::bottom();
+      } else {
+	absval += inv.csts;
+      }
+      return absval;
+    }
+
+    template<typename Dom>
+    static wrapper_dom_ptr fromCachedInvariant(const AnalysisCache::Invariant &inv) {
+      return mkGenericAbsDomWrapper(toAbsVal<Dom>(inv));
+    }
+
+    /*
+     * Call f(dbg, status) for each assertion with debug info. The
+     * status (_SAFE, _WARN or _ERR) is computed as the assertion
+     * checker does from the invariants at the entry of the blocks.
+     */
+    template<typename Dom, typename GetPre, typename F>
+    void forEachCheck(GetPre get_pre, F f) {
+      typedef crab::analyzer::intra_abs_transformer<Dom> abs_tr_t;
+      typedef typename cfg_ref_t::basic_block_t::assert_t assert_t;
+      cfg_ref_t cfg = get_cfg();
+      for (basic_block_label_t bl: llvm::make_range(cfg.label_begin(),
+						    cfg.label_end())) {
+	abs_tr_t abs_tr(get_pre(bl));
+	for (auto &s: cfg.get_node(bl)) {
+	  if (s.is_assert()) {
+	    const lin_cst_t &cst = static_cast<const assert_t*>(&s)->constraint();
+	    const crab::cfg::debug_info &dbg = s.get_debug_info();
+	    if (dbg.has_debug()) {
+	      Dom inv = abs_tr.get_abs_value();
+	      if (inv.is_bottom() ||
+		  crab::domains::checker_domain_traits<Dom>::entail(inv, cst)) {
+		f(dbg, _SAFE);
+	      } else if (crab::domains::checker_domain_traits<Dom>::intersect(inv, cst)) {
+		f(dbg, _WARN);
+	      } else {
+		f(dbg, _ERR);
+	      }
+	    }
+	  }
+	  s.accept(&abs_tr);
+	}
+      }
+    }
+
+    /* Add the status of each assertion with debug info to index */
+    template<typename Dom, typename GetPre>
+    void indexChecks(GetPre get_pre, CheckIndexWriter &index) {
+      forEachCheck<Dom>(get_pre, [&index](const crab::cfg::debug_info &dbg,
+					  check_kind_t kind) {
+	  index.add(dbg.get_file(), dbg.get_line(), dbg.get_column(),
+		    (kind == _SAFE ? CheckIndexWriter::SAFE :
+		     kind == _WARN ? CheckIndexWriter::WARNING :
+		     CheckIndexWriter::ERROR));
+	});
+    }
+
+    /*
+     * Store in cached the totals of checks and the status of each
+     * assertion with debug info so that they can be replayed.
+     */
+    template<typename Dom, typename GetPre>
+    void cacheChecks(GetPre get_pre, const checks_db_t &checks,
+		     AnalysisCache::FunctionResults &cached) {
+      cached.safe_checks = checks.get_total_safe();
+      cached.error_checks = checks.get_total_error();
+      cached.warning_checks = checks.get_total_warning();
+      forEachCheck<Dom>(get_pre, [&cached](const crab::cfg::debug_info &dbg,
+					   check_kind_t kind) {
+	  cached.checks.push_back(toCachedCheck(dbg, kind));
+	});
+    }
+
+    static AnalysisCache::Check toCachedCheck(const crab::cfg::debug_info &dbg,
+					      check_kind_t kind) {
+      AnalysisCache::Check check;
+      check.status = (kind == _SAFE ? AnalysisCache::SAFE :
+		      kind == _WARN ? AnalysisCache::WARNING :
+		      AnalysisCache::ERROR);
+      check.file = dbg.get_file();
+      check.line = dbg.get_line();
+      check.column = dbg.get_column();
+      return check;
+    }
+
+    /*
+     * Add the checks of cached to checks: the assertions with debug
+     * info with their locations and the others only to the totals.
+     */
+    static void replayCachedChecks(const AnalysisCache::FunctionResults &cached,
+				   checks_db_t &checks) {
+      unsigned safe = 0, error = 0, warning = 0;
+      for (auto const &check: cached.checks) {
+	crab::cfg::debug_info dbg(check.file, check.line, check.column);
+	switch (check.status) {
+	case AnalysisCache::SAFE:
+	  checks.add(_SAFE, dbg);
+	  ++safe;
+	  break;
+	case AnalysisCache::ERROR:
+	  checks.add(_ERR, dbg);
+	  ++error;
+	  break;
+	case AnalysisCache::WARNING:
+	  checks.add(_WARN, dbg);
+	  ++warning;
+	  break;
+	}
+      }
+      for (; safe < cached.safe_checks; ++safe) {
+	checks.add(_SAFE);
+      }
+      for (; error < cached.error_checks; ++error) {
+	checks.add(_ERR);
+      }
+      for (; warning < cached.warning_checks; ++warning) {
+	checks.add(_WARN);
+      }
+    }
+    
+    /**
+     * Check the assertions of the function from several threads once
+     * the fixpoint is computed. Each block is checked from its
+     * invariant at entry so the blocks are independent. Each thread
+     * adds the statuses to its own checks db and they are merged at
+     * the end. The status is computed as the assertion checker does.
+     * The callers pass one thread for an exclusive domain since its
+     * operations cannot run concurrently.
+     */
+    template<typename Dom, typename Analyzer>
+    void checkAssertsInParallel(Analyzer &analyzer, unsigned num_threads,
+				bool deterministic, checks_db_t &checks) {
+      cfg_ref_t cfg = get_cfg();
+      // -- the invariants are read before the threads start
+      std::vector<basic_block_label_t> blocks;
+      std::vector<Dom> pres;
+      for (basic_block_label_t bl: llvm::make_range(cfg.label_begin(),
+						    cfg.label_end())) {
+	auto &bb = cfg.get_node(bl);
+	if (std::any_of(bb.begin(), bb.end(),
+			[](const statement_t &s) { return s.is_assert(); })) {
+	  blocks.push_back(bl);
+	  pres.push_back(analyzer.get_pre(bl));
+	}
+      }
+      num_threads = std::max(1U, std::min(num_threads, (unsigned) blocks.size()));
+      CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Checking assertions of "
+		      << blocks.size() << " blocks with " << num_threads
+		      << " threads\n");
+      std::vector<checks_db_t> shards(num_threads);
+      auto check_block = [&](unsigned i, checks_db_t &shard) {
+	checkBlockAsserts<Dom>(cfg, blocks[i], pres[i], shard);
+      };
+      std::atomic<unsigned> next(0);
+      auto worker = [&](checks_db_t &shard, unsigned t) {
+	if (deterministic) {
+	  // -- a fixed range of blocks per thread so that the shards
+	  //    are merged in block order
+	  unsigned end = (t + 1) * blocks.size() / num_threads;
+	  for (unsigned i = t * blocks.size() / num_threads; i < end; ++i) {
+	    check_block(i, shard);
+	  }
+	} else {
+	  for (unsigned i = next++; i < blocks.size(); i = next++) {
+	    check_block(i, shard);
+	  }
+	}
+      };
+      // -- the transformers can create variables
+      bool thread_safe = m_vfac.is_thread_safe();
+      m_vfac.set_thread_safe(true);
+      std::vector<std::thread> workers;
+      workers.reserve(num_threads - 1);
+      for (unsigned t = 1; t < num_threads; ++t) {
+	workers.emplace_back(worker, std::ref(shards[t]), t);
+      }
+      worker(shards[0], 0);
+      for (auto &t: workers) {
+	t.join();
+      }
+      m_vfac.set_thread_safe(thread_safe);
+      for (auto &shard: shards) {
+	checks += shard;
+      }
+    }
+
+    /*
+     * Use the invariants of the last analysis of the function (which
+     * might have changed since) as the candidate fixpoint. The
+     * candidates at the loop heads are propagated through the acyclic
+     * regions between them and they are kept only if they are
+     * inductive, i.e., they include the states that reach the heads.
+     * Such a post-fixpoint is then refined with descending
+     * iterations as after widening. Return false, without changing
+     * results, if the candidates are missing or not inductive: the
+     * function must then be analyzed from scratch.
+     *
+     * The checks are stored as for cached results.
+     */
+    template<typename Dom>
+    bool warmStart(const AnalysisParams &params, const BasicBlock *entry,
+		   const AnalysisCache::FunctionResults &last,
+		   AnalysisCache::FunctionResults &cached,
+		   AnalysisResults &results) {
+      typedef crab::analyzer::intra_abs_transformer<Dom> abs_tr_t;
+      typedef typename cfg_ref_t::basic_block_t::assert_t assert_t;
+      
+      cfg_ref_t cfg = get_cfg();
+      basic_block_label_t entry_bl = m_cfg_builder->get_crab_basic_block(entry);
+      auto &lo = m_cfg_builder->get_loop_order(entry_bl);
+      const std::set<basic_block_label_t> &heads = lo.heads;
+      const std::vector<basic_block_label_t> &rpo = lo.rpo;
+      const std::set<basic_block_label_t> &reachable = lo.reachable;
+
+      std::map<basic_block_label_t, Dom> head_pre;
+      for (auto &h: heads) {
+	if (h == entry_bl) {
+	  head_pre[h] = Dom::top();
+	  continue;
+	}
+	const BasicBlock *B = h.is_edge() ? nullptr : h.get_basic_block();
+	auto it = B ? last.pre.find(B) : last.pre.end();
+	if (it == last.pre.end()) {
+	  return false;
+	}
+	head_pre[h] = toAbsVal<Dom>(it->second);
+      }
+
+      std::map<basic_block_label_t, Dom> pre, post;
+      auto incoming = [&](const basic_block_label_t &bl) {
+	Dom res = Dom::bottom();
+	for (auto pred: llvm::make_range(cfg.get_node(bl).prev_blocks())) {
+	  if (reachable.count(pred) > 0) {
+	    res |= post[pred];
+	  }
+	}
+	return res;
+      };
+      auto propagate = [&]() {
+	for (auto &bl: rpo) {
+	  Dom in = heads.count(bl) > 0 ? head_pre[bl] : incoming(bl);
+	  abs_tr_t abs_tr(in);
+	  for (auto &s: cfg.get_node(bl)) {
+	    s.accept(&abs_tr);
+	  }
+	  pre[bl] = in;
+	  post[bl] = abs_tr.get_abs_value();
+	}
+      };
+      
+      propagate();
+      for (auto &kv: head_pre) {
+	if (kv.first != entry_bl && !(incoming(kv.first) <= kv.second)) {
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+			  << "Previous invariants of " << m_fun.getName()
+			  << " are not inductive at " << kv.first.get_name() << ".\n");
+	  return false;
+	}
+      }
+      // -- descending iterations
+      unsigned iters = 0;
+      for (; iters < params.narrowing_iters; ++iters) {
+	bool change = false;
+	for (auto &kv: head_pre) {
+	  if (kv.first == entry_bl) continue;
+	  Dom next = incoming(kv.first);
+	  if (!(kv.second <= next)) {
+	    kv.second = next;
+	    change = true;
+	  }
+	}
+	if (!change) break;
+	propagate();
+      }
+      CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+		      << "Reused the previous invariants of " << m_fun.getName()
+		      << " after " << iters << " descending iterations.\n");
+
+      for (basic_block_label_t bl: llvm::make_range(cfg.label_begin(), cfg.label_end())) {
+	bool is_reachable = reachable.count(bl) > 0;
+	if (bl.is_edge()) {
+	  if (!is_reachable || post[bl].is_bottom()) {
+	    cached.infeasible_edges.push_back(bl.get_edge());
+	  }
+	} else if (const BasicBlock *B = bl.get_basic_block()) {
+	  cached.pre[B] = toCachedInvariant(is_reachable ? pre[bl] : Dom::bottom());
+	  cached.post[B] = toCachedInvariant(is_reachable ? post[bl] : Dom::bottom());
+	  if (params.store_invariants || params.print_invars) {
+	    update(results.premap, *B, mkGenericAbsDomWrapper
+		   (is_reachable ? pre[bl] : Dom::bottom()));
+	    update(results.postmap, *B, mkGenericAbsDomWrapper
+		   (is_reachable ? post[bl] : Dom::bottom()));
+	  }
+	}
+	if (!params.check) continue;
+	abs_tr_t abs_tr(is_reachable ? pre[bl] : Dom::bottom());
+	for (auto &s: cfg.get_node(bl)) {
+	  if (s.is_assert()) {
+	    const lin_cst_t &cst = static_cast<const assert_t*>(&s)->constraint();
+	    Dom inv = abs_tr.get_abs_value();
+	    check_kind_t kind;
+	    if (inv.is_bottom() ||
+		crab::domains::checker_domain_traits<Dom>::entail(inv, cst)) {
+	      cached.safe_checks++;
+	      kind = _SAFE;
+	    } else if (crab::domains::checker_domain_traits<Dom>::intersect(inv, cst)) {
+	      cached.warning_checks++;
+	      kind = _WARN;
+	    } else {
+	      cached.error_checks++;
+	      kind = _ERR;
+	    }
+	    if (s.get_debug_info().has_debug()) {
+	      cached.checks.push_back(toCachedCheck(s.get_debug_info(), kind));
+	    }
+	  }
+	  s.accept(&abs_tr);
+	}
+      }
+      if (params.store_invariants || params.print_invars) {
+	results.infeasible_edges.insert(cached.infeasible_edges.begin(),
+					cached.infeasible_edges.end());
+      }
+      replayCachedChecks(cached, results.checksdb);
+      return true;
+    }
+
+    template<typename Dom>
+    void restoreCachedResults(const AnalysisParams &params,
+			      const AnalysisCache::FunctionResults &cached,
+			      AnalysisResults &results) {
+      if (params.store_invariants || params.print_invars) {
+	for (auto &kv: cached.pre) {
+	  update(results.premap, *kv.first, fromCachedInvariant<Dom>(kv.second));
+	}
+	for (auto &kv: cached.post) {
+	  update(results.postmap, *kv.first, fromCachedInvariant<Dom>(kv.second));
+	}
+	results.infeasible_edges.insert(cached.infeasible_edges.begin(),
+					cached.infeasible_edges.end());
+      }
+      replayCachedChecks(cached, results.checksdb);
+    }
+
+    void printAnnotations(const AnalysisParams &params, AnalysisResults &results) {
+      if (params.print_invars ||
+	  params.print_unjustified_assumptions) {
+
+	typedef pretty_printer_impl::block_annotation block_annotation_t;
+	typedef pretty_printer_impl::invariant_annotation inv_annotation_t;
+	typedef pretty_printer_impl::unjust_assumption_annotation unjust_assume_annotation_t;
+	std::vector<std::unique_ptr<block_annotation_t>> pool_annotations;
+	std::lock_guard<std::mutex> lock(output_mutex);
+	// -- with --crab-output-file the function is one frame of the sink
+	OutputSink *sink = OutputSink::get();
+	std::string frame;
+	llvm::raw_string_ostream frame_os(frame);
+	llvm::raw_ostream &out = sink ? static_cast<llvm::raw_ostream&>(frame_os) :
+	                                llvm::outs();
+
+	if (params.print_invars && params.print_invars_compact &&
+	    !params.print_unjustified_assumptions) {
+	  inv_annotation_t invs(m_vfac, results.premap, results.postmap,
+				params.keep_shadow_vars);
+	  pretty_printer_impl::print_compact_invariants(get_cfg(), m_fun.getName(),
+							invs, out);
+	  if (sink) {
+	    sink->write("invariants", m_fun.getName(), frame_os.str());
+	  }
+	  return;
+	}
+
+	// everything goes through llvm::outs() so that the output is
+	// not interleaved with the output of other llvm::outs() users.
+	crab_raw_os o(out);
+	if (get_cfg().has_func_decl()) {
+	  auto fdecl = get_cfg().get_func_decl();
+	  o << "\n" << fdecl << "\n";
+	} else {
+	  o << "\n" << "function " << m_fun.getName() << "\n";
+	}
+	if (params.print_invars) {
+	  pool_annotations.emplace_back(
+	       make_unique<inv_annotation_t>(m_vfac, results.premap, results.postmap, 
+					     params.keep_shadow_vars));
+	}
+
+	// XXX: it must be alive when print_annotations is called.
+	#if 0
+	assumption_naive_analysis<cfg_ref_t> unjust_assumption_analyzer(get_cfg());
+	#else
+	assumption_dataflow_analysis<cfg_ref_t> unjust_assumption_analyzer(get_cfg());
+	#endif 
+	
+	if (params.print_unjustified_assumptions) {
+	  // -- run first the analysis
+	  unjust_assumption_analyzer.exec();
+	  pool_annotations.emplace_back(
+	    make_unique<unjust_assume_annotation_t>(get_cfg(), &unjust_assumption_analyzer));
+	}
+
+	pretty_printer_impl::print_annotations(get_cfg(), o, pool_annotations);
+	if (sink) {
+	  sink->write("invariants", m_fun.getName(), frame_os.str());
+	}
+      }
+    }
+    
+    /**
+     * Replay one visit of each reachable block from the fixpoint: the
+     * transfer function from its pre-state, the join of the
+     * post-states of its predecessors and the widening if it is a
+     * loop head. Crab does not expose its fixpoint iterator so the
+     * number of visits is estimated from the loop depth and the
+     * widening parameters. Edge blocks are counted in the LLVM block
+     * of the branch.
+     **/
+    template<typename Dom, typename Analyzer>
+    void profileFixpoint(const AnalysisParams &params, Analyzer &analyzer) {
+      typedef crab::analyzer::intra_abs_transformer<Dom> abs_tr_t;
+      typedef std::chrono::steady_clock clock;
+      auto elapsed = [](clock::time_point start) {
+	return std::chrono::duration<double>(clock::now() - start).count();
+      };
+      
+      DominatorTree DT(const_cast<Function&>(m_fun));
+      LoopInfo LI(DT);
+      std::vector<ClamBlockStats> blocks;
+      DenseMap<const BasicBlock*, unsigned> index;
+      auto getStats = [&](const BasicBlock *B) -> ClamBlockStats& {
+	auto it = index.find(B);
+	if (it != index.end()) {
+	  return blocks[it->second];
+	}
+	index[B] = blocks.size();
+	blocks.push_back(ClamBlockStats());
+	ClamBlockStats &bs = blocks.back();
+	bs.name = getValueName(*B);
+	for (const Loop *L = LI.getLoopFor(B); L; L = L->getParentLoop()) {
+	  bs.loops.insert(bs.loops.begin(), getValueName(*L->getHeader()));
+	}
+	return bs;
+      };
+      
+      auto &cfg = get_cfg();
+      for (basic_block_label_t bl: llvm::make_range(cfg.label_begin(),
+						    cfg.label_end())) {
+	const BasicBlock *B = bl.is_edge() ? bl.get_edge().first : bl.get_basic_block();
+	if (!B) continue;
+	Dom pre = analyzer.get_pre(bl);
+	if (pre.is_bottom()) continue;
+	ClamBlockStats &bs = getStats(B);
+	auto &bb = cfg.get_node(bl);
+	// -- transfer function
+	auto start = clock::now();
+	abs_tr_t abs_tr(pre);
+	for (auto &s: bb) {
+	  s.accept(&abs_tr);
+	  bs.num_stmts++;
+	}
+	bs.transfer_time += elapsed(start);
+	// -- join
+	start = clock::now();
+	Dom joined = Dom::bottom();
+	unsigned num_preds = 0;
+	for (auto pred: llvm::make_range(bb.prev_blocks())) {
+	  joined |= analyzer.get_post(pred);
+	  num_preds++;
+	}
+	if (num_preds > 1) {
+	  bs.num_joins += num_preds - 1;
+	  bs.join_time += elapsed(start);
+	}
+	// -- widening
+	if (!bl.is_edge() && LI.isLoopHeader(const_cast<BasicBlock*>(B))) {
+	  start = clock::now();
+	  Dom widened = pre || joined;
+	  (void) widened;
+	  bs.num_widenings++;
+	  bs.widening_time += elapsed(start);
+	}
+      }
+
+      double visits_per_loop = params.widening_delay + 1 + params.narrowing_iters;
+      for (auto &bs: blocks) {
+	bs.estimated_time = (bs.transfer_time + bs.join_time + bs.widening_time) *
+	  std::pow(visits_per_loop, (double) bs.loops.size());
+      }
+      m_stats.blocks = std::move(blocks);
+    }
+    
+    /**
+     * Same as analyzeCfg but only one analysis with Dom runs at a
+     * time. For domains whose state is shared by all their instances
+     * and is not thread-safe (e.g., the LDD manager of boxes).
+     **/
+    template<typename Dom>
+    void analyzeCfgExclusive(const AnalysisParams &params,
+			     const BasicBlock *entry,
+			     const abs_dom_map_t &abs_dom_assumptions,
+			     const lin_csts_map_t &lin_csts_assumptions,
+			     const liveness_t *live,
+			     AnalysisResults &results) {
+      static std::mutex mutex;
+      std::lock_guard<std::mutex> lock(mutex);
+      analyzeCfgModified<Dom>(params, entry, abs_dom_assumptions,
+			      lin_csts_assumptions, live, results);
+    }
+
+    /**
+     * The part of analyzeCfg that computes the invariants with
+     * worklist_fixpoint instead of the crab analyzer. All the
+     * invariants are stored (neither lazy nor only at the heads) and
+     * the assertions are checked from the invariants at the entry of
+     * the blocks.
+     **/
+    template<typename Dom>
+    void analyzeCfgWorklist(const AnalysisParams &params, const BasicBlock *entry,
+			    AnalysisCache *cache, const std::string &cache_key,
+			    const std::string &checks_key,
+			    AnalysisCache::FunctionResults &cached,
+			    AnalysisResults &results) {
+      MemTracker::ScopedPhase phase("fixpoint");
+      auto start = std::chrono::steady_clock::now();
+      basic_block_label_t entry_bl = m_cfg_builder->get_crab_basic_block(entry);
+      worklist_fixpoint<Dom> fixpo(get_cfg(), m_cfg_builder->get_loop_order(entry_bl));
+      if (!fixpo.run(Dom::top(), params.widening_delay, params.narrowing_iters,
+		     [&params]() { return params.should_stop(); })) {
+	// -- nothing is stored, not even in the cache
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Analysis of "
+			<< m_fun.getName() << " cancelled.\n");
+	m_stats.cancelled = true;
+	ClamStats::count("Analysis.Cancelled");
+	return;
+      }
+      CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+		      << "Finished worklist fixpoint after "
+		      << fixpo.num_evaluations() << " evaluations of blocks.\n");
+
+      phase.enter("invariants");
+      if (params.store_invariants || params.print_invars || cache) {
+	InvariantInterner interner;
+	auto store = [&interner, &params](wrapper_dom_ptr absval) {
+	  return params.intern_invariants ? interner.intern(absval) : absval;
+	};
+	bool keep = params.store_invariants || params.print_invars;
+	for (basic_block_label_t bl: llvm::make_range(get_cfg().label_begin(),
+						      get_cfg().label_end())) {
+	  if (bl.is_edge()) {
+	    if (fixpo.get_post(bl).is_bottom()) {
+	      if (keep) {
+		results.infeasible_edges.insert({bl.get_edge().first, bl.get_edge().second});
+	      }
+	      if (cache) {
+		cached.infeasible_edges.push_back(bl.get_edge());
+	      }
+	    }
+	  } else if (const BasicBlock *B = bl.get_basic_block()) {
+	    Dom pre = fixpo.get_pre(bl);
+	    Dom post = fixpo.get_post(bl);
+	    if (keep) {
+	      update(results.premap, *B, store(mkGenericAbsDomWrapper(pre)));
+	      update(results.postmap, *B, store(mkGenericAbsDomWrapper(post)));
+	    }
+	    if (cache) {
+	      cached.pre[B] = toCachedInvariant(pre);
+	      cached.post[B] = toCachedInvariant(post);
+	    }
+	  }
+	}
+      }
+      printAnnotations(params, results);
+
+      if (params.check) {
+	phase.enter("checks");
+	checks_db_t checks;
+	// -- the invariants of an exclusive domain are checked serially
+	checkAssertsInParallel<Dom>(fixpo,
+				    isExclusiveDomain(params.dom) ? 1 : params.check_threads,
+				    params.deterministic, checks);
+	results.checksdb += checks;
+	if (results.check_index) {
+	  indexChecks<Dom>([&fixpo](const basic_block_label_t &bl) {
+	      return fixpo.get_pre(bl);
+	    }, *results.check_index);
+	}
+	if (cache) {
+	  cacheChecks<Dom>([&fixpo](const basic_block_label_t &bl) {
+	      return fixpo.get_pre(bl);
+	    }, checks, cached);
+	}
+      }
+
+      if (cache) {
+	cache->store(cache_key, m_fun, cached);
+	cache->storeTime(m_fun, std::chrono::duration<double>
+			 (std::chrono::steady_clock::now() - start).count());
+	if (params.warm_start) {
+	  cache->storeLatest(m_fun, Dom::getDomainName(), cached);
+	}
+	if (params.check) {
+	  cache->storeChecks(m_fun, checks_key, cached);
+	}
+      }
+    }
+
+    // Run analyzeCfg with the disjuncts of Dom bounded by
+    // params.max_disjuncts. Return false if Dom is not disjunctive.
+    template<typename Dom>
+    bool analyzeCfgBounded(std::true_type,
+			   const AnalysisParams &params,
+			   const BasicBlock *entry,
+			   const abs_dom_map_t &abs_dom_assumptions,
+			   const lin_csts_map_t &lin_csts_assumptions,
+			   const liveness_t *live,
+			   AnalysisResults &results) {
+      bounded_disjuncts_impl::max_disjuncts() = params.max_disjuncts;
+      analyzeCfg<bounded_disjuncts_domain<Dom>>(params, entry, abs_dom_assumptions,
+						lin_csts_assumptions, live, results);
+      bounded_disjuncts_impl::get_stats().flush();
+      return true;
+    }
+
+    template<typename Dom>
+    bool analyzeCfgBounded(std::false_type,
+			   const AnalysisParams &params,
+			   const BasicBlock *entry,
+			   const abs_dom_map_t &abs_dom_assumptions,
+			   const lin_csts_map_t &lin_csts_assumptions,
+			   const liveness_t *live,
+			   AnalysisResults &results) {
+      return false;
+    }
+
+    // Run analyzeCfg with the variables of the packs of Dom that
+    // overflow params.pack_size kept unrelated. Return false if all
+    // the packs fit or Dom is not packed.
+    template<typename Dom>
+    bool analyzeCfgPacked(std::true_type,
+			  const AnalysisParams &params,
+			  const BasicBlock *entry,
+			  const abs_dom_map_t &abs_dom_assumptions,
+			  const lin_csts_map_t &lin_csts_assumptions,
+			  const liveness_t *live,
+			  AnalysisResults &results) {
+      std::vector<var_t> vars = getOverflowVars(params.pack_size);
+      if (vars.empty()) {
+	return false;
+      }
+      packed_domain_impl::overflow_vars() = std::move(vars);
+      analyzeCfg<packed_domain<Dom>>(params, entry, abs_dom_assumptions,
+				     lin_csts_assumptions, live, results);
+      packed_domain_impl::overflow_vars().clear();
+      packed_domain_impl::get_stats().flush();
+      return true;
+    }
+
+    template<typename Dom>
+    bool analyzeCfgPacked(std::false_type,
+			  const AnalysisParams &params,
+			  const BasicBlock *entry,
+			  const abs_dom_map_t &abs_dom_assumptions,
+			  const lin_csts_map_t &lin_csts_assumptions,
+			  const liveness_t *live,
+			  AnalysisResults &results) {
+      return false;
+    }
+    
+    /**
+     * Run analyzeCfg with Dom or, if params.dom_modifiers asks for
+     * it, with Dom wrapped by the modifier. The disjuncts of the
+     * disjunctive domains are bounded if params.max_disjuncts is not
+     * zero and the packs of PACKED_OCT by params.pack_size (the
+     * domain is then not instrumented).
+     **/
+    template<typename Dom>
+    void analyzeCfgModified(const AnalysisParams &params,
+			    const BasicBlock *entry,
+			    const abs_dom_map_t &abs_dom_assumptions,
+			    const lin_csts_map_t &lin_csts_assumptions,
+			    const liveness_t *live,
+			    AnalysisResults &results) {
+      if (params.max_disjuncts > 0 &&
+	  analyzeCfgBounded<Dom>(is_disjunctive_domain<Dom>(), params, entry,
+				 abs_dom_assumptions, lin_csts_assumptions,
+				 live, results)) {
+	return;
+      }
+      // -- octagons scale with the size of the largest pack of related
+      //    variables rather than with the number of live variables
+      if (params.dom == PACKED_OCT &&
+	  analyzeCfgPacked<Dom>(is_packed_domain<Dom>(), params, entry,
+				abs_dom_assumptions, lin_csts_assumptions,
+				live, results)) {
+	return;
+      }
+#ifdef INSTRUMENT_DOMAINS
+      if (params.dom_modifiers & DOM_INSTRUMENTED) {
+	analyzeCfg<instrumented_domain<Dom>>(params, entry, abs_dom_assumptions,
+					     lin_csts_assumptions, live, results);
+	instrumented_domain_impl::get_stats().flush();
+	return;
+      }
+#endif
+      analyzeCfg<Dom>(params, entry, abs_dom_assumptions, lin_csts_assumptions,
+		      live, results);
+    }
+    
+    template<typename Dom>
+    void analyzeCfg(const AnalysisParams &params,
+		    const BasicBlock *entry,
+		    const abs_dom_map_t &abs_dom_assumptions,
+		    const lin_csts_map_t &lin_csts_assumptions,
+		    const liveness_t *live,
+		    AnalysisResults &results) {
+      
+      // -- we use the combined forward/backward analyzer
+      typedef intra_forward_backward_analyzer<cfg_ref_t,Dom> intra_analyzer_t;
+      // -- checkers for assertions and nullity
+      typedef intra_checker<intra_analyzer_t> intra_checker_t;
+      typedef assert_property_checker<intra_analyzer_t> assert_prop_t;
+      //typedef null_property_checker<intra_analyzer_t> null_prop_t;
+      
+      CRAB_VERBOSE_IF(1,
+		      auto fdecl = get_cfg().get_func_decl();            
+		      crab::get_msg_stream() << "Running intra-procedural analysis with " 
+		                    << "\"" << Dom::getDomainName()  << "\""
+		                    << " for "  << fdecl.get_func_name()
+		                    << "  ... \n";);
+      
+      // -- forget invariants from a previous analysis of the function
+      if (results.lazy_invariants) {
+	results.lazy_invariants->erase(&m_fun);
+      }
+      
+      // -- reuse the results of a previous run if the function did not change
+      std::unique_ptr<AnalysisCache> cache;
+      std::string cache_key, checks_key;
+      AnalysisCache::FunctionResults cached;
+      if (!params.cache_dir.empty() &&
+	  abs_dom_assumptions.empty() && lin_csts_assumptions.empty()) {
+	cache.reset(new AnalysisCache(params.cache_dir));
+	cache_key = getCacheKey(params, Dom::getDomainName(), entry, live);
+	checks_key = getParamsKey(params, Dom::getDomainName(), live);
+	if (cache->load(cache_key, m_fun, m_vfac, cached)) {
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+			  << "Loaded analysis results of " << m_fun.getName()
+			  << " from cache.\n");
+	  restoreCachedResults<Dom>(params, cached, results);
+	  printAnnotations(params, results);
+	  return;
+	}
+	// -- the function did not change in the source (only its IR):
+	//    only the checks, identified by their lines, are reused
+	//    since the invariants refer to the values of the old IR. The
+	//    function has no invariants.
+	AnalysisCache::FunctionResults latest;
+	if (params.reuse_latest && params.check &&
+	    cache->loadChecks(m_fun, checks_key, m_vfac, latest)) {
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+			  << "Reused the last checks of " << m_fun.getName()
+			  << " without changed lines.\n");
+	  ClamStats::count("Cache.ReusedUnchanged");
+	  replayCachedChecks(latest, results.checksdb);
+	  return;
+	}
+	// -- start from the last invariants of the function (bool asserts
+	//    are not checked by warmStart)
+	AnalysisCache::FunctionResults last;
+	if (params.warm_start && !params.run_backward &&
+	    !(params.check && hasBoolAsserts()) &&
+	    cache->loadLatest(m_fun, Dom::getDomainName(), m_vfac, last) &&
+	    warmStart<Dom>(params, entry, last, cached, results)) {
+	  printAnnotations(params, results);
+	  // not stored under cache_key: the invariants of a warm start
+	  // can be more precise than the ones of a cold analysis
+	  cache->storeLatest(m_fun, Dom::getDomainName(), cached);
+	  if (params.check) {
+	    cache->storeChecks(m_fun, checks_key, cached);
+	  }
+	  return;
+	}
+      }
+      
+      if (params.fixpoint == WORKLIST_FIXPOINT) {
+	if (params.run_backward || !abs_dom_assumptions.empty() ||
+	    !lin_csts_assumptions.empty() || (params.check && hasBoolAsserts())) {
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+			  << "The worklist fixpoint does not support backward analysis, "
+			  << "assumptions or Boolean assertions: the default fixpoint "
+			  << "is used for " << m_fun.getName() << ".\n");
+	} else {
+	  analyzeCfgWorklist<Dom>(params, entry, cache.get(), cache_key, checks_key,
+				  cached, results);
+	  return;
+	}
+      }
+      
+      // -- run intra-procedural analysis
+      MemTracker::ScopedPhase phase("fixpoint");
+      auto start = std::chrono::steady_clock::now();
+      // the analyzer is kept alive if invariants are built on demand
+      std::unique_ptr<intra_analyzer_t> analyzer_ptr(new intra_analyzer_t(get_cfg()));
+      typename intra_analyzer_t::assumption_map_t crab_assumptions;
+
+      // Reconstruct a crab assumption map from an abs_dom_map_t
+      for (auto &kv: abs_dom_assumptions) {
+	Dom absval;
+	getAbsDomWrappee(kv.second, absval);
+	crab_assumptions.insert({m_cfg_builder->get_crab_basic_block(kv.first), absval});
+      }
+      
+      // Reconstruct a crab assumption map from a lin_csts_map_t
+      for (auto &kv: lin_csts_assumptions) {
+	Dom absval;
+	absval += kv.second;
+	crab_assumptions.insert({m_cfg_builder->get_crab_basic_block(kv.first), absval});
+      }
+      
+      // We use as initial state an assumption if exists
+      Dom entry_dom = Dom::top();
+      auto it = crab_assumptions.find(m_cfg_builder->get_crab_basic_block(entry));
+      if (it != crab_assumptions.end()) {
+	entry_dom = it->second;
+      }
+      
+      // Crab does not let us stop between the ascending and the
+      // descending phases, nor between the forward and the backward
+      // passes, so we run first a cheaper analysis without narrowing
+      // (--crab-check-early-stop) or without the backward passes
+      // (--crab-backward-unproven-only) and, unless all the checks
+      // are proven, we start again with the full analysis. Both can
+      // only refine the invariants so a proven check stays proven but
+      // an error can become safe.
+      bool no_narrowing = params.check_early_stop && params.narrowing_iters > 0;
+      bool no_backward = params.run_backward && params.backward_unproven_only;
+      bool proven_early = false;
+      if (params.check && (no_narrowing || no_backward)) {
+	analyzer_ptr->run(m_cfg_builder->get_crab_basic_block(entry), entry_dom,
+			  !params.run_backward || no_backward, crab_assumptions, live,
+			  params.widening_delay, no_narrowing ? 0 : params.narrowing_iters,
+			  params.widening_jumpset);
+	typename intra_checker_t::prop_checker_ptr prop(new assert_prop_t(0));
+	intra_checker_t checker(*analyzer_ptr, {prop});
+	checker.run();
+	const auto &checks = checker.get_all_checks();
+	proven_early = (checks.get_total_warning() == 0 &&
+			checks.get_total_error() == 0);
+	if (proven_early) {
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+			  << "All checks proven"
+			  << (no_narrowing ? " without narrowing" : "")
+			  << (no_backward ? " without backward analysis" : "")
+			  << ".\n");
+	} else if (params.should_stop()) {
+	  CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Analysis of "
+			  << m_fun.getName() << " cancelled.\n");
+	  m_stats.cancelled = true;
+	  ClamStats::count("Analysis.Cancelled");
+	  return;
+	} else {
+	  analyzer_ptr.reset(new intra_analyzer_t(get_cfg()));
+	}
+      }
+      if (!proven_early) {
+	analyzer_ptr->run(m_cfg_builder->get_crab_basic_block(entry), entry_dom, 
+			  !params.run_backward, crab_assumptions, live,
+			  params.widening_delay, params.narrowing_iters, params.widening_jumpset);
+      }
+      intra_analyzer_t &analyzer = *analyzer_ptr;
+      CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Finished intra-procedural analysis.\n"); 
+
+      if (params.profile_fixpoint) {
+	profileFixpoint<Dom>(params, analyzer);
+      }
+
+      // -- store invariants
+      phase.enter("invariants");
+      // If lazy, heads or delta then only infeasible edges are
+      // stored. The printer needs all the invariants so it disables
+      // these modes.
+      bool store_invariants = params.store_invariants &&
+	!(proven_early && params.check_early_stop_skip_invariants);
+      bool heads = (params.head_invariants && store_invariants &&
+		    !params.print_invars && results.lazy_invariants &&
+		    !params.run_backward && crab_assumptions.empty());
+      bool delta = (params.delta_invariants && store_invariants &&
+		    !params.print_invars && results.lazy_invariants && !heads);
+      bool lazy = (params.lazy_invariants && store_invariants &&
+		   !params.print_invars && results.lazy_invariants && !heads &&
+		   !delta);
+      if (store_invariants || params.print_invars) {
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Storing invariants.\n");       
+	InvariantInterner interner;
+	auto store = [&interner, &params](wrapper_dom_ptr absval) {
+	  return params.intern_invariants ? interner.intern(absval) : absval;
+	};
+	for (basic_block_label_t bl: llvm::make_range(get_cfg().label_begin(),
+						      get_cfg().label_end())) {
+	  if (bl.is_edge()) {
+	    // Note that we use get_post instead of get_pre:
+	    //   the crab block (bl) has an assume statement corresponding
+	    //   to the branch condition in the predecessor of the
+	    //   LLVM edge. We want the invariant *after* the
+	    //   evaluation of the assume.		
+	    if (analyzer.get_post(bl).is_bottom()) {
+	      results.infeasible_edges.insert({bl.get_edge().first, bl.get_edge().second});
+	    }
+	  } else if (lazy || heads || delta) {
+	    continue;
+	  } else if (const BasicBlock *B = bl.get_basic_block()) {
+	    // --- invariants that hold at the entry of the blocks
+	    auto pre = analyzer.get_pre(bl);
+	    update(results.premap, *B, store(mkGenericAbsDomWrapper(pre)));
+	    // --- invariants that hold at the exit of the blocks
+	    auto post = analyzer.get_post(bl);
+	    update(results.postmap, *B, store(mkGenericAbsDomWrapper(post)));
+	    #if 0
+	    if (params.stats) {
+	      unsigned num_block_invars = 0;
+	      // XXX: for boxes it would be more useful to get a measure
+	      // from to_disjunctive_linear_constraint_system() but it
+	      // can be really slow. 
+	      num_block_invars += pre.to_linear_constraint_system().size();
+	      num_invars += num_block_invars;
+	      if (num_block_invars > 0) num_nontrivial_blocks++;
+	    }
+	    #endif 
+	  } else {
+	    // this should be unreachable
+	    assert(false && "A Crab block should correspond to either an LLVM edge or block");
+	  }
+	}
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "All invariants stored.\n";
+			if (params.intern_invariants) {
+			  crab::get_msg_stream() << "Shared invariants: "
+						 << interner.num_shared() << "\n";
+			});
+      }
+
+      if (cache) {
+	for (basic_block_label_t bl: llvm::make_range(get_cfg().label_begin(),
+						      get_cfg().label_end())) {
+	  if (bl.is_edge()) {
+	    if (analyzer.get_post(bl).is_bottom()) {
+	      cached.infeasible_edges.push_back(bl.get_edge());
+	    }
+	  } else if (const BasicBlock *B = bl.get_basic_block()) {
+	    cached.pre[B] = toCachedInvariant(analyzer.get_pre(bl));
+	    cached.post[B] = toCachedInvariant(analyzer.get_post(bl));
+	  }
+	}
+      }
+      
+      // -- print all cfg annotations (if any)
+      printAnnotations(params, results);
+          
+      if (params.check) {
+	// --- checking assertions and collecting data
+	phase.enter("checks");
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Checking assertions ... \n"); 
+	checks_db_t checks;
+	if (params.check_threads > 1 && params.check_verbose == 0 &&
+	    !isExclusiveDomain(params.dom) && !hasBoolAsserts()) {
+	  checkAssertsInParallel<Dom>(analyzer, params.check_threads,
+				      params.deterministic, checks);
+	} else {
+	  typename intra_checker_t::prop_checker_ptr
+	    prop(new assert_prop_t(params.check_verbose));
+	  // if (params.check == NULLITY)
+	  //   prop.reset(new null_prop_t(params.check_verbose));
+	  intra_checker_t checker(analyzer, {prop});
+	  checker.run();
+	  CRAB_VERBOSE_IF(1,
+			  std::lock_guard<std::mutex> lock(output_mutex);
+			  llvm::outs() << "Function " << m_fun.getName() << "\n";
+			  checker.show(crab::outs()));
+	  checks += checker.get_all_checks();
+	}
+	results.checksdb += checks;
+	if (results.check_index) {
+	  indexChecks<Dom>([&analyzer](const basic_block_label_t &bl) {
+	      return analyzer.get_pre(bl);
+	    }, *results.check_index);
+	}
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Finished assert checking.\n");      
+	if (cache) {
+	  cacheChecks<Dom>([&analyzer](const basic_block_label_t &bl) {
+	      return analyzer.get_pre(bl);
+	    }, checks, cached);
+	}
+      }
+
+      if (cache) {
+	cache->store(cache_key, m_fun, cached);
+	cache->storeTime(m_fun, std::chrono::duration<double>
+			 (std::chrono::steady_clock::now() - start).count());
+	if (params.warm_start) {
+	  cache->storeLatest(m_fun, Dom::getDomainName(), cached);
+	}
+	if (params.check) {
+	  cache->storeChecks(m_fun, checks_key, cached);
+	}
+      }
+
+      if (lazy) {
+	(*results.lazy_invariants)[&m_fun] =
+	  std::make_shared<AnalyzerInvariants<intra_analyzer_t>>(m_cfg_builder,
+								 std::move(analyzer_ptr));
+      } else if (heads) {
+	(*results.lazy_invariants)[&m_fun] =
+	  std::make_shared<HeadInvariants<Dom>>(m_cfg_builder, analyzer,
+						m_cfg_builder->get_crab_basic_block(entry),
+						params.head_invariants_cache_size);
+      } else if (delta) {
+	(*results.lazy_invariants)[&m_fun] =
+	  std::make_shared<DeltaInvariants<Dom>>(m_cfg_builder, analyzer,
+						 m_cfg_builder->get_crab_basic_block(entry));
+      }
+
+      
+      return;
+    }
+
+    /* 
+     * Solve path with several domains at once, each one in its own
+     * thread. The first domain that proves infeasibility cancels the
+     * others and provides the unsat core. If the path is feasible for
+     * all of them then post is taken from params.dom if it is part of
+     * the portfolio, otherwise from the last (most precise) domain.
+     *
+     * Boxes is not part of the portfolio because its LDD manager is
+     * shared by all its instances and it is not thread-safe.
+     */
+    bool portfolioPathAnalyze(const AnalysisParams& params,
+			      const std::vector<basic_block_label_t>& path,
+			      bool layered_solving, 
+			      std::vector<crab::cfg::statement_wrapper>& core,
+			      bool populate_inv_map, abs_dom_map_t& post) {
+      static const CrabDomain portfolio[] = { INTERVALS, ZONES_SPLIT_DBM, TERMS_ZONES };
+      std::vector<CrabDomain> doms;
+      for (CrabDomain dom: portfolio) {
+	if (path_analyses().count(dom)) {
+	  doms.push_back(dom);
+	}
+      }
+      assert(!doms.empty());
+      
+      struct outcome_t {
+	std::vector<crab::cfg::statement_wrapper> core;
+	abs_dom_map_t post;
+	bool res = true;
+      };
+      std::vector<outcome_t> outcomes(doms.size());
+      // -- the path analyzers only read the cfg: it cannot change
+      //    while they run
+      std::shared_ptr<const FrozenCfg> frozen = m_cfg_builder->freeze();
+      std::atomic<bool> cancel(false);
+      int winner = -1;
+      std::mutex winner_mutex;
+      std::vector<std::thread> workers;
+      for (unsigned i=0; i < doms.size(); ++i) {
+	workers.emplace_back([&, i]() {
+	    outcome_t &o = outcomes[i];
+	    path_analyses().at(doms[i]).analyze(this, params, path, o.core, layered_solving,
+					      populate_inv_map, o.post, o.res, &cancel);
+	    if (!o.res) {
+	      std::lock_guard<std::mutex> lock(winner_mutex);
+	      if (winner < 0) {
+		winner = i;
+		cancel.store(true);
+	      }
+	    }
+	  });
+      }
+      for (auto &t: workers) {
+	t.join();
+      }
+
+      unsigned selected = doms.size() - 1;
+      if (winner >= 0) {
+	selected = winner;
+      } else {
+	auto it = std::find(doms.begin(), doms.end(), params.dom);
+	if (it != doms.end()) {
+	  selected = it - doms.begin();
+	}
+      }
+      CRAB_VERBOSE_IF(1, crab::outs() << "Path analysis portfolio: "
+		      << path_analyses().at(doms[selected]).name
+		      << (winner >= 0 ? " proved infeasibility\n" : " selected\n"););
+      outcome_t &o = outcomes[selected];
+      core.swap(o.core);
+      post.insert(o.post.begin(), o.post.end());
+      return o.res;
+    }
+    
+    // Path analyzers kept alive across path queries so that their
+    // prefix caches can be reused (see AnalysisParams::path_prefix_cache)
+    struct PathSolver {
+      std::mutex mutex;
+      virtual ~PathSolver() {}
+    };
+    
+    template<typename AbsDom>
+    struct PathSolverImpl: public PathSolver {
+      path_analyzer<cfg_ref_t, AbsDom> analyzer;
+      PathSolverImpl(cfg_ref_t cfg): analyzer(cfg, AbsDom()) {}
+    };
+
+    std::mutex m_path_solvers_mutex;
+    std::unordered_map<std::type_index, std::unique_ptr<PathSolver>> m_path_solvers;
+
+    // threads of the asynchronous path queries, created by the first one
+    std::mutex m_path_pool_mutex;
+    std::unique_ptr<PathQueryPool> m_path_pool;
+    
+    /**
+     * Same as wrapperPathAnalyze but only one path query with AbsDom
+     * runs at a time (e.g., asynchronous queries of boxes).
+     **/
+    template<typename AbsDom>
+    void wrapperPathAnalyzeExclusive(const AnalysisParams& params,
+				     const std::vector<basic_block_label_t>& path,
+				     std::vector<crab::cfg::statement_wrapper>& core,
+				     bool layered_solving, bool populate_inv_map,
+				     abs_dom_map_t& post, bool &res,
+				     const std::atomic<bool>* cancel) {
+      static std::mutex mutex;
+      std::lock_guard<std::mutex> lock(mutex);
+      wrapperPathAnalyze<AbsDom>(params, path, core, layered_solving,
+				 populate_inv_map, post, res, cancel);
+    }
+
+    template<typename AbsDom>
+    void wrapperPathAnalyze(const AnalysisParams& params,
+			    const std::vector<basic_block_label_t>& path,
+			    std::vector<crab::cfg::statement_wrapper>& core,
+			    bool layered_solving, bool populate_inv_map,
+			    abs_dom_map_t& post, bool &res,
+			    const std::atomic<bool>* cancel) {
+      using path_analyzer_t = path_analyzer<cfg_ref_t, AbsDom>;
+      using path_solver_t = PathSolverImpl<AbsDom>;
+
+      std::unique_ptr<path_analyzer_t> local_analyzer;
+      std::unique_lock<std::mutex> solver_lock;
+      path_analyzer_t* analyzer;
+      if (params.path_prefix_cache > 0) {
+	path_solver_t* solver;
+	{
+	  std::lock_guard<std::mutex> lock(m_path_solvers_mutex);
+	  auto &ptr = m_path_solvers[std::type_index(typeid(AbsDom))];
+	  if (!ptr) {
+	    ptr.reset(new path_solver_t(get_cfg()));
+	  }
+	  solver = static_cast<path_solver_t*>(ptr.get());
+	}
+	solver_lock = std::unique_lock<std::mutex>(solver->mutex);
+	analyzer = &solver->analyzer;
+	analyzer->set_prefix_cache_size(params.path_prefix_cache);
+      } else {
+	AbsDom init;
+	local_analyzer.reset(new path_analyzer_t(get_cfg(), init));
+	analyzer = local_analyzer.get();
+      }
+      
+      analyzer->set_cancel_flag(cancel);
+      res = analyzer->solve(path, layered_solving);
+      if (analyzer->is_cancelled()) {
+	return;
+      }
+      if (populate_inv_map) {
+	for(auto n: path) {
+	  if (const llvm::BasicBlock* bb = n.get_basic_block()) {
+	    AbsDom abs_val = analyzer->get_fwd_constraints(n);
+	    post.insert({bb, mkGenericAbsDomWrapper(abs_val)});
+	    if (abs_val.is_bottom()) {
+	      // the rest of blocks must be also bottom so we don't
+	      // bother storing them.
+	      break;
+	    }
+	  }
+	}
+      }
+
+      if (!res) {
+	analyzer->get_unsat_core(core);
+      }
+    }
+
+    typedef dispatch_table<IntraClam_Impl,
+			   void(const AnalysisParams&,
+				const BasicBlock*,
+				const abs_dom_map_t&,
+				const lin_csts_map_t&,			 
+				const liveness_t*,
+				AnalysisResults&),
+			   NUM_CRAB_DOMAINS> intra_analyses_t;
+
+    typedef dispatch_table<IntraClam_Impl,
+			   void(const AnalysisParams&,
+				const std::vector<basic_block_label_t>&,
+				std::vector<crab::cfg::statement_wrapper>&,
+				bool, bool, abs_dom_map_t&,bool&,
+				const std::atomic<bool>*),
+			   NUM_CRAB_DOMAINS> path_analyses_t;
+    
+  public:
+    // Domains used for intra-procedural analysis
+    static intra_analyses_t& intra_analyses();
+    
+    // Domains used for path-based analysis
+    static path_analyses_t& path_analyses();
+
+    // If dom is exclusive then the functions are analyzed with Dom
+    // one at a time, even with several threads
+    template<typename Dom>
+    static void register_domain(CrabDomain dom, const char* name) {
+      intra_analyses().add(dom, {isExclusiveDomain(dom) ?
+				 &IntraClam_Impl::analyzeCfgExclusive<Dom> :
+				 &IntraClam_Impl::analyzeCfgModified<Dom>, name});
+    }
+
+    // path_analyzer must be explicitly instantiated for Dom (see
+    // crab/path_analyzer_impl.hpp)
+    template<typename Dom>
+    static void register_path_domain(CrabDomain dom, const char* name) {
+      path_analyses().add(dom, {isExclusiveDomain(dom) ?
+				&IntraClam_Impl::wrapperPathAnalyzeExclusive<Dom> :
+				&IntraClam_Impl::wrapperPathAnalyze<Dom>, name});
+    }
+  }; // end class
+
+  /**
+   *   Internal implementation of the inter-procedural analysis
+   **/
+  class InterClam_Impl {
+  public:
+    // If funcs is not null then only the functions in funcs are
+    // analyzed. The caller must ensure that funcs is closed under
+    // calls.
+    InterClam_Impl(const Module& M, CrabBuilderManager &man,
+		   unsigned num_threads = 1,
+		   const std::set<const Function*> *funcs = nullptr)
+      : m_cg(nullptr), m_crab_builder_man(man), m_M(M),
+	m_requested_dom(INTERVALS), m_dom(INTERVALS), m_has_heavy_funcs(false),
+	m_num_threads(num_threads), m_has_funcs(funcs != nullptr),
+	m_fun_config(nullptr) {
+      if (funcs) {
+	m_funcs = *funcs;
+      }
+
+      initDomains();
+      buildCallGraph(num_threads);
+    }
+
+    // The functions with their own parameters in config are analyzed
+    // separately (as the heavy functions of per_function_dom).
+    void set_function_config(const FunctionAnalysisConfig *config) {
+      m_fun_config = config;
+    }
+    
+    void Analyze(AnalysisParams &params,
+		 // assumptions can be provided in abs_dom format or
+		 // as linear constraints.
+		 const abs_dom_map_t &abs_dom_assumptions /*unused*/,
+		 const lin_csts_map_t &lin_csts_assumptions /*unused*/,
+		 AnalysisResults &results) {
+
+      if (params.check == NULLITY) {
+	// -- the null checks are intra-procedural: each CFG is
+	//    checked on its own
+	for (auto cg_node: llvm::make_range(vertices(*m_cg))) {
+	  auto it = m_cfg_to_fun.find(cg_node.get_cfg());
+	  if (it == m_cfg_to_fun.end()) continue;
+	  ClamStats::ScopedFunction fscope(it->second->getName());
+	  NullityAnalysis nullity(it->first);
+	  CRAB_LOG("clam-nullity", nullity.write(crab::outs()));
+	  nullity.check(results.checksdb);
+	}
+	return;
+      }
+
+      keepVarScopes(results);
+
+      // If the number of live variables per block is too high we
+      // switch to a cheap domain regardless what the user wants.
+      CrabDomain absdom =  params.dom;
+      CrabDomain requested_dom = params.dom;
+      
+      /* Compute liveness information and choose statically the
+	 abstract domain */
+
+      // Functions that exceed the threshold if per_function_dom
+      std::vector<const Function*> heavy_funcs;
+      if (params.run_liveness || isRelationalDomain(absdom)) {
+	// -- run liveness on all functions in parallel
+	std::vector<std::pair<cfg_ref_t, const Function*>> nodes;
+	for (auto cg_node: llvm::make_range(vertices(*m_cg))) {
+	  auto it = m_cfg_to_fun.find(cg_node.get_cfg());
+	  if (it != m_cfg_to_fun.end()) {
+	    nodes.push_back(*it);
+	  }
+	}
+	std::vector<const liveness_t*> lives(nodes.size(), nullptr);
+	std::vector<unsigned> max_lives(nodes.size(), 0);
+	std::atomic<unsigned> next(0);
+	runWorkers([&]() {
+	    for (unsigned i = next++; i < nodes.size(); i = next++) {
+	      auto cfg_builder = m_crab_builder_man.get_cfg_builder(*nodes[i].second);
+	      assert(cfg_builder);
+	      cfg_builder->compute_live_symbols();
+	      lives[i] = cfg_builder->get_live_symbols();
+	      max_lives[i] = *cfg_builder->get_max_live_per_blk();
+	    }
+	  }, nodes.size());
+
+	// -- max number of live variables for whole cg
+	unsigned max_live_per_blk = 0;
+	for (unsigned i = 0; i < nodes.size(); ++i) {
+	  const Function *fun = nodes[i].second;
+	  unsigned max_live_per_blk_ = max_lives[i];
+	  if (params.per_function_dom && isRelationalDomain(absdom) &&
+	      max_live_per_blk_ > params.relational_threshold) {
+	    CRAB_VERBOSE_IF(1, crab::outs() << fun->getName()
+			    << " exceeds the threshold with "
+			    << max_live_per_blk_ << " live variables per block\n");
+	    heavy_funcs.push_back(fun);
+	  } else {
+	    max_live_per_blk = std::max(max_live_per_blk, max_live_per_blk_);
+	  }
+	  if (params.run_liveness) {
+	    m_live_map.insert({nodes[i].first, lives[i]});
+	  }
+	}
+
+	if (isRelationalDomain(absdom)) {
+	  // Unless per_function_dom is enabled, the selection of the
+	  // final domain is fixed for the whole program. That is, if
+	  // there is one function that exceeds the threshold then the
+	  // cheaper domain will be used for all functions.
+	  CRAB_VERBOSE_IF(1,
+		    crab::outs() << "Max live per block: "
+		                 << max_live_per_blk << "\n"
+		                 << "Threshold: "
+		                 << params.relational_threshold << "\n");
+          #ifdef HAVE_ALL_DOMAINS
+	  if (max_live_per_blk > params.relational_threshold &&
+	      IntraClam_Impl::intra_analyses().count(INTERVALS)) {
+	    // default domain
+	    absdom = INTERVALS;
+	  }
+          #endif
+	}
+      }
+      params.dom = absdom;
+
+      #ifndef HAVE_ALL_DOMAINS
+      if (!heavy_funcs.empty()) {
+	CLAM_WARNING("--crab-inter-per-function-dom is ignored without all the "
+		     "domains (intervals are not available): " << heavy_funcs.size()
+		     << " functions exceeding the relational threshold are analyzed "
+		     << "with the selected domain");
+	heavy_funcs.clear();
+      }
+      #endif
+
+      // -- the functions with their own parameters
+      std::map<const Function*, AnalysisParams> own_params;
+      if (m_fun_config && !m_fun_config->empty()) {
+	for (auto cg_node: llvm::make_range(vertices(*m_cg))) {
+	  auto it = m_cfg_to_fun.find(cg_node.get_cfg());
+	  if (it == m_cfg_to_fun.end()) continue;
+	  AnalysisParams fparams(params);
+	  if (m_fun_config->apply(*it->second, fparams)) {
+	    own_params.insert({it->second, fparams});
+	  }
+	}
+	heavy_funcs.erase(std::remove_if(heavy_funcs.begin(), heavy_funcs.end(),
+					 [&own_params](const Function *fun) {
+					   return own_params.count(fun) > 0;
+					 }),
+			  heavy_funcs.end());
+      }
+      
+      std::set<const Function*> excluded(heavy_funcs.begin(), heavy_funcs.end());
+      for (auto &kv: own_params) {
+	excluded.insert(kv.first);
+      }
+      if (!excluded.empty()) {
+	// The heavy functions and the functions with their own
+	// parameters are removed from the call graph so the
+	// inter-procedural analysis treats calls to them as calls to
+	// external functions.
+	std::vector<cfg_ref_t> cfg_ref_vector;
+	for (auto cg_node: llvm::make_range(vertices(*m_cg))) {
+	  const Function *fun = m_cfg_to_fun[cg_node.get_cfg()];
+	  if (!excluded.count(fun)) {
+	    cfg_ref_vector.push_back(cg_node.get_cfg());
+	  }
+	}
+	m_cg = make_unique<call_graph_t>(cfg_ref_vector.begin(), cfg_ref_vector.end());
+      }
+
+      // -- run the interprocedural analysis
+#ifdef TOP_DOWN_INTER_ANALYSIS
+      // -- the roots of a multi-root analysis are already analyzed in parallel
+      bool split = m_num_threads > 1 && !params.inter_multi_root;
+#else
+      bool split = m_num_threads > 1;
+#endif
+      if (!CrabBuildOnlyCFG) {
+	// -- the weakly connected components of the call graph are
+	//    independent so they are analyzed separately, in parallel
+	//    if split, and the results of each one are kept as soon as
+	//    it is done. Each component is recorded with its checks so
+	//    that Reanalyze only analyzes again the changed ones.
+	m_components.clear();
+	analyzeComponents(getComponents(excluded), params, results, split);
+      }
+
+      // -- analyze intra-procedurally the heavy functions with the
+      //    cheaper domain
+      std::map<const Function*, ClamFunctionStats> heavy_stats;
+      for (const Function *fun: heavy_funcs) {
+	AnalysisParams fparams(params);
+	fparams.dom = INTERVALS;
+	IntraClam_Impl intra_crab(*fun, m_crab_builder_man);
+	intra_crab.Analyze(fparams, &fun->getEntryBlock(),
+			   abs_dom_assumptions, lin_csts_assumptions, results);
+	heavy_stats[fun] = intra_crab.get_stats();
+      }
+      // -- and the functions with their own parameters
+      for (auto &kv: own_params) {
+	IntraClam_Impl intra_crab(*kv.first, m_crab_builder_man);
+	intra_crab.Analyze(kv.second, &kv.first->getEntryBlock(),
+			   abs_dom_assumptions, lin_csts_assumptions, results);
+	heavy_stats[kv.first] = intra_crab.get_stats();
+      }
+
+      collectStats(params.dom, heavy_stats);
+      m_requested_dom = requested_dom;
+      m_dom = params.dom;
+      m_has_heavy_funcs = !excluded.empty();
+    }
+
+    /**
+     * Analyze again the module after the functions in changed have
+     * been modified or replaced. A function modified in place whose
+     * blocks are all the same as when its cfg was built is not
+     * considered changed. Functions without cfg are also considered
+     * changed. The call graph is split into its weakly
+     * connected components and only the components that contain a
+     * changed function, or that were not analyzed as such by the last
+     * analysis, are analyzed again. The invariants and checks of the
+     * other components are reused.
+     **/
+    void Reanalyze(AnalysisParams &params,
+		   const std::vector<const Function*> &changed,
+		   AnalysisResults &results) {
+      // -- rebuild the cfg's of the changed functions
+      std::set<std::string> changed_names;
+      for (const Function *F: changed) {
+	if (!isAnalyzed(*F)) {
+	  m_crab_builder_man.invalidate(*F);
+	  changed_names.insert(F->getName());
+	  continue;
+	}
+	bool rebuilt;
+	m_crab_builder_man.rebuild(*F, rebuilt);
+	if (rebuilt) {
+	  changed_names.insert(F->getName());
+	}
+      }
+      for (auto const &F: m_M) {
+	if (isAnalyzed(F) && !m_crab_builder_man.has_cfg(F)) {
+	  changed_names.insert(F.getName());
+	}
+      }
+      m_live_map.clear();
+      buildCallGraph(m_num_threads);
+
+      if (!canReanalyze(params, changed_names)) {
+	CRAB_VERBOSE_IF(1, crab::outs() << "Analyzing the whole call graph again\n");
+	results.premap.clear();
+	results.postmap.clear();
+	results.infeasible_edges.clear();
+	results.checksdb.clear();
+	abs_dom_map_t abs_dom_assumptions;
+	lin_csts_map_t lin_csts_assumptions;
+	Analyze(params, abs_dom_assumptions, lin_csts_assumptions, results);
+	return;
+      }
+      params.dom = m_dom;
+
+      // -- split the components into the reused and the dirty ones
+      std::vector<component_t> old_components;
+      std::swap(old_components, m_components);
+      std::vector<std::vector<const Function*>> dirty;
+      std::set<const BasicBlock*> kept_blocks;
+      abs_dom_map_t premap, postmap;
+      for (auto &funcs: getComponents(std::set<const Function*>())) {
+	std::set<std::string> names;
+	bool is_dirty = false;
+	for (const Function *F: funcs) {
+	  names.insert(F->getName());
+	  is_dirty |= (changed_names.count(F->getName()) > 0);
+	}
+	auto it = std::find_if(old_components.begin(), old_components.end(),
+			       [&names](const component_t &c) {
+				 return c.first == names;
+			       });
+	if (is_dirty || it == old_components.end()) {
+	  dirty.push_back(funcs);
+	  continue;
+	}
+	m_components.push_back(*it);
+	for (const Function *F: funcs) {
+	  for (auto &B: *F) {
+	    kept_blocks.insert(&B);
+	    auto pre = results.premap.find(&B);
+	    if (pre != results.premap.end()) premap.insert(*pre);
+	    auto post = results.postmap.find(&B);
+	    if (post != results.postmap.end()) postmap.insert(*post);
+	  }
+	}
+      }
+      // The results of the dirty components are discarded. Note that
+      // the blocks of the replaced functions might not exist anymore.
+      results.premap = std::move(premap);
+      results.postmap = std::move(postmap);
+      keepVarScopes(results);
+      results.infeasible_edges.erase_if_source([&kept_blocks](const BasicBlock *b) {
+	  return !kept_blocks.count(b);
+	});
+      CRAB_VERBOSE_IF(1, crab::outs() << "Reusing " << m_components.size()
+		      << " components and analyzing " << dirty.size()
+		      << " components again\n");
+
+      // -- analyze the dirty components
+      analyzeComponents(dirty, params, results);
+
+      results.checksdb.clear();
+      for (auto &c: m_components) {
+	results.checksdb += c.second;
+      }
+      collectStats(params.dom, std::map<const Function*, ClamFunctionStats>());
+    }
+
+    const std::vector<ClamFunctionStats>& get_stats() const { return m_stats; }
+    
+  private:
+    
+    // crab call graph 
+    std::unique_ptr<call_graph_t> m_cg;
+    // crab cfg builder manager
+    CrabBuilderManager& m_crab_builder_man;
+    // the LLVM module
+    const Module& m_M;    
+    // live symbols
+    liveness_map_t m_live_map;
+    // function of each cfg in the call graph
+    std::unordered_map<cfg_ref_t, const Function*> m_cfg_to_fun;
+    // statistics of each function
+    std::vector<ClamFunctionStats> m_stats;
+    // functions analyzed together by the last analysis and their
+    // checks. Components are identified by function names since
+    // functions can be replaced in the module between analyses.
+    typedef std::pair<std::set<std::string>, checks_db_t> component_t;
+    std::vector<component_t> m_components;
+    // domain requested and domain used by the last analysis
+    CrabDomain m_requested_dom;
+    CrabDomain m_dom;
+    // whether the last analysis analyzed some functions separately
+    bool m_has_heavy_funcs;
+    // number of threads to build cfg's and analyze components
+    unsigned m_num_threads;
+    // if m_has_funcs then only the functions in m_funcs are analyzed
+    bool m_has_funcs;
+    std::set<const Function*> m_funcs;
+    // parameters of individual functions (null if none)
+    const FunctionAnalysisConfig *m_fun_config;
+
+    bool isAnalyzed(const Function &F) const {
+      return isTrackable(F) && (!m_has_funcs || m_funcs.count(&F));
+    }
+
+    // The invariants of each function keep the names of its variable
+    // scope alive even if its builder is released or built again
+    // (e.g., by Reanalyze).
+    void keepVarScopes(AnalysisResults &results) {
+      for (auto const &F: m_M) {
+	if (!isAnalyzed(F) || !m_crab_builder_man.has_cfg(F)) continue;
+	if (auto scope = m_crab_builder_man.get_cfg_builder(F)->get_var_scope()) {
+	  results.premap.set_owner(F, scope);
+	  results.postmap.set_owner(F, scope);
+	}
+      }
+    }
+
+    /** Build the missing cfg's and the call graph of all of them **/
+    void buildCallGraph(unsigned num_threads) {
+      // -- build cfg's
+      std::vector<const Function*> funcs;
+      for (auto const &F : m_M) {
+	if (isAnalyzed(F) && !m_crab_builder_man.has_cfg(F)) {
+	  funcs.push_back(&F);
+	}
+      }
+      m_crab_builder_man.mk_cfg_builders(funcs, num_threads);
+      
+      std::vector<cfg_ref_t> cfg_ref_vector;
+      m_cfg_to_fun.clear();
+      for (auto const &F : m_M) {
+        if (isAnalyzed(F)) {
+	  cfg_t* cfg = &(m_crab_builder_man.get_cfg(F));
+	  cfg_ref_vector.push_back(*cfg);
+	  m_cfg_to_fun.insert({*cfg, &F});
+	  CRAB_VERBOSE_IF(1, llvm::outs() << "Built Crab CFG for "
+			                  << F.getName() << "\n");
+	} else {
+	  CRAB_VERBOSE_IF(1, llvm::outs() << "Cannot build CFG for "
+			                  << F.getName() << "\n");
+	}
+      }
+      // build call graph
+      m_cg = make_unique<call_graph_t>(cfg_ref_vector.begin(), cfg_ref_vector.end());
+    }
+
+    void collectStats(CrabDomain dom,
+		      const std::map<const Function*, ClamFunctionStats> &heavy_stats) {
+      // -- collect statistics. The analysis time and the checks are
+      //    only known for the whole call graph.
+      m_stats.clear();
+      for (auto &F: m_M) {
+	if (!m_crab_builder_man.has_cfg(F)) continue;
+	auto it = heavy_stats.find(&F);
+	if (it != heavy_stats.end()) {
+	  m_stats.push_back(it->second);
+	  continue;
+	}
+	ClamFunctionStats fstats;
+	fstats.name = F.getName();
+	getCfgStats(*m_crab_builder_man.get_cfg_builder(F), fstats);
+	fstats.domain = dom_to_str(dom);
+	m_stats.push_back(fstats);
+      }
+    }
+
+    /** Whether the last analysis can be reused by Reanalyze **/
+    bool canReanalyze(const AnalysisParams &params,
+		      const std::set<std::string> &changed) {
+      if (m_components.empty() || m_has_heavy_funcs ||
+	  params.dom != m_requested_dom) {
+	return false;
+      }
+      if (isRelationalDomain(m_dom)) {
+	// the relational domain is kept only if the changed functions
+	// do not exceed the threshold.
+	for (const std::string &name: changed) {
+	  const Function *F = m_M.getFunction(name);
+	  if (!F || !isAnalyzed(*F)) continue;
+	  auto cfg_builder = m_crab_builder_man.get_cfg_builder(*F);
+	  cfg_builder->compute_live_symbols();
+	  if (*cfg_builder->get_max_live_per_blk() > params.relational_threshold) {
+	    return false;
+	  }
+	}
+      }
+      return true;
+    }
+
+    /** Weakly connected components of the direct calls between
+	trackable functions, in module order **/
+    std::vector<std::vector<const Function*>>
+    getComponents(const std::set<const Function*> &excluded) const {
+      DenseMap<const Function*, std::vector<const Function*>> edges;
+      for (auto const &F: m_M) {
+	if (!isAnalyzed(F) || excluded.count(&F)) continue;
+	for (auto const &I: instructions(F)) {
+	  ImmutableCallSite CS(&I);
+	  if (!CS) continue;
+	  const Function *callee =
+	    dyn_cast<Function>(CS.getCalledValue()->stripPointerCasts());
+	  if (callee && isAnalyzed(*callee) && !excluded.count(callee)) {
+	    edges[&F].push_back(callee);
+	    edges[callee].push_back(&F);
+	  }
+	}
+      }
+      std::vector<std::vector<const Function*>> components;
+      std::set<const Function*> visited;
+      for (auto const &F: m_M) {
+	if (!isAnalyzed(F) || excluded.count(&F) || visited.count(&F)) continue;
+	std::vector<const Function*> component;
+	std::vector<const Function*> worklist = {&F};
+	visited.insert(&F);
+	while (!worklist.empty()) {
+	  const Function *G = worklist.back();
+	  worklist.pop_back();
+	  component.push_back(G);
+	  for (const Function *H: edges[G]) {
+	    if (visited.insert(H).second) {
+	      worklist.push_back(H);
+	    }
+	  }
+	}
+	components.push_back(component);
+      }
+      return components;
+    }
+
+    /** 
+     * Analyze each component with its own inter-procedural analysis,
+     * in parallel if parallel and there are several threads, and
+     * record their checks in m_components.
+     *
+     * If params.inter_deadline is not zero then no component is
+     * started after the deadline, and none is started either once
+     * params.should_stop(). The components already started run to
+     * completion since Crab cannot stop an analysis. The components
+     * left out are not recorded in m_components so they are analyzed
+     * by the next Reanalyze.
+     **/
+    void analyzeComponents(const std::vector<std::vector<const Function*>> &components,
+			   const AnalysisParams &params, AnalysisResults &results,
+			   bool parallel = true) {
+      struct ComponentResults {
+	abs_dom_map_t premap;
+	abs_dom_map_t postmap;
+	edges_set infeasible_edges;
+	checks_db_t checksdb;
+      };
+
+      // -- the call graphs and the liveness information are built
+      //    before the analyses start
+      std::vector<std::unique_ptr<call_graph_t>> cgs;
+      cgs.reserve(components.size());
+      for (auto &funcs: components) {
+	std::vector<cfg_ref_t> cfg_ref_vector;
+	for (const Function *F: funcs) {
+	  auto cfg_builder = m_crab_builder_man.get_cfg_builder(*F);
+	  cfg_ref_t cfg(cfg_builder->get_cfg());
+	  cfg_ref_vector.push_back(cfg);
+	  if (params.run_liveness) {
+	    cfg_builder->compute_live_symbols();
+	    m_live_map.insert({cfg, cfg_builder->get_live_symbols()});
+	  }
+	}
+	cgs.emplace_back(make_unique<call_graph_t>(cfg_ref_vector.begin(),
+						   cfg_ref_vector.end()));
+      }
+
+      std::vector<ComponentResults> comp_results(cgs.size());
+      std::vector<char> analyzed(cgs.size(), false);
+      std::atomic<unsigned> next(0);
+      auto deadline = std::chrono::steady_clock::now() +
+	std::chrono::seconds(params.inter_deadline);
+      // -- the analyses of an exclusive domain are serialized anyway
+      unsigned num_tasks = (!parallel || isExclusive(params)) ? 1 : cgs.size();
+      CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Analyzing " << cgs.size()
+		      << " call graph components with "
+		      << std::max(std::min(m_num_threads, num_tasks), 1u)
+		      << " threads\n";);
+      runWorkers([&]() {
+	  for (unsigned i = next++; i < cgs.size(); i = next++) {
+	    if (params.inter_deadline > 0 && std::chrono::steady_clock::now() > deadline) {
+	      // -- skip the remaining components
+	      next = cgs.size();
+	      break;
+	    }
+	    if (params.should_stop()) {
+	      next = cgs.size();
+	      break;
+	    }
+	    analyzed[i] = true;
+	    ComponentResults &cres = comp_results[i];
+	    AnalysisResults res(cres.premap, cres.postmap,
+				cres.infeasible_edges, cres.checksdb);
+	    runInterAnalysis(*cgs[i], params, res);
+	  }
+	}, num_tasks);
+
+      // -- merge results following the order of the module
+      unsigned num_skipped_funcs = 0, num_skipped = 0;
+      for (unsigned i = 0; i < cgs.size(); ++i) {
+	if (!analyzed[i]) {
+	  num_skipped_funcs += components[i].size();
+	  ++num_skipped;
+	  continue;
+	}
+	ComponentResults &cres = comp_results[i];
+	for (auto &kv: cres.premap) {
+	  update(results.premap, *kv.first, kv.second);
+	}
+	for (auto &kv: cres.postmap) {
+	  update(results.postmap, *kv.first, kv.second);
+	}
+	results.infeasible_edges.insert(cres.infeasible_edges);
+	results.checksdb += cres.checksdb;
+	std::set<std::string> names;
+	for (const Function *F: components[i]) {
+	  names.insert(F->getName());
+	}
+	m_components.push_back({names, cres.checksdb});
+      }
+      if (num_skipped > 0) {
+	bool cancelled = params.cancel_token && params.cancel_token->is_cancelled();
+	if (cancelled) {
+	  ClamStats::count("Analysis.Cancelled");
+	}
+	CLAM_WARNING((cancelled ? "analysis cancelled: " : "reached --crab-inter-deadline: ")
+		     << num_skipped << " of "
+		     << cgs.size() << " call graph components (" << num_skipped_funcs
+		     << " functions) were not analyzed");
+      }
+    }
+
+    /** Whether the domains of params are exclusive (see isExclusiveDomain) **/
+    static bool isExclusive(const AnalysisParams &params) {
+#ifdef TOP_DOWN_INTER_ANALYSIS
+      return isExclusiveDomain(params.dom);
+#else
+      return isExclusiveDomain(params.sum_dom) || isExclusiveDomain(params.dom);
+#endif
+    }
+
+    /** Run worker in min(m_num_threads, num_tasks) threads (see Numa) **/
+    void runWorkers(const std::function<void()> &worker, unsigned num_tasks) const {
+      unsigned num_threads = std::min(m_num_threads, num_tasks);
+      if (num_threads <= 1) {
+	worker();
+	return;
+      }
+      // -- the analyses create variables (e.g., the ghost variables
+      //    of the domains) through the shared factory
+      auto &vfac = m_crab_builder_man.get_var_factory();
+      bool thread_safe = vfac.is_thread_safe();
+      vfac.set_thread_safe(true);
+      std::vector<std::thread> workers;
+      workers.reserve(num_threads);
+      for (unsigned i = 0; i < num_threads; ++i) {
+	workers.emplace_back([&worker, i]() {
+	    Numa::pin_worker(i);
+	    worker();
+	  });
+      }
+      for (auto &t: workers) {
+	t.join();
+      }
+      vfac.set_thread_safe(thread_safe);
+    }
+
+    /** Dispatch the inter-procedural analysis of cg **/
+    void runInterAnalysis(call_graph_t &cg, const AnalysisParams &params,
+			  AnalysisResults &results) {
+      if (params.auto_widening_jumpset) {
+	WideningThresholds thresholds;
+	for (auto cg_node: llvm::make_range(vertices(cg))) {
+	  thresholds.add(cg_node.get_cfg());
+	}
+	AnalysisParams th_params(params);
+	th_params.auto_widening_jumpset = false;
+	th_params.widening_jumpset =
+	  chooseJumpSetSize(thresholds, params.widening_jumpset);
+	runInterAnalysis(cg, th_params, results);
+	return;
+      }
+      if (params.auto_widening_delay) {
+	// -- one delay for the whole call graph
+	unsigned delay = 1;
+	for (auto cg_node: llvm::make_range(vertices(cg))) {
+	  auto it = m_cfg_to_fun.find(cg_node.get_cfg());
+	  if (it != m_cfg_to_fun.end()) {
+	    delay = std::max(delay,
+			     WideningDelay(*it->second, MAX_AUTO_WIDENING_DELAY).delay());
+	  }
+	}
+	CRAB_VERBOSE_IF(1, crab::outs() << "Widening delay: " << delay << "\n");
+	AnalysisParams wd_params(params);
+	wd_params.auto_widening_delay = false;
+	wd_params.widening_delay = delay;
+	runInterAnalysis(cg, wd_params, results);
+	return;
+      }
+      if (params.auto_array_limits) {
+	// -- the limits of the function with most arrays
+	unsigned num_arrays = 0;
+	for (auto cg_node: llvm::make_range(vertices(cg))) {
+	  num_arrays = std::max(num_arrays, numArrayVars(cg_node.get_cfg()));
+	}
+	AnalysisParams ar_params(params);
+	chooseArrayLimits(ar_params, num_arrays);
+	runInterAnalysis(cg, ar_params, results);
+	return;
+      }
+      setArrayLimits(params);
+      ////
+      // TODO: pass assumptions to the inter-procedural analysis
+      /////
+#ifndef TOP_DOWN_INTER_ANALYSIS	
+      if (inter_analyses().count(inter_key(params.sum_dom, params.dom))) {
+	inter_analyses().at(inter_key(params.sum_dom, params.dom)).analyze(this, cg, params, results);
+      } else {
+	if (inter_analyses().count(inter_key(ZONES_SPLIT_DBM, ZONES_SPLIT_DBM))) {
+	  crab::outs() << "Warning: abstract domains not found or enabled.\n"
+		 << "Compile with -DALL_DOMAINS=ON.\n";	    
+	  // crab::outs() << "Running " << inter_analyses.at({ZONES_SPLIT_DBM, INTERVALS}).name
+	  // 		    << "\n";
+	  // inter_analyses.at({ZONES_SPLIT_DBM, INTERVALS}).analyze(params, results);	
+	} else {
+	  crab::outs() << "Warning: inter-procedural analysis is not enabled.\n"
+		 << "Compile with -DENABLE_INTER=ON or do not use --crab-inter\n";
+	}
+      }
+#else
+      if (inter_analyses().count(params.dom)) {
+	inter_analyses().at(params.dom).analyze(this, cg, params, results);
+      } else {
+	if (inter_analyses().count(ZONES_SPLIT_DBM)) {
+	  crab::outs() << "Warning: abstract domains not found or enabled.\n"
+		 << "Compile with -DALL_DOMAINS=ON.\n";	    
+	} else {
+	  crab::outs() << "Warning: inter-procedural analysis is not enabled.\n"
+		 << "Compile with -DENABLE_INTER=ON or do not use --crab-inter\n";
+	}
+      }
+#endif 	
+    }
+
+    basic_block_label_t get_crab_basic_block(const BasicBlock* bb) const {
+      const Function*f = bb->getParent();
+      auto builder = m_crab_builder_man.get_cfg_builder(*f);
+      return builder->get_crab_basic_block(bb);
+    }
+    
+    /**
+     * Store the invariants of the blocks of funcs computed by analyzer,
+     * and the edges it proved infeasible, in results and print them.
+     *
+     * Each function is extracted into its own tables, in parallel if
+     * there are several threads, and the tables are then merged and
+     * printed in the order of funcs. The invariants are read from the
+     * analyzer so, as in analyzeCfgExclusive, the functions are
+     * extracted one at a time with an exclusive domain.
+     **/
+    template<typename Analyzer>
+    void extractInvariants(Analyzer &analyzer,
+			   const std::vector<std::pair<const Function*, cfg_ref_t>> &funcs,
+			   const AnalysisParams &params, AnalysisResults &results) {
+      struct FunctionInvariants {
+	abs_dom_map_t premap;
+	abs_dom_map_t postmap;
+	edges_set infeasible_edges;
+      };
+      std::vector<FunctionInvariants> func_invs(funcs.size());
+      std::atomic<unsigned> next(0);
+      auto extract = [&]() {
+	for (unsigned i = next++; i < funcs.size(); i = next++) {
+	  cfg_ref_t cfg = funcs[i].second;
+	  FunctionInvariants &finvs = func_invs[i];
+	  InvariantInterner interner;
+	  auto store = [&interner, &params](wrapper_dom_ptr absval) {
+	    return params.intern_invariants ? interner.intern(absval) : absval;
+	  };
+	  for (basic_block_label_t bl:
+		 llvm::make_range(cfg.label_begin(),cfg.label_end())) {
+	    if (bl.is_edge()) {
+	      // Note that we use get_post instead of get_pre:
+	      //   the crab block (bl) has an assume statement corresponding
+	      //   to the branch condition in the predecessor of the
+	      //   LLVM edge. We want the invariant *after* the
+	      //   evaluation of the assume.		
+	      if (analyzer.get_post(cfg, bl).is_bottom()) {
+		finvs.infeasible_edges.insert({bl.get_edge().first, bl.get_edge().second});
+	      }
+	    } else if (const BasicBlock *B = bl.get_basic_block()) {
+	      // --- invariants that hold at the entry of the blocks
+	      auto pre = analyzer.get_pre(cfg, bl);
+	      update(finvs.premap, *B, store(mkGenericAbsDomWrapper(pre)));
+	      // --- invariants that hold at the exit of the blocks
+	      auto post = analyzer.get_post(cfg, bl);
+	      update(finvs.postmap, *B, store(mkGenericAbsDomWrapper(post)));
+	    } else {
+	      // this should be unreachable
+	      assert(false && "A Crab block should correspond to either an LLVM edge or block");
+	    }
+	  }
+	}
+      };
+      if (isExclusive(params)) {
+	extract();
+      } else {
+	// -- wrapping the invariants can create variables
+	auto &vfac = m_crab_builder_man.get_var_factory();
+	bool thread_safe = vfac.is_thread_safe();
+	vfac.set_thread_safe(true);
+	runWorkers(extract, funcs.size());
+	vfac.set_thread_safe(thread_safe);
+      }
+
+      for (unsigned i = 0; i < funcs.size(); ++i) {
+	FunctionInvariants &finvs = func_invs[i];
+	for (auto &kv: finvs.premap) {
+	  update(results.premap, *kv.first, kv.second);
+	}
+	for (auto &kv: finvs.postmap) {
+	  update(results.postmap, *kv.first, kv.second);
+	}
+	results.infeasible_edges.insert(finvs.infeasible_edges);
+	// -- the tables of the function are not needed anymore
+	finvs.premap.clear();
+	finvs.postmap.clear();
+	printInvariants(funcs[i].second, *funcs[i].first, params, results);
+      }
+      ClamStats::count("Inter.ExtractedFunctions", funcs.size());
+    }
+
+    /** Print the invariants of F stored in results **/
+    void printInvariants(cfg_ref_t cfg, const Function &F, const AnalysisParams &params,
+			 AnalysisResults &results) {
+      if (!params.print_invars || !isAnalyzed(F)) {
+	return;
+      }
+      std::lock_guard<std::mutex> lock(output_mutex);
+      if (params.print_invars_compact) {
+	pretty_printer_impl::invariant_annotation
+	  invs(m_crab_builder_man.get_var_factory(),
+	       results.premap, results.postmap, params.keep_shadow_vars);
+	pretty_printer_impl::print_compact_invariants(cfg, F.getName(),
+						      invs, llvm::outs());
+      } else {
+	crab_raw_os o(llvm::outs());
+	if (cfg.has_func_decl()) {
+	  auto fdecl = cfg.get_func_decl();
+	  o << "\n" << fdecl << "\n";
+	} else {
+	  o << "\n" << "function " << F.getName() << "\n";
+	}
+	std::vector<std::unique_ptr<pretty_printer_impl::block_annotation>> annotations;
+	annotations.emplace_back(make_unique<pretty_printer_impl::invariant_annotation>
+				 (m_crab_builder_man.get_var_factory(),
+				  results.premap, results.postmap,
+				  params.keep_shadow_vars));
+	pretty_printer_impl::print_annotations(cfg, o, annotations);
+      }
+    }
+
+#ifdef TOP_DOWN_INTER_ANALYSIS
+    // Return true if a CFG of cg has Boolean assertions
+    static bool hasBoolAsserts(call_graph_t &cg) {
+      for (auto cg_node: llvm::make_range(vertices(cg))) {
+	cfg_ref_t cfg = cg_node.get_cfg();
+	for (auto &bb: llvm::make_range(cfg.begin(), cfg.end())) {
+	  for (auto &s: bb) {
+	    if (s.is_bool_assert()) {
+	      return true;
+	    }
+	  }
+	}
+      }
+      return false;
+    }
+
+    // Check the assertions of cfg from get_pre(bl), the invariant at
+    // the entry of each block bl. Return true if cfg has Boolean
+    // assertions, which are not checked.
+    template<typename Dom, typename GetPre>
+    bool checkCfgAsserts(cfg_ref_t cfg, GetPre get_pre, checks_db_t &checks) {
+      bool has_bool_asserts = false;
+      for (basic_block_label_t bl:
+	     llvm::make_range(cfg.label_begin(), cfg.label_end())) {
+	bool has_asserts = false;
+	for (auto &s: cfg.get_node(bl)) {
+	  has_asserts |= s.is_assert();
+	  has_bool_asserts |= s.is_bool_assert();
+	}
+	if (has_asserts) {
+	  checkBlockAsserts<Dom>(cfg, bl, get_pre(bl), checks);
+	}
+      }
+      return has_bool_asserts;
+    }
+
+    /**
+     * Top-down analysis of a library (AnalysisParams::inter_multi_root).
+     *
+     * Each function of cg that is externally visible or that is not
+     * called from cg is a root analyzed from a top calling context on
+     * the call graph of the functions it reaches. The roots are
+     * analyzed in parallel and the invariants of a function are the
+     * join of its invariants for all the roots that reach it. The
+     * assertions are checked from the joined invariants so that an
+     * assertion of a callee shared by several roots is counted once.
+     **/
+    template<typename Dom>
+    void analyzeCgMultiRoot(call_graph_t &cg,
+			    top_down_inter_analyzer_parameters<call_graph_ref_t> inter_params,
+			    const AnalysisParams &params, AnalysisResults &results) {
+      typedef top_down_inter_analyzer<call_graph_ref_t, Dom> inter_analyzer_t;
+      typedef std::map<basic_block_label_t, std::pair<Dom, Dom>> fun_invariants_t;
+
+      // -- the functions of cg and the ones they call directly
+      std::vector<std::pair<const Function*, cfg_ref_t>> funcs;
+      DenseMap<const Function*, unsigned> index;
+      for (auto &n: llvm::make_range(vertices(cg))) {
+	if (const Function *F = m_M.getFunction(n.name())) {
+	  index[F] = funcs.size();
+	  funcs.push_back({F, n.get_cfg()});
+	}
+      }
+      std::vector<std::vector<unsigned>> callees(funcs.size());
+      std::vector<bool> has_callers(funcs.size(), false);
+      for (unsigned i = 0; i < funcs.size(); ++i) {
+	for (auto const &I: instructions(*funcs[i].first)) {
+	  ImmutableCallSite CS(&I);
+	  if (!CS) {
+	    continue;
+	  }
+	  const Function *callee =
+	    dyn_cast<Function>(CS.getCalledValue()->stripPointerCasts());
+	  auto it = callee ? index.find(callee) : index.end();
+	  if (it != index.end()) {
+	    callees[i].push_back(it->second);
+	    if (it->second != i) {
+	      has_callers[it->second] = true;
+	    }
+	  }
+	}
+      }
+
+      // -- the roots and the functions reachable from each one
+      std::vector<std::vector<unsigned>> closures;
+      std::vector<std::unique_ptr<call_graph_t>> cgs;
+      for (unsigned r = 0; r < funcs.size(); ++r) {
+	if (funcs[r].first->hasLocalLinkage() && has_callers[r]) {
+	  continue;
+	}
+	std::vector<bool> seen(funcs.size(), false);
+	std::vector<unsigned> stack(1, r);
+	seen[r] = true;
+	while (!stack.empty()) {
+	  unsigned i = stack.back();
+	  stack.pop_back();
+	  for (unsigned j: callees[i]) {
+	    if (!seen[j]) {
+	      seen[j] = true;
+	      stack.push_back(j);
+	    }
+	  }
+	}
+	std::vector<unsigned> closure;
+	std::vector<cfg_ref_t> cfg_ref_vector;
+	for (unsigned i = 0; i < funcs.size(); ++i) {
+	  if (seen[i]) {
+	    closure.push_back(i);
+	    cfg_ref_vector.push_back(funcs[i].second);
+	  }
+	}
+	closures.push_back(std::move(closure));
+	cgs.push_back(make_unique<call_graph_t>(cfg_ref_vector.begin(),
+						cfg_ref_vector.end()));
+      }
+      ClamStats::count("Inter.MultiRoot.Roots", cgs.size());
+      CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Analyzing " << cgs.size()
+		      << " roots of " << funcs.size() << " functions.\n";);
+
+      // -- the CFGs are shared by the analyzers of the roots
+      std::vector<std::shared_ptr<const FrozenCfg>> frozen;
+      for (auto &kv: funcs) {
+	frozen.push_back(m_crab_builder_man.get_cfg_builder(*kv.first)->freeze());
+      }
+
+      // -- the checks are done below from the joined invariants
+      inter_params.run_checker = false;
+      std::vector<fun_invariants_t> joined(funcs.size());
+      std::vector<std::mutex> joined_mutex(funcs.size());
+      std::atomic<unsigned> next(0);
+      runWorkers([&]() {
+	  for (unsigned r = next++; r < cgs.size(); r = next++) {
+	    inter_analyzer_t analyzer(*cgs[r], inter_params);
+	    analyzer.run(Dom::top());
+	    for (unsigned i: closures[r]) {
+	      cfg_ref_t cfg = funcs[i].second;
+	      std::lock_guard<std::mutex> lock(joined_mutex[i]);
+	      fun_invariants_t &invs = joined[i];
+	      for (basic_block_label_t bl:
+		     llvm::make_range(cfg.label_begin(), cfg.label_end())) {
+		Dom pre = analyzer.get_pre(cfg, bl);
+		Dom post = analyzer.get_post(cfg, bl);
+		auto it = invs.find(bl);
+		if (it == invs.end()) {
+		  invs.insert({bl, {pre, post}});
+		} else {
+		  it->second.first |= pre;
+		  it->second.second |= post;
+		}
+	      }
+	    }
+	  }
+	  // -- the roots are analyzed one at a time with an exclusive domain
+	}, isExclusive(params) ? 1 : cgs.size());
+      frozen.clear();
+
+      CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Finished inter-procedural analysis.\n");
+
+      // -- store the invariants and check the assertions
+      checks_db_t checks;
+      bool has_bool_asserts = false;
+      for (unsigned i = 0; i < funcs.size(); ++i) {
+	const Function &F = *funcs[i].first;
+	cfg_ref_t cfg = funcs[i].second;
+	const fun_invariants_t &invs = joined[i];
+	auto get = [&invs](const basic_block_label_t &bl, bool is_pre) {
+	  auto it = invs.find(bl);
+	  if (it == invs.end()) {
+	    return Dom::bottom();
+	  }
+	  return is_pre ? it->second.first : it->second.second;
+	};
+	if (params.store_invariants || params.print_invars) {
+	  InvariantInterner interner;
+	  auto store = [&interner, &params](wrapper_dom_ptr absval) {
+	    return params.intern_invariants ? interner.intern(absval) : absval;
+	  };
+	  for (basic_block_label_t bl:
+		 llvm::make_range(cfg.label_begin(), cfg.label_end())) {
+	    if (bl.is_edge()) {
+	      // the post of an edge is after the assume of the branch condition
+	      if (get(bl, false).is_bottom()) {
+		results.infeasible_edges.insert({bl.get_edge().first, bl.get_edge().second});
+	      }
+	    } else if (const BasicBlock *B = bl.get_basic_block()) {
+	      update(results.premap, *B, store(mkGenericAbsDomWrapper(get(bl, true))));
+	      update(results.postmap, *B, store(mkGenericAbsDomWrapper(get(bl, false))));
+	    }
+	  }
+	  printInvariants(cfg, F, params, results);
+	}
+	if (params.check) {
+	  has_bool_asserts |= checkCfgAsserts<Dom>(cfg, [&get](const basic_block_label_t &bl) {
+	      return get(bl, true);
+	    }, checks);
+	}
+      }
+      results.checksdb += checks;
+      if (has_bool_asserts) {
+	CLAM_WARNING("--crab-inter-multi-root does not check Boolean assertions");
+      }
+    }
+#endif
+
+    /** Run inter-procedural analysis on the call graph cg **/
+#ifdef TOP_DOWN_INTER_ANALYSIS
+    template<typename Dom>
+#else    
+    template<typename BUDom, typename TDDom>
+#endif     
+    void analyzeCg(call_graph_t &cg, const AnalysisParams &params,
+		   AnalysisResults &results) {
+
+#ifdef TOP_DOWN_INTER_ANALYSIS
+      CRAB_VERBOSE_IF(1, 
+ 		      crab::get_msg_stream() << "Running top-down inter-procedural analysis " 
+		                             << "with domain:" 
+		                             << "\"" << Dom::getDomainName() << "\""
+		                             << "  ...\n";);
+
+      typedef top_down_inter_analyzer<call_graph_ref_t, Dom> inter_analyzer_t;
+      typedef top_down_inter_analyzer_parameters<call_graph_ref_t> inter_params_t;      
+
+      inter_params_t inter_params;
+      // -- with inter_merge_checks the assertions are checked below
+      //    unless there are Boolean assertions: as in the
+      //    intra-procedural analysis, they are checked by the checker
+      //    of crab in each calling context. The checker runs on the
+      //    whole call graph so that no assertion is counted twice.
+      bool merge_checks = params.check && params.inter_merge_checks;
+      if (merge_checks && hasBoolAsserts(cg)) {
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+			<< "Checking the assertions in each calling context "
+			<< "because of Boolean assertions\n");
+	ClamStats::count("Inter.UnmergedChecks");
+	merge_checks = false;
+      }
+      inter_params.run_checker = params.check && !merge_checks;
+      inter_params.checker_verbosity  = params.check_verbose;
+      inter_params.minimize_invariants = true;
+      inter_params.max_call_contexts = params.max_calling_contexts;
+      // -- crab looks up the calling contexts of the callee with <=
+      //    unless the reuse must be exact
+      inter_params.exact_summary_reuse = !params.reuse_subsumed_contexts;
+      inter_params.live_map = (params.run_liveness ? &m_live_map : nullptr);
+      inter_params.widening_delay = params.widening_delay;
+      inter_params.descending_iters = params.narrowing_iters;
+      inter_params.thresholds_size = params.widening_jumpset;
+      if (params.inter_multi_root) {
+	analyzeCgMultiRoot<Dom>(cg, inter_params, params, results);
+	return;
+      }
+      inter_analyzer_t analyzer(cg, inter_params);
+      analyzer.run(Dom::top());
+      if (inter_params.run_checker) {
+	results.checksdb += analyzer.get_all_checks();
+      }
+#else      
+      typedef bottom_up_inter_analyzer<call_graph_ref_t, BUDom, TDDom> inter_analyzer_t;
+      typedef inter_checker<inter_analyzer_t> inter_checker_t;
+      typedef assert_property_checker<inter_analyzer_t> assert_prop_t;
+      //typedef null_property_checker<inter_analyzer_t> null_prop_t;
+      
+      CRAB_VERBOSE_IF(1, 
+ 		      crab::get_msg_stream() << "Running inter-procedural analysis with " 
+		                    << "forward domain:" 
+		                    << "\"" << TDDom::getDomainName() << "\""
+		                    << " and bottom-up domain:" 
+		                    << "\"" << BUDom::getDomainName() << "\"" 
+		                    << "  ...\n";);
+      
+      inter_analyzer_t analyzer(cg, (params.run_liveness ? &m_live_map : nullptr),
+				params.widening_delay, 
+				params.narrowing_iters, 
+				params.widening_jumpset);
+      analyzer.run(TDDom::top());
+#endif
+    
+      CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Finished inter-procedural analysis.\n");
+      
+      // -- the function of each node of the call graph
+      std::vector<std::pair<const Function*, cfg_ref_t>> funcs;
+      for (auto &n: llvm::make_range(vertices(cg))) {
+	cfg_ref_t cfg = n.get_cfg();
+	auto it = m_cfg_to_fun.find(cfg);
+	if (const Function *F = (it != m_cfg_to_fun.end() ? it->second :
+				 m_M.getFunction(n.name()))) {
+	  funcs.push_back({F, cfg});
+	}
+      }
+
+      // -- store invariants
+      if (params.store_invariants || params.print_invars) {
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Storing invariants.\n");
+	extractInvariants(analyzer, funcs, params, results);
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "All invariants stored.\n");
+      }
+
+#ifdef TOP_DOWN_INTER_ANALYSIS
+      // -- the invariants of a function are joined over its calling
+      //    contexts so each assertion is checked and counted once: it
+      //    is safe if it holds in all of them
+      if (merge_checks) {
+	checks_db_t checks;
+	for (auto &kv: funcs) {
+	  cfg_ref_t cfg = kv.second;
+	  checkCfgAsserts<Dom>(cfg, [&analyzer, &cfg](const basic_block_label_t &bl) {
+	      return analyzer.get_pre(cfg, bl);
+	    }, checks);
+	}
+	ClamStats::count("Inter.MergedChecks", checks.get_total_safe() +
+			 checks.get_total_error() + checks.get_total_warning());
+	results.checksdb += checks;
+      }
+#endif
+
+#ifndef TOP_DOWN_INTER_ANALYSIS	  
+      // Summaries are not currently stored but it would be easy to do so.
+      if (params.print_summaries) {
+	for (auto &kv: funcs) {
+	  if (analyzer.has_summary(kv.second)) {
+	    std::lock_guard<std::mutex> lock(output_mutex);
+	    auto summ = analyzer.get_summary(kv.second);
+	    crab::outs() << "SUMMARY " << *summ << "\n";
+	  }
+	}
+      }
+#endif 	  
+
+#ifndef TOP_DOWN_INTER_ANALYSIS      
+      // --- checking assertions and collecting data
+      if (params.check) {
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Checking assertions ... \n"); 
+	typename inter_checker_t::prop_checker_ptr
+	  prop(new assert_prop_t(params.check_verbose));
+	// if (params.check == NULLITY)
+	//   prop.reset(new null_prop_t(params.check_verbose));      
+	inter_checker_t checker(analyzer, {prop});
+	checker.run();
+	//CRAB_VERBOSE_IF(1, checker.show(crab::outs()));
+	results.checksdb += checker.get_all_checks();
+	CRAB_VERBOSE_IF(1, crab::get_msg_stream() << "Finished assert checking.\n"); 
+      }
+#endif       
+      return;
+    }
+
+    // Domains used for inter-procedural analysis
+#ifdef TOP_DOWN_INTER_ANALYSIS
+    typedef dispatch_table<InterClam_Impl,
+			   void(call_graph_t&, const AnalysisParams&, AnalysisResults&),
+			   NUM_CRAB_DOMAINS> inter_analyses_t;
+
+    /**
+     * Same as analyzeCg but only one analysis with Dom runs at a
+     * time (see IntraClam_Impl::analyzeCfgExclusive).
+     **/
+    template<typename Dom>
+    void analyzeCgExclusive(call_graph_t &cg, const AnalysisParams &params,
+			    AnalysisResults &results) {
+      static std::mutex mutex;
+      std::lock_guard<std::mutex> lock(mutex);
+      analyzeCg<Dom>(cg, params, results);
+    }
+
+  public:
+    static inter_analyses_t& inter_analyses();
+
+    // If dom is exclusive then the call graph components are
+    // analyzed with Dom one at a time, even with several threads
+    template<typename Dom>
+    static void register_domain(CrabDomain dom, const char* name) {
+      inter_analyses().add(dom, {isExclusiveDomain(dom) ?
+				 &InterClam_Impl::analyzeCgExclusive<Dom> :
+				 &InterClam_Impl::analyzeCg<Dom>, name});
+    }
+  };
+#else
+    // the key of a pair of domains (summaries, top-down)
+    static unsigned inter_key(CrabDomain sum_dom, CrabDomain dom) {
+      return sum_dom * NUM_CRAB_DOMAINS + dom;
+    }
+    
+    typedef dispatch_table<InterClam_Impl,
+			   void(call_graph_t&, const AnalysisParams&, AnalysisResults&),
+			   NUM_CRAB_DOMAINS * NUM_CRAB_DOMAINS> inter_analyses_t;
+
+    /**
+     * Same as analyzeCg but only one analysis with the pair (SumDom,
+     * Dom) runs at a time (see IntraClam_Impl::analyzeCfgExclusive).
+     * A run uses a single pair so one lock per pair is enough.
+     **/
+    template<typename SumDom, typename Dom>
+    void analyzeCgExclusive(call_graph_t &cg, const AnalysisParams &params,
+			    AnalysisResults &results) {
+      static std::mutex mutex;
+      std::lock_guard<std::mutex> lock(mutex);
+      analyzeCg<SumDom, Dom>(cg, params, results);
+    }
+
+  public:
+    static inter_analyses_t& inter_analyses();
+
+    // If sum_dom or dom is exclusive then the call graph components
+    // are analyzed with (SumDom, Dom) one at a time, even with
+    // several threads
+    template<typename SumDom, typename Dom>
+    static void register_domain(CrabDomain sum_dom, CrabDomain dom, const char* name) {
+      inter_analyses().add(inter_key(sum_dom, dom),
+			   {isExclusiveDomain(sum_dom) || isExclusiveDomain(dom) ?
+			    &InterClam_Impl::analyzeCgExclusive<SumDom, Dom> :
+			    &InterClam_Impl::analyzeCg<SumDom, Dom>, name});
+    }
+  };
+#endif 
+
+  /** 
+   * Registration of each abstract domain (defined in domains/). A
+   * plugin calls its function when it is loaded.
+   **/
+  void registerZonesDomain();
+  void registerIntervalsDomain();
+  void registerDenseIntervalsDomain();
+  void registerIntervalsCongruencesDomain();
+  void registerDisIntervalsDomain();
+  void registerTermsIntervalsDomain();
+  void registerTermsDisIntervalsDomain();
+  void registerTermsZonesDomain();
+  void registerWrappedIntervalsDomain();
+  void registerOctDomain();
+  void registerBoxesDomain();
+  void registerPkDomain();
+
+} // end namespace clam
+
+// A domain plugin registers its domain when it is loaded
+#ifdef CLAM_BUILD_DOMAIN_PLUGIN
+#define CLAM_DOMAIN_PLUGIN(REGISTER)				\
+  namespace {							\
+    struct DomainPluginRegistration {				\
+      DomainPluginRegistration() { clam::REGISTER(); }		\
+    } domain_plugin_registration;				\
+  }
+#else
+#define CLAM_DOMAIN_PLUGIN(REGISTER)
+#endif 
@@ -0,0 +1,85 @@
+#include "clam/EdgesSet.hh"
+
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Instructions.h"
+
+#include <vector>
+
+namespace clam {
+
+using namespace llvm;
+
+void edges_set::insert(const edge_t &e) {
+  const TerminatorInst *term = e.first->getTerminator();
+  bool found = false;
+  if (term) {
+    unsigned num_succs = term->getNumSuccessors();
+    for (unsigned i = 0; i < num_succs; ++i) {
+      if (term->getSuccessor(i) != e.second) {
+        continue;
+      }
+      SmallBitVector &bits = m_succs[e.first];
+      if (bits.size() != num_succs) {
+        bits.resize(num_succs);
+      }
+      // -- all the successors that are dst (e.g., cases of a switch)
+      bits.set(i);
+      found = true;
+    }
+  }
+  if (!found) {
+    m_others.insert(e);
+  }
+}
+
+void edges_set::insert(const edges_set &o) {
+  for (auto &kv : o.m_succs) {
+    SmallBitVector &bits = m_succs[kv.first];
+    if (bits.size() < kv.second.size()) {
+      bits.resize(kv.second.size());
+    }
+    bits |= kv.second;
+  }
+  m_others.insert(o.m_others.begin(), o.m_others.end());
+}
+
+bool edges_set::contains(const BasicBlock *src, const BasicBlock *dst) const {
+  auto it = m_succs.find(src);
+  if (it != m_succs.end()) {
+    const TerminatorInst *term = src->getTerminator();
+    const SmallBitVector &bits = it->second;
+    for (int i = bits.find_first(); i != -1; i = bits.find_next(i)) {
+      if ((unsigned)i < term->getNumSuccessors() &&
+          term->getSuccessor(i) == dst) {
+        return true;
+      }
+    }
+  }
+  return !m_others.empty() && m_others.count({src, dst}) > 0;
+}
+
+void edges_set::erase_if_source(std::function<bool(const BasicBlock *)> pred) {
+  std::vector<const BasicBlock *> erased;
+  for (auto &kv : m_succs) {
+    if (pred(kv.first)) {
+      erased.push_back(kv.first);
+    }
+  }
+  for (const BasicBlock *b : erased) {
+    m_succs.erase(b);
+  }
+  for (auto it = m_others.begin(); it != m_others.end();) {
+    if (pred(it->first)) {
+      it = m_others.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void edges_set::clear() {
+  m_succs.clear();
+  m_others.clear();
+}
+
+} // end namespace clam
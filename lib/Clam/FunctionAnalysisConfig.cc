@@ -0,0 +1,196 @@
+#include "FunctionAnalysisConfig.hh"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include "clam/Support/Debug.hh"
+
+namespace clam {
+
+using namespace llvm;
+
+bool FunctionAnalysisConfig::parseSetting(StringRef setting, Settings &s,
+					  std::string &err) const {
+  StringRef key, val;
+  std::tie(key, val) = setting.split('=');
+  if (key.empty() || val.empty()) {
+    err = ("expected key=value instead of " + setting).str();
+    return false;
+  }
+  if (key == "dom") {
+    CrabDomain dom;
+    if (!m_parser(val, dom)) {
+      err = ("unknown domain " + val).str();
+      return false;
+    }
+    s.dom = dom;
+    return true;
+  }
+  if (key == "fixpoint") {
+    if (val == "wto") {
+      s.fixpoint = WTO_FIXPOINT;
+    } else if (val == "worklist") {
+      s.fixpoint = WORKLIST_FIXPOINT;
+    } else {
+      err = ("unknown fixpoint " + val).str();
+      return false;
+    }
+    return true;
+  }
+  unsigned n;
+  if (val.getAsInteger(10, n)) {
+    err = ("expected a number for " + key + " instead of " + val).str();
+    return false;
+  }
+  if (key == "widening-delay") {
+    s.widening_delay = n;
+  } else if (key == "narrowing-iterations") {
+    s.narrowing_iters = n;
+  } else if (key == "widening-jump-set") {
+    s.widening_jumpset = n;
+  } else if (key == "relational-threshold") {
+    s.relational_threshold = n;
+  } else if (key == "max-disjuncts") {
+    s.max_disjuncts = n;
+  } else {
+    err = ("unknown key " + key).str();
+    return false;
+  }
+  return true;
+}
+
+bool FunctionAnalysisConfig::readFile(StringRef filename, std::string &err) {
+  auto buf = MemoryBuffer::getFile(filename);
+  if (!buf) {
+    err = "cannot read " + filename.str() + ": " + buf.getError().message();
+    return false;
+  }
+  for (line_iterator it(**buf, true /*skip blanks*/, '#'); !it.is_at_end(); ++it) {
+    auto error = [&](const Twine &msg) {
+      err = (filename + ":" + Twine(it.line_number()) + ": " + msg).str();
+      return false;
+    };
+    StringRef glob, rest;
+    std::tie(glob, rest) = getToken(*it);
+    Expected<GlobPattern> pattern = GlobPattern::create(glob);
+    if (!pattern) {
+      return error(toString(pattern.takeError()));
+    }
+    Settings s;
+    while (true) {
+      StringRef setting;
+      std::tie(setting, rest) = getToken(rest);
+      if (setting.empty()) {
+	break;
+      }
+      std::string msg;
+      if (!parseSetting(setting, s, msg)) {
+	return error(msg);
+      }
+    }
+    m_entries.emplace_back(std::move(*pattern), s);
+  }
+  return true;
+}
+
+void FunctionAnalysisConfig::readAnnotations(const Module &M) {
+  // llvm.global.annotations is an array of
+  // { i8* function, i8* annotation, i8* file, i32 line }
+  const GlobalVariable *annotations = M.getNamedGlobal("llvm.global.annotations");
+  if (!annotations || !annotations->hasInitializer()) {
+    return;
+  }
+  const ConstantArray *entries =
+    dyn_cast<ConstantArray>(annotations->getInitializer());
+  if (!entries) {
+    return;
+  }
+  for (const Use &U: entries->operands()) {
+    const ConstantStruct *entry = dyn_cast<ConstantStruct>(U.get());
+    if (!entry || entry->getNumOperands() < 2) {
+      continue;
+    }
+    const Function *F =
+      dyn_cast<Function>(entry->getOperand(0)->stripPointerCasts());
+    const GlobalVariable *str =
+      dyn_cast<GlobalVariable>(entry->getOperand(1)->stripPointerCasts());
+    if (!F || !str || !str->hasInitializer()) {
+      continue;
+    }
+    const ConstantDataSequential *data =
+      dyn_cast<ConstantDataSequential>(str->getInitializer());
+    if (!data || !data->isCString()) {
+      continue;
+    }
+    StringRef annotation = data->getAsCString();
+    if (!annotation.startswith("clam.")) {
+      continue;
+    }
+    std::string err;
+    Settings &s = m_annotations[F];
+    if (!parseSetting(annotation.drop_front(5), s, err)) {
+      CLAM_WARNING("ignored annotation of " << F->getName() << ": " << err);
+    }
+  }
+}
+
+void FunctionAnalysisConfig::applySettings(const Settings &s,
+					   AnalysisParams &params) {
+  if (s.dom.hasValue()) {
+    params.dom = s.dom.getValue();
+  }
+  if (s.fixpoint.hasValue()) {
+    params.fixpoint = s.fixpoint.getValue();
+  }
+  if (s.widening_delay.hasValue()) {
+    params.widening_delay = s.widening_delay.getValue();
+    params.auto_widening_delay = false;
+  }
+  if (s.narrowing_iters.hasValue()) {
+    params.narrowing_iters = s.narrowing_iters.getValue();
+  }
+  if (s.widening_jumpset.hasValue()) {
+    params.widening_jumpset = s.widening_jumpset.getValue();
+    params.auto_widening_jumpset = false;
+  }
+  if (s.relational_threshold.hasValue()) {
+    params.relational_threshold = s.relational_threshold.getValue();
+  }
+  if (s.max_disjuncts.hasValue()) {
+    params.max_disjuncts = s.max_disjuncts.getValue();
+  }
+  if (s.reuse_latest.hasValue()) {
+    params.reuse_latest = s.reuse_latest.getValue();
+  }
+}
+
+void FunctionAnalysisConfig::setReuseLatest(const Function &F) {
+  m_annotations[&F].reuse_latest = true;
+}
+
+bool FunctionAnalysisConfig::apply(const Function &F,
+				   AnalysisParams &params) const {
+  bool found = false;
+  for (auto &kv: m_entries) {
+    if (kv.first.match(F.getName())) {
+      applySettings(kv.second, params);
+      found = true;
+      break;
+    }
+  }
+  auto it = m_annotations.find(&F);
+  if (it != m_annotations.end()) {
+    applySettings(it->second, params);
+    found = true;
+  }
+  return found;
+}
+
+} // end namespace clam
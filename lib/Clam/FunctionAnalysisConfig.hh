@@ -0,0 +1,86 @@
+#pragma once
+
+/* Analysis parameters of individual functions */
+
+#include "clam/ClamAnalysisParams.hh"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/GlobPattern.h"
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class Function;
+class Module;
+}
+
+namespace clam {
+
+/*
+ * Override the abstract domain and the widening parameters of some
+ * functions. The settings come from a configuration file with one
+ * entry per line:
+ *
+ *   # comment
+ *   <glob> key=value ...
+ *
+ * where key is one of dom, fixpoint, widening-delay,
+ * narrowing-iterations, widening-jump-set, relational-threshold or
+ * max-disjuncts (the values are the ones of the --crab-* options with
+ * the same name), and from the annotations of the functions:
+ *
+ *   __attribute__((annotate("clam.dom=zones")))
+ *
+ * The first entry of the file whose glob matches the name of the
+ * function is used. The annotations take precedence over the file.
+ */
+class FunctionAnalysisConfig {
+public:
+  // Return false if name is not a domain
+  typedef std::function<bool(llvm::StringRef, CrabDomain &)> domain_parser_t;
+
+  FunctionAnalysisConfig(domain_parser_t parser) : m_parser(parser) {}
+
+  // Return false and set err if the file cannot be read or an entry
+  // is not valid.
+  bool readFile(llvm::StringRef filename, std::string &err);
+
+  // Read the clam.* annotations of the functions of M. Invalid
+  // annotations are ignored with a warning.
+  void readAnnotations(const llvm::Module &M);
+
+  bool empty() const { return m_entries.empty() && m_annotations.empty(); }
+
+  // Reuse the last results of F (see AnalysisParams::reuse_latest)
+  void setReuseLatest(const llvm::Function &F);
+
+  // Override params with the settings of F. Return true if F has
+  // settings.
+  bool apply(const llvm::Function &F, AnalysisParams &params) const;
+
+private:
+  struct Settings {
+    llvm::Optional<CrabDomain> dom;
+    llvm::Optional<CrabFixpointEngine> fixpoint;
+    llvm::Optional<unsigned> widening_delay;
+    llvm::Optional<unsigned> narrowing_iters;
+    llvm::Optional<unsigned> widening_jumpset;
+    llvm::Optional<unsigned> relational_threshold;
+    llvm::Optional<unsigned> max_disjuncts;
+    llvm::Optional<bool> reuse_latest;
+  };
+
+  bool parseSetting(llvm::StringRef setting, Settings &s, std::string &err) const;
+  static void applySettings(const Settings &s, AnalysisParams &params);
+
+  domain_parser_t m_parser;
+  std::vector<std::pair<llvm::GlobPattern, Settings>> m_entries;
+  llvm::DenseMap<const llvm::Function *, Settings> m_annotations;
+};
+
+} // end namespace clam
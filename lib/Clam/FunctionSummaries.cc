@@ -0,0 +1,299 @@
+#include "FunctionSummaries.hh"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace clam {
+
+using namespace llvm;
+
+static const unsigned SUMMARIES_VERSION = 2;
+
+static std::string getBodyHash(const Function &F) {
+  MD5 hash;
+  std::string sig;
+  raw_string_ostream sig_os(sig);
+  F.getFunctionType()->print(sig_os);
+  hash.update(sig_os.str());
+  for (auto &I : instructions(F)) {
+    if (isa<DbgInfoIntrinsic>(I)) {
+      continue;
+    }
+    std::string str;
+    raw_string_ostream o(str);
+    I.print(o);
+    o.flush();
+    // -- remove the metadata attachments (e.g., !dbg !42) whose
+    //    numbering depends on the module
+    size_t pos = str.find(", !");
+    if (pos != std::string::npos) {
+      str.resize(pos);
+    }
+    hash.update(str);
+    hash.update("\n");
+  }
+  MD5::MD5Result result;
+  hash.final(result);
+  SmallString<32> res;
+  MD5::stringifyResult(result, res);
+  return res.str();
+}
+
+std::string FunctionSummaries::getHash(const Function &F) {
+  // -- collect the functions transitively called (directly) from F
+  //    so that a summary is not reused if one of them changed.
+  SmallPtrSet<const Function *, 16> visited;
+  SmallVector<const Function *, 16> worklist;
+  std::vector<std::pair<std::string, std::string>> callees;
+  visited.insert(&F);
+  worklist.push_back(&F);
+  while (!worklist.empty()) {
+    const Function *G = worklist.pop_back_val();
+    for (auto &I : instructions(*G)) {
+      if (isa<DbgInfoIntrinsic>(I)) {
+        continue;
+      }
+      ImmutableCallSite CS(&I);
+      if (!CS) {
+        continue;
+      }
+      const Function *callee = dyn_cast_or_null<Function>(
+          CS.getCalledValue()->stripPointerCasts());
+      if (!callee || callee->isIntrinsic() || !visited.insert(callee).second) {
+        continue;
+      }
+      if (callee->isDeclaration()) {
+        // -- only its name is known
+        callees.push_back({callee->getName().str(), ""});
+      } else {
+        callees.push_back({callee->getName().str(), getBodyHash(*callee)});
+        worklist.push_back(callee);
+      }
+    }
+  }
+  // -- the order of the callees must not depend on the order of the
+  //    instructions
+  std::sort(callees.begin(), callees.end());
+  MD5 hash;
+  hash.update(getBodyHash(F));
+  for (auto &kv : callees) {
+    hash.update("\n");
+    hash.update(kv.first);
+    hash.update(" ");
+    hash.update(kv.second);
+  }
+  MD5::MD5Result result;
+  hash.final(result);
+  SmallString<32> res;
+  MD5::stringifyResult(result, res);
+  return res.str();
+}
+
+static bool isValidName(StringRef name) {
+  return !name.empty() && name.find_first_of(" \t\n") == StringRef::npos;
+}
+
+bool FunctionSummaries::add(const Function &F, const Value *ret,
+                            bool is_bottom, const lin_cst_sys_t &csts) {
+  if (!isValidName(F.getName()) || F.isVarArg()) {
+    return false;
+  }
+  Summary s;
+  s.name = F.getName();
+  s.num_args = F.arg_size();
+  s.hash = getHash(F);
+  s.is_bottom = is_bottom;
+  if (!is_bottom) {
+    if (ret) {
+      // -- the return value is a constant or an argument: it is
+      //    not in the invariant
+      Constraint eq;
+      eq.kind = "eq";
+      eq.is_signed = true;
+      eq.constant = number_t(0);
+      if (const ConstantInt *c = dyn_cast<ConstantInt>(ret)) {
+        eq.constant = number_t(0) - number_t(c->getValue().toString(10, true));
+        eq.terms.push_back({number_t(1), RET});
+        s.csts.push_back(eq);
+      } else if (const Argument *a = dyn_cast<Argument>(ret)) {
+        eq.terms.push_back({number_t(1), RET});
+        eq.terms.push_back({number_t(-1), a->getArgNo()});
+        s.csts.push_back(eq);
+      }
+    }
+    for (auto const &cst : csts) {
+      Constraint c;
+      if (cst.is_equality()) {
+        c.kind = "eq";
+      } else if (cst.is_disequation()) {
+        c.kind = "ne";
+      } else if (cst.is_strict_inequality()) {
+        c.kind = "lt";
+      } else if (cst.is_inequality()) {
+        c.kind = "le";
+      } else {
+        continue;
+      }
+      c.is_signed = cst.is_signed();
+      c.constant = cst.expression().constant();
+      bool valid = true;
+      for (auto t : cst.expression()) {
+        auto name = t.second.name().get();
+        const Value *v = name ? *name : nullptr;
+        if (v && v == ret) {
+          c.terms.push_back({t.first, RET});
+        } else if (const Argument *a = dyn_cast_or_null<Argument>(v)) {
+          c.terms.push_back({t.first, a->getArgNo()});
+        } else {
+          valid = false;
+          break;
+        }
+      }
+      if (valid && !c.terms.empty()) {
+        s.csts.push_back(c);
+      }
+    }
+  }
+  m_summaries[s.name] = s;
+  return true;
+}
+
+bool FunctionSummaries::writeFile(StringRef filename, std::string &err) const {
+  std::error_code ec;
+  raw_fd_ostream o(filename, ec, sys::fs::F_Text);
+  if (ec) {
+    err = "cannot write " + filename.str() + ": " + ec.message();
+    return false;
+  }
+  o << "clam-summaries " << SUMMARIES_VERSION << "\n";
+  for (auto &kv : m_summaries) {
+    const Summary &s = kv.second;
+    o << "function " << s.name << " " << s.num_args << " " << s.hash << " ";
+    if (s.is_bottom) {
+      o << "bottom\n";
+      continue;
+    }
+    o << s.csts.size() << "\n";
+    for (auto &c : s.csts) {
+      o << c.kind << " " << c.is_signed << " " << c.constant.get_str() << " "
+        << c.terms.size();
+      for (auto &t : c.terms) {
+        o << " " << t.coef.get_str() << " ";
+        if (t.arg == RET) {
+          o << "r";
+        } else {
+          o << "a" << t.arg;
+        }
+      }
+      o << "\n";
+    }
+  }
+  return true;
+}
+
+static bool readConstraint(std::istream &in, unsigned num_args,
+                           FunctionSummaries::Constraint &c) {
+  std::string constant;
+  unsigned num_terms;
+  if (!(in >> c.kind >> c.is_signed >> constant >> num_terms)) {
+    return false;
+  }
+  if (c.kind != "eq" && c.kind != "ne" && c.kind != "lt" && c.kind != "le") {
+    return false;
+  }
+  c.constant = number_t(constant);
+  for (unsigned i = 0; i < num_terms; ++i) {
+    std::string coef, ref;
+    if (!(in >> coef >> ref) || ref.empty()) {
+      return false;
+    }
+    unsigned arg;
+    if (ref == "r") {
+      arg = FunctionSummaries::RET;
+    } else if (ref[0] != 'a' ||
+               StringRef(ref).drop_front(1).getAsInteger(10, arg) ||
+               arg >= num_args) {
+      return false;
+    }
+    c.terms.push_back({number_t(coef), arg});
+  }
+  return true;
+}
+
+bool FunctionSummaries::readFile(StringRef filename, std::string &err) {
+  auto buf = MemoryBuffer::getFile(filename);
+  if (!buf) {
+    err = "cannot read " + filename.str() + ": " + buf.getError().message();
+    return false;
+  }
+  std::istringstream in((*buf)->getBuffer().str());
+  std::string tag;
+  unsigned version;
+  if (!(in >> tag >> version) || tag != "clam-summaries" ||
+      version != SUMMARIES_VERSION) {
+    err = filename.str() + " is not a summaries file of this version";
+    return false;
+  }
+  while (in >> tag) {
+    Summary s;
+    std::string num;
+    if (tag != "function" || !(in >> s.name >> s.num_args >> s.hash >> num)) {
+      err = filename.str() + ": unexpected " + tag;
+      return false;
+    }
+    if (num == "bottom") {
+      s.is_bottom = true;
+    } else {
+      unsigned num_csts;
+      if (StringRef(num).getAsInteger(10, num_csts)) {
+        err = filename.str() + ": unexpected " + num + " in " + s.name;
+        return false;
+      }
+      for (unsigned i = 0; i < num_csts; ++i) {
+        Constraint c;
+        if (!readConstraint(in, s.num_args, c)) {
+          err = filename.str() + ": invalid constraint in " + s.name;
+          return false;
+        }
+        s.csts.push_back(c);
+      }
+    }
+    m_summaries[s.name] = s;
+  }
+  return true;
+}
+
+void FunctionSummaries::match(const Module &M) {
+  m_matches.clear();
+  for (auto &F : M) {
+    auto it = m_summaries.find(F.getName());
+    if (it == m_summaries.end() || it->second.num_args != F.arg_size() ||
+        F.isVarArg()) {
+      continue;
+    }
+    if (F.isDeclaration() || it->second.hash == getHash(F)) {
+      m_matches[&F] = &it->second;
+    }
+  }
+}
+
+const FunctionSummaries::Summary *
+FunctionSummaries::lookup(const Function &F) const {
+  return m_matches.lookup(&F);
+}
+
+} // end namespace clam
@@ -0,0 +1,107 @@
+#pragma once
+
+/* Summaries of functions shared by the analyses of several modules */
+
+#include "clam/crab/crab_cfg.hh"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class Function;
+class Module;
+class Value;
+} // namespace llvm
+
+namespace clam {
+
+/*
+ * A summary is a linear relation between the arguments and the
+ * return value of a function that holds whenever the function
+ * returns. The summaries are exported from the analysis of a module
+ * (e.g., a library) and imported by the analysis of other modules:
+ * a call to a function with a summary is translated as an assumption
+ * of the relation instead of a call, so the function does not need a
+ * CFG. The memory regions modified by the function are still havoc'ed
+ * as for any external call.
+ *
+ * A summary applies to a declaration with the same name and number
+ * of arguments, or to a definition with the same name and the same
+ * hash. The hash covers the body of the function and the bodies of
+ * the functions it calls, transitively.
+ *
+ * Format of a summaries file (one item per line):
+ *
+ *   clam-summaries <version>
+ *   function <name> <num args> <hash> bottom
+ *   function <name> <num args> <hash> <n>    followed by n lines:
+ *     <eq|ne|le|lt> <signed> <constant> <m> (<coef> <a<n>|r>)*
+ *
+ * where a<n> is the n-th argument and r is the return value.
+ */
+class FunctionSummaries {
+public:
+  struct Term {
+    number_t coef;
+    // position of the argument, or RET
+    unsigned arg;
+  };
+  enum { RET = ~0U };
+
+  struct Constraint {
+    std::string kind;
+    bool is_signed;
+    number_t constant;
+    std::vector<Term> terms;
+  };
+
+  struct Summary {
+    std::string name;
+    unsigned num_args;
+    std::string hash;
+    // the function never returns
+    bool is_bottom;
+    std::vector<Constraint> csts;
+    Summary() : num_args(0), is_bottom(false) {}
+  };
+
+  // Return a hash of the body of F and of the bodies of all the
+  // functions transitively called by F (for declarations only their
+  // names). It does not depend on the module (e.g., on the numbering
+  // of metadata).
+  static std::string getHash(const llvm::Function &F);
+
+  // Return false and set err if the file cannot be read or it is not
+  // valid.
+  bool readFile(llvm::StringRef filename, std::string &err);
+
+  // Return false and set err if the file cannot be written.
+  bool writeFile(llvm::StringRef filename, std::string &err) const;
+
+  // Add the summary of F from the invariant that holds at its return
+  // instruction. csts are over the LLVM values of F. Constraints over
+  // other values than the arguments of F and ret are ignored. Return
+  // false if F cannot be summarized.
+  bool add(const llvm::Function &F, const llvm::Value *ret, bool is_bottom,
+           const lin_cst_sys_t &csts);
+
+  // Match the summaries with the functions of M. It must be called
+  // before lookup.
+  void match(const llvm::Module &M);
+
+  // Return the summary of F or null.
+  const Summary *lookup(const llvm::Function &F) const;
+
+  unsigned size() const { return m_summaries.size(); }
+
+private:
+  // summaries indexed by name
+  std::map<std::string, Summary> m_summaries;
+  llvm::DenseMap<const llvm::Function *, const Summary *> m_matches;
+};
+
+} // end namespace clam
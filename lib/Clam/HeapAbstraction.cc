@@ -0,0 +1,49 @@
+#include "clam/HeapAbstraction.hh"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+
+namespace clam {
+
+using namespace llvm;
+
+void HeapAbstraction::forEachPointer(const Instruction &I,
+				     function_ref<void(const Value *)> f) {
+  SmallPtrSet<const Value *, 4> seen;
+  if (I.getType()->isPointerTy()) {
+    seen.insert(&I);
+    f(&I);
+  }
+  for (const Value *v : I.operand_values()) {
+    if (v->getType()->isPointerTy() && seen.insert(v).second) {
+      f(v);
+    }
+  }
+}
+
+const HeapAbstraction::RegionMap &
+HeapAbstraction::getRegionMap(const Function &F) {
+  {
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+    auto it = m_region_maps.find(&F);
+    if (it != m_region_maps.end()) {
+      return it->second;
+    }
+  }
+  // without the lock because getRegion can use the default views
+  RegionMap regions;
+  for (auto &I : instructions(F)) {
+    forEachPointer(I, [&](const Value *v) {
+      if (!regions.count(v)) {
+        // -- all the users of a pointer get the same region
+        regions.insert({v, getRegion(F, &I, v)});
+      }
+    });
+  }
+  std::lock_guard<std::mutex> lock(m_cache_mutex);
+  return m_region_maps.insert({&F, std::move(regions)}).first->second;
+}
+
+} // end namespace clam
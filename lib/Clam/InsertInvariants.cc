@@ -15,6 +15,8 @@
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DepthFirstIterator.h"
 
 #include "clam/config.h"
 #include "clam/AbstractDomain.hh"
@@ -23,6 +25,13 @@
 #include "clam/Clam.hh"
 #include "crab/analysis/abs_transformer.hpp"
 
+#include "CfgBuilderUtils.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
 /* 
  * Instrument LLVM bitcode by inserting invariants computed by Crab.
  * 
@@ -58,13 +67,27 @@ InvLoc("crab-add-invariants",
 	      "DCE + add invariants after each load instruction"),
          clEnumValN(ALL, "all", "DCE + add invariants at all locations (very verbose)")),
      cl::init(NONE));
+
+static cl::opt<bool>
+DedupInvariants("crab-add-invariants-dedup",
+     cl::desc("Skip invariants already inserted at a dominator and insert "
+	      "one verifier.assume per block"),
+     cl::init(false));
             
+static cl::opt<unsigned>
+InsertThreads("crab-add-invariants-threads",
+     cl::desc("Number of threads that extract the constraints of the "
+	      "functions and plan their instrumentation. The code is "
+	      "inserted by one thread"),
+     cl::init(1));
+
 #define DEBUG_TYPE "crab-insert-invars"
 
 STATISTIC(NumDeadBlocks, "Number of dead blocks");
 STATISTIC(NumDeadEdges, "Number of dead edges");
 STATISTIC(NumInstrBlocks, "Number of blocks instrumented with invariants");
 STATISTIC(NumInstrLoads, "Number of load inst instrumented with invariants");
+STATISTIC(NumDedupCsts, "Number of invariants implied by a dominator");
 
 namespace clam {
 
@@ -95,6 +118,10 @@ struct CodeExpander {
   }
        
   Value* mk_num(number_t n, IntegerType* ty, LLVMContext &ctx) {
+    int64_t k;
+    if (toInt64(n, k)) {
+      return ConstantInt::getSigned(ty, k);
+    }
     return ConstantInt::get(ty, n.get_str(), 10);
   }
 
@@ -143,6 +170,39 @@ struct CodeExpander {
     return change;
   }
 
+  //! Generate llvm bitcode from a set of linear constraints but only
+  //  one verifier.assume for the conjunction of all of them. The
+  //  translated constraints are added to emitted.
+  bool gen_shared_code(lin_cst_sys_t csts, IRBuilder<> B, LLVMContext &ctx,
+		       Function* assumeFn, CallGraph* cg, DominatorTree* DT,
+		       const Function* insertFun, lin_cst_unordered_set &emitted,
+		       const Twine &Name = "") {
+    Value *cond = nullptr;
+    for (auto cst: csts) {
+      if (Value* cst_code = gen_code(cst, B, ctx, DT, Name)) {
+	cond = (cond ? B.CreateAnd(cond, cst_code, Name) : cst_code);
+	emitted.insert(cst);
+      }
+    }
+    if (!cond) {
+      return false;
+    }
+    CallInst *ci = B.CreateCall(assumeFn, cond);
+    if (cg) {
+      (*cg)[insertFun]->addCalledFunction
+	(CallSite(ci),(*cg)[ci->getCalledFunction()]);
+    }
+    return true;
+  }
+
+  //! Return true if gen_code translates cst into code inserted in
+  //  User.
+  bool can_gen_code(const lin_cst_t &cst, const BasicBlock *User,
+		    DominatorTree* DT) {
+    return !cst.is_tautology() &&
+      (cst.is_contradiction() || get_code_type(cst, User, DT));
+  }
+
   // post: return a value of bool type(Int1Ty) that contains the
   // computation of cst
   Value* gen_code(lin_cst_t cst, IRBuilder<> B, LLVMContext &ctx,
@@ -155,6 +215,46 @@ struct CodeExpander {
       return mk_bool(ctx, false);
     }
 
+    IntegerType* ty = get_code_type(cst, B.GetInsertBlock(), DT);
+    if (!ty) {
+      return nullptr;
+    }
+    
+    auto e = cst.expression() - cst.expression().constant();
+    Value * ee = mk_num(number_t("0"), ty, ctx);
+    for (auto t : e) {
+      number_t n  = t.first;
+      if (n == 0) continue; 
+      varname_t v = t.second.name();
+      Value * vv = mk_var(v);
+      assert(vv);
+      assert(vv->getType()->isIntegerTy());
+      if (n == 1) {
+	ee = mk_bin_op(ADD, B, ee, vv, Name);
+      } else if (n == -1) {
+	ee = mk_bin_op(SUB, B, ee, vv, Name);
+      } else {
+	ee = mk_bin_op(ADD, B, ee, 
+		       mk_bin_op(MUL, B, mk_num(n, ty, ctx), vv, Name), 
+		       Name);
+      }
+    }
+      
+    number_t c = -cst.expression().constant();
+    Value* cc = mk_num(c, ty, ctx);
+    if (cst.is_inequality()) {
+      return B.CreateICmpSLE(ee, cc, Name);
+    } else if (cst.is_equality()) {
+      return B.CreateICmpEQ(ee, cc, Name);        
+    } else {
+      return B.CreateICmpNE(ee, cc, Name);
+    }
+  }
+
+  // Return the integer type of the code of cst if gen_code can insert
+  // it in User, otherwise null.
+  IntegerType* get_code_type(const lin_cst_t &cst, const BasicBlock *User,
+			     DominatorTree* DT) {
     // translate only expressions of LLVM integer type
     IntegerType* ty = nullptr;
     for (auto v: cst.variables()) {
@@ -184,7 +284,6 @@ struct CodeExpander {
 	if (Instruction* Def = dyn_cast<Instruction>(vv)) {
 	  // check definition of invariant variable dominates the
 	  // block where the invariant will be inserted.
-	  BasicBlock* User = B.GetInsertBlock();
 	  if (Def->getParent() == User && isa<PHINode>(Def)) {
 	    // definition is a PHI node and its user is in the same
 	    // basic block.  Since we only insert invariants after the
@@ -200,37 +299,7 @@ struct CodeExpander {
 	return nullptr;
       }
     }
-
-    
-    auto e = cst.expression() - cst.expression().constant();
-    Value * ee = mk_num(number_t("0"), ty, ctx);
-    for (auto t : e) {
-      number_t n  = t.first;
-      if (n == 0) continue; 
-      varname_t v = t.second.name();
-      Value * vv = mk_var(v);
-      assert(vv);
-      assert(vv->getType()->isIntegerTy());
-      if (n == 1) {
-	ee = mk_bin_op(ADD, B, ee, vv, Name);
-      } else if (n == -1) {
-	ee = mk_bin_op(SUB, B, ee, vv, Name);
-      } else {
-	ee = mk_bin_op(ADD, B, ee, 
-		       mk_bin_op(MUL, B, mk_num(n, ty, ctx), vv, Name), 
-		       Name);
-      }
-    }
-      
-    number_t c = -cst.expression().constant();
-    Value* cc = mk_num(c, ty, ctx);
-    if (cst.is_inequality()) {
-      return B.CreateICmpSLE(ee, cc, Name);
-    } else if (cst.is_equality()) {
-      return B.CreateICmpEQ(ee, cc, Name);        
-    } else {
-      return B.CreateICmpNE(ee, cc, Name);
-    }
+    return ty;
   }
 };
 
@@ -253,6 +322,44 @@ static bool instrument_block(lin_cst_sys_t csts, llvm::BasicBlock* bb,
   return res;
 }
 
+//! Instrument basic block entries with the constraints that are not
+//  already inserted at a dominator. All the constraints inserted at
+//  the entry of a block are kept in inserted.
+static bool instrument_block_dedup(lin_cst_sys_t csts, llvm::BasicBlock* bb,
+				   LLVMContext &ctx, CallGraph* cg,
+				   DominatorTree* DT, Function* assumeFn,
+				   DenseMap<const BasicBlock*, lin_cst_unordered_set> &inserted) {
+  const ReturnInst *ret = dyn_cast<const ReturnInst>(bb->getTerminator());
+  if (ret) return false;
+
+  // Since the program is in SSA form a constraint that holds at the
+  // entry of a dominator still holds at the entry of bb.
+  lin_cst_sys_t new_csts;
+  for (auto cst: csts) {
+    bool implied = false;
+    for (DomTreeNode *N = DT->getNode(bb)->getIDom(); N && !implied;
+	 N = N->getIDom()) {
+      auto it = inserted.find(N->getBlock());
+      implied = (it != inserted.end() && it->second.count(cst) > 0);
+    }
+    if (implied) {
+      NumDedupCsts++;
+    } else {
+      new_csts += cst;
+    }
+  }
+  
+  IRBuilder<> Builder(ctx);
+  Builder.SetInsertPoint(bb->getFirstNonPHI());
+  CodeExpander g;
+  bool res = g.gen_shared_code(new_csts, Builder, ctx, assumeFn, cg, DT,
+			       bb->getParent(), inserted[bb], "crab_");
+  if (res) {
+    NumInstrBlocks++;
+  }
+  return res;
+}
+
 //! Instrument all load instructions in a basic block.
 //
 // The instrumentation is a bit involved because Crab gives us
@@ -262,49 +369,40 @@ static bool instrument_block(lin_cst_sys_t csts, llvm::BasicBlock* bb,
 // them locally across the statements of the basic block. This will
 // redo some work but it's more efficient than storing all
 // invariants at each program point.
-template<typename AbsDomain>
-static bool instrument_loads(AbsDomain inv, basic_block_t& bb,
+static bool instrument_loads(GenericAbsDomWrapperPtr inv, basic_block_t& bb,
 			     LLVMContext &ctx, CallGraph* cg, Function* assumeFn) { 
-  // -- it will propagate forward inv through the basic block
-  //    but ignoring callsites    
-  typedef crab::analyzer::intra_abs_transformer<AbsDomain> abs_tr_t; 
   typedef array_load_stmt<number_t,varname_t> array_load_stmt_t;
   typedef ptr_load_stmt<number_t,varname_t> ptr_load_stmt_t;    
     
   IRBuilder<> Builder(ctx);
   bool change=false;
-  abs_tr_t vis(inv);
-    
-  for (auto &s: bb) {
-    s.accept(&vis); //propagate the invariant one statement forward
+  std::vector<var_t> load_vs;
+  // -- it will propagate forward inv through the basic block
+  //    but ignoring callsites. The wrapper does it regardless of the
+  //    underlying domain and without copying it for the client.
+  inv->propagate(bb, [&](const statement_t &s, bool is_top,
+			 const GenericAbsDomWrapper::constraints_filter_t &filter) {
     const LoadInst* I = nullptr;
-    lin_cst_t::variable_set_t load_vs;
+    load_vs.clear();
     if (s.is_arr_read()) { 
       const array_load_stmt_t* load_stmt = static_cast<const array_load_stmt_t*>(&s);
       if (auto v = load_stmt->lhs().name().get()) {
 	I = dyn_cast<const LoadInst>(*v);
-	load_vs += load_stmt->lhs();
+	load_vs.push_back(load_stmt->lhs());
       }
     }
     else if (s.is_ptr_read()) { 
       const ptr_load_stmt_t* load_stmt = static_cast<const ptr_load_stmt_t*>(&s);
       if (auto v = load_stmt->lhs().name().get()) {
 	I = dyn_cast<const LoadInst>(*v);	
-	load_vs += load_stmt->lhs();
+	load_vs.push_back(load_stmt->lhs());
       }
     }
       
-    if (!I) continue;
+    if (!I || is_top) return true;
     
-    AbsDomain next_inv = std::move(vis.get_abs_value());
-    if (next_inv.is_top()) continue;
     // -- Filter out all constraints that do not use x.
-    lin_cst_sys_t rel_csts;
-    for (auto cst: next_inv.to_linear_constraint_system()) {
-      auto vs = cst.variables();
-      if (!(vs & load_vs).empty())
-	rel_csts += cst;
-    }
+    lin_cst_sys_t rel_csts = filter(load_vs);
 
     // -- Insert assume's the next after I
     Builder.SetInsertPoint(const_cast<LoadInst*>(I));
@@ -316,7 +414,8 @@ static bool instrument_loads(AbsDomain inv, basic_block_t& bb,
     NumInstrLoads++;
     change |= g.gen_code(rel_csts, Builder, ctx, assumeFn, cg, nullptr,
 			 I->getParent()->getParent(), "crab_");
-  }
+    return true;
+  });
   return change;
 }
 
@@ -388,6 +487,292 @@ static void removeInfeasibleEdge(BasicBlock* BB, BasicBlock* Succ) {
   }
 }
 
+//! Instrumentation of a function planned by planFunction and done
+//  by applyPlan. Only applyPlan changes the IR.
+struct FunctionPlan {
+  // constraints inserted before an instruction
+  struct Insertion {
+    Instruction *InsertPt;
+    lin_cst_sys_t Csts;
+    // one verifier.assume for all the constraints
+    bool Shared;
+    // after a load (otherwise at the entry of the block)
+    bool AfterLoad;
+  };
+  
+  Function *F;
+  // -- filled by the main thread since they query ClamPass
+  DenseMap<const BasicBlock*, GenericAbsDomWrapperPtr> PreInvs;
+  // invariants with shadows at the entry of the blocks with loads
+  std::vector<std::pair<const BasicBlock*, GenericAbsDomWrapperPtr>> LoadInvs;
+  DenseMap<const BasicBlock*, basic_block_t*> CrabBlocks;
+  std::vector<BasicBlock*> UnreachableBlocks;
+  std::vector<std::pair<BasicBlock*, BasicBlock*>> InfeasibleEdges;
+  // the transformers of the domain are not thread-safe (see
+  // isExclusiveDomain)
+  bool Exclusive;
+  // -- filled by planFunction
+  std::vector<Insertion> Insertions;
+  unsigned NumDedup;
+  
+  FunctionPlan(Function *F): F(F), Exclusive(false), NumDedup(0) {}
+};
+
+//! Plan the instrumentation of the entry of the blocks and of the
+//  loads of plan.F. The constraints that cannot be inserted are
+//  dropped here so that applyPlan does not need DT.
+static void planFunction(FunctionPlan &plan) {
+  Function &F = *plan.F;
+  std::unique_ptr<DominatorTree> DT;
+  std::unique_ptr<LoopInfo> LI;
+  if (InvLoc == PER_BLOCK || InvLoc == PER_LOOP || InvLoc == ALL) {
+    DT.reset(new DominatorTree(F));
+  }
+  if (InvLoc == PER_LOOP) {
+    LI.reset(new LoopInfo(*DT));
+  }
+  CodeExpander g;
+  DenseMap<const BasicBlock*, lin_cst_sys_t> BlockCsts;
+  auto load_it = plan.LoadInvs.begin(), load_et = plan.LoadInvs.end();
+  for (auto &B : F) {
+    if (isa<UnreachableInst>(B.getTerminator())) continue;
+    
+    auto pre = plan.PreInvs.lookup(&B);
+    if (pre && InvLoc != PER_LOAD &&
+	!isa<ReturnInst>(B.getTerminator()) &&
+	(InvLoc != PER_LOOP || LI->isLoopHeader(&B))) {
+      lin_cst_sys_t csts;
+      for (auto const &cst: pre->to_linear_constraints()) {
+	if (g.can_gen_code(cst, &B, DT.get())) {
+	  csts += cst;
+	}
+      }
+      if (DedupInvariants) {
+	BlockCsts[&B] = csts;
+      } else {
+	plan.Insertions.push_back({B.getFirstNonPHI(), csts, false, false});
+      }
+    }
+    
+    if (load_it != load_et && load_it->first == &B) {
+      typedef array_load_stmt<number_t,varname_t> array_load_stmt_t;
+      typedef ptr_load_stmt<number_t,varname_t> ptr_load_stmt_t;
+      std::vector<var_t> load_vs;
+      load_it->second->propagate(*plan.CrabBlocks.lookup(&B), [&](const statement_t &s, bool is_top,
+				     const GenericAbsDomWrapper::constraints_filter_t &filter) {
+	const LoadInst* I = nullptr;
+	load_vs.clear();
+	if (s.is_arr_read()) { 
+	  const array_load_stmt_t* load_stmt = static_cast<const array_load_stmt_t*>(&s);
+	  if (auto v = load_stmt->lhs().name().get()) {
+	    I = dyn_cast<const LoadInst>(*v);
+	    load_vs.push_back(load_stmt->lhs());
+	  }
+	} else if (s.is_ptr_read()) { 
+	  const ptr_load_stmt_t* load_stmt = static_cast<const ptr_load_stmt_t*>(&s);
+	  if (auto v = load_stmt->lhs().name().get()) {
+	    I = dyn_cast<const LoadInst>(*v);	
+	    load_vs.push_back(load_stmt->lhs());
+	  }
+	}
+	if (!I || is_top) return true;
+	lin_cst_sys_t csts;
+	for (auto const &cst: filter(load_vs)) {
+	  if (g.can_gen_code(cst, I->getParent(), nullptr)) {
+	    csts += cst;
+	  }
+	}
+	plan.Insertions.push_back({const_cast<LoadInst*>(I)->getNextNode(),
+				   csts, false, true});
+	return true;
+      });
+      ++load_it;
+    }
+  }
+
+  if (!BlockCsts.empty()) {
+    // as instrument_block_dedup but the constraints are only planned
+    DenseMap<const BasicBlock*, lin_cst_unordered_set> Inserted;
+    for (DomTreeNode *N: depth_first(DT->getRootNode())) {
+      auto it = BlockCsts.find(N->getBlock());
+      if (it == BlockCsts.end()) continue;
+      lin_cst_sys_t new_csts;
+      for (auto const &cst: it->second) {
+	bool implied = false;
+	for (DomTreeNode *D = N->getIDom(); D && !implied; D = D->getIDom()) {
+	  auto dit = Inserted.find(D->getBlock());
+	  implied = (dit != Inserted.end() && dit->second.count(cst) > 0);
+	}
+	if (implied) {
+	  plan.NumDedup++;
+	} else {
+	  new_csts += cst;
+	  Inserted[N->getBlock()].insert(cst);
+	}
+      }
+      plan.Insertions.push_back({N->getBlock()->getFirstNonPHI(), new_csts,
+				 true, false});
+    }
+  }
+}
+
+//! Insert the code planned by planFunction and remove the dead code
+static bool applyPlan(FunctionPlan &plan, CallGraph* cg, Function* assumeFn) {
+  LLVMContext &ctx = plan.F->getContext();
+  bool change = false;
+  CodeExpander g;
+  IRBuilder<> Builder(ctx);
+  for (auto &ins: plan.Insertions) {
+    Builder.SetInsertPoint(ins.InsertPt);
+    if (ins.Shared) {
+      lin_cst_unordered_set emitted;
+      if (g.gen_shared_code(ins.Csts, Builder, ctx, assumeFn, cg, nullptr,
+			    plan.F, emitted, "crab_")) {
+	NumInstrBlocks++;
+	change = true;
+      }
+    } else {
+      if (ins.AfterLoad) {
+	NumInstrLoads++;
+      } else {
+	NumInstrBlocks++;
+      }
+      change |= g.gen_code(ins.Csts, Builder, ctx, assumeFn, cg, nullptr,
+			   plan.F, "crab_");
+    }
+  }
+  NumDedupCsts += plan.NumDedup;
+  
+  while (!plan.InfeasibleEdges.empty()) {
+    std::pair<BasicBlock*,BasicBlock*> E = plan.InfeasibleEdges.back();
+    plan.InfeasibleEdges.pop_back();
+    removeInfeasibleEdge(E.first, E.second);
+  }
+  
+  while (!plan.UnreachableBlocks.empty()) {
+    BasicBlock* B = plan.UnreachableBlocks.back();
+    plan.UnreachableBlocks.pop_back();
+    removeUnreachableBlock(B, ctx); 
+  }
+  return change;
+}
+
+//! Return the Crab domain of an invariant
+static CrabDomain getCrabDomain(const GenericAbsDomWrapper &inv) {
+  switch (inv.getId()) {
+  case GenericAbsDomWrapper::intv:          return INTERVALS;
+  case GenericAbsDomWrapper::split_dbm:     return ZONES_SPLIT_DBM;
+  case GenericAbsDomWrapper::term_intv:     return TERMS_INTERVALS;
+  case GenericAbsDomWrapper::term_dis_intv: return TERMS_DIS_INTERVALS;
+  case GenericAbsDomWrapper::ric:           return INTERVALS_CONGRUENCES;
+  case GenericAbsDomWrapper::boxes:         return BOXES;
+  case GenericAbsDomWrapper::dis_intv:      return DIS_INTERVALS;
+  case GenericAbsDomWrapper::oct:           return OCT;
+  case GenericAbsDomWrapper::pk:            return PK;
+  case GenericAbsDomWrapper::num:           return TERMS_ZONES;
+  case GenericAbsDomWrapper::w_intv:        return WRAPPED_INTERVALS;
+  case GenericAbsDomWrapper::dense_intv:    return DENSE_INTERVALS;
+  }
+  llvm_unreachable("unexpected abstract domain");
+}
+
+//! Same as runOnFunction for all the functions of M but the
+//  constraints are extracted and the instrumentation is planned by
+//  num_threads threads.
+bool InsertInvariants::runOnModuleParallel(Module &M, unsigned num_threads) {
+  ClamPass* crab = &getAnalysis<ClamPass>();
+  CallGraphWrapperPass *cgwp = getAnalysisIfAvailable<CallGraphWrapperPass>();
+  CallGraph* cg = cgwp ? &cgwp->getCallGraph() : nullptr;
+  bool only_loads = (InvLoc == PER_LOAD);
+  
+  // -- collect the invariants and the dead code of each function
+  std::vector<std::unique_ptr<FunctionPlan>> plans;
+  for (auto &F : M) {
+    if (F.isDeclaration() || F.empty() || F.isVarArg() || !crab->has_cfg(F)) {
+      continue;
+    }
+    std::unique_ptr<FunctionPlan> plan(new FunctionPlan(&F));
+    auto cfg_builder_ptr = crab->get_cfg_builder_man().get_cfg_builder(F);
+    cfg_ref_t cfg = crab->get_cfg(F);
+    FunctionPlan *p = plan.get();
+    crab->get_pre_all(F, [p](const BasicBlock &B, GenericAbsDomWrapperPtr inv) {
+			if (inv) p->PreInvs[&B] = inv;
+		      }, only_loads /*keep shadows*/);
+    DenseMap<const BasicBlock*, GenericAbsDomWrapperPtr> Live;
+    for (auto &B : F) {
+      if (isa<UnreachableInst>(B.getTerminator())) continue;
+      auto pre = plan->PreInvs.lookup(&B);
+      if (pre) {
+	if (isExclusiveDomain(getCrabDomain(*pre))) {
+	  plan->Exclusive = true;
+	}
+	if (pre->is_bottom()) {
+	  plan->UnreachableBlocks.push_back(&B);
+	  continue;
+	}
+	for (BasicBlock *Succ : B.getTerminator()->successors()) {
+	  if (!crab->has_feasible_edge(&B, Succ)) {
+	    plan->InfeasibleEdges.push_back({&B, Succ});
+	  }
+	}
+	if (InvLoc == DEAD_CODE) continue;
+	Live[&B] = pre;
+      }
+      if ((InvLoc == PER_LOAD || InvLoc == ALL) && reads_memory(B)) {
+	if (!only_loads) {
+	  pre = crab->get_pre(&B, true /*keep shadows*/);
+	}
+	if (!pre) continue;
+	plan->LoadInvs.push_back({&B, pre});
+	basic_block_label_t bb_label = cfg_builder_ptr->get_crab_basic_block(&B);
+	plan->CrabBlocks[&B] = &cfg.get_node(bb_label);
+      }
+    }
+    // -- the blocks removed are not instrumented
+    plan->PreInvs = std::move(Live);
+    plans.push_back(std::move(plan));
+  }
+  
+  // -- plan the instrumentation in parallel. The functions with
+  //    exclusive domains are planned by this thread, one at a time.
+  if (InvLoc != DEAD_CODE) {
+    variable_factory_t &vfac = crab->get_cfg_builder_man().get_var_factory();
+    bool thread_safe = vfac.is_thread_safe();
+    // -- the transformers of the loads can create variables
+    vfac.set_thread_safe(true);
+    std::atomic<unsigned> next(0);
+    auto worker = [&plans, &next]() {
+      for (unsigned i = next++; i < plans.size(); i = next++) {
+	if (!plans[i]->Exclusive) {
+	  planFunction(*plans[i]);
+	}
+      }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads - 1);
+    for (unsigned t = 1; t < num_threads; ++t) {
+      workers.emplace_back(worker);
+    }
+    for (auto &plan: plans) {
+      if (plan->Exclusive) {
+	planFunction(*plan);
+      }
+    }
+    worker();
+    for (auto &t: workers) {
+      t.join();
+    }
+    vfac.set_thread_safe(thread_safe);
+  }
+  
+  // -- change the IR in the order of the functions
+  bool change = false;
+  for (auto &plan: plans) {
+    change |= applyPlan(*plan, cg, m_assumeFn);
+  }
+  return change;
+}
+
 bool InsertInvariants::runOnModule(Module &M) {
   if (InvLoc == NONE) return false;
 
@@ -406,6 +791,11 @@ bool InsertInvariants::runOnModule(Module &M) {
   if (CallGraph *cg = cgwp ? &cgwp->getCallGraph() : nullptr)
     cg->getOrInsertFunction(m_assumeFn);
 
+  unsigned num_threads = std::max((unsigned) InsertThreads, 1U);
+  if (num_threads > 1) {
+    return runOnModuleParallel(M, num_threads);
+  }
+  
   bool change=false;
   for (auto &f : M) {
     change |= runOnFunction(f); 
@@ -437,21 +827,24 @@ bool InsertInvariants::runOnFunction(Function &F) {
   LLVMContext& ctx = F.getContext();
   std::vector<BasicBlock*> UnreachableBlocks;
   std::vector<std::pair<BasicBlock*, BasicBlock*>> InfeasibleEdges;
+  // constraints at the entry of each block if DedupInvariants
+  DenseMap<const BasicBlock*, lin_cst_sys_t> BlockCsts;
+  auto cfg_builder_ptr = crab->get_cfg_builder_man().get_cfg_builder(F);
+  // if only loads are instrumented the invariants with shadows are
+  // also used for dead code elimination.
+  bool only_loads = (InvLoc == PER_LOAD);
+  DenseMap<const BasicBlock*, GenericAbsDomWrapperPtr> PreInvs;
+  crab->get_pre_all(F, [&PreInvs](const BasicBlock &B, GenericAbsDomWrapperPtr inv) {
+		      if (inv) PreInvs[&B] = inv;
+		    }, only_loads /*keep shadows*/);
   for (auto &B : F) {
 
     // -- if the block has an unreachable instruction we skip it.
-    bool alread_dead_block = false;
-    for (auto &I: B) {
-      if (isa<UnreachableInst>(I)) {
-	alread_dead_block=true;
-	break;
-      }
-    }
-    if (alread_dead_block) continue;
-
-    auto cfg_builder_ptr = crab->get_cfg_builder_man().get_cfg_builder(F);
+    //    An unreachable instruction is always a terminator.
+    if (isa<UnreachableInst>(B.getTerminator())) continue;
 
-    if (auto pre = crab->get_pre(&B, false /*keep shadows*/)) {
+    auto pre = PreInvs.lookup(&B);
+    if (pre) {
       ///////
       /// First, we do dead code elimination.
       ///////
@@ -477,13 +870,14 @@ bool InsertInvariants::runOnFunction(Function &F) {
       //////
       
       // --- Instrument basic block with invariants
-      if (InvLoc == PER_BLOCK || InvLoc == ALL) {
+      if (InvLoc == PER_BLOCK || InvLoc == ALL ||
+	  (InvLoc == PER_LOOP &&
+	   getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo().isLoopHeader(&B))) {
 	auto csts = pre->to_linear_constraints();
-	change |= instrument_block(csts, &B, F.getContext(), cg, DT, m_assumeFn);
-      } else if (InvLoc == PER_LOOP) {
-	LoopInfo& LI = getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
-	if (LI.isLoopHeader(&B)) {
-	  auto csts = pre->to_linear_constraints();
+	if (DedupInvariants) {
+	  // the blocks are instrumented later following the dominator tree
+	  BlockCsts[&B] = csts;
+	} else {
 	  change |= instrument_block(csts, &B, F.getContext(), cg, DT, m_assumeFn);
 	}
       }
@@ -493,76 +887,29 @@ bool InsertInvariants::runOnFunction(Function &F) {
       
       // --- Instrument Load instructions
       if (reads_memory(B)) {
-	auto pre = crab->get_pre(&B, true /*keep shadows*/);
+	if (!only_loads) {
+	  pre = crab->get_pre(&B, true /*keep shadows*/);
+	}
 	if (!pre) continue;
 
 	basic_block_label_t bb_label = cfg_builder_ptr->get_crab_basic_block(&B);
-	// --- dispatch the type of the wrappee
-	switch(pre->getId()) {
-        #ifdef HAVE_ALL_DOMAINS
-	case GenericAbsDomWrapper::intv:{
-	  interval_domain_t inv;
-	  getAbsDomWrappee(pre, inv);
-	  change |= instrument_loads(inv, cfg.get_node(bb_label), F.getContext(), cg, m_assumeFn);
-	  break;
-	}	  
-	case GenericAbsDomWrapper::ric: {
-	  ric_domain_t inv;
-	  getAbsDomWrappee(pre, inv);
-	  change |= instrument_loads(inv, cfg.get_node(bb_label), F.getContext(), cg, m_assumeFn);
-	  break;
-	}
-	case GenericAbsDomWrapper::term_intv: {
-	  term_int_domain_t inv;
-	  getAbsDomWrappee(pre, inv);
-	  change |= instrument_loads(inv, cfg.get_node(bb_label), F.getContext(), cg, m_assumeFn);
-	  break;
-	}
-	case GenericAbsDomWrapper::term_dis_intv: {
-	  term_dis_int_domain_t inv;
-	  getAbsDomWrappee(pre, inv);
-	  change |= instrument_loads(inv, cfg.get_node(bb_label), F.getContext(), cg, m_assumeFn);
-	  break;
-	}
-	  
-	case GenericAbsDomWrapper::oct: {
-	  oct_domain_t inv;
-	  getAbsDomWrappee(pre, inv);
-	  change |= instrument_loads(inv, cfg.get_node(bb_label), F.getContext(), cg, m_assumeFn);
-	  break;
-	}
-	case GenericAbsDomWrapper::num: {
-	  num_domain_t inv;
-	  getAbsDomWrappee(pre, inv);
-	  change |= instrument_loads(inv, cfg.get_node(bb_label), F.getContext(), cg, m_assumeFn);
-	  break;
-	}
-	case GenericAbsDomWrapper::boxes: {
-	  boxes_domain_t inv;
-	  getAbsDomWrappee(pre, inv);
-	  change |= instrument_loads(inv, cfg.get_node(bb_label), F.getContext(), cg, m_assumeFn);
-	  break;
-	}
-	case GenericAbsDomWrapper::pk: {
-	  pk_domain_t inv;
-	  getAbsDomWrappee(pre, inv);
-	  change |= instrument_loads(inv, cfg.get_node(bb_label), F.getContext(), cg, m_assumeFn);
-	  break;
-	}
-        #endif 	    
-	case GenericAbsDomWrapper::split_dbm: {
-	  split_dbm_domain_t inv;
-	  getAbsDomWrappee(pre, inv);
-	  change |= instrument_loads(inv, cfg.get_node(bb_label), F.getContext(), cg, m_assumeFn);
-	  break;
-	}
-	default :
-	  report_fatal_error("abstract domain not supported by --crab-add-invariants");
-	}
+	change |= instrument_loads(pre, cfg.get_node(bb_label), F.getContext(), cg, m_assumeFn);
       }
     }
   }
 
+  if (!BlockCsts.empty()) {
+    // A dominator is always visited before the blocks it dominates.
+    DenseMap<const BasicBlock*, lin_cst_unordered_set> Inserted;
+    for (DomTreeNode *N: depth_first(DT->getRootNode())) {
+      auto it = BlockCsts.find(N->getBlock());
+      if (it != BlockCsts.end()) {
+	change |= instrument_block_dedup(it->second, N->getBlock(), ctx, cg, DT,
+					 m_assumeFn, Inserted);
+      }
+    }
+  }
+  
   while (!InfeasibleEdges.empty()) {
     std::pair<BasicBlock*,BasicBlock*> E = InfeasibleEdges.back();
     InfeasibleEdges.pop_back();
@@ -0,0 +1,321 @@
+#pragma once
+
+/*
+ * instrumented_domain<Dom> behaves as Dom (any domain of
+ * crab_domains.hh) but it counts and times its joins, meets,
+ * widenings, narrowings, inclusion tests, closures (normalize),
+ * additions of constraints, forgets, projections and conversions to
+ * linear constraints. After each join and widening it also records
+ * the size of the result: its variables, its constraints and its
+ * constraints over two variables (the edges between variables of a
+ * DBM).
+ *
+ * The operations not listed above are inherited from Dom. The
+ * counters of a thread are kept in thread-local storage and they
+ * are added to ClamStats by flush() so that they are attributed to
+ * the function being analyzed and written by --crab-stats-json:
+ *
+ *   Domain.<op>                     number of calls
+ *   Domain.<op>.time                seconds
+ *   Domain.<op>.latency.lt_<T>      calls that took less than T
+ *   Domain.size.<what>.le_<N>       states of at most N <what>
+ *
+ * The sizes are computed from the linear constraints of the states
+ * so the instrumented analysis is slower than the analysis with Dom
+ * even though the timers of the operations do not include them.
+ */
+
+#include "clam/AbstractDomain.hh"
+#include "clam/Support/Stats.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <utility>
+
+namespace clam {
+
+namespace instrumented_domain_impl {
+
+  enum op_t { JOIN, MEET, WIDENING, NARROWING, LEQ, NORMALIZE,
+	      ADD_CONSTRAINTS, FORGET, PROJECT, TO_CONSTRAINTS, NUM_OPS };
+
+  enum size_kind_t { VARS, CONSTRAINTS, EDGES, NUM_SIZES };
+
+  // upper bounds of the latency buckets: 1us, 10us, ..., 10ms and more
+  static const unsigned NUM_LATENCIES = 6;
+  // upper bounds of the size buckets: 1, 2, 4, ..., 4096 and more
+  static const unsigned NUM_SIZE_BUCKETS = 14;
+
+  inline const char *op_name(unsigned op) {
+    static const char *names[NUM_OPS] =
+      { "join", "meet", "widening", "narrowing", "leq", "normalize",
+	"add_constraints", "forget", "project", "to_constraints" };
+    return names[op];
+  }
+
+  inline const char *size_name(unsigned s) {
+    static const char *names[NUM_SIZES] = { "vars", "constraints", "edges" };
+    return names[s];
+  }
+
+  struct stats_t {
+    uint64_t count[NUM_OPS];
+    double time[NUM_OPS];
+    uint64_t latency[NUM_OPS][NUM_LATENCIES];
+    uint64_t size[NUM_SIZES][NUM_SIZE_BUCKETS];
+
+    stats_t() { reset(); }
+
+    void reset() {
+      for (unsigned op = 0; op < NUM_OPS; ++op) {
+	count[op] = 0;
+	time[op] = 0;
+	for (unsigned b = 0; b < NUM_LATENCIES; ++b) {
+	  latency[op][b] = 0;
+	}
+      }
+      for (unsigned s = 0; s < NUM_SIZES; ++s) {
+	for (unsigned b = 0; b < NUM_SIZE_BUCKETS; ++b) {
+	  size[s][b] = 0;
+	}
+      }
+    }
+
+    void add_op(op_t op, double secs) {
+      count[op]++;
+      time[op] += secs;
+      unsigned b = 0;
+      for (double bound = 1e-6; b + 1 < NUM_LATENCIES && secs >= bound; bound *= 10) {
+	++b;
+      }
+      latency[op][b]++;
+    }
+
+    void add_size(size_kind_t s, uint64_t n) {
+      unsigned b = 0;
+      while (b + 1 < NUM_SIZE_BUCKETS && n > (uint64_t(1) << b)) {
+	++b;
+      }
+      size[s][b]++;
+    }
+
+    // Add the counters to ClamStats and reset them
+    void flush() {
+      static const char *latencies[NUM_LATENCIES] =
+	{ "lt_1us", "lt_10us", "lt_100us", "lt_1ms", "lt_10ms", "ge_10ms" };
+      for (unsigned op = 0; op < NUM_OPS; ++op) {
+	if (count[op] == 0) {
+	  continue;
+	}
+	std::string name = std::string("Domain.") + op_name(op);
+	ClamStats::count(name, count[op]);
+	ClamStats::add_time(name + ".time", time[op]);
+	for (unsigned b = 0; b < NUM_LATENCIES; ++b) {
+	  if (latency[op][b] > 0) {
+	    ClamStats::count(name + ".latency." + latencies[b], latency[op][b]);
+	  }
+	}
+      }
+      for (unsigned s = 0; s < NUM_SIZES; ++s) {
+	for (unsigned b = 0; b < NUM_SIZE_BUCKETS; ++b) {
+	  if (size[s][b] == 0) {
+	    continue;
+	  }
+	  std::string bucket = b + 1 < NUM_SIZE_BUCKETS ?
+	    "le_" + std::to_string(uint64_t(1) << b) :
+	    "gt_" + std::to_string(uint64_t(1) << (b - 1));
+	  ClamStats::count(std::string("Domain.size.") + size_name(s) + "." + bucket,
+			   size[s][b]);
+	}
+      }
+      reset();
+    }
+  };
+
+  inline stats_t &get_stats() {
+    static thread_local stats_t stats;
+    return stats;
+  }
+
+  class scoped_op {
+    op_t m_op;
+    std::chrono::steady_clock::time_point m_start;
+  public:
+    scoped_op(op_t op): m_op(op), m_start(std::chrono::steady_clock::now()) {}
+    ~scoped_op() {
+      get_stats().add_op(m_op, std::chrono::duration<double>
+			 (std::chrono::steady_clock::now() - m_start).count());
+    }
+  };
+
+} // end namespace instrumented_domain_impl
+
+template<typename Dom>
+class instrumented_domain: public Dom {
+  typedef instrumented_domain<Dom> this_type;
+  typedef instrumented_domain_impl::scoped_op scoped_op;
+
+  void record_size() {
+    using namespace instrumented_domain_impl;
+    if (Dom::is_bottom()) {
+      return;
+    }
+    auto csts = Dom::to_linear_constraint_system();
+    std::set<var_t> vars;
+    uint64_t num_csts = 0, num_edges = 0;
+    for (auto const &cst: csts) {
+      unsigned n = 0;
+      for (auto const &v: cst.variables()) {
+	vars.insert(v);
+	++n;
+      }
+      ++num_csts;
+      num_edges += (n == 2);
+    }
+    stats_t &stats = get_stats();
+    stats.add_size(VARS, vars.size());
+    stats.add_size(CONSTRAINTS, num_csts);
+    stats.add_size(EDGES, num_edges);
+  }
+
+public:
+  instrumented_domain(): Dom() {}
+
+  // implicit so that the operations inherited from Dom that return
+  // a Dom can be used as this type
+  instrumented_domain(const Dom &dom): Dom(dom) {}
+
+  static this_type top() { return this_type(Dom::top()); }
+
+  static this_type bottom() { return this_type(Dom::bottom()); }
+
+  const Dom &base() const { return *this; }
+
+  bool operator<=(const this_type &o) {
+    scoped_op op(instrumented_domain_impl::LEQ);
+    return Dom::operator<=(o);
+  }
+
+  void operator|=(const this_type &o) {
+    {
+      scoped_op op(instrumented_domain_impl::JOIN);
+      Dom::operator|=(o);
+    }
+    record_size();
+  }
+
+  this_type operator|(const this_type &o) {
+    this_type res;
+    {
+      scoped_op op(instrumented_domain_impl::JOIN);
+      res = Dom::operator|(o);
+    }
+    res.record_size();
+    return res;
+  }
+
+  this_type operator&(const this_type &o) {
+    scoped_op op(instrumented_domain_impl::MEET);
+    return Dom::operator&(o);
+  }
+
+  this_type operator||(const this_type &o) {
+    this_type res;
+    {
+      scoped_op op(instrumented_domain_impl::WIDENING);
+      res = Dom::operator||(o);
+    }
+    res.record_size();
+    return res;
+  }
+
+  template<typename Thresholds>
+  this_type widening_thresholds(const this_type &o, const Thresholds &ts) {
+    this_type res;
+    {
+      scoped_op op(instrumented_domain_impl::WIDENING);
+      res = Dom::widening_thresholds(o, ts);
+    }
+    res.record_size();
+    return res;
+  }
+
+  this_type operator&&(const this_type &o) {
+    scoped_op op(instrumented_domain_impl::NARROWING);
+    return Dom::operator&&(o);
+  }
+
+  void normalize() {
+    scoped_op op(instrumented_domain_impl::NORMALIZE);
+    Dom::normalize();
+  }
+
+  // a linear constraint or a linear constraint system
+  template<typename Constraints>
+  void operator+=(const Constraints &csts) {
+    scoped_op op(instrumented_domain_impl::ADD_CONSTRAINTS);
+    Dom::operator+=(csts);
+  }
+
+  template<typename Vars>
+  void forget(const Vars &vars) {
+    scoped_op op(instrumented_domain_impl::FORGET);
+    Dom::forget(vars);
+  }
+
+  template<typename Vars>
+  void project(const Vars &vars) {
+    scoped_op op(instrumented_domain_impl::PROJECT);
+    Dom::project(vars);
+  }
+
+  auto to_linear_constraint_system()
+    -> decltype(std::declval<Dom&>().to_linear_constraint_system()) {
+    scoped_op op(instrumented_domain_impl::TO_CONSTRAINTS);
+    return Dom::to_linear_constraint_system();
+  }
+};
+
+// The invariants are wrapped and unwrapped as invariants of Dom
+template<typename Dom>
+inline GenericAbsDomWrapperPtr mkGenericAbsDomWrapper(instrumented_domain<Dom> abs_dom) {
+  return mkGenericAbsDomWrapper<Dom>(abs_dom.base());
+}
+
+template<typename Dom>
+inline void getAbsDomWrappee(GenericAbsDomWrapperPtr wrapper,
+			     instrumented_domain<Dom> &abs_dom) {
+  Dom base;
+  getAbsDomWrappee(wrapper, base);
+  abs_dom = base;
+}
+
+} // end namespace clam
+
+namespace crab {
+namespace domains {
+
+  // The checks are done as with Dom
+  template<typename Dom>
+  class checker_domain_traits<clam::instrumented_domain<Dom>> {
+  public:
+    template<typename Cst>
+    static bool entail(clam::instrumented_domain<Dom> &inv, const Cst &cst) {
+      return checker_domain_traits<Dom>::entail(inv, cst);
+    }
+
+    template<typename Cst>
+    static bool entail(const Cst &cst, clam::instrumented_domain<Dom> &inv) {
+      return checker_domain_traits<Dom>::entail(cst, inv);
+    }
+
+    template<typename Cst>
+    static bool intersect(clam::instrumented_domain<Dom> &inv, const Cst &cst) {
+      return checker_domain_traits<Dom>::intersect(inv, cst);
+    }
+  };
+
+} // end namespace domains
+} // end namespace crab
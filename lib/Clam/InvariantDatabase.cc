@@ -0,0 +1,511 @@
+#include "clam/InvariantDatabase.hh"
+#include "InvariantDatabaseWriter.hh"
+#include "CfgBuilderUtils.hh"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "clam/Support/Debug.hh"
+
+namespace clam {
+
+using namespace llvm;
+
+static const char MAGIC[] = "CLAMINVD";
+static const uint32_t HEADER_SIZE = 48;
+static const uint32_t FUNCTION_SIZE = 24;
+static const uint32_t BLOCK_SIZE = 16;
+
+uint32_t InvariantDatabase::hash(StringRef function, StringRef block) {
+  uint32_t h = 2166136261u;
+  auto add = [&h](char c) {
+    h ^= (unsigned char)c;
+    h *= 16777619u;
+  };
+  for (char c : function) {
+    add(c);
+  }
+  add('\0');
+  for (char c : block) {
+    add(c);
+  }
+  return h;
+}
+
+/** Reader **/
+
+InvariantDatabase::InvariantDatabase(std::unique_ptr<MemoryBuffer> buf)
+    : m_buf(std::move(buf)), m_data(m_buf->getBufferStart()) {
+  m_num_strings = u32(12);
+  m_strings = u32(16);
+  m_num_functions = u32(20);
+  m_functions = u32(24);
+  m_num_blocks = u32(28);
+  m_blocks = u32(32);
+  m_num_slots = u32(36);
+  m_slots = u32(40);
+}
+
+uint32_t InvariantDatabase::u32(uint32_t offset) const {
+  return support::endian::read32le(m_data + offset);
+}
+
+int64_t InvariantDatabase::i64(uint32_t offset) const {
+  return (int64_t)support::endian::read64le(m_data + offset);
+}
+
+std::unique_ptr<InvariantDatabase>
+InvariantDatabase::open(StringRef filename, std::string &err) {
+  // large files are memory-mapped by MemoryBuffer
+  auto buf = MemoryBuffer::getFile(filename, -1,
+                                   /*RequiresNullTerminator=*/false);
+  if (!buf) {
+    err = buf.getError().message();
+    return nullptr;
+  }
+  StringRef data = (*buf)->getBuffer();
+  if (data.size() < HEADER_SIZE || !data.startswith(StringRef(MAGIC, 8))) {
+    err = "not an invariant database";
+    return nullptr;
+  }
+  std::unique_ptr<InvariantDatabase> db(new InvariantDatabase(std::move(*buf)));
+  if (db->u32(8) != VERSION) {
+    err = "unsupported invariant database version";
+    return nullptr;
+  }
+  // -- the tables must be within the file. Systems are not checked.
+  auto fits = [&data](uint64_t offset, uint64_t n, uint64_t size) {
+    return offset + n * size <= data.size();
+  };
+  if (!fits(db->m_strings, db->m_num_strings, 4) ||
+      !fits(db->m_functions, db->m_num_functions, FUNCTION_SIZE) ||
+      !fits(db->m_blocks, db->m_num_blocks, BLOCK_SIZE) ||
+      !fits(db->m_slots, db->m_num_slots, 4) ||
+      (db->m_num_slots & (db->m_num_slots - 1)) != 0) {
+    err = "corrupted invariant database";
+    return nullptr;
+  }
+  return db;
+}
+
+uint32_t InvariantDatabase::lookup(StringRef function, StringRef block) const {
+  if (m_num_slots == 0) {
+    return NONE;
+  }
+  uint32_t mask = m_num_slots - 1;
+  for (uint32_t i = hash(function, block) & mask;; i = (i + 1) & mask) {
+    uint32_t b = u32(m_slots + 4 * i);
+    if (b == 0) {
+      return NONE;
+    }
+    --b;
+    if (get_block_name(b) == block &&
+        get_function_name(get_block_function(b)) == function) {
+      return b;
+    }
+  }
+}
+
+StringRef InvariantDatabase::get_string(uint32_t idx) const {
+  return StringRef(m_data + u32(m_strings + 4 * idx));
+}
+
+StringRef InvariantDatabase::get_function_name(uint32_t f) const {
+  return get_string(u32(m_functions + FUNCTION_SIZE * f));
+}
+
+uint32_t InvariantDatabase::get_first_block(uint32_t f) const {
+  return u32(m_functions + FUNCTION_SIZE * f + 4);
+}
+
+uint32_t InvariantDatabase::get_num_blocks(uint32_t f) const {
+  return u32(m_functions + FUNCTION_SIZE * f + 8);
+}
+
+uint32_t InvariantDatabase::get_safe_checks(uint32_t f) const {
+  return u32(m_functions + FUNCTION_SIZE * f + 12);
+}
+
+uint32_t InvariantDatabase::get_error_checks(uint32_t f) const {
+  return u32(m_functions + FUNCTION_SIZE * f + 16);
+}
+
+uint32_t InvariantDatabase::get_warning_checks(uint32_t f) const {
+  return u32(m_functions + FUNCTION_SIZE * f + 20);
+}
+
+uint32_t InvariantDatabase::get_block_function(uint32_t b) const {
+  return u32(m_blocks + BLOCK_SIZE * b);
+}
+
+StringRef InvariantDatabase::get_block_name(uint32_t b) const {
+  return get_string(u32(m_blocks + BLOCK_SIZE * b + 4));
+}
+
+uint32_t InvariantDatabase::get_pre(uint32_t b) const {
+  return u32(m_blocks + BLOCK_SIZE * b + 8);
+}
+
+uint32_t InvariantDatabase::get_post(uint32_t b) const {
+  return u32(m_blocks + BLOCK_SIZE * b + 12);
+}
+
+bool InvariantDatabase::is_bottom(uint32_t sys) const {
+  return (u32(sys) & BOTTOM) != 0;
+}
+
+uint32_t InvariantDatabase::get_num_constraints(uint32_t sys) const {
+  return u32(sys + 4);
+}
+
+uint32_t InvariantDatabase::get_next_constraint(uint32_t cst) const {
+  return cst + 24 + 16 * get_num_terms(cst);
+}
+
+InvariantDatabase::constraint_kind_t
+InvariantDatabase::get_kind(uint32_t cst) const {
+  return (constraint_kind_t)u32(cst);
+}
+
+uint32_t InvariantDatabase::get_num_terms(uint32_t cst) const {
+  return u32(cst + 4);
+}
+
+bool InvariantDatabase::is_signed(uint32_t cst) const {
+  return u32(cst + 8) != 0;
+}
+
+int64_t InvariantDatabase::get_constant(uint32_t cst) const {
+  return i64(cst + 16);
+}
+
+int64_t InvariantDatabase::get_coefficient(uint32_t cst, uint32_t i) const {
+  return i64(cst + 24 + 16 * i);
+}
+
+StringRef InvariantDatabase::get_variable(uint32_t cst, uint32_t i) const {
+  return get_string(u32(cst + 24 + 16 * i + 8));
+}
+
+/** Writer **/
+
+namespace {
+class Writer {
+  std::string &m_buf;
+
+public:
+  Writer(std::string &buf) : m_buf(buf) {}
+
+  void u32(uint32_t v) {
+    for (unsigned i = 0; i < 4; ++i) {
+      m_buf.push_back((char)((v >> (8 * i)) & 0xff));
+    }
+  }
+
+  void i64(int64_t v) {
+    uint64_t u = (uint64_t)v;
+    for (unsigned i = 0; i < 8; ++i) {
+      m_buf.push_back((char)((u >> (8 * i)) & 0xff));
+    }
+  }
+
+  void align() {
+    while (m_buf.size() % 8 != 0) {
+      m_buf.push_back('\0');
+    }
+  }
+};
+} // end namespace
+
+uint32_t InvariantDatabaseWriter::get_string_id(StringRef s) {
+  auto it = m_string_ids.find(s);
+  if (it != m_string_ids.end()) {
+    return it->second;
+  }
+  uint32_t id = m_strings.size();
+  m_strings.push_back(s);
+  m_string_ids[s] = id;
+  return id;
+}
+
+void InvariantDatabaseWriter::add_function(StringRef name, unsigned safe,
+                                           unsigned error, unsigned warning) {
+  function_t f;
+  f.name = get_string_id(name);
+  f.first_block = m_blocks.size();
+  f.num_blocks = 0;
+  f.safe = safe;
+  f.error = error;
+  f.warning = warning;
+  m_functions.push_back(f);
+}
+
+uint32_t InvariantDatabaseWriter::add_system(GenericAbsDomWrapperPtr inv) {
+  if (!inv) {
+    return InvariantDatabase::NONE;
+  }
+  uint32_t offset = m_systems.size();
+  Writer w(m_systems);
+  if (inv->is_bottom()) {
+    w.u32(InvariantDatabase::BOTTOM);
+    w.u32(0);
+    return offset;
+  }
+  std::string csts_buf;
+  Writer cw(csts_buf);
+  uint32_t num_csts = 0;
+  for (auto const &cst : inv->to_linear_constraints()) {
+    uint32_t kind;
+    if (cst.is_equality()) {
+      kind = InvariantDatabase::EQ;
+    } else if (cst.is_disequation()) {
+      kind = InvariantDatabase::NE;
+    } else if (cst.is_strict_inequality()) {
+      kind = InvariantDatabase::LT;
+    } else if (cst.is_inequality()) {
+      kind = InvariantDatabase::LE;
+    } else {
+      continue;
+    }
+    int64_t k;
+    if (!toInt64(cst.expression().constant(), k)) {
+      continue;
+    }
+    std::vector<std::pair<int64_t, uint32_t>> terms;
+    bool ok = true;
+    for (auto t : cst.expression()) {
+      int64_t coef;
+      if (!toInt64(t.first, coef)) {
+        ok = false;
+        break;
+      }
+      std::string name;
+      if (!m_var_namer) {
+        name = t.second.name().str();
+      } else if (!m_var_namer(t.second, name)) {
+        ok = false;
+        break;
+      }
+      terms.push_back({coef, get_string_id(name)});
+    }
+    if (!ok) {
+      continue;
+    }
+    cw.u32(kind);
+    cw.u32(terms.size());
+    cw.u32(cst.is_signed());
+    cw.u32(0);
+    cw.i64(k);
+    for (auto &t : terms) {
+      cw.i64(t.first);
+      cw.u32(t.second);
+      cw.u32(0);
+    }
+    ++num_csts;
+  }
+  w.u32(0);
+  w.u32(num_csts);
+  m_systems += csts_buf;
+  return offset;
+}
+
+void InvariantDatabaseWriter::add_block(StringRef name, GenericAbsDomWrapperPtr pre,
+                                        GenericAbsDomWrapperPtr post) {
+  assert(!m_functions.empty());
+  block_t b;
+  b.function = m_functions.size() - 1;
+  b.name = get_string_id(name);
+  b.pre = add_system(pre);
+  b.post = add_system(post);
+  m_blocks.push_back(b);
+  m_functions.back().num_blocks++;
+}
+
+uint32_t InvariantDatabaseWriter::copy_system(const InvariantDatabase &db,
+                                              uint32_t sys) {
+  if (sys == InvariantDatabase::NONE) {
+    return sys;
+  }
+  uint32_t offset = m_systems.size();
+  Writer w(m_systems);
+  if (db.is_bottom(sys)) {
+    w.u32(InvariantDatabase::BOTTOM);
+    w.u32(0);
+    return offset;
+  }
+  uint32_t num_csts = db.get_num_constraints(sys);
+  w.u32(0);
+  w.u32(num_csts);
+  uint32_t cst = db.get_first_constraint(sys);
+  for (uint32_t i = 0; i < num_csts; ++i, cst = db.get_next_constraint(cst)) {
+    uint32_t num_terms = db.get_num_terms(cst);
+    w.u32(db.get_kind(cst));
+    w.u32(num_terms);
+    w.u32(db.is_signed(cst));
+    w.u32(0);
+    w.i64(db.get_constant(cst));
+    // -- the variables are renumbered in the string table of this
+    //    database
+    for (uint32_t t = 0; t < num_terms; ++t) {
+      w.i64(db.get_coefficient(cst, t));
+      w.u32(get_string_id(db.get_variable(cst, t)));
+      w.u32(0);
+    }
+  }
+  return offset;
+}
+
+void InvariantDatabaseWriter::add_block(StringRef name,
+                                        const InvariantDatabase &db,
+                                        uint32_t pre, uint32_t post) {
+  assert(!m_functions.empty());
+  block_t b;
+  b.function = m_functions.size() - 1;
+  b.name = get_string_id(name);
+  b.pre = copy_system(db, pre);
+  b.post = copy_system(db, post);
+  m_blocks.push_back(b);
+  m_functions.back().num_blocks++;
+}
+
+bool InvariantDatabaseWriter::write(const std::string &file) const {
+  // -- layout
+  uint32_t strings = HEADER_SIZE;
+  uint32_t chars = strings + 4 * m_strings.size();
+  uint32_t chars_size = 0;
+  for (auto &s : m_strings) {
+    chars_size += s.size() + 1;
+  }
+  uint32_t functions = (chars + chars_size + 7) & ~7u;
+  uint32_t blocks = functions + FUNCTION_SIZE * m_functions.size();
+  uint32_t num_slots = 1;
+  while (num_slots < 2 * m_blocks.size()) {
+    num_slots <<= 1;
+  }
+  uint32_t slots = blocks + BLOCK_SIZE * m_blocks.size();
+  uint32_t systems = (slots + 4 * num_slots + 7) & ~7u;
+
+  std::string buf;
+  Writer w(buf);
+  buf.append(MAGIC, 8);
+  w.u32(InvariantDatabase::VERSION);
+  w.u32(m_strings.size());
+  w.u32(strings);
+  w.u32(m_functions.size());
+  w.u32(functions);
+  w.u32(m_blocks.size());
+  w.u32(blocks);
+  w.u32(num_slots);
+  w.u32(slots);
+  w.align();
+  // -- string table
+  uint32_t offset = chars;
+  for (auto &s : m_strings) {
+    w.u32(offset);
+    offset += s.size() + 1;
+  }
+  for (auto &s : m_strings) {
+    buf += s;
+    buf.push_back('\0');
+  }
+  w.align();
+  // -- functions
+  for (auto &f : m_functions) {
+    w.u32(f.name);
+    w.u32(f.first_block);
+    w.u32(f.num_blocks);
+    w.u32(f.safe);
+    w.u32(f.error);
+    w.u32(f.warning);
+  }
+  // -- blocks
+  auto relocate = [systems](uint32_t sys) {
+    return sys == InvariantDatabase::NONE ? sys : systems + sys;
+  };
+  for (auto &b : m_blocks) {
+    w.u32(b.function);
+    w.u32(b.name);
+    w.u32(relocate(b.pre));
+    w.u32(relocate(b.post));
+  }
+  // -- hash table
+  std::vector<uint32_t> table(num_slots, 0);
+  for (uint32_t i = 0, e = m_blocks.size(); i < e; ++i) {
+    const block_t &b = m_blocks[i];
+    uint32_t h = InvariantDatabase::hash(m_strings[m_functions[b.function].name],
+                                         m_strings[b.name]);
+    uint32_t j = h & (num_slots - 1);
+    while (table[j] != 0) {
+      j = (j + 1) & (num_slots - 1);
+    }
+    table[j] = i + 1;
+  }
+  for (uint32_t v : table) {
+    w.u32(v);
+  }
+  w.align();
+  assert(buf.size() == systems);
+  buf += m_systems;
+
+  // Write first into a temporary file and then rename it so that
+  // concurrent readers never see a partial database.
+  int fd;
+  SmallString<256> tmp_path;
+  if (std::error_code ec =
+          sys::fs::createUniqueFile(file + "-%%%%%%.tmp", fd, tmp_path)) {
+    CLAM_WARNING("cannot write invariant database " << file << ": "
+                                                    << ec.message());
+    return false;
+  }
+  {
+    raw_fd_ostream o(fd, /*shouldClose=*/true);
+    o << buf;
+  }
+  if (std::error_code ec = sys::fs::rename(tmp_path, file)) {
+    CLAM_WARNING("cannot write invariant database " << file << ": "
+                                                    << ec.message());
+    sys::fs::remove(tmp_path);
+    return false;
+  }
+  return true;
+}
+
+/** Merge **/
+
+bool mergeInvariantDatabases(const std::vector<std::string> &inputs,
+                             const std::string &output, std::string &err) {
+  InvariantDatabaseWriter res;
+  StringSet<> functions;
+  for (auto &input : inputs) {
+    std::unique_ptr<InvariantDatabase> db = InvariantDatabase::open(input, err);
+    if (!db) {
+      err = input + ": " + err;
+      return false;
+    }
+    for (uint32_t f = 0; f < db->num_functions(); ++f) {
+      StringRef name = db->get_function_name(f);
+      if (!functions.insert(name).second) {
+        CLAM_WARNING("function " << name << " of " << input
+                                 << " is already in another database");
+        continue;
+      }
+      res.add_function(name, db->get_safe_checks(f), db->get_error_checks(f),
+                       db->get_warning_checks(f));
+      uint32_t first = db->get_first_block(f);
+      for (uint32_t b = first; b < first + db->get_num_blocks(f); ++b) {
+        res.add_block(db->get_block_name(b), *db, db->get_pre(b),
+                      db->get_post(b));
+      }
+    }
+  }
+  if (!res.write(output)) {
+    err = "cannot write " + output;
+    return false;
+  }
+  return true;
+}
+
+} // end namespace clam
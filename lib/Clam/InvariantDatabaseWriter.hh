@@ -0,0 +1,73 @@
+#pragma once
+
+#include "clam/AbstractDomain.hh"
+#include "clam/InvariantDatabase.hh"
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace clam {
+
+/**
+ * Build an invariant database (see clam/InvariantDatabase.hh) in
+ * memory and write it at once.
+ **/
+class InvariantDatabaseWriter {
+public:
+  // Return false if the variable cannot be named
+  typedef std::function<bool(const var_t &, std::string &)> var_namer_t;
+
+  // Name of the variables in the database. By default, the name of
+  // the crab variable. Constraints over variables without a name are
+  // not stored.
+  void set_var_namer(var_namer_t namer) { m_var_namer = namer; }
+
+  // The next blocks belong to this function
+  void add_function(llvm::StringRef name, unsigned safe, unsigned error,
+                    unsigned warning);
+
+  // pre and post can be null if the invariants are not known
+  void add_block(llvm::StringRef name, GenericAbsDomWrapperPtr pre,
+                 GenericAbsDomWrapperPtr post);
+
+  // Copy a block of another database. pre and post are offsets of
+  // systems of db or NONE.
+  void add_block(llvm::StringRef name, const InvariantDatabase &db,
+                 uint32_t pre, uint32_t post);
+
+  // Errors are reported as warnings
+  bool write(const std::string &file) const;
+
+  unsigned num_blocks() const { return m_blocks.size(); }
+
+private:
+  struct function_t {
+    uint32_t name;
+    uint32_t first_block;
+    uint32_t num_blocks;
+    uint32_t safe, error, warning;
+  };
+  struct block_t {
+    uint32_t function;
+    uint32_t name;
+    // offsets in m_systems
+    uint32_t pre, post;
+  };
+
+  llvm::StringMap<uint32_t> m_string_ids;
+  std::vector<std::string> m_strings;
+  std::vector<function_t> m_functions;
+  std::vector<block_t> m_blocks;
+  std::string m_systems;
+  var_namer_t m_var_namer;
+
+  uint32_t get_string_id(llvm::StringRef s);
+  uint32_t add_system(GenericAbsDomWrapperPtr inv);
+  uint32_t copy_system(const InvariantDatabase &db, uint32_t sys);
+};
+
+} // end namespace clam
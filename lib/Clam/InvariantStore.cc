@@ -0,0 +1,229 @@
+#include "InvariantStore.hh"
+#include "InvariantDatabaseWriter.hh"
+#include "ValueNumbering.hh"
+
+#include "clam/InvariantDatabase.hh"
+#include "clam/Support/Debug.hh"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+/*
+ * The functions of a segment are named by their position in the
+ * store and their blocks by their position in the function. A
+ * variable is named <value>:<type>:<bitwidth> where <value> is a
+ * reference of ValueNumbering.
+ */
+
+namespace clam {
+
+using namespace llvm;
+
+// -- number of blocks of a segment before it is written
+static const unsigned SEGMENT_BLOCKS = 1 << 16;
+
+InvariantStore::InvariantStore(std::string dir, llvm_variable_factory &vfac)
+    : m_dir(dir), m_vfac(vfac) {}
+
+InvariantStore::~InvariantStore() {
+  m_segments.clear();
+  for (auto &file : m_files) {
+    sys::fs::remove(file);
+  }
+}
+
+static std::string getSegmentModel(const std::string &dir) {
+  SmallString<256> model(dir);
+  sys::path::append(model, "clam-invariants-%%%%%%.db");
+  return model.str();
+}
+
+bool InvariantStore::checkDirectory(const std::string &dir, std::string &err) {
+  if (std::error_code ec = sys::fs::create_directories(dir)) {
+    err = "cannot create " + dir + ": " + ec.message();
+    return false;
+  }
+  SmallString<256> path;
+  if (std::error_code ec =
+          sys::fs::createUniqueFile(getSegmentModel(dir), path)) {
+    err = "cannot write into " + dir + ": " + ec.message();
+    return false;
+  }
+  sys::fs::remove(path);
+  return true;
+}
+
+void InvariantStore::spill(const Function &F, abs_dom_map_t &pre,
+                           abs_dom_map_t &post) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_pending) {
+    m_pending.reset(new InvariantDatabaseWriter());
+  }
+  ValueNumbering vn(F);
+  m_pending->set_var_namer([&vn](const var_t &v, std::string &name) {
+    auto val = v.name().get();
+    std::string ref;
+    if (!val || !vn.getRef(*val, ref)) {
+      // shadow variable
+      return false;
+    }
+    name = ref + ":" + std::to_string((int)v.get_type()) + ":" +
+           std::to_string(v.get_bitwidth());
+    return true;
+  });
+
+  function_t f;
+  f.segment = m_segments.size();
+  f.key = std::to_string(m_functions.size());
+  m_pending->add_function(f.key, 0, 0, 0);
+  for (auto &B : F) {
+    auto pre_it = pre.find(&B);
+    auto post_it = post.find(&B);
+    wrapper_dom_ptr pre_inv = (pre_it != pre.end() ? pre_it->second : nullptr);
+    wrapper_dom_ptr post_inv =
+        (post_it != post.end() ? post_it->second : nullptr);
+    if (!pre_inv && !post_inv) {
+      continue;
+    }
+    if (!f.top) {
+      f.top = (pre_inv ? pre_inv : post_inv)->make(false, lin_cst_sys_t());
+    }
+    m_pending->add_block(std::to_string(vn.getBlockId(&B)), pre_inv, post_inv);
+    if (pre_it != pre.end()) {
+      pre.erase(pre_it);
+    }
+    if (post_it != post.end()) {
+      post.erase(post_it);
+    }
+  }
+  m_pending->set_var_namer(nullptr);
+  // -- and the owner of the invariants of F (its variable scope)
+  pre.erase_function(F);
+  post.erase_function(F);
+  m_functions[&F] = f;
+  if (m_pending->num_blocks() >= SEGMENT_BLOCKS) {
+    flush();
+  }
+}
+
+void InvariantStore::flush() const {
+  if (!m_pending) {
+    return;
+  }
+  std::unique_ptr<InvariantDatabase> db;
+  SmallString<256> path;
+  std::string err;
+  if (std::error_code ec =
+          sys::fs::createUniqueFile(getSegmentModel(m_dir), path)) {
+    CLAM_WARNING("cannot spill invariants into " << m_dir << ": "
+                                                 << ec.message());
+  } else {
+    m_files.push_back(path.str());
+    if (m_pending->write(path.str())) {
+      db = InvariantDatabase::open(path, err);
+      if (!db) {
+        CLAM_WARNING("cannot read spilled invariants " << path << ": " << err);
+      }
+    }
+  }
+  // -- a segment that cannot be written is lost: its invariants are
+  //    unknown
+  m_segments.push_back(std::move(db));
+  m_pending.reset();
+}
+
+bool InvariantStore::contains(const Function &F) const {
+  return m_functions.count(&F) > 0;
+}
+
+InvariantStore::wrapper_dom_ptr
+InvariantStore::get_pre(const BasicBlock &block) const {
+  return get(block, true);
+}
+
+InvariantStore::wrapper_dom_ptr
+InvariantStore::get_post(const BasicBlock &block) const {
+  return get(block, false);
+}
+
+InvariantStore::wrapper_dom_ptr InvariantStore::get(const BasicBlock &block,
+                                                    bool is_pre) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_functions.find(block.getParent());
+  if (it == m_functions.end()) {
+    return nullptr;
+  }
+  const function_t &f = it->second;
+  if (f.segment == m_segments.size()) {
+    flush();
+  }
+  const InvariantDatabase *db = m_segments[f.segment].get();
+  if (!db) {
+    return nullptr;
+  }
+  if (!m_last_vn || &m_last_vn->getFunction() != block.getParent()) {
+    m_last_vn.reset(new ValueNumbering(*block.getParent()));
+  }
+  const ValueNumbering &vn = *m_last_vn;
+  uint32_t b = db->lookup(f.key, std::to_string(vn.getBlockId(&block)));
+  if (b == InvariantDatabase::NONE) {
+    return nullptr;
+  }
+  uint32_t sys = (is_pre ? db->get_pre(b) : db->get_post(b));
+  if (sys == InvariantDatabase::NONE) {
+    return nullptr;
+  }
+  if (db->is_bottom(sys)) {
+    return f.top->make(true, lin_cst_sys_t());
+  }
+
+  lin_cst_sys_t csts;
+  uint32_t cst = db->get_first_constraint(sys);
+  for (uint32_t i = 0, e = db->get_num_constraints(sys); i < e;
+       ++i, cst = db->get_next_constraint(cst)) {
+    lin_exp_t exp(number_t(db->get_constant(cst)));
+    bool valid = true;
+    for (uint32_t j = 0, n = db->get_num_terms(cst); j < n; ++j) {
+      SmallVector<StringRef, 3> fields;
+      db->get_variable(cst, j).split(fields, ':');
+      const Value *v = nullptr;
+      int ty;
+      unsigned bitwidth;
+      if (fields.size() != 3 || !(v = vn.getValue(fields[0].str())) ||
+          fields[1].getAsInteger(10, ty) ||
+          fields[2].getAsInteger(10, bitwidth)) {
+        valid = false;
+        break;
+      }
+      var_t x(m_vfac[v], (crab::variable_type)ty, bitwidth);
+      exp = exp + number_t(db->get_coefficient(cst, j)) * x;
+    }
+    if (!valid) {
+      continue;
+    }
+    lin_cst_t c;
+    switch (db->get_kind(cst)) {
+    case InvariantDatabase::EQ:
+      c = lin_cst_t(exp == number_t(0));
+      break;
+    case InvariantDatabase::NE:
+      c = lin_cst_t(exp != number_t(0));
+      break;
+    case InvariantDatabase::LE:
+      c = lin_cst_t(exp <= number_t(0));
+      break;
+    case InvariantDatabase::LT:
+      c = lin_cst_t(exp < number_t(0));
+      break;
+    }
+    if (!db->is_signed(cst)) {
+      c.set_unsigned();
+    }
+    csts += c;
+  }
+  return f.top->make(false, csts);
+}
+
+} // end namespace clam
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "clam/AbstractDomain.hh"
+#include "clam/BlockMap.hh"
+#include "clam/crab/crab_cfg.hh"
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class BasicBlock;
+class Function;
+} // namespace llvm
+
+namespace clam {
+
+class InvariantDatabase;
+class InvariantDatabaseWriter;
+class ValueNumbering;
+
+/**
+ * Store of the invariants of the functions whose analysis is
+ * complete so they are not kept in memory (--crab-spill-invariants).
+ *
+ * The invariants of a function are added to a segment in the format
+ * of the invariant database (see clam/InvariantDatabase.hh). Once a
+ * segment has enough blocks it is written into the spill directory
+ * and memory-mapped. An invariant is rebuilt from the segment each
+ * time it is queried, so it can be weaker than the one computed by
+ * the analysis: constraints over shadow variables or with numbers
+ * that do not fit in 64 bits are lost.
+ **/
+class InvariantStore {
+public:
+  using wrapper_dom_ptr = GenericAbsDomWrapperPtr;
+  using abs_dom_map_t = block_map<wrapper_dom_ptr>;
+
+  InvariantStore(std::string dir, llvm_variable_factory &vfac);
+
+  // The segments are removed from the spill directory
+  ~InvariantStore();
+
+  // Return false and set err if segments cannot be created in dir
+  static bool checkDirectory(const std::string &dir, std::string &err);
+
+  // Move the invariants of the blocks of F from pre and post into the
+  // store.
+  void spill(const llvm::Function &F, abs_dom_map_t &pre,
+             abs_dom_map_t &post);
+
+  bool contains(const llvm::Function &F) const;
+
+  // Return null if the invariant of block is not in the store
+  wrapper_dom_ptr get_pre(const llvm::BasicBlock &block) const;
+  wrapper_dom_ptr get_post(const llvm::BasicBlock &block) const;
+
+  unsigned num_functions() const { return m_functions.size(); }
+  unsigned num_segments() const { return m_segments.size(); }
+
+private:
+  struct function_t {
+    unsigned segment;
+    // name of the function in the segment
+    std::string key;
+    // top invariant of the domain used to rebuild the invariants
+    wrapper_dom_ptr top;
+  };
+
+  std::string m_dir;
+  llvm_variable_factory &m_vfac;
+  llvm::DenseMap<const llvm::Function *, function_t> m_functions;
+  // the segments are written on demand by get_pre and get_post
+  mutable std::unique_ptr<InvariantDatabaseWriter> m_pending;
+  mutable std::vector<std::unique_ptr<InvariantDatabase>> m_segments;
+  mutable std::vector<std::string> m_files;
+  // numbering of the last function queried
+  mutable std::unique_ptr<ValueNumbering> m_last_vn;
+  mutable std::mutex m_mutex;
+
+  void flush() const;
+  wrapper_dom_ptr get(const llvm::BasicBlock &block, bool is_pre) const;
+};
+
+} // end namespace clam
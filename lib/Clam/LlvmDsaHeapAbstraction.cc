@@ -56,17 +56,29 @@ namespace clam {
     std::swap(s3, s1);
   }
 
-  // v1 is not sorted
-  template<typename Vector, typename Set>
-  inline void vector_difference(Vector& v1, Set& s2) {
-    Vector v3;
-    v3.reserve(v1.size());    
-    for(unsigned i=0,e=v1.size();i<e;++i) {
-      if (!s2.count(v1[i])) {
+  // return v1 \ v2 preserving the order of v1
+  inline HeapAbstraction::RegionVec
+  regionDifference(const HeapAbstraction::RegionVec& v1,
+		   const HeapAbstraction::RegionVec& v2) {
+    HeapAbstraction::RegionSet s2 = HeapAbstraction::toRegionSet(v2);
+    HeapAbstraction::RegionVec v3;
+    v3.reserve(v1.size());
+    for (unsigned i=0,e=v1.size();i<e;++i) {
+      if (!s2.test(v1[i].get_id())) {
 	v3.push_back(v1[i]);
       }
     }
-    std::swap(v3,v1);
+    return v3;
+  }
+
+  // return the regions of key in map without inserting key
+  template<typename Map, typename Key>
+  inline HeapAbstraction::RegionRef lookupRegions(const Map& map, const Key* key) {
+    auto it = map.find(key);
+    if (it == map.end()) {
+      return HeapAbstraction::RegionRef();
+    }
+    return it->second;
   }
 
   struct isInteger: std::unary_function<const llvm::Type*, bool> {
@@ -305,6 +317,14 @@ namespace clam {
     return id + offset;
   }
 
+  void LlvmDsaHeapAbstraction::numberNodes(const llvm::DSGraph &g) {
+    for (auto &n: llvm::make_range(g.node_begin(), g.node_end())) {
+      if (!n.isForwarding()) {
+	getId(&n, 0);
+      }
+    }
+  }
+
   // compute and cache the set of read, mod and new nodes of a whole
   // function such that mod nodes are a subset of the read nodes and
   // the new nodes are disjoint from mod nodes.
@@ -453,20 +473,47 @@ namespace clam {
       m_disambiguate_ptr_cast (disambiguate_ptr_cast),
       m_disambiguate_external (disambiguate_external) {
     
-    // --- Pre-compute all the information per function and
-    //     callsites
-    
+    // --- the information of a function and its callsites is
+    //     computed by the first query about them (see cacheFunction)
+    //     but the region ids are assigned here, in module order, so
+    //     that they are the same whatever the order of the queries
+    //     (e.g., with several threads).
+    if (m_dsa) {
+      for (auto const &F: M) {
+	if (F.isDeclaration() || !m_dsa->hasDSGraph(F)) continue;
+	llvm::DSGraph *g = m_dsa->getDSGraph(F);
+	numberNodes(*g);
+	if (llvm::DSGraph *gg = g->getGlobalsGraph()) {
+	  numberNodes(*gg);
+	}
+      }
+    }
     CRAB_LOG("heap-abs", 
 	     llvm::errs() << "========= HeapAbstraction using llvm-dsa =========\n");
+  }
+
+  void LlvmDsaHeapAbstraction::cacheFunction(const llvm::Function &F) {
+    if (!m_cached_funcs.insert(&F).second) {
+      return;
+    }
     
-    for (auto const &F: m_M) {
-      cacheReadModNewNodes(F);
+    cacheReadModNewNodes(F);
+    auto it = m_func_accessed.find(&F);
+    if (it != m_func_accessed.end()) {
+      // --- only read regions are cached so that queries don't need
+      //     to compute them
+      m_func_only_reads[&F] = regionDifference(it->second, m_func_mods[&F]);
+    }
       
-      auto InstIt = inst_begin(F), InstItEnd = inst_end(F);
-      for (; InstIt != InstItEnd; ++InstIt) {
-	if (const llvm::CallInst *Call =
-	    llvm::dyn_cast<llvm::CallInst>(&*InstIt)) {
-	  cacheReadModNewNodesFromCallSite(*Call);
+    auto InstIt = inst_begin(F), InstItEnd = inst_end(F);
+    for (; InstIt != InstItEnd; ++InstIt) {
+      if (const llvm::CallInst *Call =
+	  llvm::dyn_cast<llvm::CallInst>(&*InstIt)) {
+	cacheReadModNewNodesFromCallSite(*Call);
+	auto cit = m_callsite_accessed.find(Call);
+	if (cit != m_callsite_accessed.end()) {
+	  m_callsite_only_reads[Call] = regionDifference(cit->second,
+							 m_callsite_mods[Call]);
 	}
       }
     }
@@ -481,6 +528,8 @@ namespace clam {
     // its own global graph which seems not to be merged with
     // function's graphs, and thus, it cannot be used here.
     if (!m_dsa) return Region();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cacheFunction(F);
     
     llvm::DSGraph *dsg = m_dsa->getDSGraph(F);
     if (!dsg) return Region();
@@ -521,51 +570,107 @@ namespace clam {
   }
   
   LlvmDsaHeapAbstraction::RegionVec
-  LlvmDsaHeapAbstraction::getAccessedRegions(const llvm::Function& F)  {
-    return m_func_accessed [&F];
+  LlvmDsaHeapAbstraction::getAccessedRegions(const llvm::Function& F) {
+    RegionRef regions = getAccessedRegionsRef(F);
+    return RegionVec(regions.begin(), regions.end());
   }
 
   LlvmDsaHeapAbstraction::RegionVec
-  LlvmDsaHeapAbstraction::getOnlyReadRegions(const llvm::Function& F)  {
-    RegionVec v1 = m_func_accessed[&F];
-    RegionVec v2 = m_func_mods[&F];
-    std::set<Region> s2(v2.begin(), v2.end());
-    vector_difference(v1,s2);
-    return v1;
+  LlvmDsaHeapAbstraction::getOnlyReadRegions(const llvm::Function& F) {
+    RegionRef regions = getOnlyReadRegionsRef(F);
+    return RegionVec(regions.begin(), regions.end());
   }
-  
+
   LlvmDsaHeapAbstraction::RegionVec
   LlvmDsaHeapAbstraction::getModifiedRegions(const llvm::Function& F) {
-    return m_func_mods[&F];
+    RegionRef regions = getModifiedRegionsRef(F);
+    return RegionVec(regions.begin(), regions.end());
   }
-  
+
   LlvmDsaHeapAbstraction::RegionVec
   LlvmDsaHeapAbstraction::getNewRegions(const llvm::Function& F) {
-    return m_func_news[&F];
+    RegionRef regions = getNewRegionsRef(F);
+    return RegionVec(regions.begin(), regions.end());
   }
-  
+
   LlvmDsaHeapAbstraction::RegionVec
   LlvmDsaHeapAbstraction::getAccessedRegions(const llvm::CallInst& I) {
-    return m_callsite_accessed[&I];
+    RegionRef regions = getAccessedRegionsRef(I);
+    return RegionVec(regions.begin(), regions.end());
   }
-  
+
   LlvmDsaHeapAbstraction::RegionVec
-  LlvmDsaHeapAbstraction::getOnlyReadRegions(const llvm::CallInst& I)  {
-    RegionVec v1 = m_callsite_accessed[&I];
-    RegionVec v2 = m_callsite_mods[&I];
-    std::set<Region> s2(v2.begin(), v2.end());
-    vector_difference(v1,s2);
-    return v1;
+  LlvmDsaHeapAbstraction::getOnlyReadRegions(const llvm::CallInst& I) {
+    RegionRef regions = getOnlyReadRegionsRef(I);
+    return RegionVec(regions.begin(), regions.end());
   }
-  
+
   LlvmDsaHeapAbstraction::RegionVec
   LlvmDsaHeapAbstraction::getModifiedRegions(const llvm::CallInst& I) {
-    return m_callsite_mods[&I];
+    RegionRef regions = getModifiedRegionsRef(I);
+    return RegionVec(regions.begin(), regions.end());
   }
-  
+
   LlvmDsaHeapAbstraction::RegionVec
-  LlvmDsaHeapAbstraction::getNewRegions(const llvm::CallInst& I)  {
-    return m_callsite_news[&I];
+  LlvmDsaHeapAbstraction::getNewRegions(const llvm::CallInst& I) {
+    RegionRef regions = getNewRegionsRef(I);
+    return RegionVec(regions.begin(), regions.end());
+  }
+
+  LlvmDsaHeapAbstraction::RegionRef
+  LlvmDsaHeapAbstraction::getAccessedRegionsRef(const llvm::Function& F) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cacheFunction(F);
+    return lookupRegions(m_func_accessed, &F);
+  }
+
+  LlvmDsaHeapAbstraction::RegionRef
+  LlvmDsaHeapAbstraction::getOnlyReadRegionsRef(const llvm::Function& F) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cacheFunction(F);
+    return lookupRegions(m_func_only_reads, &F);
+  }
+
+  LlvmDsaHeapAbstraction::RegionRef
+  LlvmDsaHeapAbstraction::getModifiedRegionsRef(const llvm::Function& F) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cacheFunction(F);
+    return lookupRegions(m_func_mods, &F);
+  }
+
+  LlvmDsaHeapAbstraction::RegionRef
+  LlvmDsaHeapAbstraction::getNewRegionsRef(const llvm::Function& F) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cacheFunction(F);
+    return lookupRegions(m_func_news, &F);
+  }
+
+  LlvmDsaHeapAbstraction::RegionRef
+  LlvmDsaHeapAbstraction::getAccessedRegionsRef(const llvm::CallInst& I) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cacheFunction(*I.getParent()->getParent());
+    return lookupRegions(m_callsite_accessed, &I);
+  }
+
+  LlvmDsaHeapAbstraction::RegionRef
+  LlvmDsaHeapAbstraction::getOnlyReadRegionsRef(const llvm::CallInst& I) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cacheFunction(*I.getParent()->getParent());
+    return lookupRegions(m_callsite_only_reads, &I);
+  }
+
+  LlvmDsaHeapAbstraction::RegionRef
+  LlvmDsaHeapAbstraction::getModifiedRegionsRef(const llvm::CallInst& I) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cacheFunction(*I.getParent()->getParent());
+    return lookupRegions(m_callsite_mods, &I);
+  }
+
+  LlvmDsaHeapAbstraction::RegionRef
+  LlvmDsaHeapAbstraction::getNewRegionsRef(const llvm::CallInst& I) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cacheFunction(*I.getParent()->getParent());
+    return lookupRegions(m_callsite_news, &I);
   }
 } // end namespace
 #endif 
@@ -0,0 +1,194 @@
+#include "LoopAcceleration.hh"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+
+#include "clam/Support/NameValues.hh"
+
+using namespace llvm;
+
+namespace clam {
+
+// step if inc is counter + step or counter - step, zero otherwise
+static int64_t getStep(const Value &inc, const PHINode &counter) {
+  auto *BO = dyn_cast<BinaryOperator>(&inc);
+  if (!BO) {
+    return 0;
+  }
+  const Value *op0 = BO->getOperand(0);
+  const Value *op1 = BO->getOperand(1);
+  if (BO->getOpcode() == Instruction::Add && op1 == &counter) {
+    std::swap(op0, op1);
+  } else if (BO->getOpcode() != Instruction::Sub &&
+             BO->getOpcode() != Instruction::Add) {
+    return 0;
+  }
+  auto *C = dyn_cast<ConstantInt>(op1);
+  if (op0 != &counter || !C || C->getBitWidth() > 64) {
+    return 0;
+  }
+  int64_t step = C->getSExtValue();
+  // -- keep enough room to compute the bounds
+  if (step <= INT32_MIN || step >= INT32_MAX) {
+    return 0;
+  }
+  return BO->getOpcode() == Instruction::Add ? step : -step;
+}
+
+static bool isCountingLoop(const Loop &L, CountingLoop &cl) {
+  BasicBlock *header = L.getHeader();
+  BasicBlock *latch = L.getLoopLatch();
+  if (!latch) {
+    return false;
+  }
+  // -- a single induction variable
+  const PHINode *counter = nullptr;
+  for (auto &I : *header) {
+    auto *phi = dyn_cast<PHINode>(&I);
+    if (!phi) {
+      break;
+    }
+    if (phi->getName().startswith("shadow.mem")) {
+      continue;
+    }
+    if (counter) {
+      return false;
+    }
+    counter = phi;
+  }
+  if (!counter || !counter->getType()->isIntegerTy() ||
+      counter->getType()->getIntegerBitWidth() == 1 ||
+      counter->getNumIncomingValues() != 2) {
+    return false;
+  }
+  const Value *inc = counter->getIncomingValueForBlock(latch);
+  unsigned init_idx = counter->getIncomingBlock(0) == latch ? 1 : 0;
+  const Value *init = counter->getIncomingValue(init_idx);
+  if (L.contains(counter->getIncomingBlock(init_idx)) ||
+      !L.isLoopInvariant(init)) {
+    return false;
+  }
+  int64_t step = getStep(*inc, *counter);
+  if (step == 0) {
+    return false;
+  }
+
+  // -- the guard: either on the counter by the header or on the
+  //    incremented counter by the latch
+  bool guard_on_inc;
+  const ICmpInst *cmp = nullptr;
+  const BranchInst *BI = nullptr;
+  for (const BasicBlock *BB : {header, latch}) {
+    auto *br = dyn_cast<BranchInst>(BB->getTerminator());
+    if (!br || !br->isConditional()) {
+      continue;
+    }
+    auto *c = dyn_cast<ICmpInst>(br->getCondition());
+    const Value *guarded = (BB == header ? counter : inc);
+    if (c && (c->getOperand(0) == guarded || c->getOperand(1) == guarded)) {
+      cmp = c;
+      BI = br;
+      guard_on_inc = (BB != header);
+      break;
+    }
+  }
+  if (!cmp) {
+    return false;
+  }
+  bool stay_on_true = L.contains(BI->getSuccessor(0));
+  if (stay_on_true == L.contains(BI->getSuccessor(1))) {
+    return false;
+  }
+  // -- normalize to "guarded pred bound" while staying in the loop
+  CmpInst::Predicate pred = cmp->getPredicate();
+  if (!stay_on_true) {
+    pred = CmpInst::getInversePredicate(pred);
+  }
+  const Value *guarded = (guard_on_inc ? inc : counter);
+  const Value *bound = cmp->getOperand(1);
+  if (cmp->getOperand(1) == guarded) {
+    bound = cmp->getOperand(0);
+    pred = CmpInst::getSwappedPredicate(pred);
+  }
+  if (bound == guarded || !L.isLoopInvariant(bound)) {
+    return false;
+  }
+
+  // -- the range of the guarded value: bound + offset is an upper
+  //    (step > 0) or a lower (step < 0) bound
+  int64_t offset;
+  if (step > 0 && pred == CmpInst::ICMP_SLT) {
+    offset = -1;
+  } else if (step > 0 && pred == CmpInst::ICMP_SLE) {
+    offset = 0;
+  } else if (step < 0 && pred == CmpInst::ICMP_SGT) {
+    offset = 1;
+  } else if (step < 0 && pred == CmpInst::ICMP_SGE) {
+    offset = 0;
+  } else {
+    return false;
+  }
+  if (!guard_on_inc) {
+    // -- the guard holds before the increment
+    offset += step;
+  }
+
+  cl.header = header;
+  cl.latch = latch;
+  cl.counter = counter;
+  cl.init = init;
+  cl.bound = bound;
+  cl.step = step;
+  cl.offset = offset;
+  return true;
+}
+
+static void addLoops(const Loop &L, DenseMap<const BasicBlock *, CountingLoop> &loops) {
+  CountingLoop cl;
+  if (isCountingLoop(L, cl)) {
+    loops[cl.header] = cl;
+  }
+  for (const Loop *SubL : L) {
+    addLoops(*SubL, loops);
+  }
+}
+
+LoopAcceleration::LoopAcceleration(const Function &F) {
+  if (F.isDeclaration()) {
+    return;
+  }
+  DominatorTree DT(const_cast<Function &>(F));
+  LoopInfo LI(DT);
+  for (const Loop *L : LI) {
+    addLoops(*L, m_loops);
+  }
+}
+
+const CountingLoop *LoopAcceleration::lookup(const BasicBlock &latch,
+                                             const BasicBlock &header) const {
+  auto it = m_loops.find(&header);
+  if (it == m_loops.end() || it->second.latch != &latch) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+void LoopAcceleration::write(raw_ostream &o) const {
+  o << "Counting loops:\n";
+  for (auto &kv : m_loops) {
+    const CountingLoop &cl = kv.second;
+    o << "  " << getValueName(*cl.header) << ": "
+      << getValueName(*cl.counter) << " in ";
+    if (cl.step > 0) {
+      o << "[" << getValueName(*cl.init) << "+" << cl.step << ", "
+        << getValueName(*cl.bound) << "+" << cl.offset << "]";
+    } else {
+      o << "[" << getValueName(*cl.bound) << "+" << cl.offset << ", "
+        << getValueName(*cl.init) << "+" << cl.step << "]";
+    }
+    o << " after " << getValueName(*cl.latch) << "\n";
+  }
+}
+
+} // end namespace clam
@@ -0,0 +1,58 @@
+#pragma once
+
+/* Closed-form invariants of the counting loops of a function */
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace clam {
+
+/*
+ * A loop whose header has a single phi node i with
+ *
+ *    i = phi [init, outside], [i + step, latch]
+ *
+ * where step is a non-zero constant, and which stays in the loop
+ * while i < bound, i <= bound (step > 0) or i > bound, i >= bound
+ * (step < 0), with init and bound loop-invariant. The guard is
+ * either checked on i by the header or on i + step by the latch.
+ *
+ * After the increment on the back edge i is within
+ *
+ *    [init + step, bound + offset]   if step > 0
+ *    [bound + offset, init + step]   if step < 0
+ *
+ * so that the back edge can forget i and assume its range instead:
+ * the loop head then stabilizes at the first join, without widening.
+ */
+struct CountingLoop {
+  const llvm::BasicBlock *header;
+  const llvm::BasicBlock *latch;
+  const llvm::PHINode *counter;
+  const llvm::Value *init;
+  const llvm::Value *bound;
+  int64_t step;
+  int64_t offset;
+};
+
+class LoopAcceleration {
+public:
+  explicit LoopAcceleration(const llvm::Function &F);
+
+  // The counting loop whose back edge is latch -> header, if any
+  const CountingLoop *lookup(const llvm::BasicBlock &latch,
+                             const llvm::BasicBlock &header) const;
+
+  unsigned num_loops() const { return m_loops.size(); }
+
+  void write(llvm::raw_ostream &o) const;
+
+private:
+  // indexed by the header
+  llvm::DenseMap<const llvm::BasicBlock *, CountingLoop> m_loops;
+};
+
+} // end namespace clam
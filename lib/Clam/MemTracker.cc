@@ -0,0 +1,309 @@
+#include "clam/config.h"
+#include "clam/Support/MemTracker.hh"
+
+#ifdef TRACK_ALLOCATIONS
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+#endif
+
+namespace clam {
+
+#ifdef TRACK_ALLOCATIONS
+
+namespace {
+
+struct counter_t {
+  std::atomic<int64_t> live;
+  std::atomic<int64_t> peak;
+};
+
+// Counters of the tags, in chunks allocated on demand so that the
+// counters never move. Tags beyond the last chunk are not counted.
+// All the globals below are constant-initialized: operator new can
+// be called before any constructor runs.
+const uint32_t CHUNK_SIZE = 1024;
+const uint32_t MAX_CHUNKS = 1024;
+
+struct counters_t {
+  std::atomic<counter_t *> chunks[MAX_CHUNKS];
+
+  counter_t *get(uint32_t tag) {
+    if (tag / CHUNK_SIZE >= MAX_CHUNKS) {
+      return nullptr;
+    }
+    counter_t *chunk = chunks[tag / CHUNK_SIZE].load(std::memory_order_acquire);
+    return chunk ? &chunk[tag % CHUNK_SIZE] : nullptr;
+  }
+
+  // Called with the lock of the names of the tags
+  void ensure(uint32_t tag) {
+    if (tag / CHUNK_SIZE < MAX_CHUNKS && !get(tag)) {
+      counter_t *chunk = new counter_t[CHUNK_SIZE]();
+      chunks[tag / CHUNK_SIZE].store(chunk, std::memory_order_release);
+    }
+  }
+};
+
+counters_t function_counters;
+counters_t phase_counters;
+counter_t total_counter;
+
+// tag 0 is no function and no phase
+thread_local uint32_t tl_function = 0;
+thread_local uint32_t tl_phase = 0;
+
+struct untagged_scope_t {
+  uint32_t function, phase;
+  untagged_scope_t() : function(tl_function), phase(tl_phase) {
+    tl_function = tl_phase = 0;
+  }
+  ~untagged_scope_t() {
+    tl_function = function;
+    tl_phase = phase;
+  }
+};
+
+struct tags_t {
+  std::mutex mutex;
+  std::unordered_map<std::string, uint32_t> ids;
+  std::vector<std::string> names;
+  counters_t &counters;
+
+  tags_t(counters_t &c, const std::string &none) : counters(c) {
+    get_id(none);
+  }
+
+  uint32_t get_id(llvm::StringRef name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // -- the tags themselves are not attributed to any tag
+    untagged_scope_t untagged;
+    auto it = ids.find(name.str());
+    if (it != ids.end()) {
+      return it->second;
+    }
+    uint32_t id = names.size();
+    names.push_back(name.str());
+    ids[name.str()] = id;
+    counters.ensure(id);
+    return id;
+  }
+
+  std::map<std::string, MemTracker::usage_t> get_usages() {
+    std::lock_guard<std::mutex> lock(mutex);
+    untagged_scope_t untagged;
+    std::map<std::string, MemTracker::usage_t> res;
+    for (uint32_t id = 1; id < names.size(); ++id) {
+      if (counter_t *c = counters.get(id)) {
+        MemTracker::usage_t &u = res[names[id]];
+        u.live = std::max(c->live.load(), (int64_t)0);
+        u.peak = std::max(c->peak.load(), (int64_t)0);
+      }
+    }
+    return res;
+  }
+
+  MemTracker::usage_t get_usage(llvm::StringRef name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    untagged_scope_t untagged;
+    MemTracker::usage_t res;
+    auto it = ids.find(name.str());
+    if (it != ids.end()) {
+      if (counter_t *c = counters.get(it->second)) {
+        res.live = std::max(c->live.load(), (int64_t)0);
+        res.peak = std::max(c->peak.load(), (int64_t)0);
+      }
+    }
+    return res;
+  }
+};
+
+tags_t &getFunctionTags() {
+  static tags_t tags(function_counters, "<none>");
+  return tags;
+}
+
+tags_t &getPhaseTags() {
+  static tags_t tags(phase_counters, "<none>");
+  return tags;
+}
+
+void account(counter_t *c, int64_t delta) {
+  if (!c) {
+    return;
+  }
+  int64_t live = c->live.fetch_add(delta, std::memory_order_relaxed) + delta;
+  if (delta > 0) {
+    int64_t peak = c->peak.load(std::memory_order_relaxed);
+    while (live > peak &&
+           !c->peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+  }
+}
+
+// Prefix of each allocation. It keeps the alignment of malloc.
+struct header_t {
+  uint64_t size;
+  uint32_t function;
+  uint32_t phase;
+};
+static_assert(sizeof(header_t) == 16, "header_t must keep the alignment");
+
+void *allocate(std::size_t n) {
+  header_t *h = (header_t *)std::malloc(n + sizeof(header_t));
+  if (!h) {
+    return nullptr;
+  }
+  h->size = n;
+  h->function = tl_function;
+  h->phase = tl_phase;
+  account(function_counters.get(h->function), n);
+  account(phase_counters.get(h->phase), n);
+  account(&total_counter, n);
+  return h + 1;
+}
+
+void *allocateOrThrow(std::size_t n) {
+  for (;;) {
+    if (void *p = allocate(n)) {
+      return p;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (!handler) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void deallocate(void *p) {
+  if (!p) {
+    return;
+  }
+  header_t *h = (header_t *)p - 1;
+  int64_t n = h->size;
+  account(function_counters.get(h->function), -n);
+  account(phase_counters.get(h->phase), -n);
+  account(&total_counter, -n);
+  std::free(h);
+}
+
+} // end namespace
+
+bool MemTracker::enabled() { return true; }
+
+std::map<std::string, MemTracker::usage_t> MemTracker::get_functions() {
+  return getFunctionTags().get_usages();
+}
+
+MemTracker::usage_t MemTracker::get_function(llvm::StringRef function) {
+  return getFunctionTags().get_usage(function);
+}
+
+std::map<std::string, MemTracker::usage_t> MemTracker::get_phases() {
+  return getPhaseTags().get_usages();
+}
+
+MemTracker::usage_t MemTracker::get_total() {
+  usage_t res;
+  res.live = std::max(total_counter.live.load(), (int64_t)0);
+  res.peak = std::max(total_counter.peak.load(), (int64_t)0);
+  return res;
+}
+
+MemTracker::ScopedFunction::ScopedFunction(llvm::StringRef function)
+    : m_prev(tl_function) {
+  tl_function = getFunctionTags().get_id(function);
+}
+
+MemTracker::ScopedFunction::~ScopedFunction() { tl_function = m_prev; }
+
+MemTracker::ScopedPhase::ScopedPhase(llvm::StringRef phase) : m_prev(tl_phase) {
+  enter(phase);
+}
+
+MemTracker::ScopedPhase::~ScopedPhase() { tl_phase = m_prev; }
+
+void MemTracker::ScopedPhase::enter(llvm::StringRef phase) {
+  tl_phase = getPhaseTags().get_id(phase);
+}
+
+#else
+
+bool MemTracker::enabled() { return false; }
+
+std::map<std::string, MemTracker::usage_t> MemTracker::get_functions() {
+  return std::map<std::string, usage_t>();
+}
+
+MemTracker::usage_t MemTracker::get_function(llvm::StringRef) {
+  return usage_t();
+}
+
+std::map<std::string, MemTracker::usage_t> MemTracker::get_phases() {
+  return std::map<std::string, usage_t>();
+}
+
+MemTracker::usage_t MemTracker::get_total() { return usage_t(); }
+
+MemTracker::ScopedFunction::ScopedFunction(llvm::StringRef) : m_prev(0) {}
+
+MemTracker::ScopedFunction::~ScopedFunction() {}
+
+MemTracker::ScopedPhase::ScopedPhase(llvm::StringRef) : m_prev(0) {}
+
+MemTracker::ScopedPhase::~ScopedPhase() {}
+
+void MemTracker::ScopedPhase::enter(llvm::StringRef) {}
+
+#endif
+
+} // end namespace clam
+
+#ifdef TRACK_ALLOCATIONS
+
+/* Replacements of the global allocation functions */
+
+void *operator new(std::size_t n) { return clam::allocateOrThrow(n); }
+
+void *operator new[](std::size_t n) { return clam::allocateOrThrow(n); }
+
+void *operator new(std::size_t n, const std::nothrow_t &) noexcept {
+  try {
+    return clam::allocateOrThrow(n);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void *operator new[](std::size_t n, const std::nothrow_t &) noexcept {
+  try {
+    return clam::allocateOrThrow(n);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void operator delete(void *p) noexcept { clam::deallocate(p); }
+
+void operator delete[](void *p) noexcept { clam::deallocate(p); }
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  clam::deallocate(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  clam::deallocate(p);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void *p, std::size_t) noexcept { clam::deallocate(p); }
+
+void operator delete[](void *p, std::size_t) noexcept { clam::deallocate(p); }
+#endif
+
+#endif
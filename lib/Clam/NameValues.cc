@@ -1,13 +1,16 @@
 #include "clam/Support/NameValues.hh"
 
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/BasicBlock.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Twine.h"
 
-#include <boost/tokenizer.hpp>
-#include <boost/algorithm/string/predicate.hpp>
-#include "clam/Support/Boost.hh"
+#include <functional>
+#include <memory>
+#include <mutex>
 
 using namespace llvm;
 
@@ -16,8 +19,90 @@ UseCrabNameValues("crab-name-values",
            cl::desc("Use own crab way of naming values, otherwise LLVM instnamer"),
            cl::init(true));
 
+cl::opt<bool>
+CrabLazyNames("crab-lazy-names",
+           cl::desc("Do not name the unnamed values. Their names are "
+                    "synthesized only to print them"),
+           cl::init(false));
+
 namespace clam {
 
+  // Visit the unnamed values of F with their slot numbers, in the
+  // order of the LLVM slot tracker: unnamed arguments, then unnamed
+  // blocks and non-void instructions.
+  static void
+  visitUnnamedValues(Function &F, std::function<void(Value&, unsigned)> f) {
+    unsigned slot = 0;
+    for (auto &Arg : F.args()) {
+      if (!Arg.hasName()) {
+        f(Arg, slot++);
+      }
+    }
+    for (BasicBlock &BB : F) {
+      if (!BB.hasName()) {
+        f(BB, slot++);
+      }
+      for (Instruction &I : BB) {
+        if (!I.hasName() && !I.getType()->isVoidTy()) {
+          f(I, slot++);
+        }
+      }
+    }
+  }
+
+  static std::string getSlotName(const Value &v, unsigned slot) {
+    // -- NameValues names all the arguments "arg" so LLVM makes
+    //    them unique by appending a counter
+    if (isa<Argument>(v)) {
+      return (slot == 0 ? std::string("arg") : "arg" + std::to_string(slot));
+    }
+    return "_" + std::to_string(slot);
+  }
+
+  typedef DenseMap<const Value*, unsigned> slot_map_t;
+  static std::mutex slots_mutex;
+  static DenseMap<const Function*, std::unique_ptr<slot_map_t>> slots_cache;
+
+  std::string getValueName(const Value &v) {
+    if (v.hasName()) {
+      return v.getName().str();
+    }
+    const Function *F = nullptr;
+    if (const Argument *A = dyn_cast<Argument>(&v)) {
+      F = A->getParent();
+    } else if (const BasicBlock *B = dyn_cast<BasicBlock>(&v)) {
+      F = B->getParent();
+    } else if (const Instruction *I = dyn_cast<Instruction>(&v)) {
+      F = I->getParent() ? I->getParent()->getParent() : nullptr;
+    }
+    if (!F) {
+      std::string str;
+      raw_string_ostream o(str);
+      v.printAsOperand(o, false);
+      return o.str();
+    }
+    std::lock_guard<std::mutex> lock(slots_mutex);
+    std::unique_ptr<slot_map_t> &slots = slots_cache[F];
+    if (!slots) {
+      slots.reset(new slot_map_t());
+      visitUnnamedValues(const_cast<Function&>(*F),
+                         [&slots](Value &u, unsigned slot) {
+                           (*slots)[&u] = slot;
+                         });
+    }
+    auto it = slots->find(&v);
+    if (it == slots->end()) {
+      // -- v was added after the slots were computed
+      return "_";
+    }
+    return getSlotName(v, it->second);
+  }
+
+  void invalidateValueNames(const Function &F) {
+    std::lock_guard<std::mutex> lock(slots_mutex);
+    slots_cache.erase(&F);
+  }
+
   char NameValues::ID = 0;
 
   bool NameValues::runOnModule (Module &M)
@@ -29,62 +114,16 @@ namespace clam {
 
   bool NameValues::runOnFunction (Function &F)
   {
-    if (UseCrabNameValues) {    
-      // -- print to string 
-      std::string funcAsm;
-      raw_string_ostream out (funcAsm);
-      out << F;
-      out.flush ();
-    
-      typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
-      boost::char_separator<char> nl_sep ("\n");
-      boost::char_separator<char> sp_sep (" :\t%@");
-      
-      tokenizer lines (funcAsm, nl_sep);
-      tokenizer::iterator line_iter = lines.begin ();
-      
-      // -- skip function attributes
-      if (boost::starts_with(*line_iter, "; Function Attrs:"))
-	++line_iter;
-      
-
-      // Function parameters can be unnamed
-      for (auto &Arg : F.args()) {
-        if (!Arg.hasName()) {
-	  Arg.setName("arg");
-	}
-      }
-
-      // -- skip function definition line
-      ++line_iter;
-      
-      for (Function::iterator BI = F.begin (), BE = F.end (); 
-	   BI != BE && line_iter != lines.end (); ++BI) {
-	BasicBlock &BB = *BI;
-	
-	if (!BB.hasName ()) {
-	  std::string bb_line = *line_iter;
-	  tokenizer names (bb_line, sp_sep);
-	  std::string bb_name = *names.begin ();
-	  if (bb_name == ";") bb_name = "un";
-	  BB.setName ("_" + bb_name);
-	}
-	++line_iter;
-	
-	for (BasicBlock::iterator II = BB.begin (), IE = BB.end ();
-	     II != IE && line_iter != lines.end (); ++II) {
-	  Instruction &I = *II;
-	  if (!I.hasName () && !(I.getType ()->isVoidTy ())) {
-	    std::string inst_line = *line_iter;
-	    tokenizer names (inst_line, sp_sep);
-	    std::string inst_name = *names.begin ();
-	    I.setName ("_" + inst_name);
-          }
-	  ++line_iter;
-	}
-      }
+    if (CrabLazyNames) {
+      return false;
+    }
+    if (UseCrabNameValues) {
+      invalidateValueNames(F);
+      visitUnnamedValues(F, [](Value &v, unsigned slot) {
+          v.setName(isa<Argument>(v) ? Twine("arg") : "_" + Twine(slot));
+        });
     } else {
-      // LLVM InstructionNamer (much faster)
+      // LLVM InstructionNamer
       
       for (auto &Arg : F.args()) {
         if (!Arg.hasName()) {
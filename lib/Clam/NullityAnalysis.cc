@@ -0,0 +1,225 @@
+#include "NullityAnalysis.hh"
+
+#include "llvm/ADT/iterator_range.h"
+
+#include <deque>
+
+namespace clam {
+
+typedef basic_block_t::ptr_load_t ptr_load_t;
+typedef basic_block_t::ptr_store_t ptr_store_t;
+typedef basic_block_t::ptr_assign_t ptr_assign_t;
+typedef basic_block_t::ptr_object_t ptr_object_t;
+typedef basic_block_t::ptr_null_t ptr_null_t;
+typedef basic_block_t::ptr_assume_t ptr_assume_t;
+typedef basic_block_t::ptr_assert_t ptr_assert_t;
+
+NullityAnalysis::NullityAnalysis(cfg_ref_t cfg) : m_cfg(cfg) {
+  std::vector<basic_block_label_t> labels;
+  for (auto &bb : llvm::make_range(cfg.begin(), cfg.end())) {
+    m_blocks.insert({bb.label(), labels.size()});
+    labels.push_back(bb.label());
+  }
+  unsigned num_blocks = labels.size();
+  m_pre.resize(num_blocks);
+  std::vector<state_t> post(num_blocks);
+  std::vector<char> in_worklist(num_blocks, false);
+  std::deque<unsigned> worklist;
+  unsigned entry = m_blocks[cfg.entry()];
+  m_pre[entry].bottom = false;
+  worklist.push_back(entry);
+  in_worklist[entry] = true;
+  // -- the states only lose facts so each block is visited again at
+  //    most twice per pointer variable
+  while (!worklist.empty()) {
+    unsigned b = worklist.front();
+    worklist.pop_front();
+    in_worklist[b] = false;
+    auto &bb = cfg.get_node(labels[b]);
+    state_t s(m_pre[b]);
+    for (auto &stmt : llvm::make_range(bb.begin(), bb.end())) {
+      if (s.bottom) {
+        break;
+      }
+      apply(s, stmt);
+    }
+    if (s.bottom || s == post[b]) {
+      continue;
+    }
+    post[b] = std::move(s);
+    for (auto succ : llvm::make_range(bb.next_blocks())) {
+      unsigned n = m_blocks[succ];
+      state_t pre(m_pre[n]);
+      join(pre, post[b]);
+      if (pre == m_pre[n]) {
+        continue;
+      }
+      m_pre[n] = std::move(pre);
+      if (!in_worklist[n]) {
+        in_worklist[n] = true;
+        worklist.push_back(n);
+      }
+    }
+  }
+}
+
+void NullityAnalysis::join(state_t &s, const state_t &o) {
+  if (o.bottom) {
+    return;
+  }
+  if (s.bottom) {
+    s = o;
+    return;
+  }
+  for (auto it = s.vals.begin(); it != s.vals.end();) {
+    auto oit = o.vals.find(it->first);
+    if (oit == o.vals.end() || oit->second != it->second) {
+      it = s.vals.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void NullityAnalysis::set(state_t &s, const var_t &v, bool known, nullity_t n) {
+  if (known) {
+    s.vals[v] = n;
+  } else {
+    s.vals.erase(v);
+  }
+}
+
+bool NullityAnalysis::assume(state_t &s, const ptr_cst_t &cst) {
+  if (cst.is_tautology()) {
+    return true;
+  }
+  if (cst.is_contradiction()) {
+    return false;
+  }
+  auto lhs = s.vals.find(cst.lhs());
+  bool lhs_known = lhs != s.vals.end();
+  if (cst.is_unary()) {
+    // -- p == null or p != null
+    nullity_t n = cst.is_equality() ? NULLPTR : NONNULL;
+    if (lhs_known && lhs->second != n) {
+      return false;
+    }
+    s.vals[cst.lhs()] = n;
+    return true;
+  }
+  auto rhs = s.vals.find(cst.rhs());
+  bool rhs_known = rhs != s.vals.end();
+  if (cst.is_equality()) {
+    if (lhs_known && rhs_known) {
+      return lhs->second == rhs->second;
+    } else if (lhs_known) {
+      s.vals[cst.rhs()] = lhs->second;
+    } else if (rhs_known) {
+      s.vals[cst.lhs()] = rhs->second;
+    }
+  } else if (cst.is_disequality()) {
+    // -- only null is known to be a single value
+    if (lhs_known && rhs_known) {
+      return lhs->second != NULLPTR || rhs->second != NULLPTR;
+    } else if (lhs_known && lhs->second == NULLPTR) {
+      s.vals[cst.rhs()] = NONNULL;
+    } else if (rhs_known && rhs->second == NULLPTR) {
+      s.vals[cst.lhs()] = NONNULL;
+    }
+  }
+  return true;
+}
+
+void NullityAnalysis::apply(state_t &s, const statement_t &stmt) {
+  if (stmt.is_ptr_null()) {
+    s.vals[static_cast<const ptr_null_t &>(stmt).lhs()] = NULLPTR;
+  } else if (stmt.is_ptr_object()) {
+    s.vals[static_cast<const ptr_object_t &>(stmt).lhs()] = NONNULL;
+  } else if (stmt.is_ptr_assign()) {
+    auto &a = static_cast<const ptr_assign_t &>(stmt);
+    auto it = s.vals.find(a.rhs());
+    bool known = it != s.vals.end();
+    nullity_t n = known ? it->second : NONNULL;
+    if (known && n == NULLPTR && !(a.offset().is_constant() &&
+                                   a.offset().constant() == number_t(0))) {
+      // -- null plus an offset
+      known = false;
+    }
+    set(s, a.lhs(), known, n);
+  } else if (stmt.is_ptr_read()) {
+    auto &l = static_cast<const ptr_load_t &>(stmt);
+    s.vals.erase(l.lhs());
+    s.vals[l.rhs()] = NONNULL;
+  } else if (stmt.is_ptr_write()) {
+    s.vals[static_cast<const ptr_store_t &>(stmt).lhs()] = NONNULL;
+  } else if (stmt.is_ptr_assume()) {
+    if (!assume(s, static_cast<const ptr_assume_t &>(stmt).constraint())) {
+      s.bottom = true;
+      s.vals.clear();
+    }
+  } else if (stmt.is_ptr_assert()) {
+    // -- execution continues only if the check holds
+    if (!assume(s, static_cast<const ptr_assert_t &>(stmt).constraint())) {
+      s.bottom = true;
+      s.vals.clear();
+    }
+  } else {
+    auto &ls = stmt.get_live();
+    for (auto it = ls.defs_begin(), et = ls.defs_end(); it != et; ++it) {
+      s.vals.erase(*it);
+    }
+  }
+}
+
+void NullityAnalysis::check(crab::checker::checks_db &db) const {
+  for (auto &kv : m_blocks) {
+    state_t s(m_pre[kv.second]);
+    for (auto &stmt : m_cfg.get_node(kv.first)) {
+      if (stmt.is_ptr_assert()) {
+        const ptr_cst_t &cst = static_cast<const ptr_assert_t &>(stmt).constraint();
+        crab::checker::check_kind_t status = crab::checker::_WARN;
+        if (s.bottom || cst.is_tautology()) {
+          status = crab::checker::_SAFE;
+        } else if (cst.is_contradiction()) {
+          status = crab::checker::_ERR;
+        } else if (cst.is_unary() && cst.is_disequality()) {
+          auto it = s.vals.find(cst.lhs());
+          if (it != s.vals.end()) {
+            status = (it->second == NONNULL ? crab::checker::_SAFE
+                                            : crab::checker::_ERR);
+          }
+        } else {
+          state_t t(s);
+          if (!assume(t, cst)) {
+            status = crab::checker::_ERR;
+          }
+        }
+        db.add(status, stmt.get_debug_info());
+      }
+      if (!s.bottom) {
+        apply(s, stmt);
+      }
+    }
+  }
+}
+
+void NullityAnalysis::write(crab::crab_os &o) const {
+  for (auto &kv : m_blocks) {
+    const state_t &s = m_pre[kv.second];
+    o << kv.first << ": ";
+    if (s.bottom) {
+      o << "_|_\n";
+      continue;
+    }
+    o << "{";
+    bool first = true;
+    for (auto &v : s.vals) {
+      o << (first ? "" : ", ") << v.first
+        << (v.second == NULLPTR ? " == null" : " != null");
+      first = false;
+    }
+    o << "}\n";
+  }
+}
+
+} // end namespace clam
@@ -0,0 +1,62 @@
+#pragma once
+
+/* Nullness of the pointers of a Crab CFG */
+
+#include "clam/crab/crab_cfg.hh"
+#include "crab/checkers/base_property.hpp"
+
+#include <map>
+#include <vector>
+
+namespace clam {
+
+/*
+ * Forward analysis of whether each pointer variable of a CFG is null,
+ * not null or unknown, for the checks of --crab-check=null. The CFG
+ * must be built with the null checks of the dereferences
+ * (CrabBuilderParams::null_checks), which are the ptr_assert
+ * statements "p != null".
+ *
+ * A variable is not null after it is assigned a new object, after it
+ * is dereferenced or if it is assumed so by a branch. A pointer
+ * variable gets the value of the pointer it is assigned from
+ * (with a non-zero offset only a pointer that is not null stays not
+ * null). Any other statement that defines a variable forgets it. The
+ * lattice of each variable has height two so the fixpoint needs no
+ * widening and is only a few passes over the blocks, unlike a
+ * numerical analysis of the same CFG.
+ */
+class NullityAnalysis {
+public:
+  explicit NullityAnalysis(cfg_ref_t cfg);
+
+  // Add the status of each null check of the CFG to db
+  void check(crab::checker::checks_db &db) const;
+
+  void write(crab::crab_os &o) const;
+
+private:
+  enum nullity_t { NULLPTR, NONNULL };
+
+  // A missing variable is unknown
+  struct state_t {
+    bool bottom;
+    std::map<var_t, nullity_t> vals;
+    state_t() : bottom(true) {}
+    bool operator==(const state_t &o) const {
+      return bottom == o.bottom && vals == o.vals;
+    }
+  };
+
+  cfg_ref_t m_cfg;
+  std::map<basic_block_label_t, unsigned> m_blocks;
+  std::vector<state_t> m_pre;
+
+  static void join(state_t &s, const state_t &o);
+  static void set(state_t &s, const var_t &v, bool known, nullity_t n);
+  // Whether cst can hold in s and, if so, refine s with it
+  static bool assume(state_t &s, const ptr_cst_t &cst);
+  static void apply(state_t &s, const statement_t &stmt);
+};
+
+} // end namespace clam
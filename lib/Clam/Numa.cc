@@ -0,0 +1,104 @@
+#include "clam/Support/Numa.hh"
+#include "clam/Support/Stats.hh"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace clam {
+
+using namespace llvm;
+
+namespace {
+
+std::atomic<bool> numa_enabled(false);
+
+// Parse a cpulist such as "0-15,64-79". Return false if it is not
+// valid.
+bool parseCpuList(StringRef list, std::vector<unsigned> &cpus) {
+  SmallVector<StringRef, 8> ranges;
+  list.trim().split(ranges, ',', -1, false);
+  for (StringRef range : ranges) {
+    StringRef lo, hi;
+    std::tie(lo, hi) = range.split('-');
+    unsigned l, h;
+    if (lo.getAsInteger(10, l)) {
+      return false;
+    }
+    h = l;
+    if (!hi.empty() && hi.getAsInteger(10, h)) {
+      return false;
+    }
+    for (unsigned c = l; c <= h; ++c) {
+      cpus.push_back(c);
+    }
+  }
+  return true;
+}
+
+// The CPUs of each node with CPUs, read once
+const std::vector<std::vector<unsigned>> &getNodes() {
+  static const std::vector<std::vector<unsigned>> nodes = []() {
+    std::vector<std::vector<unsigned>> res;
+    for (unsigned n = 0;; ++n) {
+      auto buf = MemoryBuffer::getFile("/sys/devices/system/node/node" +
+                                       std::to_string(n) + "/cpulist");
+      if (!buf) {
+        break;
+      }
+      std::vector<unsigned> cpus;
+      if (parseCpuList((*buf)->getBuffer(), cpus) && !cpus.empty()) {
+        res.push_back(std::move(cpus));
+      }
+    }
+    return res;
+  }();
+  return nodes;
+}
+
+} // end namespace
+
+void Numa::set_enabled(bool enabled) { numa_enabled = enabled; }
+
+bool Numa::enabled() { return numa_enabled; }
+
+unsigned Numa::num_nodes() {
+  return std::max((unsigned)getNodes().size(), 1U);
+}
+
+bool Numa::pin_worker(unsigned worker) {
+#ifdef __linux__
+  if (!enabled() || num_nodes() < 2) {
+    return false;
+  }
+  const std::vector<unsigned> &cpus = getNodes()[worker % num_nodes()];
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (unsigned c : cpus) {
+    if (c < CPU_SETSIZE) {
+      CPU_SET(c, &set);
+    }
+  }
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    return false;
+  }
+  ClamStats::count("Numa.PinnedWorkers");
+  return true;
+#else
+  (void)worker;
+  return false;
+#endif
+}
+
+} // end namespace clam
@@ -0,0 +1,162 @@
+#include "OutputSink.hh"
+
+#include "clam/Support/Debug.hh"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compression.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+/*
+ * A gzip member (RFC 1952) is built from the zlib stream (RFC 1950)
+ * returned by llvm::zlib::compress: its 2-byte header and its
+ * adler32 trailer are replaced with the gzip header, named after the
+ * frame, and the crc32 and the size of the frame.
+ */
+
+namespace clam {
+
+using namespace llvm;
+
+// -- frames pending before write blocks
+static const unsigned MAX_PENDING_FRAMES = 64;
+
+static std::mutex current_mutex;
+static OutputSink *current = nullptr;
+
+static void appendLE32(std::string &s, uint32_t n) {
+  for (unsigned i = 0; i < 4; ++i) {
+    s.push_back((char)((n >> (8 * i)) & 0xff));
+  }
+}
+
+// Return false if data cannot be compressed
+static bool mkGzipMember(StringRef name, StringRef data, std::string &member) {
+  SmallVector<char, 0> zstream;
+  if (Error E = zlib::compress(data, zstream)) {
+    consumeError(std::move(E));
+    return false;
+  }
+  if (zstream.size() < 6) {
+    return false;
+  }
+  // -- magic, deflate, FNAME, mtime, no extra flags, unknown OS
+  member.assign("\x1f\x8b\x08\x08", 4);
+  appendLE32(member, 0);
+  member.push_back('\0');
+  member.push_back('\xff');
+  member.append(name.begin(), name.end());
+  member.push_back('\0');
+  member.append(zstream.begin() + 2, zstream.end() - 4);
+  appendLE32(member, zlib::crc32(data));
+  appendLE32(member, (uint32_t)data.size());
+  return true;
+}
+
+OutputSink::OutputSink(std::unique_ptr<raw_fd_ostream> out,
+                       std::unique_ptr<raw_fd_ostream> index, bool compress)
+    : m_out(std::move(out)), m_index(std::move(index)), m_compress(compress),
+      m_offset(0), m_done(false) {
+  m_writer = std::thread([this]() { run(); });
+}
+
+std::unique_ptr<OutputSink> OutputSink::open(const std::string &path) {
+  bool compress = StringRef(path).endswith(".gz");
+  if (compress && !zlib::isAvailable()) {
+    CLAM_WARNING("zlib is not available: " << path << " is not compressed");
+    compress = false;
+  }
+  std::error_code ec;
+  auto out = make_unique<raw_fd_ostream>(path, ec, sys::fs::F_None);
+  if (ec) {
+    CLAM_WARNING("cannot open " << path << ": " << ec.message());
+    return nullptr;
+  }
+  std::unique_ptr<raw_fd_ostream> index;
+  if (compress) {
+    index = make_unique<raw_fd_ostream>(path + ".idx", ec, sys::fs::F_Text);
+    if (ec) {
+      CLAM_WARNING("cannot open " << path << ".idx: " << ec.message());
+      index.reset();
+    }
+  }
+  std::unique_ptr<OutputSink> sink(
+      new OutputSink(std::move(out), std::move(index), compress));
+  std::lock_guard<std::mutex> lock(current_mutex);
+  current = sink.get();
+  return sink;
+}
+
+OutputSink::~OutputSink() {
+  {
+    std::lock_guard<std::mutex> lock(current_mutex);
+    if (current == this) {
+      current = nullptr;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_done = true;
+  }
+  m_added.notify_one();
+  m_writer.join();
+  m_out->flush();
+  if (m_index) {
+    m_index->flush();
+  }
+}
+
+OutputSink *OutputSink::get() {
+  std::lock_guard<std::mutex> lock(current_mutex);
+  return current;
+}
+
+void OutputSink::write(const std::string &kind, const std::string &fname,
+                       std::string data) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_removed.wait(lock,
+                 [this]() { return m_pending.size() < MAX_PENDING_FRAMES; });
+  m_pending.push_back({kind, fname, std::move(data)});
+  lock.unlock();
+  m_added.notify_one();
+}
+
+void OutputSink::run() {
+  while (true) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_added.wait(lock, [this]() { return m_done || !m_pending.empty(); });
+    if (m_pending.empty()) {
+      return;
+    }
+    frame_t frame = std::move(m_pending.front());
+    m_pending.pop_front();
+    lock.unlock();
+    m_removed.notify_all();
+    writeFrame(frame);
+  }
+}
+
+void OutputSink::writeFrame(const frame_t &frame) {
+  std::string member;
+  if (m_compress && mkGzipMember(frame.kind + ":" + frame.fname, frame.data,
+                                 member)) {
+    *m_out << member;
+    if (m_index) {
+      *m_index << m_offset << " " << member.size() << " " << frame.kind << " "
+               << frame.fname << "\n";
+    }
+    m_offset += member.size();
+  } else {
+    if (m_compress) {
+      CLAM_WARNING("cannot compress the " << frame.kind << " of " << frame.fname
+                   << ": the frame is written uncompressed");
+    }
+    *m_out << frame.data;
+    m_offset += frame.data.size();
+  }
+}
+
+} // end namespace clam
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace llvm {
+class raw_fd_ostream;
+} // namespace llvm
+
+namespace clam {
+
+/**
+ * File that receives the output printed per function
+ * (--crab-output-file): the CFGs of --crab-print-cfg and
+ * --crab-cfg-report and the invariants of --crab-print-invariants.
+ *
+ * Each call to write adds one frame, e.g., the invariants of one
+ * function. The frames are written by a background thread so the
+ * analysis is only blocked if too many frames are pending. If the
+ * file ends with .gz each frame is a gzip member, so the file can be
+ * read with zcat, and the position of each frame is written to
+ * <file>.idx as lines "<offset> <size> <kind> <function>" so that a
+ * consumer can decompress only the frames it needs. Without zlib the
+ * frames are written uncompressed.
+ *
+ * The frames of a function are in the order in which they are
+ * written but the functions analyzed by several threads are
+ * interleaved.
+ **/
+class OutputSink {
+public:
+  // Open the file and make it the current sink (see get). Return null
+  // and report a warning if it cannot be opened.
+  static std::unique_ptr<OutputSink> open(const std::string &path);
+
+  // The pending frames are written and the sink is no longer current
+  ~OutputSink();
+
+  // The current sink or null if the output goes to stdout
+  static OutputSink *get();
+
+  // Add the frame data of function fname. kind names its contents
+  // (e.g., "cfg" or "invariants"). Thread-safe.
+  void write(const std::string &kind, const std::string &fname,
+             std::string data);
+
+private:
+  struct frame_t {
+    std::string kind;
+    std::string fname;
+    std::string data;
+  };
+
+  std::unique_ptr<llvm::raw_fd_ostream> m_out;
+  std::unique_ptr<llvm::raw_fd_ostream> m_index;
+  bool m_compress;
+  uint64_t m_offset;
+  std::deque<frame_t> m_pending;
+  bool m_done;
+  std::mutex m_mutex;
+  // signaled when a frame is added or the sink is closed
+  std::condition_variable m_added;
+  // signaled when a frame is removed
+  std::condition_variable m_removed;
+  std::thread m_writer;
+
+  OutputSink(std::unique_ptr<llvm::raw_fd_ostream> out,
+             std::unique_ptr<llvm::raw_fd_ostream> index, bool compress);
+
+  void run();
+  void writeFrame(const frame_t &frame);
+};
+
+} // end namespace clam
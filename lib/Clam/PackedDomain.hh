@@ -0,0 +1,189 @@
+#pragma once
+
+/*
+ * packed_domain<Dom> behaves as Dom (a relational domain: octagons)
+ * but after each join and widening the variables of the packs that
+ * overflow --crab-pack-size (see VariablePacking) keep only their
+ * bounds: their relations with other variables are forgotten. The
+ * packs that fit are analyzed with the full precision of Dom and the
+ * others as with intervals, so the cost of Dom grows with the size of
+ * the packs that fit rather than with the number of variables.
+ *
+ * The variables are per thread so they are set before analyzing each
+ * function. The states that lost relations are added to ClamStats by
+ * flush():
+ *
+ *   Domain.Packs.Flattened     number of states whose relations
+ *                              with the overflowing variables were
+ *                              forgotten
+ */
+
+#include "clam/AbstractDomain.hh"
+#include "clam/crab/crab_domains.hh"
+#include "clam/Support/Stats.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace clam {
+
+namespace packed_domain_impl {
+
+  // sorted, empty if all the packs fit
+  inline std::vector<var_t> &overflow_vars() {
+    static thread_local std::vector<var_t> vars;
+    return vars;
+  }
+
+  struct stats_t {
+    uint64_t flattened;
+
+    stats_t(): flattened(0) {}
+
+    // Add the counters to ClamStats and reset them
+    void flush() {
+      if (flattened > 0) {
+	ClamStats::count("Domain.Packs.Flattened", flattened);
+      }
+      flattened = 0;
+    }
+  };
+
+  inline stats_t &get_stats() {
+    static thread_local stats_t stats;
+    return stats;
+  }
+
+} // end namespace packed_domain_impl
+
+// Domains whose packs are bounded (see AnalysisParams::pack_size)
+template<typename Dom>
+struct is_packed_domain: std::false_type {};
+template<>
+struct is_packed_domain<oct_domain_t>: std::true_type {};
+
+template<typename Dom>
+class packed_domain: public Dom {
+  typedef packed_domain<Dom> this_type;
+
+  static bool is_overflow_var(const var_t &v) {
+    const std::vector<var_t> &vars = packed_domain_impl::overflow_vars();
+    return std::binary_search(vars.begin(), vars.end(), v);
+  }
+
+  void flatten() {
+    using namespace packed_domain_impl;
+    const std::vector<var_t> &vars = overflow_vars();
+    if (vars.empty() || Dom::is_bottom() || Dom::is_top()) {
+      return;
+    }
+    // -- the bounds of the overflowing variables and whether one of
+    //    them is related with another variable
+    auto csts = Dom::to_linear_constraint_system();
+    lin_cst_sys_t bounds;
+    bool related = false;
+    for (auto const &cst: csts) {
+      unsigned n = 0;
+      bool overflow = false;
+      for (auto const &v: cst.variables()) {
+	overflow |= is_overflow_var(v);
+	++n;
+      }
+      if (!overflow) {
+	continue;
+      }
+      if (n == 1) {
+	bounds += cst;
+      } else {
+	related = true;
+      }
+    }
+    if (!related) {
+      return;
+    }
+    Dom::forget(vars);
+    Dom::operator+=(bounds);
+    get_stats().flattened++;
+  }
+
+public:
+  packed_domain(): Dom() {}
+
+  // implicit so that the operations inherited from Dom that return
+  // a Dom can be used as this type
+  packed_domain(const Dom &dom): Dom(dom) {}
+
+  static this_type top() { return this_type(Dom::top()); }
+
+  static this_type bottom() { return this_type(Dom::bottom()); }
+
+  const Dom &base() const { return *this; }
+
+  void operator|=(const this_type &o) {
+    Dom::operator|=(o);
+    flatten();
+  }
+
+  this_type operator|(const this_type &o) {
+    this_type res(Dom::operator|(o));
+    res.flatten();
+    return res;
+  }
+
+  this_type operator||(const this_type &o) {
+    this_type res(Dom::operator||(o));
+    res.flatten();
+    return res;
+  }
+
+  template<typename Thresholds>
+  this_type widening_thresholds(const this_type &o, const Thresholds &ts) {
+    this_type res(Dom::widening_thresholds(o, ts));
+    res.flatten();
+    return res;
+  }
+};
+
+// The invariants are wrapped and unwrapped as invariants of Dom
+template<typename Dom>
+inline GenericAbsDomWrapperPtr mkGenericAbsDomWrapper(packed_domain<Dom> abs_dom) {
+  return mkGenericAbsDomWrapper<Dom>(abs_dom.base());
+}
+
+template<typename Dom>
+inline void getAbsDomWrappee(GenericAbsDomWrapperPtr wrapper,
+			     packed_domain<Dom> &abs_dom) {
+  Dom base;
+  getAbsDomWrappee(wrapper, base);
+  abs_dom = base;
+}
+
+} // end namespace clam
+
+namespace crab {
+namespace domains {
+
+  // The checks are done as with Dom
+  template<typename Dom>
+  class checker_domain_traits<clam::packed_domain<Dom>> {
+  public:
+    template<typename Cst>
+    static bool entail(clam::packed_domain<Dom> &inv, const Cst &cst) {
+      return checker_domain_traits<Dom>::entail(inv, cst);
+    }
+
+    template<typename Cst>
+    static bool entail(const Cst &cst, clam::packed_domain<Dom> &inv) {
+      return checker_domain_traits<Dom>::entail(cst, inv);
+    }
+
+    template<typename Cst>
+    static bool intersect(clam::packed_domain<Dom> &inv, const Cst &cst) {
+      return checker_domain_traits<Dom>::intersect(inv, cst);
+    }
+  };
+
+} // end namespace domains
+} // end namespace crab
@@ -0,0 +1,185 @@
+#include "PrecisionSelection.hh"
+#include "CfgBuilderUtils.hh"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+using namespace crab::cfg;
+
+namespace clam {
+
+static unsigned rank(tracked_precision p) {
+  switch (p) {
+  case NUM:
+    return 0;
+  case PTR:
+    return 1;
+  default:
+    return 2;
+  }
+}
+
+static tracked_precision maxPrecision(tracked_precision a,
+                                      tracked_precision b) {
+  return rank(a) >= rank(b) ? a : b;
+}
+
+// The precision needed by the values the assertions of F depend on
+static tracked_precision neededByAsserts(const Function &F,
+                                         bool interprocedural) {
+  std::vector<const Value *> worklist;
+  for (auto &I : instructions(F)) {
+    ImmutableCallSite CS(&I);
+    if (!CS) {
+      continue;
+    }
+    const Function *callee = CS.getCalledFunction();
+    if (callee && isAssertFn(*callee)) {
+      worklist.insert(worklist.end(), CS.arg_begin(), CS.arg_end());
+    }
+  }
+  tracked_precision res = NUM;
+  SmallPtrSet<const Value *, 64> visited;
+  while (!worklist.empty() && res != ARR) {
+    const Value *v = worklist.back();
+    worklist.pop_back();
+    if (!visited.insert(v).second) {
+      continue;
+    }
+    if (v->getType()->isPointerTy()) {
+      res = maxPrecision(res, PTR);
+    }
+    if (auto *LI = dyn_cast<LoadInst>(v)) {
+      if (!LI->getType()->isPointerTy()) {
+        res = ARR;
+      }
+    } else if (auto *A = dyn_cast<Argument>(v)) {
+      if (!interprocedural) {
+        continue;
+      }
+      // -- the actual parameters of the direct callers
+      for (const Use &U : A->getParent()->uses()) {
+        ImmutableCallSite CS(U.getUser());
+        if (CS && CS.isCallee(&U) && A->getArgNo() < CS.arg_size()) {
+          worklist.push_back(CS.getArgument(A->getArgNo()));
+        }
+      }
+    } else if (auto *I = dyn_cast<Instruction>(v)) {
+      ImmutableCallSite CS(I);
+      if (CS) {
+        const Function *callee = CS.getCalledFunction();
+        if (interprocedural && callee && !callee->isDeclaration()) {
+          // -- the values returned by the callee
+          for (auto &B : *callee) {
+            if (auto *RI = dyn_cast<ReturnInst>(B.getTerminator())) {
+              if (const Value *RV = RI->getReturnValue()) {
+                worklist.push_back(RV);
+              }
+            }
+          }
+        }
+        continue;
+      }
+      worklist.insert(worklist.end(), I->op_begin(), I->op_end());
+    }
+  }
+  return res;
+}
+
+static bool accessesMemory(const Function &F) {
+  for (auto &I : instructions(F)) {
+    if (isa<LoadInst>(I) || isa<StoreInst>(I)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+PrecisionSelection::PrecisionSelection(const Module &M, tracked_precision max,
+                                       bool interprocedural, bool null_checks)
+    : m_max(max) {
+  std::vector<const Function *> funcs;
+  DenseMap<const Function *, unsigned> index;
+  for (auto &F : M) {
+    if (!F.isDeclaration()) {
+      index[&F] = funcs.size();
+      funcs.push_back(&F);
+    }
+  }
+  std::vector<tracked_precision> levels(funcs.size(), NUM);
+  for (unsigned i = 0; i < funcs.size(); ++i) {
+    tracked_precision p = neededByAsserts(*funcs[i], interprocedural);
+    if (null_checks && accessesMemory(*funcs[i])) {
+      p = maxPrecision(p, PTR);
+    }
+    levels[i] = (rank(p) <= rank(max) ? p : max);
+  }
+  if (interprocedural) {
+    // -- union-find of the functions connected by direct calls
+    std::vector<unsigned> parent(funcs.size());
+    for (unsigned i = 0; i < parent.size(); ++i) {
+      parent[i] = i;
+    }
+    auto find = [&parent](unsigned i) {
+      while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+      }
+      return i;
+    };
+    for (unsigned i = 0; i < funcs.size(); ++i) {
+      for (auto &I : instructions(*funcs[i])) {
+        ImmutableCallSite CS(&I);
+        if (!CS) {
+          continue;
+        }
+        auto it = index.find(CS.getCalledFunction());
+        if (it != index.end()) {
+          parent[find(i)] = find(it->second);
+        }
+      }
+    }
+    std::vector<tracked_precision> comp_levels(funcs.size(), NUM);
+    for (unsigned i = 0; i < funcs.size(); ++i) {
+      unsigned r = find(i);
+      comp_levels[r] = maxPrecision(comp_levels[r], levels[i]);
+    }
+    for (unsigned i = 0; i < funcs.size(); ++i) {
+      levels[i] = comp_levels[find(i)];
+    }
+  }
+  for (unsigned i = 0; i < funcs.size(); ++i) {
+    m_levels[funcs[i]] = levels[i];
+  }
+}
+
+tracked_precision PrecisionSelection::get(const Function &F) const {
+  auto it = m_levels.find(&F);
+  return it != m_levels.end() ? it->second : m_max;
+}
+
+const char *PrecisionSelection::name(tracked_precision p) {
+  switch (p) {
+  case NUM:
+    return "num";
+  case PTR:
+    return "ptr";
+  default:
+    return "arr";
+  }
+}
+
+void PrecisionSelection::write(raw_ostream &o) const {
+  o << "Tracked precision of the functions:\n";
+  for (auto &kv : m_levels) {
+    o << "  " << kv.first->getName() << ": " << name(kv.second) << "\n";
+  }
+}
+
+} // end namespace clam
@@ -0,0 +1,47 @@
+#pragma once
+
+/* Choice of the tracked precision of each function of a module */
+
+#include "clam/crab/crab_cfg.hh"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace clam {
+
+/*
+ * The precision of a function is the lowest level, up to max, with
+ * which the values its assertions depend on are translated:
+ *
+ *   - ARR if an assertion depends on an integer or Boolean loaded
+ *     from memory,
+ *   - PTR if an assertion depends on a pointer or if the null checks
+ *     are added and the function accesses memory,
+ *   - NUM otherwise.
+ *
+ * The dependencies follow the operands of the instructions. In the
+ * inter-procedural mode they also follow the values returned by the
+ * callees and the actual parameters of the callers, and all the
+ * functions connected by direct calls get the highest precision of
+ * them: the declarations of the callees must agree with the call
+ * sites of the callers.
+ */
+class PrecisionSelection {
+public:
+  PrecisionSelection(const llvm::Module &M, crab::cfg::tracked_precision max,
+                     bool interprocedural, bool null_checks);
+
+  crab::cfg::tracked_precision get(const llvm::Function &F) const;
+
+  void write(llvm::raw_ostream &o) const;
+
+  static const char *name(crab::cfg::tracked_precision p);
+
+private:
+  crab::cfg::tracked_precision m_max;
+  llvm::DenseMap<const llvm::Function *, crab::cfg::tracked_precision> m_levels;
+};
+
+} // end namespace clam
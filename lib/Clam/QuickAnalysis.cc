@@ -0,0 +1,122 @@
+#include "clam/QuickAnalysis.hh"
+#include "clam/CfgBuilder.hh"
+#include "clam/DummyHeapAbstraction.hh"
+#include "clam/HeapAbstraction.hh"
+#include "clam/Support/Stats.hh"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+
+#include <mutex>
+
+namespace clam {
+
+using namespace llvm;
+
+namespace {
+
+// Everything kept between the queries on a module
+struct module_entry_t {
+  // all the queries on the module are serialized
+  std::mutex mutex;
+  TargetLibraryInfoImpl tli_impl;
+  TargetLibraryInfo tli;
+  std::unique_ptr<CrabBuilderManager> man;
+
+  module_entry_t(const Module &M)
+      : tli_impl(Triple(M.getTargetTriple())), tli(tli_impl) {
+    reset(std::unique_ptr<HeapAbstraction>(new DummyHeapAbstraction()));
+  }
+
+  void reset(std::unique_ptr<HeapAbstraction> mem) {
+    CrabBuilderParams params;
+    // without regions the memory is not translated
+    params.precision_level =
+        (mem->getClassId() == HeapAbstraction::ClassId::DUMMY)
+            ? crab::cfg::NUM
+            : crab::cfg::ARR;
+    man.reset(new CrabBuilderManager(params, tli, std::move(mem)));
+  }
+};
+
+struct registry_t {
+  std::mutex mutex;
+  DenseMap<const Module *, std::shared_ptr<module_entry_t>> modules;
+};
+
+registry_t &getRegistry() {
+  static registry_t registry;
+  return registry;
+}
+
+std::shared_ptr<module_entry_t> getEntry(const Module &M) {
+  registry_t &r = getRegistry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  std::shared_ptr<module_entry_t> &entry = r.modules[&M];
+  if (!entry) {
+    entry = std::make_shared<module_entry_t>(M);
+  }
+  return entry;
+}
+
+} // end namespace
+
+QuickAnalysisResult quickAnalyze(const Function &fun, CrabDomain dom,
+                                 double budget) {
+  ScopedClamStats __st__("QuickAnalysis");
+  std::shared_ptr<module_entry_t> entry = getEntry(*fun.getParent());
+  std::lock_guard<std::mutex> lock(entry->mutex);
+  CrabBuilderManager &man = *entry->man;
+
+  QuickAnalysisResult res;
+  if (!fun.isDeclaration()) {
+    bool rebuilt = true;
+    man.rebuild(fun, rebuilt);
+    res.reused_cfg = !rebuilt;
+  }
+  ClamStats::count(res.reused_cfg ? "QuickAnalysis.ReusedCfgs"
+                                  : "QuickAnalysis.BuiltCfgs");
+
+  AnalysisParams params;
+  params.dom = dom;
+  params.check = ASSERTION;
+  params.max_estimated_cost = budget;
+  IntraClam ic(fun, man);
+  ic.analyze(params);
+  ic.get_pre_all(
+      [&res](const BasicBlock &b, IntraClam::wrapper_dom_ptr inv) {
+        if (inv) {
+          res.pre.insert({&b, inv});
+        }
+      });
+  res.checks = ic.get_checks_db();
+  return res;
+}
+
+void quickSetHeapAbstraction(const Module &M,
+                             std::unique_ptr<HeapAbstraction> mem) {
+  std::shared_ptr<module_entry_t> entry = getEntry(M);
+  std::lock_guard<std::mutex> lock(entry->mutex);
+  entry->reset(std::move(mem));
+}
+
+void quickRelease(const Module &M) {
+  registry_t &r = getRegistry();
+  std::shared_ptr<module_entry_t> entry;
+  {
+    std::lock_guard<std::mutex> lock(r.mutex);
+    auto it = r.modules.find(&M);
+    if (it == r.modules.end()) {
+      return;
+    }
+    entry = it->second;
+    r.modules.erase(it);
+  }
+  // -- wait for the query in progress, if any
+  std::lock_guard<std::mutex> lock(entry->mutex);
+}
+
+} // end namespace clam
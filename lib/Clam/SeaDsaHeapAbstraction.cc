@@ -10,6 +10,7 @@
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/TypeFinder.h"
 #include "llvm/IR/Value.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -24,13 +25,39 @@
 #include "crab/common/debug.hpp"
 
 #include <algorithm>
-#include <set>
+#include <atomic>
+#include <thread>
 
 namespace clam {
 
 using namespace sea_dsa;
 using namespace llvm;
 
+// return v1 \ v2 preserving the order of v1
+static HeapAbstraction::RegionVec
+regionDifference(const HeapAbstraction::RegionVec &v1,
+                 const HeapAbstraction::RegionVec &v2) {
+  HeapAbstraction::RegionSet s2 = HeapAbstraction::toRegionSet(v2);
+  HeapAbstraction::RegionVec out;
+  out.reserve(v1.size());
+  for (unsigned i = 0, e = v1.size(); i < e; ++i) {
+    if (!s2.test(v1[i].get_id())) {
+      out.push_back(v1[i]);
+    }
+  }
+  return out;
+}
+
+// return the regions of key in map without inserting key
+template <typename Map, typename Key>
+static HeapAbstraction::RegionRef lookupRegions(const Map &map, const Key *key) {
+  auto it = map.find(key);
+  if (it == map.end()) {
+    return HeapAbstraction::RegionRef();
+  }
+  return it->second;
+}
+
 Region LegacySeaDsaHeapAbstraction::mkRegion(const Cell &c, RegionInfo ri) {
   auto id = getId(c);
   return Region(id, ri, getSingleton(id));
@@ -67,11 +94,27 @@ LegacySeaDsaHeapAbstraction::getId(const Cell &c) {
   return id + offset;
 }
 
-// compute and cache the set of read, mod and new nodes of a whole
-// function such that mod nodes are a subset of the read nodes and
-// the new nodes are disjoint from mod nodes.
-void LegacySeaDsaHeapAbstraction::computeReadModNewNodes(
-    const llvm::Function &f) {
+// Regions of a function or a callsite in the order in which they are
+// found in the sea-dsa graphs. Their ids are assigned later so that
+// they can be collected in parallel.
+struct LegacySeaDsaHeapAbstraction::PendingRegions {
+  struct Entry {
+    Cell cell;
+    RegionInfo info;
+    bool is_read;
+    bool is_mod;
+    bool is_new;
+    // whether caller and callee agree on the region (only callsites)
+    bool is_consistent;
+  };
+  // false if there are no regions to cache
+  bool valid = false;
+  std::vector<Entry> entries;
+};
+
+// collect the read, mod and new nodes of a whole function
+void LegacySeaDsaHeapAbstraction::collectReadModNewNodes(
+    const llvm::Function &f, PendingRegions &regions) const {
 
   if (!m_dsa || !(m_dsa->hasGraph(f))) {
     return;
@@ -86,7 +129,7 @@ void LegacySeaDsaHeapAbstraction::computeReadModNewNodes(
   seadsa_heap_abs_impl::NodeSet reach, retReach;
   seadsa_heap_abs_impl::argReachableNodes(f, G, reach, retReach);
 
-  RegionVec reads, mods, news;
+  regions.valid = true;
   for (const Node *n : reach) {
     if (!n->isRead() && !n->isModified()) {
       continue;
@@ -105,30 +148,20 @@ void LegacySeaDsaHeapAbstraction::computeReadModNewNodes(
 		    m_disambiguate_ptr_cast, m_disambiguate_external);
 
       if (r_info.get_type() != UNTYPED_REGION) {
-        Region reg(mkRegion(c, r_info));
-        if ((n->isRead() || n->isModified()) && !retReach.count(n)) {
-          reads.push_back(reg);
-        }
-        if (n->isModified() && !retReach.count(n)) {
-          mods.push_back(reg);
-        }
-        if (n->isModified() && retReach.count(n)) {
-          news.push_back(reg);
-        }
+        bool is_ret = retReach.count(n);
+        regions.entries.push_back({c, r_info,
+                                   (n->isRead() || n->isModified()) && !is_ret,
+                                   n->isModified() && !is_ret,
+                                   n->isModified() && is_ret,
+                                   true});
       }
     }
   }
-  m_func_accessed[&f] = reads;
-  m_func_mods[&f] = mods;
-  m_func_news[&f] = news;
 }
 
-// Compute and cache the set of read, mod and new nodes of a
-// callsite such that mod nodes are a subset of the read nodes and
-// the new nodes are disjoint from mod nodes.
-void LegacySeaDsaHeapAbstraction::computeReadModNewNodesFromCallSite(
-    const llvm::CallInst &I, callsite_map_t &accessed_map,
-    callsite_map_t &mods_map, callsite_map_t &news_map) {
+// collect the read, mod and new nodes of a callsite
+void LegacySeaDsaHeapAbstraction::collectReadModNewNodesFromCallSite(
+    const llvm::CallInst &I, PendingRegions &regions) const {
   if (!m_dsa)
     return;
 
@@ -165,7 +198,7 @@ void LegacySeaDsaHeapAbstraction::computeReadModNewNodesFromCallSite(
   SimulationMapper simMap;
   Graph::computeCalleeCallerMapping(CS, calleeG, callerG, simMap);
 
-  std::vector<region_bool_t> reads, mods, news;
+  regions.valid = true;
   for (const Node *n : reach) {
     if (!n->isRead() && !n->isModified())
       continue;
@@ -211,16 +244,12 @@ void LegacySeaDsaHeapAbstraction::computeReadModNewNodesFromCallSite(
          * regions are exposed to clients.
          **/
         bool is_consistent_callsite = (calleeRI == callerRI);
-        Region reg(mkRegion(callerC, calleeRI));
-        if ((n->isRead() || n->isModified()) && !retReach.count(n)) {
-          reads.push_back({reg, is_consistent_callsite});
-        }
-        if (n->isModified() && !retReach.count(n)) {
-          mods.push_back({reg, is_consistent_callsite});
-        }
-        if (n->isModified() && retReach.count(n)) {
-          news.push_back({reg, is_consistent_callsite});
-        }
+        bool is_ret = retReach.count(n);
+        regions.entries.push_back({callerC, calleeRI,
+                                   (n->isRead() || n->isModified()) && !is_ret,
+                                   n->isModified() && !is_ret,
+                                   n->isModified() && is_ret,
+                                   is_consistent_callsite});
       } else {
         // if a callee's region is untyped then we should be ok
         // because when we extract regions from the function
@@ -232,7 +261,57 @@ void LegacySeaDsaHeapAbstraction::computeReadModNewNodesFromCallSite(
   // -- add the region of the lhs of the call site
   // Region ret = getRegion(*(I.getParent()->getParent()), &I, &I);
   // if (!ret.isUnknown()) mods.push_back(ret);
+}
 
+// compute and cache the set of read, mod and new nodes of a whole
+// function such that mod nodes are a subset of the read nodes and
+// the new nodes are disjoint from mod nodes.
+void LegacySeaDsaHeapAbstraction::computeReadModNewNodes(
+    const llvm::Function &f, const PendingRegions &regions) {
+  if (!regions.valid) {
+    return;
+  }
+  RegionVec reads, mods, news;
+  for (auto &e : regions.entries) {
+    Region reg(mkRegion(e.cell, e.info));
+    if (e.is_read) {
+      reads.push_back(reg);
+    }
+    if (e.is_mod) {
+      mods.push_back(reg);
+    }
+    if (e.is_new) {
+      news.push_back(reg);
+    }
+  }
+  m_func_accessed[&f] = reads;
+  m_func_mods[&f] = mods;
+  m_func_news[&f] = news;
+}
+
+// Compute and cache the set of read, mod and new nodes of a
+// callsite such that mod nodes are a subset of the read nodes and
+// the new nodes are disjoint from mod nodes.
+void LegacySeaDsaHeapAbstraction::computeReadModNewNodesFromCallSite(
+    const llvm::CallInst &I, const PendingRegions &regions,
+    callsite_map_t &accessed_map, callsite_map_t &mods_map,
+    callsite_map_t &news_map) {
+  if (!regions.valid) {
+    return;
+  }
+  std::vector<region_bool_t> reads, mods, news;
+  for (auto &e : regions.entries) {
+    Region reg(mkRegion(e.cell, e.info));
+    if (e.is_read) {
+      reads.push_back({reg, e.is_consistent});
+    }
+    if (e.is_mod) {
+      mods.push_back({reg, e.is_consistent});
+    }
+    if (e.is_new) {
+      news.push_back({reg, e.is_consistent});
+    }
+  }
   accessed_map[&I] = reads;
   mods_map[&I] = mods;
   news_map[&I] = news;
@@ -254,17 +333,65 @@ void LegacySeaDsaHeapAbstraction::initialize(const llvm::Module &M) {
     }
   });
 
-  callsite_map_t cs_accessed, cs_mods, cs_news;
+  // -- collect the regions of each function and its callsites. The
+  //    sea-dsa graphs are only read so functions are independent.
+  std::vector<const Function *> funcs;
   for (auto const &F : M) {
-    computeReadModNewNodes(F);
-    auto InstIt = inst_begin(F), InstItEnd = inst_end(F);
-    for (; InstIt != InstItEnd; ++InstIt) {
-      if (const llvm::CallInst *Call =
-              llvm::dyn_cast<llvm::CallInst>(&*InstIt)) {
-        computeReadModNewNodesFromCallSite(*Call, cs_accessed, cs_mods,
-                                           cs_news);
+    funcs.push_back(&F);
+  }
+  using callsite_regions_t =
+      std::vector<std::pair<const CallInst *, PendingRegions>>;
+  std::vector<PendingRegions> func_regions(funcs.size());
+  std::vector<callsite_regions_t> callsite_regions(funcs.size());
+  std::atomic<unsigned> next(0);
+  auto worker = [&]() {
+    for (unsigned i = next++; i < funcs.size(); i = next++) {
+      collectReadModNewNodes(*funcs[i], func_regions[i]);
+      for (auto &I : instructions(*funcs[i])) {
+        if (const CallInst *Call = dyn_cast<CallInst>(&I)) {
+          callsite_regions[i].emplace_back(Call, PendingRegions());
+          collectReadModNewNodesFromCallSite(*Call,
+                                             callsite_regions[i].back().second);
+        }
       }
     }
+  };
+
+  unsigned num_threads = std::min(m_num_threads, (unsigned)funcs.size());
+  if (num_threads <= 1) {
+    worker();
+  } else {
+    CRAB_VERBOSE_IF(1, crab::get_msg_stream()
+                           << "Computing memory regions of " << funcs.size()
+                           << " functions with " << num_threads
+                           << " threads\n";);
+    // DataLayout computes lazily the layout of struct types
+    TypeFinder struct_types;
+    struct_types.run(M, false);
+    for (StructType *ty : struct_types) {
+      if (!ty->isOpaque() && ty->isSized()) {
+        m_dl.getStructLayout(ty);
+      }
+    }
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads);
+    for (unsigned i = 0; i < num_threads; ++i) {
+      workers.emplace_back(worker);
+    }
+    for (auto &t : workers) {
+      t.join();
+    }
+  }
+
+  // -- assign region ids following the order of the module so that
+  //    they do not depend on the number of threads.
+  callsite_map_t cs_accessed, cs_mods, cs_news;
+  for (unsigned i = 0, e = funcs.size(); i < e; ++i) {
+    computeReadModNewNodes(*funcs[i], func_regions[i]);
+    for (auto &kv : callsite_regions[i]) {
+      computeReadModNewNodesFromCallSite(*kv.first, kv.second, cs_accessed,
+                                         cs_mods, cs_news);
+    }
   }
 
   for (auto const &F : M) {
@@ -376,6 +503,15 @@ void LegacySeaDsaHeapAbstraction::initialize(const llvm::Module &M) {
     }
   }
 
+  // -- only read regions are cached so that queries don't need to
+  // -- compute them
+  for (auto &kv : m_func_accessed) {
+    m_func_only_reads[kv.first] = regionDifference(kv.second, m_func_mods[kv.first]);
+  }
+  for (auto &kv : m_callsite_accessed) {
+    m_callsite_only_reads[kv.first] =
+        regionDifference(kv.second, m_callsite_mods[kv.first]);
+  }
 }
 
 LegacySeaDsaHeapAbstraction::LegacySeaDsaHeapAbstraction(
@@ -383,12 +519,14 @@ LegacySeaDsaHeapAbstraction::LegacySeaDsaHeapAbstraction(
     const llvm::TargetLibraryInfo &tli,
     const sea_dsa::AllocWrapInfo &alloc_info, bool is_context_sensitive,
     bool disambiguate_for_array_smashing, bool disambiguate_unknown,
-    bool disambiguate_ptr_cast, bool disambiguate_external)
+    bool disambiguate_ptr_cast, bool disambiguate_external,
+    unsigned num_threads)
     : m_dsa(nullptr), m_fac(nullptr), m_dl(dl), m_max_id(0),
       m_disambiguate_for_array_smashing(disambiguate_for_array_smashing),
       m_disambiguate_unknown(disambiguate_unknown),
       m_disambiguate_ptr_cast(disambiguate_ptr_cast),
-      m_disambiguate_external(disambiguate_external) {
+      m_disambiguate_external(disambiguate_external),
+      m_num_threads(num_threads) {
 
   // The factory must be alive while sea_dsa is in use
   m_fac = new SetFactory();
@@ -411,12 +549,14 @@ LegacySeaDsaHeapAbstraction::LegacySeaDsaHeapAbstraction(
     const llvm::Module &M, const llvm::DataLayout &dl,
     sea_dsa::GlobalAnalysis &dsa, 
     bool disambiguate_for_array_smashing, bool disambiguate_unknown,
-    bool disambiguate_ptr_cast, bool disambiguate_external)
+    bool disambiguate_ptr_cast, bool disambiguate_external,
+    unsigned num_threads)
     : m_dsa(&dsa), m_fac(nullptr), m_dl(dl), m_max_id(0),
       m_disambiguate_for_array_smashing(disambiguate_for_array_smashing),
       m_disambiguate_unknown(disambiguate_unknown),
       m_disambiguate_ptr_cast(disambiguate_ptr_cast),
-      m_disambiguate_external(disambiguate_external) {
+      m_disambiguate_external(disambiguate_external),
+      m_num_threads(num_threads) {
 
   initialize(M);
 }
@@ -480,17 +620,24 @@ Region LegacySeaDsaHeapAbstraction::getRegion(const llvm::Function &fn,
     return Region();
   }
 
+  auto key = std::make_pair((const Node *)c.getNode(), c.getOffset());
+  auto it = m_cell_regions.find(key);
+  if (it != m_cell_regions.end()) {
+    return it->second;
+  }
+
   RegionInfo r_info =
       DsaToRegion(c, m_dl, true /*split_dsa_nodes*/,
 		  m_disambiguate_for_array_smashing,
 		  m_disambiguate_unknown,
 		  m_disambiguate_ptr_cast, m_disambiguate_external);
 
-  if (r_info.get_type() == UNTYPED_REGION) {
-    return Region();
-  } else {
-    return mkRegion(c, r_info);
+  Region res;
+  if (r_info.get_type() != UNTYPED_REGION) {
+    res = mkRegion(c, r_info);
   }
+  m_cell_regions.insert({key, res});
+  return res;
 }
 
 const llvm::Value *
@@ -514,66 +661,90 @@ LegacySeaDsaHeapAbstraction::getSingleton(RegionId region) const {
 
 LegacySeaDsaHeapAbstraction::RegionVec
 LegacySeaDsaHeapAbstraction::getAccessedRegions(const llvm::Function &fn) {
-  return m_func_accessed[&fn];
+  RegionRef regions = getAccessedRegionsRef(fn);
+  return RegionVec(regions.begin(), regions.end());
 }
 
 LegacySeaDsaHeapAbstraction::RegionVec
 LegacySeaDsaHeapAbstraction::getOnlyReadRegions(const llvm::Function &fn) {
-  RegionVec v1 = m_func_accessed[&fn];
-  RegionVec v2 = m_func_mods[&fn];
-  std::set<Region> s2(v2.begin(), v2.end());
-
-  // return v1 \ s2
-  RegionVec out;
-  out.reserve(v1.size());
-  for (unsigned i = 0, e = v1.size(); i < e; ++i) {
-    if (!s2.count(v1[i])) {
-      out.push_back(v1[i]);
-    }
-  }
-  return out;
+  RegionRef regions = getOnlyReadRegionsRef(fn);
+  return RegionVec(regions.begin(), regions.end());
 }
 
 LegacySeaDsaHeapAbstraction::RegionVec
 LegacySeaDsaHeapAbstraction::getModifiedRegions(const llvm::Function &fn) {
-  return m_func_mods[&fn];
+  RegionRef regions = getModifiedRegionsRef(fn);
+  return RegionVec(regions.begin(), regions.end());
 }
 
 LegacySeaDsaHeapAbstraction::RegionVec
 LegacySeaDsaHeapAbstraction::getNewRegions(const llvm::Function &fn) {
-  return m_func_news[&fn];
+  RegionRef regions = getNewRegionsRef(fn);
+  return RegionVec(regions.begin(), regions.end());
 }
 
 LegacySeaDsaHeapAbstraction::RegionVec
 LegacySeaDsaHeapAbstraction::getAccessedRegions(const llvm::CallInst &I) {
-  return m_callsite_accessed[&I];
+  RegionRef regions = getAccessedRegionsRef(I);
+  return RegionVec(regions.begin(), regions.end());
 }
 
 LegacySeaDsaHeapAbstraction::RegionVec
 LegacySeaDsaHeapAbstraction::getOnlyReadRegions(const llvm::CallInst &I) {
-  RegionVec v1 = m_callsite_accessed[&I];
-  RegionVec v2 = m_callsite_mods[&I];
-  std::set<Region> s2(v2.begin(), v2.end());
-
-  // return v1 \ s2
-  RegionVec out;
-  out.reserve(v1.size());
-  for (unsigned i = 0, e = v1.size(); i < e; ++i) {
-    if (!s2.count(v1[i])) {
-      out.push_back(v1[i]);
-    }
-  }
-  return out;
+  RegionRef regions = getOnlyReadRegionsRef(I);
+  return RegionVec(regions.begin(), regions.end());
 }
 
 LegacySeaDsaHeapAbstraction::RegionVec
 LegacySeaDsaHeapAbstraction::getModifiedRegions(const llvm::CallInst &I) {
-  return m_callsite_mods[&I];
+  RegionRef regions = getModifiedRegionsRef(I);
+  return RegionVec(regions.begin(), regions.end());
 }
 
 LegacySeaDsaHeapAbstraction::RegionVec
 LegacySeaDsaHeapAbstraction::getNewRegions(const llvm::CallInst &I) {
-  return m_callsite_news[&I];
+  RegionRef regions = getNewRegionsRef(I);
+  return RegionVec(regions.begin(), regions.end());
+}
+
+LegacySeaDsaHeapAbstraction::RegionRef
+LegacySeaDsaHeapAbstraction::getAccessedRegionsRef(const llvm::Function &fn) {
+  return lookupRegions(m_func_accessed, &fn);
+}
+
+LegacySeaDsaHeapAbstraction::RegionRef
+LegacySeaDsaHeapAbstraction::getOnlyReadRegionsRef(const llvm::Function &fn) {
+  return lookupRegions(m_func_only_reads, &fn);
+}
+
+LegacySeaDsaHeapAbstraction::RegionRef
+LegacySeaDsaHeapAbstraction::getModifiedRegionsRef(const llvm::Function &fn) {
+  return lookupRegions(m_func_mods, &fn);
+}
+
+LegacySeaDsaHeapAbstraction::RegionRef
+LegacySeaDsaHeapAbstraction::getNewRegionsRef(const llvm::Function &fn) {
+  return lookupRegions(m_func_news, &fn);
+}
+
+LegacySeaDsaHeapAbstraction::RegionRef
+LegacySeaDsaHeapAbstraction::getAccessedRegionsRef(const llvm::CallInst &I) {
+  return lookupRegions(m_callsite_accessed, &I);
+}
+
+LegacySeaDsaHeapAbstraction::RegionRef
+LegacySeaDsaHeapAbstraction::getOnlyReadRegionsRef(const llvm::CallInst &I) {
+  return lookupRegions(m_callsite_only_reads, &I);
+}
+
+LegacySeaDsaHeapAbstraction::RegionRef
+LegacySeaDsaHeapAbstraction::getModifiedRegionsRef(const llvm::CallInst &I) {
+  return lookupRegions(m_callsite_mods, &I);
+}
+
+LegacySeaDsaHeapAbstraction::RegionRef
+LegacySeaDsaHeapAbstraction::getNewRegionsRef(const llvm::CallInst &I) {
+  return lookupRegions(m_callsite_news, &I);
 }
 
 } // namespace clam
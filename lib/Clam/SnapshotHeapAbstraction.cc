@@ -0,0 +1,481 @@
+#include "clam/SnapshotHeapAbstraction.hh"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "clam/Support/Debug.hh"
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Format of a snapshot (all integers are little-endian):
+ *
+ *   "CLAMHEAP" <u32 version> <string key>
+ *   <u32 #globals> <u32 #functions>
+ *   for each function in module order:
+ *     <u32 #args> <u32 #instructions>
+ *     <regions accessed> <regions only-read> <regions mod> <regions new>
+ *     <u32 n> n x <value>                        (base pointers)
+ *     <u32 n> n x <u32 inst> <value> <region>    (regions of pointers)
+ *     <u32 n> n x <u32 inst> 4 x <regions>       (regions of callsites)
+ *
+ *   string  := <u32 n> n x <u8>
+ *   regions := <u32 n> n x <region>
+ *   region  := <u64 id> <u8 type> <u32 bitwidth> <value singleton>
+ *   value   := <u8 kind> <u32 index>
+ *
+ * where kind is none, the index-th argument or instruction of the
+ * function, or the index-th global value of the module.
+ */
+
+namespace clam {
+
+using namespace llvm;
+
+static const char SNAPSHOT_MAGIC[] = "CLAMHEAP";
+static const uint32_t SNAPSHOT_VERSION = 1;
+
+namespace {
+
+enum ValueKind : uint8_t { NONE_VAL = 0, ARG_VAL, INST_VAL, GLOBAL_VAL };
+
+/* Map LLVM values from/to a position-based reference */
+class ValueNumbering {
+  DenseMap<const Value *, std::pair<ValueKind, uint32_t>> m_refs;
+  std::vector<const Value *> m_globals;
+  std::vector<const Value *> m_args;
+  std::vector<const Instruction *> m_insts;
+
+public:
+  ValueNumbering(const Module &M) {
+    for (auto &gv : M.global_values()) {
+      m_refs[&gv] = {GLOBAL_VAL, (uint32_t)m_globals.size()};
+      m_globals.push_back(&gv);
+    }
+  }
+
+  // number also the values of F (it forgets the previous function)
+  void setFunction(const Function &F) {
+    for (auto v : m_args) {
+      m_refs.erase(v);
+    }
+    for (auto v : m_insts) {
+      m_refs.erase(v);
+    }
+    m_args.clear();
+    m_insts.clear();
+    for (auto &a : F.args()) {
+      m_refs[&a] = {ARG_VAL, (uint32_t)m_args.size()};
+      m_args.push_back(&a);
+    }
+    for (auto &I : instructions(F)) {
+      m_refs[&I] = {INST_VAL, (uint32_t)m_insts.size()};
+      m_insts.push_back(&I);
+    }
+  }
+
+  bool getRef(const Value *v, ValueKind &kind, uint32_t &idx) const {
+    auto it = v ? m_refs.find(v) : m_refs.end();
+    if (it == m_refs.end()) {
+      return false;
+    }
+    kind = it->second.first;
+    idx = it->second.second;
+    return true;
+  }
+
+  // return false if the reference is not valid
+  bool getValue(ValueKind kind, uint32_t idx, const Value *&v) const {
+    v = nullptr;
+    switch (kind) {
+    case NONE_VAL:
+      return true;
+    case ARG_VAL:
+      if (idx < m_args.size()) v = m_args[idx];
+      break;
+    case INST_VAL:
+      if (idx < m_insts.size()) v = m_insts[idx];
+      break;
+    case GLOBAL_VAL:
+      if (idx < m_globals.size()) v = m_globals[idx];
+      break;
+    }
+    return v != nullptr;
+  }
+
+  const Instruction *getInst(uint32_t idx) const {
+    return (idx < m_insts.size() ? m_insts[idx] : nullptr);
+  }
+
+  size_t numGlobals() const { return m_globals.size(); }
+  size_t numArgs() const { return m_args.size(); }
+  size_t numInsts() const { return m_insts.size(); }
+};
+
+class Writer {
+  std::string &m_buf;
+
+public:
+  Writer(std::string &buf) : m_buf(buf) {}
+
+  void u8(uint8_t v) { m_buf.push_back((char)v); }
+
+  void u32(uint32_t v) {
+    for (unsigned i = 0; i < 4; ++i) {
+      u8((v >> (8 * i)) & 0xff);
+    }
+  }
+
+  void u64(uint64_t v) {
+    for (unsigned i = 0; i < 8; ++i) {
+      u8((v >> (8 * i)) & 0xff);
+    }
+  }
+
+  void str(StringRef s) {
+    u32(s.size());
+    m_buf.append(s.begin(), s.end());
+  }
+
+  void value(const ValueNumbering &vn, const Value *v) {
+    ValueKind kind = NONE_VAL;
+    uint32_t idx = 0;
+    if (!vn.getRef(v, kind, idx)) {
+      kind = NONE_VAL;
+      idx = 0;
+    }
+    u8(kind);
+    u32(idx);
+  }
+
+  void region(const ValueNumbering &vn, const Region &r) {
+    u64(r.get_id());
+    u8(r.getRegionInfo().get_type());
+    u32(r.getRegionInfo().get_bitwidth());
+    value(vn, r.getSingleton());
+  }
+
+  void regions(const ValueNumbering &vn, ArrayRef<Region> rs) {
+    u32(rs.size());
+    for (auto &r : rs) {
+      region(vn, r);
+    }
+  }
+};
+
+class Reader {
+  StringRef m_buf;
+  size_t m_pos;
+  bool m_ok;
+
+public:
+  Reader(StringRef buf) : m_buf(buf), m_pos(0), m_ok(true) {}
+
+  bool ok() const { return m_ok; }
+
+  void fail() { m_ok = false; }
+
+  bool atEnd() const { return m_pos == m_buf.size(); }
+
+  uint8_t u8() {
+    if (m_pos >= m_buf.size()) {
+      m_ok = false;
+      return 0;
+    }
+    return (uint8_t)m_buf[m_pos++];
+  }
+
+  uint32_t u32() {
+    uint32_t v = 0;
+    for (unsigned i = 0; i < 4; ++i) {
+      v |= ((uint32_t)u8()) << (8 * i);
+    }
+    return v;
+  }
+
+  uint64_t u64() {
+    uint64_t v = 0;
+    for (unsigned i = 0; i < 8; ++i) {
+      v |= ((uint64_t)u8()) << (8 * i);
+    }
+    return v;
+  }
+
+  std::string str() {
+    uint32_t n = u32();
+    if (!m_ok || n > m_buf.size() - m_pos) {
+      m_ok = false;
+      return "";
+    }
+    std::string s = m_buf.substr(m_pos, n).str();
+    m_pos += n;
+    return s;
+  }
+
+  const Value *value(const ValueNumbering &vn) {
+    uint8_t kind = u8();
+    uint32_t idx = u32();
+    const Value *v = nullptr;
+    if (kind > GLOBAL_VAL || !vn.getValue((ValueKind)kind, idx, v)) {
+      m_ok = false;
+    }
+    return v;
+  }
+
+  Region region(const ValueNumbering &vn) {
+    uint64_t id = u64();
+    uint8_t ty = u8();
+    uint32_t bitwidth = u32();
+    const Value *singleton = value(vn);
+    if (ty > PTR_REGION) {
+      m_ok = false;
+      return Region();
+    }
+    return Region(id, RegionInfo((region_type_t)ty, bitwidth), singleton);
+  }
+
+  HeapAbstraction::RegionVec regions(const ValueNumbering &vn) {
+    HeapAbstraction::RegionVec res;
+    uint32_t n = u32();
+    for (uint32_t i = 0; i < n && m_ok; ++i) {
+      res.push_back(region(vn));
+    }
+    return res;
+  }
+};
+
+} // end namespace
+
+std::unique_ptr<SnapshotHeapAbstraction>
+SnapshotHeapAbstraction::record(const Module &M, HeapAbstraction &mem) {
+  std::unique_ptr<SnapshotHeapAbstraction> res(new SnapshotHeapAbstraction(M));
+  for (auto &F : M) {
+    Regions &fr = res->m_regions[&F];
+    fr.vecs[ACCESSED] = mem.getAccessedRegionsRef(F).vec();
+    fr.vecs[ONLY_READ] = mem.getOnlyReadRegionsRef(F).vec();
+    fr.vecs[MODIFIED] = mem.getModifiedRegionsRef(F).vec();
+    fr.vecs[NEW] = mem.getNewRegionsRef(F).vec();
+    for (auto &I : instructions(F)) {
+      HeapAbstraction::forEachPointer(I, [&](const Value *v) {
+        Region r = mem.getRegion(F, &I, v);
+        if (!r.isUnknown()) {
+          res->m_value_regions[{&I, v}] = r;
+        }
+        if (mem.isBasePtr(F, v)) {
+          res->m_base_ptrs.insert({&F, v});
+        }
+      });
+      if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
+        Regions &cr = res->m_regions[CI];
+        cr.vecs[ACCESSED] = mem.getAccessedRegionsRef(*CI).vec();
+        cr.vecs[ONLY_READ] = mem.getOnlyReadRegionsRef(*CI).vec();
+        cr.vecs[MODIFIED] = mem.getModifiedRegionsRef(*CI).vec();
+        cr.vecs[NEW] = mem.getNewRegionsRef(*CI).vec();
+      }
+    }
+  }
+  res->initRegionSets();
+  return res;
+}
+
+void SnapshotHeapAbstraction::initRegionSets() {
+  for (auto &kv : m_regions) {
+    for (unsigned q = 0; q < NUM_QUERIES; ++q) {
+      kv.second.sets[q] = toRegionSet(kv.second.vecs[q]);
+    }
+  }
+}
+
+bool SnapshotHeapAbstraction::isBasePtr(const Function &F, const Value *V) {
+  return m_base_ptrs.count({&F, V}) > 0;
+}
+
+Region SnapshotHeapAbstraction::getRegion(const Function &fun,
+                                          const Instruction *i,
+                                          const Value *ptr) {
+  auto it = m_value_regions.find({i, ptr});
+  return (it != m_value_regions.end() ? it->second : Region());
+}
+
+std::string SnapshotHeapAbstraction::getKey(const Module &M,
+                                            const std::string &options_str) {
+  SmallString<0> bitcode;
+  raw_svector_ostream os(bitcode);
+  WriteBitcodeToFile(&M, os);
+  MD5 hash;
+  hash.update(bitcode.str());
+  hash.update(options_str);
+  MD5::MD5Result result;
+  hash.final(result);
+  SmallString<32> res;
+  MD5::stringifyResult(result, res);
+  return res.str();
+}
+
+bool SnapshotHeapAbstraction::write(const std::string &file,
+                                    const std::string &key) const {
+  std::string buf;
+  Writer w(buf);
+  ValueNumbering vn(m_M);
+  buf.append(SNAPSHOT_MAGIC);
+  w.u32(SNAPSHOT_VERSION);
+  w.str(key);
+  w.u32(vn.numGlobals());
+  w.u32(m_M.size());
+  for (auto &F : m_M) {
+    vn.setFunction(F);
+    w.u32(vn.numArgs());
+    w.u32(vn.numInsts());
+    for (unsigned q = 0; q < NUM_QUERIES; ++q) {
+      w.regions(vn, getRegions((Query)q, &F));
+    }
+
+    std::vector<const Value *> base_ptrs;
+    std::vector<std::pair<uint32_t, std::pair<const Value *, Region>>> regions;
+    std::vector<std::pair<uint32_t, const CallInst *>> callsites;
+    DenseSet<const Value *> seen;
+    uint32_t idx = 0;
+    for (auto &I : instructions(F)) {
+      HeapAbstraction::forEachPointer(I, [&](const Value *v) {
+        if (m_base_ptrs.count({&F, v}) && seen.insert(v).second) {
+          base_ptrs.push_back(v);
+        }
+        auto it = m_value_regions.find({&I, v});
+        if (it != m_value_regions.end()) {
+          regions.push_back({idx, {v, it->second}});
+        }
+      });
+      if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
+        callsites.push_back({idx, CI});
+      }
+      ++idx;
+    }
+
+    w.u32(base_ptrs.size());
+    for (auto v : base_ptrs) {
+      w.value(vn, v);
+    }
+    w.u32(regions.size());
+    for (auto &kv : regions) {
+      w.u32(kv.first);
+      w.value(vn, kv.second.first);
+      w.region(vn, kv.second.second);
+    }
+    w.u32(callsites.size());
+    for (auto &kv : callsites) {
+      w.u32(kv.first);
+      for (unsigned q = 0; q < NUM_QUERIES; ++q) {
+        w.regions(vn, getRegions((Query)q, kv.second));
+      }
+    }
+  }
+
+  // Write first into a temporary file and then rename it so that
+  // concurrent readers never see a partial snapshot.
+  int fd;
+  SmallString<256> tmp_path;
+  if (std::error_code ec =
+          sys::fs::createUniqueFile(file + "-%%%%%%.tmp", fd, tmp_path)) {
+    CLAM_WARNING("cannot write heap snapshot " << file << ": "
+                                               << ec.message());
+    return false;
+  }
+  {
+    raw_fd_ostream o(fd, /*shouldClose=*/true);
+    o << buf;
+  }
+  if (std::error_code ec = sys::fs::rename(tmp_path, file)) {
+    CLAM_WARNING("cannot write heap snapshot " << file << ": "
+                                               << ec.message());
+    sys::fs::remove(tmp_path);
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<SnapshotHeapAbstraction>
+SnapshotHeapAbstraction::load(const std::string &file, const std::string &key,
+                              const Module &M) {
+  auto buf = MemoryBuffer::getFile(file);
+  if (!buf) {
+    return nullptr;
+  }
+  StringRef data = (*buf)->getBuffer();
+  StringRef magic(SNAPSHOT_MAGIC);
+  if (!data.startswith(magic)) {
+    CLAM_WARNING("ignored heap snapshot " << file << ": bad format");
+    return nullptr;
+  }
+  Reader r(data.drop_front(magic.size()));
+  if (r.u32() != SNAPSHOT_VERSION || r.str() != key || !r.ok()) {
+    // written by another version or for another module
+    return nullptr;
+  }
+
+  std::unique_ptr<SnapshotHeapAbstraction> res(new SnapshotHeapAbstraction(M));
+  ValueNumbering vn(M);
+  if (r.u32() != vn.numGlobals() || r.u32() != M.size()) {
+    r.fail();
+  }
+  for (auto &F : M) {
+    if (!r.ok()) {
+      break;
+    }
+    vn.setFunction(F);
+    if (r.u32() != vn.numArgs() || r.u32() != vn.numInsts()) {
+      r.fail();
+      break;
+    }
+    Regions &fr = res->m_regions[&F];
+    for (unsigned q = 0; q < NUM_QUERIES; ++q) {
+      fr.vecs[q] = r.regions(vn);
+    }
+    uint32_t n = r.u32();
+    for (uint32_t i = 0; i < n && r.ok(); ++i) {
+      res->m_base_ptrs.insert({&F, r.value(vn)});
+    }
+    n = r.u32();
+    for (uint32_t i = 0; i < n && r.ok(); ++i) {
+      const Instruction *I = vn.getInst(r.u32());
+      const Value *v = r.value(vn);
+      Region reg = r.region(vn);
+      if (!I) {
+        r.fail();
+        break;
+      }
+      res->m_value_regions[{I, v}] = reg;
+    }
+    n = r.u32();
+    for (uint32_t i = 0; i < n && r.ok(); ++i) {
+      const CallInst *CI = dyn_cast_or_null<CallInst>(vn.getInst(r.u32()));
+      if (!CI) {
+        r.fail();
+        break;
+      }
+      Regions &cr = res->m_regions[CI];
+      for (unsigned q = 0; q < NUM_QUERIES; ++q) {
+        cr.vecs[q] = r.regions(vn);
+      }
+    }
+  }
+
+  if (!r.ok() || !r.atEnd()) {
+    CLAM_WARNING("ignored corrupted heap snapshot " << file);
+    return nullptr;
+  }
+  res->initRegionSets();
+  return res;
+}
+
+} // end namespace clam
@@ -0,0 +1,114 @@
+#include "SparseLiveness.hh"
+
+#include "llvm/ADT/iterator_range.h"
+
+#include <algorithm>
+#include <deque>
+
+namespace clam {
+
+SparseLiveness::SparseLiveness(cfg_ref_t cfg) {
+  // -- the variables used before being defined (gen) and the
+  //    variables defined (kill) by each block
+  std::vector<basic_block_label_t> labels;
+  std::vector<bitset_t> gen, kill;
+  std::vector<const statement_t *> stmts;
+  for (auto &bb : llvm::make_range(cfg.begin(), cfg.end())) {
+    m_blocks.insert({bb.label(), labels.size()});
+    labels.push_back(bb.label());
+    gen.emplace_back();
+    kill.emplace_back();
+    bitset_t &g = gen.back();
+    bitset_t &k = kill.back();
+    stmts.clear();
+    for (auto &s : llvm::make_range(bb.begin(), bb.end())) {
+      stmts.push_back(&s);
+    }
+    for (auto it = stmts.rbegin(), et = stmts.rend(); it != et; ++it) {
+      auto &ls = (*it)->get_live();
+      for (auto vit = ls.defs_begin(), vet = ls.defs_end(); vit != vet; ++vit) {
+        unsigned i = get_index(*vit);
+        k.set(i);
+        g.reset(i);
+      }
+      for (auto vit = ls.uses_begin(), vet = ls.uses_end(); vit != vet; ++vit) {
+        g.set(get_index(*vit));
+      }
+    }
+  }
+
+  // -- fixpoint: the blocks are visited again when the variables
+  //    live at the start of one of their successors change
+  unsigned num_blocks = labels.size();
+  m_live_out.resize(num_blocks);
+  std::vector<bitset_t> live_in(gen);
+  std::vector<char> in_worklist(num_blocks, true);
+  std::deque<unsigned> worklist;
+  for (unsigned b = num_blocks; b-- > 0;) {
+    worklist.push_back(b);
+  }
+  while (!worklist.empty()) {
+    unsigned b = worklist.front();
+    worklist.pop_front();
+    in_worklist[b] = false;
+    auto &bb = cfg.get_node(labels[b]);
+    bitset_t &out = m_live_out[b];
+    for (auto succ : llvm::make_range(bb.next_blocks())) {
+      out |= live_in[m_blocks[succ]];
+    }
+    bitset_t in(out);
+    in.intersectWithComplement(kill[b]);
+    in |= gen[b];
+    if (in == live_in[b]) {
+      continue;
+    }
+    live_in[b] = std::move(in);
+    for (auto pred : llvm::make_range(bb.prev_blocks())) {
+      unsigned p = m_blocks[pred];
+      if (!in_worklist[p]) {
+        in_worklist[p] = true;
+        worklist.push_back(p);
+      }
+    }
+  }
+}
+
+unsigned SparseLiveness::get_index(const var_t &v) {
+  auto it = m_index.find(v);
+  if (it != m_index.end()) {
+    return it->second;
+  }
+  unsigned i = m_vars.size();
+  m_index.insert({v, i});
+  m_vars.push_back(v);
+  return i;
+}
+
+const SparseLiveness::bitset_t &
+SparseLiveness::live_out(const basic_block_label_t &bl) const {
+  auto it = m_blocks.find(bl);
+  if (it == m_blocks.end()) {
+    return m_empty;
+  }
+  return m_live_out[it->second];
+}
+
+bool SparseLiveness::is_live_out(const basic_block_label_t &bl,
+                                 const var_t &v) const {
+  auto it = m_index.find(v);
+  return it != m_index.end() && live_out(bl).test(it->second);
+}
+
+void SparseLiveness::get_stats(unsigned &total_live, unsigned &max_live_per_blk,
+                               unsigned &avg_live_per_blk) const {
+  total_live = 0;
+  max_live_per_blk = 0;
+  for (auto &out : m_live_out) {
+    unsigned n = out.count();
+    total_live += n;
+    max_live_per_blk = std::max(max_live_per_blk, n);
+  }
+  avg_live_per_blk = m_live_out.empty() ? 0 : total_live / m_live_out.size();
+}
+
+} // end namespace clam
@@ -0,0 +1,53 @@
+#pragma once
+
+/* Liveness of the variables of a Crab CFG over sparse bit-vectors */
+
+#include "clam/crab/crab_cfg.hh"
+
+#include "llvm/ADT/SparseBitVector.h"
+
+#include <map>
+#include <vector>
+
+namespace clam {
+
+/*
+ * Backward analysis of the variables that are live at the end of
+ * each block of a CFG. Each variable of the CFG has a dense index and
+ * a set of live variables is a sparse bit-vector over these indexes,
+ * so that a function with many variables and blocks does not keep an
+ * ordered set of variables per block and joins are done word by word.
+ */
+class SparseLiveness {
+public:
+  using bitset_t = llvm::SparseBitVector<>;
+
+  explicit SparseLiveness(cfg_ref_t cfg);
+
+  // Indexes of the variables live at the end of bl
+  const bitset_t &live_out(const basic_block_label_t &bl) const;
+
+  const var_t &get_var(unsigned i) const { return m_vars[i]; }
+
+  // Whether v is live at the end of bl
+  bool is_live_out(const basic_block_label_t &bl, const var_t &v) const;
+
+  // Number of variables that occur in the CFG
+  unsigned num_vars() const { return m_vars.size(); }
+
+  // Total, max and average number of variables live at the end of a
+  // block
+  void get_stats(unsigned &total_live, unsigned &max_live_per_blk,
+                 unsigned &avg_live_per_blk) const;
+
+private:
+  std::map<var_t, unsigned> m_index;
+  std::vector<var_t> m_vars;
+  std::map<basic_block_label_t, unsigned> m_blocks;
+  std::vector<bitset_t> m_live_out;
+  bitset_t m_empty;
+
+  unsigned get_index(const var_t &v);
+};
+
+} // end namespace clam
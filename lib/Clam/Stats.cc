@@ -0,0 +1,184 @@
+#include "clam/Support/Stats.hh"
+
+#include "llvm/Support/Format.h"
+
+#include <algorithm>
+#include <mutex>
+#include <set>
+
+namespace clam {
+
+using namespace llvm;
+
+namespace {
+
+enum kind_t { COUNT, MAX, TIME };
+
+struct value_t {
+  kind_t kind;
+  double v;
+  value_t() : kind(COUNT), v(0) {}
+};
+
+typedef std::map<std::string, value_t> values_t;
+
+void apply(value_t &x, kind_t kind, double v) {
+  x.kind = kind;
+  if (kind == MAX) {
+    x.v = std::max(x.v, v);
+  } else {
+    x.v += v;
+  }
+}
+
+void merge(values_t &into, const values_t &from) {
+  for (auto &kv : from) {
+    apply(into[kv.first], kv.second.kind, kv.second.v);
+  }
+}
+
+struct thread_stats_t {
+  // only contended while the counters are read
+  std::mutex mutex;
+  values_t values;
+  std::map<std::string, values_t> functions;
+};
+
+struct registry_t {
+  std::mutex mutex;
+  std::set<thread_stats_t *> live;
+  // counters of the threads that exited
+  thread_stats_t retired;
+};
+
+registry_t &getRegistry() {
+  static registry_t registry;
+  return registry;
+}
+
+struct thread_holder_t {
+  thread_stats_t *stats;
+  // function of ScopedFunction or null
+  const std::string *function;
+
+  thread_holder_t() : stats(new thread_stats_t()), function(nullptr) {
+    registry_t &r = getRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.live.insert(stats);
+  }
+
+  ~thread_holder_t() {
+    registry_t &r = getRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    merge(r.retired.values, stats->values);
+    for (auto &kv : stats->functions) {
+      merge(r.retired.functions[kv.first], kv.second);
+    }
+    r.live.erase(stats);
+    delete stats;
+  }
+};
+
+thread_local thread_holder_t tl_stats;
+
+void update(StringRef name, kind_t kind, double v) {
+  thread_holder_t &t = tl_stats;
+  std::lock_guard<std::mutex> lock(t.stats->mutex);
+  apply(t.stats->values[name.str()], kind, v);
+  if (t.function) {
+    apply(t.stats->functions[*t.function][name.str()], kind, v);
+  }
+}
+
+// Combine the counters of all the threads, or only those of function
+// if not null
+values_t collect(const std::string *function) {
+  registry_t &r = getRegistry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  values_t res;
+  auto add = [&res, function](const thread_stats_t &s) {
+    if (!function) {
+      merge(res, s.values);
+    } else {
+      auto it = s.functions.find(*function);
+      if (it != s.functions.end()) {
+        merge(res, it->second);
+      }
+    }
+  };
+  add(r.retired);
+  for (thread_stats_t *s : r.live) {
+    std::lock_guard<std::mutex> slock(s->mutex);
+    add(*s);
+  }
+  return res;
+}
+
+std::map<std::string, double> toMap(const values_t &values) {
+  std::map<std::string, double> res;
+  for (auto &kv : values) {
+    res[kv.first] = kv.second.v;
+  }
+  return res;
+}
+
+} // end namespace
+
+void ClamStats::count(StringRef name, uint64_t n) { update(name, COUNT, n); }
+
+void ClamStats::count_max(StringRef name, uint64_t v) { update(name, MAX, v); }
+
+void ClamStats::add_time(StringRef name, double t) { update(name, TIME, t); }
+
+uint64_t ClamStats::get(StringRef name) {
+  values_t values = collect(nullptr);
+  auto it = values.find(name.str());
+  return it != values.end() && it->second.kind != TIME ? it->second.v : 0;
+}
+
+double ClamStats::get_time(StringRef name) {
+  values_t values = collect(nullptr);
+  auto it = values.find(name.str());
+  return it != values.end() && it->second.kind == TIME ? it->second.v : 0;
+}
+
+std::map<std::string, double> ClamStats::get_all() {
+  return toMap(collect(nullptr));
+}
+
+std::map<std::string, double> ClamStats::get_function(StringRef function) {
+  std::string name = function.str();
+  return toMap(collect(&name));
+}
+
+void ClamStats::reset() {
+  registry_t &r = getRegistry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.retired.values.clear();
+  r.retired.functions.clear();
+  for (thread_stats_t *s : r.live) {
+    std::lock_guard<std::mutex> slock(s->mutex);
+    s->values.clear();
+    s->functions.clear();
+  }
+}
+
+void ClamStats::PrintBrunch(raw_ostream &o) {
+  for (auto &kv : collect(nullptr)) {
+    o << "BRUNCH_STAT " << kv.first << " ";
+    if (kv.second.kind == TIME) {
+      o << format("%.6f", kv.second.v) << "\n";
+    } else {
+      o << (uint64_t)kv.second.v << "\n";
+    }
+  }
+}
+
+ClamStats::ScopedFunction::ScopedFunction(StringRef function)
+    : m_prev(tl_stats.function), m_function(function.str()), m_mem(function) {
+  tl_stats.function = &m_function;
+}
+
+ClamStats::ScopedFunction::~ScopedFunction() { tl_stats.function = m_prev; }
+
+} // end namespace clam
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace clam {
+
+/*
+ * Map LLVM values of a function from/to a position-based reference:
+ * a<n> (n-th argument), i<n> (n-th instruction) or g<name>
+ * (global). Blocks are identified by their position in the function.
+ */
+class ValueNumbering {
+  const llvm::Function &m_fun;
+  llvm::DenseMap<const llvm::Value *, std::string> m_refs;
+  std::map<std::string, const llvm::Value *> m_values;
+  llvm::DenseMap<const llvm::BasicBlock *, unsigned> m_block_ids;
+  std::vector<const llvm::BasicBlock *> m_blocks;
+
+  void add(const llvm::Value *v, std::string ref) {
+    m_refs[v] = ref;
+    m_values[ref] = v;
+  }
+
+public:
+  ValueNumbering(const llvm::Function &fun) : m_fun(fun) {
+    unsigned i = 0;
+    for (auto &a : fun.args()) {
+      add(&a, "a" + std::to_string(i++));
+    }
+    i = 0;
+    for (auto &I : llvm::instructions(fun)) {
+      add(&I, "i" + std::to_string(i++));
+    }
+    for (auto &BB : fun) {
+      m_block_ids[&BB] = m_blocks.size();
+      m_blocks.push_back(&BB);
+    }
+  }
+
+  const llvm::Function &getFunction() const { return m_fun; }
+
+  bool getRef(const llvm::Value *v, std::string &ref) const {
+    auto it = m_refs.find(v);
+    if (it != m_refs.end()) {
+      ref = it->second;
+      return true;
+    }
+    if (const llvm::GlobalValue *gv = llvm::dyn_cast<llvm::GlobalValue>(v)) {
+      std::string name = gv->getName();
+      if (!name.empty() &&
+          name.find_first_of(" \t\n") == std::string::npos) {
+        ref = "g" + name;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const llvm::Value *getValue(const std::string &ref) const {
+    if (ref.empty()) {
+      return nullptr;
+    }
+    if (ref[0] == 'g') {
+      return m_fun.getParent()->getNamedValue(ref.substr(1));
+    }
+    auto it = m_values.find(ref);
+    return (it != m_values.end() ? it->second : nullptr);
+  }
+
+  unsigned getBlockId(const llvm::BasicBlock *b) const {
+    return m_block_ids.lookup(b);
+  }
+
+  const llvm::BasicBlock *getBlock(unsigned id) const {
+    return (id < m_blocks.size() ? m_blocks[id] : nullptr);
+  }
+};
+
+} // end namespace clam
@@ -0,0 +1,136 @@
+#include "VariablePacking.hh"
+
+#include "llvm/ADT/iterator_range.h"
+
+#include <algorithm>
+
+namespace clam {
+
+VariablePacking::VariablePacking(cfg_ref_t cfg, unsigned max_pack_size)
+    : m_bound(std::max(max_pack_size, 1U)), m_truncated(false) {
+  std::vector<unsigned> vars;
+  for (auto &bb : llvm::make_range(cfg.begin(), cfg.end())) {
+    for (auto &s : llvm::make_range(bb.begin(), bb.end())) {
+      // A havoc does not relate variables and the intra-procedural
+      // analysis does not relate the actual parameters of a callsite
+      // with its return values.
+      if (s.is_havoc() || s.is_callsite()) {
+        continue;
+      }
+      vars.clear();
+      auto &ls = s.get_live();
+      for (auto it = ls.defs_begin(), et = ls.defs_end(); it != et; ++it) {
+        vars.push_back(get_index(*it));
+      }
+      for (auto it = ls.uses_begin(), et = ls.uses_end(); it != et; ++it) {
+        vars.push_back(get_index(*it));
+      }
+      for (unsigned i = 1, e = vars.size(); i < e; ++i) {
+        merge(vars[0], vars[i]);
+      }
+    }
+  }
+}
+
+unsigned VariablePacking::get_index(const var_t &v) {
+  auto it = m_index.find(v);
+  if (it != m_index.end()) {
+    return it->second;
+  }
+  unsigned i = m_parent.size();
+  m_index.insert({v, i});
+  m_vars.push_back(v);
+  m_parent.push_back(i);
+  m_size.push_back(1);
+  m_overflow.push_back(false);
+  return i;
+}
+
+unsigned VariablePacking::find(unsigned i) const {
+  // union by size keeps the trees shallow
+  while (m_parent[i] != i) {
+    i = m_parent[i];
+  }
+  return i;
+}
+
+void VariablePacking::merge(unsigned i, unsigned j) {
+  i = find(i);
+  j = find(j);
+  if (i == j) {
+    return;
+  }
+  if (m_size[i] + m_size[j] > m_bound) {
+    m_truncated = true;
+    m_overflow[i] = m_overflow[j] = true;
+    return;
+  }
+  if (m_size[i] < m_size[j]) {
+    std::swap(i, j);
+  }
+  m_parent[j] = i;
+  m_size[i] += m_size[j];
+  m_overflow[i] = m_overflow[i] || m_overflow[j];
+}
+
+unsigned VariablePacking::num_packs() const {
+  unsigned res = 0;
+  for (unsigned i = 0, e = m_parent.size(); i < e; ++i) {
+    if (m_parent[i] == i && m_size[i] > 1) {
+      ++res;
+    }
+  }
+  return res;
+}
+
+unsigned VariablePacking::max_pack_size() const {
+  unsigned res = 0;
+  for (unsigned i = 0, e = m_parent.size(); i < e; ++i) {
+    if (m_parent[i] == i) {
+      res = std::max(res, m_size[i]);
+    }
+  }
+  return res;
+}
+
+std::vector<std::vector<var_t>> VariablePacking::get_packs() const {
+  std::map<unsigned, std::vector<var_t>> packs;
+  for (unsigned i = 0, e = m_parent.size(); i < e; ++i) {
+    unsigned r = find(i);
+    if (m_size[r] > 1) {
+      packs[r].push_back(m_vars[i]);
+    }
+  }
+  std::vector<std::vector<var_t>> res;
+  res.reserve(packs.size());
+  for (auto &kv : packs) {
+    res.push_back(std::move(kv.second));
+  }
+  return res;
+}
+
+std::vector<var_t> VariablePacking::get_overflow_vars() const {
+  std::vector<var_t> res;
+  for (unsigned i = 0, e = m_parent.size(); i < e; ++i) {
+    if (m_overflow[find(i)]) {
+      res.push_back(m_vars[i]);
+    }
+  }
+  return res;
+}
+
+void VariablePacking::write(crab::crab_os &o) const {
+  o << "Variable packs (max size " << m_bound << "):\n";
+  for (auto &pack : get_packs()) {
+    o << "  {";
+    for (unsigned i = 0, e = pack.size(); i < e; ++i) {
+      if (i > 0) {
+        o << ",";
+      }
+      o << pack[i];
+    }
+    o << "}\n";
+  }
+}
+
+} // end namespace clam
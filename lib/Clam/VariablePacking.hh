@@ -0,0 +1,67 @@
+#pragma once
+
+/* Syntactic variable packing over a Crab CFG */
+
+#include "clam/crab/crab_cfg.hh"
+
+#include <map>
+#include <vector>
+
+namespace clam {
+
+/*
+ * Group the variables of a CFG into packs. Two variables are in the
+ * same pack if they appear together in a statement (e.g., an
+ * assignment or an assume) possibly through other variables. Packs
+ * never grow beyond max_pack_size: a statement that would merge two
+ * packs whose total size exceeds the bound leaves them separate.
+ *
+ * A relational domain only needs to relate variables within the same
+ * pack so the size of the largest pack is a better measure of its
+ * cost than the number of live variables. A pack that a statement
+ * related with another pack but could not be merged with it
+ * overflows: keeping its variables packed would lose the relations of
+ * that statement anyway.
+ */
+class VariablePacking {
+public:
+  VariablePacking(cfg_ref_t cfg, unsigned max_pack_size);
+
+  // Number of variables that occur in the CFG
+  unsigned num_vars() const { return m_parent.size(); }
+
+  // Number of packs with more than one variable
+  unsigned num_packs() const;
+
+  // Size of the largest pack
+  unsigned max_pack_size() const;
+
+  // True if some statement related two packs that could not be
+  // merged without exceeding the bound.
+  bool is_truncated() const { return m_truncated; }
+
+  // Return the packs with more than one variable
+  std::vector<std::vector<var_t>> get_packs() const;
+
+  // Return the variables of the packs that overflow
+  std::vector<var_t> get_overflow_vars() const;
+
+  void write(crab::crab_os &o) const;
+
+private:
+  // union-find over the variables indexed by their insertion order
+  std::map<var_t, unsigned> m_index;
+  std::vector<var_t> m_vars;
+  std::vector<unsigned> m_parent;
+  std::vector<unsigned> m_size;
+  // whether the pack of a root overflows
+  std::vector<bool> m_overflow;
+  unsigned m_bound;
+  bool m_truncated;
+
+  unsigned get_index(const var_t &v);
+  unsigned find(unsigned i) const;
+  void merge(unsigned i, unsigned j);
+};
+
+} // end namespace clam
@@ -0,0 +1,91 @@
+#include "WideningDelay.hh"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+
+#include "clam/Support/NameValues.hh"
+
+#include <algorithm>
+
+using namespace llvm;
+
+namespace clam {
+
+// a loop modifying more values than this needs one more iteration
+static const unsigned MANY_MODIFIED = 4;
+
+static bool hasConstantBound(const Loop &L) {
+  SmallVector<BasicBlock *, 4> exiting;
+  L.getExitingBlocks(exiting);
+  for (BasicBlock *BB : exiting) {
+    auto *BI = dyn_cast<BranchInst>(BB->getTerminator());
+    if (!BI || !BI->isConditional()) {
+      continue;
+    }
+    if (auto *Cmp = dyn_cast<ICmpInst>(BI->getCondition())) {
+      if (isa<ConstantInt>(Cmp->getOperand(0)) ||
+          isa<ConstantInt>(Cmp->getOperand(1))) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+static void addLoop(const Loop &L, unsigned max_delay,
+                    std::vector<ClamLoopStats> &loops) {
+  ClamLoopStats ls;
+  const BasicBlock *header = L.getHeader();
+  ls.header = getValueName(*header);
+  ls.depth = L.getLoopDepth();
+  // -- the values carried from one iteration to the next
+  ls.num_modified = 0;
+  for (auto &I : *header) {
+    if (!isa<PHINode>(I)) {
+      break;
+    }
+    ls.num_modified++;
+  }
+  ls.constant_bound = hasConstantBound(L);
+  unsigned delay = ls.depth;
+  if (ls.num_modified > MANY_MODIFIED) {
+    delay++;
+  }
+  if (!ls.constant_bound) {
+    delay++;
+  }
+  ls.widening_delay = std::max(1U, std::min(delay, max_delay));
+  loops.push_back(ls);
+  for (const Loop *SubL : L) {
+    addLoop(*SubL, max_delay, loops);
+  }
+}
+
+WideningDelay::WideningDelay(const Function &F, unsigned max_delay)
+    : m_delay(1) {
+  if (F.isDeclaration()) {
+    return;
+  }
+  DominatorTree DT(const_cast<Function &>(F));
+  LoopInfo LI(DT);
+  for (const Loop *L : LI) {
+    addLoop(*L, std::max(max_delay, 1U), m_loops);
+  }
+  for (auto &ls : m_loops) {
+    m_delay = std::max(m_delay, ls.widening_delay);
+  }
+}
+
+void WideningDelay::write(crab::crab_os &o) const {
+  o << "Widening delays:\n";
+  for (auto &ls : m_loops) {
+    o << "  " << ls.header << ": depth=" << ls.depth
+      << " modified=" << ls.num_modified
+      << " constant_bound=" << ls.constant_bound
+      << " delay=" << ls.widening_delay << "\n";
+  }
+}
+
+} // end namespace clam
@@ -0,0 +1,46 @@
+#pragma once
+
+/* Widening delay chosen from the loop nests of a function */
+
+#include "clam/Clam.hh"
+
+#include "llvm/IR/Function.h"
+
+#include <vector>
+
+namespace clam {
+
+/*
+ * Choose a widening delay for each loop of a function from its depth,
+ * the number of values it modifies and whether its exit compares
+ * with a constant:
+ *
+ *  - each level of nesting adds one iteration since the inner loop
+ *    is stabilized again at each iteration of the outer one,
+ *  - a loop that modifies many values needs one more iteration
+ *    before the relations between them settle,
+ *  - a loop bound that is not a constant cannot be recovered by the
+ *    widening thresholds or by narrowing so it adds one iteration.
+ *
+ * A loop with one constant bound and few modified values at depth 1
+ * keeps the minimal delay of 1. Crab applies one delay to all the
+ * widening points of a CFG so the delay of the function is the
+ * largest delay of its loops.
+ */
+class WideningDelay {
+public:
+  WideningDelay(const llvm::Function &F, unsigned max_delay);
+
+  // Delay for the fixpoint iterator (1 if the function has no loops)
+  unsigned delay() const { return m_delay; }
+
+  const std::vector<ClamLoopStats> &loops() const { return m_loops; }
+
+  void write(crab::crab_os &o) const;
+
+private:
+  std::vector<ClamLoopStats> m_loops;
+  unsigned m_delay;
+};
+
+} // end namespace clam
@@ -0,0 +1,42 @@
+#include "WideningThresholds.hh"
+
+#include "llvm/ADT/iterator_range.h"
+
+namespace clam {
+
+void WideningThresholds::add(cfg_ref_t cfg) {
+  typedef cfg_ref_t::basic_block_t::assume_t assume_t;
+  for (auto &bb : llvm::make_range(cfg.begin(), cfg.end())) {
+    for (auto &s : llvm::make_range(bb.begin(), bb.end())) {
+      if (!s.is_assume()) {
+        continue;
+      }
+      auto &cst = static_cast<const assume_t &>(s).constraint();
+      if (cst.size() != 1) {
+        continue;
+      }
+      // cst is a*x + c op 0 so the bound on x is -c/a
+      number_t a = (*cst.begin()).first;
+      number_t c = cst.constant();
+      if (a == 0 || c % a != 0) {
+        continue;
+      }
+      m_constants.insert(-c / a);
+    }
+  }
+}
+
+void WideningThresholds::write(crab::crab_os &o) const {
+  o << "Widening thresholds: {";
+  bool first = true;
+  for (auto &k : m_constants) {
+    if (!first) {
+      o << ",";
+    }
+    first = false;
+    o << k;
+  }
+  o << "}\n";
+}
+
+} // end namespace clam
@@ -0,0 +1,44 @@
+#pragma once
+
+/* Widening thresholds harvested from the constants of a Crab CFG */
+
+#include "clam/crab/crab_cfg.hh"
+
+#include <set>
+
+namespace clam {
+
+/*
+ * Collect the constants k of the assumes x op k of a CFG where op is
+ * a comparison. After translation these are the loop guards and the array
+ * bounds checks (the index of an array statement is always a
+ * variable so its bounds only show up through the guards).
+ *
+ * Crab already selects, for each loop head, the thresholds among the
+ * assumes of the loop but it only keeps as many as the size of the
+ * jump set. This class gives a size large enough for all of them.
+ */
+class WideningThresholds {
+public:
+  WideningThresholds() {}
+  explicit WideningThresholds(cfg_ref_t cfg) { add(cfg); }
+
+  // Add the constants of cfg
+  void add(cfg_ref_t cfg);
+
+  // Number of distinct constants
+  unsigned num_constants() const { return m_constants.size(); }
+
+  // Size of the jump set so that no constant is dropped. Crab also
+  // keeps zero and the infinities.
+  unsigned jump_set_size() const {
+    return m_constants.empty() ? 0 : m_constants.size() + 3;
+  }
+
+  void write(crab::crab_os &o) const;
+
+private:
+  std::set<number_t> m_constants;
+};
+
+} // end namespace clam
@@ -0,0 +1,184 @@
+#pragma once
+
+/* Forward fixpoint of a CFG with a priority worklist */
+
+#include "clam/CfgBuilder.hh"
+#include "clam/crab/crab_cfg.hh"
+#include "clam/Support/Stats.hh"
+
+#include "crab/analysis/abs_transformer.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace clam {
+
+/*
+ * Alternative to the recursive iteration of crab over the weak
+ * topological order of the CFG (AnalysisParams::fixpoint).
+ *
+ * The worklist always returns the dirty block that comes first in
+ * reverse postorder. A block is dirty when the post of one of its
+ * predecessors changed, and it is skipped if its new pre is included
+ * in the previous one. The widening is only applied at the targets
+ * of the back edges found by a depth-first search from the entry
+ * (CfgBuilder::loop_order_t::heads). They cut every cycle, reducible
+ * or not, so the ascending phase terminates without building nested
+ * components: on a large irreducible CFG a block is evaluated again
+ * only if one of its inputs changed, not once per iteration of every
+ * component that contains it.
+ *
+ * The descending phase is at most narrowing_iters passes over the
+ * blocks in reverse postorder that narrow the heads. Since the only
+ * edges that go backward reach the heads, one pass recomputes the
+ * other blocks from their predecessors.
+ *
+ * Unlike crab, the iteration does not use widening thresholds nor
+ * forget dead variables. Unreachable blocks are bottom.
+ *
+ * If stop is given, it is called before each evaluation of a block
+ * and the iteration is abandoned as soon as it returns true: the
+ * invariants are then not a fixpoint and must be discarded.
+ */
+template<typename Dom>
+class worklist_fixpoint {
+  typedef crab::analyzer::intra_abs_transformer<Dom> abs_tr_t;
+  typedef CfgBuilder::loop_order_t loop_order_t;
+
+  cfg_ref_t m_cfg;
+  const loop_order_t &m_lo;
+  // position of each reachable block in m_lo.rpo
+  std::map<basic_block_label_t, unsigned> m_index;
+  // reachable predecessors and successors by position
+  std::vector<std::vector<unsigned>> m_preds;
+  std::vector<std::vector<unsigned>> m_succs;
+  std::vector<bool> m_is_head;
+  std::vector<Dom> m_pre;
+  std::vector<Dom> m_post;
+  // number of evaluations of blocks and of dirty blocks skipped
+  uint64_t m_evals;
+  uint64_t m_skipped;
+
+  Dom incoming(unsigned i, const Dom &entry_dom) {
+    Dom res = (i == 0 ? entry_dom : Dom::bottom());
+    for (unsigned p: m_preds[i]) {
+      res |= m_post[p];
+    }
+    return res;
+  }
+
+  void eval(unsigned i, Dom pre) {
+    abs_tr_t abs_tr(pre);
+    for (auto &s: m_cfg.get_node(m_lo.rpo[i])) {
+      s.accept(&abs_tr);
+    }
+    m_pre[i] = pre;
+    m_post[i] = abs_tr.get_abs_value();
+    ++m_evals;
+  }
+
+public:
+  worklist_fixpoint(cfg_ref_t cfg, const loop_order_t &lo)
+    : m_cfg(cfg), m_lo(lo), m_evals(0), m_skipped(0) {
+    unsigned n = m_lo.rpo.size();
+    for (unsigned i = 0; i < n; ++i) {
+      m_index[m_lo.rpo[i]] = i;
+    }
+    m_preds.resize(n);
+    m_succs.resize(n);
+    m_is_head.resize(n, false);
+    for (unsigned i = 0; i < n; ++i) {
+      auto &bb = m_cfg.get_node(m_lo.rpo[i]);
+      for (auto succ: llvm::make_range(bb.next_blocks())) {
+	auto it = m_index.find(succ);
+	if (it != m_index.end()) {
+	  m_succs[i].push_back(it->second);
+	  m_preds[it->second].push_back(i);
+	}
+      }
+      m_is_head[i] = m_lo.heads.count(m_lo.rpo[i]) > 0;
+    }
+  }
+
+  worklist_fixpoint(const worklist_fixpoint<Dom> &o) = delete;
+  worklist_fixpoint<Dom> &operator=(const worklist_fixpoint<Dom> &o) = delete;
+
+  // Compute the invariants from entry_dom at the entry of the CFG.
+  // Return false if the iteration was stopped.
+  bool run(Dom entry_dom, unsigned widening_delay, unsigned narrowing_iters,
+	   const std::function<bool()> &stop = std::function<bool()>()) {
+    unsigned n = m_lo.rpo.size();
+    m_pre.assign(n, Dom::bottom());
+    m_post.assign(n, Dom::bottom());
+    m_evals = m_skipped = 0;
+    if (n == 0) {
+      return true;
+    }
+
+    // -- ascending phase
+    std::vector<unsigned> visits(n, 0);
+    std::set<unsigned> worklist;
+    worklist.insert(0);
+    while (!worklist.empty()) {
+      unsigned i = *worklist.begin();
+      worklist.erase(worklist.begin());
+      Dom in = incoming(i, entry_dom);
+      if (visits[i] > 0) {
+	if (in <= m_pre[i]) {
+	  ++m_skipped;
+	  continue;
+	}
+	if (m_is_head[i]) {
+	  Dom joined = m_pre[i] | in;
+	  in = (visits[i] > widening_delay ? m_pre[i] || joined : joined);
+	}
+      }
+      if (stop && stop()) {
+	return false;
+      }
+      ++visits[i];
+      eval(i, in);
+      worklist.insert(m_succs[i].begin(), m_succs[i].end());
+    }
+
+    // -- descending phase
+    for (unsigned k = 0; k < narrowing_iters; ++k) {
+      bool change = false;
+      for (unsigned i = 0; i < n; ++i) {
+	Dom in = incoming(i, entry_dom);
+	if (m_is_head[i]) {
+	  in = m_pre[i] && in;
+	  change |= !(m_pre[i] <= in);
+	}
+	if (stop && stop()) {
+	  return false;
+	}
+	eval(i, in);
+      }
+      if (!change) {
+	break;
+      }
+    }
+
+    ClamStats::count("Fixpoint.Worklist.Evaluations", m_evals);
+    ClamStats::count("Fixpoint.Worklist.Skipped", m_skipped);
+    return true;
+  }
+
+  Dom get_pre(const basic_block_label_t &bl) const {
+    auto it = m_index.find(bl);
+    return it == m_index.end() ? Dom::bottom() : m_pre[it->second];
+  }
+
+  Dom get_post(const basic_block_label_t &bl) const {
+    auto it = m_index.find(bl);
+    return it == m_index.end() ? Dom::bottom() : m_post[it->second];
+  }
+
+  uint64_t num_evaluations() const { return m_evals; }
+};
+
+} // end namespace clam
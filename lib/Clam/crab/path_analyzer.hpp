@@ -3,6 +3,9 @@
 #include <clam/crab/crab_cfg.hh>
 #include <crab/analysis/abs_transformer.hpp>
 
+#include <atomic>
+#include <list>
+#include <memory>
 #include <unordered_map>
 
 namespace crab {
@@ -59,8 +62,60 @@ namespace analyzer {
       core.clear();
       core.assign(m_core.begin(), m_core.end());
     }
+
+    /* If cancel is not null then solve polls it between statements
+     * and gives up as soon as it becomes true. A cancelled solve
+     * returns true (i.e., the path is not proven infeasible) and
+     * is_cancelled() returns true.
+     */
+    void set_cancel_flag(const std::atomic<bool>* cancel) {
+      m_cancel = cancel;
+    }
+
+    bool is_cancelled() const { return m_cancelled; }
+
+    /* Incremental solving: if max_states > 0 then the abstract states
+     * computed along each solved path are kept in a trie of path
+     * prefixes so that the next call to solve resumes from the
+     * longest prefix already solved. At most max_states states are
+     * kept (least recently used prefixes are evicted first).
+     * 
+     * The cache assumes that neither the cfg nor init change between
+     * calls to solve.
+     */
+    void set_prefix_cache_size(unsigned max_states) {
+      m_max_cached = max_states;
+      evict_prefixes();
+    }
+
+    void clear_prefix_cache() {
+      m_prefix_roots.clear();
+      m_lru.clear();
+    }
+
+    unsigned get_prefix_cache_hits() const { return m_cache_hits; }
     
   private:
+
+    // A node represents the prefix that ends at block label
+    struct prefix_node {
+      basic_block_label_t label;
+      prefix_node* parent;
+      // states at the entry and at the exit of label
+      abs_dom_t pre;
+      abs_dom_t post;
+      std::unordered_map<basic_block_label_t, std::unique_ptr<prefix_node>> kids;
+      typename std::list<prefix_node*>::iterator lru_it;
+
+      prefix_node(basic_block_label_t l, prefix_node* p, abs_dom_t pre, abs_dom_t post)
+	: label(l), parent(p), pre(pre), post(post) {}
+    };
+    typedef std::unordered_map<basic_block_label_t, std::unique_ptr<prefix_node>> prefix_map_t;
+    
+    void touch_prefixes(const std::vector<prefix_node*>& prefix);
+    void evict_prefixes();
+    void collect_statements(basic_block_label_t node, bool only_bool_reasoning,
+			    std::vector<typename crab::cfg::statement_wrapper>& stmts);
     
     bool has_kid(basic_block_label_t b1, basic_block_label_t b2);
     void minimize_path(const std::vector<crab::cfg::statement_wrapper>& path,
@@ -83,6 +138,24 @@ namespace analyzer {
     // minimal subset of statements that explains path unsatisfiability
     // (only if solver return false (i.e., bottom)
     std::vector<crab::cfg::statement_wrapper> m_core;
+    // set by other threads to stop solve (e.g., portfolio solving)
+    const std::atomic<bool>* m_cancel;
+    bool m_cancelled;
+
+    // prefix cache
+    unsigned m_max_cached;
+    prefix_map_t m_prefix_roots;
+    // most recently used first. A prefix is always more recent than
+    // its extensions so the last one is always a leaf of the trie.
+    std::list<prefix_node*> m_lru;
+    unsigned m_cache_hits;
+
+    bool check_cancelled() {
+      if (!m_cancelled && m_cancel && m_cancel->load(std::memory_order_relaxed)) {
+	m_cancelled = true;
+      }
+      return m_cancelled;
+    }
   }; 
   
 } // end namespace
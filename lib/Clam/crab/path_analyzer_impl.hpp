@@ -1,3 +1,11 @@
+#pragma once
+
+/* 
+ * Definition of path_analyzer. It must be only included by the
+ * translation units that instantiate path_analyzer for a particular
+ * abstract domain (see lib/Clam/domains).
+ */
+
 #include "clam/config.h"
 #include "path_analyzer.hpp"
 // flat_killgen_domain
@@ -20,7 +28,47 @@ static bool speculative_only_data = true;
 
 template<typename CFG, typename AbsDom>
 path_analyzer<CFG,AbsDom>::path_analyzer(CFG cfg, AbsDom init)
-  : m_cfg(cfg), m_init(init) { }
+  : m_cfg(cfg), m_init(init), m_cancel(nullptr), m_cancelled(false),
+    m_max_cached(0), m_cache_hits(0) { }
+
+template<typename CFG, typename AbsDom>  
+void path_analyzer<CFG,AbsDom>::
+collect_statements(basic_block_label_t node, bool only_bool_reasoning,
+		   std::vector<typename crab::cfg::statement_wrapper>& stmts) {
+  auto &b = m_cfg.get_node (node);
+  for (auto &s : b) {
+    if (only_bool_reasoning) {
+      if (!(s.is_bool_bin_op() || s.is_bool_assign_cst() || s.is_bool_assign_var() ||
+	    s.is_bool_assume() || s.is_bool_assert()     || s.is_bool_select())) {
+	continue;
+      }
+    }
+    if (!s.is_assert() && !s.is_ptr_assert() && !s.is_bool_assert()) {
+      stmts.push_back(crab::cfg::statement_wrapper(&s, node));
+    }
+  }
+}
+
+template<typename CFG, typename AbsDom>  
+void path_analyzer<CFG,AbsDom>::touch_prefixes(const std::vector<prefix_node*>& prefix) {
+  // from the longest to the shortest prefix so that a prefix is
+  // always more recent than its extensions.
+  for (auto it = prefix.rbegin(), et = prefix.rend(); it != et; ++it) {
+    prefix_node* n = *it;
+    m_lru.splice(m_lru.begin(), m_lru, n->lru_it);
+  }
+}
+
+template<typename CFG, typename AbsDom>  
+void path_analyzer<CFG,AbsDom>::evict_prefixes() {
+  while (m_lru.size() > m_max_cached) {
+    prefix_node* n = m_lru.back();
+    assert(n->kids.empty());
+    m_lru.pop_back();
+    prefix_map_t& siblings = (n->parent ? n->parent->kids : m_prefix_roots);
+    siblings.erase(n->label);
+  }
+}
 
 template<typename CFG, typename AbsDom>  
 bool path_analyzer<CFG,AbsDom>::
@@ -35,9 +83,31 @@ solve_path(const std::vector<basic_block_label_t>& path,
   bool bottom_found = false;
   bottom_block = path.size();
 
-  AbsDom pre(m_init);
+  // resume from the longest prefix of path already solved
+  const bool use_cache = (m_max_cached > 0 && !only_bool_reasoning);
+  std::vector<prefix_node*> prefix;
+  unsigned start = 0;
+  if (use_cache) {
+    prefix_map_t* kids = &m_prefix_roots;
+    for (unsigned e=path.size(); start < e; ++start) {
+      auto it = kids->find(path[start]);
+      if (it == kids->end()) {
+	break;
+      }
+      prefix_node* n = it->second.get();
+      prefix.push_back(n);
+      m_fwd_dom_map.insert(std::make_pair(path[start], n->pre));
+      collect_statements(path[start], only_bool_reasoning, path_statements);
+      kids = &n->kids;
+    }
+    if (start > 0) {
+      m_cache_hits++;
+    }
+  }
+  
+  AbsDom pre(prefix.empty() ? m_init : prefix.back()->post);
   fwd_abs_tr_t abs_tr(std::move(pre));
-  for(unsigned i=0, e=path.size(); i < e; ++i) {
+  for(unsigned i=start, e=path.size(); i < e; ++i) {
     AbsDom new_pre(std::move(abs_tr.get_abs_value()));
     if (new_pre.is_bottom()) {
       if (!bottom_found) {
@@ -58,6 +128,12 @@ solve_path(const std::vector<basic_block_label_t>& path,
     auto &b = m_cfg.get_node (node);
     bottom_stmt = 0;
     for (auto &s : b) {
+      if (check_cancelled()) {
+	if (use_cache) {
+	  touch_prefixes(prefix);
+	}
+	return false;
+      }
       if (only_bool_reasoning) {
 	if (!(s.is_bool_bin_op() || s.is_bool_assign_cst() || s.is_bool_assign_var() ||
 	      s.is_bool_assume() || s.is_bool_assert()     || s.is_bool_select())) {
@@ -77,6 +153,26 @@ solve_path(const std::vector<basic_block_label_t>& path,
       }
       
     }
+
+    if (use_cache) {
+      // only prefixes that are not bottom are cached
+      AbsDom post(abs_tr.get_abs_value());
+      if (post.is_bottom()) {
+	continue;
+      }
+      prefix_map_t& kids = (prefix.empty() ? m_prefix_roots : prefix.back()->kids);
+      prefix_node* n = new prefix_node(node, (prefix.empty() ? nullptr : prefix.back()),
+				       new_pre, post);
+      kids[node].reset(n);
+      m_lru.push_front(n);
+      n->lru_it = m_lru.begin();
+      prefix.push_back(n);
+    }
+  }
+
+  if (use_cache) {
+    touch_prefixes(prefix);
+    evict_prefixes();
   }
   return bottom_found;
 }
@@ -88,6 +184,7 @@ bool path_analyzer<CFG,AbsDom>::solve(const std::vector<basic_block_label_t>& pa
   // Reset state
   m_fwd_dom_map.clear();
   m_core.clear();
+  m_cancelled = false;
   
   if (path.empty()) {
     CRAB_WARN("Empty path: do nothing\n");
@@ -140,7 +237,7 @@ bool path_analyzer<CFG,AbsDom>::solve(const std::vector<basic_block_label_t>& pa
     bottom_found = solve_path(path, true /*only_bool_reasoning*/,
 			      path_statements, bottom_block, bottom_stmt);
   
-    if (!bottom_found) {
+    if (!bottom_found && !m_cancelled) {
       // clear up m_fwd_dom_map before we solve again the path.
       for(unsigned i=0, e=path.size(); i<e; ++i) {
 	basic_block_label_t node = path[i];
@@ -153,10 +250,18 @@ bool path_analyzer<CFG,AbsDom>::solve(const std::vector<basic_block_label_t>& pa
     // }
   }
   
+  if (m_cancelled) {
+    return true;
+  }
+  
   if (bottom_found) {
     // -- Compute minimal subset of statements that still implies
     //    bottom.
     minimize_path(path_statements, bottom_stmt);
+    if (m_cancelled) {
+      m_core.clear();
+      return true;
+    }
   }
   return !bottom_found;
 }
@@ -381,6 +486,10 @@ minimize_path(const std::vector<crab::cfg::statement_wrapper>& path,
     
     std::vector<bool> enabled(core.size(), true);
     for (unsigned i=0; i < core.size (); ++i) {
+      if (check_cancelled()) {
+	// the core is discarded by the caller
+	return;
+      }
       AbsDom inv;
       fwd_abs_tr_t abs_tr(std::move(inv));    
       for(unsigned j=0; j < core.size(); ++j) {
@@ -433,21 +542,3 @@ minimize_path(const std::vector<crab::cfg::statement_wrapper>& path,
 }
 } // end namespace 
 } // end namespace
-
-#include <clam/crab/crab_domains.hh>
-#include <clam/crab/crab_cfg.hh>
-
-namespace crab {
-namespace analyzer {
-// explicit instantiations
-template class path_analyzer<clam::cfg_ref_t, clam::split_dbm_domain_t>;
-#ifdef HAVE_ALL_DOMAINS
-template class path_analyzer<clam::cfg_ref_t, clam::interval_domain_t>;
-template class path_analyzer<clam::cfg_ref_t, clam::term_int_domain_t>;
-template class path_analyzer<clam::cfg_ref_t, clam::wrapped_interval_domain_t>;      
-template class path_analyzer<clam::cfg_ref_t, clam::num_domain_t>;
-template class path_analyzer<clam::cfg_ref_t, clam::boxes_domain_t>;
-#endif   
-} 
-} 
-
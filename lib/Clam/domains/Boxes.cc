@@ -0,0 +1,29 @@
+#include "../ClamImpl.hh"
+#include "../crab/path_analyzer_impl.hpp"
+
+namespace crab {
+namespace analyzer {
+template class path_analyzer<clam::cfg_ref_t, clam::boxes_domain_t>;
+} // end namespace analyzer
+} // end namespace crab
+
+namespace clam {
+
+void registerBoxesDomain() {
+  // the LDD manager is shared by all the boxes and it is not
+  // thread-safe (see isExclusiveDomain)
+  IntraClam_Impl::register_domain<boxes_domain_t>(BOXES, "boxes");
+  IntraClam_Impl::register_path_domain<boxes_domain_t>(BOXES, "boxes");
+#ifdef HAVE_INTER
+#ifdef TOP_DOWN_INTER_ANALYSIS
+  InterClam_Impl::register_domain<boxes_domain_t>(BOXES, "boxes");
+#else
+  InterClam_Impl::register_domain<split_dbm_domain_t, boxes_domain_t>
+    (ZONES_SPLIT_DBM, BOXES, "bottom-up:zones, top-down:boxes");
+#endif
+#endif
+}
+
+} // end namespace clam
+
+CLAM_DOMAIN_PLUGIN(registerBoxesDomain)
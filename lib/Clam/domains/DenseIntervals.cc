@@ -0,0 +1,27 @@
+#include "../ClamImpl.hh"
+#include "../crab/path_analyzer_impl.hpp"
+
+namespace crab {
+namespace analyzer {
+template class path_analyzer<clam::cfg_ref_t, clam::dense_interval_domain_t>;
+} // end namespace analyzer
+} // end namespace crab
+
+namespace clam {
+
+void registerDenseIntervalsDomain() {
+  IntraClam_Impl::register_domain<dense_interval_domain_t>(DENSE_INTERVALS, "dense intervals");
+  IntraClam_Impl::register_path_domain<dense_interval_domain_t>(DENSE_INTERVALS, "dense intervals");
+#ifdef HAVE_INTER
+#ifdef TOP_DOWN_INTER_ANALYSIS
+  InterClam_Impl::register_domain<dense_interval_domain_t>(DENSE_INTERVALS, "dense intervals");
+#else
+  InterClam_Impl::register_domain<split_dbm_domain_t, dense_interval_domain_t>
+    (ZONES_SPLIT_DBM, DENSE_INTERVALS, "bottom-up:zones, top-down:dense intervals");
+#endif
+#endif
+}
+
+} // end namespace clam
+
+CLAM_DOMAIN_PLUGIN(registerDenseIntervalsDomain)
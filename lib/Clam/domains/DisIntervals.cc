@@ -0,0 +1,11 @@
+#include "../ClamImpl.hh"
+
+namespace clam {
+
+void registerDisIntervalsDomain() {
+  IntraClam_Impl::register_domain<dis_interval_domain_t>(DIS_INTERVALS, "disjunctive intervals");
+}
+
+} // end namespace clam
+
+CLAM_DOMAIN_PLUGIN(registerDisIntervalsDomain)
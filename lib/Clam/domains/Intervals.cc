@@ -0,0 +1,27 @@
+#include "../ClamImpl.hh"
+#include "../crab/path_analyzer_impl.hpp"
+
+namespace crab {
+namespace analyzer {
+template class path_analyzer<clam::cfg_ref_t, clam::interval_domain_t>;
+} // end namespace analyzer
+} // end namespace crab
+
+namespace clam {
+
+void registerIntervalsDomain() {
+  IntraClam_Impl::register_domain<interval_domain_t>(INTERVALS, "classical intervals");
+  IntraClam_Impl::register_path_domain<interval_domain_t>(INTERVALS, "classical intervals");
+#ifdef HAVE_INTER
+#ifdef TOP_DOWN_INTER_ANALYSIS
+  InterClam_Impl::register_domain<interval_domain_t>(INTERVALS, "intervals");
+#else
+  InterClam_Impl::register_domain<split_dbm_domain_t, interval_domain_t>
+    (ZONES_SPLIT_DBM, INTERVALS, "bottom-up:zones, top-down:intervals");
+#endif
+#endif
+}
+
+} // end namespace clam
+
+CLAM_DOMAIN_PLUGIN(registerIntervalsDomain)
@@ -0,0 +1,11 @@
+#include "../ClamImpl.hh"
+
+namespace clam {
+
+void registerIntervalsCongruencesDomain() {
+  IntraClam_Impl::register_domain<ric_domain_t>(INTERVALS_CONGRUENCES, "reduced product of intervals and congruences");
+}
+
+} // end namespace clam
+
+CLAM_DOMAIN_PLUGIN(registerIntervalsCongruencesDomain)
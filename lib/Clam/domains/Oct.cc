@@ -0,0 +1,38 @@
+#include "../ClamImpl.hh"
+
+namespace clam {
+
+void registerOctDomain() {
+  // the Elina/Apron manager is shared by all the octagons and it is
+  // not thread-safe (see isExclusiveDomain)
+  IntraClam_Impl::register_domain<oct_domain_t>(OCT, "octagons");
+  IntraClam_Impl::register_domain<oct_domain_t>(PACKED_OCT, "packed octagons");
+#ifdef HAVE_INTER
+#ifdef TOP_DOWN_INTER_ANALYSIS
+  InterClam_Impl::register_domain<oct_domain_t>(OCT, "oct");
+#else
+  InterClam_Impl::register_domain<split_dbm_domain_t, oct_domain_t>
+    (ZONES_SPLIT_DBM, OCT, "bottom-up:zones, top-down:oct");
+  InterClam_Impl::register_domain<oct_domain_t, interval_domain_t>
+    (OCT, INTERVALS, "bottom-up:oct, top-down:intervals");
+  InterClam_Impl::register_domain<oct_domain_t, wrapped_interval_domain_t>
+    (OCT, WRAPPED_INTERVALS, "bottom-up:oct, top-down:wrapped intervals");
+  InterClam_Impl::register_domain<oct_domain_t, split_dbm_domain_t>
+    (OCT, ZONES_SPLIT_DBM, "bottom-up:oct, top-down:zones");
+  InterClam_Impl::register_domain<oct_domain_t, boxes_domain_t>
+    (OCT, BOXES, "bottom-up:oct, top-down:boxes");
+  InterClam_Impl::register_domain<oct_domain_t, oct_domain_t>
+    (OCT, OCT, "bottom-up:oct, top-down:oct");
+  InterClam_Impl::register_domain<oct_domain_t, pk_domain_t>
+    (OCT, PK, "bottom-up:oct, top-down:pk");
+  InterClam_Impl::register_domain<oct_domain_t, num_domain_t>
+    (OCT, TERMS_ZONES, "bottom-up:oct, top-down:terms+zones");
+  InterClam_Impl::register_domain<oct_domain_t, term_dis_int_domain_t>
+    (OCT, TERMS_DIS_INTERVALS, "bottom-up:oct, top-down:terms+dis_intervals");
+#endif
+#endif
+}
+
+} // end namespace clam
+
+CLAM_DOMAIN_PLUGIN(registerOctDomain)
@@ -0,0 +1,21 @@
+#include "../ClamImpl.hh"
+
+namespace clam {
+
+void registerPkDomain() {
+  // the Elina/Apron manager is shared by all the polyhedra and it is
+  // not thread-safe (see isExclusiveDomain)
+  IntraClam_Impl::register_domain<pk_domain_t>(PK, "polyhedra");
+#ifdef HAVE_INTER
+#ifdef TOP_DOWN_INTER_ANALYSIS
+  InterClam_Impl::register_domain<pk_domain_t>(PK, "pk");
+#else
+  InterClam_Impl::register_domain<split_dbm_domain_t, pk_domain_t>
+    (ZONES_SPLIT_DBM, PK, "bottom-up:zones, top-down:pk");
+#endif
+#endif
+}
+
+} // end namespace clam
+
+CLAM_DOMAIN_PLUGIN(registerPkDomain)
@@ -0,0 +1,19 @@
+#include "../ClamImpl.hh"
+
+namespace clam {
+
+void registerTermsDisIntervalsDomain() {
+  IntraClam_Impl::register_domain<term_dis_int_domain_t>(TERMS_DIS_INTERVALS, "terms with disjunctive intervals");
+#ifdef HAVE_INTER
+#ifdef TOP_DOWN_INTER_ANALYSIS
+  InterClam_Impl::register_domain<term_dis_int_domain_t>(TERMS_DIS_INTERVALS, "terms+dis_intervals");
+#else
+  InterClam_Impl::register_domain<split_dbm_domain_t, term_dis_int_domain_t>
+    (ZONES_SPLIT_DBM, TERMS_DIS_INTERVALS, "bottom-up:zones, top-down:terms+dis_intervals");
+#endif
+#endif
+}
+
+} // end namespace clam
+
+CLAM_DOMAIN_PLUGIN(registerTermsDisIntervalsDomain)
@@ -0,0 +1,19 @@
+#include "../ClamImpl.hh"
+#include "../crab/path_analyzer_impl.hpp"
+
+namespace crab {
+namespace analyzer {
+template class path_analyzer<clam::cfg_ref_t, clam::term_int_domain_t>;
+} // end namespace analyzer
+} // end namespace crab
+
+namespace clam {
+
+void registerTermsIntervalsDomain() {
+  IntraClam_Impl::register_domain<term_int_domain_t>(TERMS_INTERVALS, "terms with intervals");
+  IntraClam_Impl::register_path_domain<term_int_domain_t>(TERMS_INTERVALS, "terms with intervals");
+}
+
+} // end namespace clam
+
+CLAM_DOMAIN_PLUGIN(registerTermsIntervalsDomain)
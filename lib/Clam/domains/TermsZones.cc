@@ -0,0 +1,27 @@
+#include "../ClamImpl.hh"
+#include "../crab/path_analyzer_impl.hpp"
+
+namespace crab {
+namespace analyzer {
+template class path_analyzer<clam::cfg_ref_t, clam::num_domain_t>;
+} // end namespace analyzer
+} // end namespace crab
+
+namespace clam {
+
+void registerTermsZonesDomain() {
+  IntraClam_Impl::register_domain<num_domain_t>(TERMS_ZONES, "terms with zones");
+  IntraClam_Impl::register_path_domain<num_domain_t>(TERMS_ZONES, "terms with zones");
+#ifdef HAVE_INTER
+#ifdef TOP_DOWN_INTER_ANALYSIS
+  InterClam_Impl::register_domain<num_domain_t>(TERMS_ZONES, "terms+zones");
+#else
+  InterClam_Impl::register_domain<split_dbm_domain_t, num_domain_t>
+    (ZONES_SPLIT_DBM, TERMS_ZONES, "bottom-up:zones, top-down:terms+zones");
+#endif
+#endif
+}
+
+} // end namespace clam
+
+CLAM_DOMAIN_PLUGIN(registerTermsZonesDomain)
@@ -0,0 +1,27 @@
+#include "../ClamImpl.hh"
+#include "../crab/path_analyzer_impl.hpp"
+
+namespace crab {
+namespace analyzer {
+template class path_analyzer<clam::cfg_ref_t, clam::wrapped_interval_domain_t>;
+} // end namespace analyzer
+} // end namespace crab
+
+namespace clam {
+
+void registerWrappedIntervalsDomain() {
+  IntraClam_Impl::register_domain<wrapped_interval_domain_t>(WRAPPED_INTERVALS, "wrapped intervals");
+  IntraClam_Impl::register_path_domain<wrapped_interval_domain_t>(WRAPPED_INTERVALS, "wrapped intervals");
+#ifdef HAVE_INTER
+#ifdef TOP_DOWN_INTER_ANALYSIS
+  InterClam_Impl::register_domain<wrapped_interval_domain_t>(WRAPPED_INTERVALS, "wrapped intervals");
+#else
+  InterClam_Impl::register_domain<split_dbm_domain_t, wrapped_interval_domain_t>
+    (ZONES_SPLIT_DBM, WRAPPED_INTERVALS, "bottom-up:zones, top-down:wrapped intervals");
+#endif
+#endif
+}
+
+} // end namespace clam
+
+CLAM_DOMAIN_PLUGIN(registerWrappedIntervalsDomain)
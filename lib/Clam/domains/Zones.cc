@@ -0,0 +1,25 @@
+#include "../ClamImpl.hh"
+#include "../crab/path_analyzer_impl.hpp"
+
+namespace crab {
+namespace analyzer {
+template class path_analyzer<clam::cfg_ref_t, clam::split_dbm_domain_t>;
+} // end namespace analyzer
+} // end namespace crab
+
+namespace clam {
+
+void registerZonesDomain() {
+  IntraClam_Impl::register_domain<split_dbm_domain_t>(ZONES_SPLIT_DBM, "zones");
+  IntraClam_Impl::register_path_domain<split_dbm_domain_t>(ZONES_SPLIT_DBM, "zones");
+#ifdef HAVE_INTER
+#ifdef TOP_DOWN_INTER_ANALYSIS
+  InterClam_Impl::register_domain<split_dbm_domain_t>(ZONES_SPLIT_DBM, "zones");
+#else
+  InterClam_Impl::register_domain<split_dbm_domain_t, split_dbm_domain_t>
+    (ZONES_SPLIT_DBM, ZONES_SPLIT_DBM, "bottom-up:zones, top-down:zones");
+#endif
+#endif
+}
+
+} // end namespace clam
@@ -1,6 +1,12 @@
 #include "clam/config.h"
 #include "clam/Transforms/DevirtFunctions.hh"
 #include "llvm/Pass.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Analysis/CallGraph.h"
 
@@ -269,6 +275,7 @@ namespace clam {
 				 });
 		    } else {
 		      m_stats.m_num_dsa_unresolved++;
+		      m_megamorphic.insert(CS.getInstruction());
 		      DEVIRT_WARNING(errs() << "WARNING Devirt (dsa): unresolve "
 				            << *(CS.getInstruction())
 				            << " because the number of targets is greater than "
@@ -317,6 +324,11 @@ namespace clam {
     return nullptr;
   }
 
+  template<typename Dsa>
+  bool CallSiteResolverByDsa<Dsa>::isMegamorphic(CallSite& CS) {
+    return m_megamorphic.count(CS.getInstruction()) > 0;
+  }
+
   template<typename Dsa>
   Function* CallSiteResolverByDsa<Dsa>::getBounceFunction(CallSite&CS) {
     AliasSetId id = devirt_impl::typeAliasId(CS, false);
@@ -343,15 +355,219 @@ namespace clam {
       
   }
 
+  /* 
+   * Format of the resolution table (text file):
+   *  
+   *   DEVIRT-TABLE <version>
+   *   <key>
+   *   <caller> TAB <index of the callsite in caller> (TAB <target>)*
+   *   ...
+   */
+  static const char* DEVIRT_TABLE_MAGIC = "DEVIRT-TABLE";
+  static const unsigned DEVIRT_TABLE_VERSION = 1;
+
+  template<typename Fn>
+  static void forEachIndirectCall(Function &F, Fn fn) {
+    unsigned idx = 0;
+    for (auto &BB: F) {
+      for (auto &I: BB) {
+	if (isa<CallInst>(&I) || isa<InvokeInst>(&I)) {
+	  CallSite CS(&I);
+	  if (!(isa<CallInst>(&I) && cast<CallInst>(&I)->isInlineAsm()) &&
+	      isIndirectCall(CS)) {
+	    fn(CS, idx);
+	  }
+	}
+	++idx;
+      }
+    }
+  }
+  
+  CallSiteResolverByTable::CallSiteResolverByTable(Module& M, DevirtStats &stats)
+    : CallSiteResolverByTypes(M, stats) {}
+
+  CallSiteResolverByTable::~CallSiteResolverByTable() {
+    m_targets_map.clear();    
+    m_bounce_map.clear();
+  }
+
+  std::unique_ptr<CallSiteResolverByTable>
+  CallSiteResolverByTable::load(Module &M, const std::string &file,
+				const std::string &key, DevirtStats &stats) {
+    auto buf = MemoryBuffer::getFile(file);
+    if (!buf) {
+      return nullptr;
+    }
+    SmallVector<StringRef, 64> lines;
+    (*buf)->getBuffer().split(lines, '\n', -1, /*KeepEmpty=*/false);
+    std::string header = std::string(DEVIRT_TABLE_MAGIC) + " " +
+      std::to_string(DEVIRT_TABLE_VERSION);
+    if (lines.size() < 2 || lines[0] != header || lines[1] != key) {
+      // written by another version or for another module
+      return nullptr;
+    }
+    
+    std::unique_ptr<CallSiteResolverByTable> res(new CallSiteResolverByTable(M, stats));
+    // -- index the indirect calls of the module
+    StringMap<DenseMap<unsigned, Instruction*>> callsites;
+    for (auto &F: M) {
+      if (!F.hasName()) continue;
+      auto &fcallsites = callsites[F.getName()];
+      forEachIndirectCall(F, [&fcallsites](CallSite &CS, unsigned idx) {
+	  fcallsites.insert({idx, CS.getInstruction()});
+	});
+    }
+    
+    for (unsigned i = 2, e = lines.size(); i < e; ++i) {
+      SmallVector<StringRef, 16> fields;
+      lines[i].split(fields, '\t');
+      unsigned idx;
+      if (fields.size() < 3 || fields[1].getAsInteger(10, idx)) {
+	return nullptr;
+      }
+      auto fit = callsites.find(fields[0]);
+      if (fit == callsites.end()) {
+	return nullptr;
+      }
+      auto cit = fit->second.find(idx);
+      if (cit == fit->second.end()) {
+	return nullptr;
+      }
+      AliasSet targets;
+      for (unsigned j = 2, je = fields.size(); j < je; ++j) {
+	const Function *F = M.getFunction(fields[j]);
+	if (!F) {
+	  return nullptr;
+	}
+	targets.push_back(F);
+      }
+      // the order in the file is not the order used by FunctionCompare
+      FunctionCompare cmp;
+      std::sort(targets.begin(), targets.end(), cmp);
+      res->m_targets_map.insert({cit->second, targets});
+    }
+
+    // -- same stats as the resolver which exported the table
+    for (auto &kv: callsites) {
+      stats.m_num_indirect_calls += kv.second.size();
+    }
+    stats.m_num_resolved_calls += res->m_targets_map.size();
+    return res;
+  }
+
+  const CallSiteResolverByTable::AliasSet*
+  CallSiteResolverByTable::getTargets(CallSite& CS) {
+    auto it = m_targets_map.find(CS.getInstruction());
+    if (it != m_targets_map.end()) {
+      return &(it->second);
+    }
+    return nullptr;
+  }
+
+  Function* CallSiteResolverByTable::getBounceFunction(CallSite&CS) {
+    const AliasSet* Targets = getTargets(CS);
+    if (!Targets) {
+      return nullptr;
+    }
+    AliasSetId id = devirt_impl::typeAliasId(CS, false);
+    auto range = m_bounce_map.equal_range(id);
+    for (auto it = range.first; it != range.second; ++it) {
+      const AliasSet* cachedTargets = it->second.first;
+      if (cachedTargets->size() == Targets->size() &&
+	  std::equal(cachedTargets->begin(), cachedTargets->end(),
+		     Targets->begin())) {
+	return it->second.second;
+      }
+    }
+    return nullptr;
+  }
+  
+  void CallSiteResolverByTable::cacheBounceFunction(CallSite& CS, Function* bounce) {
+    if (const AliasSet* targets = getTargets(CS)) {
+      AliasSetId id = devirt_impl::typeAliasId(CS, false);      
+      m_bounce_map.insert({id, {targets, bounce}});
+    }
+  }
+
+  bool exportResolutionTable(Module &M, CallSiteResolver &CSR,
+			     const std::string &file, const std::string &key) {
+    std::string buf;
+    raw_string_ostream os(buf);
+    os << DEVIRT_TABLE_MAGIC << " " << DEVIRT_TABLE_VERSION << "\n" << key << "\n";
+    for (auto &F: M) {
+      if (!F.hasName()) continue;
+      forEachIndirectCall(F, [&os, &CSR, &F](CallSite &CS, unsigned idx) {
+	  const CallSiteResolver::AliasSet* targets = CSR.getTargets(CS);
+	  if (!targets || targets->empty()) return;
+	  // -- sort by name so that the table is deterministic
+	  std::vector<StringRef> names;
+	  for (const Function* T: *targets) {
+	    if (!T->hasName()) return;
+	    names.push_back(T->getName());
+	  }
+	  std::sort(names.begin(), names.end());
+	  os << F.getName() << "\t" << idx;
+	  for (StringRef n: names) {
+	    os << "\t" << n;
+	  }
+	  os << "\n";
+	});
+    }
+    os.flush();
+    
+    // Write first into a temporary file and then rename it so that
+    // concurrent readers never see a partial table.
+    int fd;
+    SmallString<256> tmp_path;
+    if (std::error_code ec =
+	sys::fs::createUniqueFile(file + "-%%%%%%.tmp", fd, tmp_path)) {
+      errs() << "WARNING: cannot write devirtualization table " << file << ": "
+	     << ec.message() << "\n";
+      return false;
+    }
+    {
+      raw_fd_ostream o(fd, /*shouldClose=*/true);
+      o << buf;
+    }
+    if (std::error_code ec = sys::fs::rename(tmp_path, file)) {
+      errs() << "WARNING: cannot write devirtualization table " << file << ": "
+	     << ec.message() << "\n";
+      sys::fs::remove(tmp_path);
+      return false;
+    }
+    return true;
+  }
+
+  std::string getResolutionTableKey(const Module &M,
+				    const std::string &options_str) {
+    SmallString<0> bitcode;
+    raw_svector_ostream os(bitcode);
+    WriteBitcodeToFile(&M, os);
+    MD5 hash;
+    hash.update(bitcode.str());
+    hash.update(options_str);
+    MD5::MD5Result result;
+    hash.final(result);
+    SmallString<32> res;
+    MD5::stringifyResult(result, res);
+    return res.str();
+  }
+  
   /***
    * End specific callsites resolver
    ***/
   
 
   DevirtualizeFunctions::DevirtualizeFunctions(llvm::CallGraph* /*cg*/,
-					       bool allowIndirectCalls)
+					       bool allowIndirectCalls,
+					       bool shareBounceFns,
+					       bool switchBounceFns,
+					       unsigned maxNumTargets)
     : //m_cg(nullptr) 
-      m_allowIndirectCalls(allowIndirectCalls) { }
+      m_allowIndirectCalls(allowIndirectCalls)
+    , m_shareBounceFns(shareBounceFns)
+    , m_switchBounceFns(switchBounceFns)
+    , m_maxNumTargets(maxNumTargets) { }
 
   DevirtualizeFunctions::~DevirtualizeFunctions() {
     m_stats.dump();
@@ -397,6 +613,19 @@ namespace clam {
     FunctionType* NewTy = FunctionType::get (CS.getType(), TP, false);
     Module * M = CS.getInstruction()->getParent()->getParent()->getParent();
     assert (M);
+    Function* F = createBounceFn(NewTy, *Targets, M);
+
+    // -- cache the newly created function
+    CSR->cacheBounceFunction(CS, F);
+    
+    // Return the newly created bounce function.
+    return F;
+  }
+
+  Function* DevirtualizeFunctions::createBounceFn(FunctionType* NewTy,
+						  const AliasSet& Targets,
+						  Module* M) {
+    Type* RetTy = NewTy->getReturnType();
     Function* F = Function::Create (NewTy,
                                     GlobalValue::InternalLinkage,
                                     "seahorn.bounce",
@@ -420,14 +649,24 @@ namespace clam {
     // For each function target, create a basic block that will call that
     // function directly.
     DenseMap<const Function*, BasicBlock*> targets;
-    for (const Function *FL : *Targets) {
+    for (const Function *FL : Targets) {
       // Create the basic block for doing the direct call
       BasicBlock* BL = BasicBlock::Create (M->getContext(), FL->getName(), F);
       targets[FL] = BL;
       // Create the direct function call
       CallingConv::ID cc = FL->getCallingConv();      
+      FunctionType* FLTy = FL->getFunctionType();
+      SmallVector<Value*, 8> args;
+      for (unsigned i = 0, e = fargs.size(); i < e; ++i) {
+	Value* arg = fargs[i];
+	if (i < FLTy->getNumParams() && arg->getType() != FLTy->getParamType(i) &&
+	    arg->getType()->isPointerTy() && FLTy->getParamType(i)->isPointerTy()) {
+	  arg = CastInst::CreatePointerCast(arg, FLTy->getParamType(i), "", BL);
+	}
+	args.push_back(arg);
+      }
       CallInst* directCall = CallInst::Create (const_cast<Function*>(FL),
-                                               fargs, "", BL);
+                                               args, "", BL);
       directCall->setCallingConv(cc);      
       // TODO: update call graph
       // if (m_cg) {
@@ -437,8 +676,12 @@ namespace clam {
       // }
       
       // Add the return instruction for the basic block
-      if (CS.getType()->isVoidTy())
+      if (RetTy->isVoidTy())
         ReturnInst::Create (M->getContext(), BL);
+      else if (directCall->getType() != RetTy &&
+	       directCall->getType()->isPointerTy() && RetTy->isPointerTy())
+        ReturnInst::Create (M->getContext(),
+			    CastInst::CreatePointerCast(directCall, RetTy, "", BL), BL);
       else
         ReturnInst::Create (M->getContext(), directCall, BL);
     }
@@ -447,10 +690,18 @@ namespace clam {
     if (m_allowIndirectCalls) {
       // Create a default basic block having the original indirect call
       defaultBB = BasicBlock::Create (M->getContext(), "default", F);
-      if (CS.getType()->isVoidTy()) {
+      if (RetTy->isVoidTy()) {
 	ReturnInst::Create (M->getContext(), defaultBB);
       } else {
-	CallInst *defaultRet = CallInst::Create(&*(F->arg_begin()), fargs, "", defaultBB);
+	// The function pointer might have been erased to i8*
+	Value* callee = &*(F->arg_begin());
+	FunctionType* calleeTy =
+	  FunctionType::get(RetTy, NewTy->params().drop_front(), false);
+	if (callee->getType() != calleeTy->getPointerTo()) {
+	  callee = CastInst::CreatePointerCast(callee, calleeTy->getPointerTo(),
+					       "", defaultBB);
+	}
+	CallInst *defaultRet = CallInst::Create(callee, fargs, "", defaultBB);
 	ReturnInst::Create (M->getContext(), defaultRet, defaultBB);
       }
     } else {
@@ -464,12 +715,40 @@ namespace clam {
     // basic block.  We'll change the basic block to which it branches later.
     BranchInst * InsertPt = BranchInst::Create (defaultBB, entryBB);
     
-    // Create basic blocks which will test the value of the incoming function
-    // pointer and branch to the appropriate basic block to call the function.
     Type * VoidPtrType = getVoidPtrType (M->getContext());
     Value * FArg = castTo (&*(F->arg_begin()), VoidPtrType, "", InsertPt);
+
+    if (m_switchBounceFns) {
+      // The targets are numbered from 1 by a chain of selects in the
+      // entry block (0 if no target matches) and a single switch
+      // jumps to the block that calls the target. Selects are
+      // translated natively to Crab so the dispatch adds no block
+      // per target.
+      IntegerType * IdxTy = IntegerType::get(M->getContext(), 32);
+      Value * Idx = ConstantInt::get(IdxTy, 0);
+      unsigned i = Targets.size();
+      for (auto it = Targets.rbegin(), et = Targets.rend(); it != et; ++it, --i) {
+	Value * TargetInt =
+	  castTo (const_cast<Function*>(*it), VoidPtrType, "", InsertPt);
+	CmpInst * setcc = CmpInst::Create(Instruction::ICmp,
+					  CmpInst::ICMP_EQ,
+					  TargetInt, FArg, "sc", InsertPt);
+	Idx = SelectInst::Create(setcc, ConstantInt::get(IdxTy, i), Idx,
+				 "idx", InsertPt);
+      }
+      SwitchInst * SI = SwitchInst::Create(Idx, defaultBB, Targets.size(), InsertPt);
+      i = 1;
+      for (const Function *FL : Targets) {
+	SI->addCase(ConstantInt::get(IdxTy, i++), targets[FL]);
+      }
+      InsertPt->eraseFromParent();
+      return F;
+    }
+    
+    // Create basic blocks which will test the value of the incoming function
+    // pointer and branch to the appropriate basic block to call the function.
     BasicBlock * tailBB = defaultBB;
-    for (const Function *FL : *Targets) {
+    for (const Function *FL : Targets) {
       // Cast the function pointer to an integer.  This can go in the entry
       // block.
       Value * TargetInt =
@@ -495,16 +774,127 @@ namespace clam {
     // Make the entry basic block branch to the first comparison basic block.
     InsertPt->setSuccessor(0, tailBB);
 
-    // -- cache the newly created function
-    CSR->cacheBounceFunction(CS, F);
-    
-    // Return the newly created bounce function.
     return F;
   }
 
+  static Type* eraseType(Type* Ty) {
+    return (Ty->isPointerTy() ? getVoidPtrType(Ty->getContext()) : Ty);
+  }
+  
+  Function* DevirtualizeFunctions::mkSharedBounceFn(CallSite &CS, CallSiteResolver* CSR) {
+    assert (isIndirectCall (CS) && "Not an indirect call");
+
+    if (CS.getFunctionType()->isVarArg()) {
+      return nullptr;
+    }
+    
+    const AliasSet* Targets = CSR->getTargets(CS);
+    if (!Targets || Targets->empty()) {
+      return nullptr;
+    }
+
+    // The signature of the bounce function is the one of the callsite
+    // where all pointer types are replaced with i8*, including the
+    // function pointer.
+    SmallVector<Type*, 8> TP;
+    TP.push_back (eraseType(CS.getCalledValue()->getType()));
+    for (auto i = CS.arg_begin(), e = CS.arg_end (); i != e; ++i) 
+      TP.push_back (eraseType((*i)->getType()));
+    FunctionType* NewTy = FunctionType::get (eraseType(CS.getType()), TP, false);
 
+    // Targets is sorted
+    SharedBounceKey key(NewTy, std::vector<const Function*>(Targets->begin(),
+							    Targets->end()));
+    auto it = m_shared_bounce_map.find(key);
+    if (it != m_shared_bounce_map.end()) {
+      DEVIRT_LOG(errs() << "Sharing bounce function for " << *(CS.getInstruction()) 
+		 << "\n\t" << it->second->getName() << "::"
+		 << *(it->second->getType()) << "\n";);
+      return it->second;
+    }
+
+    Module * M = CS.getInstruction()->getParent()->getParent()->getParent();
+    assert (M);
+    Function* F = createBounceFn(NewTy, *Targets, M);
+    m_shared_bounce_map.insert({key, F});
+    return F;
+  }
+  
+  bool DevirtualizeFunctions::isMegamorphic(CallSite &CS, CallSiteResolver* CSR) {
+    if (m_maxNumTargets == 0) {
+      return false;
+    }
+    if (CSR->isMegamorphic(CS)) {
+      return true;
+    }
+    const AliasSet* Targets = CSR->getTargets(CS);
+    return Targets && Targets->size() > m_maxNumTargets;
+  }
+
+  Function* DevirtualizeFunctions::getHavocFn(FunctionType* Ty, Module* M) {
+    auto it = m_havoc_fns.find(Ty);
+    if (it != m_havoc_fns.end()) {
+      return it->second;
+    }
+    // -- an external function: the analysis havocs its return value
+    Function* F = Function::Create (Ty, GlobalValue::ExternalLinkage,
+				    "seahorn.bounce.havoc", M);
+    m_havoc_fns.insert({Ty, F});
+    return F;
+  }
+  
+  void DevirtualizeFunctions::mkHavocCall(CallSite &CS) {
+    Instruction* I = CS.getInstruction();
+    Module * M = I->getParent()->getParent()->getParent();
+    Function* havocFn = getHavocFn(CS.getFunctionType(), M);
+    SmallVector<Value*, 8> Params(CS.arg_begin(), CS.arg_end());
+    std::string name = I->hasName() ? I->getName().str() + ".dv" : "";
+    Instruction* CN = nullptr;
+    if (InvokeInst* II = dyn_cast<InvokeInst>(I)) {
+      CN = InvokeInst::Create (havocFn, II->getNormalDest(), II->getUnwindDest(),
+			       Params, name, II);
+    } else {
+      CN = CallInst::Create (havocFn, Params, name, I);
+    }
+    CN->setDebugLoc (I->getDebugLoc ());
+    I->replaceAllUsesWith(CN);
+    I->eraseFromParent();
+  }
+  
   void DevirtualizeFunctions::mkDirectCall(CallSite CS, CallSiteResolver* CSR) {
     m_stats.m_num_indirect_calls++;
+
+    // -- too many targets: the call does not dominate the analysis
+    if (isMegamorphic(CS, CSR)) {
+      DEVIRT_WARNING(errs() << "WARNING Devirt: " << *(CS.getInstruction())
+		            << " has more than " << m_maxNumTargets
+		            << " targets and it is replaced with a havoc\n";);
+      m_stats.m_num_megamorphic++;
+      mkHavocCall(CS);
+      return;
+    }
+
+    // -- the result of an invoke cannot be easily casted back so
+    // -- invokes always get their own bounce function.
+    if (m_shareBounceFns && isa<CallInst>(CS.getInstruction())) {
+      if (Function* bounceFn = mkSharedBounceFn(CS, CSR)) {
+	m_stats.m_num_resolved_calls++;
+	CallInst* CI = cast<CallInst>(CS.getInstruction());
+	FunctionType* bounceTy = bounceFn->getFunctionType();
+	SmallVector<Value*, 8> Params;
+	Params.push_back(castTo(CS.getCalledValue(), bounceTy->getParamType(0), "", CI));
+	unsigned i = 1;
+	for (auto ai = CS.arg_begin(), ae = CS.arg_end(); ai != ae; ++ai, ++i) {
+	  Params.push_back(castTo(*ai, bounceTy->getParamType(i), "", CI));
+	}
+	std::string name = CI->hasName() ? CI->getName().str() + ".dv" : "";
+	CallInst* CN = CallInst::Create (bounceFn, Params, name, CI);
+	CN->setDebugLoc (CI->getDebugLoc ());
+	CI->replaceAllUsesWith(castTo(CN, CI->getType(), "", CI));
+	CI->eraseFromParent();
+	return;
+      }
+    }
     
     const Function *bounceFn = mkBounceFn(CS, CSR);
     // -- something failed
@@ -619,7 +1009,8 @@ namespace clam {
     errs() << "BRUNCH_STAT RESOLVED CALLS " << m_num_resolved_calls << "\n";
     errs() << "BRUNCH_STAT UNRESOLVED BY DSA " << m_num_dsa_unresolved << "\n";
     errs() << "BRUNCH_STAT UNRESOLVED BY TYPE SIGNATURE " << m_num_type_unresolved
-	   << "\n\n";
+	   << "\n";
+    errs() << "BRUNCH_STAT MEGAMORPHIC CALLS " << m_num_megamorphic << "\n\n";
   }
 } // end namespace
 
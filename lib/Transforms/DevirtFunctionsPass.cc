@@ -7,6 +7,7 @@
 #include "llvm/Pass.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 
 #ifdef HAVE_DSA
@@ -46,6 +47,36 @@ MaxNumTargets("devirt-max-num-targets",
       llvm::cl::desc("Do not resolve if number of targets is greater than this number."),
       llvm::cl::init(9999));
 
+static llvm::cl::opt<bool>
+HavocMegamorphic("devirt-havoc-megamorphic",
+      llvm::cl::desc("Replace indirect calls with more than --devirt-max-num-targets "
+		     "targets with a call to an external function"),
+      llvm::cl::init(true));
+
+static llvm::cl::opt<bool>
+SwitchBounceFunctions("devirt-switch-bounce-functions",
+      llvm::cl::desc("Dispatch in bounce functions with a single switch "
+		     "instead of a chain of comparisons"),
+      llvm::cl::init(true));
+
+static llvm::cl::opt<bool>
+ShareBounceFunctions("devirt-share-bounce-functions",
+      llvm::cl::desc("Share bounce functions between indirect calls with the "
+		     "same targets and signature modulo pointer types"),
+      llvm::cl::init(false));
+
+static llvm::cl::opt<std::string>
+DevirtTableExport("devirt-table-export",
+      llvm::cl::desc("Write the resolved targets of all indirect calls into a file"),
+      llvm::cl::init(""), llvm::cl::value_desc("filename"));
+
+static llvm::cl::opt<std::string>
+DevirtTableImport("devirt-table-import",
+      llvm::cl::desc("Resolve indirect calls from a file written by "
+		     "--devirt-table-export for the same module and options "
+		     "(pointer analysis is not run)"),
+      llvm::cl::init(""), llvm::cl::value_desc("filename"));
+
 using namespace llvm;
 
 namespace clam {
@@ -56,14 +87,49 @@ namespace clam {
     static char ID;
     
     DevirtualizeFunctionsPass(): ModulePass(ID) {}
-      
+
+    // If true then the pointer analysis is not required
+    static bool hasImportTable() {
+      return DevirtTableImport != "" && sys::fs::exists(DevirtTableImport);
+    }
+    
+    static std::string getTableKey(const Module &M) {
+      std::string buf;
+      raw_string_ostream o(buf);
+      o << "resolver=" << static_cast<int>(DevirtResolver)
+	<< ",incomplete=" << (ResolveIncompleteCalls ? 1 : 0)
+	<< ",max-targets=" << static_cast<unsigned>(MaxNumTargets);
+      return getResolutionTableKey(M, o.str());
+    }
+    
     virtual bool runOnModule(Module & M) {
       // -- Get the call graph: unused for now
       // CallGraph* CG = &(getAnalysis<CallGraphWrapperPass> ().getCallGraph ());
       
-      DevirtualizeFunctions DF(/*CG*/ nullptr, AllowIndirectCalls);
+      DevirtualizeFunctions DF(/*CG*/ nullptr, AllowIndirectCalls,
+			       ShareBounceFunctions, SwitchBounceFunctions,
+			       HavocMegamorphic ? (unsigned) MaxNumTargets : 0);
       std::unique_ptr<CallSiteResolver> CSR;
-      switch(DevirtResolver) {
+      std::string key;
+      bool exportTable = DevirtTableExport != "";
+      if (DevirtTableImport != "" || exportTable) {
+	// -- the key must be computed before any callsite is resolved
+	key = getTableKey(M);
+      }
+      
+      if (hasImportTable()) {
+	CSR = CallSiteResolverByTable::load(M, DevirtTableImport, key, DF.getStats());
+	if (!CSR) {
+	  // The pointer analysis was not scheduled so we can only use types.
+	  errs() << "WARNING: ignored devirtualization table " << DevirtTableImport
+		 << " computed for other module or options\n";
+	  CSR.reset(new CallSiteResolverByTypes(M, DF.getStats()));
+	  // -- do not record the weaker resolution under the same key
+	  exportTable = false;
+	}
+      }
+      
+      if (!CSR) switch(DevirtResolver) {
       case RESOLVER_DSA: {
 #ifdef HAVE_DSA
 	// -- Access to analysis pass which finds targets of indirect function calls
@@ -92,11 +158,19 @@ namespace clam {
 	break;
       }
       
+      if (exportTable) {
+	exportResolutionTable(M, *CSR, DevirtTableExport, key);
+      }
+      
       bool res = DF.resolveCallSites(M, &*CSR);
       return res;
     }      
     
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      if (hasImportTable()) {
+	return;
+      }
+      
       bool runSeaDsa = false;
       
       if (DevirtResolver == RESOLVER_DSA) {
@@ -0,0 +1,112 @@
+/** 
+ * Lower constant expressions, ULT/ULE comparisons and select
+ * instructions in a single walk over each function.
+ *
+ * It is equivalent to running LowerCstExpr, LowerUnsignedICmp and
+ * LowerSelect in this order but without the cleanup passes between
+ * them.
+ **/
+
+#include "llvm/Pass.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+
+#include <vector>
+
+#include "Lowering.hh"
+
+namespace clam {
+
+  using namespace llvm;
+  
+  class FusedLowering: public FunctionPass {
+    bool m_lower_cst_expr;
+    bool m_lower_unsigned_icmp;
+    bool m_lower_select;
+    // lower each constant expression once per function
+    bool m_shared_cst_expr;
+
+    void addCandidate(Instruction *I,
+		      std::vector<ICmpInst*> &icmps,
+		      std::vector<SelectInst*> &selects) {
+      if (ICmpInst *CI = dyn_cast<ICmpInst>(I)) {
+	if (m_lower_unsigned_icmp && isLowerableUnsignedICmp(CI)) {
+	  icmps.push_back(CI);
+	}
+      } else if (SelectInst *SI = dyn_cast<SelectInst>(I)) {
+	if (m_lower_select && isLowerableSelect(SI)) {
+	  selects.push_back(SI);
+	}
+      }
+    }
+    
+  public:
+    
+    static char ID;
+    
+    FusedLowering(bool lowerCstExpr = true, bool lowerUnsignedICmp = true,
+		  bool lowerSelect = true, bool sharedCstExpr = false)
+      : FunctionPass(ID)
+      , m_lower_cst_expr(lowerCstExpr)
+      , m_lower_unsigned_icmp(lowerUnsignedICmp)
+      , m_lower_select(lowerSelect)
+      , m_shared_cst_expr(sharedCstExpr) {}
+    
+    virtual bool runOnFunction(Function &F) {
+      SmallPtrSet<Instruction*, 8> cstexprs;
+      std::vector<ICmpInst*> icmps;
+      std::vector<SelectInst*> selects;
+      for (inst_iterator It = inst_begin(F), E = inst_end(F); It != E; ++It) {
+	Instruction *I = &*It;
+	if (m_lower_cst_expr && hasCstExprOperand(I)) {
+	  cstexprs.insert(I);
+	}
+	addCandidate(I, icmps, selects);
+      }
+
+      bool change = false;
+      if (!cstexprs.empty()) {
+	// -- the lowered constant expressions can be also comparisons
+	// -- or selects
+	std::vector<Instruction*> newInsts;
+	change |= lowerCstExprs(cstexprs, &newInsts, m_shared_cst_expr);
+	for (Instruction *I: newInsts) {
+	  addCandidate(I, icmps, selects);
+	}
+      }
+      
+      change |= (!icmps.empty() || !selects.empty());
+      // -- lowering a comparison or a select splits blocks but it never
+      // -- removes other instructions
+      while (!icmps.empty()) {
+	ICmpInst *CI = icmps.back();
+	icmps.pop_back();
+	lowerUnsignedICmpInst(CI);
+      }
+      while (!selects.empty()) {
+	SelectInst *SI = selects.back();
+	selects.pop_back();
+	lowerSelectInst(SI);
+      }
+      return change;
+    }
+    
+    virtual StringRef getPassName() const {
+      return "Clam: Lower constant expressions, unsigned comparisons and selects";
+    }
+    
+    virtual void getAnalysisUsage (AnalysisUsage &AU) const {
+      //AU.setPreservesAll ();
+    }
+  };
+
+  char FusedLowering::ID = 0;
+  
+  Pass* createFusedLoweringPass(bool lowerCstExpr, bool lowerUnsignedICmp,
+				bool lowerSelect, bool sharedCstExpr) {
+    return new FusedLowering(lowerCstExpr, lowerUnsignedICmp, lowerSelect,
+			     sharedCstExpr);
+  }
+  
+} // end namespace
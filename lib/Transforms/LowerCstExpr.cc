@@ -4,85 +4,155 @@
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstIterator.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 
+#include <memory>
+
+#include "Lowering.hh"
+
 namespace clam {
   
   using namespace llvm;
 
-  class LowerCstExpr: public ModulePass {
-    
-    ConstantExpr* hasCstExpr(Value *V) {
-      // We only handle top-level constant expressions ignoring
-      // constant subexpressions
-      if (Constant * cst = dyn_cast<Constant>(V)) {
-        if (ConstantExpr * ce = dyn_cast<ConstantExpr>(cst)) {
-          return ce;
-	}
+  static ConstantExpr* hasCstExpr(Value *V) {
+    // We only handle top-level constant expressions ignoring
+    // constant subexpressions
+    if (Constant * cst = dyn_cast<Constant>(V)) {
+      if (ConstantExpr * ce = dyn_cast<ConstantExpr>(cst)) {
+        return ce;
       }
-      return nullptr;
     }
+    return nullptr;
+  }
 
-    Instruction * lowerCstExpr(ConstantExpr* CstExp, 
-                               Instruction* InsertionLoc) {
-      Instruction* NewI = CstExp->getAsInstruction ();
-      // insert before
-      InsertionLoc->getParent()->getInstList().insert(InsertionLoc->getIterator(), NewI); 
-      return NewI;
+  static Instruction * lowerCstExpr(ConstantExpr* CstExp, 
+                                    Instruction* InsertionLoc) {
+    Instruction* NewI = CstExp->getAsInstruction ();
+    // insert before
+    InsertionLoc->getParent()->getInstList().insert(InsertionLoc->getIterator(), NewI); 
+    return NewI;
+  }
+
+  namespace {
+  /// Lowering of the constant expressions of a function shared by
+  /// all their uses. The instructions are inserted in order at the
+  /// start of the entry block after the lowering of their constant
+  /// subexpressions, so they dominate all the uses.
+  class SharedCstExprs {
+    Instruction *m_loc;
+    DenseMap<ConstantExpr*, Instruction*> m_lowered;
+  public:
+    SharedCstExprs(Function &F)
+      : m_loc(&*F.getEntryBlock().getFirstInsertionPt()) {}
+
+    // An expression that can trap is lowered at its use
+    static bool isShareable(ConstantExpr *CstExp) {
+      return !CstExp->canTrap();
     }
-        
-    bool runOnFunction(Function & F) {
-      SmallPtrSet<Instruction*, 8> worklist;
-      for (inst_iterator It = inst_begin(F), E = inst_end(F); It != E; ++It) {
-        Instruction *I = &*It;
-        for (unsigned int i=0; i < I->getNumOperands(); ++i) {
-          if (hasCstExpr (I->getOperand(i))) 
-            worklist.insert (I);
-        }
+
+    Instruction *lower(ConstantExpr *CstExp,
+                       SmallPtrSetImpl<Instruction*> &worklist,
+                       std::vector<Instruction*> *newInsts) {
+      auto it = m_lowered.find(CstExp);
+      if (it != m_lowered.end())
+        return it->second;
+      Instruction *NewI = CstExp->getAsInstruction();
+      for (unsigned int i = 0; i < NewI->getNumOperands(); ++i) {
+        ConstantExpr *Sub = hasCstExpr(NewI->getOperand(i));
+        if (Sub && isShareable(Sub))
+          NewI->setOperand(i, lower(Sub, worklist, newInsts));
       }
+      NewI->insertBefore(m_loc);
+      m_lowered[CstExp] = NewI;
+      worklist.insert(NewI);
+      if (newInsts) newInsts->push_back(NewI);
+      return NewI;
+    }
+  };
+  } // end anonymous namespace
+
+  bool hasCstExprOperand(Instruction *I) {
+    for (unsigned int i=0; i < I->getNumOperands(); ++i) {
+      if (hasCstExpr (I->getOperand(i))) 
+        return true;
+    }
+    return false;
+  }
+  
+  bool lowerCstExprs(SmallPtrSetImpl<Instruction*> &worklist,
+                     std::vector<Instruction*> *newInsts,
+                     bool shared) {
+    bool change = !worklist.empty ();
+    std::unique_ptr<SharedCstExprs> sharedExprs;
+    if (shared && change)
+      sharedExprs.reset(new SharedCstExprs(*(*worklist.begin())->getFunction()));
+    while (!worklist.empty()) {
+      auto It = worklist.begin ();
+      Instruction*I = *It;
+      worklist.erase (*It);
       
-      bool change = !worklist.empty ();
-      while (!worklist.empty()) {
-        auto It = worklist.begin ();
-        Instruction*I = *It;
-        worklist.erase (*It);
-        
-        if (PHINode * PHI = dyn_cast<PHINode>(I)) {
-          for (unsigned int i = 0; i < PHI->getNumIncomingValues (); ++i) {
-            Instruction* InsertLoc = PHI->getIncomingBlock (i)->getTerminator ();        
-            assert(InsertLoc);
-            if (ConstantExpr * CstExp = hasCstExpr (PHI->getIncomingValue(i))) {
-	      // skip if CstExp is not the same as incoming PHI value
-	      if (CstExp != PHI->getIncomingValue(i))
-		continue;
-              Instruction* NewInst = lowerCstExpr (CstExp, InsertLoc);
-              for (unsigned int j= PHI->getNumIncomingValues(); j>i; --j) {
-                if ( (PHI->getIncomingValue(j-1) == PHI->getIncomingValue (i)) &&
-                     (PHI->getIncomingBlock(j-1) == PHI->getIncomingBlock (i))) {
-                  PHI->setIncomingValue (j-1, NewInst);
-                }
+      if (PHINode * PHI = dyn_cast<PHINode>(I)) {
+        for (unsigned int i = 0; i < PHI->getNumIncomingValues (); ++i) {
+          Instruction* InsertLoc = PHI->getIncomingBlock (i)->getTerminator ();        
+          assert(InsertLoc);
+          if (ConstantExpr * CstExp = hasCstExpr (PHI->getIncomingValue(i))) {
+            // skip if CstExp is not the same as incoming PHI value
+            if (CstExp != PHI->getIncomingValue(i))
+              continue;
+            if (sharedExprs && SharedCstExprs::isShareable(CstExp)) {
+              PHI->setIncomingValue(i, sharedExprs->lower(CstExp, worklist, newInsts));
+              continue;
+            }
+            Instruction* NewInst = lowerCstExpr (CstExp, InsertLoc);
+            for (unsigned int j= PHI->getNumIncomingValues(); j>i; --j) {
+              if ( (PHI->getIncomingValue(j-1) == PHI->getIncomingValue (i)) &&
+                   (PHI->getIncomingBlock(j-1) == PHI->getIncomingBlock (i))) {
+                PHI->setIncomingValue (j-1, NewInst);
               }
-              worklist.insert (NewInst);
             }
+            worklist.insert (NewInst);
+            if (newInsts) newInsts->push_back(NewInst);
           }
-        } else { 
-          for (unsigned int i=0; i < I->getNumOperands (); ++i) {
-            if (ConstantExpr* CstExp = hasCstExpr (I->getOperand(i))) {
-              Instruction * NewInst = lowerCstExpr (CstExp, I);
-              I->replaceUsesOfWith (CstExp, NewInst);
-              worklist.insert (NewInst);
+        }
+      } else { 
+        for (unsigned int i=0; i < I->getNumOperands (); ++i) {
+          if (ConstantExpr* CstExp = hasCstExpr (I->getOperand(i))) {
+            if (sharedExprs && SharedCstExprs::isShareable(CstExp)) {
+              I->setOperand(i, sharedExprs->lower(CstExp, worklist, newInsts));
+              continue;
             }
+            Instruction * NewInst = lowerCstExpr (CstExp, I);
+            I->replaceUsesOfWith (CstExp, NewInst);
+            worklist.insert (NewInst);
+            if (newInsts) newInsts->push_back(NewInst);
           }
         }
       }
-      return change;
+    }
+    return change;
+  }
+  
+  class LowerCstExpr: public ModulePass {
+
+    // lower each constant expression once per function
+    bool m_shared;
+    
+    bool runOnFunction(Function & F) {
+      SmallPtrSet<Instruction*, 8> worklist;
+      for (inst_iterator It = inst_begin(F), E = inst_end(F); It != E; ++It) {
+        Instruction *I = &*It;
+        if (hasCstExprOperand(I))
+          worklist.insert (I);
+      }
+      return lowerCstExprs(worklist, nullptr, m_shared);
     }
     
    public:
     
     static char ID; 
     
-    LowerCstExpr(): ModulePass (ID) {}
+    LowerCstExpr(bool shared = false): ModulePass (ID), m_shared (shared) {}
     
     virtual bool runOnModule(Module &M) {
      bool change = false;
@@ -101,6 +171,6 @@ namespace clam {
   };
 
   char LowerCstExpr::ID = 0;
-  Pass* createLowerCstExprPass () { return new LowerCstExpr (); }
+  Pass* createLowerCstExprPass (bool shared) { return new LowerCstExpr (shared); }
 
 } // end namespace 
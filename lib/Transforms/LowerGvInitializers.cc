@@ -25,6 +25,14 @@
  * The reason to treat specially ConstantAggregateZero is to be able
  * to model it in a concise way via special functions (understood by
  * the analyzer) to avoid having too many Store instructions.
+ *
+ * For the same reason, an array of integers with more elements than
+ * --crab-lower-gv-summary-array-size is not lowered into one Store per
+ * element. Instead, it is summarized by the range of its elements:
+ *
+ *   @t = internal global [4096 x i16] [i16 3, i16 -7, ...]
+ *
+ *   call void @verifier.range_initializer.1([4096 x i16]* @t, i16 -7, i16 90)
  */
 
 #include "llvm/Pass.h"
@@ -40,6 +48,8 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/GlobalStatus.h"
 
+#include <algorithm>
+
 #include "clam/Support/Boost.hh"
 #include "boost/range.hpp"
 #include "boost/format.hpp"
@@ -68,6 +78,12 @@ MaxStructSize("crab-lower-gv-max-struct-size",
       llvm::cl::desc("Do not lower the struct if its size is greater than threshold"),
       llvm::cl::init(1024));
 
+static llvm::cl::opt<unsigned>
+SummaryArraySize("crab-lower-gv-summary-array-size",
+      llvm::cl::desc("Summarize an array of integers by the range of its elements "
+		     "if its size is greater than threshold"),
+      llvm::cl::init(1024));
+
 namespace clam {
 
   class LowerGvInitializers : public ModulePass {
@@ -196,6 +212,67 @@ namespace clam {
       Builder.CreateCall(intfn, {&gv, gv.getInitializer()});
     }
 
+    Constant* getRangeInitFn(Type *ty, std::vector<Constant*> &LLVMUsed, Module &m) {
+      assert(ty->isPointerTy());
+      ArrayType *ATy = cast<ArrayType>(cast<PointerType>(ty)->getElementType());
+      Type *ETy = ATy->getElementType();
+      Constant* res = m_rangefn[ty];
+      if (res == NULL) {
+	res = m.getOrInsertFunction 
+	  (boost::str 
+	   (boost::format ("verifier.range_initializer.%d") % m_rangefn.size ()), 
+	   m_voidty, ty, ETy, ETy);
+	m_rangefn[ty] = res;
+	Type *i8PTy = Type::getInt8PtrTy(m.getContext ());
+	LLVMUsed.push_back(ConstantExpr::getBitCast(res, i8PTy));
+	if (m_cg) m_cg->getOrInsertFunction(cast<Function>(res));
+      }
+      return res;
+    }
+
+    // Return true if C is an array of integers that should be
+    // summarized by the range of its elements.
+    static bool isSummarizedArray(const Constant *C) {
+      ArrayType *ATy = dyn_cast<ArrayType>(C->getType());
+      if (!ATy || !ATy->getElementType()->isIntegerTy() ||
+	  ATy->getNumElements() <= SummaryArraySize) {
+	return false;
+      }
+      if (const ConstantDataSequential *CDS = dyn_cast<ConstantDataSequential>(C)) {
+	return !(CDS->isString() || CDS->isCString());
+      }
+      if (isa<ConstantArray>(C)) {
+	return std::all_of(C->op_begin(), C->op_end(),
+			   [](const Use &U) { return isa<ConstantInt>(U.get()); });
+      }
+      return false;
+    }
+
+    void CreateRangeInitializerCallSite(const Constant &C, Value &base,
+					const std::vector<APInt> &Indices,
+					IRBuilder<> &Builder,
+					std::vector<Constant*> &LLVMUsed,
+					Module &M) {
+      const ArrayType *ATy = cast<ArrayType>(C.getType());
+      const ConstantInt *Min = nullptr, *Max = nullptr;
+      for (unsigned i = 0, e = ATy->getNumElements(); i < e; ++i) {
+	const ConstantInt *CI = cast<ConstantInt>(C.getAggregateElement(i));
+	if (!Min || CI->getValue().slt(Min->getValue())) {
+	  Min = CI;
+	}
+	if (!Max || CI->getValue().sgt(Max->getValue())) {
+	  Max = CI;
+	}
+      }
+      LOWERGV_LOG(errs() << "\tCreating rangeInitializer function with min="
+		         << *Min << " and max=" << *Max << "\n";);
+      
+      Value *ptr = Builder.CreateInBoundsGEP(&base, CreateGEPIndices(Indices));
+      Constant *f = getRangeInitFn(ptr->getType(), LLVMUsed, M);
+      Builder.CreateCall(f, {ptr, const_cast<ConstantInt*>(Min),
+			     const_cast<ConstantInt*>(Max)});
+    }
+    
     bool LowerConstantAggregateZero(Type* T, Value &base,
 				    IRBuilder<> &Builder, Module &M,
 				    std::vector<Constant*> &LLVMUsed,
@@ -277,6 +354,9 @@ namespace clam {
 	  isa<ConstantFP>(C) ||
 	  isa<UndefValue>(C)) {
 	// ignore these cases
+      } else if (isSummarizedArray(C)) {
+	CreateRangeInitializerCallSite(*C, Base, Indices, Builder, LLVMUsed, M);
+	change = true;
       } else if (const ConstantDataSequential *CDS = dyn_cast<ConstantDataSequential>(C)) {
 	// ignore C strings
 	if (!(CDS->isString() || CDS->isCString())) {
@@ -434,6 +514,8 @@ namespace clam {
     
     /** map for initializer functions */
     DenseMap<const Type*, Constant*> m_initfn;
+    /** map for range initializer functions */
+    DenseMap<const Type*, Constant*> m_rangefn;
     /** void type **/
     Type *m_voidty;
     /** gep index types **/
@@ -10,6 +10,8 @@
 
 #include <vector>
 
+#include "Lowering.hh"
+
 //#define DEBUG_TYPE "lower-selects"
 
 namespace clam
@@ -18,61 +20,66 @@ namespace clam
 
   //STATISTIC(totalLowered, "Number of Lowered Select Instructions");
 
+  bool isLowerableSelect(SelectInst *SI) {
+    // we ignore vector operations
+    return SI->getCondition()->getType()->isIntegerTy(1);
+  }
+  
+  // Lower the select instruction into three new blocks.
+  void lowerSelectInst(SelectInst *SI) {
+  
+    BasicBlock *curBlk = SI->getParent();
+    Function   *F      = curBlk->getParent();
+    Value *Flag        = SI->getCondition();  
+  
+    /// This splits a basic block into two at the specified instruction.
+    /// All instructions BEFORE the specified iterator stay as part of
+    /// the original basic block, an unconditional branch is added to
+    /// the original BB, and the rest of the instructions in the BB are
+    /// moved to the new BB, including the old terminator.
+    /// IMPORTANT: this function invalidates the specified iterator.
+    /// IMPORTANT: note that the select instructions goes to afterSelect
+    /// Also note that this doesn't preserve any passes. To split blocks
+    /// while keeping loop information consistent, use the SplitBlock
+    /// utility function.
+    BasicBlock * afterSelect = curBlk->splitBasicBlock (SI, 
+                                                        curBlk->getName() + "LowerSelect"); 
+  
+    BasicBlock* trueBlock  = BasicBlock::Create (F->getContext(),
+                                                 "TrueLowerSelect",F,afterSelect);
+    BasicBlock* falseBlock = BasicBlock::Create (F->getContext(),
+                                                 "FalseLowerSelect",F,afterSelect);
+  
+    /// Wire trueBlock and falseblock to afterSelect via unconditional
+    /// branch
+    BranchInst::Create (afterSelect,trueBlock);
+    BranchInst::Create (afterSelect,falseBlock);
+  
+    /// Replace the the unconditional branch added by splitBasicBlock
+    /// with a conditional branch splitting on Flag **at the end** of
+    /// curBlk
+    curBlk->getTerminator()->eraseFromParent();
+    BranchInst::Create (trueBlock, falseBlock, Flag, curBlk);
+  
+    // Insert a phi node just before the select instruction.
+    PHINode *PHI=PHINode::Create (SI->getOperand(1)->getType(), 
+                                  0,
+                                  "PHILowerSelect", 
+                                  SI);
+  
+    PHI->addIncoming (SI->getOperand(1),trueBlock);
+    PHI->addIncoming (SI->getOperand(2),falseBlock);
+  
+    // Make sure any users of the select is now an user of the phi node.
+    SI->replaceAllUsesWith(PHI);
+  
+    // Finally we remove the select instruction
+    SI->eraseFromParent();
+ 
+    //totalLowered++;
+  }
+
   class LowerSelect: public FunctionPass  {
-    // Lower the select instruction into three new blocks.
-    void processSelectInst(SelectInst *SI) {
-      
-      BasicBlock *curBlk = SI->getParent();
-      Function   *F      = curBlk->getParent();
-      Value *Flag        = SI->getCondition();  
-      
-      /// This splits a basic block into two at the specified instruction.
-      /// All instructions BEFORE the specified iterator stay as part of
-      /// the original basic block, an unconditional branch is added to
-      /// the original BB, and the rest of the instructions in the BB are
-      /// moved to the new BB, including the old terminator.
-      /// IMPORTANT: this function invalidates the specified iterator.
-      /// IMPORTANT: note that the select instructions goes to afterSelect
-      /// Also note that this doesn't preserve any passes. To split blocks
-      /// while keeping loop information consistent, use the SplitBlock
-      /// utility function.
-      BasicBlock * afterSelect = curBlk->splitBasicBlock (SI, 
-                                                          curBlk->getName() + "LowerSelect"); 
-      
-      BasicBlock* trueBlock  = BasicBlock::Create (F->getContext(),
-                                                   "TrueLowerSelect",F,afterSelect);
-      BasicBlock* falseBlock = BasicBlock::Create (F->getContext(),
-                                                   "FalseLowerSelect",F,afterSelect);
-      
-      /// Wire trueBlock and falseblock to afterSelect via unconditional
-      /// branch
-      BranchInst::Create (afterSelect,trueBlock);
-      BranchInst::Create (afterSelect,falseBlock);
-      
-      /// Replace the the unconditional branch added by splitBasicBlock
-      /// with a conditional branch splitting on Flag **at the end** of
-      /// curBlk
-      curBlk->getTerminator()->eraseFromParent();
-      BranchInst::Create (trueBlock, falseBlock, Flag, curBlk);
-      
-      // Insert a phi node just before the select instruction.
-      PHINode *PHI=PHINode::Create (SI->getOperand(1)->getType(), 
-                                    0,
-                                    "PHILowerSelect", 
-                                    SI);
-      
-      PHI->addIncoming (SI->getOperand(1),trueBlock);
-      PHI->addIncoming (SI->getOperand(2),falseBlock);
-      
-      // Make sure any users of the select is now an user of the phi node.
-      SI->replaceAllUsesWith(PHI);
-      
-      // Finally we remove the select instruction
-      SI->eraseFromParent();
-     
-      //totalLowered++;
-    }
-    
    public:
     
     static char ID;   
@@ -88,8 +95,7 @@ namespace clam
       for (inst_iterator It = inst_begin(F), E = inst_end(F); It != E; ++It) {
         Instruction *inst = &*It;
         if (SelectInst * SI = dyn_cast<SelectInst>(inst)) {
-          if (SI->getCondition()->getType()->isIntegerTy(1)) {
-	    // we ignore vector operations
+          if (isLowerableSelect(SI)) {
 	    worklist.push_back(SI);
 	  }
         }
@@ -99,7 +105,7 @@ namespace clam
         modified=true;
         SelectInst * SI = worklist.back();
         worklist.pop_back();
-        processSelectInst(SI);
+        lowerSelectInst(SI);
       }
       
       return modified;
@@ -0,0 +1,43 @@
+#pragma once
+
+/* Rewrites shared by the lowering passes and FusedLowering */
+
+#include "llvm/ADT/SmallPtrSet.h"
+
+#include <vector>
+
+namespace llvm {
+class Instruction;
+class ICmpInst;
+class SelectInst;
+} // namespace llvm
+
+namespace clam {
+
+// LowerCstExpr.cc
+
+// Return true if some operand of I is a constant expression.
+bool hasCstExprOperand(llvm::Instruction *I);
+// Replace the constant expressions used by the instructions in
+// worklist with new instructions. If newInsts is not null then it
+// contains all the new instructions. If shared then the instructions
+// of worklist are from the same function and each constant
+// expression that cannot trap is lowered once, in the entry block,
+// for all its uses.
+bool lowerCstExprs(llvm::SmallPtrSetImpl<llvm::Instruction *> &worklist,
+                   std::vector<llvm::Instruction *> *newInsts,
+                   bool shared);
+
+// LowerUnsignedICmp.cc
+
+// Return true if CI is an ULT or ULE over integers. It might swap the
+// operands of CI.
+bool isLowerableUnsignedICmp(llvm::ICmpInst *CI);
+void lowerUnsignedICmpInst(llvm::ICmpInst *CI);
+
+// LowerSelect.cc
+
+bool isLowerableSelect(llvm::SelectInst *SI);
+void lowerSelectInst(llvm::SelectInst *SI);
+
+} // end namespace clam
@@ -0,0 +1,180 @@
+#include "llvm/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+namespace clam {
+
+  /// marks with AlwaysInline the call sites of the internal functions
+  /// that are worth inlining for the analysis: the callees that are
+  /// small, called from few call sites or that reach an assertion.
+  /// The growth of each caller (in instructions) is bounded by a
+  /// budget.
+  struct MarkSelectiveInline : public ModulePass
+  {
+    static char ID;
+
+    // a callee is small if it has at most m_max_size instructions
+    // (after inlining its own call sites)
+    unsigned m_max_size;
+    // a callee is called few times if it has at most m_max_calls
+    // call sites
+    unsigned m_max_calls;
+    // max number of instructions added to a caller by inlining
+    unsigned m_caller_budget;
+    // print the call sites inlined and the growth of each caller
+    bool m_report;
+
+    MarkSelectiveInline (unsigned max_size, unsigned max_calls,
+			 unsigned caller_budget, bool report)
+      : ModulePass (ID), m_max_size (max_size), m_max_calls (max_calls),
+	m_caller_budget (caller_budget), m_report (report) {}
+
+    void getAnalysisUsage (AnalysisUsage &AU) const
+    {
+      AU.addRequired<CallGraphWrapperPass> ();
+      AU.setPreservesAll ();
+    }
+
+    static bool isAssertFn (const Function &F)
+    {
+      return (F.getName ().equals ("verifier.assert") ||
+	      F.getName ().equals ("crab.assert") ||
+	      F.getName ().equals ("__CRAB_assert") ||
+	      F.getName ().equals ("__VERIFIER_assert"));
+    }
+
+    static unsigned numInstructions (const Function &F)
+    {
+      unsigned n = 0;
+      for (auto &I : instructions (F))
+	if (!isa<DbgInfoIntrinsic> (I))
+	  ++n;
+      return n;
+    }
+
+    bool runOnModule (Module &M)
+    {
+      CallGraph &CG = getAnalysis<CallGraphWrapperPass> ().getCallGraph ();
+
+      // -- number of direct call sites of each function
+      DenseMap<const Function*, unsigned> num_calls;
+      for (Function &F : M)
+	for (auto &I : instructions (F)) {
+	  CallSite CS (&I);
+	  if (CS && CS.getCalledFunction ())
+	    ++num_calls[CS.getCalledFunction ()];
+	}
+
+      // -- size after inlining and whether an assertion is reachable,
+      //    computed bottom-up
+      DenseMap<const Function*, unsigned> size;
+      DenseMap<const Function*, bool> reaches_assert;
+      unsigned total_sites = 0, total_inlined = 0, total_over_budget = 0;
+      bool change = false;
+
+      for (scc_iterator<CallGraph*> it = scc_begin (&CG); !it.isAtEnd (); ++it) {
+	SmallPtrSet<const Function*, 8> scc;
+	for (CallGraphNode *N : *it)
+	  if (Function *F = N->getFunction ())
+	    if (!F->isDeclaration ())
+	      scc.insert (F);
+
+	bool scc_asserts = false;
+	for (const Function *F : scc)
+	  for (auto &I : instructions (*F)) {
+	    ImmutableCallSite CS (&I);
+	    const Function *callee = CS ? CS.getCalledFunction () : nullptr;
+	    if (callee && (isAssertFn (*callee) || reaches_assert.lookup (callee)))
+	      scc_asserts = true;
+	  }
+
+	for (const Function *CF : scc) {
+	  Function &F = *const_cast<Function*> (CF);
+	  struct candidate_t {
+	    CallSite cs;
+	    const Function *callee;
+	  };
+	  std::vector<candidate_t> candidates;
+	  unsigned num_sites = 0;
+	  for (auto &I : instructions (F)) {
+	    CallSite CS (&I);
+	    const Function *callee = CS ? CS.getCalledFunction () : nullptr;
+	    if (!callee || callee->isDeclaration ())
+	      continue;
+	    ++num_sites;
+	    if (scc.count (callee) || !callee->hasLocalLinkage () ||
+		callee->hasFnAttribute (Attribute::NoInline) ||
+		CS.hasFnAttr (Attribute::NoInline))
+	      continue;
+	    if (size[callee] <= m_max_size || num_calls[callee] <= m_max_calls ||
+		reaches_assert[callee])
+	      candidates.push_back ({CS, callee});
+	  }
+	  // -- the callees that reach an assertion first, then the
+	  //    smallest ones
+	  std::stable_sort (candidates.begin (), candidates.end (),
+			    [&] (const candidate_t &a, const candidate_t &b) {
+			      bool ra = reaches_assert[a.callee];
+			      bool rb = reaches_assert[b.callee];
+			      if (ra != rb)
+				return ra;
+			      return size[a.callee] < size[b.callee];
+			    });
+	  unsigned growth = 0, inlined = 0, over_budget = 0;
+	  for (auto &c : candidates) {
+	    unsigned n = size[c.callee];
+	    if (growth + n > m_caller_budget) {
+	      ++over_budget;
+	      continue;
+	    }
+	    growth += n;
+	    ++inlined;
+	    c.cs.addAttribute (AttributeList::FunctionIndex, Attribute::AlwaysInline);
+	    change = true;
+	  }
+	  size[&F] = numInstructions (F) + growth;
+	  reaches_assert[&F] = scc_asserts;
+
+	  total_sites += num_sites;
+	  total_inlined += inlined;
+	  total_over_budget += over_budget;
+	  if (m_report && num_sites > 0)
+	    errs () << "Inline " << F.getName () << ": " << inlined << " of "
+		    << num_sites << " call sites, " << over_budget
+		    << " over budget, " << growth << "/" << m_caller_budget
+		    << " instructions added\n";
+	}
+      }
+
+      if (m_report) {
+	errs () << "=== Selective inlining stats===\n";
+	errs () << "BRUNCH_STAT INLINE CALL SITES " << total_sites << "\n";
+	errs () << "BRUNCH_STAT INLINE MARKED " << total_inlined << "\n";
+	errs () << "BRUNCH_STAT INLINE OVER BUDGET " << total_over_budget << "\n";
+      }
+      return change;
+    }
+
+    virtual StringRef getPassName() const {
+      return "Clam: Mark the call sites worth inlining with AlwaysInline attribute";
+    }
+
+  };
+
+  char MarkSelectiveInline::ID = 0;
+  Pass* createMarkSelectiveInlinePass (unsigned max_size, unsigned max_calls,
+				       unsigned caller_budget, bool report)
+  { return new MarkSelectiveInline (max_size, max_calls, caller_budget, report); }
+}
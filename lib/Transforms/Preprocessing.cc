@@ -0,0 +1,463 @@
+#include "llvm/LinkAllPasses.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/GlobalValue.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+
+#include "clam/config.h"
+#include "clam/Passes.hh"
+#include "clam/Transforms/Preprocessing.hh"
+
+#ifdef HAVE_LLVM_SEAHORN
+#include "llvm_seahorn/Transforms/Scalar.h"
+#endif
+
+static llvm::cl::opt<bool>
+InlineAll("crab-inline-all",
+	   llvm::cl::desc("Inline all functions"),
+           llvm::cl::init(false));
+
+static llvm::cl::opt<bool>
+InlineSelective("crab-inline-selective",
+	   llvm::cl::desc("Inline only the internal functions that are small, "
+			  "called from few call sites or that reach an assertion "
+			  "(ignored if --crab-inline-all)"),
+           llvm::cl::init(false));
+
+static llvm::cl::opt<unsigned>
+InlineMaxSize("crab-inline-max-size",
+	   llvm::cl::desc("Functions with at most this number of instructions "
+			  "are small (only if --crab-inline-selective)"),
+           llvm::cl::init(50));
+
+static llvm::cl::opt<unsigned>
+InlineMaxCalls("crab-inline-max-calls",
+	   llvm::cl::desc("Functions with at most this number of call sites "
+			  "are called few times (only if --crab-inline-selective)"),
+           llvm::cl::init(1));
+
+static llvm::cl::opt<unsigned>
+InlineCallerBudget("crab-inline-caller-budget",
+	   llvm::cl::desc("Max number of instructions added to a function by "
+			  "inlining (only if --crab-inline-selective)"),
+           llvm::cl::init(2000));
+
+static llvm::cl::opt<bool>
+InlineReport("crab-inline-report",
+	   llvm::cl::desc("Print the call sites inlined and the growth of each "
+			  "function (only if --crab-inline-selective)"),
+           llvm::cl::init(false));
+
+static llvm::cl::opt<bool>
+SpecializeConstArgs("crab-specialize-const-args",
+	   llvm::cl::desc("Clone the functions for the tuples of integer constants "
+			  "passed to them by several call sites"),
+           llvm::cl::init(false));
+
+static llvm::cl::opt<unsigned>
+SpecializeMinCalls("crab-specialize-min-calls",
+	   llvm::cl::desc("Min number of call sites passing the same constants "
+			  "(only if --crab-specialize-const-args)"),
+           llvm::cl::init(2));
+
+static llvm::cl::opt<unsigned>
+SpecializeMaxClones("crab-specialize-max-clones",
+	   llvm::cl::desc("Max number of clones of a function "
+			  "(only if --crab-specialize-const-args)"),
+           llvm::cl::init(4));
+
+static llvm::cl::opt<unsigned>
+SpecializeBudget("crab-specialize-budget",
+	   llvm::cl::desc("Max number of instructions added to the module by "
+			  "specialization (only if --crab-specialize-const-args)"),
+           llvm::cl::init(2000));
+
+static llvm::cl::opt<bool>
+SpecializeReport("crab-specialize-report",
+	   llvm::cl::desc("Print the clones (only if --crab-specialize-const-args)"),
+           llvm::cl::init(false));
+
+static llvm::cl::opt<bool>
+Devirtualize("crab-devirt",
+              llvm::cl::desc("Resolve indirect calls"),
+              llvm::cl::init(false));
+
+static llvm::cl::opt<bool>
+LowerGv("crab-lower-gv",
+	 llvm::cl::desc("Lower global initializers in main"),
+	 llvm::cl::init(true));
+
+static llvm::cl::opt<bool>
+Scalarize("crab-scalarize",
+	 llvm::cl::desc("Scalarize vector operations"),
+	 llvm::cl::init(true));
+
+static llvm::cl::opt<bool>
+ExternalizeAddrTakenFuncs("crab-externalize-addr-taken-funcs",
+         llvm::cl::desc("Externalize uses of address-taken functions"),
+         llvm::cl::init(false));
+
+static llvm::cl::opt<bool>
+OptimizeLoops("clam-pp-loops",
+               llvm::cl::desc("Perform loop optimizations"),
+               llvm::cl::init(false));
+
+static llvm::cl::opt<bool>
+LowerInvoke("crab-lower-invoke",
+	 llvm::cl::desc("Lower invoke instructions"),
+	 llvm::cl::init(true));
+
+static llvm::cl::opt<bool>
+LowerCstExpr("crab-lower-constant-expr",
+	 llvm::cl::desc("Lower constant expressions to instructions"),
+	 llvm::cl::init(true));
+
+static llvm::cl::opt<bool>
+LowerCstExprOnce("crab-lower-constant-expr-once",
+	 llvm::cl::desc("Lower each constant expression once per function, "
+			"in the entry block, and share it by all its uses"),
+	 llvm::cl::init(false));
+
+static llvm::cl::opt<bool>
+LowerSwitch("crab-lower-switch",
+	 llvm::cl::desc("Lower switch instructions"),
+	 llvm::cl::init(true));
+
+static llvm::cl::opt<bool>
+LowerSelect("crab-lower-select",
+	     llvm::cl::desc("Lower all select instructions"),
+             llvm::cl::init(false));
+
+static llvm::cl::opt<bool>
+LowerUnsignedICmp("crab-lower-unsigned-icmp",
+	 llvm::cl::desc("Lower ULT and ULE instructions"),
+	 llvm::cl::init(false));
+
+static llvm::cl::opt<bool>
+FusedLowering("crab-fused-lowering",
+	 llvm::cl::desc("Lower constant expressions, ULT/ULE and selects "
+			"in a single pass followed by one cleanup"),
+	 llvm::cl::init(false));
+
+static llvm::cl::opt<bool>
+TurnUndefNondet("crab-turn-undef-nondet",
+                 llvm::cl::desc("Turn undefined behaviour into non-determinism"),
+                 llvm::cl::init(false));
+
+namespace clam {
+
+static void breakAllocas(llvm::legacy::PassManager &pass_manager) {
+  #ifdef HAVE_LLVM_SEAHORN
+  // -- can remove bitcast from bitcast(alloca(...))
+  pass_manager.add (llvm_seahorn::createInstructionCombiningPass ());
+  #endif
+  pass_manager.add (clam::createRemoveUnreachableBlocksPass ());
+  // -- break alloca's into scalars
+  pass_manager.add(llvm::createSROAPass());
+  #ifdef HAVE_LLVM_SEAHORN
+  if (TurnUndefNondet) {
+    // -- Turn undef into nondet (undef are created by SROA when it calls mem2reg)
+    pass_manager.add (llvm_seahorn::createNondetInitPass ());
+  }
+  #endif
+}
+
+// -- lower constant expressions, ULT/ULE and selects in one walk
+static void addFusedLoweringPasses(llvm::legacy::PassManager &pass_manager) {
+  pass_manager.add(clam::createFusedLoweringPass(LowerCstExpr, LowerUnsignedICmp,
+                                                 LowerSelect, LowerCstExprOnce));
+  // -- a single cleanup. CFGSimplification would undo the lowering of
+  // -- selects so it only runs if selects are kept.
+  pass_manager.add(llvm::createDeadCodeEliminationPass());
+  if (!LowerSelect) {
+    pass_manager.add(llvm::createCFGSimplificationPass());
+  }
+  pass_manager.add(clam::createRemoveUnreachableBlocksPass());
+}
+
+void addPreprocessingPasses(llvm::legacy::PassManager &pass_manager) {
+  // -- promote top-level mallocs to alloca
+  pass_manager.add(clam::createPromoteMallocPass());
+
+  // -- turn all functions internal so that we can apply some global
+  // -- optimizations inline them if requested
+  auto PreserveMain = [=](const llvm::GlobalValue &GV) {
+    return GV.getName() == "main";
+  };
+  pass_manager.add(llvm::createInternalizePass(PreserveMain));
+
+  if (Devirtualize) {
+    // -- resolve indirect calls
+    pass_manager.add(clam::createDevirtualizeFunctionsPass());
+  }
+
+  if (ExternalizeAddrTakenFuncs) {
+    // -- externalize uses of address-taken functions
+    pass_manager.add(clam::createExternalizeAddressTakenFunctionsPass());
+  }
+
+  if (SpecializeConstArgs) {
+    // -- clone the callees for frequent constant arguments. The
+    // -- clones are folded by the cleanups after SSA.
+    pass_manager.add(clam::createSpecializeConstantArgsPass(SpecializeMinCalls,
+							    SpecializeMaxClones,
+							    SpecializeBudget,
+							    SpecializeReport));
+  }
+
+  // kill unused internal global
+  pass_manager.add(llvm::createGlobalDCEPass());
+  pass_manager.add(clam::createRemoveUnreachableBlocksPass());
+  // -- global optimizations
+  pass_manager.add(llvm::createGlobalOptimizerPass());
+
+  if (LowerGv) {
+    // -- lower initializers of global variables
+    pass_manager.add(clam::createLowerGvInitializersPass());
+  }
+
+  // -- SSA
+  pass_manager.add(llvm::createPromoteMemoryToRegisterPass());
+  #ifdef HAVE_LLVM_SEAHORN
+  if (TurnUndefNondet) {
+    // -- Turn undef into nondet
+    pass_manager.add(llvm_seahorn::createNondetInitPass());
+  }
+  #endif
+
+  // -- cleanup after SSA
+  #ifdef HAVE_LLVM_SEAHORN
+  pass_manager.add(llvm_seahorn::createInstructionCombiningPass());
+  #endif
+  pass_manager.add (llvm::createCFGSimplificationPass ());
+  breakAllocas(pass_manager);
+
+  // -- global value numbering and redundant load elimination
+  pass_manager.add(llvm::createGVNPass());
+
+  // -- cleanup after break aggregates
+  #ifdef HAVE_LLVM_SEAHORN
+  pass_manager.add(llvm_seahorn::createInstructionCombiningPass());
+  #endif
+  pass_manager.add(llvm::createCFGSimplificationPass());
+
+  #ifdef HAVE_LLVM_SEAHORN
+  if (TurnUndefNondet) {
+     // eliminate unused calls to verifier.nondet() functions
+     pass_manager.add(llvm_seahorn::createDeadNondetElimPass());
+  }
+  #endif
+
+  if (LowerInvoke) {
+    // -- lower invoke's
+    pass_manager.add(llvm::createLowerInvokePass());
+    // cleanup after lowering invoke's
+    pass_manager.add(llvm::createCFGSimplificationPass());
+  }
+
+  if (InlineAll || InlineSelective) {
+    if (InlineAll) {
+      pass_manager.add (clam::createMarkInternalInlinePass ());
+    } else {
+      pass_manager.add (clam::createMarkSelectiveInlinePass (InlineMaxSize,
+							     InlineMaxCalls,
+							     InlineCallerBudget,
+							     InlineReport));
+    }
+    pass_manager.add (llvm::createAlwaysInlinerLegacyPass ());
+    // // after inlining we promote malloc to alloca instructions
+    // pass_manager.add(clam::createPromoteMallocPass());
+    // // kill unused internal global
+    // pass_manager.add(llvm::createGlobalDCEPass());
+    pass_manager.add(llvm::createGlobalDCEPass()); // kill unused internal global
+    // -- promote malloc to alloca
+    pass_manager.add(clam::createPromoteMallocPass());
+    pass_manager.add(llvm::createGlobalDCEPass()); // kill unused internal global
+    // XXX: for svcomp ssh programs we need to run twice to break all
+    // relevant allocas
+    breakAllocas(pass_manager);
+    breakAllocas(pass_manager);
+  }
+
+  pass_manager.add(clam::createRemoveUnreachableBlocksPass());
+  pass_manager.add(llvm::createDeadInstEliminationPass());
+
+  if (OptimizeLoops) {
+    // canonical form for loops
+    pass_manager.add(llvm::createLoopSimplifyPass());
+    // cleanup unnecessary blocks
+    pass_manager.add(llvm::createCFGSimplificationPass());
+    // loop-closed SSA
+    pass_manager.add(llvm::createLCSSAPass());
+    #ifdef HAVE_LLVM_SEAHORN
+    // induction variable
+    pass_manager.add (llvm_seahorn::createIndVarSimplifyPass ());
+    #endif
+    // trivial invariants outside loops
+    pass_manager.add (llvm::createBasicAAWrapperPass());
+    pass_manager.add (llvm::createLICMPass()); //LICM needs alias analysis
+    pass_manager.add (llvm::createPromoteMemoryToRegisterPass());
+    // dead loop elimination
+    pass_manager.add (llvm::createLoopDeletionPass());
+    // cleanup unnecessary blocks
+    pass_manager.add (llvm::createCFGSimplificationPass ());
+  }
+
+  // -- ensure one single exit point per function
+  pass_manager.add(llvm::createUnifyFunctionExitNodesPass());
+  pass_manager.add(llvm::createGlobalDCEPass());
+  pass_manager.add(llvm::createDeadCodeEliminationPass());
+  // -- remove unreachable blocks also dead cycles
+  pass_manager.add(clam::createRemoveUnreachableBlocksPass());
+
+  if (Scalarize) {
+    pass_manager.add(clam::createScalarizerPass());
+    pass_manager.add(llvm::createDeadCodeEliminationPass());
+  }
+
+  if (LowerSwitch) {
+    // -- remove switch constructions
+    pass_manager.add(llvm::createLowerSwitchPass());
+    // cleanup unnecessary blocks
+    pass_manager.add(llvm::createCFGSimplificationPass());
+  }
+
+  if (FusedLowering) {
+    addFusedLoweringPasses(pass_manager);
+    return;
+  }
+  
+  if (LowerCstExpr) {
+    // -- lower constant expressions to instructions
+    pass_manager.add(clam::createLowerCstExprPass(LowerCstExprOnce));
+    pass_manager.add(llvm::createDeadCodeEliminationPass());
+  }
+
+  // -- lower ULT and ULE instructions
+  if(LowerUnsignedICmp) {
+    pass_manager.add(clam::createLowerUnsignedICmpPass());
+    // cleanup unnecessary and unreachable blocks
+    pass_manager.add(llvm::createCFGSimplificationPass());
+    pass_manager.add(clam::createRemoveUnreachableBlocksPass());
+  }
+
+  // -- must be the last one to avoid llvm undoing it
+  if (LowerSelect) {
+    pass_manager.add(clam::createLowerSelectPass());
+  }
+}
+
+void addLoweringPasses(llvm::legacy::PassManager &pass_manager) {
+  // kill unused internal global
+  pass_manager.add(llvm::createGlobalDCEPass());
+  pass_manager.add(clam::createRemoveUnreachableBlocksPass());
+
+  // -- promote alloca's to registers
+  pass_manager.add(llvm::createPromoteMemoryToRegisterPass());
+  #ifdef HAVE_LLVM_SEAHORN
+  if (TurnUndefNondet) {
+    // -- Turn undef into nondet
+    pass_manager.add(llvm_seahorn::createNondetInitPass());
+  }
+  #endif
+  if (LowerInvoke) {
+    // -- lower invoke's
+    pass_manager.add(llvm::createLowerInvokePass());
+    // cleanup after lowering invoke's
+    pass_manager.add(llvm::createCFGSimplificationPass());
+  }
+  // -- ensure one single exit point per function
+  pass_manager.add(llvm::createUnifyFunctionExitNodesPass());
+  // -- remove unreachable blocks
+  pass_manager.add(clam::createRemoveUnreachableBlocksPass());
+  if (LowerSwitch) {
+    // -- remove switch constructions
+    pass_manager.add(llvm::createLowerSwitchPass());
+    // cleanup after lowering switches
+    pass_manager.add(llvm::createCFGSimplificationPass());
+  }
+  if (FusedLowering) {
+    #ifdef HAVE_LLVM_SEAHORN
+    if (TurnUndefNondet) {
+      pass_manager.add(llvm_seahorn::createDeadNondetElimPass());
+    }
+    #endif
+    addFusedLoweringPasses(pass_manager);
+  } else {
+    // -- lower constant expressions to instructions
+    if (LowerCstExpr) {
+      pass_manager.add(clam::createLowerCstExprPass(LowerCstExprOnce));
+      // cleanup after lowering constant expressions
+      pass_manager.add(llvm::createDeadCodeEliminationPass());
+    }
+    #ifdef HAVE_LLVM_SEAHORN
+    if (TurnUndefNondet) {
+      pass_manager.add(llvm_seahorn::createDeadNondetElimPass());
+    }
+    #endif
+
+    // -- lower ULT and ULE instructions
+    if(LowerUnsignedICmp) {
+      pass_manager.add(clam::createLowerUnsignedICmpPass());
+      // cleanup unnecessary and unreachable blocks
+      pass_manager.add(llvm::createCFGSimplificationPass());
+      pass_manager.add(clam::createRemoveUnreachableBlocksPass());
+    }
+
+    // -- must be the last ones before running crab.
+    if (LowerSelect) {
+      pass_manager.add(clam::createLowerSelectPass());
+    }
+  }
+
+  // -- ensure one single exit point per function
+  // LowerUnsignedIcmpPass and LowerSelect can add multiple returns.
+  pass_manager.add(llvm::createUnifyFunctionExitNodesPass());
+}
+
+void addFunctionLoweringPasses(llvm::legacy::FunctionPassManager &fpm) {
+  // -- the passes of addLoweringPasses that need the whole module
+  // -- (global dce, nondet initialization, lowering of constant
+  // -- expressions in globals) are not run
+  if (TurnUndefNondet) {
+    llvm::errs() << "warning: --crab-turn-undef-nondet is ignored if "
+                 << "the functions are read on demand\n";
+  }
+  fpm.add(clam::createRemoveUnreachableBlocksPass());
+  fpm.add(llvm::createPromoteMemoryToRegisterPass());
+  if (LowerInvoke) {
+    fpm.add(llvm::createLowerInvokePass());
+    fpm.add(llvm::createCFGSimplificationPass());
+  }
+  fpm.add(llvm::createUnifyFunctionExitNodesPass());
+  fpm.add(clam::createRemoveUnreachableBlocksPass());
+  if (LowerSwitch) {
+    fpm.add(llvm::createLowerSwitchPass());
+    fpm.add(llvm::createCFGSimplificationPass());
+  }
+  fpm.add(clam::createFusedLoweringPass(LowerCstExpr, LowerUnsignedICmp,
+                                        LowerSelect, LowerCstExprOnce));
+  fpm.add(llvm::createDeadCodeEliminationPass());
+  if (!LowerSelect) {
+    fpm.add(llvm::createCFGSimplificationPass());
+  }
+  fpm.add(clam::createRemoveUnreachableBlocksPass());
+  fpm.add(llvm::createUnifyFunctionExitNodesPass());
+}
+
+void addOptimizationPasses(llvm::legacy::PassManager &pass_manager,
+                           unsigned level) {
+  llvm::PassManagerBuilder builder;
+  builder.OptLevel = level;
+  builder.SizeLevel = 0;
+  // -inline-threshold and -unroll-threshold are read by LLVM from the
+  // command line as in opt.
+  builder.Inliner = llvm::createFunctionInliningPass(level, 0, false);
+  builder.LoopVectorize = false;
+  builder.SLPVectorize = false;
+  builder.populateModulePassManager(pass_manager);
+}
+
+} // end namespace clam
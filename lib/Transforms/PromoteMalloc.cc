@@ -1,4 +1,6 @@
+#include "llvm/Pass.h"
 #include "llvm/IR/CallSite.h"
+#include "llvm/IR/Module.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/IRBuilder.h"
 
@@ -9,19 +11,21 @@ namespace clam {
 
   using namespace llvm;
   
-  class PromoteMalloc : public FunctionPass {
+  // A module pass because it only looks at main: a function pass
+  // would be scheduled on every function of the module.
+  class PromoteMalloc : public ModulePass {
     
   public:
     static char ID;
     
-    PromoteMalloc () : FunctionPass (ID) {} 
+    PromoteMalloc () : ModulePass (ID) {} 
 
-    bool runOnFunction (Function &F)
+    bool runOnModule (Module &M)
     {
-      if (F.empty ()) return false;
-      
       // -- only promote mallocs in top level functions
-      if (!F.getName ().equals ("main")) return false;
+      Function *main = M.getFunction ("main");
+      if (!main || main->empty ()) return false;
+      Function &F = *main;
       
       bool changed = false;
 
@@ -57,7 +61,8 @@ namespace clam {
     }
 
     void getAnalysisUsage (AnalysisUsage &AU) const {
-      //AU.setPreservesAll ();
+      // -- only instructions are replaced or removed
+      AU.setPreservesCFG ();
     }
     
     virtual StringRef getPassName () const {
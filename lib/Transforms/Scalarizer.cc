@@ -816,6 +816,26 @@
    return true;
  }
  
+// Return true if some instruction of F defines or uses a vector.
+// This is a cheap read-only scan that avoids the ordered traversal of
+// the visitor on functions that have nothing to scalarize.
+static bool hasVectorOperations(const Function &F) {
+  for (const BasicBlock &BB : F) {
+    for (const Instruction &I : BB) {
+      if (I.getType()->isVectorTy())
+        return true;
+      for (const Value *Op : I.operand_values()) {
+        Type *Ty = Op->getType();
+        if (Ty->isVectorTy() ||
+            (Ty->isPointerTy() &&
+             cast<PointerType>(Ty)->getElementType()->isVectorTy()))
+          return true;
+      }
+    }
+  }
+  return false;
+}
+
 class ScalarizerPass : public FunctionPass {
 public:
   static char ID;
@@ -823,7 +843,7 @@ public:
   ScalarizerPass() : FunctionPass(ID) {}
   
   bool runOnFunction(Function &F) override {
-    if (skipFunction(F))
+    if (skipFunction(F) || !hasVectorOperations(F))
       return false;
     
     Module &M = *F.getParent();
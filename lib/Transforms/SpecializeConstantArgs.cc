@@ -0,0 +1,165 @@
+#include "llvm/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace llvm;
+
+namespace clam {
+
+  /// clones a function for each tuple of integer constants passed to
+  /// it by at least m_min_calls call sites, and redirects these call
+  /// sites to the clone where the arguments are replaced with the
+  /// constants. The next cleanups fold the code that depends on
+  /// them, and the inter-procedural analysis enters the clone in one
+  /// context instead of one per call site. The instructions added
+  /// to the module are bounded by a budget.
+  struct SpecializeConstantArgs : public ModulePass
+  {
+    static char ID;
+
+    // a tuple is specialized if it is passed by at least m_min_calls
+    // call sites
+    unsigned m_min_calls;
+    // max number of clones of a function
+    unsigned m_max_clones;
+    // max number of instructions added to the module
+    unsigned m_budget;
+    // print the clones
+    bool m_report;
+
+    // the position and the value of the constant arguments of a call
+    typedef std::vector<std::pair<unsigned, ConstantInt*>> tuple_t;
+
+    SpecializeConstantArgs (unsigned min_calls, unsigned max_clones,
+			    unsigned budget, bool report)
+      : ModulePass (ID), m_min_calls (min_calls), m_max_clones (max_clones),
+	m_budget (budget), m_report (report) {}
+
+    void getAnalysisUsage (AnalysisUsage &AU) const {}
+
+    static unsigned numInstructions (const Function &F)
+    {
+      unsigned n = 0;
+      for (auto &I : instructions (F))
+	if (!isa<DbgInfoIntrinsic> (I))
+	  ++n;
+      return n;
+    }
+
+    static tuple_t getTuple (CallSite &CS)
+    {
+      tuple_t t;
+      unsigned i = 0;
+      for (auto ai = CS.arg_begin (), ae = CS.arg_end (); ai != ae; ++ai, ++i)
+	if (ConstantInt *C = dyn_cast<ConstantInt> (*ai))
+	  t.push_back ({i, C});
+      return t;
+    }
+
+    Function* mkClone (Function &F, const tuple_t &t)
+    {
+      ValueToValueMapTy VMap;
+      Function *clone = CloneFunction (&F, VMap);
+      clone->setName (F.getName () + ".spec");
+      clone->setLinkage (GlobalValue::InternalLinkage);
+      // -- the signature is kept so the call sites only change callee
+      for (auto &kv : t) {
+	Argument *arg = &*std::next (clone->arg_begin (), kv.first);
+	arg->replaceAllUsesWith (kv.second);
+      }
+      return clone;
+    }
+
+    bool runOnModule (Module &M)
+    {
+      // -- the functions present before any clone is added
+      std::vector<Function*> funcs;
+      for (Function &F : M)
+	if (!F.isDeclaration () && !F.isVarArg ())
+	  funcs.push_back (&F);
+
+      unsigned used = 0, total_clones = 0, total_sites = 0, over_budget = 0;
+      bool change = false;
+      for (Function *F : funcs) {
+	// -- call sites grouped by tuple, in order of first occurrence
+	std::map<tuple_t, unsigned> index;
+	std::vector<std::pair<tuple_t, std::vector<CallSite>>> groups;
+	for (Use &U : F->uses ()) {
+	  CallSite CS (U.getUser ());
+	  if (!CS || !CS.isCallee (&U) ||
+	      CS.getFunctionType () != F->getFunctionType ())
+	    continue;
+	  tuple_t t = getTuple (CS);
+	  if (t.empty ())
+	    continue;
+	  auto it = index.find (t);
+	  if (it == index.end ()) {
+	    it = index.insert ({t, groups.size ()}).first;
+	    groups.push_back ({t, {}});
+	  }
+	  groups[it->second].second.push_back (CS);
+	}
+	// -- the most frequent tuples first
+	std::stable_sort (groups.begin (), groups.end (),
+			  [] (const std::pair<tuple_t, std::vector<CallSite>> &a,
+			      const std::pair<tuple_t, std::vector<CallSite>> &b) {
+			    return a.second.size () > b.second.size ();
+			  });
+	unsigned size = numInstructions (*F), clones = 0;
+	for (auto &g : groups) {
+	  if (g.second.size () < m_min_calls || clones >= m_max_clones)
+	    break;
+	  if (used + size > m_budget) {
+	    ++over_budget;
+	    continue;
+	  }
+	  Function *clone = mkClone (*F, g.first);
+	  for (CallSite &CS : g.second)
+	    CS.setCalledFunction (clone);
+	  used += size;
+	  ++clones;
+	  total_sites += g.second.size ();
+	  change = true;
+	  if (m_report) {
+	    errs () << "Specialize " << F->getName () << " as " << clone->getName ()
+		    << " for " << g.second.size () << " call sites with";
+	    for (auto &kv : g.first)
+	      errs () << " arg" << kv.first << "=" << kv.second->getValue ();
+	    errs () << "\n";
+	  }
+	}
+	total_clones += clones;
+      }
+
+      if (m_report) {
+	errs () << "=== Constant argument specialization stats===\n";
+	errs () << "BRUNCH_STAT SPECIALIZE CLONES " << total_clones << "\n";
+	errs () << "BRUNCH_STAT SPECIALIZE CALL SITES " << total_sites << "\n";
+	errs () << "BRUNCH_STAT SPECIALIZE OVER BUDGET " << over_budget << "\n";
+	errs () << "BRUNCH_STAT SPECIALIZE INSTRUCTIONS ADDED " << used << "\n";
+      }
+      return change;
+    }
+
+    virtual StringRef getPassName() const {
+      return "Clam: Specialize functions for frequent constant arguments";
+    }
+
+  };
+
+  char SpecializeConstantArgs::ID = 0;
+  Pass* createSpecializeConstantArgsPass (unsigned min_calls, unsigned max_clones,
+					  unsigned budget, bool report)
+  { return new SpecializeConstantArgs (min_calls, max_clones, budget, report); }
+}
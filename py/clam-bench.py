@@ -0,0 +1,481 @@
+#!/usr/bin/env python2
+
+"""
+Benchmark harness for clam.
+
+Run clam.py on every C file of the given directories with each of the
+selected abstract domains and record, per run:
+  - wall time and peak RSS of the whole pipeline
+  - all BRUNCH_STAT lines printed with --crab-stats (Crab phase
+    timers such as "CFG Construction" and the clam.py timers "Clang",
+    "ClamPP" and "Clam")
+
+Results are written in JSON or CSV. If a baseline (a JSON file
+produced by a previous execution) is given then runs whose wall time
+or peak RSS grow more than the tolerance are reported as regressions
+and the script returns a non-zero exit code.
+
+The options of each benchmark are taken from its lit RUN line so the
+analysis configures as in the test-suite (--crab-dom is overridden).
+
+The startup time of clam with each domain is also measured (unless
+--startup=0): it is the median "Clam" time of several runs on an
+empty program, reported as the benchmark <startup>. Since the domains
+are registered when they are first used, it should not grow with the
+number of domains linked into clam.
+
+With --triage every benchmark is analyzed once with --crab-triage
+(the domains are ignored) and its throughput, the CFG statements
+analyzed per second, is reported. If --min-throughput is given then
+the runs below it are reported as regressions, and with a baseline
+the runs whose throughput drops more than the tolerance too.
+
+With --threads=1,2,4,... every run is repeated with each number of
+--crab-threads and the scaling of each domain is reported: the sum
+of the "Clam" times for each number of threads and its speedup over
+the first one. Add --extra=--crab-threads-numa to pin the workers to
+the NUMA nodes.
+
+With --autotune the widening and threshold parameters are tuned for
+one domain on a random sample of the benchmarks that check assertions
+(--sample). Starting from the defaults of clam.py, each parameter in
+turn takes the values of its grid (--tune-widening-delay, ...) while
+the others are fixed, and the value that proves the most checks per
+CPU-second on the sample is kept, until no parameter changes. The
+recommended parameters are written (-o) as a --crab-dom-config file
+with a single "*" entry.
+"""
+
+from __future__ import print_function
+
+import argparse
+import csv
+import json
+import os
+import os.path
+import random
+import re
+import shlex
+import subprocess as sub
+import sys
+import tempfile
+import time
+
+root = os.path.dirname(os.path.dirname(os.path.realpath(__file__)))
+
+DEFAULT_CORPORA = [os.path.join(root, 'tests', d)
+                   for d in ['ssh', 'ntdrivers-simplified', 'array-adapt']]
+
+DOMAINS = ['int', 'ric', 'term-int', 'dis-int', 'term-dis-int', 'boxes',
+           'zones', 'oct', 'pk', 'rtz', 'w-int', 'dense-int']
+
+STARTUP = '<startup>'
+
+STARTUP_PROGRAM = 'int main() { return 0; }\n'
+
+TRIAGE = 'triage'
+
+# -- (--crab-dom-config key, clam.py option, default value) of the
+#    parameters tuned by --autotune
+TUNED = [('widening-delay', '--crab-widening-delay', 1),
+         ('narrowing-iterations', '--crab-narrowing-iterations', 3),
+         ('widening-jump-set', '--crab-widening-jump-set', 0),
+         ('relational-threshold', '--crab-relational-threshold', 10000)]
+
+def getClam():
+    clam = os.path.join(os.path.dirname(os.path.realpath(__file__)), 'clam.py')
+    if os.path.isfile(clam):
+        return clam
+    return os.path.join(root, 'build', 'run', 'bin', 'clam.py')
+
+def litSubstitutions(directory):
+    """ Return the %opts-like substitutions of the lit.local.cfg of directory """
+    substs = {}
+    cfg = os.path.join(directory, 'lit.local.cfg')
+    if os.path.isfile(cfg):
+        with open(cfg) as f:
+            for m in re.finditer(r"substitutions\.append\(\('(%\w+)',\s*'([^']*)'\)\)",
+                                 f.read()):
+                substs[m.group(1)] = m.group(2)
+    return substs
+
+def runLineOptions(filename, substs):
+    """ Return the clam options of the RUN line of filename """
+    with open(filename) as f:
+        for line in f:
+            m = re.match(r'\s*//\s*RUN:\s*%clam\s+(.*)', line)
+            if m is None:
+                continue
+            cmd = m.group(1).split('|')[0]
+            for k, v in substs.items():
+                cmd = cmd.replace(k, v)
+            opts = []
+            for o in shlex.split(cmd):
+                if o == '%s' or o.startswith('2>'):
+                    continue
+                if o.startswith('--crab-dom=') or o.startswith('--crab-do-not-print'):
+                    continue
+                opts.append(o)
+            return opts
+    return []
+
+def collectBenchmarks(corpora):
+    benchs = []
+    for d in corpora:
+        substs = litSubstitutions(d)
+        for dirpath, _, files in os.walk(d):
+            for f in sorted(files):
+                if f.endswith('.c'):
+                    path = os.path.join(dirpath, f)
+                    benchs.append((path, runLineOptions(path, substs)))
+    return benchs
+
+def parseBrunchStats(out):
+    res = {}
+    for line in out.splitlines():
+        if not line.startswith('BRUNCH_STAT '):
+            continue
+        tokens = line.split()[1:]
+        if len(tokens) < 2:
+            continue
+        name, val = ' '.join(tokens[:-1]), tokens[-1]
+        try:
+            res[name] = float(val)
+        except ValueError:
+            res[name] = val
+    return res
+
+def safeChecks(out):
+    """ The number of safe checks printed by clam or None """
+    m = re.search(r'^\s*(\d+)\s+Number of total safe checks$', out, re.M)
+    return int(m.group(1)) if m is not None else None
+
+def runOne(clam, bench, opts, dom, args):
+    cmd = [clam, '--crab-triage' if dom == TRIAGE else '--crab-dom={0}'.format(dom),
+           '--crab-stats', '--crab-do-not-print-invariants',
+           '--cpu={0}'.format(args.cpu), '--mem={0}'.format(args.mem)]
+    cmd.extend(opts)
+    cmd.extend(args.extra)
+    cmd.append(bench)
+    with tempfile.TemporaryFile() as log:
+        start = time.time()
+        p = sub.Popen(cmd, stdout=log, stderr=sub.STDOUT)
+        # wait4 reports the resources of clam.py together with all the
+        # processes it waited for (clang, clam-pp, clam, ...)
+        _, status, ru = os.wait4(p.pid, 0)
+        wall = time.time() - start
+        log.seek(0)
+        out = log.read()
+    if not isinstance(out, str):
+        out = out.decode('utf-8', 'replace')
+    rss = ru.ru_maxrss
+    if sys.platform == 'darwin':
+        rss = rss // 1024
+    if os.WIFEXITED(status):
+        returncode = os.WEXITSTATUS(status)
+    else:
+        returncode = -os.WTERMSIG(status)
+    return {'benchmark': os.path.relpath(bench, root),
+            'domain': dom,
+            'returncode': returncode,
+            'wall_time': round(wall, 3),
+            'cpu_time': round(ru.ru_utime + ru.ru_stime, 3),
+            'safe_checks': safeChecks(out),
+            'peak_rss_kb': rss,
+            'phases': parseBrunchStats(out)}
+
+def runStartup(clam, dom, args):
+    """ Median of args.startup runs on an empty program """
+    fd, prog = tempfile.mkstemp(prefix='clam-startup-', suffix='.c')
+    try:
+        with os.fdopen(fd, 'w') as f:
+            f.write(STARTUP_PROGRAM)
+        runs = [runOne(clam, prog, ['-O0'], dom, args) for _ in range(args.startup)]
+    finally:
+        os.remove(prog)
+    times = sorted(r['phases'].get('Clam', r['wall_time']) for r in runs)
+    r = runs[0]
+    r['benchmark'] = STARTUP
+    r['returncode'] = max(x['returncode'] for x in runs)
+    r['wall_time'] = round(times[len(times) // 2], 3)
+    r['peak_rss_kb'] = max(x['peak_rss_kb'] for x in runs)
+    return r
+
+def throughput(r):
+    """ CFG statements analyzed per second by a triage run, or None """
+    stmts = r['phases'].get('Triage.Statements')
+    secs = r['phases'].get('Triage.AnalysisTime')
+    if not isinstance(stmts, float) or not isinstance(secs, float) or secs <= 0:
+        return None
+    return stmts / secs
+
+def runKey(r):
+    """ The runs compared with a baseline have the same key """
+    return (r['benchmark'], r['domain'], r.get('threads'))
+
+def reportScaling(results, threads):
+    """ Print the speedup of each domain with each number of threads """
+    for dom in sorted(set(r['domain'] for r in results if 'threads' in r)):
+        times = {}
+        for r in results:
+            if r['domain'] == dom and r.get('threads') is not None:
+                t = r['phases'].get('Clam', r['wall_time'])
+                times[r['threads']] = times.get(r['threads'], 0.0) + t
+        base = times.get(threads[0], 0.0)
+        line = []
+        for n in threads:
+            t = times.get(n, 0.0)
+            speedup = ' ({0:.2f}x)'.format(base / t) if t > 0 and base > 0 else ''
+            line.append('{0} threads {1:.3f}s{2}'.format(n, t, speedup))
+        print('Scaling {0}: {1}'.format(dom, ', '.join(line)), file=sys.stderr)
+
+def checkThroughput(results, baseline, min_throughput, tolerance, min_time):
+    base = dict((runKey(r), r) for r in baseline or [])
+    regressions = []
+    for r in results:
+        new = r.get('throughput')
+        # the throughput of very short runs is noise
+        if new is None or r['phases'].get('Triage.AnalysisTime', 0) < min_time:
+            continue
+        if min_throughput is not None and new < min_throughput:
+            regressions.append((r, 'throughput', min_throughput, new))
+        old = base.get(runKey(r), {}).get('throughput')
+        if old is not None and new < old * (1.0 - tolerance):
+            regressions.append((r, 'throughput', old, new))
+    return regressions
+
+def tuneScore(clam, sample, dom, config, args):
+    """ Safe checks per CPU-second of config on the sample """
+    safe, cpu = 0, 0.0
+    for bench, opts in sample:
+        tuned = ['{0}={1}'.format(opt, config[key]) for key, opt, _ in TUNED]
+        r = runOne(clam, bench, opts + tuned, dom, args)
+        cpu += r['cpu_time']
+        # -- a run killed by the limits proves nothing
+        if r['returncode'] == 0 and r['safe_checks'] is not None:
+            safe += r['safe_checks']
+    score = safe / cpu if cpu > 0 else 0.0
+    print('{0}: {1} safe checks in {2:.3f}s ({3:.2f}/s)'.format(
+        ' '.join('{0}={1}'.format(k, config[k]) for k, _, _ in TUNED),
+        safe, cpu, score), file=sys.stderr)
+    return score, safe, cpu
+
+def autotune(clam, benchs, args):
+    """ Return the best config and its score, safe checks and CPU time """
+    candidates = [b for b in benchs
+                  if any(o.startswith('--crab-check') for o in b[1])]
+    if not candidates:
+        print('no benchmark checks assertions', file=sys.stderr)
+        return None
+    random.seed(args.seed)
+    sample = random.sample(candidates, min(args.sample, len(candidates)))
+    dom = args.domains[0]
+    best = dict((key, default) for key, _, default in TUNED)
+    scores = {}
+    def score(config):
+        k = tuple(config[key] for key, _, _ in TUNED)
+        if k not in scores:
+            scores[k] = tuneScore(clam, sample, dom, config, args)
+        return scores[k]
+    change = True
+    while change:
+        change = False
+        for key, _, _ in TUNED:
+            for v in args.grid[key]:
+                config = dict(best)
+                config[key] = v
+                if score(config)[0] > score(best)[0]:
+                    best = config
+                    change = True
+    return best, score(best), dom, len(sample)
+
+def writeConfig(best, out):
+    config, (score, safe, cpu), dom, num = best
+    out.write('# clam-bench.py --autotune: {0} on {1} benchmarks\n'.format(dom, num))
+    out.write('# {0} safe checks in {1:.3f}s ({2:.2f}/s)\n'.format(safe, cpu, score))
+    out.write('* {0}\n'.format(' '.join('{0}={1}'.format(k, config[k])
+                                        for k, _, _ in TUNED)))
+
+def writeCSV(results, out):
+    phases = sorted(set(k for r in results for k in r['phases']))
+    w = csv.writer(out)
+    w.writerow(['benchmark', 'domain', 'threads', 'returncode', 'wall_time',
+                'cpu_time', 'peak_rss_kb', 'safe_checks', 'throughput'] + phases)
+    for r in results:
+        w.writerow([r['benchmark'], r['domain'], r.get('threads', ''), r['returncode'],
+                    r['wall_time'], r.get('cpu_time', ''), r['peak_rss_kb'],
+                    r.get('safe_checks', ''), r.get('throughput', '')] +
+                   [r['phases'].get(p, '') for p in phases])
+
+def compareBaseline(results, baseline, tolerance, min_time):
+    base = dict((runKey(r), r) for r in baseline)
+    regressions = []
+    for r in results:
+        b = base.get(runKey(r))
+        if b is None:
+            continue
+        if b['returncode'] == 0 and r['returncode'] != 0:
+            regressions.append((r, 'returncode', b['returncode'], r['returncode']))
+        # the startup time is always short
+        low_time = 0.0 if r['benchmark'] == STARTUP else min_time
+        for key, low in [('wall_time', low_time), ('peak_rss_kb', 0)]:
+            old, new = b[key], r[key]
+            if old > low and new > old * (1.0 + tolerance):
+                regressions.append((r, key, old, new))
+    return regressions
+
+def parseArgs(argv):
+    p = argparse.ArgumentParser(description='Benchmark harness for clam')
+    p.add_argument('corpora', nargs='*', metavar='DIR',
+                   help='Directories with C benchmarks (default: {0})'.format(
+                       ', '.join(os.path.relpath(d, root) for d in DEFAULT_CORPORA)))
+    p.add_argument('--domains', default='int,zones',
+                   help='Comma-separated list of domains or "all" (default: int,zones)')
+    p.add_argument('--format', choices=['json', 'csv'], default='json')
+    p.add_argument('-o', dest='output', default=None,
+                   help='Output file (default: stdout)')
+    p.add_argument('--baseline', default=None, metavar='FILE',
+                   help='JSON results of a previous execution to compare with')
+    p.add_argument('--tolerance', type=float, default=0.10,
+                   help='Relative growth considered a regression (default: 0.10)')
+    p.add_argument('--min-time', type=float, default=0.5,
+                   help='Ignore time regressions of runs faster than this (seconds)')
+    p.add_argument('--startup', type=int, default=5, metavar='N',
+                   help='Runs on an empty program to measure the startup time '
+                   'with each domain (default: 5, 0 to disable)')
+    p.add_argument('--triage', action='store_true', default=False,
+                   help='Analyze with --crab-triage and report the throughput '
+                   '(--domains and --startup are ignored)')
+    p.add_argument('--min-throughput', type=float, default=None, metavar='N',
+                   help='With --triage, CFG statements per second below which '
+                   'a run is a regression')
+    p.add_argument('--threads', default=None, metavar='N,...',
+                   help='Repeat every run with each number of --crab-threads '
+                   'and report the scaling of each domain')
+    p.add_argument('--autotune', action='store_true', default=False,
+                   help='Tune the widening and threshold parameters of the '
+                   'first domain and write them as a --crab-dom-config file')
+    p.add_argument('--sample', type=int, default=10, metavar='N',
+                   help='With --autotune, number of benchmarks analyzed with '
+                   'each configuration (default: 10)')
+    p.add_argument('--seed', type=int, default=0,
+                   help='With --autotune, seed of the sample (default: 0)')
+    p.add_argument('--tune-widening-delay', default='1,2,4',
+                   help='Values of widening-delay tried by --autotune')
+    p.add_argument('--tune-narrowing-iterations', default='1,3,5',
+                   help='Values of narrowing-iterations tried by --autotune')
+    p.add_argument('--tune-widening-jump-set', default='0,10,20',
+                   help='Values of widening-jump-set tried by --autotune')
+    p.add_argument('--tune-relational-threshold', default='1000,10000',
+                   help='Values of relational-threshold tried by --autotune')
+    p.add_argument('--cpu', type=int, default=600, help='CPU limit per run (seconds)')
+    p.add_argument('--mem', type=int, default=4096, help='Memory limit per run (MB)')
+    p.add_argument('--clam', default=None, help='Path to clam.py')
+    p.add_argument('--extra', default='',
+                   help='Extra options passed to every clam.py invocation')
+    args = p.parse_args(argv)
+    args.extra = shlex.split(args.extra)
+    if not args.corpora:
+        args.corpora = DEFAULT_CORPORA
+    if args.min_throughput is not None and not args.triage:
+        p.error('--min-throughput needs --triage')
+    if args.autotune and args.triage:
+        p.error('--autotune and --triage are incompatible')
+    if args.threads is not None:
+        if args.autotune:
+            p.error('--threads and --autotune are incompatible')
+        try:
+            args.threads = [int(n) for n in args.threads.split(',')]
+        except ValueError:
+            p.error('expected a list of numbers for --threads')
+    args.grid = {}
+    for key, _, _ in TUNED:
+        vals = getattr(args, 'tune_' + key.replace('-', '_'))
+        try:
+            args.grid[key] = [int(v) for v in vals.split(',')]
+        except ValueError:
+            p.error('expected a list of numbers for --tune-{0}'.format(key))
+    if args.triage:
+        args.domains = [TRIAGE]
+        args.startup = 0
+    elif args.domains == 'all':
+        args.domains = DOMAINS
+    else:
+        args.domains = args.domains.split(',')
+        for d in args.domains:
+            if d not in DOMAINS:
+                p.error('unknown domain {0}'.format(d))
+    return args
+
+def main(argv):
+    args = parseArgs(argv[1:])
+    clam = args.clam if args.clam is not None else getClam()
+    benchs = collectBenchmarks(args.corpora)
+    if args.autotune:
+        best = autotune(clam, benchs, args)
+        if best is None:
+            return 1
+        out = open(args.output, 'w') if args.output else sys.stdout
+        writeConfig(best, out)
+        if args.output:
+            out.close()
+        return 0
+    results = []
+    if args.startup > 0:
+        for dom in args.domains:
+            r = runStartup(clam, dom, args)
+            print('{0} {1}: {2}s (rc={3})'.format(
+                STARTUP, dom, r['wall_time'], r['returncode']), file=sys.stderr)
+            results.append(r)
+    for bench, opts in benchs:
+        for dom in args.domains:
+            for n in args.threads or [None]:
+                topts = opts if n is None else opts + ['--crab-threads={0}'.format(n)]
+                r = runOne(clam, bench, topts, dom, args)
+                if n is not None:
+                    r['threads'] = n
+                if dom == TRIAGE:
+                    r['throughput'] = throughput(r)
+                print('{0} {1}{2}: {3}s {4}KB (rc={5})'.format(
+                    r['benchmark'], dom, '' if n is None else ' x{0}'.format(n),
+                    r['wall_time'], r['peak_rss_kb'], r['returncode']),
+                      file=sys.stderr)
+                results.append(r)
+    if args.threads:
+        reportScaling(results, args.threads)
+    if args.triage:
+        stmts = sum(r['phases'].get('Triage.Statements', 0) for r in results)
+        secs = sum(r['phases'].get('Triage.AnalysisTime', 0) for r in results)
+        if secs > 0:
+            print('Triage throughput: {0:.0f} statements/s ({1:.0f} statements '
+                  'in {2:.3f}s)'.format(stmts / secs, stmts, secs), file=sys.stderr)
+
+    out = open(args.output, 'w') if args.output else sys.stdout
+    if args.format == 'json':
+        json.dump(results, out, indent=2, sort_keys=True)
+        out.write('\n')
+    else:
+        writeCSV(results, out)
+    if args.output:
+        out.close()
+
+    baseline = None
+    if args.baseline is not None:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    regressions = []
+    if baseline is not None:
+        regressions = compareBaseline(results, baseline, args.tolerance,
+                                      args.min_time)
+    if args.triage:
+        regressions += checkThroughput(results, baseline, args.min_throughput,
+                                       args.tolerance, args.min_time)
+    for r, key, old, new in regressions:
+        print('REGRESSION {0} {1} {2}: {3} -> {4}'.format(
+            r['benchmark'], r['domain'], key, old, new), file=sys.stderr)
+    if regressions:
+        return 1
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
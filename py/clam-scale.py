@@ -0,0 +1,239 @@
+#!/usr/bin/env python2
+
+"""
+Scaling benchmarks for clam.
+
+Generate C programs whose shape is controlled by a few parameters:
+  - blocks: if-then-else diamonds in the body of the innermost loop
+  - depth:  number of nested loops
+  - vars:   integer variables live across the whole loop nest
+  - arrays: global arrays read and written in every diamond
+and either write one of them (gen) or analyze a family of them with
+each domain while one parameter grows (run). For each domain the
+growth of the wall time and of the peak RSS is fitted to a power law
+a * n^b so that the exponent b tells how the domain scales with the
+parameter.
+
+With --scale=vars the report also gives, for each relational domain,
+the largest number of live variables analyzed within --budget seconds,
+a starting point for --crab-relational-threshold.
+
+The runs are done by clam.py as in clam-bench.py.
+
+Examples:
+  clam-scale.py gen --vars=64 --depth=2 -o big.c
+  clam-scale.py run --scale=vars --sizes=8,16,32,64,128 --domains=int,zones,oct
+"""
+
+from __future__ import print_function
+
+import argparse
+import json
+import math
+import os
+import os.path
+import shlex
+import sys
+import tempfile
+
+def _loadBench():
+    """ Import clam-bench.py (not a valid module name) """
+    path = os.path.join(os.path.dirname(os.path.realpath(__file__)), 'clam-bench.py')
+    try:
+        import importlib.util
+        spec = importlib.util.spec_from_file_location('clam_bench', path)
+        mod = importlib.util.module_from_spec(spec)
+        spec.loader.exec_module(mod)
+        return mod
+    except ImportError:
+        import imp
+        return imp.load_source('clam_bench', path)
+
+bench = _loadBench()
+
+PARAMS = ['blocks', 'depth', 'vars', 'arrays']
+NON_RELATIONAL = ['int', 'ric', 'boxes', 'dis-int', 'term-int', 'term-dis-int', 'w-int',
+                  'dense-int']
+
+def genProgram(blocks, depth, nvars, arrays, array_size, out):
+    w = out.write
+    w('// clam-scale.py gen --blocks={0} --depth={1} --vars={2} --arrays={3} '
+      '--array-size={4}\n'.format(blocks, depth, nvars, arrays, array_size))
+    w('extern void __CRAB_assert(int);\n')
+    w('extern int nd(void);\n\n')
+    for a in range(arrays):
+        w('int A{0}[{1}];\n'.format(a, array_size))
+    w('\nint main() {\n')
+    for v in range(nvars):
+        w('  int x{0} = {1};\n'.format(v, v))
+    w('  int c = 0;\n')
+    w('  int n = nd();\n')
+    indent = '  '
+    for d in range(depth):
+        w('{0}for (int i{1} = 0; i{1} < n; i{1}++) {{\n'.format(indent, d))
+        indent += '  '
+    for b in range(blocks):
+        x = 'x{0}'.format(b % max(nvars, 1))
+        y = 'x{0}'.format((b + 1) % max(nvars, 1))
+        w('{0}if (nd()) {{\n'.format(indent))
+        if nvars > 0:
+            w('{0}  {1} = {1} + 1;\n'.format(indent, x))
+        for a in range(arrays):
+            w('{0}  A{1}[{2}] = c;\n'.format(indent, a, b % array_size))
+        w('{0}}} else {{\n'.format(indent))
+        if nvars > 0:
+            w('{0}  {1} = {2} + 1;\n'.format(indent, x, y))
+        for a in range(arrays):
+            w('{0}  c = c + A{1}[{2}];\n'.format(indent, a, (b + 1) % array_size))
+        w('{0}}}\n'.format(indent))
+    w('{0}c = c + 1;\n'.format(indent))
+    for d in range(depth):
+        indent = indent[:-2]
+        w('{0}}}\n'.format(indent))
+    # keep every variable live until the end
+    for v in range(nvars):
+        w('  __CRAB_assert(x{0} >= 0);\n'.format(v))
+    w('  __CRAB_assert(c >= 0);\n')
+    w('  return 0;\n}\n')
+
+def fitPowerLaw(points):
+    """ Least squares fit of y = a * x^b on the log-log scale. Return
+        (a, b) or None if there are not enough positive points. """
+    pts = [(math.log(x), math.log(y)) for x, y in points if x > 0 and y > 0]
+    if len(pts) < 2:
+        return None
+    n = float(len(pts))
+    mx = sum(p[0] for p in pts) / n
+    my = sum(p[1] for p in pts) / n
+    sxx = sum((p[0] - mx) ** 2 for p in pts)
+    if sxx == 0:
+        return None
+    b = sum((p[0] - mx) * (p[1] - my) for p in pts) / sxx
+    return (math.exp(my - b * mx), b)
+
+def shapeOf(args, size):
+    shape = dict((p, getattr(args, p)) for p in PARAMS)
+    shape[args.scale] = size
+    return shape
+
+def report(results, args, out):
+    print('Scaling with {0} (other parameters: {1})'.format(
+        args.scale, ', '.join('{0}={1}'.format(p, getattr(args, p))
+                              for p in PARAMS if p != args.scale)), file=out)
+    summary = {}
+    for dom in args.domains:
+        runs = [r for r in results if r['domain'] == dom and r['returncode'] == 0]
+        entry = {}
+        for key in ['wall_time', 'peak_rss_kb']:
+            fit = fitPowerLaw([(r['size'], r[key]) for r in runs])
+            if fit is not None:
+                entry[key] = {'a': fit[0], 'b': fit[1]}
+        if args.scale == 'vars' and dom not in NON_RELATIONAL:
+            fits = [r['size'] for r in runs if r['wall_time'] <= args.budget]
+            entry['max_vars_within_budget'] = max(fits) if fits else None
+        summary[dom] = entry
+        line = '  {0:14}'.format(dom)
+        for key, unit in [('wall_time', 's'), ('peak_rss_kb', 'KB')]:
+            if key in entry:
+                line += '  {0} ~ {1:.3g} * n^{2:.2f}'.format(
+                    unit, entry[key]['a'], entry[key]['b'])
+            else:
+                line += '  {0}: not enough data'.format(unit)
+        if 'max_vars_within_budget' in entry:
+            line += '  max vars in {0}s: {1}'.format(
+                args.budget, entry['max_vars_within_budget'])
+        print(line, file=out)
+    return summary
+
+def parseArgs(argv):
+    p = argparse.ArgumentParser(description='Scaling benchmarks for clam')
+    sp = p.add_subparsers(dest='command')
+    for name in ['gen', 'run']:
+        c = sp.add_parser(name)
+        c.add_argument('--blocks', type=int, default=8, help='Diamonds per loop body')
+        c.add_argument('--depth', type=int, default=1, help='Loop nesting depth')
+        c.add_argument('--vars', type=int, default=8, help='Live integer variables')
+        c.add_argument('--arrays', type=int, default=0, help='Global arrays')
+        c.add_argument('--array-size', type=int, default=16, dest='array_size')
+        c.add_argument('-o', dest='output', default=None,
+                       help='Output file (default: stdout)')
+    run = sp.choices['run']
+    run.add_argument('--scale', choices=PARAMS, default='blocks',
+                     help='Parameter that grows (default: blocks)')
+    run.add_argument('--sizes', default='4,8,16,32,64',
+                     help='Comma-separated values of the growing parameter')
+    run.add_argument('--domains', default='int,zones',
+                     help='Comma-separated list of domains or "all" (default: int,zones)')
+    run.add_argument('--budget', type=float, default=10.0,
+                     help='Time budget (seconds) for the relational threshold (default: 10)')
+    run.add_argument('--json', default=None, metavar='FILE',
+                     help='Also write the runs and the fitted curves in JSON')
+    run.add_argument('--keep', default=None, metavar='DIR',
+                     help='Keep the generated programs in DIR')
+    run.add_argument('--cpu', type=int, default=600, help='CPU limit per run (seconds)')
+    run.add_argument('--mem', type=int, default=4096, help='Memory limit per run (MB)')
+    run.add_argument('--clam', default=None, help='Path to clam.py')
+    run.add_argument('--extra', default='',
+                     help='Extra options passed to every clam.py invocation')
+    args = p.parse_args(argv)
+    if args.command == 'run':
+        args.extra = shlex.split(args.extra)
+        args.sizes = [int(s) for s in args.sizes.split(',')]
+        if args.domains == 'all':
+            args.domains = bench.DOMAINS
+        else:
+            args.domains = args.domains.split(',')
+            for d in args.domains:
+                if d not in bench.DOMAINS:
+                    p.error('unknown domain {0}'.format(d))
+    return args
+
+def genToFile(shape, args, filename):
+    with open(filename, 'w') as f:
+        genProgram(shape['blocks'], shape['depth'], shape['vars'],
+                   shape['arrays'], args.array_size, f)
+
+def main(argv):
+    args = parseArgs(argv[1:])
+    if args.command == 'gen':
+        out = open(args.output, 'w') if args.output else sys.stdout
+        genProgram(args.blocks, args.depth, args.vars, args.arrays,
+                   args.array_size, out)
+        if args.output:
+            out.close()
+        return 0
+
+    clam = args.clam if args.clam is not None else bench.getClam()
+    workdir = args.keep if args.keep is not None else tempfile.mkdtemp(prefix='clam-scale-')
+    if not os.path.isdir(workdir):
+        os.makedirs(workdir)
+    opts = ['-O0', '--crab-track=arr' if args.arrays > 0 or args.scale == 'arrays'
+            else '--crab-track=num', '--crab-check=assert']
+    results = []
+    for size in args.sizes:
+        shape = shapeOf(args, size)
+        filename = os.path.join(workdir, '{0}-{1}.c'.format(args.scale, size))
+        genToFile(shape, args, filename)
+        for dom in args.domains:
+            r = bench.runOne(clam, filename, opts, dom, args)
+            r['size'] = size
+            r['shape'] = shape
+            print('{0}={1} {2}: {3}s {4}KB (rc={5})'.format(
+                args.scale, size, dom, r['wall_time'], r['peak_rss_kb'],
+                r['returncode']), file=sys.stderr)
+            results.append(r)
+        if args.keep is None:
+            os.remove(filename)
+    if args.keep is None:
+        os.rmdir(workdir)
+
+    summary = report(results, args, sys.stdout)
+    if args.json is not None:
+        with open(args.json, 'w') as f:
+            json.dump({'scale': args.scale, 'runs': results, 'fits': summary},
+                      f, indent=2, sort_keys=True)
+            f.write('\n')
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -10,12 +10,16 @@ import subprocess as sub
 import threading
 import signal
 import resource
+import time
 import stats
 
 root = os.path.dirname(os.path.dirname(os.path.realpath(__file__)))
 verbose = True
 
 running_process = None
+## processes launched concurrently by the jobs of --jobs and --link
+running_jobs = []
+running_jobs_lock = threading.Lock()
 
 ####### SPECIAL ERROR CODES USEFUL FOR DEBUGGING ############
 # Exit codes are between 0 and 255.
@@ -60,7 +64,9 @@ def which(program):
 # Return a tuple (returnvalue:int, timeout:bool, out_of_memory:bool, segfault:bool, unknown:bool)
 #   - Only one boolean flag can be enabled at any time.
 #   - If all flags are false then returnvalue cannot be None.
-def run_command_with_limits(cmd, cpu, mem, out = None):
+#   - The wall time and the resource usage of the process are recorded
+#     in the statistics of stage (the name of the command by default).
+def run_command_with_limits(cmd, cpu, mem, out = None, stage = None):
     timeout = False
     out_of_memory = False
     segfault = False
@@ -80,6 +86,8 @@ def run_command_with_limits(cmd, cpu, mem, out = None):
             running_process = None
         except OSError: pass
         
+    if stage is None: stage = os.path.basename(cmd[0])
+    start = time.time()
     if out is not None:
         p = sub.Popen(cmd, stdout = out, preexec_fn=set_limits)
     else:
@@ -87,12 +95,14 @@ def run_command_with_limits(cmd, cpu, mem, out = None):
         
     global running_process
     running_process = p
+    with running_jobs_lock: running_jobs.append(p)
     timer = threading.Timer(cpu, kill, [p])
     if cpu > 0:
         timer.start()
         
     try:
         (pid, status, ru_child) = os.wait4(p.pid, 0)
+        stats.stage(stage, time.time() - start, ru_child)
         signal = status & 0xff
         returnvalue = status >> 8        
         if signal <> 0:
@@ -123,6 +133,7 @@ def run_command_with_limits(cmd, cpu, mem, out = None):
     finally:
         ## kill the timer if the process has terminated already
         if timer.isAlive(): timer.cancel()
+        with running_jobs_lock: running_jobs.remove(p)
         
     return (returnvalue, timeout, out_of_memory, segfault, unknown_error)        
 
@@ -171,6 +182,10 @@ def parseArgs(argv):
     p.add_argument("--only-preprocess", dest="only_preprocess", 
                     help='Run only the preprocessor', action='store_true',
                     default=False)
+    p.add_argument("--in-process", dest="in_process",
+                    help='Run the preprocessor, the LLVM optimizer and the analysis\n'
+                    'in a single clam process without intermediate bitcode files',
+                    action='store_true', default=False)
     p.add_argument('-O', type=int, dest='L', metavar='INT',
                     help='Optimization level L:[0,1,2,3]', default=0)
     p.add_argument('--cpu', type=int, dest='cpu', metavar='SEC',
@@ -201,6 +216,36 @@ def parseArgs(argv):
                     default=150, metavar='NUM')
     p.add_argument('--inline', dest='inline', help='Inline all functions',
                     default=False, action='store_true')
+    p.add_argument('--inline-selective', dest='inline_selective',
+                    help='Inline only the functions that are small, called few times or that reach an assertion',
+                    default=False, action='store_true')
+    p.add_argument('--inline-max-size', dest='inline_max_size', type=int, metavar='NUM',
+                    help='Functions with at most NUM instructions are small (default = 50)',
+                    default=None)
+    p.add_argument('--inline-max-calls', dest='inline_max_calls', type=int, metavar='NUM',
+                    help='Functions with at most NUM call sites are called few times (default = 1)',
+                    default=None)
+    p.add_argument('--inline-caller-budget', dest='inline_caller_budget', type=int, metavar='NUM',
+                    help='Max number of instructions added to a function by inlining (default = 2000)',
+                    default=None)
+    p.add_argument('--inline-report', dest='inline_report',
+                    help='Print the call sites inlined and the growth of each function',
+                    default=False, action='store_true')
+    p.add_argument('--specialize-const-args', dest='specialize',
+                    help='Clone the functions for the integer constants passed by several call sites',
+                    default=False, action='store_true')
+    p.add_argument('--specialize-min-calls', dest='specialize_min_calls', type=int, metavar='NUM',
+                    help='Min number of call sites passing the same constants (default = 2)',
+                    default=None)
+    p.add_argument('--specialize-max-clones', dest='specialize_max_clones', type=int, metavar='NUM',
+                    help='Max number of clones of a function (default = 4)',
+                    default=None)
+    p.add_argument('--specialize-budget', dest='specialize_budget', type=int, metavar='NUM',
+                    help='Max number of instructions added by specialization (default = 2000)',
+                    default=None)
+    p.add_argument('--specialize-report', dest='specialize_report',
+                    help='Print the clones created by specialization',
+                    default=False, action='store_true')
     p.add_argument('--turn-undef-nondet',
                     help='Turn undefined behaviour into non-determinism',
                     dest='undef_nondet', default=False, action='store_true')
@@ -210,6 +255,9 @@ def parseArgs(argv):
     p.add_argument('--lower-unsigned-icmp',
                     help='Lower ULT and ULE instructions',
                     dest='lower_unsigned_icmp', default=False, action='store_true')    
+    p.add_argument('--fused-lowering',
+                    help='Lower constant expressions, unsigned comparisons and selects in a single pass',
+                    dest='fused_lowering', default=False, action='store_true')
     p.add_argument('--disable-lower-gv',
                     help='Disable lowering of global variable initializers into main',
                     dest='disable_lower_gv', default=False, action='store_true')
@@ -219,6 +267,9 @@ def parseArgs(argv):
     p.add_argument('--disable-lower-constant-expr',
                     help='Disable lowering of constant expressions to instructions',
                     dest='disable_lower_cst_expr', default=False, action='store_true')
+    p.add_argument('--lower-constant-expr-once',
+                    help='Lower each constant expression once per function and share it by all its uses',
+                    dest='lower_cst_expr_once', default=False, action='store_true')
     p.add_argument('--disable-lower-switch',
                     help='Disable lowering of switch instructions',
                     dest='disable_lower_switch', default=False, action='store_true')
@@ -231,6 +282,18 @@ def parseArgs(argv):
                     dest='devirt',
                     choices=['none','types','sea-dsa','dsa'],
                     default='none')
+    p.add_argument('--devirt-share-bounce-functions',
+                    help='Share bounce functions between indirect calls with the same targets and signature modulo pointer types',
+                    dest='devirt_share_bounce', default=False, action='store_true')
+    p.add_argument('--devirt-max-num-targets',
+                    help='Replace indirect calls with more than N targets with a call to an external function',
+                    dest='devirt_max_targets', type=int, default=None, metavar='N')
+    p.add_argument('--devirt-table-export',
+                    help='Write the targets of the resolved indirect calls to FILE',
+                    dest='devirt_table_export', default=None, metavar='FILE')
+    p.add_argument('--devirt-table-import',
+                    help='Resolve indirect calls from FILE if it was exported for the same program',
+                    dest='devirt_table_import', default=None, metavar='FILE')
     p.add_argument('--externalize-addr-taken-functions',
                     help='Externalize uses of address-taken functions (potentially unsound)',
                     dest='enable_ext_funcs', default=False,
@@ -243,7 +306,21 @@ def parseArgs(argv):
                     help='Print all LLVM passes executed (--debug-pass=Structure)',
                     dest='debug_pass', default=False,
                     action='store_true')
-    p.add_argument('file', metavar='FILE', help='Input file')
+    p.add_argument('-j', '--jobs', type=int, dest='jobs', metavar='N',
+                    help='Number of input files analyzed in parallel (default = 1).\n'
+                    '--cpu and --mem are limits of each file', default=1)
+    p.add_argument('--stats-json', dest='stats_json', metavar='FILE',
+                    help='Write the statistics and the wall time, user/sys time and peak\n'
+                    'memory of each stage (clang, opt, clam-pp, clam) to FILE in JSON',
+                    default=None)
+    p.add_argument('--link', dest='link',
+                    help='Compile the input files in parallel (see --jobs), link them with\n'
+                    'llvm-link and analyze the whole program',
+                    default=False, action='store_true')
+    p.add_argument('--frontend-cache-dir', dest='frontend_cache_dir', metavar='DIR',
+                    help='Directory to cache the output of clang, opt and clam-pp across runs',
+                    default=None)
+    p.add_argument('file', metavar='FILE', nargs='+', help='Input files')
     ### BEGIN CRAB
     p.add_argument('--crab-verbose', type=int,
                     help='Enable verbose messages',
@@ -255,6 +332,16 @@ def parseArgs(argv):
     p.add_argument('--crab-cfg-simplify',
                     help='Perform some crab CFG transformations',
                     dest='crab_cfg_simplify', default=False, action='store_true')    
+    dom_choices = ['int', 'ric', 'term-int',
+                   'dis-int', 'term-dis-int', 'boxes',
+                   'zones', 'oct', 'packed-oct', 'pk', 'rtz',
+                   'w-int', 'dense-int']
+    def dom_list(s):
+        for d in s.split(','):
+            if d not in dom_choices:
+                raise a.ArgumentTypeError("invalid choice: '{0}' (choose from {1})".format
+                                          (d, ', '.join(dom_choices)))
+        return s
     p.add_argument('--crab-dom',
                     help="Choose abstract domain:\n"
                           "- int: intervals\n"
@@ -265,20 +352,83 @@ def parseArgs(argv):
                           "- boxes: disjunctive intervals based on LDDs\n"
                           "- zones: zones domain using sparse DBM in Split Normal Form\n"
                           "- oct: octagons domain\n"
+                          "- packed-oct: oct but only the bounds of the variables of the packs that are too large\n"
                           "- pk: polyhedra domain\n"
                           "- rtz: reduced product of term-dis-int with zones\n"
-                          "- w-int: wrapped intervals\n",
-                    choices=['int', 'ric', 'term-int',
-                             'dis-int', 'term-dis-int', 'boxes',  
-                             'zones', 'oct', 'pk', 'rtz',
-                             'w-int'],
+                          "- w-int: wrapped intervals\n"
+                          "- dense-int: int with vectorized join, meet and widening\n"
+                          "A comma-separated list (e.g., int,zones,oct) compares several domains",
+                    type=dom_list, metavar='DOM',
                     dest='crab_dom', default='zones')
+    p.add_argument('--crab-estimate-cost',
+                    help='Print the estimated cost of analyzing each function with each domain',
+                    dest='estimate_cost', default=False, action='store_true')
+    p.add_argument('--crab-max-estimated-cost',
+                    type=float, dest='max_estimated_cost',
+                    help='Analyze with intervals the functions whose estimated cost exceeds this value',
+                    default=0)
+    p.add_argument('--crab-staged',
+                    help='Analyze each function with intervals first and with --crab-dom only if some checks are not proven',
+                    dest='staged', default=False, action='store_true')
+    p.add_argument('--crab-warm-start',
+                    help='Reuse the invariants of the last analysis of a changed function if they are still inductive\n'
+                    '(requires --crab-cache-dir)',
+                    dest='warm_start', default=False, action='store_true')
+    p.add_argument('--crab-profile-fixpoint',
+                    help='Print the cost of the transfer functions, joins and widenings of each block',
+                    dest='profile_fixpoint', default=False, action='store_true')
+    p.add_argument('--crab-profile-fixpoint-folded',
+                    help='Write the fixpoint profile in the folded format of flamegraph.pl',
+                    dest='profile_fixpoint_folded', default=None, metavar='FILE')
+    p.add_argument('--crab-spill-invariants',
+                    help='Move the invariants of each function into memory-mapped files of DIR once it is analyzed (intra-procedural only)',
+                    dest='crab_spill_invariants', default=None, metavar='DIR')
+    p.add_argument('--crab-release-cfgs',
+                    help='Release the CFG of each function once it is analyzed, except the literals of globals and constants (intra-procedural only)',
+                    dest='crab_release_cfgs', default=False, action='store_true')
+    p.add_argument('--crab-external-models',
+                    help='File with the memory effects (readnone, readonly, argmemonly) of some external functions',
+                    dest='crab_external_models', default=None, metavar='FILE')
+    p.add_argument('--crab-dom-config',
+                    help='File with the abstract domain and widening parameters of some functions',
+                    dest='crab_dom_config', default=None, metavar='FILE')
+    p.add_argument('--crab-export-summaries',
+                    help='Write the summaries of the functions analyzed from a top entry',
+                    dest='crab_export_summaries', default=None, metavar='FILE')
+    p.add_argument('--crab-dump-cfg',
+                    help='Write the Crab CFGs of the analyzed functions into a file',
+                    dest='crab_dump_cfg', default=None, metavar='FILE')
+    p.add_argument('--crab-import-summaries',
+                    help='Use the summaries of a file instead of analyzing the summarized functions',
+                    dest='crab_import_summaries', default=None, metavar='FILE')
     p.add_argument('--crab-widening-delay', 
                     type=int, dest='widening_delay', 
                     help='Max number of iterations until performing widening', default=1)
+    p.add_argument('--crab-widening-delay-auto',
+                    help='Choose the widening delay of each function from its loop nests',
+                    dest='widening_delay_auto', default=False, action='store_true')
     p.add_argument('--crab-widening-jump-set', 
                     type=int, dest='widening_jump_set', 
                     help='Size of the jump set used in widening', default=0)
+    p.add_argument('--crab-widening-jump-set-auto',
+                    help='Size the jump set from the constants of the loop guards',
+                    dest='widening_jump_set_auto', default=False, action='store_true')
+    p.add_argument('--crab-fixpoint',
+                    help='Fixpoint engine: wto (default) or worklist (large flat or irreducible CFGs)',
+                    choices=['wto', 'worklist'], dest='crab_fixpoint', default='wto')
+    p.add_argument('--crab-max-disjuncts',
+                    type=int, dest='max_disjuncts',
+                    help='Merge the closest disjuncts of the states of dis-int, term-dis-int and boxes with more disjuncts (0 if unlimited)',
+                    default=0)
+    p.add_argument('--crab-array-max-smashable-cells',
+                    type=int, dest='array_max_smashable_cells',
+                    help='Max number of cells of an array before it is smashed', default=64)
+    p.add_argument('--crab-array-max-size',
+                    type=int, dest='array_max_size',
+                    help='Max size of an array to be expanded', default=512)
+    p.add_argument('--crab-array-auto-limits',
+                    help='Scale the array limits of each function by its number of arrays',
+                    dest='array_auto_limits', default=False, action='store_true')
     p.add_argument('--crab-narrowing-iterations', 
                     type=int, dest='narrowing_iterations', 
                     help='Max number of narrowing iterations', default=3)
@@ -286,9 +436,16 @@ def parseArgs(argv):
                     type=int, dest='num_threshold', 
                     help='Max number of live vars per block before switching to a non-relational domain',
                     default=10000)
+    p.add_argument('--crab-pack-size',
+                    type=int, dest='pack_size',
+                    help='Max number of variables in a pack of related variables (only for packed-oct)',
+                    default=64)
     p.add_argument('--crab-track',
                    help='Track integers (num), num + pointer offsets (ptr), and num + memory contents (arr) via memory abstraction',
                    choices=['num', 'ptr', 'arr'], dest='track', default='num')
+    p.add_argument('--crab-track-adaptive',
+                   help='Choose the abstraction level of each function, up to --crab-track, from the values its assertions depend on',
+                   dest='track_adaptive', default=False, action='store_true')
     p.add_argument('--crab-heap-analysis',
                    help="Heap analysis used for memory disambiguation (if --crab-track=arr):\n"
                    "- llvm-dsa: context-insensitive llvm-dsa (deprecated) \n"
@@ -302,12 +459,93 @@ def parseArgs(argv):
                             'ci-sea-dsa-types', 'cs-sea-dsa-types'],                   
                     dest='crab_heap_analysis',
                     default='ci-sea-dsa-types')
+    p.add_argument('--crab-heap-analysis-budget',
+                    help='With cs-sea-dsa, seconds after which the context-sensitive analysis is stopped and ci-sea-dsa is used instead (0 if unlimited)',
+                    type=int, dest='crab_heap_analysis_budget', default=0, metavar='SECS')
+    p.add_argument('--crab-heap-snapshot',
+                    help='Load the heap analysis from FILE if it was computed for the same program, otherwise write it into FILE',
+                    dest='crab_heap_snapshot', default=None, metavar='FILE')
     p.add_argument('--crab-singleton-aliases',
                     help='Translate singleton alias sets (mostly globals) as scalar values',
                     dest='crab_singleton_aliases', default=False, action='store_true')
+    p.add_argument('--crab-forget-dead-arrays',
+                    help='Forget the arrays at the end of the blocks where they become dead (only if --crab-track=arr)',
+                    dest='crab_forget_dead_arrays', default=False, action='store_true')
+    p.add_argument('--crab-array-expand-max-elems',
+                    help='Expand the arrays of the regions whose objects have at most N elements and smash the other ones (0 if disabled, only if --crab-track=arr)',
+                    type=int, dest='crab_array_expand_max_elems', default=0, metavar='N')
+    p.add_argument('--crab-accelerate-loops',
+                    help='Compute in closed form the range of the counter of the loops with a single induction variable',
+                    dest='crab_accelerate_loops', default=False, action='store_true')
+    p.add_argument('--crab-hoist-loop-havocs',
+                    help='Move the havocs of the variables that are neither assigned nor read by a loop to its preheader',
+                    dest='crab_hoist_loop_havocs', default=False, action='store_true')
+    p.add_argument('--crab-promote-local-regions',
+                    help='Translate the regions of a single cell of a non-escaping local object (e.g., a field of a local struct) as scalar values',
+                    dest='crab_promote_local_regions', default=False, action='store_true')
     p.add_argument('--crab-inter',
                     help='Run summary-based, inter-procedural analysis',
                     dest='crab_inter', default=False, action='store_true')
+    p.add_argument('--crab-inter-per-function-dom',
+                    help='Analyze separately with intervals the functions that exceed the relational threshold (only if --crab-inter)',
+                    dest='crab_inter_per_function_dom', default=False, action='store_true')
+    p.add_argument('--crab-inter-all-functions',
+                    help='Build the CFGs of the functions unreachable from the roots (only if --crab-inter)',
+                    dest='crab_inter_all_functions', default=False, action='store_true')
+    p.add_argument('--crab-threads',
+                    type=int, dest='crab_threads',
+                    help='Number of threads to build CFGs and analyze functions (call graph components with --crab-inter) in parallel (ignored if --crab-stats)',
+                    default=1)
+    p.add_argument('--crab-threads-mem-budget',
+                    type=int, dest='crab_threads_mem_budget', metavar='MB',
+                    help='Start a function with --crab-threads only if its predicted memory fits in this budget (0 if unlimited)',
+                    default=0)
+    p.add_argument('--crab-threads-numa',
+                    help='Pin the workers of --crab-threads to the NUMA nodes so that their memory is node-local',
+                    dest='crab_threads_numa', default=False, action='store_true')
+    p.add_argument('--crab-huge-pages',
+                    help='Back the malloc arenas of clam with transparent huge pages (glibc 2.35 or newer)',
+                    dest='crab_huge_pages', default=False, action='store_true')
+    p.add_argument('--crab-deterministic',
+                    help='The results do not depend on --crab-threads',
+                    dest='crab_deterministic', default=False, action='store_true')
+    p.add_argument('--crab-triage',
+                    help='Cheap analysis linear in the size of the CFGs (intervals, checks only)',
+                    dest='crab_triage', default=False, action='store_true')
+    p.add_argument('--crab-function-var-scopes',
+                    help='Name the variables local to a function in a scope freed with its CFG',
+                    dest='crab_function_var_scopes', default=False, action='store_true')
+    p.add_argument('--crab-pipeline-heap',
+                    help='Build the CFGs of the functions that do not use memory while the heap analysis runs',
+                    dest='crab_pipeline_heap', default=False, action='store_true')
+    p.add_argument('--crab-cfg-block-threads',
+                    type=int, dest='crab_cfg_block_threads',
+                    help=a.SUPPRESS, default=1)
+    p.add_argument('--crab-fun-timeout',
+                    type=int, dest='crab_fun_timeout', metavar='SEC',
+                    help='Time limit per function before falling back to a cheaper domain',
+                    default=0)
+    p.add_argument('--crab-inter-deadline',
+                    type=int, dest='crab_inter_deadline', metavar='SEC',
+                    help='Time limit after which the inter-procedural analysis does not start more call graph components',
+                    default=0)
+    p.add_argument('--crab-fun-mem-limit',
+                    type=int, dest='crab_fun_mem_limit', metavar='MB',
+                    help='Memory limit per function before falling back to a cheaper domain',
+                    default=0)
+    p.add_argument('--crab-fun-rss-limit',
+                    type=int, dest='crab_fun_rss_limit', metavar='MB',
+                    help='Limit of the resident memory added by the analysis of a function before falling back to a cheaper domain',
+                    default=0)
+    p.add_argument('--crab-downgrade-chain',
+                    help='Comma-separated domains tried in order if a function exceeds its budget (e.g., oct,zones,int)',
+                    dest='crab_downgrade_chain', default=None, metavar='DOMS')
+    p.add_argument('--crab-cache-dir',
+                    help='Directory to cache the analysis results of unchanged functions across runs',
+                    dest='crab_cache_dir', default=None, metavar='DIR')
+    p.add_argument('--crab-checkpoint-dir',
+                    help='Directory to record the analyzed functions so that a restarted run skips them',
+                    dest='crab_checkpoint_dir', default=None, metavar='DIR')
     # p.add_argument('--crab-inter-sum-dom',
     #                 help='Choose abstract domain for computing summaries',
     #                 choices=['zones','oct','rtz'],
@@ -316,9 +554,21 @@ def parseArgs(argv):
                     type=int, dest='inter_max_summaries', 
                     help='Max number of summaries per function',
                     default=1000000)
+    p.add_argument('--crab-inter-reuse-subsumed-contexts',
+                    help='Reuse the summary of a calling context that includes the new one (less precise)',
+                    dest='inter_reuse_subsumed', default=False, action='store_true')
+    p.add_argument('--crab-inter-multi-root',
+                    help='Analyze every externally visible function from a top context and join the invariants of a function across them',
+                    dest='inter_multi_root', default=False, action='store_true')
+    p.add_argument('--crab-inter-merge-checks',
+                    help='Check each assertion once from the join of its calling contexts instead of once per context (ignored if there are Boolean assertions)',
+                    dest='inter_merge_checks', default=False, action='store_true')
     p.add_argument('--crab-backward',
                     help='Run iterative forward/backward analysis for proving assertions (only intra version available and very experimental)',
                     dest='crab_backward', default=False, action='store_true')
+    p.add_argument('--crab-backward-unproven-only',
+                    help='Run the backward analysis only on functions with checks not proven by the forward analysis',
+                    dest='crab_backward_unproven_only', default=False, action='store_true')
     # WARNING: --crab-live may lose precision.
     # If x=z in bb1 and y=z in bb2 and z is dead after bb1 and bb2 then
     # the equality x=y is lost.
@@ -334,37 +584,117 @@ def parseArgs(argv):
                              'after-load',
                              'all'],
                     dest='insert_inv_loc', default='none')
+    p.add_argument('--crab-add-invariants-dedup',
+                    help='Skip invariants already inserted at a dominator and insert one verifier.assume per block',
+                    dest='insert_inv_dedup', default=False, action='store_true')
+    p.add_argument('--crab-add-invariants-threads', type=int,
+                    help='Number of threads that extract the constraints and plan the instrumentation of the functions',
+                    dest='insert_inv_threads', default=None, metavar='N')
+    p.add_argument('--crab-intern-invariants',
+                    help='Share the stored invariants that are equal within a function',
+                    dest='intern_invariants', default=False, action='store_true')
+    p.add_argument('--crab-head-invariants',
+                    help='Store only the invariants at loop heads and recompute the others when queried',
+                    dest='head_invariants', default=False, action='store_true')
+    p.add_argument('--crab-delta-invariants',
+                    help='Store the invariants at loop heads and merge points and the others as deltas of constraints',
+                    dest='delta_invariants', default=False, action='store_true')
     p.add_argument('--crab-do-not-store-invariants',
                     help='Do not store invariants',
                     dest='store_invariants', default=True, action='store_false')        
     p.add_argument('--crab-promote-assume',
                     help='Promote verifier.assume calls to llvm.assume intrinsics',
                     dest='crab_promote_assume', default=False, action='store_true')
+    p.add_argument('--lazy-functions',
+                    help='Read the body of each function just before it is analyzed '
+                    '(only intra-procedural analysis with --crab-track=num)',
+                    dest='lazy_functions', default=False, action='store_true')
     p.add_argument('--crab-check',
-                    help='Check user assertions (default no check)',
-                    choices=['none', 'assert'],
+                    help='Check user assertions or null dereferences (default no check)',
+                    choices=['none', 'assert', 'null'],
                     dest='assert_check', default='none')
+    p.add_argument('--crab-slice-to-checks',
+                    help='Analyze only the functions that can influence the checks',
+                    dest='crab_slice_to_checks', default=False, action='store_true')
+    p.add_argument('--crab-reachable-only',
+                    help='Analyze only the functions reachable from the roots',
+                    dest='crab_reachable_only', default=False, action='store_true')
+    p.add_argument('--crab-roots', metavar='STR',
+                    help='Comma-separated root functions for --crab-reachable-only (default main)',
+                    dest='crab_roots', default=None)
+    p.add_argument('--crab-shard', metavar='K/N',
+                    help='Analyze only the K-th (from 0) of N shards of the functions (see clam-merge)',
+                    dest='crab_shard', default=None)
+    p.add_argument('--crab-changed-lines', metavar='FILE',
+                    help='Analyze only the functions with a source line in the ranges of FILE (file:L1-L2,... per line, needs -g). The others reuse their last checks',
+                    dest='crab_changed_lines', default=None)
+    p.add_argument('--crab-changed-callers-depth', metavar='INT', type=int,
+                    help='With --crab-changed-lines and --crab-inter, analyze also the callers up to this depth',
+                    dest='crab_changed_callers_depth', default=None)
     p.add_argument('--crab-check-verbose', metavar='INT',
                     help='Print verbose information about checks\n' + 
                          '>=1: only error checks\n' + 
                          '>=2: error and warning checks\n' + 
                          '>=3: error, warning, and safe checks',
                     dest='check_verbose', type=int, default=0)
+    p.add_argument('--crab-check-early-stop',
+                    help='Skip narrowing in a function if all its checks are proven after the ascending phase',
+                    dest='check_early_stop', default=False, action='store_true')
+    p.add_argument('--crab-check-threads', metavar='NUM',
+                    help='Number of threads to check the assertions of a function with many assertions',
+                    dest='check_threads', type=int, default=None)
+    p.add_argument('--crab-check-early-stop-skip-invariants',
+                    help='Do not store the invariants of a function if narrowing was skipped',
+                    dest='check_early_stop_skip_invariants', default=False, action='store_true')
     p.add_argument('--crab-print-summaries',
                     help='Display computed summaries (if --crab-inter)',
                     dest='print_summs', default=False, action='store_true')
     p.add_argument('--crab-print-cfg',
                     help='Display crab CFG',
                     dest='print_cfg', default=False, action='store_true')
+    p.add_argument('--crab-cfg-report',
+                    help='Print the footprint of the Crab CFG of each function and of its translation',
+                    choices=['none', 'text', 'json'], dest='cfg_report', default='none')
+    p.add_argument('--crab-output-file',
+                    help='Write the printed CFGs and invariants to FILE instead of stdout '
+                         '(one gzip member per function if FILE ends with .gz)',
+                    dest='crab_output_file', default=None, metavar='FILE')
     p.add_argument('--crab-do-not-print-invariants',
                     help='Do not print invariants',
                     dest='crab_print_invariants', default=True, action='store_false')    
+    p.add_argument('--crab-print-invariants-compact',
+                    help='Print invariants, one line per block',
+                    dest='crab_print_invariants_compact', default=False, action='store_true')
     p.add_argument('--crab-print-unjustified-assumptions',
                     help='Print unjustified assumptions done by the analyzer (experimental, only for integer overflows)',
                     dest='print_assumptions', default=False, action='store_true')
     p.add_argument('--crab-stats',
                     help='Display crab statistics',
                     dest='print_stats', default=False, action='store_true')    
+    p.add_argument('--crab-stats-json',
+                    help='Write per-function statistics in JSON format to FILE',
+                    dest='crab_stats_json', default=None, metavar='FILE')
+    p.add_argument('--crab-dom-instrument',
+                    help='Count and time the operations of the domain and record the size of its states (needs clam built with CLAM_INSTRUMENT_DOMAINS)',
+                    dest='crab_dom_instrument', default=False, action='store_true')
+    p.add_argument('--crab-check-stream',
+                    help='Write the checks of each function as soon as it is analyzed, one JSON record per line (- for stdout)',
+                    dest='crab_check_stream', default=None, metavar='FILE')
+    p.add_argument('--crab-check-index',
+                    help='Write the status of the checks by source location in a binary index (intra-procedural only)',
+                    dest='crab_check_index', default=None, metavar='FILE')
+    p.add_argument('--crab-progress-file',
+                    help='Rewrite periodically the status of the analysis (functions done, current functions, elapsed and remaining time, memory) as JSON',
+                    dest='crab_progress_file', default=None, metavar='FILE')
+    p.add_argument('--crab-progress-interval',
+                    help='Seconds between two updates of --crab-progress-file',
+                    type=int, dest='crab_progress_interval', default=5, metavar='SEC')
+    p.add_argument('--crab-stop-on-error',
+                    help='Stop the analysis after the first function with an error check (intra-procedural only)',
+                    dest='crab_stop_on_error', default=False, action='store_true')
+    p.add_argument('--crab-invariants-db',
+                    help='Write the invariants in a binary database',
+                    dest='crab_invariants_db', default=None, metavar='FILE')
     p.add_argument('--crab-disable-warnings',
                     help='Disable clam and crab warnings',
                     dest='crab_disable_warnings', default=False, action='store_true')
@@ -395,18 +725,29 @@ def parseArgs(argv):
     p.add_argument('--crab-name-values',
                     help=a.SUPPRESS,
                     dest='crab_name_values', default=True, action='store_false')
+    p.add_argument('--crab-lazy-names',
+                    help='Do not name the unnamed LLVM values (names are only synthesized to print them)',
+                    dest='crab_lazy_names', default=False, action='store_true')
     p.add_argument('--crab-keep-shadows',
                     help=a.SUPPRESS,
                     dest='crab_keep_shadows', default=False, action='store_true')
     p.add_argument('--crab-enable-bignums',
                     help=a.SUPPRESS,
                     dest='crab_enable_bignums', default=False, action='store_true')
+    p.add_argument('--crab-disable-native-select',
+                    help='Havoc select instructions instead of translating them into Crab select statements',
+                    dest='crab_disable_native_select', default=False, action='store_true')
     #Instrument each memory instruction with shadow.mem functions to
     #convert the program into memory SSA form and translate to crab
     #preserving that memory SSA form.
     p.add_argument('--crab-memssa',
                     help=a.SUPPRESS,
                     dest='crab_memssa', default=False, action='store_true')
+    #Translate to crab in memory SSA form using the heap regions
+    #(without shadow.mem instrumentation)
+    p.add_argument('--crab-memssa-regions',
+                    help=a.SUPPRESS,
+                    dest='crab_memssa_regions', default=False, action='store_true')
     
     #### END CRAB
     
@@ -418,6 +759,13 @@ def parseArgs(argv):
     if args.machine != 32 and args.machine != 64:
         p.error("Unknown option -m%s" % args.machine)
 
+    if args.jobs < 1:
+        p.error("Unknown option --jobs=%s" % args.jobs)
+
+    if len(args.file) > 1 and not args.link and \
+       (args.out_name is not None or args.asm_out_name is not None):
+        p.error("-o and --oll require a single input file")
+
     return args
 
 def createWorkDir(dname = None, save = False):
@@ -490,6 +838,12 @@ def getOptLlvm ():
         raise IOError ('neither seaopt nor opt where found')
     return (cmd_name, False)
 
+def getLlvmLink():
+    cmd_name = which(['llvm-link-mp-5.0', 'llvm-link-5.0', 'llvm-link'])
+    if cmd_name is None:
+        raise IOError('llvm-link not found')
+    return cmd_name
+
 ### Passes
 def defBCName(name, wd=None):
     base = os.path.basename(name)
@@ -518,18 +872,8 @@ def _plus_plus_file(name):
     ext = os.path.splitext(name)[1]
     return ext == '.cpp' or ext == '.cc'
 
-# Run Clang
-def clang(in_name, out_name, args, arch=32, extra_args=[]):
-
-    if os.path.splitext(in_name)[1] == '.bc':
-        if verbose:
-            print '--- Clang skipped: input file is already bitecode'
-        shutil.copy2(in_name, out_name)
-        return
-
-    if out_name == '' or out_name == None:
-        out_name = defBCName(in_name)
-
+# Command line of clang to compile in_name into out_name
+def clangArgs(in_name, out_name, args, arch=32, extra_args=[]):
     clang_cmd = getClang(_plus_plus_file(in_name))
     clang_version = getClangVersion(clang_cmd)
     if not clang_version == "not-found":
@@ -576,16 +920,151 @@ def clang(in_name, out_name, args, arch=32, extra_args=[]):
         if os.path.isdir(osx_sdk_dir):
             clang_args.append('--sysroot=' + osx_sdk_dir)
             break
-    
+    return clang_args
+
+# Run Clang
+def clang(in_name, out_name, args, arch=32, extra_args=[]):
+
+    if os.path.splitext(in_name)[1] == '.bc':
+        if verbose:
+            print '--- Clang skipped: input file is already bitecode'
+        shutil.copy2(in_name, out_name)
+        return
+
+    if out_name == '' or out_name == None:
+        out_name = defBCName(in_name)
+
+    clang_args = clangArgs(in_name, out_name, args, arch, extra_args)
+    cache_name = _clangCacheName(clang_args, in_name, out_name, args)
+    if _cacheLoad(cache_name, out_name, 'Clang'): return
     if verbose: print ' '.join(clang_args)
     returnvalue, timeout, out_of_mem, segfault, unknown = \
-        run_command_with_limits(clang_args, -1, -1)
+        run_command_with_limits(clang_args, -1, -1, stage='Clang')
     if timeout:
         sys.exit(FRONTEND_TIMEOUT)
     elif out_of_mem:
         sys.exit(FRONTEND_MEMORY_OUT)
     elif segfault or unknown or returnvalue <> 0:
         sys.exit(CLANG_ERROR)    
+    _cacheStore(out_name, cache_name)
+
+# Return the file of the cache directory for key or None if there is no
+# cache directory.
+def _cacheName(args, key, suffix):
+    if args.frontend_cache_dir is None: return None
+    import hashlib
+    if not os.path.isdir(args.frontend_cache_dir):
+        os.makedirs(args.frontend_cache_dir)
+    return os.path.join(args.frontend_cache_dir,
+                        hashlib.sha1(key).hexdigest() + suffix)
+
+# Return the file of the cache directory for the output of the
+# command cmd run on in_name (None if there is no cache directory). The
+# key is the command with in_name and out_name abstracted away and the
+# content of in_name (or content if not None).
+def _stageCacheName(cmd, in_name, out_name, args, content=None):
+    if args.frontend_cache_dir is None: return None
+    ## their output is printed and not part of the cached file
+    if args.print_after_all or args.debug_pass: return None
+    if content is None:
+        with open(in_name, 'rb') as f: content = f.read()
+    key = ' '.join('<in>' if a == in_name else '<out>' if a == out_name else a
+                   for a in cmd)
+    return _cacheName(args, key + '\0' + content, '.bc')
+
+# Copy the cached file to out_name if it exists
+def _cacheLoad(cache_name, out_name, stage):
+    if cache_name is None or not os.path.isfile(cache_name): return False
+    if verbose: print '--- {0} skipped: {1} is cached'.format(stage, out_name)
+    shutil.copy2(cache_name, out_name)
+    return True
+
+# Copy out_name into the cache. The rename is atomic so that
+# concurrent runs never see a partial file.
+def _cacheStore(out_name, cache_name):
+    if cache_name is None: return
+    tmp = cache_name + '.tmp{0}'.format(os.getpid())
+    shutil.copy2(out_name, tmp)
+    os.rename(tmp, cache_name)
+
+# The cache file of the output of clang. The key is the preprocessed
+# source so that an edit of an included header is not missed.
+def _clangCacheName(clang_args, in_name, out_name, args):
+    if args.frontend_cache_dir is None: return None
+    pp_args = [a for a in clang_args if a != '-emit-llvm' and a != '-c']
+    i = pp_args.index('-o')
+    del pp_args[i:i+2]
+    pp_args.append('-E')
+    proc = sub.Popen(pp_args, stdout=sub.PIPE)
+    source = proc.communicate()[0]
+    if proc.returncode <> 0: return None
+    return _stageCacheName(clang_args, in_name, out_name, args, source)
+
+# Compile in_name into out_name unless the cache already has the
+# bitcode of the same preprocessed source with the same arguments.
+# Return the bitcode file, None if clang failed or an exit code if it
+# did not terminate.
+def _compileTU(in_name, out_name, args, extra_args):
+    if os.path.splitext(in_name)[1] == '.bc':
+        return in_name
+    clang_args = clangArgs(in_name, out_name, args, args.machine, extra_args)
+    cache_name = _clangCacheName(clang_args, in_name, out_name, args)
+    if cache_name is not None and os.path.isfile(cache_name):
+        if verbose: print '--- Clang skipped: {0} is cached'.format(in_name)
+        return cache_name
+    if verbose: print ' '.join(clang_args)
+    returnvalue, timeout, out_of_mem, segfault, unknown = \
+        run_command_with_limits(clang_args, -1, -1, stage='Clang')
+    if timeout: return FRONTEND_TIMEOUT
+    elif out_of_mem: return FRONTEND_MEMORY_OUT
+    elif segfault or unknown or returnvalue <> 0: return None
+    _cacheStore(out_name, cache_name)
+    return out_name
+
+# Compile each file with clang (args.jobs files in parallel) and link
+# the bitcode into a single module. Return the linked bitcode file.
+def compileAndLink(in_names, workdir, args):
+    import Queue
+    extra_args = []
+    if args.debug_info: extra_args.append('-g')
+
+    jobs = Queue.Queue()
+    for i, f in enumerate(in_names): jobs.put((i, f))
+    bc_names = [None] * len(in_names)
+    def worker():
+        while True:
+            try:
+                (i, f) = jobs.get_nowait()
+            except Queue.Empty:
+                return
+            ## prefix with the position of the file so that files with
+            ## the same name in different directories do not clash
+            out_name = os.path.join(workdir, '{0}.{1}'.format(
+                i, os.path.basename(defBCName(f))))
+            bc_names[i] = _compileTU(f, out_name, args, extra_args)
+
+    workers = [threading.Thread(target=worker)
+               for _ in range(min(args.jobs, len(in_names)))]
+    for w in workers: w.daemon = True; w.start()
+    while any(w.is_alive() for w in workers):
+        for w in workers: w.join(0.5)
+    for bc in bc_names:
+        if bc is None: sys.exit(CLANG_ERROR)
+        if isinstance(bc, int): sys.exit(bc)
+
+    out_name = os.path.join(workdir, 'linked.bc')
+    link_args = [getLlvmLink(), '-o', out_name] + bc_names
+    if verbose: print ' '.join(link_args)
+    returnvalue, timeout, out_of_mem, segfault, unknown = \
+        run_command_with_limits(link_args, args.cpu, args.mem,
+                                stage='Link')
+    if timeout:
+        sys.exit(FRONTEND_TIMEOUT)
+    elif out_of_mem:
+        sys.exit(FRONTEND_MEMORY_OUT)
+    elif segfault or unknown or returnvalue <> 0:
+        sys.exit(CLANG_ERROR)
+    return out_name
 
 # Run llvm optimizer
 def optLlvm(in_name, out_name, args, extra_args=[], cpu = -1, mem = -1):
@@ -637,15 +1116,18 @@ def optLlvm(in_name, out_name, args, extra_args=[], cpu = -1, mem = -1):
     opt_args.extend(extra_args)
     opt_args.append(in_name)
 
+    cache_name = _stageCacheName(opt_args, in_name, out_name, args)
+    if _cacheLoad(cache_name, out_name, 'Opt'): return
     if verbose: print ' '.join(opt_args)
     returnvalue, timeout, out_of_mem, segfault, unknown = \
-        run_command_with_limits(opt_args, cpu, mem)
+        run_command_with_limits(opt_args, cpu, mem, stage='Opt')
     if timeout:
         sys.exit(FRONTEND_TIMEOUT)
     elif out_of_mem:
         sys.exit(FRONTEND_MEMORY_OUT)
     elif unknown or returnvalue <> 0:
         sys.exit(OPT_ERROR)
+    _cacheStore(out_name, cache_name)
 
 # Generate dot files for each LLVM function.
 def dot(in_name, view_dot = False, cpu = -1, mem = -1):
@@ -654,50 +1136,90 @@ def dot(in_name, view_dot = False, cpu = -1, mem = -1):
     if view_dot: args.append('-view-cfg')
     if verbose: print ' '.join(args)
     ## We don't bother here analyzing the exit code
-    run_command_with_limits(args, cpu, mem, fnull)
-    
-# Run crabpp
-def crabpp(in_name, out_name, args, extra_args=[], cpu = -1, mem = -1):
-    if out_name == '' or out_name == None:
-        out_name = defPPName(in_name)
-
-    crabpp_args = [getClamPP(), '-o', out_name, in_name ]
+    run_command_with_limits(args, cpu, mem, fnull, stage='Dot')
     
-    # disable sinking instructions to end of basic block
-    # this might create unwanted aliasing scenarios
-    # for now, there is no option to undo this switch
-    crabpp_args.append('--simplifycfg-sink-common=false')
-
+# Options of clam-pp. If in_process then the options that are also
+# passed to clam are omitted since clam runs the clam-pp pipeline.
+def crabppOpts(args, in_process=False):
+    opts = []
     if args.inline: 
-        crabpp_args.append('--crab-inline-all')
+        opts.append('--crab-inline-all')
+    if args.inline_selective:
+        opts.append('--crab-inline-selective')
+        if args.inline_max_size is not None:
+            opts.append('--crab-inline-max-size={0}'.format(args.inline_max_size))
+        if args.inline_max_calls is not None:
+            opts.append('--crab-inline-max-calls={0}'.format(args.inline_max_calls))
+        if args.inline_caller_budget is not None:
+            opts.append('--crab-inline-caller-budget={0}'.format(args.inline_caller_budget))
+        if args.inline_report:
+            opts.append('--crab-inline-report')
+    if args.specialize:
+        opts.append('--crab-specialize-const-args')
+        if args.specialize_min_calls is not None:
+            opts.append('--crab-specialize-min-calls={0}'.format(args.specialize_min_calls))
+        if args.specialize_max_clones is not None:
+            opts.append('--crab-specialize-max-clones={0}'.format(args.specialize_max_clones))
+        if args.specialize_budget is not None:
+            opts.append('--crab-specialize-budget={0}'.format(args.specialize_budget))
+        if args.specialize_report:
+            opts.append('--crab-specialize-report')
     if args.pp_loops: 
-        crabpp_args.append('--clam-pp-loops')
-    if args.undef_nondet:
-        crabpp_args.append('--crab-turn-undef-nondet')
+        opts.append('--clam-pp-loops')
+    if args.undef_nondet and not in_process:
+        opts.append('--crab-turn-undef-nondet')
         
     if args.disable_lower_gv:
-        crabpp_args.append('--crab-lower-gv=false')
+        opts.append('--crab-lower-gv=false')
     if args.disable_scalarize:
-        crabpp_args.append('--crab-scalarize=false')
-    if args.disable_lower_cst_expr:
-        crabpp_args.append('--crab-lower-constant-expr=false')
-    if args.disable_lower_switch:
-        crabpp_args.append('--crab-lower-switch=false')
+        opts.append('--crab-scalarize=false')
+    if args.disable_lower_cst_expr and not in_process:
+        opts.append('--crab-lower-constant-expr=false')
+    if args.lower_cst_expr_once and not in_process:
+        opts.append('--crab-lower-constant-expr-once')
+    if args.fused_lowering and not in_process:
+        opts.append('--crab-fused-lowering')
+    if args.disable_lower_switch and not in_process:
+        opts.append('--crab-lower-switch=false')
         
     # Postponed until clam is run, otherwise it can be undone by the optLlvm
     # if args.lower_unsigned_icmp:
-    #     crabpp_args.append( '--crab-lower-unsigned-icmp')
+    #     opts.append( '--crab-lower-unsigned-icmp')
     if args.devirt is not 'none':
-        crabpp_args.append('--crab-devirt')
+        opts.append('--crab-devirt')
         if args.devirt == 'types':
-            crabpp_args.append('--devirt-resolver=types')
+            opts.append('--devirt-resolver=types')
         elif args.devirt == 'sea-dsa':
-            crabpp_args.append('--devirt-resolver=sea-dsa')
-            crabpp_args.append('--sea-dsa-type-aware=true')            
+            opts.append('--devirt-resolver=sea-dsa')
+            if not (in_process and args.crab_heap_analysis.endswith('-types')):
+                opts.append('--sea-dsa-type-aware=true')
         elif args.devirt == 'dsa':
-            crabpp_args.append('--devirt-resolver=dsa')            
+            opts.append('--devirt-resolver=dsa')            
+        if args.devirt_share_bounce:
+            opts.append('--devirt-share-bounce-functions')
+        if args.devirt_max_targets is not None:
+            opts.append('--devirt-max-num-targets={0}'.format(args.devirt_max_targets))
+        if args.devirt_table_export is not None:
+            opts.append('--devirt-table-export={0}'.format(args.devirt_table_export))
+        if args.devirt_table_import is not None:
+            opts.append('--devirt-table-import={0}'.format(args.devirt_table_import))
     if args.enable_ext_funcs:
-        crabpp_args.append('--crab-externalize-addr-taken-funcs')
+        opts.append('--crab-externalize-addr-taken-funcs')
+    return opts
+
+# Run crabpp
+def crabpp(in_name, out_name, args, extra_args=[], cpu = -1, mem = -1):
+    if out_name == '' or out_name == None:
+        out_name = defPPName(in_name)
+
+    crabpp_args = [getClamPP(), '-o', out_name, in_name ]
+    
+    # disable sinking instructions to end of basic block
+    # this might create unwanted aliasing scenarios
+    # for now, there is no option to undo this switch
+    crabpp_args.append('--simplifycfg-sink-common=false')
+
+    crabpp_args.extend(crabppOpts(args))
     if args.print_after_all: crabpp_args.append('--print-after-all')
     if args.debug_pass: crabpp_args.append('--debug-pass=Structure')        
 
@@ -705,15 +1227,18 @@ def crabpp(in_name, out_name, args, extra_args=[], cpu = -1, mem = -1):
         for l in args.dsa_log.split(':'): crabpp_args.extend(['-sea-dsa-log', l])
     
     crabpp_args.extend(extra_args)
+    cache_name = _stageCacheName(crabpp_args, in_name, out_name, args)
+    if _cacheLoad(cache_name, out_name, 'ClamPP'): return
     if verbose: print ' '.join(crabpp_args)
     returnvalue, timeout, out_of_mem, segfault, unknown = \
-        run_command_with_limits(crabpp_args, cpu, mem)
+        run_command_with_limits(crabpp_args, cpu, mem, stage='ClamPP')
     if timeout:
         sys.exit(FRONTEND_TIMEOUT)
     elif out_of_mem:
         sys.exit(FRONTEND_MEMORY_OUT)
     elif segfault or unknown or returnvalue <> 0:
         sys.exit(PP_ERROR)
+    _cacheStore(out_name, cache_name)
     
 # Run clam
 def clam(in_name, out_name, args, extra_opts, cpu = -1, mem = -1):
@@ -744,20 +1269,65 @@ def clam(in_name, out_name, args, extra_opts, cpu = -1, mem = -1):
         clam_args.append('--crab-lower-select')
     if args.disable_lower_cst_expr:
         clam_args.append('--crab-lower-constant-expr=false')
+    if args.lower_cst_expr_once:
+        clam_args.append('--crab-lower-constant-expr-once')
+    if args.fused_lowering:
+        clam_args.append('--crab-fused-lowering')
     if args.disable_lower_switch:
         clam_args.append('--crab-lower-switch=false')
     
     clam_args.append('--crab-dom={0}'.format(args.crab_dom))
+    if args.estimate_cost:
+        clam_args.append('--crab-estimate-cost')
+    if args.max_estimated_cost > 0:
+        clam_args.append('--crab-max-estimated-cost={0}'.format(args.max_estimated_cost))
+    if args.staged:
+        clam_args.append('--crab-staged')
+    if args.warm_start:
+        clam_args.append('--crab-warm-start')
+    if args.profile_fixpoint:
+        clam_args.append('--crab-profile-fixpoint')
+    if args.profile_fixpoint_folded is not None:
+        clam_args.append('--crab-profile-fixpoint-folded={0}'.format(args.profile_fixpoint_folded))
+    if args.crab_spill_invariants is not None:
+        clam_args.append('--crab-spill-invariants={0}'.format(args.crab_spill_invariants))
+    if args.crab_release_cfgs:
+        clam_args.append('--crab-release-cfgs')
+    if args.crab_external_models is not None:
+        clam_args.append('--crab-external-models={0}'.format(args.crab_external_models))
+    if args.crab_dom_config is not None:
+        clam_args.append('--crab-dom-config={0}'.format(args.crab_dom_config))
+    if args.crab_export_summaries is not None:
+        clam_args.append('--crab-export-summaries={0}'.format(args.crab_export_summaries))
+    if args.crab_dump_cfg is not None:
+        clam_args.append('--crab-dump-cfg={0}'.format(args.crab_dump_cfg))
+    if args.crab_import_summaries is not None:
+        clam_args.append('--crab-import-summaries={0}'.format(args.crab_import_summaries))
     clam_args.append('--crab-widening-delay={0}'.format(args.widening_delay))
+    if args.widening_delay_auto:
+        clam_args.append('--crab-widening-delay-auto')
     clam_args.append('--crab-widening-jump-set={0}'.format(args.widening_jump_set))
+    if args.widening_jump_set_auto:
+        clam_args.append('--crab-widening-jump-set-auto')
+    if args.crab_fixpoint != 'wto':
+        clam_args.append('--crab-fixpoint={0}'.format(args.crab_fixpoint))
+    if args.max_disjuncts > 0:
+        clam_args.append('--crab-max-disjuncts={0}'.format(args.max_disjuncts))
+    clam_args.append('--crab-array-max-smashable-cells={0}'.format(args.array_max_smashable_cells))
+    clam_args.append('--crab-array-max-size={0}'.format(args.array_max_size))
+    if args.array_auto_limits:
+        clam_args.append('--crab-array-auto-limits')
     clam_args.append('--crab-narrowing-iterations={0}'.format(args.narrowing_iterations))
     clam_args.append('--crab-relational-threshold={0}'.format(args.num_threshold))
+    clam_args.append('--crab-pack-size={0}'.format(args.pack_size))
     if args.track == 'arr':        
         clam_args.append('--crab-track=arr')
         if args.crab_disable_array_smashing:
             clam_args.append('--crab-use-array-smashing=false')
     else:
         clam_args.append('--crab-track={0}'.format(args.track))
+    if args.track_adaptive:
+        clam_args.append('--crab-track-adaptive')
     if args.crab_heap_analysis == 'none' or \
        args.crab_heap_analysis == 'llvm-dsa' or \
        args.crab_heap_analysis == 'ci-sea-dsa' or \
@@ -769,22 +1339,117 @@ def clam(in_name, out_name, args, extra_opts, cpu = -1, mem = -1):
     elif args.crab_heap_analysis == 'cs-sea-dsa-types':
         clam_args.append('--crab-heap-analysis=cs-sea-dsa')
         clam_args.append('--sea-dsa-type-aware=true')
+    if args.crab_heap_analysis_budget > 0:
+        clam_args.append('--crab-heap-analysis-budget={0}'.format(args.crab_heap_analysis_budget))
+    if args.crab_heap_snapshot is not None:
+        clam_args.append('--crab-heap-snapshot={0}'.format(args.crab_heap_snapshot))
     if args.crab_singleton_aliases: clam_args.append('--crab-singleton-aliases')
+    if args.crab_promote_local_regions: clam_args.append('--crab-promote-local-regions')
+    if args.crab_forget_dead_arrays: clam_args.append('--crab-forget-dead-arrays')
+    if args.crab_array_expand_max_elems > 0:
+        clam_args.append('--crab-array-expand-max-elems={0}'.format(args.crab_array_expand_max_elems))
+    if args.crab_accelerate_loops: clam_args.append('--crab-accelerate-loops')
+    if args.crab_hoist_loop_havocs: clam_args.append('--crab-hoist-loop-havocs')
     if args.crab_inter:
         clam_args.append('--crab-inter')
         clam_args.append('--crab-inter-max-summaries={0}'.format(args.inter_max_summaries))
+        if args.inter_reuse_subsumed:
+            clam_args.append('--crab-inter-reuse-subsumed-contexts')
+        if args.inter_multi_root:
+            clam_args.append('--crab-inter-multi-root')
+        if args.inter_merge_checks:
+            clam_args.append('--crab-inter-merge-checks')
         #clam_args.append('--crab-inter-sum-dom={0}'.format(args.crab_inter_sum_dom))
+        if args.crab_inter_per_function_dom:
+            clam_args.append('--crab-inter-per-function-dom')
+        if args.crab_inter_all_functions:
+            clam_args.append('--crab-inter-reachable-only=false')
+    if args.crab_threads > 1:
+        clam_args.append('--crab-threads={0}'.format(args.crab_threads))
+        if args.crab_threads_mem_budget > 0:
+            clam_args.append('--crab-threads-mem-budget={0}'.format(args.crab_threads_mem_budget))
+        if args.crab_threads_numa:
+            clam_args.append('--crab-threads-numa')
+    if args.crab_triage:
+        clam_args.append('--crab-triage')
+    if args.crab_function_var_scopes:
+        clam_args.append('--crab-function-var-scopes')
+    if args.crab_deterministic:
+        clam_args.append('--crab-deterministic')
+    if args.crab_pipeline_heap:
+        clam_args.append('--crab-pipeline-heap')
+    if args.crab_cfg_block_threads > 1:
+        clam_args.append('--crab-cfg-block-threads={0}'.format(args.crab_cfg_block_threads))
+    if args.crab_fun_timeout > 0:
+        clam_args.append('--crab-fun-timeout={0}'.format(args.crab_fun_timeout))
+    if args.crab_inter_deadline > 0:
+        clam_args.append('--crab-inter-deadline={0}'.format(args.crab_inter_deadline))
+    if args.crab_fun_mem_limit > 0:
+        clam_args.append('--crab-fun-mem-limit={0}'.format(args.crab_fun_mem_limit))
+    if args.crab_fun_rss_limit > 0:
+        clam_args.append('--crab-fun-rss-limit={0}'.format(args.crab_fun_rss_limit))
+    if args.crab_downgrade_chain is not None:
+        clam_args.append('--crab-downgrade-chain={0}'.format(args.crab_downgrade_chain))
+    if args.crab_cache_dir is not None:
+        clam_args.append('--crab-cache-dir={0}'.format(args.crab_cache_dir))
+    if args.crab_checkpoint_dir is not None:
+        clam_args.append('--crab-checkpoint-dir={0}'.format(args.crab_checkpoint_dir))
         
     if args.crab_backward: clam_args.append('--crab-backward')
+    if args.crab_backward_unproven_only:
+        clam_args.append('--crab-backward-unproven-only')
     if args.crab_live: clam_args.append('--crab-live')
     clam_args.append('--crab-add-invariants={0}'.format(args.insert_inv_loc))
+    if args.insert_inv_dedup: clam_args.append('--crab-add-invariants-dedup')
+    if args.insert_inv_threads is not None:
+        clam_args.append('--crab-add-invariants-threads={0}'.format(args.insert_inv_threads))
+    if args.intern_invariants: clam_args.append('--crab-intern-invariants')
+    if args.head_invariants: clam_args.append('--crab-head-invariants')
+    if args.delta_invariants: clam_args.append('--crab-delta-invariants')
     if args.crab_promote_assume: clam_args.append('--crab-promote-assume')
+    if args.lazy_functions: clam_args.append('--lazy-functions')
     if args.assert_check: clam_args.append('--crab-check={0}'.format(args.assert_check))
+    if args.crab_slice_to_checks:
+        clam_args.append('--crab-slice-to-checks')
+    if args.crab_reachable_only:
+        clam_args.append('--crab-reachable-only')
+    if args.crab_roots is not None:
+        clam_args.append('--crab-roots={0}'.format(args.crab_roots))
+    if args.crab_shard is not None:
+        clam_args.append('--crab-shard={0}'.format(args.crab_shard))
+    if args.crab_changed_lines is not None:
+        clam_args.append('--crab-changed-lines={0}'.format(args.crab_changed_lines))
+    if args.crab_changed_callers_depth is not None:
+        clam_args.append('--crab-changed-callers-depth={0}'.format(args.crab_changed_callers_depth))
     if args.check_verbose:
         clam_args.append('--crab-check-verbose={0}'.format(args.check_verbose))
+    if args.check_early_stop:
+        clam_args.append('--crab-check-early-stop')
+    if args.check_early_stop_skip_invariants:
+        clam_args.append('--crab-check-early-stop-skip-invariants')
+    if args.check_threads is not None:
+        clam_args.append('--crab-check-threads={0}'.format(args.check_threads))
     if args.print_summs: clam_args.append('--crab-print-summaries')
     if args.print_cfg: clam_args.append('--crab-print-cfg')
+    if args.cfg_report != 'none':
+        clam_args.append('--crab-cfg-report={0}'.format(args.cfg_report))
+    if args.crab_output_file is not None:
+        clam_args.append('--crab-output-file={0}'.format(args.crab_output_file))
     if args.print_stats: clam_args.append('--crab-stats')
+    if args.crab_stats_json is not None:
+        clam_args.append('--crab-stats-json={0}'.format(args.crab_stats_json))
+    if args.crab_dom_instrument: clam_args.append('--crab-dom-instrument')
+    if args.crab_check_stream is not None:
+        clam_args.append('--crab-check-stream={0}'.format(args.crab_check_stream))
+    if args.crab_check_index is not None:
+        clam_args.append('--crab-check-index={0}'.format(args.crab_check_index))
+    if args.crab_progress_file is not None:
+        clam_args.append('--crab-progress-file={0}'.format(args.crab_progress_file))
+        clam_args.append('--crab-progress-interval={0}'.format(args.crab_progress_interval))
+    if args.crab_stop_on_error:
+        clam_args.append('--crab-stop-on-error')
+    if args.crab_invariants_db is not None:
+        clam_args.append('--crab-invariants-db={0}'.format(args.crab_invariants_db))
     if args.print_assumptions: clam_args.append('--crab-print-unjustified-assumptions')
     if args.crab_disable_warnings:
         clam_args.append('--crab-enable-warnings=false')
@@ -792,6 +1457,8 @@ def clam(in_name, out_name, args, extra_opts, cpu = -1, mem = -1):
     if args.crab_cfg_simplify: clam_args.append('--crab-cfg-simplify')
     if args.crab_print_invariants:
         clam_args.append('--crab-print-invariants')
+    if args.crab_print_invariants_compact:
+        clam_args.append('--crab-print-invariants-compact')
     if args.store_invariants:
         clam_args.append('--crab-store-invariants=true')
     else:
@@ -805,12 +1472,18 @@ def clam(in_name, out_name, args, extra_opts, cpu = -1, mem = -1):
         clam_args.append('--crab-name-values=true')
     else:
         clam_args.append('--crab-name-values=false')    
+    if args.crab_lazy_names:
+        clam_args.append('--crab-lazy-names')
     if args.crab_enable_bignums:
         clam_args.append('--crab-enable-bignums=true')
     else:
         clam_args.append('--crab-enable-bignums=false')
+    if args.crab_disable_native_select:
+        clam_args.append('--crab-native-select=false')
     if args.crab_memssa:
         clam_args.append('--crab-memssa=true')
+    if args.crab_memssa_regions:
+        clam_args.append('--crab-memssa-regions')
     # end hidden options
         
     if verbose: print ' '.join(clam_args)
@@ -824,8 +1497,14 @@ def clam(in_name, out_name, args, extra_opts, cpu = -1, mem = -1):
     if args.debug_pass:        
         clam_args.append('--debug-pass=Structure')            
 
+    if args.crab_huge_pages:
+        # -- older versions of glibc ignore the tunable
+        tunables = os.environ.get('GLIBC_TUNABLES')
+        os.environ['GLIBC_TUNABLES'] = 'glibc.malloc.hugetlb=1' + \
+            (':' + tunables if tunables else '')
+
     returnvalue, timeout, out_of_mem, segfault, unknown = \
-        run_command_with_limits(clam_args, cpu, mem)
+        run_command_with_limits(clam_args, cpu, mem, stage='Clam')
     if timeout:
         sys.exit(CRAB_TIMEOUT)
     elif out_of_mem:
@@ -855,7 +1534,15 @@ def main(argv):
 
     args  = parseArgs(argv[1:])
     workdir = createWorkDir(args.temp_dir, args.save_temps)
-    in_name = args.file
+    if args.stats_json is not None:
+        atexit.register(stats.json_dump, args.stats_json)
+    if args.link:
+        with stats.timer('Link'):
+            in_name = compileAndLink(args.file, workdir, args)
+    elif len(args.file) > 1:
+        return runJobs(argv, args, workdir)
+    else:
+        in_name = args.file[0]
 
     if args.preprocess:
         bc_out = defBCName(in_name, workdir)
@@ -867,14 +1554,17 @@ def main(argv):
                 #stat('Progress', 'Clang')
         in_name = bc_out
 
-        pp_out = defPPName(in_name, workdir)
-        if pp_out != in_name:
-            with stats.timer('ClamPP'):
-                crabpp(in_name, pp_out, args=args, cpu=args.cpu, mem=args.mem)
-            #stat('Progress', 'Clam preprocessor')
-        in_name = pp_out
-
-    if args.L > 0:
+        # with --in-process clam-pp and opt are run by clam on the
+        # in-memory module
+        if not args.in_process:
+            pp_out = defPPName(in_name, workdir)
+            if pp_out != in_name:
+                with stats.timer('ClamPP'):
+                    crabpp(in_name, pp_out, args=args, cpu=args.cpu, mem=args.mem)
+                #stat('Progress', 'Clam preprocessor')
+            in_name = pp_out
+
+    if args.L > 0 and not (args.in_process and args.preprocess):
         o_out = defOptName(in_name, workdir)
         if o_out != in_name:
             extra_args = []
@@ -888,6 +1578,17 @@ def main(argv):
         extra_opts = []
         if args.only_preprocess:
             extra_opts.append('-no-crab')
+        if args.in_process and args.preprocess:
+            extra_opts.append('--clam-pp')
+            extra_opts.extend(crabppOpts(args, in_process=True))
+            if args.L > 0:
+                extra_opts.append('--clam-opt-level={0}'.format(args.L))
+                if args.inline_threshold is not None:
+                    extra_opts.append('--inline-threshold={t}'.format
+                                      (t=args.inline_threshold))
+                if args.unroll_threshold is not None:
+                    extra_opts.append('--unroll-threshold={t}'.format
+                                      (t=args.unroll_threshold))
         clam(in_name, pp_out, args, extra_opts, cpu=args.cpu, mem=args.mem)
 
     if args.dot_cfg: dot(pp_out)
@@ -900,6 +1601,107 @@ def main(argv):
 
     return 0
 
+# Command line of the job that analyzes in_name: the one of the driver
+# without the input files and --jobs, and with its own temporary
+# directory so that files with the same name do not clash.
+def _jobArgs(argv, args, in_name, jobdir):
+    job_args = [sys.executable, os.path.realpath(__file__)]
+    files = list(args.file)
+    skip = False
+    for a in argv[1:]:
+        if skip:
+            skip = False
+        elif a in files:
+            files.remove(a)
+        elif a == '-j' or a == '--jobs':
+            skip = True
+        elif not (a.startswith('--jobs=') or \
+                  (a.startswith('-j') and a[2:].isdigit())):
+            job_args.append(a)
+    if args.temp_dir is not None:
+        job_args.append('--temp-dir={0}'.format(jobdir))
+    job_args.append(in_name)
+    return job_args
+
+# Analyze several input files with a pool of args.jobs workers. Each
+# file is analyzed by a separate clam.py process which runs the whole
+# pipeline (clang, clam-pp, opt and clam) so the stages of one file run
+# in order and never wait for other files: while a file is analyzed by
+# clam the next ones are compiled by clang. The output of each job is
+# printed once it finishes and the statistics of all jobs are reported
+# together.
+def runJobs(argv, args, workdir):
+    import Queue
+    import time
+
+    jobs = Queue.Queue()
+    ## the largest files first so that they do not finish last
+    for i, f in sorted(enumerate(args.file),
+                       key=lambda (i, f): -os.path.getsize(f) \
+                       if os.path.isfile(f) else 0):
+        jobs.put((i, f))
+
+    results = [None] * len(args.file)
+    lock = threading.Lock()
+    def worker():
+        while not stop_event.is_set():
+            try:
+                (i, f) = jobs.get_nowait()
+            except Queue.Empty:
+                return
+            jobdir = os.path.join(workdir, 'job{0}'.format(i))
+            if not os.path.isdir(jobdir): os.makedirs(jobdir)
+            log_name = os.path.join(jobdir, 'clam.log')
+            start = time.time()
+            with open(log_name, 'w') as log:
+                p = sub.Popen(_jobArgs(argv, args, f, jobdir),
+                              stdout=log, stderr=sub.STDOUT)
+                with running_jobs_lock: running_jobs.append(p)
+                returnvalue = p.wait()
+                with running_jobs_lock: running_jobs.remove(p)
+            results[i] = (f, returnvalue, time.time() - start, log_name)
+            with lock:
+                with open(log_name) as log:
+                    print '=== {0} ==='.format(f)
+                    sys.stdout.write(log.read())
+
+    stop_event = threading.Event()
+    workers = [threading.Thread(target=worker)
+               for _ in range(min(args.jobs, len(args.file)))]
+    for w in workers: w.daemon = True; w.start()
+    try:
+        ## join with a timeout so that KeyboardInterrupt is delivered
+        while any(w.is_alive() for w in workers):
+            for w in workers: w.join(0.5)
+    except KeyboardInterrupt:
+        stop_event.set()
+        raise
+
+    ## aggregate the statistics printed by each job
+    totals = dict()
+    failed = 0
+    print '----------------------------------------------------------------------'
+    print 'JOBS: {0} files, {1} in parallel'.format(len(args.file), args.jobs)
+    for (f, returnvalue, elapsed, log_name) in results:
+        if returnvalue != 0: failed += 1
+        print '{0:>8.2f}s exit={1:<4} {2}'.format(elapsed, returnvalue, f)
+        with open(log_name) as log:
+            for line in log:
+                words = line.split()
+                if len(words) != 3 or words[0] != 'BRUNCH_STAT': continue
+                try:
+                    v = float(words[2])
+                except ValueError: continue
+                if words[1].endswith('.maxrss_mb'):
+                    totals[words[1]] = max(totals.get(words[1], 0.0), v)
+                else:
+                    totals[words[1]] = totals.get(words[1], 0.0) + v
+    print '----------------------------------------------------------------------'
+    for k, v in totals.iteritems(): stats.put(k, '{0:.2f}'.format(v))
+    stats.put('Jobs', len(args.file))
+    stats.put('FailedJobs', failed)
+    return CRAB_ERROR if failed > 0 else 0
+
 def killall():
     global running_process
     if running_process != None:
@@ -909,6 +1711,12 @@ def killall():
             running_process.wait()
             running_process = None
         except OSError: pass
+    with running_jobs_lock: procs = list(running_jobs)
+    for p in procs:
+        try:
+            p.terminate()
+            p.wait()
+        except OSError: pass
 
 if __name__ == '__main__':
     # unbuffered output
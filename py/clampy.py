@@ -0,0 +1,146 @@
+#!/usr/bin/env python2
+
+# In-process bindings of Clam through libclampy (tools/clampy.cc).
+#
+# Build with -DCLAM_PYTHON_BINDINGS=ON. The library is looked up in
+# $CLAMPY_LIB, then in ../lib next to this file (installed layout).
+#
+#   import clampy
+#   clampy.init(['--crab-track=num'])
+#   m = clampy.Module('prog.bc')
+#   res = m.analyze('main', dom='zones', widening_delay=2)
+#   print res.checks.safe, res.checks.warning
+#   for b in res.blocks('main'):
+#       print b.name, b.pre_constraints
+#
+# The CFGs are built once per module and reused by all the analyses.
+
+import ctypes
+import json
+import os
+
+_lib = None
+
+def _load_library ():
+  global _lib
+  if _lib is not None:
+    return _lib
+  candidates = []
+  if 'CLAMPY_LIB' in os.environ:
+    candidates.append (os.environ ['CLAMPY_LIB'])
+  root = os.path.dirname (os.path.dirname (os.path.abspath (__file__)))
+  for name in ['libclampy.so', 'libclampy.dylib']:
+    candidates.append (os.path.join (root, 'lib', name))
+  for path in candidates:
+    if os.path.isfile (path):
+      lib = ctypes.CDLL (path)
+      break
+  else:
+    raise IOError ('libclampy not found (set CLAMPY_LIB)')
+  lib.clampy_init.argtypes = [ctypes.c_int, ctypes.POINTER (ctypes.c_char_p)]
+  lib.clampy_init.restype = ctypes.c_int
+  lib.clampy_load.argtypes = [ctypes.c_char_p, ctypes.POINTER (ctypes.c_void_p)]
+  lib.clampy_load.restype = ctypes.c_void_p
+  lib.clampy_functions.argtypes = [ctypes.c_void_p]
+  lib.clampy_functions.restype = ctypes.c_void_p
+  lib.clampy_analyze.argtypes = [ctypes.c_void_p, ctypes.c_char_p,
+                                 ctypes.c_char_p, ctypes.POINTER (ctypes.c_void_p)]
+  lib.clampy_analyze.restype = ctypes.c_void_p
+  lib.clampy_free.argtypes = [ctypes.c_void_p]
+  lib.clampy_free.restype = None
+  lib.clampy_free_string.argtypes = [ctypes.c_void_p]
+  lib.clampy_free_string.restype = None
+  _lib = lib
+  return lib
+
+class ClamError (Exception):
+  pass
+
+def _encode (s):
+  return s if s is None or isinstance (s, bytes) else s.encode ('utf-8')
+
+def _take_string (lib, ptr):
+  """ Copy and release a string returned by libclampy """
+  try:
+    return ctypes.cast (ptr, ctypes.c_char_p).value.decode ('utf-8')
+  finally:
+    lib.clampy_free_string (ptr)
+
+def _check (lib, res, err):
+  if not res:
+    raise ClamError (_take_string (lib, err.value) if err.value else 'unknown error')
+  return _take_string (lib, res)
+
+def init (options = None):
+  """ Set the --crab-* options as in the clam command line. Only the
+      first call has effect. """
+  lib = _load_library ()
+  options = [_encode (o) for o in (options or [])]
+  argv = (ctypes.c_char_p * (len (options) + 1)) (*(options + [None]))
+  lib.clampy_init (len (options), argv)
+
+class Checks (object):
+  def __init__ (self, d):
+    self.safe = d ['safe']
+    self.error = d ['error']
+    self.warning = d ['warning']
+    self.report = d ['report']
+
+class Block (object):
+  def __init__ (self, d):
+    self.name = d ['block']
+    # invariants as printed by crab (None if not stored)
+    self.pre = d ['pre']
+    self.post = d ['post']
+    # constraints of the invariant at the entry
+    self.pre_constraints = d ['pre_constraints']
+
+class Result (object):
+  def __init__ (self, d):
+    self.time = d ['time']
+    self.checks = Checks (d ['checks'])
+    self._functions = d ['functions']
+
+  @property
+  def functions (self):
+    return list (self._functions.keys ())
+
+  def blocks (self, function):
+    return [Block (b) for b in self._functions [function]]
+
+class Module (object):
+  """ A bitcode file whose Crab CFGs are kept in memory """
+  def __init__ (self, filename):
+    self._lib = _load_library ()
+    init ()
+    err = ctypes.c_void_p ()
+    self._session = self._lib.clampy_load (_encode (filename), ctypes.byref (err))
+    if not self._session:
+      raise ClamError (_take_string (self._lib, err.value))
+
+  def close (self):
+    if self._session:
+      self._lib.clampy_free (self._session)
+      self._session = None
+
+  def __del__ (self):
+    self.close ()
+
+  def __enter__ (self):
+    return self
+
+  def __exit__ (self, *args):
+    self.close ()
+
+  def functions (self):
+    return json.loads (_take_string (self._lib, self._lib.clampy_functions (self._session)))
+
+  def analyze (self, function = None, **params):
+    """ Analyze function (all if None). The keyword arguments override
+        the options: dom, check ('none' or 'assert'), inter, backward,
+        widening_delay, narrowing_iterations, widening_jumpset,
+        relational_threshold and max_estimated_cost. """
+    err = ctypes.c_void_p ()
+    res = self._lib.clampy_analyze (self._session, _encode (function),
+                                    _encode (json.dumps (params)), ctypes.byref (err))
+    return Result (json.loads (_check (self._lib, res, err)))
@@ -3,13 +3,13 @@
 from distutils.core import setup
 from os.path import join
 
-scripts = ['clam.py']
+scripts = ['clam.py', 'clam-bench.py', 'clam-scale.py']
 scripts = map(lambda x: join('${CMAKE_CURRENT_SOURCE_DIR}', x), scripts)
 
 setup(name='clam',
       description='An Abstract Interpretation-based Analyzer for LLVM bitecode',
       url='https://github.com/seahorn/crab-llvm',
       package_dir={'': '${CMAKE_CURRENT_SOURCE_DIR}'},
-      py_modules=['stats'],
+      py_modules=['stats', 'clampy'],
       scripts=scripts
       )
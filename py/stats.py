@@ -3,6 +3,8 @@
 # simple statistics module
 
 import resource
+import sys
+import threading
 
 def _systemtime ():
   ru_self = resource.getrusage (resource.RUSAGE_SELF)
@@ -95,6 +97,39 @@ def count (key):
     if c is None: put (key, 1)
     else: put (key, c + 1)
 
+_stages = dict()
+_stages_lock = threading.Lock ()
+
+def stage (name, wall, ru):
+    """ Records the wall time and the resource usage ru (as returned by
+        wait4) of a process launched by the pipeline stage name """
+    # ru_maxrss is in kilobytes except on macOS where it is in bytes
+    maxrss = ru.ru_maxrss / 1024.0
+    if sys.platform == 'darwin': maxrss /= 1024.0
+    with _stages_lock:
+      _stage (name, wall, ru, maxrss)
+
+def _stage (name, wall, ru, maxrss):
+    st = _stages.get (name)
+    if st is None:
+        st = {'count': 0, 'wall': 0.0, 'user': 0.0, 'sys': 0.0, 'maxrss_mb': 0.0}
+        _stages[name] = st
+    st['count'] += 1
+    st['wall'] += wall
+    st['user'] += ru.ru_utime
+    st['sys'] += ru.ru_stime
+    st['maxrss_mb'] = max (st['maxrss_mb'], maxrss)
+    for k in ('wall', 'user', 'sys', 'maxrss_mb'):
+        put ('{0}.{1}'.format (name, k), '{0:.2f}'.format (st[k]))
+
+def json_dump (filename):
+    """ Writes the statistics and the usage of each stage in JSON """
+    import json
+    out = {'stats': dict ((k, str (v)) for k, v in _statistics.iteritems ()),
+           'stages': _stages}
+    with open (filename, 'w') as f:
+        json.dump (out, f, indent=2, sort_keys=True)
+
 def brunch_print ():
     """ Prints the result in brunch format """
 
@@ -0,0 +1,22 @@
+// RUN: %clam -O0 --crab-track=arr --crab-disable-array-smashing --crab-dom=int --crab-check=assert --crab-array-expand-max-elems=8 "%s" 2>&1 | OutputCheck %s
+// CHECK: ^2  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The local array of 4 elements is tagged to be expanded so its
+// elements are kept apart while the global buffer is tagged to be
+// smashed.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int buf[4096];
+
+int main() {
+  int a[4];
+  a[0] = 1;
+  a[1] = 2;
+  buf[nd() % 4096] = 5;
+  __CRAB_assert(a[0] == 1);
+  __CRAB_assert(a[1] == 2);
+  return buf[0];
+}
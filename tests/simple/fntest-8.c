@@ -0,0 +1,36 @@
+// RUN: %clam -O0 --devirt-functions=sea-dsa --devirt-max-num-targets=1 --crab-inter --crab-check=assert --crab-sanity-checks "%s" 2>&1 | OutputCheck %s
+// CHECK: ^1  Number of total safe checks$
+// CHECK: ^0  Number of total error checks$
+// CHECK: ^1  Number of total warning checks$
+
+// p has two targets so the call is replaced with an external call
+// whose result is unknown.
+
+extern void __CRAB_assert(int);
+
+int a (void);
+int b (void);
+int c (void);
+
+int main(int argc, char** argv) {
+  int (*p) (void);
+  int (*q) (void);
+
+  if (argc == 1) {
+      p = a;
+  } else {
+      p = b;
+  }
+  q = c;
+
+  int x = p();
+  int y = q();
+
+  __CRAB_assert(x>= 5);
+  __CRAB_assert(y>= 15);
+  return 0;
+}
+
+int a() {return 10;}
+int b() {return 5;}
+int c() {return 15;}
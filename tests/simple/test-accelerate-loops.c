@@ -0,0 +1,17 @@
+// RUN: %clam -O0 --crab-accelerate-loops --crab-narrowing-iterations=0 --crab-dom=int --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^2  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// Without narrowing the bounds of i and j are only found by the
+// closed-form ranges of the counting loops.
+
+extern void __CRAB_assert(int);
+
+int main() {
+  int i, j;
+  for (i = 0; i < 100; i += 2) {}
+  __CRAB_assert(i <= 101);
+  for (j = 50; j >= 10; --j) {}
+  __CRAB_assert(j >= 9);
+  return 0;
+}
@@ -0,0 +1,36 @@
+// RUN: %clam -O0 --crab-dom=zones --crab-add-invariants=all --oll=%t.serial.ll "%s" > /dev/null 2>&1
+// RUN: %clam -O0 --crab-dom=zones --crab-add-invariants=all --crab-add-invariants-threads=4 --oll=%t.parallel.ll "%s" > /dev/null 2>&1
+// RUN: diff %t.serial.ll %t.parallel.ll
+// RUN: cat %t.parallel.ll | OutputCheck %s
+// CHECK: call void @verifier.assume
+
+// The code inserted when the instrumentation of the functions is
+// planned by several threads is the same as with one thread.
+
+extern int nd(void);
+int A[10];
+
+int f1(int n) {
+  int i, x = 0;
+  for (i = 0; i < n; i++) x++;
+  return x - i;
+}
+
+int f2(int n) {
+  int i, s = 0;
+  for (i = 0; i < 10; i++) {
+    A[i] = n;
+    s += A[i];
+  }
+  return s;
+}
+
+int f3(int a, int b) {
+  int c = a;
+  if (a > b) c = b;
+  return c;
+}
+
+int main() {
+  return f1(nd()) + f2(nd()) + f3(nd(), nd());
+}
@@ -0,0 +1,12 @@
+// RUN: %clam -O0 --crab-cfg-report=json "%s" 2>&1 | OutputCheck %s
+// CHECK: ^{"function": "main", .*"statements": {"assign": [0-9]+, "assume": [0-9]+
+// CHECK: "variables": {"scalar": [0-9]+, "array": 0, "shadow": [0-9]+}
+
+extern int nd(void);
+
+int main() {
+  int i, x = 0, n = nd();
+  for (i = 0; i < n; i++)
+    x += 2;
+  return x;
+}
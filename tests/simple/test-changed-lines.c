@@ -0,0 +1,32 @@
+// RUN: echo "test-changed-lines.c:16-17" > %t.lines
+// RUN: %clam -O0 -g --crab-dom=zones --crab-check=assert --crab-changed-lines=%t.lines "%s" 2>&1 | OutputCheck %s
+// CHECK: ^1  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// Only f1 has a changed line so the assertions of f2 and main are
+// not checked.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int f1(int n) {
+  int i, x = 0;
+  for (i = 0; i < n; i++)
+    x++;
+  __CRAB_assert(x - i <= 0);
+  return x;
+}
+
+int f2(int n) {
+  int i, y = 10;
+  for (i = 0; i < n; i++)
+    y++;
+  __CRAB_assert(y - i >= 10);
+  return y;
+}
+
+int main() {
+  int s = f1(nd()) + f2(nd());
+  __CRAB_assert(s >= -2147483648);
+  return s;
+}
@@ -0,0 +1,20 @@
+// RUN: %clam -O0 -g --crab-dom=int --crab-check=assert --crab-check-stream=- --crab-stop-on-error "%s" 2>&1 | OutputCheck %s
+// CHECK: ^\{"function": "main", "file": ".*test-check-stream.c", "line": 16, "safe": 0, "error": 1, "warning": 0
+// CHECK: ^\{"stopped": "main"\}$
+// CHECK: ^1  Number of total error checks$
+
+// The record of main is written as soon as it is analyzed and the
+// analysis stops after its error.
+
+extern void __CRAB_assert(int);
+
+int f(int x) {
+  __CRAB_assert(x > 0);
+  return x;
+}
+
+int main() {
+  int x = 5;
+  __CRAB_assert(x < 5);
+  return 0;
+}
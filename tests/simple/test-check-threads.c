@@ -0,0 +1,21 @@
+// RUN: %clam -O0 --crab-dom=int --crab-check=assert --crab-check-threads=4 "%s" 2>&1 | OutputCheck %s
+// CHECK: ^3  Number of total safe checks$
+// CHECK: ^1  Number of total warning checks$
+
+// The assertions of the blocks are checked from several threads.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int main() {
+  int x = nd();
+  if (x < 0 || x > 10) return 0;
+  __CRAB_assert(x >= 0);
+  if (nd()) {
+    __CRAB_assert(x <= 10);
+  } else {
+    __CRAB_assert(x + 1 <= 11);
+  }
+  __CRAB_assert(x <= 5);
+  return 0;
+}
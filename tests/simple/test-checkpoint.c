@@ -0,0 +1,18 @@
+// RUN: rm -rf %t.dir
+// RUN: %clam -O0 --crab-dom=int --crab-check=assert --crab-checkpoint-dir=%t.dir "%s" > /dev/null
+// RUN: (%clam -O0 --crab-dom=int --crab-check=assert --crab-checkpoint-dir=%t.dir "%s"; cat %t.dir/progress-*) 2>&1 | OutputCheck %s
+// CHECK: ^1  Number of total safe checks$
+// CHECK: ^1  Number of total error checks$
+// CHECK: ^main\t1\t1\t0\t
+
+// The second run restores main from the checkpoint of the first one
+// with the same checks.
+
+extern void __CRAB_assert(int);
+
+int main() {
+  int x = 5;
+  __CRAB_assert(x == 5);
+  __CRAB_assert(x < 5);
+  return 0;
+}
@@ -0,0 +1,19 @@
+// RUN: %clam -O0 --crab-dom=zones --crab-delta-invariants --crab-add-invariants=all --oll=%t.ll "%s" > /dev/null 2>&1
+// RUN: cat %t.ll | OutputCheck %s
+// CHECK: call void @verifier.assume
+
+// The invariants inserted in the blocks of the loop body are decoded
+// from the deltas with respect to the loop head.
+
+extern int nd(void);
+
+int main() {
+  int i, x = 0, n = nd();
+  for (i = 0; i < n; i++) {
+    if (nd())
+      x++;
+    else
+      x += 2;
+  }
+  return x - i;
+}
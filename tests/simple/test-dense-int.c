@@ -0,0 +1,25 @@
+// RUN: %clam -O0 --crab-dom=int,dense-int --crab-check=assert --crab-sanity-checks "%s" 2>&1 | OutputCheck %s
+// CHECK: DOMAIN SWEEP
+// CHECK: ^\S+ +[0-9.]+ +2 +0 +0 +\+0$
+// CHECK: ^\S+ +[0-9.]+ +2 +0 +0 +\+0$
+// CHECK: ^2  Number of total safe checks$
+
+// The dense intervals prove the same assertions as the intervals.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int main (){
+
+  int x,i;
+  x=0;
+  for (i=0;i< 10;i++) {
+    if (nd())
+      x++;
+  }
+
+  __CRAB_assert(x>=0);
+  __CRAB_assert(i<=10);
+
+  return x;
+}
@@ -0,0 +1,51 @@
+// RUN: %clam -O0 --crab-dom=zones --crab-check=assert --crab-print-invariants --crab-deterministic --crab-threads=1 "%s" > %t.serial 2>&1
+// RUN: %clam -O0 --crab-dom=zones --crab-check=assert --crab-print-invariants --crab-deterministic --crab-threads=4 --crab-check-threads=2 "%s" > %t.parallel 2>&1
+// RUN: diff %t.serial %t.parallel
+// RUN: cat %t.parallel | OutputCheck %s
+// CHECK: ^5  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// With --crab-deterministic the invariants (whose constraints are
+// printed in the order of the variables) and the checks are the same
+// whatever the number of threads.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int f1(int n) {
+  int i, x = 0;
+  for (i = 0; i < n; i++) x++;
+  __CRAB_assert(x - i <= 0);
+  return x;
+}
+
+int f2(int n) {
+  int i, y = 10;
+  for (i = 0; i < n; i++) y++;
+  __CRAB_assert(y - i >= 10);
+  return y;
+}
+
+int f3(int a, int b) {
+  int c = a;
+  if (a > b) c = b;
+  __CRAB_assert(c <= a);
+  __CRAB_assert(c - b <= 0);
+  return c;
+}
+
+int f4(int n) {
+  int i, j = 0;
+  for (i = 0; i < n; i++) j += 2;
+  __CRAB_assert(j >= 0);
+  return j;
+}
+
+int main() {
+  int s = 0;
+  s += f1(nd());
+  s += f2(nd());
+  s += f3(nd(), nd());
+  s += f4(nd());
+  return s;
+}
@@ -0,0 +1,26 @@
+// RUN: %clam -O0 --crab-dom=int --crab-check=assert --crab-sanity-checks "%s" 2>&1 | OutputCheck %s
+// CHECK: ^2  Number of total safe checks$
+// CHECK: ^0  Number of total error checks$
+// CHECK: ^0  Number of total warning checks$
+
+// Intervals cannot prove the assertions but main is analyzed with
+// zones because of its annotation.
+
+extern void __CRAB_assert(int);
+
+__attribute__((annotate("clam.dom=zones")))
+int main (){
+
+  int x,y,i;
+  x=0;
+  y=0;
+  for (i=0;i< 10;i++) {
+    x++;
+    y++;
+  }
+
+  __CRAB_assert(x>=y);
+  __CRAB_assert(y>=x);
+
+  return x+y;
+}
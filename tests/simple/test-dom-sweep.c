@@ -0,0 +1,26 @@
+// RUN: %clam -O0 --crab-dom=int,zones --crab-check=assert --crab-sanity-checks "%s" 2>&1 | OutputCheck %s
+// CHECK: DOMAIN SWEEP
+// CHECK: ^\S+ +[0-9.]+ +0 +0 +2 +\+0$
+// CHECK: ^\S+ +[0-9.]+ +2 +0 +0 +\+2$
+// CHECK: ^2  Number of total safe checks$
+
+// Zones prove the two assertions that intervals cannot prove. The
+// results of the last domain are reported.
+
+extern void __CRAB_assert(int);
+
+int main (){
+
+  int x,y,i;
+  x=0;
+  y=0;
+  for (i=0;i< 10;i++) {
+    x++;
+    y++;
+  }
+
+  __CRAB_assert(x>=y);
+  __CRAB_assert(y>=x);
+
+  return x+y;
+}
@@ -0,0 +1,15 @@
+// RUN: %clam -O0 --crab-dom=int --crab-dump-cfg=%t.crab "%s" 2>&1
+// RUN: OutputCheck %s --file-to-check=%t.crab
+// CHECK: inc\(
+// CHECK: main\(
+
+extern int nd(void);
+
+int inc(int x) {
+  return x + 1;
+}
+
+int main() {
+  int y = nd();
+  return inc(y);
+}
@@ -0,0 +1,25 @@
+// RUN: echo "peek* readonly" > %t.models
+// RUN: %clam -O0 --crab-dom=int --crab-track=arr --crab-external-models=%t.models --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^2  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The calls to peek_at and sum do not havoc the contents of a: the
+// first one is readonly according to the models file and the second
+// one according to its attributes.
+
+extern void __CRAB_assert(int);
+extern int peek_at(int *p, int i);
+extern int sum(const int *p, int n) __attribute__((pure));
+
+int main() {
+  int a[4];
+  a[0] = 1;
+  a[1] = 1;
+  a[2] = 1;
+  a[3] = 1;
+  int x = peek_at(a, 2);
+  __CRAB_assert(a[1] == 1);
+  int y = sum(a, 4);
+  __CRAB_assert(a[3] == 1);
+  return x + y;
+}
@@ -0,0 +1,26 @@
+// RUN: %clam -O0 --crab-dom=int --crab-track=arr --crab-forget-dead-arrays --crab-check=assert --crab-sanity-checks "%s" 2>&1 | OutputCheck %s
+// CHECK: ^2  Number of total safe checks$
+// CHECK: ^0  Number of total error checks$
+// CHECK: ^0  Number of total warning checks$
+
+// tmp is forgotten once it is dead and it does not change the facts
+// about out.
+
+extern int nd(void);
+extern void __CRAB_assert(int);
+
+int main() {
+  int tmp[10];
+  int out[10];
+  int i;
+  for (i = 0; i < 10; i++) {
+    tmp[i] = nd() ? 1 : 2;
+  }
+  int x = tmp[5];
+  __CRAB_assert(x >= 1);
+  for (i = 0; i < 10; i++) {
+    out[i] = 7;
+  }
+  __CRAB_assert(out[3] == 7);
+  return x;
+}
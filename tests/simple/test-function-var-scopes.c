@@ -0,0 +1,28 @@
+// RUN: %clam -O0 --crab-dom=zones --crab-check=assert --crab-function-var-scopes --crab-release-cfgs "%s" 2>&1 | OutputCheck %s
+// CHECK: ^3  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The variables of each function are named in a scope freed with
+// its CFG.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int f1(int n) {
+  int i, x = 0;
+  for (i = 0; i < n; i++) x++;
+  __CRAB_assert(x - i <= 0);
+  return x;
+}
+
+int f2(int a, int b) {
+  int c = a;
+  if (a > b) c = b;
+  __CRAB_assert(c <= a);
+  __CRAB_assert(c - b <= 0);
+  return c;
+}
+
+int main() {
+  return f1(nd()) + f2(nd(), nd());
+}
@@ -0,0 +1,29 @@
+// RUN: %clam -O0 --crab-dom=int --crab-track=arr --crab-heap-analysis=cs-sea-dsa --crab-check=assert --crab-sanity-checks "%s" 2>&1 | OutputCheck %s
+// CHECK: ^2  Number of total safe checks$
+// CHECK: ^0  Number of total error checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The initializer of the table is summarized by the range of its
+// elements instead of being lowered into 2048 stores.
+
+extern int nd ();
+extern void __CRAB_assume(int);
+extern void __CRAB_assert(int);
+
+#define E4    1, 5, 2, 7
+#define E16   E4, E4, E4, E4
+#define E64   E16, E16, E16, E16
+#define E256  E64, E64, E64, E64
+#define E1024 E256, E256, E256, E256
+
+static const int table[2048] = { E1024, E1024 };
+
+int main() {
+  int i = nd();
+  __CRAB_assume(i >= 0);
+  __CRAB_assume(i < 2048);
+  int x = table[i];
+  __CRAB_assert(x >= 1);
+  __CRAB_assert(x <= 7);
+  return x;
+}
@@ -0,0 +1,19 @@
+// RUN: %clam -O0 --crab-dom=int --crab-track=arr --crab-heap-analysis=cs-sea-dsa --crab-heap-analysis-budget=60 --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^2  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// cs-sea-dsa runs in a child process within the budget and its
+// regions are passed back to the analysis.
+
+extern void __CRAB_assert(int);
+
+static void set(int *p, int v) { *p = v; }
+
+int main() {
+  int a, b;
+  set(&a, 1);
+  set(&b, 2);
+  __CRAB_assert(a == 1);
+  __CRAB_assert(b == 2);
+  return 0;
+}
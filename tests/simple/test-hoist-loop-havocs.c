@@ -0,0 +1,25 @@
+// RUN: %clam -O0 --crab-hoist-loop-havocs --crab-dom=zones --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^2  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The results of nd() that are ignored are only havoced: their
+// havocs are moved out of the loops, the invariants stay the same.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int main() {
+  int i, j, x = 0, y = 0;
+  int n = nd();
+  for (i = 0; i < n; i++) {
+    nd();
+    x++;
+    for (j = 0; j < i; j++) {
+      nd();
+      y++;
+    }
+  }
+  __CRAB_assert(x - i <= 0);
+  __CRAB_assert(y >= 0);
+  return 0;
+}
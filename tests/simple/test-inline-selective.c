@@ -0,0 +1,22 @@
+// RUN: %clam -O0 --inline-selective --crab-dom=int --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^2  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The small helpers are inlined so that the intra-procedural analysis
+// knows their results.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+static int inc(int x) { return x + 1; }
+
+static void check_pos(int x) { __CRAB_assert(x > 0); }
+
+int main() {
+  int x = nd();
+  if (x < 0 || x > 100) return 0;
+  int y = inc(inc(x));
+  check_pos(y);
+  __CRAB_assert(y <= 102);
+  return 0;
+}
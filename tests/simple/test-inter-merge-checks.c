@@ -0,0 +1,18 @@
+// RUN: %clam -O0 --crab-inter --crab-inter-merge-checks --crab-dom=int --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^1  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The assertion of inc is checked once for its two calling contexts.
+
+extern void __CRAB_assert(int);
+
+__attribute__((noinline)) int inc(int x) {
+  __CRAB_assert(x > 0);
+  return x + 1;
+}
+
+int main() {
+  int a = inc(1);
+  int b = inc(5);
+  return a + b;
+}
@@ -0,0 +1,25 @@
+// RUN: %clam -O0 --crab-inter --crab-inter-multi-root --crab-dom=int --crab-check=assert --crab-threads=2 "%s" 2>&1 | OutputCheck %s
+// CHECK: ^3  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// A library without main: api_small and api_large are roots analyzed
+// from a top context, and the invariants of scale are the join of its
+// invariants for both roots.
+
+extern void __CRAB_assert(int);
+
+static int scale(int k) {
+  __CRAB_assert(k >= 2);
+  __CRAB_assert(k <= 8);
+  return k * 2;
+}
+
+int api_small(void) {
+  return scale(2);
+}
+
+int api_large(int n) {
+  int r = scale(8);
+  __CRAB_assert(r >= 0);
+  return r + n;
+}
@@ -0,0 +1,23 @@
+// RUN: %clam -O0 --crab-dom=zones --crab-track=num --crab-check=assert --lazy-functions "%s" 2>&1 | OutputCheck %s
+// CHECK: ^2  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The body of each function is read just before it is analyzed and
+// released after.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int count(int n) {
+  int i, x = 0;
+  for (i = 0; i < n; i++) x++;
+  __CRAB_assert(x - i <= 0);
+  return x;
+}
+
+int main() {
+  int a = nd();
+  int b = a + 1;
+  __CRAB_assert(b > a);
+  return count(nd()) + b;
+}
@@ -0,0 +1,19 @@
+// RUN: %clam -O0 --crab-lazy-names --crab-dom=zones --crab-check=assert --crab-sanity-checks "%s" 2>&1 | OutputCheck %s
+// CHECK: ^1  Number of total safe checks$
+// CHECK: ^0  Number of total error checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The CFGs are built from IR with unnamed values.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int main() {
+  int x = 0, y = 0;
+  while (nd()) {
+    x++;
+    y++;
+  }
+  __CRAB_assert(x == y);
+  return 0;
+}
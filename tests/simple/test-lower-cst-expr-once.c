@@ -0,0 +1,22 @@
+// RUN: %clam -O0 --lower-constant-expr-once --crab-track=mem --crab-dom=int --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^1  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The address of a[2] is used in three blocks but it is lowered
+// once in the entry block of main.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int a[10];
+
+int main() {
+  int x;
+  a[2] = 5;
+  if (nd())
+    x = a[2];
+  else
+    x = a[2] - 1;
+  __CRAB_assert(x <= 5);
+  return x;
+}
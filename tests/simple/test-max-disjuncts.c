@@ -0,0 +1,20 @@
+// RUN: %clam -O0 --crab-dom=dis-int --crab-max-disjuncts=2 --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^1  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The four values of x are merged into two disjuncts: [0,1] and
+// [10,11] are the closest, so x != 5 is still proven.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int main() {
+  int x;
+  if (nd()) {
+    if (nd()) x = 0; else x = 1;
+  } else {
+    if (nd()) x = 10; else x = 11;
+  }
+  __CRAB_assert(x != 5);
+  return x;
+}
@@ -0,0 +1,26 @@
+// RUN: %clam -O0 --crab-dom=int --crab-track=arr --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^2  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The struct copies are translated into copies of the regions of
+// their fields.
+
+#include <string.h>
+
+extern void __CRAB_assert(int);
+
+struct point {
+  int x;
+  int y;
+};
+
+int main() {
+  struct point p, q, r;
+  p.x = 5;
+  p.y = 7;
+  q = p;
+  memmove(&r, &q, sizeof(r));
+  __CRAB_assert(q.x == 5);
+  __CRAB_assert(r.y == 7);
+  return 0;
+}
@@ -0,0 +1,24 @@
+// RUN: %clam -O0 --crab-track=ptr --crab-check=null "%s" 2>&1 | OutputCheck %s
+// CHECK: ^3  Number of total safe checks$
+// CHECK: ^0  Number of total error checks$
+// CHECK: ^1  Number of total warning checks$
+
+// A pointer is not null after it is dereferenced or if a branch
+// tested it.
+
+extern int *nd_ptr(void);
+
+int main() {
+  int *p = nd_ptr();
+  *p = 1;
+  int a = *p;
+  int *q = nd_ptr();
+  if (q) {
+    *q = a;
+  }
+  int *r = nd_ptr();
+  if (!r) {
+    return 0;
+  }
+  return *r;
+}
@@ -0,0 +1,14 @@
+// RUN: %clam -O0 --crab-print-cfg --crab-output-file=%t.gz "%s" > /dev/null 2>&1
+// RUN: gzip -t %t.gz
+// RUN: cat %t.gz.idx | OutputCheck %s
+// CHECK: ^0 [0-9]+ cfg main$
+// CHECK: ^[0-9]+ [0-9]+ invariants main$
+
+extern int nd(void);
+
+int main() {
+  int i, x = 0, n = nd();
+  for (i = 0; i < n; i++)
+    x += 2;
+  return x;
+}
@@ -0,0 +1,25 @@
+// RUN: %clam -O0 --crab-dom=packed-oct --crab-pack-size=8 --crab-check=assert --crab-sanity-checks "%s" 2>&1 | OutputCheck %s
+// CHECK: ^1  Number of total safe checks$
+// CHECK: ^0  Number of total error checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The sum relates more than 8 variables so its pack overflows but
+// the pack of x and y fits and the assertion is proven with octagons.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int main (){
+
+  int a = nd(), b = nd(), c = nd(), d = nd(), e = nd(), f = nd();
+  int s = a + b + c + d + e + f;
+  int x = 0, y = 0;
+
+  while (nd()) {
+    x++;
+    y++;
+  }
+  __CRAB_assert(x == y);
+
+  return s;
+}
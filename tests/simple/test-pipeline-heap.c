@@ -0,0 +1,28 @@
+// RUN: %clam -O0 --crab-dom=int --crab-track=arr --crab-check=assert --crab-pipeline-heap --crab-threads=2 "%s" 2>&1 | OutputCheck %s
+// CHECK: ^3  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The CFG of clamp does not depend on the heap abstraction so it is
+// built while the heap analysis runs. The CFG of main is built once
+// the regions are available.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int clamp(int x) {
+  int y = x;
+  if (y < 0) y = 0;
+  if (y > 10) y = 10;
+  __CRAB_assert(y >= 0);
+  __CRAB_assert(y <= 10);
+  return y;
+}
+
+int a[5];
+
+int main() {
+  a[2] = 7;
+  int z = clamp(nd());
+  __CRAB_assert(a[2] == 7);
+  return z;
+}
@@ -0,0 +1,11 @@
+// RUN: %clam -O0 --crab-dom=int --crab-print-invariants-compact "%s" 2>&1 | OutputCheck %s
+// CHECK: ^main:[^ ]+ pre: .* post: .*$
+// CHECK-NOT: ^function main$
+
+int main() {
+  int i, x = 0;
+  for (i = 0; i < 10; i++) {
+    x++;
+  }
+  return x;
+}
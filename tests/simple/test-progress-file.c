@@ -0,0 +1,18 @@
+// RUN: %clam -O0 --crab-dom=int --crab-check=assert --crab-progress-file=%t.json "%s" > /dev/null
+// RUN: cat %t.json | OutputCheck %s
+// CHECK: ^\{"done": 2, "total": 2, "elapsed": [0-9.]+, "eta": [0-9.]+, .*"current": \[\]\}$
+
+// The last status is written when the analysis ends.
+
+extern void __CRAB_assert(int);
+
+int f(int x) {
+  __CRAB_assert(x > 0);
+  return x;
+}
+
+int main() {
+  int x = f(5);
+  __CRAB_assert(x == 5);
+  return 0;
+}
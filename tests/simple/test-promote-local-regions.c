@@ -0,0 +1,28 @@
+// RUN: %clam -O0 --crab-dom=int --crab-track=arr --crab-promote-local-regions --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^2  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The fields of p do not escape so they are translated as scalars
+// and the stores in the branches are strong updates.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+struct point {
+  int x;
+  int y;
+};
+
+int main() {
+  struct point p;
+  p.x = 1;
+  p.y = 7;
+  if (nd()) {
+    p.x = 2;
+  } else {
+    p.x = 3;
+  }
+  __CRAB_assert(p.x >= 2);
+  __CRAB_assert(p.y == 7);
+  return 0;
+}
@@ -0,0 +1,25 @@
+// RUN: %clam -O0 --crab-dom=int --crab-check=assert --crab-reachable-only --crab-sanity-checks "%s" 2>&1 | OutputCheck %s
+// CHECK: ^1  Number of total safe checks$
+// CHECK: ^0  Number of total error checks$
+// CHECK: ^0  Number of total warning checks$
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+// never called from main: not analyzed
+int unreached(int n) {
+  __CRAB_assert(n > 0);
+  return n;
+}
+
+int inc(int x) { return x + 1; }
+
+int main() {
+  int i, x = 0, y = 0;
+  for (i = 0; i < 10; i++) {
+    x++;
+    y = inc(y);
+  }
+  __CRAB_assert(x <= 10);
+  return y;
+}
@@ -0,0 +1,24 @@
+// RUN: %clam -O0 --crab-dom=zones --crab-shard=0/2 --crab-export-summaries=%t.0.sum "%s" 2>&1
+// RUN: %clam -O0 --crab-dom=zones --crab-shard=1/2 --crab-export-summaries=%t.1.sum "%s" 2>&1
+// RUN: %clam_merge -o %t.sum %t.0.sum %t.1.sum
+// RUN: %clam -O0 --crab-dom=zones --crab-import-summaries=%t.sum --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^1  Number of total safe checks$
+// CHECK: ^0  Number of total error checks$
+// CHECK: ^0  Number of total warning checks$
+
+// inc and main are in different shards. The summary of inc is in the
+// merged summaries whatever shard it is in.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int inc(int x) {
+  return x + 1;
+}
+
+int main() {
+  int y = nd();
+  int z = inc(y);
+  __CRAB_assert(z == y + 1);
+  return z;
+}
@@ -0,0 +1,25 @@
+// RUN: %clam -O0 --crab-dom=int --crab-check=assert --crab-slice-to-checks --crab-sanity-checks "%s" 2>&1 | OutputCheck %s
+// CHECK: ^1  Number of total safe checks$
+// CHECK: ^0  Number of total error checks$
+// CHECK: ^0  Number of total warning checks$
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+// no checks: not analyzed
+int unused(int n) {
+  int i, s = 0;
+  for (i = 0; i < n; i++) {
+    s += nd();
+  }
+  return s;
+}
+
+int main() {
+  int i, x = 0;
+  for (i = 0; i < 10; i++) {
+    x++;
+  }
+  __CRAB_assert(x <= 10);
+  return unused(x);
+}
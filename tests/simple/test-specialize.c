@@ -0,0 +1,22 @@
+// RUN: %clam -O0 --specialize-const-args --crab-dom=int --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^1  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// Both calls pass k=3 so they call the same clone of f where k is
+// replaced with 3. The original f has no call left and it is removed.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+void f(int k) {
+  int x = nd();
+  if (x < k) {
+    __CRAB_assert(x < 10);
+  }
+}
+
+int main() {
+  f(3);
+  f(3);
+  return 0;
+}
@@ -0,0 +1,22 @@
+// RUN: %clam -O0 --crab-dom=zones --crab-spill-invariants=%t.spill --crab-export-summaries=%t.sum "%s" 2>&1
+// RUN: %clam -O0 --crab-dom=zones --crab-import-summaries=%t.sum --crab-check=assert --crab-sanity-checks "%s" 2>&1 | OutputCheck %s
+// CHECK: ^1  Number of total safe checks$
+// CHECK: ^0  Number of total error checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The summary of inc is computed from the invariants read back from
+// the spilled segments.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int inc(int x) {
+  return x + 1;
+}
+
+int main() {
+  int y = nd();
+  int z = inc(y);
+  __CRAB_assert(z == y + 1);
+  return z;
+}
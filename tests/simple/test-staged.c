@@ -0,0 +1,34 @@
+// RUN: %clam -O0 --crab-dom=zones --crab-staged --crab-check=assert --crab-sanity-checks "%s" 2>&1 | OutputCheck %s
+// CHECK: ^3  Number of total safe checks$
+// CHECK: ^0  Number of total error checks$
+// CHECK: ^0  Number of total warning checks$
+
+// Intervals prove the check of foo. The checks of main need zones.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int foo(int n) {
+  int i = 0;
+  while (i < 10) {
+    i++;
+  }
+  __CRAB_assert(i == 10);
+  return i;
+}
+
+int main (){
+
+  int x,y,i;
+  x=0;
+  y=0;
+  for (i=0;i< nd();i++) {
+    x++;
+    y++;
+  }
+
+  __CRAB_assert(x>=y);
+  __CRAB_assert(y>=x);
+
+  return x+y+foo(x);
+}
@@ -0,0 +1,28 @@
+// RUN: %clam -O0 --disable-lower-switch --crab-dom=zones --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^3  Number of total safe checks$
+// CHECK: ^0  Number of total error checks$
+// CHECK: ^0  Number of total warning checks$
+
+extern int nd(void);
+extern void __CRAB_assert(int);
+
+int main () {
+  int x = 0;
+  int v = nd();
+  switch (v) {
+  case 1:
+  case 2:
+  case 4:
+    __CRAB_assert(v >= 1);
+    __CRAB_assert(v <= 4);
+    x = 1;
+    break;
+  case 10:
+    __CRAB_assert(v == 10);
+    x = 2;
+    break;
+  default:
+    x = 3;
+  }
+  return x;
+}
@@ -0,0 +1,38 @@
+// RUN: %clam -O0 --crab-dom=zones --crab-check=assert --crab-threads=4 --crab-threads-mem-budget=1 "%s" 2>&1 | OutputCheck %s
+// CHECK: ^3  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The predicted memory of these functions fits in the budget so they
+// are analyzed with zones, at most as many at the same time as fit.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int f1(int n) {
+  int i, x = 0;
+  for (i = 0; i < n; i++) x++;
+  __CRAB_assert(x - i <= 0);
+  return x;
+}
+
+int f2(int n) {
+  int i, y = 10;
+  for (i = 0; i < n; i++) y++;
+  __CRAB_assert(y - i >= 10);
+  return y;
+}
+
+int f3(int a, int b) {
+  int c = a;
+  if (a > b) c = b;
+  __CRAB_assert(c <= a);
+  return c;
+}
+
+int main() {
+  int s = 0;
+  s += f1(nd());
+  s += f2(nd());
+  s += f3(nd(), nd());
+  return s;
+}
@@ -0,0 +1,21 @@
+// RUN: %clam -O0 --crab-dom=int --crab-track=arr --crab-track-adaptive --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^2  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The first assertion needs the contents of a (arr) while the second
+// one only needs registers: the function gets the precision of the
+// first one.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int a[10];
+
+int main() {
+  int i, n = nd();
+  for (i = 0; i < 10; i++) a[i] = 5;
+  __CRAB_assert(a[3] >= 5);
+  if (n > 0) n--;
+  __CRAB_assert(n >= -2147483648);
+  return 0;
+}
@@ -0,0 +1,18 @@
+// RUN: %clam -O0 --crab-triage --crab-dom=zones "%s" 2>&1 | OutputCheck %s
+// CHECK: ^1  Number of total safe checks$
+// CHECK: ^1  Number of total warning checks$
+
+// --crab-triage analyzes with intervals whatever --crab-dom says and
+// checks the assertions without --crab-check. Without narrowing the
+// bound of the loop is lost.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int main() {
+  int i, x = 0;
+  for (i = 0; i < 10; i++) x++;
+  __CRAB_assert(x >= 0);
+  __CRAB_assert(i <= 10);
+  return x;
+}
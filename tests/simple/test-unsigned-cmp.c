@@ -0,0 +1,21 @@
+// RUN: %clam -O0 --crab-dom=int --crab-check=assert "%s" 2>&1 | OutputCheck %s
+// CHECK: ^2  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The unsigned comparisons with a constant are translated into signed
+// bounds so intervals do not need --crab-lower-unsigned-icmp.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int main() {
+  int x = nd();
+  int y = nd();
+  if ((unsigned)x < 10u) {
+    __CRAB_assert(x >= 0);
+  }
+  if (!((unsigned)y > 5u)) {
+    __CRAB_assert(y <= 5);
+  }
+  return 0;
+}
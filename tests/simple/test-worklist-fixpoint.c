@@ -0,0 +1,28 @@
+// RUN: %clam -O0 --crab-dom=int --crab-check=assert --crab-fixpoint=worklist "%s" 2>&1 | OutputCheck %s
+// CHECK: ^3  Number of total safe checks$
+// CHECK: ^0  Number of total warning checks$
+
+// The loop between L1 and L2 has two entries so the CFG is
+// irreducible. The worklist widens at the target of the back edge
+// found by the depth-first search, and narrowing recovers the bound
+// of the second loop.
+
+extern void __CRAB_assert(int);
+extern int nd(void);
+
+int main() {
+  int i, x = 0;
+  if (nd()) goto L2;
+ L1:
+  x++;
+  if (x >= 100) goto end;
+ L2:
+  x++;
+  if (nd()) goto L1;
+ end:
+  __CRAB_assert(x >= 0);
+  for (i = 0; i < 10; i++) x++;
+  __CRAB_assert(i <= 10);
+  __CRAB_assert(i >= 10);
+  return x;
+}
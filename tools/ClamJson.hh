@@ -0,0 +1,180 @@
+#pragma once
+
+/*
+ * JSON values shared by clam-server and the Python bindings
+ */
+
+#include "llvm/ADT/StringRef.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace clam {
+
+/* Minimal JSON value: enough to read requests and options */
+struct JsonValue {
+  enum kind_t { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+  kind_t kind;
+  bool b;
+  double n;
+  std::string s;
+  std::vector<JsonValue> elems;
+  std::map<std::string, JsonValue> fields;
+
+  JsonValue(): kind(NUL), b(false), n(0) {}
+
+  const JsonValue *get(const std::string &key) const {
+    if (kind != OBJECT) return nullptr;
+    auto it = fields.find(key);
+    return (it != fields.end() ? &it->second : nullptr);
+  }
+};
+
+class JsonParser {
+  llvm::StringRef m_str;
+  size_t m_pos;
+
+  void skipSpaces() {
+    while (m_pos < m_str.size() && isspace((unsigned char) m_str[m_pos])) {
+      ++m_pos;
+    }
+  }
+
+  bool consume(char c) {
+    skipSpaces();
+    if (m_pos < m_str.size() && m_str[m_pos] == c) {
+      ++m_pos;
+      return true;
+    }
+    return false;
+  }
+
+  bool consume(llvm::StringRef word) {
+    if (m_str.substr(m_pos).startswith(word)) {
+      m_pos += word.size();
+      return true;
+    }
+    return false;
+  }
+
+  bool parseString(std::string &res) {
+    if (!consume('"')) return false;
+    while (m_pos < m_str.size()) {
+      char c = m_str[m_pos++];
+      if (c == '"') {
+	return true;
+      } else if (c != '\\') {
+	res += c;
+	continue;
+      }
+      if (m_pos >= m_str.size()) return false;
+      c = m_str[m_pos++];
+      switch (c) {
+      case 'n': res += '\n'; break;
+      case 't': res += '\t'; break;
+      case 'r': res += '\r'; break;
+      case 'b': res += '\b'; break;
+      case 'f': res += '\f'; break;
+      case 'u': {
+	unsigned code;
+	if (m_pos + 4 > m_str.size() ||
+	    m_str.substr(m_pos, 4).getAsInteger(16, code)) {
+	  return false;
+	}
+	m_pos += 4;
+	// only ASCII is expected in file and function names
+	res += (code < 0x80 ? (char) code : '?');
+	break;
+      }
+      default: res += c;
+      }
+    }
+    return false;
+  }
+
+public:
+  JsonParser(llvm::StringRef str): m_str(str), m_pos(0) {}
+
+  bool parse(JsonValue &v) {
+    skipSpaces();
+    if (m_pos >= m_str.size()) return false;
+    char c = m_str[m_pos];
+    if (c == '{') {
+      ++m_pos;
+      v.kind = JsonValue::OBJECT;
+      if (consume('}')) return true;
+      do {
+	std::string key;
+	skipSpaces();
+	if (!parseString(key) || !consume(':') || !parse(v.fields[key])) {
+	  return false;
+	}
+      } while (consume(','));
+      return consume('}');
+    } else if (c == '[') {
+      ++m_pos;
+      v.kind = JsonValue::ARRAY;
+      if (consume(']')) return true;
+      do {
+	v.elems.emplace_back();
+	if (!parse(v.elems.back())) return false;
+      } while (consume(','));
+      return consume(']');
+    } else if (c == '"') {
+      v.kind = JsonValue::STRING;
+      return parseString(v.s);
+    } else if (consume("true")) {
+      v.kind = JsonValue::BOOL;
+      v.b = true;
+      return true;
+    } else if (consume("false")) {
+      v.kind = JsonValue::BOOL;
+      return true;
+    } else if (consume("null")) {
+      return true;
+    } else {
+      const char *begin = m_str.data() + m_pos;
+      char *end;
+      v.kind = JsonValue::NUMBER;
+      v.n = strtod(begin, &end);
+      m_pos += end - begin;
+      return end != begin;
+    }
+  }
+
+  bool atEnd() {
+    skipSpaces();
+    return m_pos == m_str.size();
+  }
+};
+
+inline std::string jsonEscape(llvm::StringRef str) {
+  std::string res;
+  for (char c: str) {
+    switch (c) {
+    case '"':  res += "\\\""; break;
+    case '\\': res += "\\\\"; break;
+    case '\n': res += "\\n"; break;
+    case '\t': res += "\\t"; break;
+    default:
+      if ((unsigned char) c < 0x20) {
+	char buf[8];
+	snprintf(buf, sizeof(buf), "\\u%04x", c);
+	res += buf;
+      } else {
+	res += c;
+      }
+    }
+  }
+  return res;
+}
+
+inline std::string jsonString(llvm::StringRef str) {
+  return "\"" + jsonEscape(str) + "\"";
+}
+
+} // end namespace clam
@@ -0,0 +1,118 @@
+///
+// clam-merge -- Merge the results of the shards of a module
+//
+// Each shard of a module is analyzed by a separate clam run (e.g., on
+// a different machine) with --crab-shard=K/N and the same bitcode and
+// options. This tool merges the results written by those runs into
+// one file of the same kind:
+//
+//   - invariant databases (--crab-invariants-db)
+//   - check indexes (--crab-check-index)
+//   - summaries (--crab-export-summaries)
+//
+// The kind is given by the first input. Check streams
+// (--crab-check-stream) are merged by concatenation.
+///
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "clam/CheckIndex.hh"
+#include "clam/InvariantDatabase.hh"
+
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace clam;
+
+static cl::list<std::string>
+InputFilenames(cl::Positional, cl::desc("<input files>"), cl::OneOrMore);
+
+static cl::opt<std::string>
+OutputFilename("o", cl::desc("Output filename"), cl::Required,
+               cl::value_desc("filename"));
+
+static const char SUMMARIES_HEADER[] = "clam-summaries ";
+
+// Summaries are text: the header of all the inputs must be the same
+// and the functions of the inputs are concatenated.
+static bool mergeSummaries(const std::vector<std::string> &inputs,
+                           const std::string &output, std::string &err) {
+  std::string header;
+  std::string body;
+  for (auto &input : inputs) {
+    auto buf = MemoryBuffer::getFile(input);
+    if (!buf) {
+      err = input + ": " + buf.getError().message();
+      return false;
+    }
+    StringRef first, rest;
+    std::tie(first, rest) = (*buf)->getBuffer().split('\n');
+    if (!first.startswith(SUMMARIES_HEADER)) {
+      err = input + ": not a summaries file";
+      return false;
+    }
+    if (header.empty()) {
+      header = first.str();
+    } else if (header != first) {
+      err = input + ": unsupported summaries version";
+      return false;
+    }
+    body += rest.str();
+    if (!rest.empty() && !rest.endswith("\n")) {
+      body += "\n";
+    }
+  }
+  std::error_code ec;
+  raw_fd_ostream o(output, ec, sys::fs::F_Text);
+  if (ec) {
+    err = output + ": " + ec.message();
+    return false;
+  }
+  o << header << "\n" << body;
+  return true;
+}
+
+int main(int argc, char **argv) {
+  llvm::llvm_shutdown_obj shutdown;  // calls llvm_shutdown() on exit
+  cl::ParseCommandLineOptions(argc, argv,
+  "clam-merge -- Merge the results of the shards of a module\n");
+
+  sys::PrintStackTraceOnErrorSignal(argv[0]);
+  PrettyStackTraceProgram PSTP(argc, argv);
+
+  std::vector<std::string> inputs(InputFilenames.begin(), InputFilenames.end());
+  auto buf = MemoryBuffer::getFile(inputs[0], -1,
+                                   /*RequiresNullTerminator=*/false);
+  if (!buf) {
+    errs() << "clam-merge: " << inputs[0] << ": "
+           << buf.getError().message() << "\n";
+    return 1;
+  }
+  StringRef data = (*buf)->getBuffer();
+
+  std::string err;
+  bool ok;
+  if (data.startswith("CLAMINVD")) {
+    ok = mergeInvariantDatabases(inputs, OutputFilename, err);
+  } else if (data.startswith("CLAMCHKI")) {
+    ok = mergeCheckIndexes(inputs, OutputFilename, err);
+  } else if (data.startswith(SUMMARIES_HEADER)) {
+    ok = mergeSummaries(inputs, OutputFilename, err);
+  } else {
+    ok = false;
+    err = inputs[0] + ": unknown kind of results";
+  }
+  if (!ok) {
+    errs() << "clam-merge: " << err << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,411 @@
+///
+// clam-microbench -- microbenchmarks of the hot primitives of Clam
+//
+// Built with -DCLAM_MICROBENCH=ON (needs Google Benchmark). The
+// benchmarks are run in isolation on synthetic inputs whose size is
+// the benchmark argument:
+//   Domain/<dom>/<op>/N  join, meet, widen, leq, assign and assume on
+//                        states of the Crab domains with N variables
+//   CfgBuilder/N         build_cfg of a function with N blocks
+//   ToZNumber/W          conversion of W-bit constants
+//   BlockWrapper/N       hash and compare of N block labels
+//   DsaToRegion/N        regions of the cells of N memory accesses
+//
+// To compare two commits, run both with --benchmark_out=F.json
+// --benchmark_out_format=json and compare the files with the
+// compare.py script of Google Benchmark.
+///
+
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/ManagedStatic.h"
+
+#include "clam/config.h"
+#include "clam/CfgBuilder.hh"
+#include "clam/CfgBuilderParams.hh"
+#include "clam/DummyHeapAbstraction.hh"
+#include "clam/crab/crab_domains.hh"
+
+#include "sea_dsa/AllocWrapInfo.hh"
+#include "sea_dsa/Global.hh"
+#include "sea_dsa/Graph.hh"
+
+#include "CfgBuilderUtils.hh"
+#include "SeaDsaHeapAbstractionDsaToRegion.hh"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace clam;
+
+namespace {
+
+/* Abstract domains */
+
+struct DomainVars {
+  variable_factory_t vfac;
+  std::vector<var_t> vars;
+
+  DomainVars(unsigned n) {
+    for (unsigned i = 0; i < n; ++i) {
+      vars.push_back(var_t(vfac.get(), crab::INT_TYPE, 32));
+    }
+  }
+};
+
+// k <= x_i <= k+i+1 and x_i - x_{i-1} <= k+1
+template<typename Dom>
+Dom makeState(const std::vector<var_t> &vs, int64_t k) {
+  Dom d = Dom::top();
+  for (unsigned i = 0; i < vs.size(); ++i) {
+    d += (vs[i] >= number_t(k));
+    d += (vs[i] <= number_t(k + i + 1));
+    if (i > 0) {
+      d += (vs[i] - vs[i-1] <= number_t(k + 1));
+    }
+  }
+  return d;
+}
+
+template<typename Dom>
+void BM_Join(benchmark::State &state) {
+  DomainVars v(state.range(0));
+  Dom a = makeState<Dom>(v.vars, 0), b = makeState<Dom>(v.vars, 1);
+  for (auto _ : state) {
+    Dom r = a | b;
+    benchmark::DoNotOptimize(r);
+  }
+}
+
+template<typename Dom>
+void BM_Meet(benchmark::State &state) {
+  DomainVars v(state.range(0));
+  Dom a = makeState<Dom>(v.vars, 0), b = makeState<Dom>(v.vars, 1);
+  for (auto _ : state) {
+    Dom r = a & b;
+    benchmark::DoNotOptimize(r);
+  }
+}
+
+template<typename Dom>
+void BM_Widen(benchmark::State &state) {
+  DomainVars v(state.range(0));
+  Dom a = makeState<Dom>(v.vars, 0), b = makeState<Dom>(v.vars, 2);
+  Dom joined = a | b;
+  for (auto _ : state) {
+    Dom r = a || joined;
+    benchmark::DoNotOptimize(r);
+  }
+}
+
+template<typename Dom>
+void BM_Leq(benchmark::State &state) {
+  DomainVars v(state.range(0));
+  Dom a = makeState<Dom>(v.vars, 0), b = makeState<Dom>(v.vars, 1);
+  Dom joined = a | b;
+  for (auto _ : state) {
+    bool r = (a <= joined);
+    benchmark::DoNotOptimize(r);
+  }
+}
+
+// One assignment per variable on a copy of the state
+template<typename Dom>
+void BM_Assign(benchmark::State &state) {
+  DomainVars v(state.range(0));
+  const std::vector<var_t> &vs = v.vars;
+  Dom a = makeState<Dom>(vs, 0);
+  for (auto _ : state) {
+    Dom d = a;
+    for (unsigned i = 0; i < vs.size(); ++i) {
+      d.assign(vs[i], lin_exp_t(vs[(i + 1) % vs.size()]) + number_t(1));
+    }
+    benchmark::DoNotOptimize(d);
+  }
+  state.SetItemsProcessed(state.iterations() * vs.size());
+}
+
+// One constraint per variable on a copy of the state
+template<typename Dom>
+void BM_Assume(benchmark::State &state) {
+  DomainVars v(state.range(0));
+  const std::vector<var_t> &vs = v.vars;
+  Dom a = makeState<Dom>(vs, 0);
+  for (auto _ : state) {
+    Dom d = a;
+    for (unsigned i = 0; i < vs.size(); ++i) {
+      d += (vs[i] - vs[(i + 1) % vs.size()] <= number_t(i));
+    }
+    benchmark::DoNotOptimize(d);
+  }
+  state.SetItemsProcessed(state.iterations() * vs.size());
+}
+
+template<typename Dom>
+void registerDomain(const std::string &name) {
+  const std::string prefix = "Domain/" + name + "/";
+  auto reg = [&prefix](const std::string &op, void (*f)(benchmark::State&)) {
+    benchmark::RegisterBenchmark((prefix + op).c_str(), f)
+      ->RangeMultiplier(4)->Range(8, 512);
+  };
+  reg("join", BM_Join<Dom>);
+  reg("meet", BM_Meet<Dom>);
+  reg("widen", BM_Widen<Dom>);
+  reg("leq", BM_Leq<Dom>);
+  reg("assign", BM_Assign<Dom>);
+  reg("assume", BM_Assume<Dom>);
+}
+
+// The names are those of --crab-dom
+void registerDomains() {
+  registerDomain<split_dbm_domain_t>("zones");
+#ifdef HAVE_ALL_DOMAINS
+  registerDomain<interval_domain_t>("int");
+  registerDomain<ric_domain_t>("ric");
+  registerDomain<boxes_domain_t>("boxes");
+  registerDomain<dis_interval_domain_t>("dis-int");
+  registerDomain<term_int_domain_t>("term-int");
+  registerDomain<term_dis_int_domain_t>("term-dis-int");
+  registerDomain<num_domain_t>("rtz");
+  registerDomain<oct_domain_t>("oct");
+  registerDomain<pk_domain_t>("pk");
+  registerDomain<wrapped_interval_domain_t>("w-int");
+  registerDomain<dense_interval_domain_t>("dense-int");
+#endif
+}
+
+/* Synthetic functions */
+
+// A loop of n blocks: each block updates two counters and branches
+// to the next block or to the exit.
+Function *makeArithFunction(Module &M, unsigned n) {
+  LLVMContext &ctx = M.getContext();
+  IntegerType *i32 = Type::getInt32Ty(ctx);
+  FunctionType *ty = FunctionType::get(i32, {i32}, false);
+  Function *F = Function::Create(ty, GlobalValue::ExternalLinkage,
+				 "arith" + std::to_string(n), &M);
+  BasicBlock *entry = BasicBlock::Create(ctx, "entry", F);
+  std::vector<BasicBlock*> blocks;
+  for (unsigned i = 0; i < n; ++i) {
+    blocks.push_back(BasicBlock::Create(ctx, "b" + std::to_string(i), F));
+  }
+  BasicBlock *exit = BasicBlock::Create(ctx, "exit", F);
+  IRBuilder<> b(entry);
+  b.CreateBr(blocks[0]);
+
+  b.SetInsertPoint(blocks[0]);
+  PHINode *x = b.CreatePHI(i32, 2, "x");
+  PHINode *y = b.CreatePHI(i32, 2, "y");
+  x->addIncoming(ConstantInt::get(i32, 0), entry);
+  y->addIncoming(&*F->arg_begin(), entry);
+  Value *vx = x, *vy = y;
+  for (unsigned i = 0; i < n; ++i) {
+    b.SetInsertPoint(blocks[i]);
+    vx = b.CreateAdd(vx, ConstantInt::get(i32, i + 1));
+    vy = b.CreateSub(vy, vx);
+    Value *c = b.CreateICmpSLT(vx, ConstantInt::get(i32, 1000));
+    if (i + 1 < n) {
+      b.CreateCondBr(c, blocks[i+1], exit);
+    } else {
+      b.CreateCondBr(c, blocks[0], exit);
+      x->addIncoming(vx, blocks[i]);
+      y->addIncoming(vy, blocks[i]);
+    }
+  }
+  b.SetInsertPoint(exit);
+  b.CreateRet(ConstantInt::get(i32, 0));
+  return F;
+}
+
+// n stores and loads through the fields of a global array of structs
+Function *makeMemoryFunction(Module &M, unsigned n) {
+  LLVMContext &ctx = M.getContext();
+  IntegerType *i32 = Type::getInt32Ty(ctx);
+  StructType *st = StructType::create(ctx, {i32, i32}, "pair");
+  ArrayType *at = ArrayType::get(st, n);
+  GlobalVariable *g = new GlobalVariable(M, at, false, GlobalValue::InternalLinkage,
+					 ConstantAggregateZero::get(at),
+					 "g" + std::to_string(n));
+  FunctionType *ty = FunctionType::get(i32, {}, false);
+  Function *F = Function::Create(ty, GlobalValue::ExternalLinkage,
+				 "mem" + std::to_string(n), &M);
+  IRBuilder<> b(BasicBlock::Create(ctx, "entry", F));
+  Value *sum = ConstantInt::get(i32, 0);
+  for (unsigned i = 0; i < n; ++i) {
+    Value *p = b.CreateInBoundsGEP(at, g, {b.getInt32(0), b.getInt32(i),
+					  b.getInt32(i % 2)});
+    b.CreateStore(ConstantInt::get(i32, i), p);
+    sum = b.CreateAdd(sum, b.CreateLoad(p));
+  }
+  b.CreateRet(sum);
+  return F;
+}
+
+struct SyntheticModule {
+  LLVMContext ctx;
+  std::unique_ptr<Module> M;
+  TargetLibraryInfoImpl tlii;
+  TargetLibraryInfo tli;
+
+  SyntheticModule()
+    : M(new Module("clam-microbench", ctx)), tlii(Triple(M->getTargetTriple())),
+      tli(tlii) {}
+};
+
+/* CFG construction */
+
+void BM_CfgBuilder(benchmark::State &state) {
+  SyntheticModule sm;
+  Function *F = makeArithFunction(*sm.M, state.range(0));
+  CrabBuilderParams params;
+  unsigned num_insts = 0;
+  for (auto &B : *F) {
+    num_insts += B.size();
+  }
+  for (auto _ : state) {
+    std::unique_ptr<HeapAbstraction> mem(new DummyHeapAbstraction());
+    CrabBuilderManager man(params, sm.tli, std::move(mem));
+    auto builder = man.mk_cfg_builder(*F);
+    benchmark::DoNotOptimize(builder);
+  }
+  state.SetItemsProcessed(state.iterations() * num_insts);
+}
+
+/* Constants */
+
+void BM_ToZNumber(benchmark::State &state) {
+  unsigned width = state.range(0);
+  CrabBuilderParams params;
+  params.enable_bignums = true;
+  std::vector<APInt> values;
+  for (unsigned i = 0; i < 256; ++i) {
+    values.push_back(APInt(width, (uint64_t) i * 2654435761U, true) -
+		     APInt(width, 128));
+  }
+  for (auto _ : state) {
+    for (const APInt &v : values) {
+      bool is_bignum;
+      benchmark::DoNotOptimize(toZNumber(v, params, is_bignum));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+
+/* Block labels */
+
+void BM_BlockWrapper(benchmark::State &state) {
+  SyntheticModule sm;
+  Function *F = makeArithFunction(*sm.M, state.range(0));
+  std::vector<basic_block_label_t> labels;
+  std::size_t id = 1;
+  for (auto &B : *F) {
+    labels.push_back(basic_block_label_t(&B, id++));
+  }
+  for (auto &B : *F) {
+    labels.push_back(basic_block_label_t(&B, &F->getEntryBlock(), id++));
+  }
+  std::hash<basic_block_label_t> hasher;
+  for (auto _ : state) {
+    std::size_t h = 0;
+    unsigned lt = 0;
+    for (unsigned i = 0; i < labels.size(); ++i) {
+      h ^= hasher(labels[i]);
+      lt += (labels[i] < labels[labels.size() - 1 - i]);
+      lt += (labels[i] == labels[(i * 7) % labels.size()]);
+    }
+    benchmark::DoNotOptimize(h);
+    benchmark::DoNotOptimize(lt);
+  }
+  state.SetItemsProcessed(state.iterations() * labels.size());
+}
+
+/* Regions of sea-dsa cells */
+
+// Run the sea-dsa analysis as clam does (see LegacySeaDsaHeapAbstraction)
+struct SeaDsaRunner: public ModulePass {
+  static char ID;
+  sea_dsa::Graph::SetFactory &m_fac;
+  std::unique_ptr<sea_dsa::GlobalAnalysis> &m_dsa;
+
+  SeaDsaRunner(sea_dsa::Graph::SetFactory &fac,
+	       std::unique_ptr<sea_dsa::GlobalAnalysis> &dsa)
+    : ModulePass(ID), m_fac(fac), m_dsa(dsa) {}
+
+  bool runOnModule(Module &M) override {
+    auto &tli = getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
+    auto &awi = getAnalysis<sea_dsa::AllocWrapInfo>();
+    CallGraph &cg = getAnalysis<CallGraphWrapperPass>().getCallGraph();
+    m_dsa.reset(new sea_dsa::ContextInsensitiveGlobalAnalysis
+		(M.getDataLayout(), tli, awi, cg, m_fac, false));
+    m_dsa->runOnModule(M);
+    return false;
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+    AU.addRequired<TargetLibraryInfoWrapperPass>();
+    AU.addRequired<CallGraphWrapperPass>();
+    AU.addRequired<sea_dsa::AllocWrapInfo>();
+  }
+};
+char SeaDsaRunner::ID = 0;
+
+void BM_DsaToRegion(benchmark::State &state) {
+  SyntheticModule sm;
+  Function *F = makeMemoryFunction(*sm.M, state.range(0));
+  sea_dsa::Graph::SetFactory fac;
+  std::unique_ptr<sea_dsa::GlobalAnalysis> dsa;
+  {
+    legacy::PassManager pm;
+    pm.add(new SeaDsaRunner(fac, dsa));
+    pm.run(*sm.M);
+  }
+  sea_dsa::Graph &G = dsa->getGraph(*F);
+  std::vector<const sea_dsa::Cell*> cells;
+  for (auto &I : instructions(*F)) {
+    if (auto *SI = dyn_cast<StoreInst>(&I)) {
+      if (G.hasCell(*SI->getPointerOperand())) {
+	cells.push_back(&G.getCell(*SI->getPointerOperand()));
+      }
+    }
+  }
+  const DataLayout &dl = sm.M->getDataLayout();
+  for (auto _ : state) {
+    for (const sea_dsa::Cell *c : cells) {
+      RegionInfo ri = DsaToRegion(*c, dl, true, false, false, false, false);
+      benchmark::DoNotOptimize(ri);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * cells.size());
+}
+
+} // end namespace
+
+BENCHMARK(BM_CfgBuilder)->Name("CfgBuilder")->RangeMultiplier(4)->Range(16, 4096);
+BENCHMARK(BM_ToZNumber)->Name("ToZNumber")->Arg(32)->Arg(64)->Arg(128);
+BENCHMARK(BM_BlockWrapper)->Name("BlockWrapper")->RangeMultiplier(8)->Range(64, 4096);
+BENCHMARK(BM_DsaToRegion)->Name("DsaToRegion")->RangeMultiplier(4)->Range(16, 1024);
+
+int main(int argc, char **argv) {
+  llvm::llvm_shutdown_obj shutdown;  // calls llvm_shutdown() on exit
+  registerDomains();
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -11,6 +11,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
@@ -22,11 +23,7 @@
 #include "llvm/Bitcode/BitcodeWriterPass.h"
 
 #include "clam/config.h"
-#include "clam/Passes.hh"
-
-#ifdef HAVE_LLVM_SEAHORN
-#include "llvm_seahorn/Transforms/Scalar.h"
-#endif 
+#include "clam/Transforms/Preprocessing.hh"
 
 static llvm::cl::opt<std::string>
 InputFilename(llvm::cl::Positional, llvm::cl::desc("<input LLVM bitcode file>"),
@@ -50,64 +47,38 @@ DefaultDataLayout("default-data-layout",
         llvm::cl::init(""), llvm::cl::value_desc("layout-string"));
 
 static llvm::cl::opt<bool>
-InlineAll("crab-inline-all",
-	   llvm::cl::desc("Inline all functions"),
-           llvm::cl::init(false));
-
-static llvm::cl::opt<bool>
-Devirtualize("crab-devirt", 
-              llvm::cl::desc("Resolve indirect calls"),
-              llvm::cl::init(false));
-
-static llvm::cl::opt<bool>
-LowerGv("crab-lower-gv",
-	 llvm::cl::desc("Lower global initializers in main"),
-	 llvm::cl::init(true));
-
-static llvm::cl::opt<bool>
-Scalarize("crab-scalarize",
-	 llvm::cl::desc("Scalarize vector operations"),
-	 llvm::cl::init(true));
-
-static llvm::cl::opt<bool>
-LowerInvoke("crab-lower-invoke",
-	 llvm::cl::desc("Lower invoke instructions"),
-	 llvm::cl::init(true));
-
-static llvm::cl::opt<bool>
-LowerCstExpr("crab-lower-constant-expr",
-	 llvm::cl::desc("Lower constant expressions to instructions"),
-	 llvm::cl::init(true));
-
-static llvm::cl::opt<bool>
-LowerSwitch("crab-lower-switch",
-	 llvm::cl::desc("Lower switch instructions"),
-	 llvm::cl::init(true));
-
-static llvm::cl::opt<bool>
-LowerSelect("crab-lower-select",
-	     llvm::cl::desc("Lower all select instructions"),
-             llvm::cl::init(false));
-
-static llvm::cl::opt<bool>
-ExternalizeAddrTakenFuncs("crab-externalize-addr-taken-funcs", 
-         llvm::cl::desc("Externalize uses of address-taken functions"),
-         llvm::cl::init(false));
-
-static llvm::cl::opt<bool>
-LowerUnsignedICmp("crab-lower-unsigned-icmp",
-	 llvm::cl::desc("Lower ULT and ULE instructions"),
-	 llvm::cl::init(false));
-
-static llvm::cl::opt<bool>
-OptimizeLoops("clam-pp-loops", 
-               llvm::cl::desc("Perform loop optimizations"),
-               llvm::cl::init(false));
-
-static llvm::cl::opt<bool>
-TurnUndefNondet("crab-turn-undef-nondet", 
-                 llvm::cl::desc("Turn undefined behaviour into non-determinism"),
-                 llvm::cl::init(false));
+LazyBitcode("lazy-bitcode",
+        llvm::cl::desc("Load function bodies one at a time and promote them to "
+                       "SSA before running the pre-processing passes "
+                       "(reduces peak memory on large modules)"),
+        llvm::cl::init(false));
+
+// Materialize the function bodies of a lazily loaded module one by
+// one. Each function is promoted to SSA and simplified as soon as it
+// is loaded so that only simplified bodies stay resident while the
+// rest of the module is read.
+static bool materializeByFunction(llvm::Module &M) {
+  llvm::legacy::FunctionPassManager fpm(&M);
+  fpm.add(llvm::createPromoteMemoryToRegisterPass());
+  fpm.add(llvm::createCFGSimplificationPass());
+  fpm.doInitialization();
+  for (auto &F : M) {
+    if (!F.isMaterializable())
+      continue;
+    if (llvm::Error e = F.materialize()) {
+      llvm::logAllUnhandledErrors(std::move(e), llvm::errs(), "error: ");
+      return false;
+    }
+    fpm.run(F);
+  }
+  fpm.doFinalization();
+  // -- remaining metadata, if any
+  if (llvm::Error e = M.materializeAll()) {
+    llvm::logAllUnhandledErrors(std::move(e), llvm::errs(), "error: ");
+    return false;
+  }
+  return true;
+}
 
 // removes extension from filename if there is one
 std::string getFileName(const std::string &str) {
@@ -118,22 +89,6 @@ std::string getFileName(const std::string &str) {
   return filename;
 }
 
-void breakAllocas(llvm::legacy::PassManager &pass_manager) {
-  #ifdef HAVE_LLVM_SEAHORN
-  // -- can remove bitcast from bitcast(alloca(...))
-  pass_manager.add (llvm_seahorn::createInstructionCombiningPass ());
-  #endif     
-  pass_manager.add (clam::createRemoveUnreachableBlocksPass ());
-  // -- break alloca's into scalars
-  pass_manager.add(llvm::createSROAPass());    
-  #ifdef HAVE_LLVM_SEAHORN
-  if (TurnUndefNondet) {
-    // -- Turn undef into nondet (undef are created by SROA when it calls mem2reg)
-    pass_manager.add (llvm_seahorn::createNondetInitPass ());
-  }
-  #endif
-}
-
 int main(int argc, char **argv) {
   llvm::llvm_shutdown_obj shutdown;  // calls llvm_shutdown() on exit
   llvm::cl::ParseCommandLineOptions(argc, argv,
@@ -150,7 +105,10 @@ int main(int argc, char **argv) {
   std::unique_ptr<llvm::tool_output_file> output;
   std::unique_ptr<llvm::tool_output_file> asmOutput;
   
-  module = llvm::parseIRFile(InputFilename, err, context);
+  if (LazyBitcode)
+    module = llvm::getLazyIRFileModule(InputFilename, err, context);
+  else
+    module = llvm::parseIRFile(InputFilename, err, context);
   if (module.get() == 0)
   {
     if (llvm::errs().has_colors())
@@ -217,155 +175,15 @@ int main(int argc, char **argv) {
 
   assert(dl && "Could not find Data Layout for the module");
 
-  // -- promote top-level mallocs to alloca
-  pass_manager.add(clam::createPromoteMallocPass());  
-
-  // -- turn all functions internal so that we can apply some global
-  // -- optimizations inline them if requested
-  auto PreserveMain = [=](const llvm::GlobalValue &GV) {
-    return GV.getName() == "main";
-  };    
-  pass_manager.add(llvm::createInternalizePass(PreserveMain));
-  
-  if (Devirtualize) {
-    // -- resolve indirect calls 
-    pass_manager.add(clam::createDevirtualizeFunctionsPass());
-  }
-  
-  
- if (ExternalizeAddrTakenFuncs) {
-    // -- externalize uses of address-taken functions
-    pass_manager.add(clam::createExternalizeAddressTakenFunctionsPass());
-  }
-  
-  // kill unused internal global    
-  pass_manager.add(llvm::createGlobalDCEPass()); 
-  pass_manager.add(clam::createRemoveUnreachableBlocksPass());
-  // -- global optimizations
-  pass_manager.add(llvm::createGlobalOptimizerPass());
-
-  if (LowerGv) {
-    // -- lower initializers of global variables
-    pass_manager.add(clam::createLowerGvInitializersPass());   
-  }
-
-  // -- SSA
-  pass_manager.add(llvm::createPromoteMemoryToRegisterPass());
-  #ifdef HAVE_LLVM_SEAHORN
-  if (TurnUndefNondet) {
-    // -- Turn undef into nondet
-    pass_manager.add(llvm_seahorn::createNondetInitPass());
-  }
-  #endif 
-
-  // -- cleanup after SSA
-  #ifdef HAVE_LLVM_SEAHORN
-  pass_manager.add(llvm_seahorn::createInstructionCombiningPass());
-  #endif 
-  pass_manager.add (llvm::createCFGSimplificationPass ());
-  breakAllocas(pass_manager);
-
-  // -- global value numbering and redundant load elimination
-  pass_manager.add(llvm::createGVNPass());
-  
-  // -- cleanup after break aggregates
-  #ifdef HAVE_LLVM_SEAHORN
-  pass_manager.add(llvm_seahorn::createInstructionCombiningPass());
-  #endif 
-  pass_manager.add(llvm::createCFGSimplificationPass());
-  
-  #ifdef HAVE_LLVM_SEAHORN
-  if (TurnUndefNondet) {
-     // eliminate unused calls to verifier.nondet() functions
-     pass_manager.add(llvm_seahorn::createDeadNondetElimPass());
-  }
-  #endif 
-
-  if (LowerInvoke) {
-    // -- lower invoke's
-    pass_manager.add(llvm::createLowerInvokePass());
-    // cleanup after lowering invoke's
-    pass_manager.add(llvm::createCFGSimplificationPass());
-  }
-  
-  if (InlineAll) {
-    pass_manager.add (clam::createMarkInternalInlinePass ());   
-    pass_manager.add (llvm::createAlwaysInlinerLegacyPass ());
-    // // after inlining we promote malloc to alloca instructions
-    // pass_manager.add(clam::createPromoteMallocPass());    
-    // // kill unused internal global    
-    // pass_manager.add(llvm::createGlobalDCEPass());
-    pass_manager.add(llvm::createGlobalDCEPass()); // kill unused internal global
-    // -- promote malloc to alloca
-    pass_manager.add(clam::createPromoteMallocPass());
-    pass_manager.add(llvm::createGlobalDCEPass()); // kill unused internal global
-    // XXX: for svcomp ssh programs we need to run twice to break all
-    // relevant allocas
-    breakAllocas(pass_manager);
-    breakAllocas(pass_manager);
-  }
-  
-  pass_manager.add(clam::createRemoveUnreachableBlocksPass());
-  pass_manager.add(llvm::createDeadInstEliminationPass());
-  
-  if (OptimizeLoops) {
-    // canonical form for loops
-    pass_manager.add(llvm::createLoopSimplifyPass());
-    // cleanup unnecessary blocks     
-    pass_manager.add(llvm::createCFGSimplificationPass());  
-    // loop-closed SSA 
-    pass_manager.add(llvm::createLCSSAPass());
-    #ifdef HAVE_LLVM_SEAHORN
-    // induction variable
-    pass_manager.add (llvm_seahorn::createIndVarSimplifyPass ());
-    #endif
-    // trivial invariants outside loops 
-    pass_manager.add (llvm::createBasicAAWrapperPass());
-    pass_manager.add (llvm::createLICMPass()); //LICM needs alias analysis
-    pass_manager.add (llvm::createPromoteMemoryToRegisterPass());
-    // dead loop elimination
-    pass_manager.add (llvm::createLoopDeletionPass());
-    // cleanup unnecessary blocks   
-    pass_manager.add (llvm::createCFGSimplificationPass ()); 
-  }
-    
-  // -- ensure one single exit point per function
-  pass_manager.add(llvm::createUnifyFunctionExitNodesPass());
-  pass_manager.add(llvm::createGlobalDCEPass()); 
-  pass_manager.add(llvm::createDeadCodeEliminationPass());
-  // -- remove unreachable blocks also dead cycles
-  pass_manager.add(clam::createRemoveUnreachableBlocksPass());
-
-  if (Scalarize) {
-    pass_manager.add(clam::createScalarizerPass());
-    pass_manager.add(llvm::createDeadCodeEliminationPass());
-  }
-  
-  if (LowerSwitch) {
-    // -- remove switch constructions
-    pass_manager.add(llvm::createLowerSwitchPass());
-    // cleanup unnecessary blocks     
-    pass_manager.add(llvm::createCFGSimplificationPass());
+  if (LazyBitcode && !materializeByFunction(*module)) {
+    if (llvm::errs().has_colors())
+      llvm::errs().changeColor(llvm::raw_ostream::RED);
+    llvm::errs() << "error: Bitcode was not properly read\n";
+    if (llvm::errs().has_colors()) llvm::errs().resetColor();
+    return 3;
   }
 
-  if (LowerCstExpr) {
-    // -- lower constant expressions to instructions
-    pass_manager.add(clam::createLowerCstExprPass());   
-    pass_manager.add(llvm::createDeadCodeEliminationPass());
-  }
-  
-  // -- lower ULT and ULE instructions  
-  if(LowerUnsignedICmp) {
-    pass_manager.add(clam::createLowerUnsignedICmpPass());   
-    // cleanup unnecessary and unreachable blocks   
-    pass_manager.add(llvm::createCFGSimplificationPass());
-    pass_manager.add(clam::createRemoveUnreachableBlocksPass());
-  }
-  
-  // -- must be the last one to avoid llvm undoing it
-  if (LowerSelect) {
-    pass_manager.add(clam::createLowerSelectPass());
-  }
+  clam::addPreprocessingPasses(pass_manager);
 
   if(!AsmOutputFilename.empty()) 
     pass_manager.add(createPrintModulePass(asmOutput->os()));
@@ -0,0 +1,651 @@
+///
+// clam-server -- Clam analysis server
+//
+// Keep a module and the Crab CFGs of its functions resident and
+// answer JSON-RPC 2.0 requests, one per line, read from the standard
+// input. Responses are written one per line to the standard output.
+// Anything else printed on the standard output (e.g., by Crab) is
+// redirected to the standard error.
+//
+// Methods:
+//   load       {"file": F}
+//              Read bitcode F and analyze all its functions.
+//   update     {"file": F, "functions": [N1,...]}
+//              Replace functions N1,... with their definitions in
+//              bitcode F and re-analyze them together with their
+//              callers (with --crab-inter, the call graph components
+//              that contain them). Other definitions in F are ignored.
+//   checks     {"function": N}
+//              Checks of function N (all functions if omitted).
+//   invariants {"function": N}
+//              Invariants at the entry and exit of each block of N.
+//   save       {"dir": D}
+//              Write a snapshot of the session into D (by default,
+//              --server-snapshot-dir).
+//   shutdown   {}
+//
+// The analysis is configured with the same --crab-* options as clam.
+// Memory is modeled without heap abstraction so that a function can
+// be re-analyzed without recomputing a whole-program analysis.
+//
+// With --server-snapshot-dir=D the session is saved into D after each
+// load and update, and restored from D when the server starts. A
+// snapshot is the module after the lowering passes, written as
+// bitcode together with its MD5 hash, and the analysis cache of the
+// functions (D/cache unless --crab-cache-dir is given). Restoring a
+// snapshot reads the bitcode without lowering it again and rebuilds
+// the CFGs, but the functions that did not change since are not
+// analyzed again: their invariants and the number of checks of each
+// kind are loaded from the cache. The results of --crab-inter are not
+// cached so they are recomputed.
+///
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "clam/config.h"
+#include "clam/CfgBuilder.hh"
+#include "clam/Clam.hh"
+#include "clam/DummyHeapAbstraction.hh"
+#include "clam/AbstractDomain.hh"
+#include "clam/Support/NameValues.hh"
+#include "clam/Transforms/Preprocessing.hh"
+
+#include "ClamJson.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <unistd.h>
+
+using namespace llvm;
+using namespace clam;
+
+static cl::opt<std::string>
+SnapshotDir("server-snapshot-dir",
+  cl::desc("Save the session into this directory after each load and "
+	   "update and restore it at startup"),
+  cl::init(""), cl::value_desc("dir"));
+
+namespace {
+
+const char *const SNAPSHOT_MAGIC = "clam-server-snapshot 1";
+
+// Only numbers, strings and null are valid JSON-RPC ids
+std::string jsonId(const JsonValue &id) {
+  switch (id.kind) {
+  case JsonValue::NUMBER: {
+    std::string res;
+    raw_string_ostream o(res);
+    o << format("%.15g", id.n);
+    return o.str();
+  }
+  case JsonValue::STRING:
+    return jsonString(id.s);
+  default:
+    return "null";
+  }
+}
+
+struct RpcError {
+  int code;
+  std::string message;
+  RpcError(int c, std::string m): code(c), message(m) {}
+};
+
+// JSON-RPC error codes
+enum { PARSE_ERROR = -32700, INVALID_REQUEST = -32600,
+       METHOD_NOT_FOUND = -32601, INVALID_PARAMS = -32602,
+       ANALYSIS_ERROR = -32000 };
+
+class ClamServer {
+  LLVMContext m_ctx;
+  std::unique_ptr<Module> m_module;
+  std::unique_ptr<TargetLibraryInfoImpl> m_tlii;
+  std::unique_ptr<TargetLibraryInfo> m_tli;
+  std::unique_ptr<CrabBuilderManager> m_man;
+  AnalysisParams m_params;
+  // intra-procedural analysis of each function
+  std::map<std::string, std::unique_ptr<IntraClam>> m_intra;
+  // inter-procedural analysis of the module (if --crab-inter)
+  std::unique_ptr<InterClam> m_inter;
+
+  static bool isTrackable(const Function &F) {
+    return !F.isDeclaration() && !F.empty() && !F.isVarArg();
+  }
+
+  static double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>
+      (std::chrono::steady_clock::now() - start).count();
+  }
+
+  const std::string &getStringParam(const JsonValue &params,
+				    const std::string &key) const {
+    const JsonValue *v = params.get(key);
+    if (!v || v->kind != JsonValue::STRING) {
+      throw RpcError(INVALID_PARAMS, "expected string parameter \"" + key + "\"");
+    }
+    return v->s;
+  }
+
+  Function &getFunction(const std::string &name) const {
+    Function *F = m_module->getFunction(name);
+    if (!F || !isTrackable(*F)) {
+      throw RpcError(INVALID_PARAMS, "no analyzed function " + name);
+    }
+    return *F;
+  }
+
+  std::unique_ptr<Module> readModule(const std::string &file) {
+    SMDiagnostic err;
+    std::unique_ptr<Module> M = parseIRFile(file, err, m_ctx);
+    if (!M) {
+      throw RpcError(INVALID_PARAMS, "bitcode was not properly read; " +
+		     err.getMessage().str());
+    }
+    return M;
+  }
+
+  static void prepare(Module &M) {
+    legacy::PassManager pm;
+    addLoweringPasses(pm);
+    pm.run(M);
+  }
+
+  static std::string md5(StringRef data) {
+    MD5 hash;
+    hash.update(data);
+    MD5::MD5Result result;
+    hash.final(result);
+    SmallString<32> res;
+    MD5::stringifyResult(result, res);
+    return res.str();
+  }
+
+  // Write into a temporary file that is renamed to path once
+  // complete so that a crash never leaves a partial snapshot.
+  static void writeFile(const std::string &path, StringRef data) {
+    int fd;
+    SmallString<256> tmp_path;
+    if (std::error_code ec = sys::fs::createUniqueFile(path + "-%%%%%%.tmp",
+							fd, tmp_path)) {
+      throw RpcError(ANALYSIS_ERROR, "cannot write " + path + ": " + ec.message());
+    }
+    {
+      raw_fd_ostream o(fd, /*shouldClose=*/true);
+      o << data;
+    }
+    if (std::error_code ec = sys::fs::rename(tmp_path, path)) {
+      sys::fs::remove(tmp_path);
+      throw RpcError(ANALYSIS_ERROR, "cannot write " + path + ": " + ec.message());
+    }
+  }
+
+  // Make M the module of the session and analyze it. Return the
+  // number of analyzed functions.
+  unsigned setModule(std::unique_ptr<Module> M) {
+    m_intra.clear();
+    m_inter.reset();
+    m_man.reset();
+    m_module = std::move(M);
+    m_tlii.reset(new TargetLibraryInfoImpl(Triple(m_module->getTargetTriple())));
+    m_tli.reset(new TargetLibraryInfo(*m_tlii));
+    CrabBuilderParams cfg_params = getCrabBuilderParamsFromOptions();
+    cfg_params.print_cfg = false;
+    std::unique_ptr<HeapAbstraction> mem(new DummyHeapAbstraction());
+    m_man.reset(new CrabBuilderManager(cfg_params, *m_tli, std::move(mem)));
+
+    unsigned num_funcs = 0;
+    if (m_params.run_inter) {
+      analyzeModule();
+      for (auto &F: *m_module) {
+	if (isTrackable(F)) ++num_funcs;
+      }
+    } else {
+      for (auto &F: *m_module) {
+	if (isTrackable(F)) {
+	  analyzeFunction(F);
+	  ++num_funcs;
+	}
+      }
+    }
+    return num_funcs;
+  }
+
+  void saveSnapshot(const std::string &dir) {
+    if (std::error_code ec = sys::fs::create_directories(dir)) {
+      throw RpcError(ANALYSIS_ERROR, "cannot create " + dir + ": " + ec.message());
+    }
+    SmallString<0> bitcode;
+    raw_svector_ostream os(bitcode);
+    WriteBitcodeToFile(m_module.get(), os);
+    // -- the manifest is written last: it is only valid with the
+    //    module it hashes
+    writeFile(dir + "/module.bc", bitcode.str());
+    writeFile(dir + "/manifest", std::string(SNAPSHOT_MAGIC) + "\n" +
+	      md5(bitcode.str()) + "\n");
+  }
+
+  // Save into --server-snapshot-dir (if any). A failure does not fail
+  // the request (the snapshot is then stale or invalid).
+  void autoSave() {
+    if (SnapshotDir.empty()) return;
+    try {
+      saveSnapshot(SnapshotDir);
+    } catch (const RpcError &e) {
+      errs() << "clam-server: " << e.message << "\n";
+    }
+  }
+
+  void analyzeFunction(const Function &F) {
+    std::unique_ptr<IntraClam> ic(new IntraClam(F, *m_man));
+    AnalysisParams params(m_params);
+    ic->analyze(params);
+    m_intra[F.getName()] = std::move(ic);
+  }
+
+  void analyzeModule() {
+    m_inter.reset(new InterClam(*m_module, *m_man));
+    AnalysisParams params(m_params);
+    m_inter->analyze(params, InterClam::abs_dom_map_t());
+  }
+
+  std::string printInvariant(const IntraClam::wrapper_dom_ptr &inv) const {
+    if (!inv) return "null";
+    crab::crab_string_os o;
+    inv->write(o);
+    return jsonString(o.str());
+  }
+
+  static std::string printChecks(const IntraClam::checks_db_t &db) {
+    crab::crab_string_os o;
+    db.write(o);
+    std::string res;
+    raw_string_ostream r(res);
+    r << "{\"safe\": " << db.get_total_safe()
+      << ", \"error\": " << db.get_total_error()
+      << ", \"warning\": " << db.get_total_warning()
+      << ", \"report\": " << jsonString(o.str()) << "}";
+    return r.str();
+  }
+
+public:
+
+  ClamServer(): m_params(getAnalysisParamsFromOptions()) {
+    // Nothing can be printed on the standard output
+    m_params.print_invars = false;
+    m_params.print_summaries = false;
+    m_params.print_unjustified_assumptions = false;
+    m_params.stats = false;
+    // Invariants are queried after the analysis
+    m_params.store_invariants = true;
+    m_params.lazy_invariants = false;
+    // The snapshot keeps the intra-procedural results in its cache
+    if (!SnapshotDir.empty() && m_params.cache_dir.empty()) {
+      m_params.cache_dir = SnapshotDir + "/cache";
+    }
+  }
+
+  // Restore the session saved into dir. Return false if dir has no
+  // valid snapshot.
+  bool restore(const std::string &dir, std::string &msg) {
+    auto start = std::chrono::steady_clock::now();
+    auto manifest = MemoryBuffer::getFile(dir + "/manifest");
+    if (!manifest) {
+      msg = "no snapshot in " + dir;
+      return false;
+    }
+    StringRef magic, hash;
+    std::tie(magic, hash) = (*manifest)->getBuffer().split('\n');
+    hash = hash.trim();
+    if (magic != SNAPSHOT_MAGIC) {
+      msg = "unknown snapshot format in " + dir;
+      return false;
+    }
+    // -- the bitcode is mapped in memory, not read
+    auto bitcode = MemoryBuffer::getFile(dir + "/module.bc");
+    if (!bitcode || md5((*bitcode)->getBuffer()) != hash) {
+      msg = "the module of the snapshot in " + dir + " is missing or corrupted";
+      return false;
+    }
+    SMDiagnostic err;
+    std::unique_ptr<Module> M = parseIR((*bitcode)->getMemBufferRef(), err, m_ctx);
+    if (!M) {
+      msg = "the module of the snapshot in " + dir + " cannot be read; " +
+	err.getMessage().str();
+      return false;
+    }
+    unsigned num_funcs = setModule(std::move(M));
+    raw_string_ostream o(msg);
+    o << "restored " << num_funcs << " functions from " << dir << " in "
+      << format("%.3f", elapsed(start)) << "s";
+    o.flush();
+    return true;
+  }
+
+  std::string load(const JsonValue &params) {
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<Module> M = readModule(getStringParam(params, "file"));
+    prepare(*M);
+    NameValues().runOnModule(*M);
+    unsigned num_funcs = setModule(std::move(M));
+    autoSave();
+
+    std::string res;
+    raw_string_ostream o(res);
+    o << "{\"functions\": " << num_funcs
+      << ", \"time\": " << format("%.6f", elapsed(start)) << "}";
+    return o.str();
+  }
+
+  std::string update(const JsonValue &params) {
+    if (!m_module) {
+      throw RpcError(ANALYSIS_ERROR, "no module loaded");
+    }
+    auto start = std::chrono::steady_clock::now();
+    const JsonValue *funcs = params.get("functions");
+    if (!funcs || funcs->kind != JsonValue::ARRAY) {
+      throw RpcError(INVALID_PARAMS, "expected array parameter \"functions\"");
+    }
+    std::set<std::string> changed;
+    for (auto &f: funcs->elems) {
+      if (f.kind != JsonValue::STRING) {
+	throw RpcError(INVALID_PARAMS, "function names must be strings");
+      }
+      changed.insert(f.s);
+    }
+    std::unique_ptr<Module> src = readModule(getStringParam(params, "file"));
+
+    // -- keep only the definitions of the changed functions. They
+    // -- are made external so that they replace the old ones even if
+    // -- they were internalized.
+    std::map<std::string, GlobalValue::LinkageTypes> linkages;
+    for (auto &F: *src) {
+      if (!changed.count(F.getName())) {
+	if (!F.isDeclaration()) F.deleteBody();
+      } else if (F.isDeclaration()) {
+	throw RpcError(INVALID_PARAMS, "no definition of " + F.getName().str());
+      } else {
+	linkages[F.getName()] = F.getLinkage();
+	F.setLinkage(GlobalValue::ExternalLinkage);
+      }
+    }
+    for (auto &name: changed) {
+      if (!src->getFunction(name)) {
+	throw RpcError(INVALID_PARAMS, "no definition of " + name);
+      }
+    }
+    prepare(*src);
+
+    // -- functions and globals already in the module are linked to
+    // -- the existing ones. Otherwise, the CFGs of the other functions
+    // -- would refer to erased globals.
+    for (auto &F: *src) {
+      if (Function *DF = m_module->getFunction(F.getName())) {
+	linkages.insert({DF->getName(), DF->getLinkage()});
+      }
+    }
+    for (auto &GV: src->globals()) {
+      if (GlobalVariable *DGV = m_module->getGlobalVariable(GV.getName(), true)) {
+	if (!GV.isDeclaration()) {
+	  GV.setInitializer(nullptr);
+	  GV.setLinkage(GlobalValue::ExternalLinkage);
+	}
+	linkages.insert({DGV->getName(), DGV->getLinkage()});
+      }
+    }
+
+    // -- the analyses of the changed functions and of their callers
+    // -- are discarded before the old functions are erased.
+    std::set<std::string> affected(changed.begin(), changed.end());
+    for (auto &name: changed) {
+      if (Function *F = m_module->getFunction(name)) {
+	for (User *U: F->users()) {
+	  CallSite CS(U);
+	  if (CS && CS.getCalledFunction() == F) {
+	    affected.insert(CS.getInstruction()->getParent()->getParent()->getName());
+	  }
+	}
+      }
+    }
+    for (auto &name: affected) {
+      m_intra.erase(name);
+      if (Function *F = m_module->getFunction(name)) {
+	m_man->invalidate(*F);
+      }
+    }
+
+    // -- the old definitions are freed by the link so the names of
+    // -- their values are dropped before
+    for (auto &name: changed) {
+      if (Function *F = m_module->getFunction(name)) {
+	m_man->get_var_factory().erase(*F);
+      }
+    }
+
+    for (auto &kv: linkages) {
+      if (GlobalValue *GV = m_module->getNamedValue(kv.first)) {
+	GV->setLinkage(GlobalValue::ExternalLinkage);
+      }
+    }
+    bool failed = Linker::linkModules(*m_module, std::move(src),
+				      Linker::Flags::OverrideFromSrc);
+    for (auto &kv: linkages) {
+      if (GlobalValue *GV = m_module->getNamedValue(kv.first)) {
+	GV->setLinkage(kv.second);
+      }
+    }
+    if (failed) {
+      // the module might be only partially linked
+      m_intra.clear();
+      m_inter.reset();
+      m_man.reset();
+      m_module.reset();
+      throw RpcError(ANALYSIS_ERROR, "cannot link the new definitions; "
+		     "the module must be loaded again");
+    }
+    for (auto &name: changed) {
+      NameValues().runOnFunction(*m_module->getFunction(name));
+    }
+
+    // -- re-analysis
+    if (m_params.run_inter) {
+      // Only the call graph components of the changed functions are
+      // analyzed again
+      std::vector<const Function*> changed_funcs;
+      for (auto &name: changed) {
+	changed_funcs.push_back(m_module->getFunction(name));
+      }
+      AnalysisParams params(m_params);
+      m_inter->reanalyze(params, changed_funcs);
+    } else {
+      for (auto &name: affected) {
+	Function *F = m_module->getFunction(name);
+	if (F && isTrackable(*F)) {
+	  analyzeFunction(*F);
+	}
+      }
+    }
+    autoSave();
+
+    std::string res;
+    raw_string_ostream o(res);
+    o << "{\"reanalyzed\": [";
+    bool first = true;
+    for (auto &name: affected) {
+      o << (first ? "" : ", ") << jsonString(name);
+      first = false;
+    }
+    o << "], \"time\": " << format("%.6f", elapsed(start)) << "}";
+    return o.str();
+  }
+
+  std::string save(const JsonValue &params) {
+    if (!m_module) {
+      throw RpcError(ANALYSIS_ERROR, "no module loaded");
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::string dir = SnapshotDir;
+    if (params.get("dir")) {
+      dir = getStringParam(params, "dir");
+    } else if (dir.empty()) {
+      throw RpcError(INVALID_PARAMS, "expected string parameter \"dir\"");
+    }
+    saveSnapshot(dir);
+    std::string res;
+    raw_string_ostream o(res);
+    o << "{\"dir\": " << jsonString(dir)
+      << ", \"time\": " << format("%.6f", elapsed(start)) << "}";
+    return o.str();
+  }
+
+  std::string checks(const JsonValue &params) {
+    if (!m_module) {
+      throw RpcError(ANALYSIS_ERROR, "no module loaded");
+    }
+    if (m_inter) {
+      // checks are not kept per function by the inter-procedural analysis
+      return printChecks(m_inter->get_checks_db());
+    }
+    if (params.get("function")) {
+      Function &F = getFunction(getStringParam(params, "function"));
+      return printChecks(m_intra.at(F.getName())->get_checks_db());
+    }
+    IntraClam::checks_db_t all;
+    for (auto &kv: m_intra) {
+      all += kv.second->get_checks_db();
+    }
+    return printChecks(all);
+  }
+
+  std::string invariants(const JsonValue &params) {
+    if (!m_module) {
+      throw RpcError(ANALYSIS_ERROR, "no module loaded");
+    }
+    Function &F = getFunction(getStringParam(params, "function"));
+    std::string res;
+    raw_string_ostream o(res);
+    o << "{\"blocks\": [";
+    for (auto &B: F) {
+      IntraClam::wrapper_dom_ptr pre, post;
+      if (m_inter) {
+	pre = m_inter->get_pre(&B);
+	post = m_inter->get_post(&B);
+      } else {
+	IntraClam &ic = *m_intra.at(F.getName());
+	pre = ic.get_pre(&B);
+	post = ic.get_post(&B);
+      }
+      o << (&B == &F.getEntryBlock() ? "" : ", ")
+	<< "{\"block\": " << jsonString(B.getName())
+	<< ", \"pre\": " << printInvariant(pre)
+	<< ", \"post\": " << printInvariant(post) << "}";
+    }
+    o << "]}";
+    return o.str();
+  }
+};
+
+} // end namespace
+
+int main(int argc, char **argv) {
+  llvm::llvm_shutdown_obj shutdown;  // calls llvm_shutdown() on exit
+  llvm::cl::ParseCommandLineOptions(argc, argv,
+  "clam-server -- Clam analysis server (JSON-RPC on standard input/output)\n");
+
+  llvm::sys::PrintStackTraceOnErrorSignal(argv[0]);
+  llvm::PrettyStackTraceProgram PSTP(argc, argv);
+
+  // -- responses are the only output on the original standard output
+  int rpc_fd = dup(STDOUT_FILENO);
+  dup2(STDERR_FILENO, STDOUT_FILENO);
+  llvm::raw_fd_ostream rpc(rpc_fd, /*shouldClose=*/true);
+
+  ClamServer server;
+  if (!SnapshotDir.empty()) {
+    std::string msg;
+    server.restore(SnapshotDir, msg);
+    errs() << "clam-server: " << msg << "\n";
+  }
+  std::string line;
+  bool done = false;
+  while (!done && std::getline(std::cin, line)) {
+    if (StringRef(line).trim().empty()) continue;
+
+    JsonValue request;
+    std::string id = "null";
+    std::string result;
+    try {
+      JsonParser parser(line);
+      if (!parser.parse(request) || !parser.atEnd()) {
+	throw RpcError(PARSE_ERROR, "parse error");
+      }
+      if (const JsonValue *v = request.get("id")) {
+	id = jsonId(*v);
+      }
+      const JsonValue *method = request.get("method");
+      if (!method || method->kind != JsonValue::STRING) {
+	throw RpcError(INVALID_REQUEST, "missing method");
+      }
+      JsonValue no_params;
+      no_params.kind = JsonValue::OBJECT;
+      const JsonValue *params = request.get("params");
+      if (!params) {
+	params = &no_params;
+      } else if (params->kind != JsonValue::OBJECT) {
+	throw RpcError(INVALID_PARAMS, "params must be an object");
+      }
+
+      if (method->s == "load") {
+	result = server.load(*params);
+      } else if (method->s == "update") {
+	result = server.update(*params);
+      } else if (method->s == "checks") {
+	result = server.checks(*params);
+      } else if (method->s == "invariants") {
+	result = server.invariants(*params);
+      } else if (method->s == "save") {
+	result = server.save(*params);
+      } else if (method->s == "shutdown") {
+	result = "null";
+	done = true;
+      } else {
+	throw RpcError(METHOD_NOT_FOUND, "unknown method " + method->s);
+      }
+      // notifications (requests without id) have no response
+      if (!request.get("id")) continue;
+      rpc << "{\"jsonrpc\": \"2.0\", \"id\": " << id
+	  << ", \"result\": " << result << "}\n";
+    } catch (const RpcError &e) {
+      rpc << "{\"jsonrpc\": \"2.0\", \"id\": " << id
+	  << ", \"error\": {\"code\": " << e.code
+	  << ", \"message\": " << jsonString(e.message) << "}}\n";
+    }
+    rpc.flush();
+  }
+  return 0;
+}
@@ -14,6 +14,8 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO.h"
@@ -28,13 +30,27 @@
 
 #include "clam/Passes.hh"
 #include "clam/Clam.hh"
+#include "clam/Support/Stats.hh"
 #include "clam/Transforms/InsertInvariants.hh"
+#include "clam/Transforms/Preprocessing.hh"
 
 #include "sea_dsa/ShadowMem.hh"
 
+#include "crab/common/stats.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
 static llvm::cl::opt<std::string>
 InputFilename(llvm::cl::Positional, llvm::cl::desc("<input LLVM bitcode file>"),
-              llvm::cl::Required, llvm::cl::value_desc("filename"));
+              llvm::cl::Optional, llvm::cl::value_desc("filename"));
 
 static llvm::cl::opt<std::string>
 OutputFilename("o", llvm::cl::desc("Override output filename"),
@@ -59,35 +75,40 @@ NoCrab("no-crab",
         llvm::cl::Hidden);
 
 static llvm::cl::opt<bool>
-TurnUndefNondet("crab-turn-undef-nondet", 
-                 llvm::cl::desc("Turn undefined behaviour into non-determinism"),
-                 llvm::cl::init(false),
-                 llvm::cl::Hidden);
+RunPreprocessor("clam-pp",
+                 llvm::cl::desc("Run the clam-pp pipeline before the analysis in the same process"),
+                 llvm::cl::init(false));
 
-static llvm::cl::opt<bool>
-LowerUnsignedICmp("crab-lower-unsigned-icmp",
-	 llvm::cl::desc("Lower ULT and ULE instructions"),
-	 llvm::cl::init(false));
+static llvm::cl::opt<unsigned>
+OptLevel("clam-opt-level",
+          llvm::cl::desc("Run the LLVM -O<N> pipeline after clam-pp (requires --clam-pp)"),
+          llvm::cl::init(0), llvm::cl::value_desc("N"));
 
-static llvm::cl::opt<bool>
-LowerCstExpr("crab-lower-constant-expr",
-	 llvm::cl::desc("Lower constant expressions to instructions"),
-	 llvm::cl::init(true));
+static llvm::cl::opt<std::string>
+BatchFilename("batch",
+               llvm::cl::desc("Analyze all the bitcode files listed in <filename>, "
+                              "one per line (- for standard input)"),
+               llvm::cl::init(""), llvm::cl::value_desc("filename"));
 
-static llvm::cl::opt<bool>
-LowerInvoke("crab-lower-invoke",
-	 llvm::cl::desc("Lower invoke instructions"),
-	 llvm::cl::init(true));
+static llvm::cl::opt<std::string>
+BatchOutputDir("batch-out-dir",
+                llvm::cl::desc("Directory of the per-module outputs in batch mode: "
+                               "<dir>/<name>.out and, if given, -o and -oll "
+                               "as suffixes of <dir>/<name>"),
+                llvm::cl::init("."), llvm::cl::value_desc("dir"));
 
-static llvm::cl::opt<bool>
-LowerSwitch("crab-lower-switch",
-	 llvm::cl::desc("Lower switch instructions"),
-	 llvm::cl::init(true));
+static llvm::cl::opt<unsigned>
+BatchJobs("batch-jobs",
+           llvm::cl::desc("Number of processes analyzing modules in batch mode"),
+           llvm::cl::init(1), llvm::cl::value_desc("N"));
 
 static llvm::cl::opt<bool>
-LowerSelect("crab-lower-select", 
-             llvm::cl::desc("Lower all select instructions"),
-             llvm::cl::init(false));
+LazyFunctions("lazy-functions",
+               llvm::cl::desc("Map the bitcode file and read the body of each function "
+                              "just before it is analyzed, releasing it once its "
+                              "results are reported (only intra-procedural analysis "
+                              "with --crab-track=num)"),
+               llvm::cl::init(false));
 
 static llvm::cl::opt<bool>
 PromoteAssume("crab-promote-assume", 
@@ -109,23 +130,71 @@ std::string getFileName(const std::string &str) {
   return filename;
 }
 
-int main(int argc, char **argv) {
-  llvm::llvm_shutdown_obj shutdown;  // calls llvm_shutdown() on exit
-  llvm::cl::ParseCommandLineOptions(argc, argv,
-  "Clam -- Abstract Interpretation-based Analyzer of LLVM bitcode\n");
+// Analyze one bitcode file whose function bodies are read on
+// demand. Only one function body is in memory at a time so the peak
+// memory follows the largest function instead of the whole module.
+static int runOnLazyFile(const std::string &inputFilename) {
+  llvm::SMDiagnostic err;
+  llvm::LLVMContext context;
+  // -- the file is mapped in memory and only the bodies of the
+  // -- functions and their metadata are read when they are needed
+  std::unique_ptr<llvm::Module> module =
+    llvm::getLazyIRFileModule(inputFilename, err, context,
+                              true /*ShouldLazyLoadMetadata*/);
+  if (!module) {
+    if (llvm::errs().has_colors()) llvm::errs().changeColor(llvm::raw_ostream::RED);
+    llvm::errs() << "error: "
+                 << "Bitcode was not properly read; " << err.getMessage() << "\n";
+    if (llvm::errs().has_colors()) llvm::errs().resetColor();
+    return 3;
+  }
+  if (!DefaultDataLayout.empty() &&
+      module->getDataLayout().getStringRepresentation().empty()) {
+    module->setDataLayout(DefaultDataLayout);
+  }
 
-  llvm::sys::PrintStackTraceOnErrorSignal(argv[0]);
-  llvm::PrettyStackTraceProgram PSTP(argc, argv);
-  llvm::EnableDebugBuffering = true;
+  // -- the lowering cannot run on the whole module: it runs on each
+  // -- function once its body is read (FunctionPassManager::run
+  // -- materializes the function)
+  llvm::legacy::FunctionPassManager lowering(module.get());
+  clam::addFunctionLoweringPasses(lowering);
+  lowering.doInitialization();
+
+  clam::ClamPass *clam_pass = new clam::ClamPass();
+  clam_pass->set_function_hooks(
+      [&lowering](llvm::Function &F) { lowering.run(F); },
+      // -- the results of F are already reported
+      [](llvm::Function &F) { F.deleteBody(); });
 
+  llvm::legacy::PassManager pass_manager;
+  pass_manager.add(clam_pass);
+  pass_manager.run(*module.get());
+  lowering.doFinalization();
+  return 0;
+}
+
+// Run the whole pipeline on one bitcode file
+static int runOnFile(const std::string &inputFilename,
+                     const std::string &outputFilename,
+                     const std::string &asmOutputFilename) {
   std::error_code error_code;
   llvm::SMDiagnostic err;
-  static llvm::LLVMContext context;
+  llvm::LLVMContext context;
   std::unique_ptr<llvm::Module> module;
   std::unique_ptr<llvm::tool_output_file> output;
   std::unique_ptr<llvm::tool_output_file> asmOutput;
+
+  if (LazyFunctions) {
+    if (RunPreprocessor || NoCrab || XMemShadows ||
+        !outputFilename.empty() || !asmOutputFilename.empty()) {
+      llvm::errs() << "error: --lazy-functions cannot be used with --clam-pp, "
+                   << "--no-crab, --crab-mem-shadows, -o or -oll\n";
+      return 3;
+    }
+    return runOnLazyFile(inputFilename);
+  }
   
-  module = llvm::parseIRFile(InputFilename, err, context);
+  module = llvm::parseIRFile(inputFilename, err, context);
   if (!module) {
     if (llvm::errs().has_colors()) llvm::errs().changeColor(llvm::raw_ostream::RED);
     llvm::errs() << "error: "
@@ -134,26 +203,26 @@ int main(int argc, char **argv) {
     return 3;
   }
 
-  if (!AsmOutputFilename.empty())
+  if (!asmOutputFilename.empty())
     asmOutput = 
-      llvm::make_unique<llvm::tool_output_file>(AsmOutputFilename.c_str(), error_code, 
+      llvm::make_unique<llvm::tool_output_file>(asmOutputFilename.c_str(), error_code, 
                                                 llvm::sys::fs::F_Text);
   if (error_code) {
     if (llvm::errs().has_colors()) 
       llvm::errs().changeColor(llvm::raw_ostream::RED);
-    llvm::errs() << "error: Could not open " << AsmOutputFilename << ": " 
+    llvm::errs() << "error: Could not open " << asmOutputFilename << ": " 
                  << error_code.message() << "\n";
     if (llvm::errs().has_colors()) llvm::errs().resetColor();
     return 3;
   }
 
-  if (!OutputFilename.empty())
+  if (!outputFilename.empty())
     output = llvm::make_unique<llvm::tool_output_file>
-      (OutputFilename.c_str(), error_code, llvm::sys::fs::F_None);
+      (outputFilename.c_str(), error_code, llvm::sys::fs::F_None);
       
   if (error_code) {
     if (llvm::errs().has_colors()) llvm::errs().changeColor(llvm::raw_ostream::RED);
-    llvm::errs() << "error: Could not open " << OutputFilename << ": " 
+    llvm::errs() << "error: Could not open " << outputFilename << ": " 
                  << error_code.message() << "\n";
     if (llvm::errs().has_colors()) llvm::errs().resetColor();
     return 3;
@@ -164,18 +233,6 @@ int main(int argc, char **argv) {
   ///////////////////////////////
 
   llvm::legacy::PassManager pass_manager;
-  llvm::PassRegistry &Registry = *llvm::PassRegistry::getPassRegistry();
-  llvm::initializeAnalysis(Registry);
-
-  /// call graph and other IPA passes
-  // llvm::initializeIPA (Registry);
-  // XXX: porting to 3.8
-  llvm::initializeCallGraphWrapperPassPass(Registry);
-  // XXX: commented while porting to 5.0    
-  //llvm::initializeCallGraphPrinterPass(Registry);
-  llvm::initializeCallGraphViewerPass(Registry);
-  // XXX: not sure if needed anymore
-  llvm::initializeGlobalsAAWrapperPassPass(Registry);
     
   // add an appropriate DataLayout instance for the module
   const llvm::DataLayout *dl = &module->getDataLayout();
@@ -187,68 +244,20 @@ int main(int argc, char **argv) {
 
   assert(dl && "Could not find Data Layout for the module");
   
+  if (RunPreprocessor) {
+    // -- same pipeline as clam-pp but on the in-memory module
+    clam::addPreprocessingPasses(pass_manager);
+    if (OptLevel > 0) {
+      clam::addOptimizationPasses(pass_manager, OptLevel);
+    }
+  }
+  
   /**
    * Here only passes that are strictly necessary to avoid crashes or
    * useless results. Passes that are only for improving precision
    * should be run in crabllvm-pp.
    **/
-    
-  // kill unused internal global    
-  pass_manager.add(llvm::createGlobalDCEPass()); 
-  pass_manager.add(clam::createRemoveUnreachableBlocksPass());
-
-  // -- promote alloca's to registers
-  pass_manager.add(llvm::createPromoteMemoryToRegisterPass());
-  #ifdef HAVE_LLVM_SEAHORN
-  if (TurnUndefNondet) {
-    // -- Turn undef into nondet
-    pass_manager.add(llvm_seahorn::createNondetInitPass());
-  }
-  #endif
-  if (LowerInvoke) {
-    // -- lower invoke's
-    pass_manager.add(llvm::createLowerInvokePass());
-    // cleanup after lowering invoke's
-    pass_manager.add(llvm::createCFGSimplificationPass());
-  }
-  // -- ensure one single exit point per function
-  pass_manager.add(llvm::createUnifyFunctionExitNodesPass());
-  // -- remove unreachable blocks 
-  pass_manager.add(clam::createRemoveUnreachableBlocksPass());
-  if (LowerSwitch) {
-    // -- remove switch constructions
-    pass_manager.add(llvm::createLowerSwitchPass());
-    // cleanup after lowering switches
-    pass_manager.add(llvm::createCFGSimplificationPass());
-  }
-  // -- lower constant expressions to instructions
-  if (LowerCstExpr) {
-    pass_manager.add(clam::createLowerCstExprPass());
-    // cleanup after lowering constant expressions
-    pass_manager.add(llvm::createDeadCodeEliminationPass());
-  }
-  #ifdef HAVE_LLVM_SEAHORN
-  if (TurnUndefNondet) {
-    pass_manager.add(llvm_seahorn::createDeadNondetElimPass());
-  }
-  #endif 
-  
-  // -- lower ULT and ULE instructions  
-  if(LowerUnsignedICmp) {
-    pass_manager.add(clam::createLowerUnsignedICmpPass());   
-    // cleanup unnecessary and unreachable blocks   
-    pass_manager.add(llvm::createCFGSimplificationPass());
-    pass_manager.add(clam::createRemoveUnreachableBlocksPass());
-  }
-  
-  // -- must be the last ones before running crab.
-  if (LowerSelect) {
-    pass_manager.add(clam::createLowerSelectPass());
-  }
-  
-  // -- ensure one single exit point per function
-  // LowerUnsignedIcmpPass and LowerSelect can add multiple returns.
-  pass_manager.add(llvm::createUnifyFunctionExitNodesPass());
+  clam::addLoweringPasses(pass_manager);
 
   if (XMemShadows) {
     // XXX: it should preserve unifyFunctionExitNodes pass.
@@ -260,7 +269,7 @@ int main(int argc, char **argv) {
     pass_manager.add(new clam::ClamPass());
   }
 
-  if(!AsmOutputFilename.empty()) {
+  if(!asmOutputFilename.empty()) {
     pass_manager.add(createPrintModulePass(asmOutput->os()));    
   }
  
@@ -280,7 +289,7 @@ int main(int argc, char **argv) {
     }    
   }
       
-  if (!OutputFilename.empty()) {
+  if (!outputFilename.empty()) {
     if (OutputAssembly)
       pass_manager.add(createPrintModulePass(output->os()));
     else 
@@ -289,8 +298,170 @@ int main(int argc, char **argv) {
   
   pass_manager.run(*module.get());
 
-  if (!AsmOutputFilename.empty()) asmOutput->keep();
-  if (!OutputFilename.empty()) output->keep();
+  if (!asmOutputFilename.empty()) asmOutput->keep();
+  if (!outputFilename.empty()) output->keep();
 
   return 0;
 }
+
+// Analyze one module of the batch. The standard output is redirected
+// to <stem>.out while the module is analyzed.
+static int runOnBatchModule(const std::string &inputFilename,
+                            const std::string &stem) {
+  std::string outputFilename =
+    OutputFilename.empty() ? "" : stem + OutputFilename;
+  std::string asmOutputFilename =
+    AsmOutputFilename.empty() ? "" : stem + AsmOutputFilename;
+
+  int fd;
+  std::string resultsFilename = stem + ".out";
+  if (std::error_code ec = llvm::sys::fs::openFileForWrite(resultsFilename, fd,
+                                                           llvm::sys::fs::F_Text)) {
+    llvm::errs() << "error: Could not open " << resultsFilename << ": "
+                 << ec.message() << "\n";
+    return 3;
+  }
+  llvm::outs().flush();
+  std::cout.flush();
+  fflush(stdout);
+  int savedStdout = dup(STDOUT_FILENO);
+  dup2(fd, STDOUT_FILENO);
+  close(fd);
+
+  // -- statistics are global so they would accumulate across modules
+  crab::CrabStats::reset();
+  clam::ClamStats::reset();
+  int res = runOnFile(inputFilename, outputFilename, asmOutputFilename);
+
+  llvm::outs().flush();
+  std::cout.flush();
+  fflush(stdout);
+  dup2(savedStdout, STDOUT_FILENO);
+  close(savedStdout);
+  return res;
+}
+
+// Analyze all the modules listed in BatchFilename. Modules are
+// distributed among BatchJobs processes forked after all the options
+// have been parsed. Return 0 if all modules were analyzed successfully.
+static int runBatch() {
+  auto bufOrErr = llvm::MemoryBuffer::getFileOrSTDIN(BatchFilename);
+  if (!bufOrErr) {
+    llvm::errs() << "error: Could not open " << BatchFilename << ": "
+                 << bufOrErr.getError().message() << "\n";
+    return 3;
+  }
+  std::vector<std::string> files;
+  llvm::SmallVector<llvm::StringRef, 64> lines;
+  (*bufOrErr)->getBuffer().split(lines, '\n', -1, false);
+  for (llvm::StringRef line : lines) {
+    line = line.trim();
+    if (!line.empty() && !line.startswith("#")) {
+      files.push_back(line.str());
+    }
+  }
+
+  if (std::error_code ec = llvm::sys::fs::create_directories(BatchOutputDir)) {
+    llvm::errs() << "error: Could not create " << BatchOutputDir << ": "
+                 << ec.message() << "\n";
+    return 3;
+  }
+  // -- files with the same name get a numeric suffix
+  std::vector<std::string> stems;
+  std::map<std::string, unsigned> seen;
+  for (auto &file : files) {
+    std::string name = llvm::sys::path::stem(file);
+    unsigned n = seen[name]++;
+    if (n > 0) {
+      name += "." + std::to_string(n);
+    }
+    llvm::SmallString<256> stem(BatchOutputDir);
+    llvm::sys::path::append(stem, name);
+    stems.push_back(stem.str());
+  }
+
+  auto analyzeShare = [&](unsigned job, unsigned jobs) {
+    unsigned failures = 0;
+    for (unsigned i = job; i < files.size(); i += jobs) {
+      if (runOnBatchModule(files[i], stems[i]) != 0) {
+        llvm::errs() << "error: analysis of " << files[i] << " failed\n";
+        ++failures;
+      }
+    }
+    return failures;
+  };
+
+  unsigned jobs = std::min((unsigned)files.size(), (unsigned)BatchJobs);
+  if (jobs <= 1) {
+    return (analyzeShare(0, 1) > 0 ? 1 : 0);
+  }
+
+  llvm::outs().flush();
+  llvm::errs().flush();
+  std::cout.flush();
+  fflush(nullptr);
+  std::vector<pid_t> workers;
+  unsigned failures = 0;
+  for (unsigned job = 0; job < jobs; ++job) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      _exit(analyzeShare(job, jobs) > 0 ? 1 : 0);
+    } else if (pid < 0) {
+      // -- the shares without a process are analyzed by this one
+      llvm::errs() << "warning: Could not create a batch process ("
+                   << std::strerror(errno) << "): " << jobs - job
+                   << " of the " << jobs << " shares are analyzed by the main process\n";
+      for (; job < jobs; ++job) {
+        failures += analyzeShare(job, jobs);
+      }
+      break;
+    }
+    workers.push_back(pid);
+  }
+  int res = (failures > 0 ? 1 : 0);
+  for (pid_t pid : workers) {
+    int status;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      res = 1;
+    }
+  }
+  return res;
+}
+
+int main(int argc, char **argv) {
+  llvm::llvm_shutdown_obj shutdown;  // calls llvm_shutdown() on exit
+  llvm::cl::ParseCommandLineOptions(argc, argv,
+  "Clam -- Abstract Interpretation-based Analyzer of LLVM bitcode\n");
+
+  llvm::sys::PrintStackTraceOnErrorSignal(argv[0]);
+  llvm::PrettyStackTraceProgram PSTP(argc, argv);
+  llvm::EnableDebugBuffering = true;
+
+  llvm::PassRegistry &Registry = *llvm::PassRegistry::getPassRegistry();
+  llvm::initializeAnalysis(Registry);
+
+  /// call graph and other IPA passes
+  // llvm::initializeIPA (Registry);
+  // XXX: porting to 3.8
+  llvm::initializeCallGraphWrapperPassPass(Registry);
+  // XXX: commented while porting to 5.0    
+  //llvm::initializeCallGraphPrinterPass(Registry);
+  llvm::initializeCallGraphViewerPass(Registry);
+  // XXX: not sure if needed anymore
+  llvm::initializeGlobalsAAWrapperPassPass(Registry);
+
+  if (!BatchFilename.empty()) {
+    if (!InputFilename.empty()) {
+      llvm::errs() << "error: an input file cannot be given together with --batch\n";
+      return 3;
+    }
+    return runBatch();
+  }
+
+  if (InputFilename.empty()) {
+    llvm::errs() << "error: no input file (see -help)\n";
+    return 3;
+  }
+  return runOnFile(InputFilename, OutputFilename, AsmOutputFilename);
+}
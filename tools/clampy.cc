@@ -0,0 +1,332 @@
+///
+// libclampy -- C interface of Clam for py/clampy.py
+//
+// A session keeps a module and the Crab CFGs of its functions so
+// that the functions can be analyzed many times, with different
+// parameters, without spawning a process. The results are returned
+// as JSON strings that clampy.py turns into Python objects.
+//
+// All the functions return null (or -1) on error and set *err to a
+// message that must be released with clampy_free_string.
+//
+// Functions:
+//   clampy_init(argc, argv)
+//       Parse the --crab-* options as clam does. Only the first call
+//       parses them.
+//   clampy_load(file, err)
+//       Read bitcode file and start a session. Memory is modeled
+//       without heap abstraction as in clam-server.
+//   clampy_functions(session)
+//       JSON array with the names of the functions that can be analyzed.
+//   clampy_analyze(session, function, params, err)
+//       Analyze function (all of them if null) with the options
+//       overridden by the JSON object params, e.g.
+//       {"dom": "zones", "widening_delay": 2, "inter": false}, and
+//       return {"time": T, "checks": {...}, "functions": {N: [B,...]}}
+//       where each block B is {"block": name, "pre": I, "post": I,
+//       "pre_constraints": [C,...]}.
+//   clampy_free(session), clampy_free_string(str)
+///
+
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "clam/config.h"
+#include "clam/CfgBuilder.hh"
+#include "clam/Clam.hh"
+#include "clam/DummyHeapAbstraction.hh"
+#include "clam/AbstractDomain.hh"
+#include "clam/Support/NameValues.hh"
+#include "clam/Transforms/Preprocessing.hh"
+
+#include "ClamJson.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace clam;
+
+namespace {
+
+struct ClamPySession {
+  LLVMContext ctx;
+  std::unique_ptr<Module> module;
+  std::unique_ptr<TargetLibraryInfoImpl> tlii;
+  std::unique_ptr<TargetLibraryInfo> tli;
+  std::unique_ptr<CrabBuilderManager> man;
+  // all the calls on a session are serialized
+  std::mutex mutex;
+};
+
+bool isTrackable(const Function &F) {
+  return !F.isDeclaration() && !F.empty() && !F.isVarArg();
+}
+
+char *copyString(const std::string &str) {
+  char *res = (char *) malloc(str.size() + 1);
+  memcpy(res, str.c_str(), str.size() + 1);
+  return res;
+}
+
+unsigned getUnsigned(const JsonValue &v, const std::string &key) {
+  if (v.kind != JsonValue::NUMBER || v.n < 0) {
+    throw std::runtime_error("expected a non-negative number for " + key);
+  }
+  return (unsigned) v.n;
+}
+
+bool getBool(const JsonValue &v, const std::string &key) {
+  if (v.kind != JsonValue::BOOL) {
+    throw std::runtime_error("expected a boolean for " + key);
+  }
+  return v.b;
+}
+
+// Override the parameters given by the options with the fields of
+// the JSON object str
+void readParams(StringRef str, AnalysisParams &params) {
+  if (str.trim().empty()) {
+    return;
+  }
+  JsonValue obj;
+  JsonParser parser(str);
+  if (!parser.parse(obj) || !parser.atEnd() || obj.kind != JsonValue::OBJECT) {
+    throw std::runtime_error("parameters must be a JSON object");
+  }
+  for (auto &kv : obj.fields) {
+    const std::string &key = kv.first;
+    const JsonValue &v = kv.second;
+    if (key == "dom") {
+      if (v.kind != JsonValue::STRING || !parseDomainName(v.s, params.dom)) {
+	throw std::runtime_error("unknown domain for dom");
+      }
+    } else if (key == "check") {
+      if (v.kind == JsonValue::STRING && v.s == "none") {
+	params.check = NOCHECKS;
+      } else if (v.kind == JsonValue::STRING && v.s == "assert") {
+	params.check = ASSERTION;
+      } else {
+	throw std::runtime_error("check must be \"none\" or \"assert\"");
+      }
+    } else if (key == "inter") {
+      params.run_inter = getBool(v, key);
+    } else if (key == "backward") {
+      params.run_backward = getBool(v, key);
+    } else if (key == "widening_delay") {
+      params.widening_delay = getUnsigned(v, key);
+    } else if (key == "narrowing_iterations") {
+      params.narrowing_iters = getUnsigned(v, key);
+    } else if (key == "widening_jumpset") {
+      params.widening_jumpset = getUnsigned(v, key);
+    } else if (key == "relational_threshold") {
+      params.relational_threshold = getUnsigned(v, key);
+    } else if (key == "max_estimated_cost") {
+      if (v.kind != JsonValue::NUMBER) {
+	throw std::runtime_error("expected a number for " + key);
+      }
+      params.max_estimated_cost = v.n;
+    } else {
+      throw std::runtime_error("unknown parameter " + key);
+    }
+  }
+}
+
+std::string printInvariant(const IntraClam::wrapper_dom_ptr &inv) {
+  if (!inv) return "null";
+  crab::crab_string_os o;
+  inv->write(o);
+  return jsonString(o.str());
+}
+
+std::string printConstraints(const IntraClam::wrapper_dom_ptr &inv) {
+  if (!inv) return "[]";
+  std::string res;
+  raw_string_ostream r(res);
+  r << "[";
+  bool first = true;
+  for (auto const &cst : inv->to_linear_constraints()) {
+    crab::crab_string_os o;
+    o << cst;
+    r << (first ? "" : ", ") << jsonString(o.str());
+    first = false;
+  }
+  r << "]";
+  return r.str();
+}
+
+std::string printChecks(const IntraClam::checks_db_t &db) {
+  crab::crab_string_os o;
+  db.write(o);
+  std::string res;
+  raw_string_ostream r(res);
+  r << "{\"safe\": " << db.get_total_safe()
+    << ", \"error\": " << db.get_total_error()
+    << ", \"warning\": " << db.get_total_warning()
+    << ", \"report\": " << jsonString(o.str()) << "}";
+  return r.str();
+}
+
+// get_pre and get_post of IntraClam or InterClam
+template<typename Analysis>
+void printBlocks(const Function &F, const Analysis &a, raw_ostream &o) {
+  o << jsonString(F.getName()) << ": [";
+  for (auto &B : F) {
+    IntraClam::wrapper_dom_ptr pre = a.get_pre(&B);
+    IntraClam::wrapper_dom_ptr post = a.get_post(&B);
+    o << (&B == &F.getEntryBlock() ? "" : ", ")
+      << "{\"block\": " << jsonString(getValueName(B))
+      << ", \"pre\": " << printInvariant(pre)
+      << ", \"post\": " << printInvariant(post)
+      << ", \"pre_constraints\": " << printConstraints(pre) << "}";
+  }
+  o << "]";
+}
+
+std::string analyze(ClamPySession &s, const char *function,
+		    const char *params_str) {
+  auto start = std::chrono::steady_clock::now();
+  AnalysisParams params = getAnalysisParamsFromOptions();
+  // Nothing is printed: the results are returned
+  params.print_invars = false;
+  params.print_summaries = false;
+  params.print_unjustified_assumptions = false;
+  params.stats = false;
+  params.store_invariants = true;
+  params.lazy_invariants = false;
+  readParams(params_str ? params_str : "", params);
+
+  std::vector<const Function*> funcs;
+  if (function) {
+    const Function *F = s.module->getFunction(function);
+    if (!F || !isTrackable(*F)) {
+      throw std::runtime_error(std::string("no analyzed function ") + function);
+    }
+    funcs.push_back(F);
+  } else {
+    for (auto &F : *s.module) {
+      if (isTrackable(F)) funcs.push_back(&F);
+    }
+  }
+
+  std::string blocks;
+  raw_string_ostream b(blocks);
+  std::string checks;
+  if (params.run_inter) {
+    InterClam inter(*s.module, *s.man);
+    inter.analyze(params, InterClam::abs_dom_map_t());
+    bool first = true;
+    for (const Function *F : funcs) {
+      b << (first ? "" : ", ");
+      printBlocks(*F, inter, b);
+      first = false;
+    }
+    checks = printChecks(inter.get_checks_db());
+  } else {
+    IntraClam::checks_db_t all;
+    bool first = true;
+    for (const Function *F : funcs) {
+      IntraClam ic(*F, *s.man);
+      AnalysisParams fparams(params);
+      ic.analyze(fparams);
+      b << (first ? "" : ", ");
+      printBlocks(*F, ic, b);
+      all += ic.get_checks_db();
+      first = false;
+    }
+    checks = printChecks(all);
+  }
+
+  std::string res;
+  raw_string_ostream o(res);
+  o << "{\"time\": " << format("%.6f", std::chrono::duration<double>
+			       (std::chrono::steady_clock::now() - start).count())
+    << ", \"checks\": " << checks
+    << ", \"functions\": {" << b.str() << "}}";
+  return o.str();
+}
+
+} // end namespace
+
+extern "C" {
+
+int clampy_init(int argc, const char **argv) {
+  static std::once_flag parsed;
+  std::call_once(parsed, [argc, argv]() {
+      std::vector<const char*> args(1, "clampy");
+      args.insert(args.end(), argv, argv + argc);
+      cl::ParseCommandLineOptions(args.size(), args.data(),
+				  "clampy -- Python bindings of Clam\n");
+    });
+  return 0;
+}
+
+void *clampy_load(const char *file, char **err) {
+  std::unique_ptr<ClamPySession> s(new ClamPySession());
+  SMDiagnostic diag;
+  s->module = parseIRFile(file, diag, s->ctx);
+  if (!s->module) {
+    *err = copyString("bitcode was not properly read; " + diag.getMessage().str());
+    return nullptr;
+  }
+  legacy::PassManager pm;
+  addLoweringPasses(pm);
+  pm.run(*s->module);
+
+  s->tlii.reset(new TargetLibraryInfoImpl(Triple(s->module->getTargetTriple())));
+  s->tli.reset(new TargetLibraryInfo(*s->tlii));
+  CrabBuilderParams cfg_params = getCrabBuilderParamsFromOptions();
+  cfg_params.print_cfg = false;
+  std::unique_ptr<HeapAbstraction> mem(new DummyHeapAbstraction());
+  s->man.reset(new CrabBuilderManager(cfg_params, *s->tli, std::move(mem)));
+  return s.release();
+}
+
+char *clampy_functions(void *session) {
+  ClamPySession &s = *(ClamPySession *) session;
+  std::lock_guard<std::mutex> lock(s.mutex);
+  std::string res = "[";
+  bool first = true;
+  for (auto &F : *s.module) {
+    if (!isTrackable(F)) continue;
+    res += (first ? "" : ", ") + jsonString(F.getName());
+    first = false;
+  }
+  res += "]";
+  return copyString(res);
+}
+
+char *clampy_analyze(void *session, const char *function, const char *params,
+		     char **err) {
+  ClamPySession &s = *(ClamPySession *) session;
+  std::lock_guard<std::mutex> lock(s.mutex);
+  try {
+    return copyString(analyze(s, function, params));
+  } catch (const std::exception &e) {
+    *err = copyString(e.what());
+    return nullptr;
+  }
+}
+
+void clampy_free(void *session) {
+  delete (ClamPySession *) session;
+}
+
+void clampy_free_string(char *str) {
+  free(str);
+}
+
+} // extern "C"